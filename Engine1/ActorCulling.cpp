@@ -0,0 +1,355 @@
+#include "ActorCulling.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "BlockActor.h"
+#include "SkeletonActor.h"
+#include "BlockModel.h"
+#include "SkeletonModel.h"
+#include "BlockMesh.h"
+#include "SkeletonMesh.h"
+#include "MathUtil.h"
+#include "JobSystem.h"
+#include "Timer.h"
+#include "SimdMath.h"
+#include "Scene.h"
+
+using namespace Engine1;
+
+const int ActorCulling::s_minActorCountPerJob = 4096;
+
+namespace
+{
+    // Boxes are processed in groups of 4 - arrays are padded to a multiple of it.
+    const int groupSize = 4;
+
+    struct Plane
+    {
+        float a, b, c, d;
+    };
+
+    // Planes of the D3D clip space volume (-w <= x <= w, -w <= y <= w, 0 <= z <= w) in world space - 
+    // positive distance is inside. Planes are not normalized, only the sign of the distance matters.
+    void extractFrustumPlanes( const float44& viewProjection, Plane planes[ 6 ] )
+    {
+        const float4 column1( viewProjection.m11, viewProjection.m21, viewProjection.m31, viewProjection.m41 );
+        const float4 column2( viewProjection.m12, viewProjection.m22, viewProjection.m32, viewProjection.m42 );
+        const float4 column3( viewProjection.m13, viewProjection.m23, viewProjection.m33, viewProjection.m43 );
+        const float4 column4( viewProjection.m14, viewProjection.m24, viewProjection.m34, viewProjection.m44 );
+
+        const float4 planeVectors[ 6 ] = {
+            column4 + column1, // Left.
+            column4 - column1, // Right.
+            column4 + column2, // Bottom.
+            column4 - column2, // Top.
+            column3,           // Near.
+            column4 - column3  // Far.
+        };
+
+        for ( int i = 0; i < 6; ++i )
+            planes[ i ] = { planeVectors[ i ].x, planeVectors[ i ].y, planeVectors[ i ].z, planeVectors[ i ].w };
+    }
+
+    // Returns an empty box (min > max) for actors without a mesh - such boxes are always culled.
+    BoundingBox getWorldBoundingBox( const Actor& actor )
+    {
+        if ( actor.getType() == Actor::Type::BlockActor )
+        {
+            const auto& blockActor = static_cast< const BlockActor& >( actor );
+
+            if ( blockActor.getModel() && blockActor.getModel()->getMesh() )
+                return MathUtil::boundingBoxLocalToWorld( blockActor.getModel()->getMesh()->getBoundingBox(), blockActor.getPose() );
+        }
+        else if ( actor.getType() == Actor::Type::SkeletonActor )
+        {
+            const auto& skeletonActor = static_cast< const SkeletonActor& >( actor );
+
+            if ( skeletonActor.getModel() && skeletonActor.getModel()->getMesh() )
+                return MathUtil::boundingBoxLocalToWorld( skeletonActor.getBoundingBox(), skeletonActor.getPose() );
+        }
+
+        return BoundingBox( float3( FLT_MAX, FLT_MAX, FLT_MAX ), float3( -FLT_MAX, -FLT_MAX, -FLT_MAX ) );
+    }
+}
+
+ActorCulling::Settings::Settings() :
+    frustumCulling( true ),
+    occlusionCulling( false ),
+    occlusionBufferDimensions( 256, 128 ),
+    maxOccluderCount( 16 ),
+    maxOccluderTriangleCount( 2000 ),
+    minOccluderSize( 0.1f )
+{}
+
+ActorCulling::ActorCulling()
+{
+    m_statistics = Statistics();
+}
+
+ActorCulling::~ActorCulling()
+{}
+
+void ActorCulling::update( const std::vector< std::shared_ptr< Actor > >& actors )
+{
+    const Timer startTime;
+
+    m_actors = actors;
+
+    resize();
+
+    JobSystem::get().parallelFor( (int)m_actors.size(), s_minActorCountPerJob, [this]( const int begin, const int end )
+    {
+        for ( int i = begin; i < end; ++i )
+            setBoundingBox( i, getWorldBoundingBox( *m_actors[ i ] ) );
+    } );
+
+    const Timer endTime;
+
+    m_statistics.actorCount     = (int)m_actors.size();
+    m_statistics.updateDuration = Timer::getElapsedTime( endTime, startTime );
+}
+
+void ActorCulling::update( const Scene& scene )
+{
+    const Timer startTime;
+
+    const Scene::BlockActorArrays&    blockActors    = scene.getBlockActors();
+    const Scene::SkeletonActorArrays& skeletonActors = scene.getSkeletonActors();
+
+    m_actors.assign( blockActors.actors.begin(), blockActors.actors.end() );
+    m_actors.insert( m_actors.end(), skeletonActors.actors.begin(), skeletonActors.actors.end() );
+
+    resize();
+
+    for ( int i = 0; i < blockActors.size(); ++i )
+        setBoundingBox( i, blockActors.bounds[ i ] );
+
+    for ( int i = 0; i < skeletonActors.size(); ++i )
+        setBoundingBox( blockActors.size() + i, skeletonActors.bounds[ i ] );
+
+    const Timer endTime;
+
+    m_statistics.actorCount     = (int)m_actors.size();
+    m_statistics.updateDuration = Timer::getElapsedTime( endTime, startTime );
+}
+
+void ActorCulling::resize()
+{
+    const int actorCount  = (int)m_actors.size();
+    const int paddedCount = ( actorCount + groupSize - 1 ) / groupSize * groupSize;
+
+    // Padding boxes are never read back - their values don't matter.
+    m_minX.resize( paddedCount, 0.0f );
+    m_minY.resize( paddedCount, 0.0f );
+    m_minZ.resize( paddedCount, 0.0f );
+    m_maxX.resize( paddedCount, 0.0f );
+    m_maxY.resize( paddedCount, 0.0f );
+    m_maxZ.resize( paddedCount, 0.0f );
+    m_visibility.resize( paddedCount );
+}
+
+void ActorCulling::setBoundingBox( const int actorIdx, const BoundingBox& box )
+{
+    const float3 min = box.getMin();
+    const float3 max = box.getMax();
+
+    m_minX[ actorIdx ] = min.x;
+    m_minY[ actorIdx ] = min.y;
+    m_minZ[ actorIdx ] = min.z;
+    m_maxX[ actorIdx ] = max.x;
+    m_maxY[ actorIdx ] = max.y;
+    m_maxZ[ actorIdx ] = max.z;
+}
+
+void ActorCulling::cull( const float44& viewProjection, const Settings& settings )
+{
+    const int actorCount = (int)m_actors.size();
+
+    m_statistics.frustumCullingDuration   = 0.0;
+    m_statistics.occlusionCullingDuration = 0.0;
+    m_statistics.occluderCount            = 0;
+
+    const Timer frustumStartTime;
+
+    if ( settings.frustumCulling )
+        cullFrustum( viewProjection );
+    else
+        std::fill( m_visibility.begin(), m_visibility.end(), (unsigned char)1 );
+
+    const Timer frustumEndTime;
+
+    m_statistics.frustumCullingDuration   = Timer::getElapsedTime( frustumEndTime, frustumStartTime );
+    m_statistics.frustumVisibleActorCount = (int)std::count( m_visibility.begin(), m_visibility.begin() + actorCount, (unsigned char)1 );
+
+    if ( settings.occlusionCulling )
+    {
+        const Timer occlusionStartTime;
+
+        cullOccluded( viewProjection, settings );
+
+        const Timer occlusionEndTime;
+
+        m_statistics.occlusionCullingDuration = Timer::getElapsedTime( occlusionEndTime, occlusionStartTime );
+    }
+
+    m_visibleActors.clear();
+    m_visibleBoundingBoxes.clear();
+    for ( int i = 0; i < actorCount; ++i ) 
+    {
+        if ( m_visibility[ i ] == 0 )
+            continue;
+
+        m_visibleActors.push_back( m_actors[ i ] );
+        m_visibleBoundingBoxes.emplace_back( float3( m_minX[ i ], m_minY[ i ], m_minZ[ i ] ), float3( m_maxX[ i ], m_maxY[ i ], m_maxZ[ i ] ) );
+    }
+
+    m_statistics.visibleActorCount = (int)m_visibleActors.size();
+}
+
+void ActorCulling::cullFrustum( const float44& viewProjection )
+{
+    Plane planes[ 6 ];
+    extractFrustumPlanes( viewProjection, planes );
+
+    // For each plane test only the box corner furthest along the plane normal - box is outside if that corner is outside.
+    auto cullGroups = [&]( const int beginGroup, const int endGroup )
+    {
+        const int begin = beginGroup * groupSize;
+        const int end   = endGroup * groupSize;
+
+#if ENGINE1_MATH_SIMD >= 1
+        for ( int i = begin; i < end; i += groupSize )
+        {
+            __m128 outside = _mm_setzero_ps();
+
+            for ( const Plane& plane : planes )
+            {
+                const __m128 x = _mm_loadu_ps( plane.a >= 0.0f ? &m_maxX[ i ] : &m_minX[ i ] );
+                const __m128 y = _mm_loadu_ps( plane.b >= 0.0f ? &m_maxY[ i ] : &m_minY[ i ] );
+                const __m128 z = _mm_loadu_ps( plane.c >= 0.0f ? &m_maxZ[ i ] : &m_minZ[ i ] );
+
+                const __m128 distance = _mm_add_ps( 
+                    _mm_add_ps( _mm_mul_ps( x, _mm_set1_ps( plane.a ) ), _mm_mul_ps( y, _mm_set1_ps( plane.b ) ) ),
+                    _mm_add_ps( _mm_mul_ps( z, _mm_set1_ps( plane.c ) ), _mm_set1_ps( plane.d ) )
+                );
+
+                outside = _mm_or_ps( outside, _mm_cmplt_ps( distance, _mm_setzero_ps() ) );
+            }
+
+            const int outsideMask = _mm_movemask_ps( outside );
+            for ( int lane = 0; lane < groupSize; ++lane )
+                m_visibility[ i + lane ] = ( outsideMask >> lane ) & 1 ? 0 : 1;
+        }
+#else
+        for ( int i = begin; i < end; ++i )
+        {
+            bool outside = false;
+
+            for ( const Plane& plane : planes )
+            {
+                const float x = plane.a >= 0.0f ? m_maxX[ i ] : m_minX[ i ];
+                const float y = plane.b >= 0.0f ? m_maxY[ i ] : m_minY[ i ];
+                const float z = plane.c >= 0.0f ? m_maxZ[ i ] : m_minZ[ i ];
+
+                outside |= x * plane.a + y * plane.b + z * plane.c + plane.d < 0.0f;
+            }
+
+            m_visibility[ i ] = outside ? 0 : 1;
+        }
+#endif
+    };
+
+    JobSystem::get().parallelFor( (int)m_visibility.size() / groupSize, s_minActorCountPerJob / groupSize, cullGroups );
+}
+
+void ActorCulling::cullOccluded( const float44& viewProjection, const Settings& settings )
+{
+    const int actorCount = (int)m_actors.size();
+
+    // Pick the occluders - visible block actors with small meshes in CPU memory, which appear the largest on the screen.
+    m_occluderCandidates.clear();
+    for ( int i = 0; i < actorCount; ++i )
+    {
+        if ( m_visibility[ i ] == 0 || m_actors[ i ]->getType() != Actor::Type::BlockActor )
+            continue;
+
+        const auto& blockActor = static_cast< const BlockActor& >( *m_actors[ i ] );
+        const auto  mesh       = blockActor.getModel() ? blockActor.getModel()->getMesh() : nullptr;
+
+        if ( !mesh || !mesh->isInCpuMemory() || (int)mesh->getTriangles().size() > settings.maxOccluderTriangleCount )
+            continue;
+
+        const float3 center( ( m_minX[ i ] + m_maxX[ i ] ) * 0.5f, ( m_minY[ i ] + m_maxY[ i ] ) * 0.5f, ( m_minZ[ i ] + m_maxZ[ i ] ) * 0.5f );
+        const float  radius = float3( m_maxX[ i ] - m_minX[ i ], m_maxY[ i ] - m_minY[ i ], m_maxZ[ i ] - m_minZ[ i ] ).length() * 0.5f;
+
+        // Clip space w is the view space depth.
+        const float depth = center.x * viewProjection.m14 + center.y * viewProjection.m24 + center.z * viewProjection.m34 + viewProjection.m44;
+        const float size  = radius / std::max( depth, 0.0001f );
+
+        if ( size >= settings.minOccluderSize )
+            m_occluderCandidates.emplace_back( size, i );
+    }
+
+    const int occluderCount = std::min( (int)m_occluderCandidates.size(), settings.maxOccluderCount );
+
+    std::partial_sort( 
+        m_occluderCandidates.begin(), m_occluderCandidates.begin() + occluderCount, m_occluderCandidates.end(), 
+        []( const std::pair< float, int >& a, const std::pair< float, int >& b ) { return a.first > b.first; } 
+    );
+
+    m_statistics.occluderCount = occluderCount;
+
+    if ( occluderCount == 0 )
+        return;
+
+    m_occlusionBuffer.reset( settings.occlusionBufferDimensions, viewProjection );
+
+    for ( int i = 0; i < occluderCount; ++i )
+    {
+        const int   actorIndex = m_occluderCandidates[ i ].second;
+        const auto& blockActor = static_cast< const BlockActor& >( *m_actors[ actorIndex ] );
+        const auto& mesh       = *blockActor.getModel()->getMesh();
+
+        m_occlusionBuffer.rasterizeTriangles( mesh.getVertices(), mesh.getTriangles(), blockActor.getPose() );
+
+        // Mark as an occluder - occluders are not tested against themselves.
+        m_visibility[ actorIndex ] = 2;
+    }
+
+    m_occlusionBuffer.finishRasterization();
+
+    auto cullActors = [this]( const int begin, const int end )
+    {
+        for ( int i = begin; i < end; ++i )
+        {
+            if ( m_visibility[ i ] != 1 )
+                continue;
+
+            if ( m_occlusionBuffer.isOccluded( float3( m_minX[ i ], m_minY[ i ], m_minZ[ i ] ), float3( m_maxX[ i ], m_maxY[ i ], m_maxZ[ i ] ) ) )
+                m_visibility[ i ] = 0;
+        }
+    };
+
+    JobSystem::get().parallelFor( actorCount, s_minActorCountPerJob, cullActors );
+}
+
+const std::vector< std::shared_ptr< Actor > >& ActorCulling::getVisibleActors() const
+{
+    return m_visibleActors;
+}
+
+const std::vector< BoundingBox >& ActorCulling::getVisibleBoundingBoxes() const
+{
+    return m_visibleBoundingBoxes;
+}
+
+const ActorCulling::Statistics& ActorCulling::getStatistics() const
+{
+    return m_statistics;
+}
+
+const SoftwareDepthBuffer& ActorCulling::getOcclusionBuffer() const
+{
+    return m_occlusionBuffer;
+}
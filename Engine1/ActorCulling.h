@@ -0,0 +1,107 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "int2.h"
+#include "float44.h"
+#include "BoundingBox.h"
+#include "SoftwareDepthBuffer.h"
+
+namespace Engine1
+{
+    class Actor;
+    class Scene;
+
+    // Decides which actors have to be rendered for a given camera - before anything is submitted to the GPU.
+    // World bounding boxes of the actors are kept in flat arrays (one per component), tested against the view frustum 
+    // with SIMD (4 boxes per plane test) in parallel chunks on the JobSystem. Optionally the boxes which passed are tested 
+    // against a low resolution depth buffer, rasterized on the CPU from the few largest occluders (block actors with meshes in CPU memory).
+    class ActorCulling
+    {
+        public:
+
+        struct Settings
+        {
+            Settings();
+
+            bool frustumCulling;
+            bool occlusionCulling;
+            int2 occlusionBufferDimensions;
+            int  maxOccluderCount;
+            int  maxOccluderTriangleCount;
+            // Minimal ratio of bounding sphere radius to the distance from the camera for an actor to be used as an occluder.
+            float minOccluderSize;
+        };
+
+        struct Statistics
+        {
+            int actorCount;
+            int frustumVisibleActorCount;
+            int occluderCount;
+            int visibleActorCount;
+
+            // In milliseconds.
+            double updateDuration;
+            double frustumCullingDuration;
+            double occlusionCullingDuration;
+        };
+
+        static const int s_minActorCountPerJob;
+
+        ActorCulling();
+        ~ActorCulling();
+
+        // Gathers the actors and their world bounding boxes. Has to be called again after actors are added, removed, moved or animated.
+        void update( const std::vector< std::shared_ptr< Actor > >& actors );
+
+        // Same as above, but takes the bounding boxes kept by the scene - block actors first, then skeleton actors.
+        void update( const Scene& scene );
+
+        // viewProjection - world to clip space (p * view * projection), D3D clip space (0 <= z <= w).
+        void cull( const float44& viewProjection, const Settings& settings );
+
+        // Result of the last cull. Order is the same as in the updated actor set.
+        const std::vector< std::shared_ptr< Actor > >& getVisibleActors() const;
+
+        // World bounding boxes of the visible actors (same order as getVisibleActors).
+        const std::vector< BoundingBox >& getVisibleBoundingBoxes() const;
+
+        const Statistics& getStatistics() const;
+
+        const SoftwareDepthBuffer& getOcclusionBuffer() const;
+
+        private:
+
+        // Resizes the bounding box arrays to the actor count.
+        void resize();
+
+        void setBoundingBox( const int actorIdx, const BoundingBox& box );
+
+        void cullFrustum( const float44& viewProjection );
+        void cullOccluded( const float44& viewProjection, const Settings& settings );
+
+        std::vector< std::shared_ptr< Actor > > m_actors;
+
+        // World bounding boxes of m_actors.
+        std::vector< float > m_minX;
+        std::vector< float > m_minY;
+        std::vector< float > m_minZ;
+        std::vector< float > m_maxX;
+        std::vector< float > m_maxY;
+        std::vector< float > m_maxZ;
+
+        // Per actor - 1 if visible.
+        std::vector< unsigned char > m_visibility;
+
+        std::vector< std::shared_ptr< Actor > > m_visibleActors;
+        std::vector< BoundingBox >              m_visibleBoundingBoxes;
+
+        SoftwareDepthBuffer m_occlusionBuffer;
+
+        // Occluder candidates - ( size, actor index ).
+        std::vector< std::pair< float, int > > m_occluderCandidates;
+
+        Statistics m_statistics;
+    };
+}
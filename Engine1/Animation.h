@@ -28,6 +28,7 @@ namespace Engine1
         void setCurrentPlaybackTime( float playbackTime );
         void setCurrentPlaybackDirection( float playbackDirection );
         void setSmoothstepInterpolation( bool useSmoothstep );
+        void setSpeedMultiplier( float speedMultiplier );
 
         float getCurrentPlaybackTime() const;
         float getCurrentPlaybackDirection() const;
@@ -134,6 +135,12 @@ namespace Engine1
         m_smoothstepInterpolation = useSmoothstep;
     }
 
+    template <typename T>
+    void Animation< T >::setSpeedMultiplier( float speedMultiplier )
+    {
+        m_speedMultiplier = speedMultiplier;
+    }
+
     template <typename T>
     float Animation< T >::getCurrentPlaybackTime() const
     {
@@ -0,0 +1,115 @@
+#include "AnimationChannels.h"
+
+#include <algorithm>
+
+#include "BlockActor.h"
+#include "BlockModel.h"
+#include "SpotLight.h"
+#include "FreeCamera.h"
+#include "MathUtil.h"
+#include "float33.h"
+#include "float43.h"
+
+using namespace Engine1;
+
+AnimationChannels< BlockActor > AnimationChannels< BlockActor >::extract( const BlockActor& actor )
+{
+    AnimationChannels channels;
+    channels.orientation = quat( actor.getPose() );
+    channels.translation = actor.getPose().getTranslation();
+
+    return channels;
+}
+
+void AnimationChannels< BlockActor >::apply( BlockActor& actor, const AnimationChannels& from, const AnimationChannels& to, const float ratio )
+{
+    // Pose is set directly - physics is not moved by animation.
+    float43& pose = actor.getPose();
+    pose.setOrientation( quat::slerp( from.orientation, to.orientation, ratio ) );
+    pose.setTranslation( MathUtil::lerp( from.translation, to.translation, ratio ) );
+}
+
+AnimationChannels< SpotLight > AnimationChannels< SpotLight >::extract( const SpotLight& light )
+{
+    AnimationChannels channels;
+    channels.position      = light.getPosition();
+    channels.color         = light.getColor();
+    channels.orientation   = quat( MathUtil::directionToRotationMatrix( light.getDirection() ) );
+    channels.emitterRadius = light.getEmitterRadius();
+    channels.coneAngle     = light.getConeAngle();
+
+    return channels;
+}
+
+void AnimationChannels< SpotLight >::apply( SpotLight& light, const AnimationChannels& from, const AnimationChannels& to, const float ratio )
+{
+    // Direction is the 3rd row of the rotation matrix.
+    float3 direction = float33( quat::slerp( from.orientation, to.orientation, ratio ) ).getRow3();
+    direction.normalize();
+
+    light.setPosition( MathUtil::lerp( from.position, to.position, ratio ) );
+    light.setColor( MathUtil::lerp( from.color, to.color, ratio ) );
+    light.setEmitterRadius( MathUtil::lerp( from.emitterRadius, to.emitterRadius, ratio ) );
+    light.setDirection( direction );
+    light.setConeAngle( MathUtil::lerp( from.coneAngle, to.coneAngle, ratio ) );
+}
+
+AnimationChannels< FreeCamera > AnimationChannels< FreeCamera >::extract( const FreeCamera& camera )
+{
+    AnimationChannels channels;
+    channels.position    = camera.getPosition();
+    channels.orientation = quat( float33( cross( camera.getUp(), camera.getDirection() ), camera.getUp(), camera.getDirection() ) );
+    channels.fieldOfView = camera.getFieldOfView();
+
+    return channels;
+}
+
+void AnimationChannels< FreeCamera >::apply( FreeCamera& camera, const AnimationChannels& from, const AnimationChannels& to, const float ratio )
+{
+    const float33 orientation( quat::slerp( from.orientation, to.orientation, ratio ) );
+
+    camera.setPosition( MathUtil::lerp( from.position, to.position, ratio ) );
+    camera.setDirection( orientation.getRow3() );
+    camera.setUp( orientation.getRow2() );
+    camera.setFieldOfView( MathUtil::lerp( from.fieldOfView, to.fieldOfView, ratio ) );
+}
+
+AnimationChannels< BlockModel > AnimationChannels< BlockModel >::extract( const BlockModel& model )
+{
+    AnimationChannels channels;
+
+    for ( int typeIdx = 0; typeIdx < static_cast< int >( Model::TextureType::COUNT ); ++typeIdx )
+    {
+        const auto type         = static_cast< Model::TextureType >( typeIdx );
+        const int  textureCount = model.getTextureCount( type );
+
+        for ( int textureIdx = 0; textureIdx < textureCount; ++textureIdx )
+            channels.textureColorMultipliers.push_back( model.getTextureColorMultiplier( type, textureIdx ) );
+
+        channels.textureCounts.push_back( textureCount );
+    }
+
+    return channels;
+}
+
+void AnimationChannels< BlockModel >::apply( BlockModel& model, const AnimationChannels& from, const AnimationChannels& to, const float ratio )
+{
+    int fromFirstIdx = 0, toFirstIdx = 0;
+    for ( int typeIdx = 0; typeIdx < static_cast< int >( Model::TextureType::COUNT ); ++typeIdx )
+    {
+        const auto type = static_cast< Model::TextureType >( typeIdx );
+
+        // Textures could have been added or removed since the keyframes were created.
+        const int textureCount = std::min( model.getTextureCount( type ), std::min( from.textureCounts[ typeIdx ], to.textureCounts[ typeIdx ] ) );
+
+        for ( int textureIdx = 0; textureIdx < textureCount; ++textureIdx )
+        {
+            const float4 colorMul = MathUtil::lerp( from.textureColorMultipliers[ fromFirstIdx + textureIdx ], to.textureColorMultipliers[ toFirstIdx + textureIdx ], ratio );
+
+            model.setTextureColorMultiplier( colorMul, type, textureIdx );
+        }
+
+        fromFirstIdx += from.textureCounts[ typeIdx ];
+        toFirstIdx   += to.textureCounts[ typeIdx ];
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+
+#include "float3.h"
+#include "float4.h"
+#include "quat.h"
+
+namespace Engine1
+{
+    class BlockActor;
+    class BlockModel;
+    class SpotLight;
+    class FreeCamera;
+
+    // Animated values of an object stored at each keyframe by Animator - only the values which get interpolated,
+    // not the whole object. Each specialization provides:
+    // extract - reads the values from the object,
+    // apply   - sets interpolated values on the object (has to be safe to call for different objects in parallel).
+    template< typename T >
+    struct AnimationChannels;
+
+    template<>
+    struct AnimationChannels< BlockActor >
+    {
+        quat   orientation;
+        float3 translation;
+
+        static AnimationChannels extract( const BlockActor& actor );
+        static void              apply( BlockActor& actor, const AnimationChannels& from, const AnimationChannels& to, const float ratio );
+    };
+
+    template<>
+    struct AnimationChannels< SpotLight >
+    {
+        float3 position;
+        float3 color;
+        quat   orientation; // Rotation matrix created from the light direction.
+        float  emitterRadius;
+        float  coneAngle;
+
+        static AnimationChannels extract( const SpotLight& light );
+        static void              apply( SpotLight& light, const AnimationChannels& from, const AnimationChannels& to, const float ratio );
+    };
+
+    template<>
+    struct AnimationChannels< FreeCamera >
+    {
+        float3 position;
+        quat   orientation; // Rotation matrix created from the right, up and direction vectors.
+        float  fieldOfView;
+
+        static AnimationChannels extract( const FreeCamera& camera );
+        static void              apply( FreeCamera& camera, const AnimationChannels& from, const AnimationChannels& to, const float ratio );
+    };
+
+    template<>
+    struct AnimationChannels< BlockModel >
+    {
+        // Color multipliers of all the textures, ordered by texture type.
+        std::vector< float4 > textureColorMultipliers;
+        std::vector< int >    textureCounts; // For each texture type.
+
+        static AnimationChannels extract( const BlockModel& model );
+        static void              apply( BlockModel& model, const AnimationChannels& from, const AnimationChannels& to, const float ratio );
+    };
+}
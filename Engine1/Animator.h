@@ -1,14 +1,24 @@
 #pragma once
 
 #include <memory>
-#include <map>
+#include <unordered_map>
 #include <vector>
+#include <atomic>
+#include <algorithm>
 
 #include "Animation.h"
+#include "AnimationChannels.h"
+#include "BinaryFile.h"
+#include "JobSystem.h"
 #include "MathUtil.h"
 
 namespace Engine1
 {
+    // Plays keyframe animations of objects. Keyframes store only the animated values (see AnimationChannels)
+    // and the state of all the animations is kept in flat arrays indexed by animation.
+    // Animations are updated in parallel - AnimationChannels< T >::apply is called for different objects at the same time.
+    // Update can be split into evaluate and apply - interpolated values are kept aside until apply, so the objects can be read
+    // (e.g. rendered) by other threads while the next frame's animation is evaluated.
     template <typename T>
     class Animator
     {
@@ -23,9 +33,17 @@ namespace Engine1
         void saveAnimationToMemory( const std::shared_ptr< T >& obj, std::vector< char >& data );
         void saveAnimationToFile( const std::shared_ptr< T >& obj, const std::string& path );
 
+        // Same as evaluate followed by apply.
         void update( float timeDelta );
 
+        // Advances the playback and finds the keyframes and interpolation ratios for the animated objects, without modifying them.
+        void evaluate( float timeDelta );
+
+        // Sets the values found by the last evaluate on the objects.
+        void apply();
+
         // Negative time is treated as last keyframe time + 1 second (or 0 if there are no keyframes yet).
+        // Keyframes can only be added after the last keyframe.
         void addKeyframe( const std::shared_ptr< T >& obj, float time = -1.0f );
 
         void removeLastKeyframe( const std::shared_ptr< T >& obj );
@@ -46,14 +64,42 @@ namespace Engine1
 
         private:
 
-        // #WARNING: Using weak_ptr in the map is potentially dangerous
-        // as weak_ptr changes over time and that may influence the way it's sorted inside the map.
-        // #TODO: Think how to overcome this problem. Use raw data ptr as key?
-        std::map< 
-            std::weak_ptr< T >, 
-            Animation< T >,
-            std::owner_less< std::weak_ptr< T > >
-        > animations;
+        static const int s_minAnimationCountPerJob = 256;
+
+        // Returns -1 if the object has no animation.
+        int findAnimation( const std::shared_ptr< T >& obj ) const;
+        int findOrAddAnimation( const std::shared_ptr< T >& obj );
+
+        void removeAnimation( const int animationIdx );
+
+        void evaluateAnimation( const int animationIdx, const float timeDelta );
+
+        // Returns false if the object got deleted.
+        bool applyAnimation( const int animationIdx );
+
+        // Returns index of the keyframe starting the segment which contains the time.
+        // Cursor is the segment found in the previous update - playback usually stays in the same segment or moves to the neighboring one.
+        static int findKeyframe( const std::vector< float >& keyframeTimes, const float time, int& cursor );
+
+        // Objects are identified by their address. Stored weak pointers detect a deleted object whose address got reused.
+        std::unordered_map< const T*, int > m_animationIndices;
+
+        std::vector< std::weak_ptr< T > > m_objects;
+        std::vector< const T* >           m_objectAddresses; // Keys in m_animationIndices.
+
+        std::vector< std::vector< float > >                  m_keyframeTimes;
+        std::vector< std::vector< AnimationChannels< T > > > m_keyframeValues;
+
+        std::vector< float >         m_playbackTimes;
+        std::vector< float >         m_playbackDirections; // Equals 1 or -1.
+        std::vector< float >         m_speedMultipliers;
+        std::vector< int >           m_cursors;
+        std::vector< unsigned char > m_enabled;
+        std::vector< unsigned char > m_smoothstepInterpolation;
+
+        // Result of the last evaluate - keyframe starting the segment to interpolate (-1 if there is nothing to apply) and the ratio.
+        std::vector< int >           m_pendingKeyframes;
+        std::vector< float >         m_pendingRatios;
     };
 
     template< typename T >
@@ -69,291 +115,385 @@ namespace Engine1
     {
         auto animation = Animation< T >::createFromMemory( data.begin(), data.end() );
 
-        std::weak_ptr< T > objWeakPtr = obj;
+        const int animationIdx = findOrAddAnimation( obj );
+
+        m_keyframeTimes[ animationIdx ].clear();
+        m_keyframeValues[ animationIdx ].clear();
 
-        // Insert or find the key.
-        auto  result = animations.insert( std::make_pair( objWeakPtr, Animation< T >() ) );
-        auto& anim   = result.first->second;
+        for ( const auto& keyframe : animation->getKeyframes() )
+        {
+            m_keyframeTimes[ animationIdx ].push_back( std::get< 1 >( keyframe ) );
+            m_keyframeValues[ animationIdx ].push_back( AnimationChannels< T >::extract( std::get< 0 >( keyframe ) ) );
+        }
 
-        anim.clearKeyframes();
-        anim = std::move( *animation );
+        m_playbackTimes[ animationIdx ]           = animation->getCurrentPlaybackTime();
+        m_playbackDirections[ animationIdx ]      = animation->getCurrentPlaybackDirection() < 0.0f ? -1.0f : 1.0f;
+        m_speedMultipliers[ animationIdx ]        = animation->getSpeedMultiplier();
+        m_cursors[ animationIdx ]                 = 0;
+        m_enabled[ animationIdx ]                 = animation->isEnabled();
+        m_smoothstepInterpolation[ animationIdx ] = animation->isSmoothstepInterpolated();
     }
 
     template< typename T >
     void Animator< T >::loadAnimationFromFile( const std::shared_ptr< T >& obj, const std::string& path )
     {
-        auto animation = Animation< T >::createFromFile( path );
-
-        std::weak_ptr< T > objWeakPtr = obj;
+        std::shared_ptr< std::vector< char > > fileData = BinaryFile::load( path );
 
-        // Insert or find the key.
-        auto  result = animations.insert( std::make_pair( objWeakPtr, Animation< T >() ) );
-        auto& anim   = result.first->second;
-
-        anim.clearKeyframes();
-        anim = std::move( *animation );
+        loadAnimationFromMemory( obj, *fileData );
     }
 
     template< typename T >
     void Animator< T >::saveAnimationToMemory( const std::shared_ptr< T >& obj, std::vector< char >& data )
     {
-        std::weak_ptr< T > objWeakPtr = obj;
-
-        auto resultIt = animations.find( objWeakPtr );
-        if ( resultIt == animations.end() )
+        const int animationIdx = findAnimation( obj );
+        if ( animationIdx < 0 )
             return;
 
-        auto& anim = resultIt->second;
+        // File format stores whole objects at each keyframe - they are recreated from the current object and the keyframe values.
+        Animation< T > animation;
+
+        for ( int keyframeIdx = 0; keyframeIdx < (int)m_keyframeTimes[ animationIdx ].size(); ++keyframeIdx )
+        {
+            const auto& values = m_keyframeValues[ animationIdx ][ keyframeIdx ];
+
+            T keyframeObj( *obj );
+            AnimationChannels< T >::apply( keyframeObj, values, values, 0.0f );
 
-        anim.saveToMemory( data );
+            animation.addKeyframe( keyframeObj, m_keyframeTimes[ animationIdx ][ keyframeIdx ] );
+        }
+
+        animation.setEnabled( m_enabled[ animationIdx ] != 0 );
+        animation.setCurrentPlaybackTime( m_playbackTimes[ animationIdx ] );
+        animation.setCurrentPlaybackDirection( m_playbackDirections[ animationIdx ] );
+        animation.setSpeedMultiplier( m_speedMultipliers[ animationIdx ] );
+        animation.setSmoothstepInterpolation( m_smoothstepInterpolation[ animationIdx ] != 0 );
+
+        animation.saveToMemory( data );
     }
 
     template< typename T >
     void Animator< T >::saveAnimationToFile( const std::shared_ptr< T >& obj, const std::string& path )
     {
-        std::weak_ptr< T > objWeakPtr = obj;
+        std::vector< char > data;
 
-        auto resultIt = animations.find( objWeakPtr );
-        if ( resultIt == animations.end() )
-            return;
+        saveAnimationToMemory( obj, data );
 
-        auto& anim = resultIt->second;
-
-        anim.saveToFile( path );
+        BinaryFile::save( path, data );
     }
 
     template< typename T >
     void Animator< T >::update( float timeDelta )
+    {
+        evaluate( timeDelta );
+        apply();
+    }
+
+    template< typename T >
+    void Animator< T >::evaluate( float timeDelta )
     {
         // Limit time delta in case of pauses/debugging.
         timeDelta = std::min( timeDelta, 0.1f );
 
-        // #TODO: Maybe remove only once a second - not at every update.
-        removeKeyframesForDeletedObjects();
-
-        for ( auto& animation : animations )
+        JobSystem::get().parallelFor( (int)m_objects.size(), s_minAnimationCountPerJob, [ & ]( const int begin, const int end )
         {
-            auto& objWeakPtr = animation.first;
-            auto& anim       = animation.second;
-
-            // Skip lights with 0 or 1 keyframes or the ones with animation disabled.
-            if ( anim.getKeyframes().size() <= 1 || !anim.isEnabled())
-                continue;
-
-            const float animDuration = anim.getDuration();
+            for ( int animationIdx = begin; animationIdx < end; ++animationIdx )
+                evaluateAnimation( animationIdx, timeDelta );
+        } );
+    }
 
-            auto newPlaybackTime = anim.getCurrentPlaybackTime() + timeDelta * anim.getSpeedMultiplier() * anim.getCurrentPlaybackDirection();
+    template< typename T >
+    void Animator< T >::apply()
+    {
+        std::atomic< bool > hasDeletedObjects( false );
 
-            // Reverse the animation direction if finished playback.
-            if (anim.getCurrentPlaybackDirection() >= 0.0f && newPlaybackTime > animDuration) 
-            {
-                newPlaybackTime = animDuration - (newPlaybackTime - animDuration);
-                newPlaybackTime = std::max( 0.0f, newPlaybackTime );
-                anim.setCurrentPlaybackDirection( anim.getCurrentPlaybackDirection() * -1.0f );
-            } 
-            else if (anim.getCurrentPlaybackDirection() < 0.0f && newPlaybackTime <= 0.0f) 
+        JobSystem::get().parallelFor( (int)m_objects.size(), s_minAnimationCountPerJob, [ & ]( const int begin, const int end )
+        {
+            for ( int animationIdx = begin; animationIdx < end; ++animationIdx )
             {
-                newPlaybackTime = -newPlaybackTime;
-                newPlaybackTime = std::min( animDuration, newPlaybackTime );
-                anim.setCurrentPlaybackDirection( anim.getCurrentPlaybackDirection() * -1.0f );
+                if ( !applyAnimation( animationIdx ) )
+                    hasDeletedObjects = true;
             }
+        } );
 
-            anim.setCurrentPlaybackTime( newPlaybackTime );
+        if ( hasDeletedObjects )
+            removeKeyframesForDeletedObjects();
+    }
 
-            // Find the closest keyframe before the desired playback time.
-            int idx, prevIdx, nextIdx;
-            if ( anim.getCurrentPlaybackDirection() > 0.0f ) 
-            {
-                for ( idx = 0; idx < (int)anim.getKeyframes().size(); ++idx ) 
-                {
-                    const float keyframeTime = std::get< 1 >( anim.getKeyframes()[ idx ] );
+    template< typename T >
+    void Animator< T >::evaluateAnimation( const int animationIdx, const float timeDelta )
+    {
+        const auto& keyframeTimes = m_keyframeTimes[ animationIdx ];
 
-                    if ( keyframeTime > anim.getCurrentPlaybackTime() )
-                        break;
-                }
+        m_pendingKeyframes[ animationIdx ] = -1;
 
-                prevIdx = idx - 1;
-                nextIdx = idx;
-            }
-            else
-            {
-                for ( idx = (int)anim.getKeyframes().size() - 1; idx >= 0; --idx ) 
-                {
-                    const float keyframeTime = std::get< 1 >( anim.getKeyframes()[ idx ] );
+        // Skip objects with 0 or 1 keyframes or the ones with animation disabled.
+        if ( keyframeTimes.size() <= 1 || !m_enabled[ animationIdx ] )
+            return;
 
-                    if ( keyframeTime < anim.getCurrentPlaybackTime() )
-                        break;
-                }
+        const float animDuration = keyframeTimes.back();
 
-                prevIdx = idx;
-                nextIdx = idx + 1;
-            }
+        float& playbackDirection = m_playbackDirections[ animationIdx ];
+        float  newPlaybackTime   = m_playbackTimes[ animationIdx ] + timeDelta * m_speedMultipliers[ animationIdx ] * playbackDirection;
 
-            // Get keyframes before and after the desired playback time.
-            const auto& obj1 = std::get< 0 >( anim.getKeyframes()[ prevIdx ] );
-            const float time1  = std::get< 1 >( anim.getKeyframes()[ prevIdx ] );
-            const auto& obj2 = std::get< 0 >( anim.getKeyframes()[ nextIdx ] );
-            const float time2  = std::get< 1 >( anim.getKeyframes()[ nextIdx ] );
+        // Reverse the animation direction if finished playback.
+        if ( playbackDirection >= 0.0f && newPlaybackTime > animDuration )
+        {
+            newPlaybackTime   = std::max( 0.0f, animDuration - ( newPlaybackTime - animDuration ) );
+            playbackDirection = -playbackDirection;
+        }
+        else if ( playbackDirection < 0.0f && newPlaybackTime <= 0.0f )
+        {
+            newPlaybackTime   = std::min( animDuration, -newPlaybackTime );
+            playbackDirection = -playbackDirection;
+        }
 
-            auto obj = objWeakPtr.lock();
+        m_playbackTimes[ animationIdx ] = newPlaybackTime;
 
-            // Check if light hasn't been deleted.
-            if ( !obj )
-                continue;
+        // Get keyframes before and after the playback time.
+        const int   keyframeIdx = findKeyframe( keyframeTimes, newPlaybackTime, m_cursors[ animationIdx ] );
+        const float time1       = keyframeTimes[ keyframeIdx ];
+        const float time2       = keyframeTimes[ keyframeIdx + 1 ];
 
-            // Interpolate the keyframes.
-            float ratio = (anim.getCurrentPlaybackTime() - time1) / (time2 - time1);
+        // Interpolate the keyframes.
+        float ratio = time2 > time1 ? std::min( 1.0f, std::max( 0.0f, ( newPlaybackTime - time1 ) / ( time2 - time1 ) ) ) : 1.0f;
 
-            if ( anim.isSmoothstepInterpolated() )
-                ratio = MathUtil::smoothstep(ratio);
+        if ( m_smoothstepInterpolation[ animationIdx ] )
+            ratio = MathUtil::smoothstep( ratio );
 
-            obj->setInterpolated( obj1, obj2, ratio );
-        }
+        m_pendingKeyframes[ animationIdx ] = keyframeIdx;
+        m_pendingRatios[ animationIdx ]    = ratio;
     }
 
     template< typename T >
-    void Animator< T >::addKeyframe( const std::shared_ptr< T >& obj, float time )
+    bool Animator< T >::applyAnimation( const int animationIdx )
     {
-        std::weak_ptr< T > objWeakPtr = obj;
+        const int keyframeIdx = m_pendingKeyframes[ animationIdx ];
+        m_pendingKeyframes[ animationIdx ] = -1;
 
-        // Insert or find the key.
-        auto  result = animations.insert( std::make_pair( objWeakPtr, Animation< T >() ) );
-        auto& anim   = result.first->second;
+        // Nothing evaluated or keyframes got removed since then.
+        if ( keyframeIdx < 0 || keyframeIdx + 1 >= (int)m_keyframeValues[ animationIdx ].size() )
+            return true;
 
-        if ( time < 0.0f && !anim.getKeyframes().empty() )
-            time = std::get< 1 >( anim.getKeyframes().back() ) + 1.0f;
-        else
-            time = 0.0f;
+        auto obj = m_objects[ animationIdx ].lock();
+
+        // Check if object hasn't been deleted.
+        if ( !obj )
+            return false;
+
+        AnimationChannels< T >::apply( *obj, m_keyframeValues[ animationIdx ][ keyframeIdx ], m_keyframeValues[ animationIdx ][ keyframeIdx + 1 ], m_pendingRatios[ animationIdx ] );
 
-        anim.addKeyframe( *obj, time );
+        return true;
     }
 
     template< typename T >
-    void Animator< T >::removeLastKeyframe( const std::shared_ptr< T >& obj )
+    int Animator< T >::findKeyframe( const std::vector< float >& keyframeTimes, const float time, int& cursor )
     {
-        std::weak_ptr< T > objWeakPtr = obj;
+        const int lastSegmentIdx = (int)keyframeTimes.size() - 2;
 
-        auto result = animations.find( objWeakPtr );
-        if ( result != animations.end() )
-        {
-            auto& anim = result->second;
+        int idx = std::min( std::max( cursor, 0 ), lastSegmentIdx );
 
-            if ( !anim.getKeyframes().empty() )
-                anim.getKeyframes().pop_back();
+        if ( keyframeTimes[ idx ] <= time && time <= keyframeTimes[ idx + 1 ] )
+            ; // Still in the same segment.
+        else if ( idx < lastSegmentIdx && keyframeTimes[ idx + 1 ] <= time && time <= keyframeTimes[ idx + 2 ] )
+            ++idx;
+        else if ( idx > 0 && keyframeTimes[ idx - 1 ] <= time && time <= keyframeTimes[ idx ] )
+            --idx;
+        else
+        {
+            // Playback time jumped - binary search for the last keyframe not after the time.
+            idx = (int)( std::upper_bound( keyframeTimes.begin(), keyframeTimes.end(), time ) - keyframeTimes.begin() ) - 1;
+            idx = std::min( std::max( idx, 0 ), lastSegmentIdx );
         }
+
+        cursor = idx;
+
+        return idx;
     }
 
     template< typename T >
-    int Animator< T >::getKeyframeCount( const std::shared_ptr< T >& obj )
+    void Animator< T >::addKeyframe( const std::shared_ptr< T >& obj, float time )
     {
-        std::weak_ptr< T > objWeakPtr = obj;
+        const int animationIdx = findOrAddAnimation( obj );
 
-        auto result = animations.find( objWeakPtr );
-        if ( result != animations.end() )
-        {
-            auto& anim = result->second;
+        auto& keyframeTimes = m_keyframeTimes[ animationIdx ];
 
-            return static_cast< int > ( anim.getKeyframes().size() );
-        }
+        if ( time < 0.0f )
+            time = keyframeTimes.empty() ? 0.0f : keyframeTimes.back() + 1.0f;
 
-        return 0;
+        //#TODO: Insert the key frame somewhere in the middle.
+        if ( !keyframeTimes.empty() && time <= keyframeTimes.back() )
+            return;
+
+        keyframeTimes.push_back( time );
+        m_keyframeValues[ animationIdx ].push_back( AnimationChannels< T >::extract( *obj ) );
     }
 
     template< typename T >
-    void Animator< T >::setPlaying( const std::shared_ptr< T >& obj, const bool playing )
+    void Animator< T >::removeLastKeyframe( const std::shared_ptr< T >& obj )
     {
-        std::weak_ptr< T > objWeakPtr = obj;
-
-        auto resultIt = animations.find( objWeakPtr );
-        if ( resultIt == animations.end() )
+        const int animationIdx = findAnimation( obj );
+        if ( animationIdx < 0 || m_keyframeTimes[ animationIdx ].empty() )
             return;
 
-        auto& anim = resultIt->second;
+        m_keyframeTimes[ animationIdx ].pop_back();
+        m_keyframeValues[ animationIdx ].pop_back();
 
-        anim.setEnabled( playing );
+        const float duration = m_keyframeTimes[ animationIdx ].empty() ? 0.0f : m_keyframeTimes[ animationIdx ].back();
+        m_playbackTimes[ animationIdx ] = std::min( m_playbackTimes[ animationIdx ], duration );
     }
 
     template< typename T >
-    void Animator< T >::setPlaybackTime( const std::shared_ptr< T >& obj, const float time )
+    int Animator< T >::getKeyframeCount( const std::shared_ptr< T >& obj )
     {
-        std::weak_ptr< T > objWeakPtr = obj;
+        const int animationIdx = findAnimation( obj );
 
-        auto resultIt = animations.find( objWeakPtr );
-        if ( resultIt == animations.end() )
-            return;
-
-        auto& anim = resultIt->second;
-
-        anim.setCurrentPlaybackTime( time );
+        return animationIdx >= 0 ? (int)m_keyframeTimes[ animationIdx ].size() : 0;
     }
 
     template< typename T >
-    void Animator< T >::setSmoothstepInterpolation( const std::shared_ptr< T >& obj, bool smoothstep )
+    void Animator< T >::setPlaying( const std::shared_ptr< T >& obj, const bool playing )
     {
-        std::weak_ptr< T > objWeakPtr = obj;
+        const int animationIdx = findAnimation( obj );
+        if ( animationIdx >= 0 )
+            m_enabled[ animationIdx ] = playing;
+    }
 
-        auto resultIt = animations.find( objWeakPtr );
-        if ( resultIt == animations.end() )
+    template< typename T >
+    void Animator< T >::setPlaybackTime( const std::shared_ptr< T >& obj, const float time )
+    {
+        const int animationIdx = findAnimation( obj );
+        if ( animationIdx < 0 )
             return;
 
-        auto& anim = resultIt->second;
+        const float duration = m_keyframeTimes[ animationIdx ].empty() ? 0.0f : m_keyframeTimes[ animationIdx ].back();
 
-        anim.setSmoothstepInterpolation( smoothstep );
+        m_playbackTimes[ animationIdx ] = std::min( std::max( time, 0.0f ), duration );
     }
 
     template< typename T >
-    bool Animator< T >::isPlaying( const std::shared_ptr< T >& obj )
+    void Animator< T >::setSmoothstepInterpolation( const std::shared_ptr< T >& obj, bool smoothstep )
     {
-        std::weak_ptr< T > objWeakPtr = obj;
-
-        auto resultIt = animations.find( objWeakPtr );
-        if ( resultIt == animations.end() )
-            return false;
+        const int animationIdx = findAnimation( obj );
+        if ( animationIdx >= 0 )
+            m_smoothstepInterpolation[ animationIdx ] = smoothstep;
+    }
 
-        auto& anim = resultIt->second;
+    template< typename T >
+    bool Animator< T >::isPlaying( const std::shared_ptr< T >& obj )
+    {
+        const int animationIdx = findAnimation( obj );
 
-        return anim.isEnabled();
+        return animationIdx >= 0 && m_enabled[ animationIdx ];
     }
 
     template< typename T >
     float Animator< T >::getSpeedMultiplier( const std::shared_ptr< T >& obj ) const
     {
-        std::weak_ptr< T > objWeakPtr = obj;
+        const int animationIdx = findAnimation( obj );
 
-        auto resultIt = animations.find( objWeakPtr );
-        if ( resultIt == animations.end() )
-            return 0.0f;
+        return animationIdx >= 0 ? m_speedMultipliers[ animationIdx ] : 0.0f;
+    }
 
-        auto& anim = resultIt->second;
+    template< typename T >
+    void  Animator< T >::setSpeedMultiplier( const std::shared_ptr< T >& obj, const float speedMultiplier )
+    {
+        const int animationIdx = findAnimation( obj );
+        if ( animationIdx >= 0 )
+            m_speedMultipliers[ animationIdx ] = speedMultiplier;
+    }
 
-        return anim.speedMultiplier;
+    template< typename T >
+    void Animator< T >::removeKeyframesForDeletedObjects()
+    {
+        for ( int animationIdx = (int)m_objects.size() - 1; animationIdx >= 0; --animationIdx )
+        {
+            if ( m_objects[ animationIdx ].expired() )
+                removeAnimation( animationIdx );
+        }
     }
 
     template< typename T >
-    void  Animator< T >::setSpeedMultiplier( const std::shared_ptr< T >& obj, const float speedMultiplier )
+    int Animator< T >::findAnimation( const std::shared_ptr< T >& obj ) const
     {
-        std::weak_ptr< T > objWeakPtr = obj;
+        const auto it = m_animationIndices.find( obj.get() );
+        if ( it == m_animationIndices.end() )
+            return -1;
 
-        auto resultIt = animations.find( objWeakPtr );
-        if ( resultIt == animations.end() )
-            return;
+        // Object at the same address may be a new one - the animated object got deleted.
+        const auto& storedObj = m_objects[ it->second ];
+        if ( storedObj.owner_before( obj ) || obj.owner_before( storedObj ) )
+            return -1;
 
-        auto& anim = resultIt->second;
+        return it->second;
+    }
 
-        anim.speedMultiplier = speedMultiplier;
+    template< typename T >
+    int Animator< T >::findOrAddAnimation( const std::shared_ptr< T >& obj )
+    {
+        const int animationIdx = findAnimation( obj );
+        if ( animationIdx >= 0 )
+            return animationIdx;
+
+        // Remove animation of a deleted object which had the same address.
+        const auto it = m_animationIndices.find( obj.get() );
+        if ( it != m_animationIndices.end() )
+            removeAnimation( it->second );
+
+        m_animationIndices[ obj.get() ] = (int)m_objects.size();
+
+        m_objects.push_back( obj );
+        m_objectAddresses.push_back( obj.get() );
+        m_keyframeTimes.emplace_back();
+        m_keyframeValues.emplace_back();
+        m_playbackTimes.push_back( 0.0f );
+        m_playbackDirections.push_back( 1.0f );
+        m_speedMultipliers.push_back( 1.0f );
+        m_cursors.push_back( 0 );
+        m_enabled.push_back( false );
+        m_smoothstepInterpolation.push_back( false );
+        m_pendingKeyframes.push_back( -1 );
+        m_pendingRatios.push_back( 0.0f );
+
+        return (int)m_objects.size() - 1;
     }
 
     template< typename T >
-    void Animator< T >::removeKeyframesForDeletedObjects()
+    void Animator< T >::removeAnimation( const int animationIdx )
     {
-        for ( auto it = animations.cbegin(); it != animations.cend(); ) 
+        // Move the last animation in place of the removed one.
+        const int lastIdx = (int)m_objects.size() - 1;
+
+        m_animationIndices.erase( m_objectAddresses[ animationIdx ] );
+
+        if ( animationIdx != lastIdx )
         {
-            if ( it->first.expired() )
-                it = animations.erase( it );
-            else
-                ++it;
+            m_animationIndices[ m_objectAddresses[ lastIdx ] ] = animationIdx;
+
+            m_objects[ animationIdx ]                 = std::move( m_objects[ lastIdx ] );
+            m_objectAddresses[ animationIdx ]         = m_objectAddresses[ lastIdx ];
+            m_keyframeTimes[ animationIdx ]           = std::move( m_keyframeTimes[ lastIdx ] );
+            m_keyframeValues[ animationIdx ]          = std::move( m_keyframeValues[ lastIdx ] );
+            m_playbackTimes[ animationIdx ]           = m_playbackTimes[ lastIdx ];
+            m_playbackDirections[ animationIdx ]      = m_playbackDirections[ lastIdx ];
+            m_speedMultipliers[ animationIdx ]        = m_speedMultipliers[ lastIdx ];
+            m_cursors[ animationIdx ]                 = m_cursors[ lastIdx ];
+            m_enabled[ animationIdx ]                 = m_enabled[ lastIdx ];
+            m_smoothstepInterpolation[ animationIdx ] = m_smoothstepInterpolation[ lastIdx ];
+            m_pendingKeyframes[ animationIdx ]        = m_pendingKeyframes[ lastIdx ];
+            m_pendingRatios[ animationIdx ]           = m_pendingRatios[ lastIdx ];
         }
-    }
 
+        m_objects.pop_back();
+        m_objectAddresses.pop_back();
+        m_keyframeTimes.pop_back();
+        m_keyframeValues.pop_back();
+        m_playbackTimes.pop_back();
+        m_playbackDirections.pop_back();
+        m_speedMultipliers.pop_back();
+        m_cursors.pop_back();
+        m_enabled.pop_back();
+        m_smoothstepInterpolation.pop_back();
+        m_pendingKeyframes.pop_back();
+        m_pendingRatios.pop_back();
+    }
 }
-
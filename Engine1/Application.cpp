@@ -29,6 +29,8 @@
 #include "Scene.h"
 
 #include "Timer.h"
+#include "FrameTaskGraph.h"
+#include "JobSystem.h"
 
 #include "BVHTree.h"
 #include "BVHTreeBuffer.h"
@@ -260,6 +262,11 @@ void Application::run()
 
     bool updateProfiling = true;
 
+    FrameTaskGraph   frameTasks;
+    bool             frameTasksPipelined = false;
+    float            frameTimeS          = 0.0f;
+    Renderer::Output output;
+
 	while ( run ) {
 		Timer frameStartTime;
 
@@ -280,18 +287,6 @@ void Application::run()
                 run = false;
 		}
 
-        if ( !physicsStepFinished )
-            physicsStepFinished = PhysicsLibrary::getScene().fetchResults( false );
-
-        physicsTimeAccumulator += (float)(frameTimeMs * 1000.0);
-        if ( physicsTimeAccumulator > settings().physics.fixedStepDuration && physicsStepFinished )
-        {
-            PhysicsLibrary::getScene().simulate( settings().physics.fixedStepDuration );
-            
-            physicsStepFinished = false;
-            physicsTimeAccumulator -= settings().physics.fixedStepDuration;
-        }
-
         bool modifyingScene = false;
 
         // Disable locking when connecting through Team Viewer.
@@ -302,63 +297,137 @@ void Application::run()
         //if ( modifyingScene )
         //    m_renderer.renderShadowMaps( *m_sceneManager.getScene() );
 
-        m_profiler.beginEvent( Profiler::GlobalEventType::RenderSceneToFrame );
+        // Simulation of the next frame runs on worker threads. It doesn't modify the scene - simulated poses stay in the physics scene
+        // and animation values in the animators and skeleton actors until the simulation is applied. In pipelined mode it happens after
+        // the current frame is rendered, so the renderer reads a stable snapshot while the next frame is simulated.
+        frameTimeS = (float)( frameTimeMs / 1000.0 );
 
-        Renderer::Output output;
-        output = m_renderer.renderScene( 
-            *m_sceneManager.getScene(), 
-            *m_sceneManager.getCamera(), 
-            settings().debug.debugWireframeMode, 
-            m_sceneManager.getSelection(), 
-            m_sceneManager.getSelectionVolumeMesh() 
-        );
+        // The graph is only rebuilt when the pipelining mode changes - tasks read the per-frame values (e.g. frameTimeS) by reference.
+        if ( frameTasks.getTaskCount() == 0 || frameTasksPipelined != settings().main.pipelinedFrameUpdate )
+        {
+            frameTasks.clear();
+            frameTasksPipelined = settings().main.pipelinedFrameUpdate;
 
-        m_profiler.endEvent( Profiler::GlobalEventType::RenderSceneToFrame );
+            const int physicsTask = frameTasks.addTask( "physics", [ & ]()
+            {
+                if ( !physicsStepFinished )
+                    physicsStepFinished = PhysicsLibrary::getScene().fetchResults( false );
 
-        const int2 mousePos = m_inputManager.getMousePos();
+                physicsTimeAccumulator += (float)(frameTimeMs * 1000.0);
+                if ( physicsTimeAccumulator > settings().physics.fixedStepDuration && physicsStepFinished )
+                {
+                    PhysicsLibrary::getScene().simulate( settings().physics.fixedStepDuration );
 
-        if ( m_inputManager.isMouseButtonPressed( 0 ) ) {
-            displayPixelColorAsWindowTitle( output, mousePos );
-        }
+                    physicsStepFinished = false;
+                    physicsTimeAccumulator -= settings().physics.fixedStepDuration;
+                }
+            } );
+
+            const int simulationTasks[] = {
+                physicsTask,
+                frameTasks.addTask( "lightAnimation", [ & ]() { m_sceneManager.getLightAnimator().evaluate( frameTimeS * settings().animation.lightsPlaybackSpeed ); } ),
+                frameTasks.addTask( "cameraAnimation", [ & ]() { m_sceneManager.getCameraAnimator().evaluate( frameTimeS * settings().animation.cameraPlaybackSpeed ); } ),
+                frameTasks.addTask( "actorAnimation", [ & ]() { m_sceneManager.getActorAnimator().evaluate( frameTimeS * settings().animation.actorsPlaybackSpeed ); } ),
+                frameTasks.addTask( "modelAnimation", [ & ]() { m_sceneManager.getModelAnimator().evaluate( frameTimeS * settings().animation.actorsPlaybackSpeed ); } ),
+                frameTasks.addTask( "skeletonAnimation", [ & ]()
+                {
+                    const auto& skeletonActors = m_sceneManager.getScene()->getSkeletonActors().actors;
 
-        if ( updateProfiling )
-        {
-            profilingLastRefreshTime.reset();
+                    JobSystem::get().parallelFor( (int)skeletonActors.size(), 1, [ & ]( const int begin, const int end )
+                    {
+                        for ( int actorIdx = begin; actorIdx < end; ++actorIdx )
+                            skeletonActors[ actorIdx ]->evaluateAnimation( frameTimeS );
+                    } );
+                } )
+            };
 
-            { // Accumulate some profiling results.
-                totalFrameTimeCPU = (float)frameTimeMs;
-                totalFrameTimeGPU = m_profiler.getEventDuration( Profiler::GlobalEventType::Frame );
+            const int applySimulationTask = frameTasks.addTask( "applySimulation", [ & ]()
+            {
+                m_sceneManager.getLightAnimator().apply();
+                m_sceneManager.getCameraAnimator().apply();
+                m_sceneManager.getActorAnimator().apply();
+                m_sceneManager.getModelAnimator().apply();
 
-                accumulateStageProfilingData( stageProfilingInfos );
-            }
-        }
+                for ( const auto& skeletonActor : m_sceneManager.getScene()->getSkeletonActors().actors )
+                    skeletonActor->applyAnimation();
 
-        m_profiler.beginEvent( Profiler::GlobalEventType::RenderTextToFrame );
+                for ( const auto& blockActor : m_sceneManager.getScene()->getBlockActors().actors )
+                    blockActor->updatePoseFromPhysics();
+            }, true );
 
-        auto renderTarget = output.uchar4Image;
+            for ( const int simulationTask : simulationTasks )
+                frameTasks.addDependency( applySimulationTask, simulationTask );
 
-        if ( renderTarget )
-        {
-            renderActiveViewText( renderTarget, font2 );
-            renderGPUNameText( renderTarget, font2 );
-            renderFPSText( totalFrameTimeCPU, totalFrameTimeGPU, renderTarget, font );
-            renderProfilingText( totalFrameTimeGPU, stageProfilingInfos, renderTarget, font2 );
-            renderSceneStatisticsText( renderTarget, font2 );
-        }
+            const int renderTask = frameTasks.addTask( "render", [ & ]()
+            {
+                // Poses and bounds of the actors moved by the editor, physics or animation.
+                m_sceneManager.getScene()->updateActorData();
 
-        m_profiler.endEvent( Profiler::GlobalEventType::RenderTextToFrame );
-        m_profiler.beginEvent( Profiler::GlobalEventType::RenderFrameToScreen );
+                m_profiler.beginEvent( Profiler::GlobalEventType::RenderSceneToFrame );
 
-        displayFinalFrame( output );
+                output = m_renderer.renderScene( 
+                    *m_sceneManager.getScene(), 
+                    *m_sceneManager.getCamera(), 
+                    settings().debug.debugWireframeMode, 
+                    m_sceneManager.getSelection(), 
+                    m_sceneManager.getSelectionVolumeMesh() 
+                );
 
-        m_profiler.endEvent( Profiler::GlobalEventType::RenderFrameToScreen );
-        m_profiler.beginEvent( Profiler::GlobalEventType::RenderControlPanelToScreen );
+                m_profiler.endEvent( Profiler::GlobalEventType::RenderSceneToFrame );
 
-        m_controlPanel.draw();
+                const int2 mousePos = m_inputManager.getMousePos();
 
-        m_profiler.endEvent( Profiler::GlobalEventType::RenderControlPanelToScreen );
+                if ( m_inputManager.isMouseButtonPressed( 0 ) ) {
+                    displayPixelColorAsWindowTitle( output, mousePos );
+                }
+
+                if ( updateProfiling )
+                {
+                    profilingLastRefreshTime.reset();
+
+                    { // Accumulate some profiling results.
+                        totalFrameTimeCPU = (float)frameTimeMs;
+                        totalFrameTimeGPU = m_profiler.getEventDuration( Profiler::GlobalEventType::Frame );
+
+                        accumulateStageProfilingData( stageProfilingInfos );
+                    }
+                }
+
+                m_profiler.beginEvent( Profiler::GlobalEventType::RenderTextToFrame );
+
+                auto renderTarget = output.uchar4Image;
+
+                if ( renderTarget )
+                {
+                    renderActiveViewText( renderTarget, font2 );
+                    renderGPUNameText( renderTarget, font2 );
+                    renderFPSText( totalFrameTimeCPU, totalFrameTimeGPU, renderTarget, font );
+                    renderProfilingText( totalFrameTimeGPU, stageProfilingInfos, renderTarget, font2 );
+                    renderSceneStatisticsText( renderTarget, font2 );
+                }
+
+                m_profiler.endEvent( Profiler::GlobalEventType::RenderTextToFrame );
+                m_profiler.beginEvent( Profiler::GlobalEventType::RenderFrameToScreen );
+
+                displayFinalFrame( output );
+
+                m_profiler.endEvent( Profiler::GlobalEventType::RenderFrameToScreen );
+                m_profiler.beginEvent( Profiler::GlobalEventType::RenderControlPanelToScreen );
+
+                m_controlPanel.draw();
+
+                m_profiler.endEvent( Profiler::GlobalEventType::RenderControlPanelToScreen );
+
+                m_frameRenderer.displayFrame();
+            }, true );
+
+            if ( settings().main.pipelinedFrameUpdate )
+                frameTasks.addDependency( applySimulationTask, renderTask );
+            else
+                frameTasks.addDependency( renderTask, applySimulationTask );
+        }
 
-		m_frameRenderer.displayFrame();
+        frameTasks.execute();
 
         m_profiler.endEvent( Profiler::GlobalEventType::Frame );
         m_profiler.endFrameProfiling();
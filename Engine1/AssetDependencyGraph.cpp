@@ -0,0 +1,178 @@
+#include "AssetDependencyGraph.h"
+
+#include <algorithm>
+
+#include "AssetManager.h"
+#include "BinaryFile.h"
+#include "BlockModel.h"
+#include "SkeletonModel.h"
+#include "BlockModelFileInfo.h"
+#include "SkeletonModelFileInfo.h"
+#include "JobSystem.h"
+#include "StringUtil.h"
+
+using namespace Engine1;
+
+AssetDependencyGraph::AssetDependencyGraph()
+{}
+
+AssetDependencyGraph::~AssetDependencyGraph()
+{}
+
+void AssetDependencyGraph::build( const std::vector< std::shared_ptr< FileInfo > >& rootFileInfos, ID3D11Device3& device )
+{
+    m_nodes.clear();
+    m_nodeIndices.clear();
+    m_fileInfosLeavesFirst.clear();
+
+    std::vector< int > rootNodeIndices;
+    for ( const std::shared_ptr< FileInfo >& fileInfo : rootFileInfos ) {
+        if ( fileInfo && !fileInfo->getPath().empty() )
+            rootNodeIndices.push_back( addNode( fileInfo ) );
+    }
+
+    // Read root assets in parallel to find their sub-assets.
+    std::vector< std::vector< std::shared_ptr< FileInfo > > > subAssetFileInfos( rootNodeIndices.size() );
+    JobSystem::get().parallelFor( (int)rootNodeIndices.size(), 1, [ this, &rootNodeIndices, &subAssetFileInfos, &device ]( int begin, int end ) {
+        for ( int i = begin; i < end; ++i ) {
+            try {
+                subAssetFileInfos[ i ] = readSubAssetFileInfos( *m_nodes[ rootNodeIndices[ i ] ].fileInfo, device );
+            } catch ( std::exception& ex ) {
+                OutputDebugStringW( StringUtil::widen( 
+                    "AssetDependencyGraph::build - failed to read sub-assets of \"" 
+                    + m_nodes[ rootNodeIndices[ i ] ].fileInfo->getPath() + "\"\nException: " 
+                    + ex.what() + ".\n"
+                ).c_str() );
+            }
+        }
+    } );
+
+    // Add sub-assets to the graph - each unique asset only once.
+    // Note: Sub-assets (meshes, textures) can't have sub-assets of their own, so there is no need to recurse.
+    for ( int i = 0; i < (int)rootNodeIndices.size(); ++i ) {
+        for ( const std::shared_ptr< FileInfo >& subAssetFileInfo : subAssetFileInfos[ i ] ) {
+            const int subAssetNodeIdx = addNode( subAssetFileInfo );
+
+            std::vector< int >& dependencies = m_nodes[ rootNodeIndices[ i ] ].dependencies;
+            if ( subAssetNodeIdx != rootNodeIndices[ i ] && std::find( dependencies.begin(), dependencies.end(), subAssetNodeIdx ) == dependencies.end() )
+                dependencies.push_back( subAssetNodeIdx );
+        }
+    }
+
+    // Calculate depth of each node. Nodes are added after their parents, so iterate in reverse order.
+    for ( int nodeIdx = (int)m_nodes.size() - 1; nodeIdx >= 0; --nodeIdx ) {
+        Node& node = m_nodes[ nodeIdx ];
+
+        node.depth = 0;
+        for ( const int dependencyIdx : node.dependencies )
+            node.depth = std::max( node.depth, m_nodes[ dependencyIdx ].depth + 1 );
+    }
+
+    std::vector< int > nodeOrder( m_nodes.size() );
+    for ( int nodeIdx = 0; nodeIdx < (int)m_nodes.size(); ++nodeIdx )
+        nodeOrder[ nodeIdx ] = nodeIdx;
+
+    std::stable_sort( nodeOrder.begin(), nodeOrder.end(), [ this ]( const int nodeIdx1, const int nodeIdx2 ) {
+        return m_nodes[ nodeIdx1 ].depth < m_nodes[ nodeIdx2 ].depth;
+    } );
+
+    for ( const int nodeIdx : nodeOrder )
+        m_fileInfosLeavesFirst.push_back( m_nodes[ nodeIdx ].fileInfo );
+}
+
+void AssetDependencyGraph::loadAsync( AssetManager& assetManager )
+{
+    m_loadingStartTime.reset();
+
+    for ( const std::shared_ptr< FileInfo >& fileInfo : m_fileInfosLeavesFirst )
+        assetManager.loadAsync( *fileInfo );
+}
+
+AssetDependencyGraph::Progress AssetDependencyGraph::getProgress( const AssetManager& assetManager ) const
+{
+    Progress progress;
+    progress.totalCount  = (int)m_nodes.size();
+    progress.loadedCount   = 0;
+    progress.failedCount   = 0;
+    progress.buildingGraph = false;
+
+    for ( const Node& node : m_nodes ) {
+        if ( assetManager.isLoaded( node.id ) )
+            ++progress.loadedCount;
+        else if ( !assetManager.isLoadedOrLoading( node.id ) )
+            ++progress.failedCount;
+    }
+
+    const Timer currTime;
+    progress.elapsedTime = (float)( Timer::getElapsedTime( currTime, m_loadingStartTime ) / 1000.0 );
+
+    const int finishedCount = progress.loadedCount + progress.failedCount;
+    if ( finishedCount > 0 )
+        progress.estimatedRemainingTime = progress.elapsedTime * (float)( progress.totalCount - finishedCount ) / (float)finishedCount;
+    else
+        progress.estimatedRemainingTime = -1.0f;
+
+    return progress;
+}
+
+const std::vector< std::shared_ptr< FileInfo > >& AssetDependencyGraph::getFileInfosLeavesFirst() const
+{
+    return m_fileInfosLeavesFirst;
+}
+
+int AssetDependencyGraph::getAssetCount() const
+{
+    return (int)m_nodes.size();
+}
+
+int AssetDependencyGraph::getLeafAssetCount() const
+{
+    return (int)std::count_if( m_nodes.begin(), m_nodes.end(), []( const Node& node ) { return node.dependencies.empty(); } );
+}
+
+int AssetDependencyGraph::addNode( const std::shared_ptr< FileInfo >& fileInfo )
+{
+    const AssetId id( *fileInfo );
+
+    auto it = m_nodeIndices.find( id.getValue() );
+    if ( it != m_nodeIndices.end() )
+        return it->second;
+
+    Node node;
+    node.fileInfo = fileInfo;
+    node.id       = id;
+    node.depth    = 0;
+
+    m_nodes.push_back( node );
+    m_nodeIndices.insert( std::make_pair( id.getValue(), (int)m_nodes.size() - 1 ) );
+
+    return (int)m_nodes.size() - 1;
+}
+
+std::vector< std::shared_ptr< FileInfo > > AssetDependencyGraph::readSubAssetFileInfos( const FileInfo& fileInfo, ID3D11Device3& device )
+{
+    std::vector< std::shared_ptr< Asset > > subAssets;
+
+    // Note: Model files are small (they only reference meshes and textures), so reading them twice (here and in AssetManager) is cheap.
+    // Models are parsed without loading sub-assets - they contain only the file infos of their sub-assets.
+    if ( fileInfo.getAssetType() == Asset::Type::BlockModel ) 
+    {
+        const BlockModelFileInfo& modelFileInfo = static_cast< const BlockModelFileInfo& >( fileInfo );
+        
+        subAssets = BlockModel::createFromFile( modelFileInfo, false, device )->getSubAssets();
+    } 
+    else if ( fileInfo.getAssetType() == Asset::Type::SkeletonModel ) 
+    {
+        const SkeletonModelFileInfo& modelFileInfo = static_cast< const SkeletonModelFileInfo& >( fileInfo );
+
+        subAssets = SkeletonModel::createFromFile( modelFileInfo, false, device )->getSubAssets();
+    }
+
+    std::vector< std::shared_ptr< FileInfo > > subAssetFileInfos;
+    for ( const std::shared_ptr< Asset >& subAsset : subAssets ) {
+        if ( !subAsset->getFileInfo().getPath().empty() )
+            subAssetFileInfos.push_back( subAsset->getFileInfo().clone() );
+    }
+
+    return subAssetFileInfos;
+}
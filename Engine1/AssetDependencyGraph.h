@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+#include "AssetId.h"
+#include "Timer.h"
+
+struct ID3D11Device3;
+
+namespace Engine1
+{
+    class FileInfo;
+    class AssetManager;
+
+    // Graph of all assets needed by a set of root assets (usually the unique models of a scene) together with their sub-assets (meshes, textures).
+    // Knowing the whole graph up front allows to queue all leaf assets (which are shared between many models) first and load them in parallel,
+    // instead of discovering them one model at a time.
+    class AssetDependencyGraph
+    {
+        public:
+
+        struct Progress
+        {
+            int   totalCount;
+            int   loadedCount;
+            int   failedCount;
+            float elapsedTime;            // In seconds.
+            float estimatedRemainingTime; // In seconds. Negative if unknown yet (nothing loaded).
+            // Root assets are still being read to find their sub-assets - totalCount is the number of root assets only.
+            bool  buildingGraph;
+
+            float getRatio() const { return totalCount > 0 ? (float)( loadedCount + failedCount ) / (float)totalCount : 1.0f; }
+            bool  isFinished() const { return loadedCount + failedCount >= totalCount; }
+        };
+
+        AssetDependencyGraph();
+        ~AssetDependencyGraph();
+
+        // Reads root assets from disk (in parallel) to find their sub-assets. Assets used by many roots are stored in the graph only once.
+        // Roots which fail to be read are kept in the graph without dependencies - AssetManager reports their errors when loading.
+        void build( const std::vector< std::shared_ptr< FileInfo > >& rootFileInfos, ID3D11Device3& device );
+
+        // Queues loading of all assets in the graph - leaves first, then assets which depend only on the already queued ones.
+        void loadAsync( AssetManager& assetManager );
+
+        // Thread-safe - can be called while the assets are being loaded (AssetManager lookups are lock-free).
+        Progress getProgress( const AssetManager& assetManager ) const;
+
+        // All assets in the order in which they should be loaded - leaves first.
+        const std::vector< std::shared_ptr< FileInfo > >& getFileInfosLeavesFirst() const;
+
+        int getAssetCount() const;
+        int getLeafAssetCount() const;
+
+        private:
+
+        struct Node
+        {
+            std::shared_ptr< FileInfo > fileInfo;
+            AssetId                     id;
+            std::vector< int >          dependencies; // Indices of sub-asset nodes.
+            int                         depth;        // 0 for leaves, otherwise 1 + max depth of the dependencies.
+        };
+
+        int addNode( const std::shared_ptr< FileInfo >& fileInfo );
+
+        static std::vector< std::shared_ptr< FileInfo > > readSubAssetFileInfos( const FileInfo& fileInfo, ID3D11Device3& device );
+
+        std::vector< Node >              m_nodes;
+        std::unordered_map< uint64_t, int > m_nodeIndices; // Key: asset id, value: index in m_nodes.
+
+        std::vector< std::shared_ptr< FileInfo > > m_fileInfosLeavesFirst;
+
+        Timer m_loadingStartTime;
+    };
+}
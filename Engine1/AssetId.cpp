@@ -0,0 +1,49 @@
+#include "AssetId.h"
+
+#include "FileInfo.h"
+
+using namespace Engine1;
+
+const AssetId AssetId::INVALID;
+
+AssetId::AssetId() :
+    m_value( 0 )
+{}
+
+AssetId::AssetId( const Asset::Type type, const std::string& path, const int indexInFile ) :
+    m_value( calculateHash( type, path, indexInFile ) )
+{}
+
+AssetId::AssetId( const FileInfo& fileInfo ) :
+    m_value( calculateHash( fileInfo.getAssetType(), fileInfo.getPath(), fileInfo.getIndexInFile() ) )
+{}
+
+uint64_t AssetId::calculateHash( const Asset::Type type, const std::string& path, const int indexInFile )
+{
+    // FNV-1a over the type, lowercase path and index in file.
+    const uint64_t fnvOffsetBasis = 14695981039346656037ull;
+    const uint64_t fnvPrime       = 1099511628211ull;
+
+    uint64_t hash = fnvOffsetBasis;
+
+    hash = ( hash ^ (uint64_t)(unsigned char)type ) * fnvPrime;
+
+    for ( const char c : path ) {
+        // Note: Only ASCII letters are folded to lowercase - it's enough for asset paths and avoids allocating a lowercase copy.
+        const unsigned char lowercaseChar = ( c >= 'A' && c <= 'Z' ) ? (unsigned char)( c - 'A' + 'a' ) : (unsigned char)c;
+        hash = ( hash ^ (uint64_t)lowercaseChar ) * fnvPrime;
+    }
+
+    const uint32_t index = (uint32_t)indexInFile;
+    for ( int byteIdx = 0; byteIdx < 4; ++byteIdx )
+        hash = ( hash ^ (uint64_t)( ( index >> ( byteIdx * 8 ) ) & 0xFF ) ) * fnvPrime;
+
+    // Final mix (from SplitMix64) - spreads the bits, so the low bits can be used directly as a hash table index.
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ull;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebull;
+    hash ^= hash >> 31;
+
+    return hash != 0 ? hash : 1;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+#include "Asset.h"
+
+namespace Engine1
+{
+    class FileInfo;
+
+    // 64-bit handle identifying an asset by its type, path (case-insensitive) and index in file.
+    // The hash is computed once, without allocating, so callers can keep the handle and reuse it for lookups.
+    // Note: Two different assets colliding on a 64-bit hash is considered practically impossible and is not detected.
+    class AssetId
+    {
+        public:
+
+        static const AssetId INVALID;
+
+        AssetId();
+        AssetId( const Asset::Type type, const std::string& path, const int indexInFile = 0 );
+        explicit AssetId( const FileInfo& fileInfo );
+
+        uint64_t getValue() const { return m_value; }
+        bool     isValid() const  { return m_value != 0; }
+
+        bool operator == ( const AssetId& other ) const { return m_value == other.m_value; }
+        bool operator != ( const AssetId& other ) const { return m_value != other.m_value; }
+
+        private:
+
+        static uint64_t calculateHash( const Asset::Type type, const std::string& path, const int indexInFile );
+
+        // Value 0 is reserved for an invalid id (and empty slots in AssetRegistry).
+        uint64_t m_value;
+    };
+}
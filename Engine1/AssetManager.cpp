@@ -65,15 +65,11 @@ void AssetManager::initialize( int parsingBasicAssetsThreadCount, int parsingCom
 
 void AssetManager::load( const FileInfo& fileInfo )
 {
-    std::string id = getId( fileInfo.getAssetType(), fileInfo.getPath(), fileInfo.getIndexInFile() );
-
-	{ // Check if asset was loaded already or is in the course of loading.
-		std::lock_guard<std::mutex> assetsLock( m_assetsMutex );
-		if ( m_assets.count( id ) != 0 ) 
-			throw std::exception( "AssetManager::load - Asset is already loaded or in the course of loading." );
-		
-		m_assets.insert( id );
-	}
+    const AssetId id( fileInfo );
+
+	// Check if asset was loaded already or is in the course of loading.
+	if ( !m_assets.markLoading( id ) ) 
+		throw std::exception( "AssetManager::load - Asset is already loaded or in the course of loading." );
 
 	try 
     {
@@ -96,10 +92,7 @@ void AssetManager::load( const FileInfo& fileInfo )
             }
         }
 
-		{
-			std::lock_guard<std::mutex> loadedAssetsLock( m_loadedAssetsMutex );
-			m_loadedAssets.insert( std::make_pair( id, asset ) );
-		}
+		onAssetLoaded( id, asset );
 
 		OutputDebugStringW( StringUtil::widen( 
             "AssetManager::load - read and parsed \"" 
@@ -111,8 +104,7 @@ void AssetManager::load( const FileInfo& fileInfo )
     catch ( std::exception& ex ) 
     {
 		// If asset failed to load - remove it from assets.
-		std::lock_guard<std::mutex> assetsLock( m_assetsMutex );
-		m_assets.erase( id );
+		onAssetFailed( id );
 
 		OutputDebugStringW( StringUtil::widen( 
             "AssetManager::load - failed to read or parse \"" 
@@ -128,15 +120,11 @@ void AssetManager::load( const FileInfo& fileInfo )
 
 void AssetManager::loadAsync( const FileInfo& fileInfo, const bool highestPriority )
 {
-    std::string id = getId( fileInfo.getAssetType(), fileInfo.getPath(), fileInfo.getIndexInFile() );
-
-	{ // Check if this asset was loaded already or is in the course of loading.
-		std::lock_guard<std::mutex> assetsLock( m_assetsMutex );
-		if ( m_assets.count( id ) != 0 ) 
-			return; // Asset is already loading or loaded.
+    const AssetId id( fileInfo );
 
-		m_assets.insert( id );
-	}
+	// Check if this asset was loaded already or is in the course of loading.
+	if ( !m_assets.markLoading( id ) ) 
+		return; // Asset is already loading or loaded.
 
 	{ // Add the asset to the list of assets to load from disk - lock mutex.
 		std::unique_lock<std::mutex> assetsToLoadFromDiskLock( m_assetsToReadFromDiskMutex );
@@ -161,71 +149,83 @@ void AssetManager::loadAsync( const FileInfo& fileInfo, const bool highestPriori
 	m_assetsToReadFromDiskNotEmpty.notify_one();
 }
 
-bool AssetManager::isLoaded( Asset::Type type, std::string path, const int indexInFile )
+bool AssetManager::isLoaded( Asset::Type type, const std::string& path, const int indexInFile ) const
 {
-    std::string id = getId( type, path, indexInFile );
-
-	//TODO: should I lock loadedAssets before searching through it?
-    return (m_loadedAssets.find( id ) != m_loadedAssets.end( ));
+    return isLoaded( AssetId( type, path, indexInFile ) );
 }
 
-bool AssetManager::isLoadedOrLoading( Asset::Type type, std::string path, const int indexInFile )
+bool AssetManager::isLoadedOrLoading( Asset::Type type, const std::string& path, const int indexInFile ) const
 {
-    std::string id = getId( type, path, indexInFile );
-
-	std::lock_guard<std::mutex> assetsLock( m_assetsMutex );
-    return (m_assets.count( id ) != 0);
+    return isLoadedOrLoading( AssetId( type, path, indexInFile ) );
 }
 
-std::shared_ptr<Asset> AssetManager::get( Asset::Type type, std::string path, const int indexInFile )
+std::shared_ptr<Asset> AssetManager::get( Asset::Type type, const std::string& path, const int indexInFile ) const
 {
-    std::string id = getId( type, path, indexInFile );
-
-	std::lock_guard<std::mutex> loadedAssetsLock( m_loadedAssetsMutex );
+    return get( AssetId( type, path, indexInFile ) );
+}
 
-    std::unordered_map< std::string, std::shared_ptr<Asset> >::iterator it = m_loadedAssets.find( id );
+bool AssetManager::isLoaded( const AssetId id ) const
+{
+    return m_assets.isLoaded( id );
+}
 
-	if ( it == m_loadedAssets.end() )
-		return nullptr;
+bool AssetManager::isLoadedOrLoading( const AssetId id ) const
+{
+    return m_assets.isLoadedOrLoading( id );
+}
 
-	return it->second;
+std::shared_ptr<Asset> AssetManager::get( const AssetId id ) const
+{
+    return m_assets.get( id );
 }
 
 std::shared_ptr<Asset> AssetManager::getOrLoad( const FileInfo& fileInfo )
 {
     const float timeout = 660.0f;
 
-    if ( !isLoadedOrLoading( fileInfo.getAssetType(), fileInfo.getPath(), fileInfo.getIndexInFile() ) )
+    const AssetId id( fileInfo );
+
+    // Fast path - no locking if the asset is already loaded.
+    std::shared_ptr<Asset> asset = m_assets.get( id );
+    if ( asset )
+        return asset;
+
+    if ( !m_assets.isLoadedOrLoading( id ) )
         load( fileInfo );
 
-    return getWhenLoaded( fileInfo.getAssetType(), fileInfo.getPath( ), fileInfo.getIndexInFile( ), timeout );
+    return getWhenLoaded( id, timeout );
 }
 
-std::shared_ptr<Asset> AssetManager::getWhenLoaded( Asset::Type type, std::string path, const int indexInFile, const float timeout )
+std::shared_ptr<Asset> AssetManager::getWhenLoaded( Asset::Type type, const std::string& path, const int indexInFile, const float timeout )
 {
-    std::string id = getId( type, path, indexInFile );
+    return getWhenLoaded( AssetId( type, path, indexInFile ), timeout );
+}
 
-	std::unordered_map< std::string, std::shared_ptr<Asset> >::iterator it;
+std::shared_ptr<Asset> AssetManager::getWhenLoaded( const AssetId id, const float timeout )
+{
+    { // Fast path - no locking if the asset is already loaded.
+        std::shared_ptr<Asset> asset = m_assets.get( id );
+        if ( asset )
+            return asset;
+    }
 
 	const std::chrono::steady_clock::time_point timoutTime = std::chrono::steady_clock::now( ) + std::chrono::microseconds( (long long)( timeout / 0.000001f ) );
 
-	std::unique_lock<std::mutex> loadedAssetsLock( m_loadedAssetsMutex );
+	std::unique_lock<std::mutex> assetLoadedOrErrorLock( m_assetLoadedOrErrorMutex );
 
 	for (;;) {
 		// Check if the asset is loaded.
-        it = m_loadedAssets.find( id );
-		if ( it != m_loadedAssets.end() )
-			return it->second;
-
-        { // Check if that asset failed to load (because it's not loading).
-            std::lock_guard<std::mutex> assetsLock( m_assetsMutex );
-            if ( m_assets.count( id ) == 0 )
-                return nullptr; //#TODO: Should it throw exception?
-        }
+        std::shared_ptr<Asset> asset = m_assets.get( id );
+		if ( asset )
+			return asset;
+
+        // Check if that asset failed to load (because it's not loading).
+        if ( !m_assets.isLoadedOrLoading( id ) )
+            return nullptr; //#TODO: Should it throw exception?
 
 		// Wait until some asset finish loading or timeout.
         // #TODO: Could use wait_for instead. No need to check current time.
-		std::_Cv_status status = m_assetLoadedOrError.wait_until( loadedAssetsLock, timoutTime );
+		std::_Cv_status status = m_assetLoadedOrError.wait_until( assetLoadedOrErrorLock, timoutTime );
 
 		// Exit method on timeout.
 		if ( status == std::cv_status::timeout )
@@ -235,11 +235,6 @@ std::shared_ptr<Asset> AssetManager::getWhenLoaded( Asset::Type type, std::strin
 
 void AssetManager::unloadAll()
 {
-    {
-        std::lock_guard<std::mutex> lock( m_loadedAssetsMutex );
-	    m_loadedAssets.clear();
-    }
-
     {
         std::lock_guard<std::mutex> lock( m_complexAssetsToParseMutex );
 	    m_complexAssetsToParse.clear();
@@ -251,7 +246,8 @@ void AssetManager::unloadAll()
     }
 
     {
-        std::lock_guard<std::mutex> lock( m_assetsMutex );
+        // Note: Lookups can run while clearing. The lock serializes clearing with publishing loaded and failed assets.
+        std::lock_guard<std::mutex> lock( m_assetLoadedOrErrorMutex );
 	    m_assets.clear();
     }
 }
@@ -312,11 +308,8 @@ void AssetManager::readAssetsFromDisk() {
 		} 
         catch ( std::exception& ex ) 
         {
-            std::string id = getId( fileInfo->getAssetType( ), fileInfo->getPath( ), fileInfo->getIndexInFile( ) );
-
 			// If asset failed to load - remove it from assets.
-			std::lock_guard<std::mutex> assetsLock( m_assetsMutex );
-			m_assets.erase( id );
+			onAssetFailed( AssetId( *fileInfo ) );
 
 			OutputDebugStringW( StringUtil::widen( 
                 "AssetManager::readAssetsFromDisk - failed to read \"" 
@@ -325,9 +318,6 @@ void AssetManager::readAssetsFromDisk() {
                 + ex.what() + ".\n"
             ).c_str( ) );
 
-            // Notify 'getWhenLoaded' method that an asset failed to load.
-            m_assetLoadedOrError.notify_all();
-
 			//TODO: handle this error - do some callback for ex.
             continue;
 		}
@@ -398,8 +388,7 @@ void AssetManager::parseBasicAssets()
         catch ( std::exception& ex ) 
         {
 			// Asset failed to load - remove it from assets.
-			std::lock_guard<std::mutex> assetsLock( m_assetsMutex );
-			m_assets.erase( assetToParse.fileInfo->getPath() );
+			onAssetFailed( AssetId( *assetToParse.fileInfo ) );
 
 			OutputDebugStringW( StringUtil::widen( 
                 "AssetManager::parseBasicAssets - failed to parse \"" 
@@ -408,23 +397,12 @@ void AssetManager::parseBasicAssets()
                 + ex.what() + ".\n"
             ).c_str( ) );
 
-            // Notify 'getWhenLoaded' method that an asset failed to load.
-            m_assetLoadedOrError.notify_all();
-
 			//TODO: handle this error - do some callback for ex.
             continue;
 		}
 
-		{ // Add asset to a list of assets - hold lock.
-			std::lock_guard<std::mutex> loadedAssetsLock( m_loadedAssetsMutex );
-			// Add asset to a list of assets.
-
-            std::string id = getId( assetToParse.fileInfo->getAssetType( ), assetToParse.fileInfo->getPath( ), assetToParse.fileInfo->getIndexInFile() );
-			m_loadedAssets.insert( std::make_pair( id, asset ) );
-		}
-
-		// Notify 'getWhenLoaded' method that an asset has just been loaded.
-		m_assetLoadedOrError.notify_all();
+		// Add asset to a list of assets and notify 'getWhenLoaded' method that an asset has just been loaded.
+		onAssetLoaded( AssetId( *assetToParse.fileInfo ), asset );
 	}
 }
 
@@ -489,8 +467,7 @@ void AssetManager::parseComplexAssets()
         catch ( std::exception& ex ) 
         {
             // Asset failed to load - remove it from assets.
-            std::lock_guard<std::mutex> assetsLock( m_assetsMutex );
-            m_assets.erase( assetToParse.fileInfo->getPath() );
+            onAssetFailed( AssetId( *assetToParse.fileInfo ) );
 
             OutputDebugStringW( StringUtil::widen( 
                 "AssetManager::parseComplexAssets - failed to parse \"" 
@@ -499,23 +476,12 @@ void AssetManager::parseComplexAssets()
                 + ex.what() + ".\n"
             ).c_str() );
 
-            // Notify 'getWhenLoaded' method that an asset failed to load.
-            m_assetLoadedOrError.notify_all();
-
             //TODO: handle this error - do some callback for ex.
             continue;
         }
 
-        { // Add asset to a list of assets - hold lock.
-            std::lock_guard<std::mutex> loadedAssetsLock( m_loadedAssetsMutex );
-            // Add asset to a list of assets.
-
-            std::string id = getId( assetToParse.fileInfo->getAssetType(), assetToParse.fileInfo->getPath(), assetToParse.fileInfo->getIndexInFile() );
-            m_loadedAssets.insert( std::make_pair( id, asset ) );
-        }
-
-        // Notify 'getWhenLoaded' method that an asset has just been loaded.
-        m_assetLoadedOrError.notify_all();
+        // Add asset to a list of assets and notify 'getWhenLoaded' method that an asset has just been loaded.
+        onAssetLoaded( AssetId( *assetToParse.fileInfo ), asset );
     }
 }
 
@@ -660,7 +626,24 @@ std::shared_ptr<Asset> AssetManager::createFromMemory( const FileInfo& fileInfo,
 	}
 }
 
-std::string AssetManager::getId( Asset::Type type, const std::string path, const int indexInFile )
+void AssetManager::onAssetLoaded( const AssetId id, std::shared_ptr<Asset> asset )
+{
+    { // Note: Publish under the lock, so 'getWhenLoaded' can't miss the notification between checking the asset and starting to wait.
+        std::lock_guard<std::mutex> assetLoadedOrErrorLock( m_assetLoadedOrErrorMutex );
+        m_assets.markLoaded( id, asset );
+    }
+
+    // Notify 'getWhenLoaded' method that an asset has just been loaded.
+    m_assetLoadedOrError.notify_all();
+}
+
+void AssetManager::onAssetFailed( const AssetId id )
 {
-    return "(" + Asset::toString(type) + ") " + StringUtil::toLowercase( path ) + " [" + std::to_string( indexInFile ) + "]";
+    {
+        std::lock_guard<std::mutex> assetLoadedOrErrorLock( m_assetLoadedOrErrorMutex );
+        m_assets.markFailed( id );
+    }
+
+    // Notify 'getWhenLoaded' method that an asset failed to load.
+    m_assetLoadedOrError.notify_all();
 }
\ No newline at end of file
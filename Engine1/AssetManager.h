@@ -2,14 +2,15 @@
 
 #include <string>
 #include <memory>
-#include <unordered_map>
-#include <unordered_set>
+#include <list>
 #include <mutex>
 #include <thread>
 #include <condition_variable>
 #include <wrl.h>
 
 #include "Asset.h"
+#include "AssetId.h"
+#include "AssetRegistry.h"
 #include "FileInfo.h"
 
 struct ID3D11Device3;
@@ -30,11 +31,17 @@ namespace Engine1
 
         void                   load( const FileInfo& fileInfo );
         void                   loadAsync( const FileInfo& fileInfo, const bool highestPriority = false );
-        bool                   isLoaded( Asset::Type type, std::string path, const int indexInFile = 0 );
-        bool                   isLoadedOrLoading( Asset::Type type, std::string path, const int indexInFile = 0 );
-        std::shared_ptr<Asset> get( Asset::Type type, std::string path, const int indexInFile = 0 );
+        bool                   isLoaded( Asset::Type type, const std::string& path, const int indexInFile = 0 ) const;
+        bool                   isLoadedOrLoading( Asset::Type type, const std::string& path, const int indexInFile = 0 ) const;
+        std::shared_ptr<Asset> get( Asset::Type type, const std::string& path, const int indexInFile = 0 ) const;
         std::shared_ptr<Asset> getOrLoad( const FileInfo& fileInfo );
-        std::shared_ptr<Asset> getWhenLoaded( Asset::Type type, std::string path, const int indexInFile = 0, const float timeout = 10.0f );
+        std::shared_ptr<Asset> getWhenLoaded( Asset::Type type, const std::string& path, const int indexInFile = 0, const float timeout = 10.0f );
+
+        // Versions taking an already computed asset id - lock-free and without allocations.
+        bool                   isLoaded( const AssetId id ) const;
+        bool                   isLoadedOrLoading( const AssetId id ) const;
+        std::shared_ptr<Asset> get( const AssetId id ) const;
+        std::shared_ptr<Asset> getWhenLoaded( const AssetId id, const float timeout = 10.0f );
 
         void unloadAll();
 
@@ -51,15 +58,12 @@ namespace Engine1
         std::shared_ptr<Asset> createFromFile( const FileInfo& fileInfo );
         std::shared_ptr<Asset> createFromMemory( const FileInfo& fileInfo, const std::vector<char>& fileData );
 
-        std::string getId( Asset::Type type, const std::string path, const int indexInFile );
-
         std::thread              m_readingFromDiskThread;
         std::vector<std::thread> m_parsingBasicAssetsThreads;
         std::vector<std::thread> m_parsingComplexAssetsThreads;
 
-        // List of all assets which are in the course of loading or were loaded already.
-        std::mutex                      m_assetsMutex;
-        std::unordered_set<std::string> m_assets;
+        // All assets which are in the course of loading or were loaded already.
+        AssetRegistry m_assets;
 
         std::mutex                                     m_assetsToReadFromDiskMutex;
         std::condition_variable                        m_assetsToReadFromDiskNotEmpty;
@@ -94,11 +98,13 @@ namespace Engine1
         std::list< AssetToParse > m_basicAssetsToParse;
         std::list< AssetToParse > m_complexAssetsToParse;
 
-        std::mutex                                                m_loadedAssetsMutex;
-        std::unordered_map< std::string, std::shared_ptr<Asset> > m_loadedAssets;
-
         // Used to notify 'getWhenLoaded' method that a new asset has just finished loading.
+        // Note: The mutex only guards waiting on the condition variable - lookups in m_assets don't need it.
+        std::mutex              m_assetLoadedOrErrorMutex;
         std::condition_variable m_assetLoadedOrError;
+
+        void onAssetLoaded( const AssetId id, std::shared_ptr<Asset> asset );
+        void onAssetFailed( const AssetId id );
     };
 }
 
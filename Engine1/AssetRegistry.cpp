@@ -0,0 +1,151 @@
+#include "AssetRegistry.h"
+
+#include <string>
+
+#include "Asset.h"
+#include "MathUtil.h"
+
+using namespace Engine1;
+
+AssetRegistry::AssetRegistry( const unsigned int capacity ) :
+    m_capacity( capacity ),
+    m_indexMask( (uint64_t)capacity - 1 ),
+    m_slots( new Slot[ capacity ] ),
+    m_clearCount( 0 )
+{
+    if ( capacity == 0 || !MathUtil::isPowerOfTwo( capacity ) )
+        throw std::exception( "AssetRegistry::AssetRegistry - capacity has to be a power of two." );
+
+    for ( unsigned int slotIdx = 0; slotIdx < m_capacity; ++slotIdx ) {
+        m_slots[ slotIdx ].id.store( 0, std::memory_order_relaxed );
+        m_slots[ slotIdx ].state.store( (int)State::Unloaded, std::memory_order_relaxed );
+    }
+
+    std::atomic_thread_fence( std::memory_order_release );
+}
+
+AssetRegistry::~AssetRegistry()
+{}
+
+bool AssetRegistry::markLoading( const AssetId id )
+{
+    Slot& slot = findOrInsertSlot( id );
+
+    int expectedState = (int)State::Unloaded;
+    return slot.state.compare_exchange_strong( expectedState, (int)State::Loading, std::memory_order_acq_rel );
+}
+
+void AssetRegistry::markLoaded( const AssetId id, std::shared_ptr< Asset > asset )
+{
+    Slot& slot = findOrInsertSlot( id );
+
+    // If the asset was already loaded, keep the previous one, as others may be using it.
+    std::shared_ptr< Asset > expectedAsset;
+    std::atomic_compare_exchange_strong( &slot.asset, &expectedAsset, asset );
+
+    slot.state.store( (int)State::Loaded, std::memory_order_release );
+}
+
+void AssetRegistry::markFailed( const AssetId id )
+{
+    Slot& slot = findOrInsertSlot( id );
+
+    int expectedState = (int)State::Loading;
+    slot.state.compare_exchange_strong( expectedState, (int)State::Unloaded, std::memory_order_acq_rel );
+}
+
+bool AssetRegistry::isLoaded( const AssetId id ) const
+{
+    const Slot* slot = findSlot( id );
+
+    return slot && slot->state.load( std::memory_order_acquire ) == (int)State::Loaded;
+}
+
+bool AssetRegistry::isLoadedOrLoading( const AssetId id ) const
+{
+    const Slot* slot = findSlot( id );
+
+    return slot && slot->state.load( std::memory_order_acquire ) != (int)State::Unloaded;
+}
+
+std::shared_ptr< Asset > AssetRegistry::get( const AssetId id ) const
+{
+    const unsigned int clearCount = m_clearCount.load();
+    if ( clearCount & 1 )
+        return nullptr; // Being cleared.
+
+    const Slot* slot = findSlot( id );
+    if ( !slot || slot->state.load( std::memory_order_acquire ) != (int)State::Loaded )
+        return nullptr;
+
+    std::shared_ptr< Asset > asset = std::atomic_load( &slot->asset );
+
+    // Slot was cleared after it was found - the asset may belong to another id now.
+    if ( m_clearCount.load() != clearCount )
+        return nullptr;
+
+    return asset;
+}
+
+void AssetRegistry::clear()
+{
+    ++m_clearCount;
+
+    for ( unsigned int slotIdx = 0; slotIdx < m_capacity; ++slotIdx ) {
+        Slot& slot = m_slots[ slotIdx ];
+
+        // Readers which already copied the pointer keep the asset alive.
+        std::atomic_store( &slot.asset, std::shared_ptr< Asset >() );
+
+        slot.state.store( (int)State::Unloaded, std::memory_order_relaxed );
+        slot.id.store( 0, std::memory_order_release );
+    }
+
+    ++m_clearCount;
+}
+
+const AssetRegistry::Slot* AssetRegistry::findSlot( const AssetId id ) const
+{
+    const uint64_t idValue = id.getValue();
+
+    uint64_t slotIdx = idValue & m_indexMask;
+    for ( unsigned int probeCount = 0; probeCount < m_capacity; ++probeCount ) {
+        const uint64_t slotId = m_slots[ slotIdx ].id.load( std::memory_order_acquire );
+
+        if ( slotId == idValue )
+            return &m_slots[ slotIdx ];
+        else if ( slotId == 0 ) // Empty slot ends the probe sequence - slots are never removed.
+            return nullptr;
+
+        slotIdx = ( slotIdx + 1 ) & m_indexMask;
+    }
+
+    return nullptr;
+}
+
+AssetRegistry::Slot& AssetRegistry::findOrInsertSlot( const AssetId id )
+{
+    if ( !id.isValid() )
+        throw std::exception( "AssetRegistry::findOrInsertSlot - asset id is invalid." );
+
+    const uint64_t idValue = id.getValue();
+
+    uint64_t slotIdx = idValue & m_indexMask;
+    for ( unsigned int probeCount = 0; probeCount < m_capacity; ++probeCount ) {
+        Slot& slot = m_slots[ slotIdx ];
+
+        uint64_t slotId = slot.id.load( std::memory_order_acquire );
+        if ( slotId == 0 ) {
+            // Try to claim the empty slot. If another thread was faster, check whether it inserted the same id.
+            if ( slot.id.compare_exchange_strong( slotId, idValue, std::memory_order_acq_rel ) )
+                return slot;
+        }
+
+        if ( slotId == idValue )
+            return slot;
+
+        slotIdx = ( slotIdx + 1 ) & m_indexMask;
+    }
+
+    throw std::exception( ( "AssetRegistry::findOrInsertSlot - registry is full (capacity: " + std::to_string( m_capacity ) + ")." ).c_str() );
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "AssetId.h"
+
+namespace Engine1
+{
+    class Asset;
+
+    // Concurrent open-addressing hash table keeping the state of all assets known to AssetManager.
+    // Reads (get, isLoaded, isLoadedOrLoading) don't allocate and don't take any registry-wide lock - isLoaded and isLoadedOrLoading are
+    // lock-free, get copies the asset pointer with std::atomic_load (standard library guards the reference count with a short spinlock
+    // per pointer). Writes use atomic compare-and-swap.
+    // Slots are never removed (only reset to "unloaded" when an asset fails to load), which keeps linear probing valid without tombstones.
+    // Capacity is fixed at construction and has to be a power of two.
+    class AssetRegistry
+    {
+        public:
+
+        static const unsigned int s_defaultCapacity = 1 << 16;
+
+        AssetRegistry( const unsigned int capacity = s_defaultCapacity );
+        ~AssetRegistry();
+
+        // Returns false if the asset is already loading or loaded.
+        bool markLoading( const AssetId id );
+        // If the asset was already loaded, the previous asset is kept and the new one is ignored.
+        void markLoaded( const AssetId id, std::shared_ptr< Asset > asset );
+        // Makes it possible to try loading the asset again.
+        void markFailed( const AssetId id );
+
+        bool                     isLoaded( const AssetId id ) const;
+        bool                     isLoadedOrLoading( const AssetId id ) const;
+        std::shared_ptr< Asset > get( const AssetId id ) const;
+
+        // Can run while other threads call get, isLoaded or isLoadedOrLoading - they see the asset as before clearing or no asset.
+        // Has to be serialized with markLoaded and markFailed by the caller.
+        void clear();
+
+        private:
+
+        enum class State : int
+        {
+            Unloaded = 0,
+            Loading  = 1,
+            Loaded   = 2
+        };
+
+        struct Slot
+        {
+            std::atomic< uint64_t > id;
+            std::atomic< int >      state;
+            // Accessed only through std::atomic_load/atomic_store/atomic_compare_exchange_strong - clear() can reset it while it's being read.
+            std::shared_ptr< Asset > asset;
+        };
+
+        const Slot* findSlot( const AssetId id ) const;
+        Slot&       findOrInsertSlot( const AssetId id );
+
+        const unsigned int        m_capacity;
+        const uint64_t            m_indexMask;
+        std::unique_ptr< Slot[] > m_slots;
+
+        // Odd while clear() runs. Lets get detect that the slot it read was cleared (and possibly reused for another asset) meanwhile.
+        std::atomic< unsigned int > m_clearCount;
+
+        // Copying is not allowed.
+        AssetRegistry( const AssetRegistry& ) = delete;
+        AssetRegistry& operator=( const AssetRegistry& ) = delete;
+    };
+}
@@ -42,12 +42,6 @@ const float43& BlockActor::getPose() const
 
 float43& BlockActor::getPose( )
 {
-    if ( m_physics )
-    {
-        auto transform = m_physics->getGlobalPose();
-        m_pose = float43( transform );
-    }
-        
     return m_pose;
 }
 
@@ -93,6 +87,12 @@ bool BlockActor::hasPhysics() const
     return m_physics != nullptr;
 }
 
+void BlockActor::updatePoseFromPhysics()
+{
+    if ( m_physics )
+        m_pose = float43( m_physics->getGlobalPose() );
+}
+
 void BlockActor::createDynamicPhysics()
 {
     PxTransform transform( 
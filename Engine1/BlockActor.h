@@ -37,6 +37,10 @@ namespace Engine1
 
         bool hasPhysics() const;
 
+        // Copies the pose simulated by physics to the actor. Pose getters don't read the physics scene -
+        // it may be simulated by other threads while the actor is rendered.
+        void updatePoseFromPhysics();
+
         void createDynamicPhysics();
         void createKinematicPhysics();
         void createPhysics( const physx::PxRigidActor& otherPhysics );
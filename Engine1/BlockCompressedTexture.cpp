@@ -0,0 +1,274 @@
+#include "BlockCompressedTexture.h"
+
+#include <algorithm>
+
+#include "BinaryFile.h"
+#include "JobSystem.h"
+
+using namespace Engine1;
+
+namespace
+{
+    // DDS header constants (see DDS_HEADER and DDS_HEADER_DXT10 in the DirectX documentation).
+    const int ddsMagic             = 0x20534444; // "DDS "
+    const int ddsHeaderSize        = 124;
+    const int ddsPixelFormatSize   = 32;
+    const int ddsFourCCDX10        = 0x30315844; // "DX10"
+    const int ddsFlagsRequired     = 0x1 | 0x2 | 0x4 | 0x1000;  // Caps, height, width, pixel format.
+    const int ddsFlagMipmapCount   = 0x20000;
+    const int ddsFlagLinearSize    = 0x80000;
+    const int ddsPixelFormatFourCC = 0x4;
+    const int ddsCapsTexture       = 0x1000;
+    const int ddsCapsComplex       = 0x8;
+    const int ddsCapsMipmap        = 0x400000;
+    const int dimensionTexture2D   = 3;
+}
+
+BlockCompression::Format BlockCompressedTexture::getFormat( const Model::TextureType textureType )
+{
+    switch ( textureType ) {
+        case Model::TextureType::Albedo:          return BlockCompression::Format::BC7;
+        case Model::TextureType::Emissive:        return BlockCompression::Format::BC1;
+        case Model::TextureType::Normal:          return BlockCompression::Format::BC5;
+        case Model::TextureType::Alpha:
+        case Model::TextureType::Metalness:
+        case Model::TextureType::Roughness:
+        case Model::TextureType::RefractiveIndex: return BlockCompression::Format::BC4;
+    }
+
+    throw std::exception( "BlockCompressedTexture::getFormat - unknown texture type." );
+}
+
+std::shared_ptr< BlockCompressedTexture > BlockCompressedTexture::createFromTexture( const Texture2D< uchar4 >& texture, const BlockCompression::Format format )
+{
+    if ( !texture.isInCpuMemory() )
+        throw std::exception( "BlockCompressedTexture::createFromTexture - texture is not in CPU memory." );
+
+    const int mipmapCount = texture.getMipMapCountOnCpu();
+
+    std::shared_ptr< BlockCompressedTexture > compressedTexture( new BlockCompressedTexture( format, texture.getWidth(), texture.getHeight(), mipmapCount ) );
+
+    JobSystem::get().parallelFor( mipmapCount, 1, [ & ]( const int beginMipmap, const int endMipmap ) {
+        for ( int mipmapLevel = beginMipmap; mipmapLevel < endMipmap; ++mipmapLevel ) {
+            // Swap BGRA to RGBA.
+            std::vector< uchar4 > pixels = texture.getData( mipmapLevel );
+            for ( uchar4& pixel : pixels )
+                std::swap( pixel.x, pixel.z );
+
+            compressedTexture->m_mipmaps[ mipmapLevel ]
+                = BlockCompression::encode( pixels.data(), texture.getWidth( mipmapLevel ), texture.getHeight( mipmapLevel ), format );
+        }
+    } );
+
+    return compressedTexture;
+}
+
+std::shared_ptr< BlockCompressedTexture > BlockCompressedTexture::createFromTexture( const Texture2D< unsigned char >& texture, const BlockCompression::Format format )
+{
+    if ( format != BlockCompression::Format::BC4 )
+        throw std::exception( "BlockCompressedTexture::createFromTexture - single channel textures can only be encoded as BC4." );
+
+    if ( !texture.isInCpuMemory() )
+        throw std::exception( "BlockCompressedTexture::createFromTexture - texture is not in CPU memory." );
+
+    const int mipmapCount = texture.getMipMapCountOnCpu();
+
+    std::shared_ptr< BlockCompressedTexture > compressedTexture( new BlockCompressedTexture( format, texture.getWidth(), texture.getHeight(), mipmapCount ) );
+
+    JobSystem::get().parallelFor( mipmapCount, 1, [ & ]( const int beginMipmap, const int endMipmap ) {
+        for ( int mipmapLevel = beginMipmap; mipmapLevel < endMipmap; ++mipmapLevel ) {
+            compressedTexture->m_mipmaps[ mipmapLevel ]
+                = BlockCompression::encode( texture.getData( mipmapLevel ).data(), texture.getWidth( mipmapLevel ), texture.getHeight( mipmapLevel ) );
+        }
+    } );
+
+    return compressedTexture;
+}
+
+std::shared_ptr< BlockCompressedTexture > BlockCompressedTexture::createFromFile( const std::string& path )
+{
+    std::shared_ptr< std::vector< char > > data = BinaryFile::load( path );
+
+    return createFromMemory( data->cbegin(), data->cend() );
+}
+
+std::shared_ptr< BlockCompressedTexture > BlockCompressedTexture::createFromMemory( std::vector< char >::const_iterator dataIt, std::vector< char >::const_iterator dataEndIt )
+{
+    const int headersSize = 4 + ddsHeaderSize + 20;
+    if ( std::distance( dataIt, dataEndIt ) < headersSize )
+        throw std::exception( "BlockCompressedTexture::createFromMemory - data is too small to contain DDS headers." );
+
+    const std::vector< char >::const_iterator headerIt = dataIt + 4;
+
+    if ( BinaryFile::readInt( dataIt ) != ddsMagic )
+        throw std::exception( "BlockCompressedTexture::createFromMemory - data is not a DDS file." );
+
+    BinaryFile::readInt( dataIt ); // Header size.
+    const int flags       = BinaryFile::readInt( dataIt );
+    const int height      = BinaryFile::readInt( dataIt );
+    const int width       = BinaryFile::readInt( dataIt );
+    BinaryFile::readInt( dataIt ); // Linear size.
+    BinaryFile::readInt( dataIt ); // Depth.
+    const int mipmapCountValue = BinaryFile::readInt( dataIt );
+    const int mipmapCount      = ( flags & ddsFlagMipmapCount ) ? std::max( 1, mipmapCountValue ) : 1;
+
+    dataIt += 11 * 4; // Reserved.
+
+    BinaryFile::readInt( dataIt ); // Pixel format size.
+    BinaryFile::readInt( dataIt ); // Pixel format flags.
+    if ( BinaryFile::readInt( dataIt ) != ddsFourCCDX10 )
+        throw std::exception( "BlockCompressedTexture::createFromMemory - only DDS files with DX10 header are supported." );
+
+    dataIt = headerIt + ddsHeaderSize;
+
+    const BlockCompression::Format format = fromDxgiFormat( BinaryFile::readInt( dataIt ) );
+    dataIt += 4 * 4; // Resource dimension, misc flags, array size, misc flags 2.
+
+    std::shared_ptr< BlockCompressedTexture > compressedTexture( new BlockCompressedTexture( format, width, height, mipmapCount ) );
+
+    for ( int mipmapLevel = 0; mipmapLevel < mipmapCount; ++mipmapLevel ) {
+        const int size = BlockCompression::getEncodedSize( format, compressedTexture->getWidth( mipmapLevel ), compressedTexture->getHeight( mipmapLevel ) );
+
+        if ( std::distance( dataIt, dataEndIt ) < size )
+            throw std::exception( "BlockCompressedTexture::createFromMemory - data is too small to contain all mipmaps." );
+
+        compressedTexture->m_mipmaps[ mipmapLevel ].assign( dataIt, dataIt + size );
+        dataIt += size;
+    }
+
+    return compressedTexture;
+}
+
+void BlockCompressedTexture::saveToFile( const std::string& path ) const
+{
+    std::vector< char > data;
+    saveToMemory( data );
+
+    BinaryFile::save( path, data );
+}
+
+void BlockCompressedTexture::saveToMemory( std::vector< char >& data ) const
+{
+    const int mipmapCount = getMipmapCount();
+
+    BinaryFile::writeInt( data, ddsMagic );
+
+    // DDS_HEADER.
+    BinaryFile::writeInt( data, ddsHeaderSize );
+    BinaryFile::writeInt( data, ddsFlagsRequired | ddsFlagLinearSize | ( mipmapCount > 1 ? ddsFlagMipmapCount : 0 ) );
+    BinaryFile::writeInt( data, m_height );
+    BinaryFile::writeInt( data, m_width );
+    BinaryFile::writeInt( data, (int)getData( 0 ).size() );
+    BinaryFile::writeInt( data, 0 ); // Depth.
+    BinaryFile::writeInt( data, mipmapCount );
+    for ( int i = 0; i < 11; ++i )
+        BinaryFile::writeInt( data, 0 ); // Reserved.
+
+    // DDS_PIXELFORMAT.
+    BinaryFile::writeInt( data, ddsPixelFormatSize );
+    BinaryFile::writeInt( data, ddsPixelFormatFourCC );
+    BinaryFile::writeInt( data, ddsFourCCDX10 );
+    for ( int i = 0; i < 5; ++i )
+        BinaryFile::writeInt( data, 0 ); // Bit count and masks.
+
+    BinaryFile::writeInt( data, ddsCapsTexture | ( mipmapCount > 1 ? ddsCapsComplex | ddsCapsMipmap : 0 ) );
+    for ( int i = 0; i < 4; ++i )
+        BinaryFile::writeInt( data, 0 ); // Caps 2-4, reserved.
+
+    // DDS_HEADER_DXT10.
+    BinaryFile::writeInt( data, toDxgiFormat( m_format ) );
+    BinaryFile::writeInt( data, dimensionTexture2D );
+    BinaryFile::writeInt( data, 0 ); // Misc flags.
+    BinaryFile::writeInt( data, 1 ); // Array size.
+    BinaryFile::writeInt( data, 0 ); // Misc flags 2.
+
+    for ( const std::vector< unsigned char >& mipmap : m_mipmaps )
+        data.insert( data.end(), mipmap.begin(), mipmap.end() );
+}
+
+std::vector< uchar4 > BlockCompressedTexture::decode( const int mipmapLevel ) const
+{
+    const int width  = getWidth( mipmapLevel );
+    const int height = getHeight( mipmapLevel );
+
+    std::vector< uchar4 > pixels( width * height );
+    BlockCompression::decode( getData( mipmapLevel ).data(), width, height, m_format, pixels.data() );
+
+    return pixels;
+}
+
+BlockCompression::Format BlockCompressedTexture::getFormat() const
+{
+    return m_format;
+}
+
+int BlockCompressedTexture::getMipmapCount() const
+{
+    return (int)m_mipmaps.size();
+}
+
+int BlockCompressedTexture::getWidth( const int mipmapLevel ) const
+{
+    if ( mipmapLevel < 0 || mipmapLevel >= getMipmapCount() )
+        throw std::exception( "BlockCompressedTexture::getWidth - incorrect mipmap level." );
+
+    return std::max( 1, m_width >> mipmapLevel );
+}
+
+int BlockCompressedTexture::getHeight( const int mipmapLevel ) const
+{
+    if ( mipmapLevel < 0 || mipmapLevel >= getMipmapCount() )
+        throw std::exception( "BlockCompressedTexture::getHeight - incorrect mipmap level." );
+
+    return std::max( 1, m_height >> mipmapLevel );
+}
+
+const std::vector< unsigned char >& BlockCompressedTexture::getData( const int mipmapLevel ) const
+{
+    if ( mipmapLevel < 0 || mipmapLevel >= getMipmapCount() )
+        throw std::exception( "BlockCompressedTexture::getData - incorrect mipmap level." );
+
+    return m_mipmaps[ mipmapLevel ];
+}
+
+int BlockCompressedTexture::getSize() const
+{
+    int size = 0;
+    for ( const std::vector< unsigned char >& mipmap : m_mipmaps )
+        size += (int)mipmap.size();
+
+    return size;
+}
+
+BlockCompressedTexture::BlockCompressedTexture( const BlockCompression::Format format, const int width, const int height, const int mipmapCount ) :
+    m_format( format ),
+    m_width( width ),
+    m_height( height ),
+    m_mipmaps( std::max( 1, mipmapCount ) )
+{}
+
+int BlockCompressedTexture::toDxgiFormat( const BlockCompression::Format format )
+{
+    switch ( format ) {
+        case BlockCompression::Format::BC1: return DXGI_FORMAT_BC1_UNORM;
+        case BlockCompression::Format::BC3: return DXGI_FORMAT_BC3_UNORM;
+        case BlockCompression::Format::BC4: return DXGI_FORMAT_BC4_UNORM;
+        case BlockCompression::Format::BC5: return DXGI_FORMAT_BC5_UNORM;
+        case BlockCompression::Format::BC7: return DXGI_FORMAT_BC7_UNORM;
+    }
+
+    throw std::exception( "BlockCompressedTexture::toDxgiFormat - unknown format." );
+}
+
+BlockCompression::Format BlockCompressedTexture::fromDxgiFormat( const int dxgiFormat )
+{
+    switch ( dxgiFormat ) {
+        case DXGI_FORMAT_BC1_UNORM: return BlockCompression::Format::BC1;
+        case DXGI_FORMAT_BC3_UNORM: return BlockCompression::Format::BC3;
+        case DXGI_FORMAT_BC4_UNORM: return BlockCompression::Format::BC4;
+        case DXGI_FORMAT_BC5_UNORM: return BlockCompression::Format::BC5;
+        case DXGI_FORMAT_BC7_UNORM: return BlockCompression::Format::BC7;
+    }
+
+    throw std::exception( "BlockCompressedTexture::fromDxgiFormat - unsupported DXGI format." );
+}
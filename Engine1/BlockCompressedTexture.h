@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <string>
+
+#include "BlockCompression.h"
+#include "Model.h"
+
+namespace Engine1
+{
+    // Block-compressed texture with all its mipmaps stored on CPU.
+    // Saved to and loaded from DDS files (with DX10 header), so it can be used by any tool or loader supporting BCn formats.
+    class BlockCompressedTexture
+    {
+        public:
+
+        // Format used for the given kind of model texture.
+        static BlockCompression::Format getFormat( const Model::TextureType textureType );
+
+        // Encodes all mipmaps stored on CPU (mipmaps are encoded in parallel).
+        // uchar4 textures are expected in BGRA order (the format used for model textures).
+        static std::shared_ptr< BlockCompressedTexture > createFromTexture( const Texture2D< uchar4 >& texture, const BlockCompression::Format format );
+        static std::shared_ptr< BlockCompressedTexture > createFromTexture( const Texture2D< unsigned char >& texture, const BlockCompression::Format format = BlockCompression::Format::BC4 );
+
+        static std::shared_ptr< BlockCompressedTexture > createFromFile( const std::string& path );
+        static std::shared_ptr< BlockCompressedTexture > createFromMemory( std::vector< char >::const_iterator dataIt, std::vector< char >::const_iterator dataEndIt );
+
+        void saveToFile( const std::string& path ) const;
+        void saveToMemory( std::vector< char >& data ) const;
+
+        // Returns RGBA pixels.
+        std::vector< uchar4 > decode( const int mipmapLevel = 0 ) const;
+
+        BlockCompression::Format            getFormat() const;
+        int                                 getMipmapCount() const;
+        int                                 getWidth( const int mipmapLevel = 0 ) const;
+        int                                 getHeight( const int mipmapLevel = 0 ) const;
+        const std::vector< unsigned char >& getData( const int mipmapLevel = 0 ) const;
+        int                                 getSize() const; // Size of all mipmaps in bytes.
+
+        private:
+
+        BlockCompressedTexture( const BlockCompression::Format format, const int width, const int height, const int mipmapCount );
+
+        static int           toDxgiFormat( const BlockCompression::Format format );
+        static BlockCompression::Format fromDxgiFormat( const int dxgiFormat );
+
+        BlockCompression::Format m_format;
+        int                      m_width;
+        int                      m_height;
+
+        std::vector< std::vector< unsigned char > > m_mipmaps;
+    };
+}
@@ -0,0 +1,696 @@
+#include "BlockCompression.h"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "uchar4.h"
+#include "JobSystem.h"
+
+using namespace Engine1;
+
+namespace
+{
+    typedef unsigned char Block[ 16 ][ 4 ];
+
+    // Interpolation weights (out of 64) for 4-bit BC7 indices.
+    const int bc7Weights[ 16 ] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    // Weights (0 - first endpoint, 1 - second endpoint) of BC1 palette entries in four-color mode.
+    const float bc1Weights[ 4 ] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+    // Reads a 4x4 block, repeating the last row/column for blocks crossing the texture border.
+    void loadBlock( const unsigned char* pixels, const int pixelSize, const int width, const int height, const int blockX, const int blockY, Block& block )
+    {
+        for ( int y = 0; y < 4; ++y ) {
+            const int pixelY = std::min( height - 1, blockY * 4 + y );
+
+            for ( int x = 0; x < 4; ++x ) {
+                const int pixelX = std::min( width - 1, blockX * 4 + x );
+
+                const unsigned char* pixel = pixels + ( (size_t)pixelY * width + pixelX ) * pixelSize;
+                for ( int c = 0; c < 4; ++c )
+                    block[ y * 4 + x ][ c ] = c < pixelSize ? pixel[ c ] : 0;
+            }
+        }
+    }
+
+    void storeBlock( const Block& block, const int pixelSize, const int width, const int height, const int blockX, const int blockY, unsigned char* pixels )
+    {
+        for ( int y = 0; y < 4 && blockY * 4 + y < height; ++y ) {
+            for ( int x = 0; x < 4 && blockX * 4 + x < width; ++x ) {
+                unsigned char* pixel = pixels + ( (size_t)( blockY * 4 + y ) * width + blockX * 4 + x ) * pixelSize;
+                for ( int c = 0; c < pixelSize; ++c )
+                    pixel[ c ] = block[ y * 4 + x ][ c ];
+            }
+        }
+    }
+
+    // Finds endpoints as the extremes of block colors projected on the principal axis (of the covariance matrix).
+    void findPrincipalAxisEndpoints( const unsigned char block[ 16 ][ 4 ], const int channelCount, float endpoint0[ 4 ], float endpoint1[ 4 ] )
+    {
+        float mean[ 4 ] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for ( int i = 0; i < 16; ++i )
+            for ( int c = 0; c < channelCount; ++c )
+                mean[ c ] += (float)block[ i ][ c ] / 16.0f;
+
+        float covariance[ 4 ][ 4 ] = {};
+        for ( int i = 0; i < 16; ++i ) {
+            for ( int c1 = 0; c1 < channelCount; ++c1 ) {
+                for ( int c2 = 0; c2 < channelCount; ++c2 )
+                    covariance[ c1 ][ c2 ] += ( (float)block[ i ][ c1 ] - mean[ c1 ] ) * ( (float)block[ i ][ c2 ] - mean[ c2 ] );
+            }
+        }
+
+        // Power iteration.
+        float axis[ 4 ] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        for ( int iteration = 0; iteration < 8; ++iteration ) {
+            float next[ 4 ] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            float length    = 0.0f;
+            for ( int c1 = 0; c1 < channelCount; ++c1 ) {
+                for ( int c2 = 0; c2 < channelCount; ++c2 )
+                    next[ c1 ] += covariance[ c1 ][ c2 ] * axis[ c2 ];
+
+                length = std::max( length, std::abs( next[ c1 ] ) );
+            }
+
+            if ( length < 1e-6f )
+                break; // All colors are (almost) the same.
+
+            for ( int c = 0; c < channelCount; ++c )
+                axis[ c ] = next[ c ] / length;
+        }
+
+        float minProjection = std::numeric_limits< float >::max();
+        float maxProjection = -std::numeric_limits< float >::max();
+        for ( int i = 0; i < 16; ++i ) {
+            float projection = 0.0f;
+            for ( int c = 0; c < channelCount; ++c )
+                projection += ( (float)block[ i ][ c ] - mean[ c ] ) * axis[ c ];
+
+            if ( projection < minProjection ) {
+                minProjection = projection;
+                for ( int c = 0; c < channelCount; ++c ) endpoint1[ c ] = (float)block[ i ][ c ];
+            }
+            if ( projection > maxProjection ) {
+                maxProjection = projection;
+                for ( int c = 0; c < channelCount; ++c ) endpoint0[ c ] = (float)block[ i ][ c ];
+            }
+        }
+    }
+
+    // Finds endpoints minimizing squared error for given interpolation weights of each pixel (0 - endpoint0, 1 - endpoint1).
+    // Returns false if all pixels use the same weight (system has no unique solution).
+    bool fitEndpointsLeastSquares( const unsigned char block[ 16 ][ 4 ], const int channelCount, const float weights[ 16 ], float endpoint0[ 4 ], float endpoint1[ 4 ] )
+    {
+        float a = 0.0f, b = 0.0f, c = 0.0f;
+        float rhs0[ 4 ] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        float rhs1[ 4 ] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+        for ( int i = 0; i < 16; ++i ) {
+            const float t = weights[ i ];
+            a += ( 1.0f - t ) * ( 1.0f - t );
+            b += ( 1.0f - t ) * t;
+            c += t * t;
+
+            for ( int ch = 0; ch < channelCount; ++ch ) {
+                rhs0[ ch ] += ( 1.0f - t ) * (float)block[ i ][ ch ];
+                rhs1[ ch ] += t * (float)block[ i ][ ch ];
+            }
+        }
+
+        const float determinant = a * c - b * b;
+        if ( std::abs( determinant ) < 1e-6f )
+            return false;
+
+        for ( int ch = 0; ch < channelCount; ++ch ) {
+            endpoint0[ ch ] = std::min( 255.0f, std::max( 0.0f, ( c * rhs0[ ch ] - b * rhs1[ ch ] ) / determinant ) );
+            endpoint1[ ch ] = std::min( 255.0f, std::max( 0.0f, ( a * rhs1[ ch ] - b * rhs0[ ch ] ) / determinant ) );
+        }
+
+        return true;
+    }
+
+    // Picks the nearest palette entry for each pixel. Returns total squared error.
+    int findIndices( const unsigned char block[ 16 ][ 4 ], const int channelCount, const unsigned char palette[][ 4 ], const int paletteSize, int indices[ 16 ] )
+    {
+        int totalError = 0;
+        for ( int i = 0; i < 16; ++i ) {
+            int bestError = std::numeric_limits< int >::max();
+            for ( int p = 0; p < paletteSize; ++p ) {
+                int error = 0;
+                for ( int c = 0; c < channelCount; ++c ) {
+                    const int difference = (int)block[ i ][ c ] - (int)palette[ p ][ c ];
+                    error += difference * difference;
+                }
+
+                if ( error < bestError ) {
+                    bestError    = error;
+                    indices[ i ] = p;
+                }
+            }
+
+            totalError += bestError;
+        }
+
+        return totalError;
+    }
+
+    unsigned short packColor565( const float color[ 4 ] )
+    {
+        const int r = (int)( std::min( 255.0f, std::max( 0.0f, color[ 0 ] ) ) * 31.0f / 255.0f + 0.5f );
+        const int g = (int)( std::min( 255.0f, std::max( 0.0f, color[ 1 ] ) ) * 63.0f / 255.0f + 0.5f );
+        const int b = (int)( std::min( 255.0f, std::max( 0.0f, color[ 2 ] ) ) * 31.0f / 255.0f + 0.5f );
+
+        return (unsigned short)( ( r << 11 ) | ( g << 5 ) | b );
+    }
+
+    void unpackColor565( const unsigned short color, unsigned char output[ 4 ] )
+    {
+        const int r = ( color >> 11 ) & 31;
+        const int g = ( color >> 5 ) & 63;
+        const int b = color & 31;
+
+        output[ 0 ] = (unsigned char)( ( r << 3 ) | ( r >> 2 ) );
+        output[ 1 ] = (unsigned char)( ( g << 2 ) | ( g >> 4 ) );
+        output[ 2 ] = (unsigned char)( ( b << 3 ) | ( b >> 2 ) );
+        output[ 3 ] = 255;
+    }
+
+    void getPaletteBC1( const unsigned short color0, const unsigned short color1, const bool forceFourColors, unsigned char palette[ 4 ][ 4 ] )
+    {
+        unpackColor565( color0, palette[ 0 ] );
+        unpackColor565( color1, palette[ 1 ] );
+
+        for ( int c = 0; c < 3; ++c ) {
+            if ( color0 > color1 || forceFourColors ) {
+                palette[ 2 ][ c ] = (unsigned char)( ( 2 * palette[ 0 ][ c ] + palette[ 1 ][ c ] + 1 ) / 3 );
+                palette[ 3 ][ c ] = (unsigned char)( ( palette[ 0 ][ c ] + 2 * palette[ 1 ][ c ] + 1 ) / 3 );
+            } else {
+                palette[ 2 ][ c ] = (unsigned char)( ( palette[ 0 ][ c ] + palette[ 1 ][ c ] ) / 2 );
+                palette[ 3 ][ c ] = 0;
+            }
+        }
+
+        palette[ 2 ][ 3 ] = 255;
+        palette[ 3 ][ 3 ] = ( color0 > color1 || forceFourColors ) ? 255 : 0;
+    }
+
+    void getPaletteBC4( const unsigned char value0, const unsigned char value1, unsigned char palette[ 8 ] )
+    {
+        palette[ 0 ] = value0;
+        palette[ 1 ] = value1;
+
+        if ( value0 > value1 ) {
+            for ( int i = 1; i <= 6; ++i )
+                palette[ i + 1 ] = (unsigned char)( ( ( 7 - i ) * value0 + i * value1 + 3 ) / 7 );
+        } else {
+            for ( int i = 1; i <= 4; ++i )
+                palette[ i + 1 ] = (unsigned char)( ( ( 5 - i ) * value0 + i * value1 + 2 ) / 5 );
+
+            palette[ 6 ] = 0;
+            palette[ 7 ] = 255;
+        }
+    }
+
+    // Quantizes an endpoint to 7 bits per channel plus a shared p-bit (BC7 mode 6). Returns chosen p-bit.
+    int quantizeEndpointBC7( const float endpoint[ 4 ], unsigned char quantized[ 4 ] )
+    {
+        int   bestPBit  = 0;
+        float bestError = std::numeric_limits< float >::max();
+
+        for ( int pBit = 0; pBit < 2; ++pBit ) {
+            float         error = 0.0f;
+            unsigned char values[ 4 ];
+            for ( int c = 0; c < 4; ++c ) {
+                values[ c ] = (unsigned char)std::min( 127, std::max( 0, (int)std::floor( ( endpoint[ c ] - (float)pBit ) / 2.0f + 0.5f ) ) );
+
+                const float difference = (float)( values[ c ] * 2 + pBit ) - endpoint[ c ];
+                error += difference * difference;
+            }
+
+            if ( error < bestError ) {
+                bestError = error;
+                bestPBit  = pBit;
+                std::copy( values, values + 4, quantized );
+            }
+        }
+
+        return bestPBit;
+    }
+
+    void getPaletteBC7( const unsigned char endpoint0[ 4 ], const unsigned char endpoint1[ 4 ], unsigned char palette[ 16 ][ 4 ] )
+    {
+        for ( int i = 0; i < 16; ++i ) {
+            for ( int c = 0; c < 4; ++c )
+                palette[ i ][ c ] = (unsigned char)( ( ( 64 - bc7Weights[ i ] ) * endpoint0[ c ] + bc7Weights[ i ] * endpoint1[ c ] + 32 ) >> 6 );
+        }
+    }
+
+    class BitWriter
+    {
+        public:
+
+        BitWriter( unsigned char* output ) : m_output( output ), m_position( 0 ) {}
+
+        void write( const int value, const int bitCount )
+        {
+            for ( int i = 0; i < bitCount; ++i, ++m_position ) {
+                if ( ( value >> i ) & 1 )
+                    m_output[ m_position / 8 ] |= (unsigned char)( 1 << ( m_position % 8 ) );
+            }
+        }
+
+        private:
+
+        unsigned char* m_output;
+        int            m_position;
+    };
+
+    class BitReader
+    {
+        public:
+
+        BitReader( const unsigned char* input ) : m_input( input ), m_position( 0 ) {}
+
+        int read( const int bitCount )
+        {
+            int value = 0;
+            for ( int i = 0; i < bitCount; ++i, ++m_position )
+                value |= ( ( m_input[ m_position / 8 ] >> ( m_position % 8 ) ) & 1 ) << i;
+
+            return value;
+        }
+
+        private:
+
+        const unsigned char* m_input;
+        int                  m_position;
+    };
+}
+
+std::string BlockCompression::formatToString( const Format format )
+{
+    switch ( format ) {
+        case Format::BC1: return "BC1";
+        case Format::BC3: return "BC3";
+        case Format::BC4: return "BC4";
+        case Format::BC5: return "BC5";
+        case Format::BC7: return "BC7";
+    }
+
+    throw std::exception( "BlockCompression::formatToString - unknown format." );
+}
+
+int BlockCompression::getBlockSize( const Format format )
+{
+    return ( format == Format::BC1 || format == Format::BC4 ) ? 8 : 16;
+}
+
+int BlockCompression::getBlockCount( const int width, const int height )
+{
+    return ( ( width + 3 ) / 4 ) * ( ( height + 3 ) / 4 );
+}
+
+int BlockCompression::getEncodedSize( const Format format, const int width, const int height )
+{
+    return getBlockCount( width, height ) * getBlockSize( format );
+}
+
+std::vector< unsigned char > BlockCompression::encode( const uchar4* pixels, const int width, const int height, const Format format )
+{
+    if ( width <= 0 || height <= 0 )
+        throw std::exception( "BlockCompression::encode - given width or height has zero or negative value." );
+
+    const int blockCountX = ( width + 3 ) / 4;
+    const int blockCountY = ( height + 3 ) / 4;
+    const int blockSize   = getBlockSize( format );
+
+    std::vector< unsigned char > blocks( (size_t)blockCountX * blockCountY * blockSize, 0 );
+
+    JobSystem::get().parallelFor( blockCountY, 1, [ & ]( const int beginY, const int endY ) {
+        Block block;
+
+        for ( int blockY = beginY; blockY < endY; ++blockY ) {
+            for ( int blockX = 0; blockX < blockCountX; ++blockX ) {
+                loadBlock( (const unsigned char*)pixels, 4, width, height, blockX, blockY, block );
+
+                unsigned char* output = blocks.data() + ( (size_t)blockY * blockCountX + blockX ) * blockSize;
+
+                switch ( format ) {
+                    case Format::BC1:
+                        encodeBlockBC1( block, output );
+                        break;
+                    case Format::BC3:
+                        encodeBlockBC4( block, 3, output );
+                        encodeBlockBC1( block, output + 8 );
+                        break;
+                    case Format::BC4:
+                        encodeBlockBC4( block, 0, output );
+                        break;
+                    case Format::BC5:
+                        encodeBlockBC4( block, 0, output );
+                        encodeBlockBC4( block, 1, output + 8 );
+                        break;
+                    case Format::BC7:
+                        encodeBlockBC7( block, output );
+                        break;
+                }
+            }
+        }
+    } );
+
+    return blocks;
+}
+
+std::vector< unsigned char > BlockCompression::encode( const unsigned char* pixels, const int width, const int height )
+{
+    if ( width <= 0 || height <= 0 )
+        throw std::exception( "BlockCompression::encode - given width or height has zero or negative value." );
+
+    const int blockCountX = ( width + 3 ) / 4;
+    const int blockCountY = ( height + 3 ) / 4;
+
+    std::vector< unsigned char > blocks( (size_t)blockCountX * blockCountY * 8, 0 );
+
+    JobSystem::get().parallelFor( blockCountY, 1, [ & ]( const int beginY, const int endY ) {
+        Block block;
+
+        for ( int blockY = beginY; blockY < endY; ++blockY ) {
+            for ( int blockX = 0; blockX < blockCountX; ++blockX ) {
+                loadBlock( pixels, 1, width, height, blockX, blockY, block );
+                encodeBlockBC4( block, 0, blocks.data() + ( (size_t)blockY * blockCountX + blockX ) * 8 );
+            }
+        }
+    } );
+
+    return blocks;
+}
+
+void BlockCompression::decode( const unsigned char* blocks, const int width, const int height, const Format format, uchar4* pixels )
+{
+    const int blockCountX = ( width + 3 ) / 4;
+    const int blockCountY = ( height + 3 ) / 4;
+    const int blockSize   = getBlockSize( format );
+
+    JobSystem::get().parallelFor( blockCountY, 1, [ & ]( const int beginY, const int endY ) {
+        Block block;
+
+        for ( int blockY = beginY; blockY < endY; ++blockY ) {
+            for ( int blockX = 0; blockX < blockCountX; ++blockX ) {
+                const unsigned char* input = blocks + ( (size_t)blockY * blockCountX + blockX ) * blockSize;
+
+                for ( int i = 0; i < 16; ++i ) {
+                    block[ i ][ 0 ] = block[ i ][ 1 ] = block[ i ][ 2 ] = 0;
+                    block[ i ][ 3 ] = 255;
+                }
+
+                switch ( format ) {
+                    case Format::BC1:
+                        decodeBlockBC1( input, false, block );
+                        break;
+                    case Format::BC3:
+                        decodeBlockBC1( input + 8, true, block ); // Color blocks of BC3 always use four colors.
+                        decodeBlockBC4( input, 3, block );
+                        break;
+                    case Format::BC4:
+                        decodeBlockBC4( input, 0, block );
+                        break;
+                    case Format::BC5:
+                        decodeBlockBC4( input, 0, block );
+                        decodeBlockBC4( input + 8, 1, block );
+                        break;
+                    case Format::BC7:
+                        decodeBlockBC7( input, block );
+                        break;
+                }
+
+                storeBlock( block, 4, width, height, blockX, blockY, (unsigned char*)pixels );
+            }
+        }
+    } );
+}
+
+void BlockCompression::decode( const unsigned char* blocks, const int width, const int height, unsigned char* pixels )
+{
+    const int blockCountX = ( width + 3 ) / 4;
+    const int blockCountY = ( height + 3 ) / 4;
+
+    JobSystem::get().parallelFor( blockCountY, 1, [ & ]( const int beginY, const int endY ) {
+        Block block;
+
+        for ( int blockY = beginY; blockY < endY; ++blockY ) {
+            for ( int blockX = 0; blockX < blockCountX; ++blockX ) {
+                decodeBlockBC4( blocks + ( (size_t)blockY * blockCountX + blockX ) * 8, 0, block );
+                storeBlock( block, 1, width, height, blockX, blockY, pixels );
+            }
+        }
+    } );
+}
+
+float BlockCompression::calculatePsnr( const uchar4* pixels1, const uchar4* pixels2, const int pixelCount, const int channelCount )
+{
+    const unsigned char* data1 = (const unsigned char*)pixels1;
+    const unsigned char* data2 = (const unsigned char*)pixels2;
+
+    double squaredErrorSum = 0.0;
+    for ( int i = 0; i < pixelCount; ++i ) {
+        for ( int c = 0; c < channelCount; ++c ) {
+            const double difference = (double)data1[ i * 4 + c ] - (double)data2[ i * 4 + c ];
+            squaredErrorSum += difference * difference;
+        }
+    }
+
+    if ( squaredErrorSum == 0.0 )
+        return std::numeric_limits< float >::infinity();
+
+    const double meanSquaredError = squaredErrorSum / ( (double)pixelCount * channelCount );
+
+    return (float)( 10.0 * std::log10( 255.0 * 255.0 / meanSquaredError ) );
+}
+
+float BlockCompression::calculatePsnr( const unsigned char* pixels1, const unsigned char* pixels2, const int pixelCount )
+{
+    double squaredErrorSum = 0.0;
+    for ( int i = 0; i < pixelCount; ++i ) {
+        const double difference = (double)pixels1[ i ] - (double)pixels2[ i ];
+        squaredErrorSum += difference * difference;
+    }
+
+    if ( squaredErrorSum == 0.0 )
+        return std::numeric_limits< float >::infinity();
+
+    return (float)( 10.0 * std::log10( 255.0 * 255.0 / ( squaredErrorSum / pixelCount ) ) );
+}
+
+void BlockCompression::encodeBlockBC1( const unsigned char block[ 16 ][ 4 ], unsigned char* output )
+{
+    float endpoint0[ 4 ], endpoint1[ 4 ];
+    findPrincipalAxisEndpoints( block, 3, endpoint0, endpoint1 );
+
+    unsigned short bestColor0 = 0, bestColor1 = 0;
+    int            bestIndices[ 16 ];
+    int            bestError = std::numeric_limits< int >::max();
+
+    // First try endpoints from the principal axis, then refine them once using the found indices.
+    for ( int iteration = 0; iteration < 2; ++iteration ) {
+        unsigned short color0 = packColor565( endpoint0 );
+        unsigned short color1 = packColor565( endpoint1 );
+
+        // Four-color mode requires color0 > color1.
+        if ( color0 < color1 )
+            std::swap( color0, color1 );
+
+        unsigned char palette[ 4 ][ 4 ];
+        getPaletteBC1( color0, color1, true, palette );
+
+        int       indices[ 16 ];
+        const int error = findIndices( block, 3, palette, color0 == color1 ? 1 : 4, indices );
+
+        if ( error < bestError ) {
+            bestError  = error;
+            bestColor0 = color0;
+            bestColor1 = color1;
+            std::copy( indices, indices + 16, bestIndices );
+        }
+
+        float weights[ 16 ];
+        for ( int i = 0; i < 16; ++i )
+            weights[ i ] = bc1Weights[ indices[ i ] ];
+
+        if ( bestError == 0 || !fitEndpointsLeastSquares( block, 3, weights, endpoint0, endpoint1 ) )
+            break;
+    }
+
+    output[ 0 ] = (unsigned char)( bestColor0 & 0xFF );
+    output[ 1 ] = (unsigned char)( bestColor0 >> 8 );
+    output[ 2 ] = (unsigned char)( bestColor1 & 0xFF );
+    output[ 3 ] = (unsigned char)( bestColor1 >> 8 );
+
+    unsigned int packedIndices = 0;
+    for ( int i = 0; i < 16; ++i )
+        packedIndices |= (unsigned int)bestIndices[ i ] << ( 2 * i );
+
+    for ( int i = 0; i < 4; ++i )
+        output[ 4 + i ] = (unsigned char)( packedIndices >> ( 8 * i ) );
+}
+
+void BlockCompression::encodeBlockBC4( const unsigned char block[ 16 ][ 4 ], const int channel, unsigned char* output )
+{
+    unsigned char minValue = 255, maxValue = 0;
+    for ( int i = 0; i < 16; ++i ) {
+        minValue = std::min( minValue, block[ i ][ channel ] );
+        maxValue = std::max( maxValue, block[ i ][ channel ] );
+    }
+
+    unsigned char palette[ 8 ];
+    getPaletteBC4( maxValue, minValue, palette );
+
+    output[ 0 ] = maxValue;
+    output[ 1 ] = minValue;
+
+    unsigned long long packedIndices = 0;
+    for ( int i = 0; i < 16; ++i ) {
+        int bestIndex = 0, bestError = std::numeric_limits< int >::max();
+        for ( int p = 0; p < 8; ++p ) {
+            const int error = std::abs( (int)block[ i ][ channel ] - (int)palette[ p ] );
+            if ( error < bestError ) {
+                bestError = error;
+                bestIndex = p;
+            }
+        }
+
+        packedIndices |= (unsigned long long)bestIndex << ( 3 * i );
+    }
+
+    for ( int i = 0; i < 6; ++i )
+        output[ 2 + i ] = (unsigned char)( packedIndices >> ( 8 * i ) );
+}
+
+void BlockCompression::encodeBlockBC7( const unsigned char block[ 16 ][ 4 ], unsigned char* output )
+{
+    float endpoint0[ 4 ], endpoint1[ 4 ];
+    findPrincipalAxisEndpoints( block, 4, endpoint0, endpoint1 );
+
+    unsigned char bestEndpoint0[ 4 ], bestEndpoint1[ 4 ];
+    int           bestPBit0 = 0, bestPBit1 = 0;
+    int           bestIndices[ 16 ];
+    int           bestError = std::numeric_limits< int >::max();
+
+    for ( int iteration = 0; iteration < 2; ++iteration ) {
+        unsigned char quantized0[ 4 ], quantized1[ 4 ];
+        const int     pBit0 = quantizeEndpointBC7( endpoint0, quantized0 );
+        const int     pBit1 = quantizeEndpointBC7( endpoint1, quantized1 );
+
+        unsigned char expanded0[ 4 ], expanded1[ 4 ];
+        for ( int c = 0; c < 4; ++c ) {
+            expanded0[ c ] = (unsigned char)( quantized0[ c ] * 2 + pBit0 );
+            expanded1[ c ] = (unsigned char)( quantized1[ c ] * 2 + pBit1 );
+        }
+
+        unsigned char palette[ 16 ][ 4 ];
+        getPaletteBC7( expanded0, expanded1, palette );
+
+        int       indices[ 16 ];
+        const int error = findIndices( block, 4, palette, 16, indices );
+
+        if ( error < bestError ) {
+            bestError = error;
+            bestPBit0 = pBit0;
+            bestPBit1 = pBit1;
+            std::copy( quantized0, quantized0 + 4, bestEndpoint0 );
+            std::copy( quantized1, quantized1 + 4, bestEndpoint1 );
+            std::copy( indices, indices + 16, bestIndices );
+        }
+
+        float weights[ 16 ];
+        for ( int i = 0; i < 16; ++i )
+            weights[ i ] = (float)bc7Weights[ indices[ i ] ] / 64.0f;
+
+        if ( bestError == 0 || !fitEndpointsLeastSquares( block, 4, weights, endpoint0, endpoint1 ) )
+            break;
+    }
+
+    // Most significant bit of the first pixel's index is implicit zero - swap endpoints if needed.
+    if ( bestIndices[ 0 ] >= 8 ) {
+        std::swap_ranges( bestEndpoint0, bestEndpoint0 + 4, bestEndpoint1 );
+        std::swap( bestPBit0, bestPBit1 );
+
+        for ( int i = 0; i < 16; ++i )
+            bestIndices[ i ] = 15 - bestIndices[ i ];
+    }
+
+    std::fill( output, output + 16, (unsigned char)0 );
+
+    BitWriter writer( output );
+    writer.write( 1 << 6, 7 ); // Mode 6.
+
+    for ( int c = 0; c < 4; ++c ) {
+        writer.write( bestEndpoint0[ c ], 7 );
+        writer.write( bestEndpoint1[ c ], 7 );
+    }
+
+    writer.write( bestPBit0, 1 );
+    writer.write( bestPBit1, 1 );
+
+    writer.write( bestIndices[ 0 ], 3 );
+    for ( int i = 1; i < 16; ++i )
+        writer.write( bestIndices[ i ], 4 );
+}
+
+void BlockCompression::decodeBlockBC1( const unsigned char* input, const bool forceFourColors, unsigned char block[ 16 ][ 4 ] )
+{
+    const unsigned short color0 = (unsigned short)( input[ 0 ] | ( input[ 1 ] << 8 ) );
+    const unsigned short color1 = (unsigned short)( input[ 2 ] | ( input[ 3 ] << 8 ) );
+
+    unsigned char palette[ 4 ][ 4 ];
+    getPaletteBC1( color0, color1, forceFourColors, palette );
+
+    const unsigned int packedIndices = input[ 4 ] | ( input[ 5 ] << 8 ) | ( input[ 6 ] << 16 ) | ( (unsigned int)input[ 7 ] << 24 );
+
+    for ( int i = 0; i < 16; ++i )
+        std::copy( palette[ ( packedIndices >> ( 2 * i ) ) & 3 ], palette[ ( packedIndices >> ( 2 * i ) ) & 3 ] + 4, block[ i ] );
+}
+
+void BlockCompression::decodeBlockBC4( const unsigned char* input, const int channel, unsigned char block[ 16 ][ 4 ] )
+{
+    unsigned char palette[ 8 ];
+    getPaletteBC4( input[ 0 ], input[ 1 ], palette );
+
+    unsigned long long packedIndices = 0;
+    for ( int i = 0; i < 6; ++i )
+        packedIndices |= (unsigned long long)input[ 2 + i ] << ( 8 * i );
+
+    for ( int i = 0; i < 16; ++i )
+        block[ i ][ channel ] = palette[ ( packedIndices >> ( 3 * i ) ) & 7 ];
+}
+
+void BlockCompression::decodeBlockBC7( const unsigned char* input, unsigned char block[ 16 ][ 4 ] )
+{
+    BitReader reader( input );
+
+    if ( reader.read( 7 ) != ( 1 << 6 ) )
+        throw std::exception( "BlockCompression::decodeBlockBC7 - only mode 6 blocks are supported." );
+
+    unsigned char endpoint0[ 4 ], endpoint1[ 4 ];
+    for ( int c = 0; c < 4; ++c ) {
+        endpoint0[ c ] = (unsigned char)reader.read( 7 );
+        endpoint1[ c ] = (unsigned char)reader.read( 7 );
+    }
+
+    const int pBit0 = reader.read( 1 );
+    const int pBit1 = reader.read( 1 );
+
+    for ( int c = 0; c < 4; ++c ) {
+        endpoint0[ c ] = (unsigned char)( endpoint0[ c ] * 2 + pBit0 );
+        endpoint1[ c ] = (unsigned char)( endpoint1[ c ] * 2 + pBit1 );
+    }
+
+    unsigned char palette[ 16 ][ 4 ];
+    getPaletteBC7( endpoint0, endpoint1, palette );
+
+    for ( int i = 0; i < 16; ++i ) {
+        const int index = reader.read( i == 0 ? 3 : 4 );
+        std::copy( palette[ index ], palette[ index ] + 4, block[ i ] );
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+#include <string>
+
+namespace Engine1
+{
+    class uchar4;
+
+    // CPU encoder/decoder of block-compressed (BCn) texture data. Each 4x4 pixel block is encoded independently,
+    // so rows of blocks are encoded in parallel on the JobSystem.
+    // Pixels are expected in RGBA order (x - red, y - green, z - blue, w - alpha).
+    // Edge blocks of textures with dimensions not divisible by 4 are padded by repeating the last row/column.
+    class BlockCompression
+    {
+        public:
+
+        enum class Format : char
+        {
+            BC1 = 0, // RGB, 4 bits per pixel.
+            BC3,     // RGBA (BC1 color + BC4 alpha), 8 bits per pixel.
+            BC4,     // Single channel (red), 4 bits per pixel.
+            BC5,     // Two channels (red, green), 8 bits per pixel - used for tangent-space normals.
+            BC7      // RGBA, 8 bits per pixel - best quality. Only mode 6 (single subset, RGBA endpoints) is used.
+        };
+
+        static std::string formatToString( const Format format );
+
+        static int getBlockSize( const Format format ); // In bytes.
+        static int getBlockCount( const int width, const int height );
+        static int getEncodedSize( const Format format, const int width, const int height ); // In bytes.
+
+        // For BC4 only the red channel is encoded, for BC5 red and green channels.
+        static std::vector< unsigned char > encode( const uchar4* pixels, const int width, const int height, const Format format );
+        static std::vector< unsigned char > encode( const unsigned char* pixels, const int width, const int height ); // BC4.
+
+        // Missing channels are decoded as: green = 0, blue = 0, alpha = 255 (BC4 and BC5), alpha = 255 (BC1).
+        static void decode( const unsigned char* blocks, const int width, const int height, const Format format, uchar4* pixels );
+        static void decode( const unsigned char* blocks, const int width, const int height, unsigned char* pixels ); // BC4.
+
+        // Peak signal-to-noise ratio (in dB) over the first channelCount channels. Returns infinity for identical images.
+        static float calculatePsnr( const uchar4* pixels1, const uchar4* pixels2, const int pixelCount, const int channelCount );
+        static float calculatePsnr( const unsigned char* pixels1, const unsigned char* pixels2, const int pixelCount );
+
+        private:
+
+        static void encodeBlockBC1( const unsigned char block[ 16 ][ 4 ], unsigned char* output );
+        static void encodeBlockBC4( const unsigned char block[ 16 ][ 4 ], const int channel, unsigned char* output );
+        static void encodeBlockBC7( const unsigned char block[ 16 ][ 4 ], unsigned char* output );
+
+        static void decodeBlockBC1( const unsigned char* input, const bool forceFourColors, unsigned char block[ 16 ][ 4 ] );
+        static void decodeBlockBC4( const unsigned char* input, const int channel, unsigned char block[ 16 ][ 4 ] );
+        static void decodeBlockBC7( const unsigned char* input, unsigned char block[ 16 ][ 4 ] );
+    };
+}
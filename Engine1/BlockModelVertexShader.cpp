@@ -2,6 +2,7 @@
 
 #include "StringUtil.h"
 
+#include <cstddef>
 #include <d3d11_3.h>
 #include <d3dcompiler.h>
 
@@ -9,7 +10,9 @@ using namespace Engine1;
 
 using Microsoft::WRL::ComPtr;
 
-BlockModelVertexShader::BlockModelVertexShader() {}
+BlockModelVertexShader::BlockModelVertexShader() :
+	m_isPartialUpdateSupported( false )
+{}
 
 BlockModelVertexShader::~BlockModelVertexShader() {}
 
@@ -57,37 +60,55 @@ void BlockModelVertexShader::initialize( ComPtr< ID3D11Device3 >& device )
 	}
 
 	{
-		// Create constant buffer.
+		// Create constant buffer - updated (instead of mapped) to write only the matrices used by a draw.
 		D3D11_BUFFER_DESC desc;
-		desc.Usage               = D3D11_USAGE_DYNAMIC;
+		desc.Usage               = D3D11_USAGE_DEFAULT;
 		desc.ByteWidth           = sizeof( ConstantBuffer );
 		desc.BindFlags           = D3D11_BIND_CONSTANT_BUFFER;
-		desc.CPUAccessFlags      = D3D11_CPU_ACCESS_WRITE;
+		desc.CPUAccessFlags      = 0;
 		desc.MiscFlags           = 0;
 		desc.StructureByteStride = 0;
 
 		HRESULT result = device->CreateBuffer( &desc, nullptr, m_constantInputBuffer.ReleaseAndGetAddressOf() );
 		if ( result < 0 ) throw std::exception( "BlockMeshVertexShader::compileFromFile - creating constant buffer failed" );
 	}
+
+	{
+		D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+		HRESULT result = device->CheckFeatureSupport( D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof( options ) );
+
+		m_isPartialUpdateSupported = result >= 0 && options.ConstantBufferPartialUpdate;
+	}
 }
 
 void BlockModelVertexShader::setParameters( ID3D11DeviceContext3& deviceContext, const float43& worldMatrix, const float44& viewMatrix, const float44& projectionMatrix ) {
+	setParameters( deviceContext, &worldMatrix, 1, viewMatrix, projectionMatrix );
+}
+
+void BlockModelVertexShader::setParameters( ID3D11DeviceContext3& deviceContext, const float43* worldMatrices, const int instanceCount, const float44& viewMatrix, const float44& projectionMatrix ) {
 	if ( !m_compiled ) throw std::exception( "BlockModelVertexShader::setParameters - Shader hasn't been compiled yet" );
+	if ( instanceCount < 1 || instanceCount > s_maxInstanceCount ) throw std::exception( "BlockModelVertexShader::setParameters - instance count out of range" );
 
-	D3D11_MAPPED_SUBRESOURCE mappedResource;
-	ConstantBuffer* dataPtr;
+	ConstantBuffer data;
 
-	HRESULT result = deviceContext.Map( m_constantInputBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource );
-	if ( result < 0 ) throw std::exception( "BlockModelVertexShader::setParameters - mapping constant buffer to CPU memory failed" );
+	// Transpose from row-major to column-major to fit each column in one register.
+	data.view       = viewMatrix.getTranspose();
+	data.projection = projectionMatrix.getTranspose();
 
-	dataPtr = (ConstantBuffer*)mappedResource.pData;
+	for ( int instanceIdx = 0; instanceIdx < instanceCount; ++instanceIdx )
+		data.world[ instanceIdx ] = float44( worldMatrices[ instanceIdx ] ).getTranspose();
 
-	// Transpose from row-major to column-major to fit each column in one register.
-	dataPtr->world = float44( worldMatrix ).getTranspose();
-	dataPtr->view = viewMatrix.getTranspose();
-	dataPtr->projection = projectionMatrix.getTranspose();
+	// Most draws are of a single model - only the matrices used by the draw are written (rest of the buffer is discarded).
+	if ( m_isPartialUpdateSupported )
+	{
+		const D3D11_BOX box = { 0, 0, 0, (UINT)( offsetof( ConstantBuffer, world ) + instanceCount * sizeof( float44 ) ), 1, 1 };
 
-	deviceContext.Unmap( m_constantInputBuffer.Get(), 0 );
+		deviceContext.UpdateSubresource1( m_constantInputBuffer.Get(), 0, &box, &data, 0, 0, D3D11_COPY_DISCARD );
+	}
+	else
+	{
+		deviceContext.UpdateSubresource( m_constantInputBuffer.Get(), 0, nullptr, &data, 0, 0 );
+	}
 
 	deviceContext.VSSetConstantBuffers( 0, 1, m_constantInputBuffer.GetAddressOf() );
 }
@@ -15,26 +15,37 @@ namespace Engine1
     {
 
         public:
+
+        // Max number of model copies drawn in a single instanced draw - same as MAX_INSTANCE_COUNT in the shader.
+        static const int s_maxInstanceCount = 64;
+
         BlockModelVertexShader();
         virtual ~BlockModelVertexShader();
 
         void initialize( Microsoft::WRL::ComPtr< ID3D11Device3 >& device );
         void setParameters( ID3D11DeviceContext3& deviceContext, const float43& worldMatrix, const float44& viewMatrix, const float44& projectionMatrix );
 
+        // World matrices of the instances - instance i of the next draw uses worldMatrices[ i ].
+        void setParameters( ID3D11DeviceContext3& deviceContext, const float43* worldMatrices, const int instanceCount, const float44& viewMatrix, const float44& projectionMatrix );
+
         ID3D11InputLayout& getInputLauout() const;
 
         private:
 
         Microsoft::WRL::ComPtr<ID3D11InputLayout> m_inputLayout;
 
+        // Only the part of the buffer used by a draw is updated - so world matrices come last.
         __declspec(align(DIRECTX_CONSTANT_BUFFER_ALIGNMENT))
         struct ConstantBuffer
         {
-            float44 world;
             float44 view;
             float44 projection;
+            float44 world[ s_maxInstanceCount ];
         };
 
+        // Whether the device can update a part of a constant buffer (otherwise whole buffer is updated).
+        bool m_isPartialUpdateSupported;
+
         // Copying is not allowed.
         BlockModelVertexShader( const BlockModelVertexShader& ) = delete;
         BlockModelVertexShader& operator=(const BlockModelVertexShader&) = delete;
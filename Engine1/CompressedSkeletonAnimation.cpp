@@ -0,0 +1,466 @@
+#include "CompressedSkeletonAnimation.h"
+
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <algorithm>
+
+#include "SkeletonAnimation.h"
+#include "SkeletonPose.h"
+
+using namespace Engine1;
+
+const float CompressedSkeletonAnimation::s_minQuantizedOrientationError = 0.0002f;
+
+namespace
+{
+    // Components other than the largest one are in range [ -1 / sqrt( 2 ), 1 / sqrt( 2 ) ].
+    const float smallestThreeRange = 0.70710678f;
+
+    const int maxOrientationValue = 0x7FFF;
+    const int maxVectorValue      = 0xFFFF;
+
+    float getOrientationError( const quat& q1, const quat& q2 )
+    {
+        const double dot = std::min( 1.0, std::abs( (double)q1.w * q2.w + (double)q1.x * q2.x + (double)q1.y * q2.y + (double)q1.z * q2.z ) );
+
+        return (float)( 2.0 * std::acos( dot ) );
+    }
+
+    float getVectorError( const float3& vec1, const float3& vec2 )
+    {
+        return std::max( std::abs( vec1.x - vec2.x ), std::max( std::abs( vec1.y - vec2.y ), std::abs( vec1.z - vec2.z ) ) );
+    }
+}
+
+float CompressedSkeletonAnimation::Statistics::getCompressionRatio() const
+{
+    return compressedSize > 0 ? (float)uncompressedSize / (float)compressedSize : 0.0f;
+}
+
+std::shared_ptr< CompressedSkeletonAnimation > CompressedSkeletonAnimation::compress( const SkeletonAnimation& animation, const Options& options, Statistics* statistics )
+{
+    const unsigned int keyframeCount = animation.getKeyframeCount();
+
+    if ( keyframeCount == 0 ) throw std::exception( "CompressedSkeletonAnimation::compress - animation has no keyframes." );
+    if ( keyframeCount > 0x10000 ) throw std::exception( "CompressedSkeletonAnimation::compress - animation has more than 65536 keyframes." );
+
+    std::shared_ptr< CompressedSkeletonAnimation > compressedAnimation( new CompressedSkeletonAnimation() );
+    compressedAnimation->m_keyframeCount = keyframeCount;
+
+    const SkeletonPose& firstPose = animation.getPose( 0 );
+    for ( int i = 0; i < (int)firstPose.getOrientations().size(); ++i ) {
+        if ( firstPose.hasBone( (unsigned char)( i + 1 ) ) )
+            compressedAnimation->m_boneIndices.push_back( (unsigned char)( i + 1 ) );
+    }
+
+    for ( unsigned int keyframe = 1; keyframe < keyframeCount; ++keyframe ) {
+        const SkeletonPose& pose = animation.getPose( keyframe );
+
+        if ( pose.getBonesCount() != firstPose.getBonesCount() ) throw std::exception( ( "CompressedSkeletonAnimation::compress - poses contain different bones (keyframe " + std::to_string( keyframe ) + ")." ).c_str() );
+
+        for ( const unsigned char boneIndex : compressedAnimation->m_boneIndices ) {
+            if ( !pose.hasBone( boneIndex ) ) throw std::exception( ( "CompressedSkeletonAnimation::compress - poses contain different bones (keyframe " + std::to_string( keyframe ) + ")." ).c_str() );
+        }
+    }
+
+    // Compress each track separately.
+    std::vector< quat >   orientations( keyframeCount );
+    std::vector< float3 > translations( keyframeCount ), scales( keyframeCount );
+    for ( const unsigned char boneIndex : compressedAnimation->m_boneIndices ) {
+        for ( unsigned int keyframe = 0; keyframe < keyframeCount; ++keyframe ) {
+            const SkeletonPose& pose = animation.getPose( keyframe );
+
+            orientations[ keyframe ] = pose.getOrientations()[ boneIndex - 1 ];
+            translations[ keyframe ] = pose.getTranslations()[ boneIndex - 1 ];
+            scales[ keyframe ]       = pose.getScales()[ boneIndex - 1 ];
+        }
+
+        compressedAnimation->addOrientationTrack( orientations, options.maxOrientationError );
+        compressedAnimation->addVectorTrack( translations, options.maxTranslationError );
+        compressedAnimation->addVectorTrack( scales, options.maxScaleError );
+    }
+
+    if ( statistics ) {
+        const long long boneCount = (long long)compressedAnimation->m_boneIndices.size();
+
+        statistics->uncompressedSize   = (long long)keyframeCount * boneCount * (long long)( sizeof( quat ) + 2 * sizeof( float3 ) );
+        statistics->compressedSize     = compressedAnimation->getSize();
+        statistics->trackCount         = (int)compressedAnimation->m_tracks.size();
+        statistics->constantTrackCount = (int)std::count_if( compressedAnimation->m_tracks.begin(), compressedAnimation->m_tracks.end(), []( const Track& track ) { return track.keyCount == 1; } );
+        statistics->keyCount           = (int)compressedAnimation->m_keyFrames.size();
+        statistics->originalKeyCount   = (int)keyframeCount * statistics->trackCount;
+
+        statistics->maxOrientationError = 0.0f;
+        statistics->maxTranslationError = 0.0f;
+        statistics->maxScaleError       = 0.0f;
+
+        for ( unsigned int keyframe = 0; keyframe < keyframeCount; ++keyframe ) {
+            const SkeletonPose& pose = animation.getPose( keyframe );
+
+            for ( int boneIndexIndex = 0; boneIndexIndex < (int)boneCount; ++boneIndexIndex ) {
+                const int    i      = compressedAnimation->m_boneIndices[ boneIndexIndex ] - 1;
+                const Track* tracks = &compressedAnimation->m_tracks[ boneIndexIndex * s_trackCountPerBone ];
+                const float  frame  = (float)keyframe;
+
+                statistics->maxOrientationError = std::max( statistics->maxOrientationError, getOrientationError( compressedAnimation->sampleOrientation( tracks[ 0 ], frame ), pose.getOrientations()[ i ] ) );
+                statistics->maxTranslationError = std::max( statistics->maxTranslationError, getVectorError( compressedAnimation->sampleVector( tracks[ 1 ], frame ), pose.getTranslations()[ i ] ) );
+                statistics->maxScaleError       = std::max( statistics->maxScaleError, getVectorError( compressedAnimation->sampleVector( tracks[ 2 ], frame ), pose.getScales()[ i ] ) );
+            }
+        }
+    }
+
+    return compressedAnimation;
+}
+
+CompressedSkeletonAnimation::CompressedSkeletonAnimation() :
+    m_keyframeCount( 0 )
+{}
+
+void CompressedSkeletonAnimation::samplePose( const float progress, SkeletonPose& pose ) const
+{
+    const float frame = std::min( std::max( progress, 0.0f ), 1.0f ) * (float)( m_keyframeCount - 1 );
+
+    pose.clear();
+
+    for ( int boneIndexIndex = 0; boneIndexIndex < (int)m_boneIndices.size(); ++boneIndexIndex ) {
+        const Track* tracks = &m_tracks[ boneIndexIndex * s_trackCountPerBone ];
+
+        pose.setBonePose( m_boneIndices[ boneIndexIndex ], sampleOrientation( tracks[ 0 ], frame ), sampleVector( tracks[ 1 ], frame ), sampleVector( tracks[ 2 ], frame ) );
+    }
+}
+
+SkeletonPose CompressedSkeletonAnimation::samplePose( const float progress ) const
+{
+    SkeletonPose pose;
+    samplePose( progress, pose );
+
+    return pose;
+}
+
+void CompressedSkeletonAnimation::samplePose( const float progress, quat* orientations, float3* translations, float3* scales, const int boneCount ) const
+{
+    const float frame = std::min( std::max( progress, 0.0f ), 1.0f ) * (float)( m_keyframeCount - 1 );
+
+    std::fill( orientations, orientations + boneCount, quat( 1.0f, 0.0f, 0.0f, 0.0f ) );
+    std::fill( translations, translations + boneCount, float3::ZERO );
+    std::fill( scales, scales + boneCount, float3::ONE );
+
+    for ( int boneIndexIndex = 0; boneIndexIndex < (int)m_boneIndices.size(); ++boneIndexIndex ) {
+        const int i = m_boneIndices[ boneIndexIndex ] - 1;
+        if ( i >= boneCount )
+            continue;
+
+        const Track* tracks = &m_tracks[ boneIndexIndex * s_trackCountPerBone ];
+
+        orientations[ i ] = sampleOrientation( tracks[ 0 ], frame );
+        translations[ i ] = sampleVector( tracks[ 1 ], frame );
+        scales[ i ]       = sampleVector( tracks[ 2 ], frame );
+    }
+}
+
+unsigned int CompressedSkeletonAnimation::getKeyframeCount() const
+{
+    return m_keyframeCount;
+}
+
+long long CompressedSkeletonAnimation::getSize() const
+{
+    return (long long)( m_boneIndices.size() * sizeof( unsigned char )
+        + m_tracks.size() * sizeof( Track )
+        + m_keyFrames.size() * sizeof( unsigned short )
+        + m_keyValues.size() * sizeof( unsigned short ) );
+}
+
+void CompressedSkeletonAnimation::quantize( const quat& orientation, unsigned short* values )
+{
+    quat normalizedOrientation = orientation;
+    normalizedOrientation.normalize();
+
+    const float components[ 4 ] = { normalizedOrientation.w, normalizedOrientation.x, normalizedOrientation.y, normalizedOrientation.z };
+
+    int largestIndex = 0;
+    for ( int i = 1; i < 4; ++i ) {
+        if ( std::abs( components[ i ] ) > std::abs( components[ largestIndex ] ) )
+            largestIndex = i;
+    }
+
+    // Store the remaining components with the largest one being positive (q and -q are the same rotation).
+    const float sign = components[ largestIndex ] < 0.0f ? -1.0f : 1.0f;
+
+    int valueIndex = 0;
+    for ( int i = 0; i < 4; ++i ) {
+        if ( i == largestIndex )
+            continue;
+
+        const float normalized = ( components[ i ] * sign / smallestThreeRange ) * 0.5f + 0.5f;
+        values[ valueIndex++ ] = (unsigned short)std::min( std::max( (int)std::lround( normalized * maxOrientationValue ), 0 ), maxOrientationValue );
+    }
+
+    // Index of the largest component is stored in the highest bits of the first two values.
+    values[ 0 ] |= (unsigned short)( ( largestIndex & 1 ) << 15 );
+    values[ 1 ] |= (unsigned short)( ( largestIndex >> 1 ) << 15 );
+}
+
+quat CompressedSkeletonAnimation::dequantize( const unsigned short* values )
+{
+    const int largestIndex = ( values[ 0 ] >> 15 ) | ( ( values[ 1 ] >> 15 ) << 1 );
+
+    float components[ 4 ];
+    float sumOfSquares = 0.0f;
+    int   valueIndex   = 0;
+    for ( int i = 0; i < 4; ++i ) {
+        if ( i == largestIndex )
+            continue;
+
+        const float normalized = (float)( values[ valueIndex++ ] & maxOrientationValue ) / (float)maxOrientationValue;
+
+        components[ i ] = ( normalized * 2.0f - 1.0f ) * smallestThreeRange;
+        sumOfSquares   += components[ i ] * components[ i ];
+    }
+
+    components[ largestIndex ] = std::sqrt( std::max( 0.0f, 1.0f - sumOfSquares ) );
+
+    return quat( components[ 0 ], components[ 1 ], components[ 2 ], components[ 3 ] );
+}
+
+void CompressedSkeletonAnimation::quantize( const float3& vec, const float3& rangeMin, const float3& rangeExtent, unsigned short* values )
+{
+    const float3 offset = vec - rangeMin;
+
+    values[ 0 ] = (unsigned short)( rangeExtent.x > 0.0f ? std::min( std::max( (int)std::lround( offset.x / rangeExtent.x * maxVectorValue ), 0 ), maxVectorValue ) : 0 );
+    values[ 1 ] = (unsigned short)( rangeExtent.y > 0.0f ? std::min( std::max( (int)std::lround( offset.y / rangeExtent.y * maxVectorValue ), 0 ), maxVectorValue ) : 0 );
+    values[ 2 ] = (unsigned short)( rangeExtent.z > 0.0f ? std::min( std::max( (int)std::lround( offset.z / rangeExtent.z * maxVectorValue ), 0 ), maxVectorValue ) : 0 );
+}
+
+float3 CompressedSkeletonAnimation::dequantize( const unsigned short* values, const float3& rangeMin, const float3& rangeExtent )
+{
+    return float3(
+        rangeMin.x + rangeExtent.x * ( (float)values[ 0 ] / (float)maxVectorValue ),
+        rangeMin.y + rangeExtent.y * ( (float)values[ 1 ] / (float)maxVectorValue ),
+        rangeMin.z + rangeExtent.z * ( (float)values[ 2 ] / (float)maxVectorValue )
+    );
+}
+
+quat CompressedSkeletonAnimation::interpolate( const quat& from, const quat& to, const float factor )
+{
+    // Normalized linear interpolation along the shorter arc - keys are dense enough for nlerp to follow slerp closely.
+    const float toFactor = quat::dot( from, to ) < 0.0f ? -factor : factor;
+    const float fromFactor = 1.0f - factor;
+
+    quat result(
+        from.w * fromFactor + to.w * toFactor,
+        from.x * fromFactor + to.x * toFactor,
+        from.y * fromFactor + to.y * toFactor,
+        from.z * fromFactor + to.z * toFactor
+    );
+
+    result.normalize();
+
+    return result;
+}
+
+float3 CompressedSkeletonAnimation::interpolate( const float3& from, const float3& to, const float factor )
+{
+    return from + ( to - from ) * factor;
+}
+
+void CompressedSkeletonAnimation::addOrientationTrack( const std::vector< quat >& samples, const float maxError )
+{
+    const int    sampleCount = (int)samples.size();
+    const double minDot      = std::cos( (double)maxError * 0.5 );
+
+    Track track;
+    track.firstKey         = (int)m_keyFrames.size();
+    track.firstValue       = (int)m_keyValues.size();
+    track.rangeMin         = float3::ZERO;
+    track.rangeExtent      = float3::ZERO;
+    track.valueCountPerKey = maxError >= s_minQuantizedOrientationError ? 3 : (int)( sizeof( quat ) / sizeof( unsigned short ) );
+
+    // Encode all the samples first - keys are selected based on the values which are going to be decoded.
+    std::vector< unsigned short > encodedValues( sampleCount * track.valueCountPerKey );
+    std::vector< quat >           decodedSamples( sampleCount );
+    for ( int i = 0; i < sampleCount; ++i ) {
+        unsigned short* values = &encodedValues[ i * track.valueCountPerKey ];
+
+        if ( track.valueCountPerKey == 3 )
+            quantize( samples[ i ], values );
+        else
+            std::memcpy( values, &samples[ i ], sizeof( quat ) );
+
+        decodedSamples[ i ] = decodeOrientation( track, values );
+    }
+
+    const auto isWithinError = [ & ]( const quat& orientation, const int sampleIndex )
+    {
+        const quat& sample = samples[ sampleIndex ];
+        return std::abs( (double)orientation.w * sample.w + (double)orientation.x * sample.x + (double)orientation.y * sample.y + (double)orientation.z * sample.z ) >= minDot;
+    };
+
+    // Checks if all the samples between the keys can be interpolated from the keys.
+    const auto canInterpolate = [ & ]( const int firstKey, const int lastKey )
+    {
+        for ( int i = firstKey + 1; i < lastKey; ++i ) {
+            if ( !isWithinError( interpolate( decodedSamples[ firstKey ], decodedSamples[ lastKey ], (float)( i - firstKey ) / (float)( lastKey - firstKey ) ), i ) )
+                return false;
+        }
+        return true;
+    };
+
+    // Constant track - the first key represents all the samples.
+    bool isConstant = true;
+    for ( int i = 1; i < sampleCount && isConstant; ++i )
+        isConstant = isWithinError( decodedSamples[ 0 ], i );
+
+    addKeys( track, encodedValues, isConstant ? std::function< bool( int, int ) >() : canInterpolate );
+}
+
+void CompressedSkeletonAnimation::addVectorTrack( const std::vector< float3 >& samples, const float maxError )
+{
+    const int sampleCount = (int)samples.size();
+
+    Track track;
+    track.firstKey   = (int)m_keyFrames.size();
+    track.firstValue = (int)m_keyValues.size();
+
+    float3 rangeMax = samples[ 0 ];
+    track.rangeMin  = samples[ 0 ];
+    for ( const float3& sample : samples ) {
+        track.rangeMin = float3( std::min( track.rangeMin.x, sample.x ), std::min( track.rangeMin.y, sample.y ), std::min( track.rangeMin.z, sample.z ) );
+        rangeMax       = float3( std::max( rangeMax.x, sample.x ), std::max( rangeMax.y, sample.y ), std::max( rangeMax.z, sample.z ) );
+    }
+    track.rangeExtent = rangeMax - track.rangeMin;
+
+    const float maxExtent = std::max( track.rangeExtent.x, std::max( track.rangeExtent.y, track.rangeExtent.z ) );
+
+    if ( maxExtent <= maxError ) {
+        // Constant track - store the center of the range, error is at most half of the extent.
+        track.rangeMin         = track.rangeMin + track.rangeExtent * 0.5f;
+        track.rangeExtent      = float3::ZERO;
+        track.valueCountPerKey = 3;
+
+        addKeys( track, std::vector< unsigned short >( 3, 0 ), std::function< bool( int, int ) >() );
+        return;
+    }
+
+    // Quantize only if the quantization step leaves at least half of the allowed error for the key reduction.
+    track.valueCountPerKey = maxExtent / maxVectorValue <= maxError ? 3 : (int)( sizeof( float3 ) / sizeof( unsigned short ) );
+
+    std::vector< unsigned short > encodedValues( sampleCount * track.valueCountPerKey );
+    std::vector< float3 >         decodedSamples( sampleCount );
+    for ( int i = 0; i < sampleCount; ++i ) {
+        unsigned short* values = &encodedValues[ i * track.valueCountPerKey ];
+
+        if ( track.valueCountPerKey == 3 )
+            quantize( samples[ i ], track.rangeMin, track.rangeExtent, values );
+        else
+            std::memcpy( values, &samples[ i ], sizeof( float3 ) );
+
+        decodedSamples[ i ] = decodeVector( track, values );
+    }
+
+    const auto canInterpolate = [ & ]( const int firstKey, const int lastKey )
+    {
+        for ( int i = firstKey + 1; i < lastKey; ++i ) {
+            if ( getVectorError( interpolate( decodedSamples[ firstKey ], decodedSamples[ lastKey ], (float)( i - firstKey ) / (float)( lastKey - firstKey ) ), samples[ i ] ) > maxError )
+                return false;
+        }
+        return true;
+    };
+
+    addKeys( track, encodedValues, canInterpolate );
+}
+
+void CompressedSkeletonAnimation::addKeys( Track& track, const std::vector< unsigned short >& encodedValues, const std::function< bool( int, int ) >& canInterpolate )
+{
+    const int sampleCount = (int)encodedValues.size() / track.valueCountPerKey;
+
+    const auto addKey = [ & ]( const int sampleIndex )
+    {
+        const unsigned short* values = &encodedValues[ sampleIndex * track.valueCountPerKey ];
+
+        m_keyFrames.push_back( (unsigned short)sampleIndex );
+        m_keyValues.insert( m_keyValues.end(), values, values + track.valueCountPerKey );
+    };
+
+    addKey( 0 );
+
+    // Greedily extend each segment as long as the skipped samples can be interpolated.
+    if ( canInterpolate ) {
+        int key = 0;
+        while ( key < sampleCount - 1 ) {
+            int nextKey = key + 1;
+            while ( nextKey + 1 < sampleCount && canInterpolate( key, nextKey + 1 ) )
+                ++nextKey;
+
+            addKey( nextKey );
+            key = nextKey;
+        }
+    }
+
+    track.keyCount = (int)m_keyFrames.size() - track.firstKey;
+    m_tracks.push_back( track );
+}
+
+quat CompressedSkeletonAnimation::decodeOrientation( const Track& track, const unsigned short* values )
+{
+    if ( track.valueCountPerKey == 3 )
+        return dequantize( values );
+
+    quat orientation;
+    std::memcpy( &orientation, values, sizeof( quat ) );
+
+    return orientation;
+}
+
+float3 CompressedSkeletonAnimation::decodeVector( const Track& track, const unsigned short* values )
+{
+    if ( track.valueCountPerKey == 3 )
+        return dequantize( values, track.rangeMin, track.rangeExtent );
+
+    float3 vec;
+    std::memcpy( &vec, values, sizeof( float3 ) );
+
+    return vec;
+}
+
+int CompressedSkeletonAnimation::findKey( const Track& track, const float frame ) const
+{
+    const unsigned short* first = &m_keyFrames[ track.firstKey ];
+    const unsigned short* last  = first + track.keyCount;
+
+    // First key after the frame, minus one.
+    const unsigned short* next = std::upper_bound( first, last, (unsigned short)frame );
+
+    return std::max( 0, (int)( next - first ) - 1 );
+}
+
+quat CompressedSkeletonAnimation::sampleOrientation( const Track& track, const float frame ) const
+{
+    const int key = findKey( track, frame );
+
+    const unsigned short* values      = &m_keyValues[ track.firstValue + key * track.valueCountPerKey ];
+    const quat            orientation = decodeOrientation( track, values );
+    if ( key + 1 >= track.keyCount )
+        return orientation;
+
+    const float keyFrame     = (float)m_keyFrames[ track.firstKey + key ];
+    const float nextKeyFrame = (float)m_keyFrames[ track.firstKey + key + 1 ];
+
+    return interpolate( orientation, decodeOrientation( track, values + track.valueCountPerKey ), ( frame - keyFrame ) / ( nextKeyFrame - keyFrame ) );
+}
+
+float3 CompressedSkeletonAnimation::sampleVector( const Track& track, const float frame ) const
+{
+    const int key = findKey( track, frame );
+
+    const unsigned short* values = &m_keyValues[ track.firstValue + key * track.valueCountPerKey ];
+    const float3          vec    = decodeVector( track, values );
+    if ( key + 1 >= track.keyCount )
+        return vec;
+
+    const float keyFrame     = (float)m_keyFrames[ track.firstKey + key ];
+    const float nextKeyFrame = (float)m_keyFrames[ track.firstKey + key + 1 ];
+
+    return interpolate( vec, decodeVector( track, values + track.valueCountPerKey ), ( frame - keyFrame ) / ( nextKeyFrame - keyFrame ) );
+}
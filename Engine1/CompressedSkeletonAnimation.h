@@ -0,0 +1,128 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <functional>
+
+#include "float3.h"
+#include "quat.h"
+
+namespace Engine1
+{
+    class SkeletonAnimation;
+    class SkeletonPose;
+
+    // Skeleton animation stored as separate orientation, translation and scale tracks for each bone.
+    // Keyframes which can be interpolated from their neighbors (within the allowed error) are removed from each track,
+    // tracks which don't change become single-key tracks. Orientations are quantized to 48 bits ("smallest three" components),
+    // translations and scales to 16 bits per component within the range of the track.
+    // Sampling decodes only the two keys around the sampled time for each track.
+    class CompressedSkeletonAnimation
+    {
+        public:
+
+        struct Options
+        {
+            Options( const float maxOrientationError = 0.001f, const float maxTranslationError = 0.001f, const float maxScaleError = 0.001f ) :
+                maxOrientationError( maxOrientationError ),
+                maxTranslationError( maxTranslationError ),
+                maxScaleError( maxScaleError )
+            {}
+
+            float maxOrientationError; // In radians.
+            float maxTranslationError; // In mesh units.
+            float maxScaleError;
+        };
+
+        struct Statistics
+        {
+            long long uncompressedSize; // Size of the keyframe poses (in bytes).
+            long long compressedSize;
+
+            int trackCount;
+            int constantTrackCount;
+            int keyCount;          // Keys left in all the tracks.
+            int originalKeyCount;  // Keyframe count multiplied by the track count.
+
+            // Measured at the original keyframes.
+            float maxOrientationError;
+            float maxTranslationError;
+            float maxScaleError;
+
+            float getCompressionRatio() const;
+        };
+
+        // All the poses of the animation have to contain the same bones. The animation has to have at least one keyframe.
+        static std::shared_ptr< CompressedSkeletonAnimation > compress( const SkeletonAnimation& animation, const Options& options = Options(), Statistics* statistics = nullptr );
+
+        // Progress is in range 0 - 1, same as in SkeletonAnimation::getInterpolatedPose.
+        void         samplePose( const float progress, SkeletonPose& pose ) const;
+        SkeletonPose samplePose( const float progress ) const;
+
+        // Samples the pose into dense arrays (indexed by boneIndex - 1, boneCount elements each) without allocating memory.
+        // Bones which are not in the animation (or don't fit in the arrays) get identity poses.
+        void samplePose( const float progress, quat* orientations, float3* translations, float3* scales, const int boneCount ) const;
+
+        unsigned int getKeyframeCount() const;
+
+        // Size of the compressed data (in bytes).
+        long long getSize() const;
+
+        private:
+
+        static const int s_trackCountPerBone = 3;
+
+        // Orientation tracks with lower allowed error are stored without quantization.
+        static const float s_minQuantizedOrientationError;
+
+        struct Track
+        {
+            int    firstKey;
+            int    keyCount;
+            int    firstValue;
+            int    valueCountPerKey; // 3 for quantized keys. Tracks which can't be quantized within the allowed error store raw floats.
+            float3 rangeMin;         // Used to dequantize translation and scale keys.
+            float3 rangeExtent;
+        };
+
+        static void quantize( const quat& orientation, unsigned short* values );
+        static quat dequantize( const unsigned short* values );
+
+        static void   quantize( const float3& vec, const float3& rangeMin, const float3& rangeExtent, unsigned short* values );
+        static float3 dequantize( const unsigned short* values, const float3& rangeMin, const float3& rangeExtent );
+
+        static quat   interpolate( const quat& from, const quat& to, const float factor );
+        static float3 interpolate( const float3& from, const float3& to, const float factor );
+
+        // Adds the track with only the keys needed to reconstruct all the samples within the allowed error.
+        void addOrientationTrack( const std::vector< quat >& samples, const float maxError );
+        void addVectorTrack( const std::vector< float3 >& samples, const float maxError );
+
+        // Adds the track with the first key and the keys selected by extending the interpolated segments as long as canInterpolate( firstKey, lastKey ) allows.
+        // Only the first key is added if canInterpolate is empty (constant track).
+        void addKeys( Track& track, const std::vector< unsigned short >& encodedValues, const std::function< bool( int, int ) >& canInterpolate );
+
+        static quat   decodeOrientation( const Track& track, const unsigned short* values );
+        static float3 decodeVector( const Track& track, const unsigned short* values );
+
+        // Returns the index of the last key at or before the frame.
+        int findKey( const Track& track, const float frame ) const;
+
+        quat   sampleOrientation( const Track& track, const float frame ) const;
+        float3 sampleVector( const Track& track, const float frame ) const;
+
+        CompressedSkeletonAnimation();
+
+        unsigned int m_keyframeCount;
+
+        // Bones present in the animation.
+        std::vector< unsigned char > m_boneIndices;
+
+        // Orientation, translation and scale track for each bone.
+        std::vector< Track > m_tracks;
+
+        // Keys of all the tracks - frame of each key and its encoded values.
+        std::vector< unsigned short > m_keyFrames;
+        std::vector< unsigned short > m_keyValues;
+    };
+}
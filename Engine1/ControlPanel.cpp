@@ -47,6 +47,7 @@ void ControlPanel::initialize( Microsoft::WRL::ComPtr< ID3D11Device3 >& device,
     TwAddVarRW( m_mainBar, "Reflections", TW_TYPE_BOOL8, &Settings::s_settings.rendering.reflectionsRefractions.reflectionsEnabled, "" );
     TwAddVarRW( m_mainBar, "Refractions", TW_TYPE_BOOL8, &Settings::s_settings.rendering.reflectionsRefractions.refractionsEnabled, "" );
     TwAddVarRW( m_mainBar, "Shadows", TW_TYPE_BOOL8, &Settings::s_settings.rendering.shadows.enabled, "" );
+    TwAddVarRW( m_mainBar, "Pipelined frame update", TW_TYPE_BOOL8, &Settings::s_settings.main.pipelinedFrameUpdate, "" );
 
     TwAddButton( m_mainBar, "Reset camera", ControlPanel::onResetCamera, this, "" );
 
@@ -99,6 +100,11 @@ void ControlPanel::initialize( Microsoft::WRL::ComPtr< ID3D11Device3 >& device,
     TwAddVarRW( m_reflectionRefractionBar, "Reflection radial blur", TW_TYPE_BOOL8, &Settings::s_settings.rendering.reflectionsRefractions.radialBlurEnabled, "" );
     TwAddVarRW( m_reflectionRefractionBar, "Debug hit-dist power", TW_TYPE_FLOAT, &Settings::s_settings.rendering.reflectionsRefractions.debugHitDistPower, "min=0.01 max=2.0 step=0.01 precision=2" );
 
+    TwAddButton( m_reflectionRefractionBar, "", nullptr, nullptr, " label='Pruning' ");
+    TwAddVarRW( m_reflectionRefractionBar, "Pruning enabled", TW_TYPE_BOOL8, &Settings::s_settings.rendering.reflectionsRefractions.pruning.enabled, "" );
+    TwAddVarRW( m_reflectionRefractionBar, "Pruning contribution threshold", TW_TYPE_FLOAT, &Settings::s_settings.rendering.reflectionsRefractions.pruning.contributionThreshold, "min=0 max=1 step=0.001 precision=3" );
+    TwAddVarRW( m_reflectionRefractionBar, "Pruning readback mipmap", TW_TYPE_INT32, &Settings::s_settings.rendering.reflectionsRefractions.pruning.readbackMipmapLevel, "min=0 max=10" );
+
     TwAddButton( m_reflectionRefractionBar, "", nullptr, nullptr, " label='Hit-dist search' ");
     TwAddVarRW( m_reflectionRefractionBar, "Decrease blur for small values", TW_TYPE_BOOL8, &Settings::s_settings.rendering.hitDistanceSearch.decreaseBlurForSmallValues, "" );
     TwAddVarRW( m_reflectionRefractionBar, "Field of view", TW_TYPE_FLOAT, &Settings::s_settings.rendering.hitDistanceSearch.maxHitDistForDecreasedBlur, "min=0 max=1 step=0.01 precision=2" );
@@ -177,7 +183,11 @@ void ControlPanel::initialize( Microsoft::WRL::ComPtr< ID3D11Device3 >& device,
     TwDefine(" Optimization iconified=true ");
     TwAddVarRW( m_optimizationBar, "Use separable shadow pattern blur", TW_TYPE_BOOL8, &Settings::s_settings.rendering.shadows.useSeparableShadowPatternBlur, "" );
     TwAddVarRW( m_optimizationBar, "Use separable shadow blur", TW_TYPE_BOOL8, &Settings::s_settings.rendering.shadows.useSeparableShadowBlur, "" );
+    TwAddVarRW( m_optimizationBar, "Max shadowed light count", TW_TYPE_INT32, &Settings::s_settings.rendering.shadows.maxShadowedLightCount, "min=0 max=16" );
     TwAddVarRW( m_optimizationBar, "Combining sampling quality", TW_TYPE_FLOAT, &Settings::s_settings.rendering.reflectionsRefractions.samplingQuality, "min=0 max=1 step=0.002 precision=3" );
+    TwAddVarRW( m_optimizationBar, "Frustum culling", TW_TYPE_BOOL8, &Settings::s_settings.rendering.culling.frustumCulling, "" );
+    TwAddVarRW( m_optimizationBar, "Occlusion culling", TW_TYPE_BOOL8, &Settings::s_settings.rendering.culling.occlusionCulling, "" );
+    TwAddVarRW( m_optimizationBar, "Max occluder count", TW_TYPE_INT32, &Settings::s_settings.rendering.culling.maxOccluderCount, "min=0 max=64" );
     TwAddVarRW( m_optimizationBar, "Use half normals", TW_TYPE_BOOL8, &Settings::s_settings.rendering.optimization.useHalfFloatsForNormals, "" );
     TwAddVarRW( m_optimizationBar, "Use half ray directions", TW_TYPE_BOOL8, &Settings::s_settings.rendering.optimization.useHalfFloatsForRayDirections, "" );
     TwAddVarRW( m_optimizationBar, "Use half hit-distance", TW_TYPE_BOOL8, &Settings::s_settings.rendering.optimization.useHalfFloatsForHitDistance, "" );
@@ -14,6 +14,7 @@
 #include "Font.h"
 #include "Settings.h"
 
+#include <algorithm>
 #include <d3d11_3.h>
 
 using namespace Engine1;
@@ -185,19 +186,22 @@ void DX11DeferredRenderer::render(
     const float43& worldMatrix, 
     const float44& viewMatrix, 
     const float4& extraEmissive )
+{
+    bindModel( deferredRenderTargets, renderSettings, model, extraEmissive );
+    renderInstances( renderSettings, model, &worldMatrix, 1, viewMatrix );
+}
+
+void DX11DeferredRenderer::bindModel( 
+    const DeferredRenderTargets& deferredRenderTargets,
+    const Settings& renderSettings, 
+    const BlockModel& model, 
+    const float4& extraEmissive )
 {
 	if ( !m_initialized ) 
-        throw std::exception( "Direct3DDeferredRenderer::render - renderer not initialized." );
+        throw std::exception( "Direct3DDeferredRenderer::bindModel - renderer not initialized." );
 
     if ( !model.getMesh( ) ) 
-        throw std::exception( "Direct3DDeferredRenderer::render - model has no mesh." );
-
-    const float44 projectionMatrix = MathUtil::perspectiveProjectionTransformation(
-        renderSettings.fieldOfView,
-        renderSettings.imageDimensions.x / renderSettings.imageDimensions.y,
-        renderSettings.zNear,
-        renderSettings.zFar
-    );
+        throw std::exception( "Direct3DDeferredRenderer::bindModel - model has no mesh." );
 
     m_rendererCore.setViewport( renderSettings.imageDimensions );
 
@@ -248,8 +252,6 @@ void DX11DeferredRenderer::render(
             ? *model.getRefractiveIndexTextures()[ 0 ].getTexture() 
             : *settings().textures.defaults.refractiveIndex;
 
-		m_blockModelVertexShader.setParameters( *m_deviceContext.Get( ), worldMatrix, viewMatrix, projectionMatrix );
-
 		m_blockModelFragmentShader.setParameters( 
             *m_deviceContext.Get( ), 
             alphaTexture, alphaMul,
@@ -268,9 +270,38 @@ void DX11DeferredRenderer::render(
 	m_rendererCore.enableRasterizerState( renderSettings.wireframeMode ? *m_wireframeRasterizerState.Get() : *m_rasterizerState.Get() );
 	m_rendererCore.enableDepthStencilState( *m_depthStencilState.Get() );
 	m_rendererCore.enableBlendState( *m_blendStateForMeshRendering.Get() );
+}
 
-	// Draw mesh.
-	m_rendererCore.draw( *model.getMesh().get() );
+void DX11DeferredRenderer::renderInstances( 
+    const Settings& renderSettings, 
+    const BlockModel& model, 
+    const float43* worldMatrices, 
+    const int instanceCount, 
+    const float44& viewMatrix )
+{
+	if ( !m_initialized ) 
+        throw std::exception( "Direct3DDeferredRenderer::renderInstances - renderer not initialized." );
+
+    if ( !model.getMesh( ) ) 
+        throw std::exception( "Direct3DDeferredRenderer::renderInstances - model has no mesh." );
+
+    const float44 projectionMatrix = MathUtil::perspectiveProjectionTransformation(
+        renderSettings.fieldOfView,
+        renderSettings.imageDimensions.x / renderSettings.imageDimensions.y,
+        renderSettings.zNear,
+        renderSettings.zFar
+    );
+
+    const int maxInstanceCount = BlockModelVertexShader::s_maxInstanceCount;
+
+    for ( int firstInstance = 0; firstInstance < instanceCount; firstInstance += maxInstanceCount )
+    {
+        const int drawInstanceCount = std::min( instanceCount - firstInstance, maxInstanceCount );
+
+        m_blockModelVertexShader.setParameters( *m_deviceContext.Get( ), worldMatrices + firstInstance, drawInstanceCount, viewMatrix, projectionMatrix );
+
+        m_rendererCore.draw( *model.getMesh().get(), drawInstanceCount );
+    }
 }
 
 void DX11DeferredRenderer::render( 
@@ -121,6 +121,23 @@ namespace Engine1
             const float4& extraEmissive = float4::ZERO 
         );
 
+        // Enables render targets, shaders, states and the model's textures for the following renderInstances calls.
+        void bindModel( 
+            const DeferredRenderTargets& renderTargets, 
+            const Settings& renderSettings, 
+            const BlockModel& model, 
+            const float4& extraEmissive = float4::ZERO 
+        );
+
+        // Draws the model bound with bindModel once per world matrix - in instanced draws of up to BlockModelVertexShader::s_maxInstanceCount copies.
+        void renderInstances( 
+            const Settings& renderSettings, 
+            const BlockModel& model, 
+            const float43* worldMatrices, 
+            const int instanceCount, 
+            const float44& viewMatrix 
+        );
+
         void render( 
             const DeferredRenderTargets& renderTargets, 
             const Settings& renderSettings, 
@@ -72,6 +72,7 @@ size_t RenderTargets::getCount() const
 
 DX11RendererCore::DX11RendererCore() :
 m_deviceContext( nullptr ),
+m_commandList( nullptr ),
 viewportDimensions( float2::ZERO ),
 viewportTopLeft( float2::ZERO ),
 viewportDepthMin( 0.0f ),
@@ -96,6 +97,36 @@ void DX11RendererCore::initialize( ID3D11DeviceContext3& deviceContext )
 	this->m_deviceContext = &deviceContext;
 }
 
+void DX11RendererCore::setCommandList( RenderCommandList* commandList )
+{
+    m_commandList = commandList;
+}
+
+RenderCommandList* DX11RendererCore::getCommandList() const
+{
+    return m_commandList;
+}
+
+void DX11RendererCore::beginPass( const char* name )
+{
+    if ( m_commandList )
+        m_commandList->beginPass( name );
+}
+
+void DX11RendererCore::endPass()
+{
+    if ( m_commandList )
+        m_commandList->endPass();
+}
+
+bool DX11RendererCore::isExecuting( const char* errorMessage ) const
+{
+    if ( !m_deviceContext && !m_commandList )
+        throw std::exception( errorMessage );
+
+    return m_deviceContext != nullptr;
+}
+
 void DX11RendererCore::disableRenderingPipeline()
 {
     disableRenderingShaders();
@@ -124,10 +155,13 @@ void DX11RendererCore::enableRenderingShaders( std::shared_ptr<const VertexShade
 
 void DX11RendererCore::enableRenderingShaders( const VertexShader& vertexShader )
 {
-    if ( !m_deviceContext )
-        throw std::exception( "Direct3DRendererCore::enableRenderingShaders - renderer not initialized." );
+    if ( m_commandList )
+        m_commandList->setRenderingShaders( &vertexShader, nullptr );
 
-    disableComputeShaders();
+    if ( !isExecuting( "Direct3DRendererCore::enableRenderingShaders - renderer not initialized." ) )
+        return;
+
+    unbindComputeShaders();
 
     // Check if currently set vertex shader is the same as the one to be enabled - do nothing then. 
     if ( m_currentVertexShader != &vertexShader ) {
@@ -150,10 +184,13 @@ void DX11RendererCore::enableRenderingShaders( const VertexShader& vertexShader
 
 void DX11RendererCore::enableRenderingShaders( const VertexShader& vertexShader, const FragmentShader& fragmentShader )
 {
-    if ( !m_deviceContext )
-        throw std::exception( "Direct3DRendererCore::enableRenderingShaders - renderer not initialized." );
+    if ( m_commandList )
+        m_commandList->setRenderingShaders( &vertexShader, &fragmentShader );
 
-    disableComputeShaders();
+    if ( !isExecuting( "Direct3DRendererCore::enableRenderingShaders - renderer not initialized." ) )
+        return;
+
+    unbindComputeShaders();
 
     // Check if currently set vertex shader is the same as the one to be enabled - do nothing then. 
     if ( m_currentVertexShader != &vertexShader ) 
@@ -184,10 +221,13 @@ void DX11RendererCore::enableComputeShader( std::shared_ptr<const ComputeShader>
 
 void DX11RendererCore::enableComputeShader( const ComputeShader& computeShader )
 {
-    if ( !m_deviceContext ) 
-        throw std::exception( "Direct3DRendererCore::enableComputeShader - renderer not initialized." );
+    if ( m_commandList )
+        m_commandList->setComputeShader( &computeShader );
 
-    disableRenderingShaders();
+    if ( !isExecuting( "Direct3DRendererCore::enableComputeShader - renderer not initialized." ) )
+        return;
+
+    unbindRenderingShaders();
 
     // Check if currently set compute shader is the same as the one to be enabled - do nothing then. 
     if ( m_currentComputeShader != &computeShader ) 
@@ -201,6 +241,28 @@ void DX11RendererCore::enableComputeShader( const ComputeShader& computeShader )
 }
 
 void DX11RendererCore::disableRenderingShaders()
+{
+    if ( m_commandList )
+        m_commandList->setRenderingShaders( nullptr, nullptr );
+
+    if ( !m_deviceContext )
+        return;
+
+    unbindRenderingShaders();
+}
+
+void DX11RendererCore::disableComputeShaders()
+{
+    if ( m_commandList )
+        m_commandList->setComputeShader( nullptr );
+
+    if ( !m_deviceContext )
+        return;
+
+    unbindComputeShaders();
+}
+
+void DX11RendererCore::unbindRenderingShaders()
 {
     if ( m_graphicsShaderEnabled ) 
     {
@@ -215,7 +277,7 @@ void DX11RendererCore::disableRenderingShaders()
     }
 }
 
-void DX11RendererCore::disableComputeShaders()
+void DX11RendererCore::unbindComputeShaders()
 {
     if ( m_computeShaderEnabled ) 
     {
@@ -229,6 +291,12 @@ void DX11RendererCore::disableComputeShaders()
 
 void DX11RendererCore::setViewport( float2 dimensions, float2 topLeft, float depthMin, float depthMax )
 {
+    if ( m_commandList )
+        m_commandList->setViewport( dimensions, topLeft, depthMin, depthMax );
+
+    if ( !isExecuting( "Direct3DRendererCore::setViewport - renderer not initialized." ) )
+        return;
+
     if ( !MathUtil::areEqual( dimensions, viewportDimensions ) || !MathUtil::areEqual( topLeft, viewportTopLeft ) || 
          !MathUtil::areEqual( depthMin, viewportDepthMin ) || !MathUtil::areEqual( depthMax, viewportDepthMax ) )
     {
@@ -254,8 +322,7 @@ void DX11RendererCore::enableRenderTargets(
 	const RenderTargets& unorderedAccessTargets,
     const int mipmapLevel )
 {
-	if ( !m_deviceContext ) 
-		throw std::exception( "Direct3DRendererCore::enableRenderTargets - renderer-core not initialized." );
+	const bool executing = isExecuting( "Direct3DRendererCore::enableRenderTargets - renderer-core not initialized." );
 
 	if ( renderTargets.depth && renderTargets.depthStencil )
 		throw std::exception( "Direct3DRendererCore::enableRenderTargets - depth and depth-stencil were passed, but only one of them can be enabled." );
@@ -263,9 +330,35 @@ void DX11RendererCore::enableRenderTargets(
     const auto rtvCount = renderTargets.getCount();
     const auto uavCount = unorderedAccessTargets.getCount();
 
+    if ( m_commandList )
+    {
+        RenderHandle rtvs[ D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT ];
+        RenderHandle uavs[ D3D11_1_UAV_SLOT_COUNT ];
+
+        if ( rtvCount > D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT || uavCount > D3D11_1_UAV_SLOT_COUNT )
+            throw std::exception( "Direct3DRendererCore::enableRenderTargets - too many render targets passed. Number exceeds the supported maximum." );
+
+        for ( auto rtvIdx = 0u; rtvIdx < rtvCount; ++rtvIdx )
+            rtvs[ rtvIdx ] = renderTargets.getRTV( rtvIdx, mipmapLevel );
+
+        for ( auto uavIdx = 0u; uavIdx < uavCount; ++uavIdx )
+            uavs[ uavIdx ] = unorderedAccessTargets.getUAV( uavIdx, mipmapLevel );
+
+        RenderHandle dsv = nullptr;
+        if ( renderTargets.depthStencil )
+            dsv = renderTargets.depthStencil->getDepthStencilView( mipmapLevel );
+        else if ( renderTargets.depth )
+            dsv = renderTargets.depth->getDepthStencilView( mipmapLevel );
+
+        m_commandList->setRenderTargets( rtvs, (int)rtvCount, dsv, uavs, (int)uavCount );
+    }
+
+    if ( !executing )
+        return;
+
     // Disable redundant RTVs and UAVs (by disabling them all).
     if ( rtvCount < m_currentRTVs.size() || uavCount < m_currentUAVs.size() )
-        disableRenderTargets();
+        unbindRenderTargets();
 
 	bool rtvSameAsCurrent = true;
 	{
@@ -374,6 +467,17 @@ void DX11RendererCore::enableRenderTargets(
 }
 
 void DX11RendererCore::disableRenderTargets()
+{
+    if ( m_commandList )
+        m_commandList->unbindRenderTargets();
+
+    if ( !m_deviceContext )
+        return;
+
+    unbindRenderTargets();
+}
+
+void DX11RendererCore::unbindRenderTargets()
 {
     if ( !m_currentRTVs.empty() || m_currentDSV || !m_currentUAVs.empty() )
     {
@@ -410,7 +514,11 @@ void DX11RendererCore::disableRenderTargets()
 
 void DX11RendererCore::enableRasterizerState( ID3D11RasterizerState& rasterizerState )
 {
-	if ( !m_deviceContext ) throw std::exception( "Direct3DRendererCore::enableRasterizerState - renderer not initialized." );
+	if ( m_commandList )
+		m_commandList->setRasterizerState( &rasterizerState );
+
+	if ( !isExecuting( "Direct3DRendererCore::enableRasterizerState - renderer not initialized." ) )
+		return;
 
 	// Change rasterizer state if new state is different than the current one.
 	if ( &rasterizerState != m_currentRasterizerState ) {
@@ -422,7 +530,11 @@ void DX11RendererCore::enableRasterizerState( ID3D11RasterizerState& rasterizerS
 
 void DX11RendererCore::enableDepthStencilState( ID3D11DepthStencilState& depthStencilState )
 {
-	if ( !m_deviceContext ) throw std::exception( "Direct3DRendererCore::enableDepthStencilState - renderer not initialized." );
+	if ( m_commandList )
+		m_commandList->setDepthStencilState( &depthStencilState );
+
+	if ( !isExecuting( "Direct3DRendererCore::enableDepthStencilState - renderer not initialized." ) )
+		return;
 
 	// Change depth stencil state if new state is different than the current one.
 	if ( &depthStencilState != m_currentDepthStencilState ) {
@@ -434,7 +546,11 @@ void DX11RendererCore::enableDepthStencilState( ID3D11DepthStencilState& depthSt
 
 void DX11RendererCore::enableBlendState( ID3D11BlendState& blendState )
 {
-	if ( !m_deviceContext ) throw std::exception( "Direct3DRendererCore::enableBlendState - renderer not initialized." );
+	if ( m_commandList )
+		m_commandList->setBlendState( &blendState );
+
+	if ( !isExecuting( "Direct3DRendererCore::enableBlendState - renderer not initialized." ) )
+		return;
 
 	// Change blend state if new state is different than the current one.
 	if ( &blendState != m_currentBlendState ) {
@@ -449,7 +565,11 @@ void DX11RendererCore::enableBlendState( ID3D11BlendState& blendState )
 
 void DX11RendererCore::enableDefaultRasterizerState()
 {
-    if ( !m_deviceContext ) throw std::exception( "Direct3DRendererCore::enableDefaultRasterizerState - renderer not initialized." );
+    if ( m_commandList )
+        m_commandList->setRasterizerState( nullptr );
+
+    if ( !isExecuting( "Direct3DRendererCore::enableDefaultRasterizerState - renderer not initialized." ) )
+        return;
 
     if ( m_currentRasterizerState ) {
         m_deviceContext->RSSetState( nullptr );
@@ -460,7 +580,11 @@ void DX11RendererCore::enableDefaultRasterizerState()
 
 void DX11RendererCore::enableDefaultDepthStencilState()
 {
-    if ( !m_deviceContext ) throw std::exception( "Direct3DRendererCore::enableDefaultDepthStencilState - renderer not initialized." );
+    if ( m_commandList )
+        m_commandList->setDepthStencilState( nullptr );
+
+    if ( !isExecuting( "Direct3DRendererCore::enableDefaultDepthStencilState - renderer not initialized." ) )
+        return;
 
     if ( m_currentDepthStencilState ) {
         m_deviceContext->OMSetDepthStencilState( nullptr, 0 );
@@ -471,7 +595,11 @@ void DX11RendererCore::enableDefaultDepthStencilState()
 
 void DX11RendererCore::enableDefaultBlendState()
 {
-	if ( !m_deviceContext ) throw std::exception( "Direct3DRendererCore::enableDefaultBlendState - renderer not initialized." );
+	if ( m_commandList )
+		m_commandList->setBlendState( nullptr );
+
+	if ( !isExecuting( "Direct3DRendererCore::enableDefaultBlendState - renderer not initialized." ) )
+		return;
 
 	if ( m_currentBlendState ) {
 
@@ -485,7 +613,12 @@ void DX11RendererCore::enableDefaultBlendState()
 // Note: Shaders need to be configured and set before calling this method.
 void DX11RendererCore::draw( const RectangleMesh& mesh )
 {
-	if ( !m_deviceContext ) throw std::exception( "Direct3DRendererCore::draw - renderer not initialized." );
+	if ( m_commandList )
+		m_commandList->draw( &mesh, (unsigned int)mesh.getTriangles().size() * uint3::size() );
+
+	if ( !isExecuting( "Direct3DRendererCore::draw - renderer not initialized." ) )
+		return;
+
 	if ( !mesh.isInGpuMemory() ) throw std::exception( "Direct3DRenderer::drawRectangleMesh - mesh hasn't been loaded to GPU yet" );
 
 	{ // set mesh buffers
@@ -526,9 +659,14 @@ void DX11RendererCore::draw( const RectangleMesh& mesh )
 }
 
 // Note: Shaders need to be configured and set before calling this method.
-void DX11RendererCore::draw( const BlockMesh& mesh )
+void DX11RendererCore::draw( const BlockMesh& mesh, const int instanceCount )
 {
-	if ( !m_deviceContext ) throw std::exception( "Direct3DRendererCore::draw - renderer not initialized." );
+	if ( m_commandList )
+		m_commandList->draw( &mesh, (unsigned int)mesh.getTriangles().size() * uint3::size(), (unsigned int)instanceCount );
+
+	if ( !isExecuting( "Direct3DRendererCore::draw - renderer not initialized." ) )
+		return;
+
 	if ( !mesh.isInGpuMemory() ) throw std::exception( "Direct3DRenderer::drawBlockMesh - mesh hasn't been loaded to GPU yet" );
 
 	{ // set mesh buffers
@@ -565,13 +703,20 @@ void DX11RendererCore::draw( const BlockMesh& mesh )
 	}
 
 	// draw mesh
-	m_deviceContext->DrawIndexed( (unsigned int)mesh.getTriangles().size() * uint3::size(), 0, 0 );
+	if ( instanceCount > 1 )
+		m_deviceContext->DrawIndexedInstanced( (unsigned int)mesh.getTriangles().size() * uint3::size(), (unsigned int)instanceCount, 0, 0, 0 );
+	else
+		m_deviceContext->DrawIndexed( (unsigned int)mesh.getTriangles().size() * uint3::size(), 0, 0 );
 }
 
 // Note: Shaders need to be configured and set before calling this method.
 void DX11RendererCore::draw( const SkeletonMesh& mesh )
 {
-	if ( !m_deviceContext ) throw std::exception( "Direct3DRendererCore::draw - renderer not initialized." );
+	if ( m_commandList )
+		m_commandList->draw( &mesh, (unsigned int)mesh.getTriangles().size() * uint3::size() );
+
+	if ( !isExecuting( "Direct3DRendererCore::draw - renderer not initialized." ) )
+		return;
 
 	//TODO: move this tests to some method? To which class?
 	if ( mesh.getVertexBones().empty() )   throw std::exception( "Direct3DRenderer::drawSkeletonMesh - mesh doesn't have vertex-bone assignemnts." );
@@ -636,7 +781,11 @@ void DX11RendererCore::draw( const SkeletonMesh& mesh )
 // Note: Shaders need to be configured and set before calling this method.
 void DX11RendererCore::draw( const FontCharacter& character )
 {
-	if ( !m_deviceContext ) throw std::exception( "Direct3DRendererCore::draw - renderer not initialized." );
+	if ( m_commandList )
+		m_commandList->draw( &character, 2 * uint3::size() );
+
+	if ( !isExecuting( "Direct3DRendererCore::draw - renderer not initialized." ) )
+		return;
 
 	const unsigned int bufferCount = 2;
 	unsigned int  strides[ bufferCount ] = { sizeof( float3 ), sizeof( float2 ) };
@@ -655,14 +804,22 @@ void DX11RendererCore::draw( const FontCharacter& character )
 // Note: Shaders need to be configured and set before calling this method.
 void DX11RendererCore::compute( uint3 groupCount )
 {
-    if ( !m_deviceContext ) throw std::exception( "Direct3DRendererCore::compute - renderer not initialized." );
+    if ( m_commandList )
+        m_commandList->dispatch( groupCount );
+
+    if ( !isExecuting( "Direct3DRendererCore::compute - renderer not initialized." ) )
+        return;
 
     m_deviceContext->Dispatch( groupCount.x, groupCount.y, groupCount.z );
 }
 
 void DX11RendererCore::disableShaderInputs()
 {
-    if ( !m_deviceContext ) throw std::exception( "Direct3DRendererCore::disableShaderInputs - renderer not initialized." );
+    if ( m_commandList )
+        m_commandList->unbindShaderInputs();
+
+    if ( !isExecuting( "Direct3DRendererCore::disableShaderInputs - renderer not initialized." ) )
+        return;
 
     m_deviceContext->IASetVertexBuffers( 0, (unsigned int)m_nullVertexBuffers.size(), m_nullVertexBuffers.data(), m_nullVertexBuffersStrideOffset.data(), m_nullVertexBuffersStrideOffset.data() );
     m_deviceContext->IASetIndexBuffer( nullptr, DXGI_FORMAT_UNKNOWN, 0 );
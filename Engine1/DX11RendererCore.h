@@ -5,6 +5,7 @@
 
 #include "Texture2DTypes.h"
 #include "StagingTexture2D.h"
+#include "RenderCommandList.h"
 
 #include "uint3.h"
 #include "float2.h"
@@ -56,6 +57,15 @@ namespace Engine1
 
         void initialize( ID3D11DeviceContext3& deviceContext );
 
+        // Each following call is recorded into the command list - also the calls which don't change the pipeline state.
+        // Without a device context the calls are only recorded - to build frames headless. Null stops the recording.
+        void               setCommandList( RenderCommandList* commandList );
+        RenderCommandList* getCommandList() const;
+
+        // Pass markers for the recorded command stream. Names have to outlive the command list.
+        void beginPass( const char* name );
+        void endPass();
+
         void disableRenderingPipeline();
         void disableComputePipeline();
 
@@ -91,7 +101,7 @@ namespace Engine1
         void enableDefaultBlendState();
 
         void draw( const RectangleMesh& mesh );
-        void draw( const BlockMesh& mesh );
+        void draw( const BlockMesh& mesh, const int instanceCount = 1 );
         void draw( const SkeletonMesh& mesh );
         void draw( const FontCharacter& character );
 
@@ -122,7 +132,16 @@ namespace Engine1
 
         private:
 
+        // Whether the call should be executed on the device - throws if there is neither a device context nor a command list.
+        bool isExecuting( const char* errorMessage ) const;
+
+        // Not recorded - called internally by the methods which record.
+        void unbindRenderingShaders();
+        void unbindComputeShaders();
+        void unbindRenderTargets();
+
         ID3D11DeviceContext* m_deviceContext;
+        RenderCommandList*   m_commandList;
 
         bool m_graphicsShaderEnabled;
         bool m_computeShaderEnabled;
@@ -162,9 +181,7 @@ namespace Engine1
 											const Texture2D< T >& srcTexture,
 											const int2 coords, int2 dimensions )
 	{
-		if ( !m_deviceContext ) {
-            throw std::exception( "Direct3DRendererCore::copyTexture - renderer not initialized." );
-        }
+		const bool executing = isExecuting( "Direct3DRendererCore::copyTexture - renderer not initialized." );
 
         if ( dimensions.x == -1 && dimensions.y == -1 ) {
             dimensions = srcTexture.getDimensions();
@@ -180,6 +197,12 @@ namespace Engine1
 			throw std::exception( "Direct3DRendererCore::copyTexture - given fragment exceeds boundaries of the source/destination texture." );
         }
 
+        if ( m_commandList )
+            m_commandList->copy( destTexture.getTextureResource().Get(), 0, srcTexture.getTextureResource().Get(), 0 );
+
+        if ( !executing )
+            return;
+
 		D3D11_BOX sourceRregion;
 		sourceRregion.left   = coords.x;
 		sourceRregion.right  = coords.x + dimensions.x;
@@ -200,9 +223,11 @@ namespace Engine1
     void DX11RendererCore::copyTextureGpu( Texture2D< T >& destTexture, const int destMipmap,
                                             const Texture2D< T >& srcTexture, const int srcMipmap )
     {
-        if ( !m_deviceContext ) {
-            throw std::exception( "Direct3DRendererCore::copyTexture - renderer not initialized." );
-        }
+        if ( m_commandList )
+            m_commandList->copy( destTexture.getTextureResource().Get(), (unsigned int)destMipmap, srcTexture.getTextureResource().Get(), (unsigned int)srcMipmap );
+
+        if ( !isExecuting( "Direct3DRendererCore::copyTexture - renderer not initialized." ) )
+            return;
 
         D3D11_BOX sourceRregion;
         sourceRregion.left   = 0;
@@ -224,9 +249,11 @@ namespace Engine1
     template< typename T >
     void DX11RendererCore::copyTextureGpu( StagingTexture2D< T >& destTexture, const Texture2D< T >& srcTexture )
     {
-        if ( !m_deviceContext ) {
-            throw std::exception( "Direct3DRendererCore::copyTexture - renderer not initialized." );
-        }
+        if ( m_commandList )
+            m_commandList->copy( destTexture.getTextureResource().Get(), 0, srcTexture.getTextureResource().Get(), 0 );
+
+        if ( !isExecuting( "Direct3DRendererCore::copyTexture - renderer not initialized." ) )
+            return;
 
         m_deviceContext->CopyResource( destTexture.getTextureResource().Get(), srcTexture.getTextureResource().Get() );
     }
@@ -236,9 +263,11 @@ namespace Engine1
         StagingTexture2D< T >& destTexture, unsigned int destMipmap,
         const Texture2D< T >& srcTexture, unsigned int srcMipmap)
     {
-        if (!m_deviceContext) {
-            throw std::exception("Direct3DRendererCore::copyTexture - renderer not initialized.");
-        }
+        if (m_commandList)
+            m_commandList->copy(destTexture.getTextureResource().Get(), destMipmap, srcTexture.getTextureResource().Get(), srcMipmap);
+
+        if (!isExecuting("Direct3DRendererCore::copyTexture - renderer not initialized."))
+            return;
 
         m_deviceContext->CopySubresourceRegion(
             destTexture.getTextureResource().Get(), destMipmap, 0u, 0u, 0u,
@@ -249,9 +278,7 @@ namespace Engine1
     void DX11RendererCore::copyTextureGpu( StagingTexture2D< T >& destTexture, const Texture2D< T >& srcTexture,
                                             const int2 coords, const int2 dimensions )
     {
-        if ( !m_deviceContext ) {
-            throw std::exception( "Direct3DRendererCore::copyTexture - renderer not initialized." );
-        }
+        const bool executing = isExecuting( "Direct3DRendererCore::copyTexture - renderer not initialized." );
 
         if ( coords.x < 0 || 
              coords.y < 0 || 
@@ -263,6 +290,12 @@ namespace Engine1
             throw std::exception( "Direct3DRendererCore::copyTexture - given fragment exceeds boundaries of the source/destination texture." );
         }
 
+        if ( m_commandList )
+            m_commandList->copy( destTexture.getTextureResource().Get(), 0, srcTexture.getTextureResource().Get(), 0 );
+
+        if ( !executing )
+            return;
+
         D3D11_BOX sourceRregion;
         sourceRregion.left   = coords.x;
         sourceRregion.right  = coords.x + dimensions.x;
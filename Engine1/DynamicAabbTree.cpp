@@ -0,0 +1,591 @@
+#include "DynamicAabbTree.h"
+
+#include <algorithm>
+#include <queue>
+
+using namespace Engine1;
+
+const int DynamicAabbTree::s_nullNode = -1;
+
+namespace
+{
+    struct Plane
+    {
+        float a, b, c, d;
+    };
+
+    // Planes of the D3D clip space volume (-w <= x <= w, -w <= y <= w, 0 <= z <= w) in world space - positive distance is inside.
+    void extractFrustumPlanes( const float44& viewProjection, Plane planes[ 6 ] )
+    {
+        const float4 column1( viewProjection.m11, viewProjection.m21, viewProjection.m31, viewProjection.m41 );
+        const float4 column2( viewProjection.m12, viewProjection.m22, viewProjection.m32, viewProjection.m42 );
+        const float4 column3( viewProjection.m13, viewProjection.m23, viewProjection.m33, viewProjection.m43 );
+        const float4 column4( viewProjection.m14, viewProjection.m24, viewProjection.m34, viewProjection.m44 );
+
+        const float4 planeVectors[ 6 ] = {
+            column4 + column1, // Left.
+            column4 - column1, // Right.
+            column4 + column2, // Bottom.
+            column4 - column2, // Top.
+            column3,           // Near.
+            column4 - column3  // Far.
+        };
+
+        for ( int i = 0; i < 6; ++i )
+            planes[ i ] = { planeVectors[ i ].x, planeVectors[ i ].y, planeVectors[ i ].z, planeVectors[ i ].w };
+    }
+
+    // Half of the surface area - only compared, so the factor doesn't matter.
+    float getArea( const float3& min, const float3& max )
+    {
+        const float3 size = max - min;
+        return size.x * size.y + size.y * size.z + size.z * size.x;
+    }
+
+    bool overlap( const float3& min1, const float3& max1, const float3& min2, const float3& max2 )
+    {
+        return min1.x <= max2.x && min2.x <= max1.x
+            && min1.y <= max2.y && min2.y <= max1.y
+            && min1.z <= max2.z && min2.z <= max1.z;
+    }
+
+    bool contains( const float3& outerMin, const float3& outerMax, const float3& innerMin, const float3& innerMax )
+    {
+        return outerMin.x <= innerMin.x && outerMin.y <= innerMin.y && outerMin.z <= innerMin.z
+            && innerMax.x <= outerMax.x && innerMax.y <= outerMax.y && innerMax.z <= outerMax.z;
+    }
+
+    float getDistanceSquare( const float3& point, const float3& min, const float3& max )
+    {
+        const float3 offset = Engine1::max( Engine1::max( min - point, point - max ), float3::ZERO );
+        return offset.lengthSquare();
+    }
+
+    // Returns -1 if the box is entirely outside, 1 if entirely inside and 0 if it crosses any of the planes.
+    int classifyBox( const Plane planes[ 6 ], const float3& min, const float3& max )
+    {
+        int result = 1;
+
+        for ( int i = 0; i < 6; ++i )
+        {
+            const Plane& plane = planes[ i ];
+
+            // Corners furthest along and against the plane normal.
+            const float farDistance
+                = plane.a * ( plane.a >= 0.0f ? max.x : min.x ) + plane.b * ( plane.b >= 0.0f ? max.y : min.y )
+                + plane.c * ( plane.c >= 0.0f ? max.z : min.z ) + plane.d;
+
+            if ( farDistance < 0.0f )
+                return -1;
+
+            const float nearDistance
+                = plane.a * ( plane.a >= 0.0f ? min.x : max.x ) + plane.b * ( plane.b >= 0.0f ? min.y : max.y )
+                + plane.c * ( plane.c >= 0.0f ? min.z : max.z ) + plane.d;
+
+            if ( nearDistance < 0.0f )
+                result = 0;
+        }
+
+        return result;
+    }
+
+    // Returns true if the ray enters the box before maxDistance - distance is 0 if the ray starts inside.
+    bool intersectRay( const float3& origin, const float3& inverseDirection, const float3& min, const float3& max, const float maxDistance, float& distance )
+    {
+        const float3 t1 = ( min - origin ) * inverseDirection;
+        const float3 t2 = ( max - origin ) * inverseDirection;
+
+        const float3 tMin = Engine1::min( t1, t2 );
+        const float3 tMax = Engine1::max( t1, t2 );
+
+        const float enter = std::max( std::max( tMin.x, tMin.y ), std::max( tMin.z, 0.0f ) );
+        const float exit  = std::min( std::min( tMax.x, tMax.y ), tMax.z );
+
+        distance = enter;
+
+        return enter <= exit && enter <= maxDistance;
+    }
+}
+
+bool DynamicAabbTree::Node::isLeaf() const
+{
+    return child1 == s_nullNode;
+}
+
+DynamicAabbTree::DynamicAabbTree( const float margin ) :
+    m_margin( margin ),
+    m_root( s_nullNode ),
+    m_freeList( s_nullNode ),
+    m_proxyCount( 0 )
+{}
+
+DynamicAabbTree::~DynamicAabbTree()
+{}
+
+void DynamicAabbTree::clear()
+{
+    m_nodes.clear();
+    m_root       = s_nullNode;
+    m_freeList   = s_nullNode;
+    m_proxyCount = 0;
+}
+
+int DynamicAabbTree::createProxy( const BoundingBox& box, const int userData )
+{
+    const float3 margin( m_margin, m_margin, m_margin );
+
+    const int proxy = allocateNode();
+
+    Node& node = m_nodes[ proxy ];
+    node.boxMin   = box.getMin();
+    node.boxMax   = box.getMax();
+    node.min      = node.boxMin - margin;
+    node.max      = node.boxMax + margin;
+    node.height   = 0;
+    node.userData = userData;
+
+    insertLeaf( proxy );
+    ++m_proxyCount;
+
+    return proxy;
+}
+
+void DynamicAabbTree::destroyProxy( const int proxy )
+{
+    checkProxy( proxy, "DynamicAabbTree::destroyProxy - invalid proxy." );
+
+    removeLeaf( proxy );
+    freeNode( proxy );
+    --m_proxyCount;
+}
+
+bool DynamicAabbTree::moveProxy( const int proxy, const BoundingBox& box )
+{
+    checkProxy( proxy, "DynamicAabbTree::moveProxy - invalid proxy." );
+
+    Node& node = m_nodes[ proxy ];
+    node.boxMin = box.getMin();
+    node.boxMax = box.getMax();
+
+    if ( contains( node.min, node.max, node.boxMin, node.boxMax ) )
+        return false;
+
+    removeLeaf( proxy );
+
+    const float3 margin( m_margin, m_margin, m_margin );
+
+    node.min = node.boxMin - margin;
+    node.max = node.boxMax + margin;
+
+    insertLeaf( proxy );
+
+    return true;
+}
+
+int DynamicAabbTree::getUserData( const int proxy ) const
+{
+    checkProxy( proxy, "DynamicAabbTree::getUserData - invalid proxy." );
+
+    return m_nodes[ proxy ].userData;
+}
+
+BoundingBox DynamicAabbTree::getBoundingBox( const int proxy ) const
+{
+    checkProxy( proxy, "DynamicAabbTree::getBoundingBox - invalid proxy." );
+
+    return BoundingBox( m_nodes[ proxy ].boxMin, m_nodes[ proxy ].boxMax );
+}
+
+BoundingBox DynamicAabbTree::getFatBoundingBox( const int proxy ) const
+{
+    checkProxy( proxy, "DynamicAabbTree::getFatBoundingBox - invalid proxy." );
+
+    return BoundingBox( m_nodes[ proxy ].min, m_nodes[ proxy ].max );
+}
+
+int DynamicAabbTree::getProxyCount() const
+{
+    return m_proxyCount;
+}
+
+int DynamicAabbTree::getHeight() const
+{
+    return m_root != s_nullNode ? m_nodes[ m_root ].height : 0;
+}
+
+void DynamicAabbTree::queryBox( const BoundingBox& box, std::vector< int >& result ) const
+{
+    if ( m_root == s_nullNode )
+        return;
+
+    const float3 min = box.getMin();
+    const float3 max = box.getMax();
+
+    std::vector< int > stack;
+    stack.reserve( 64 );
+    stack.push_back( m_root );
+
+    while ( !stack.empty() )
+    {
+        const Node& node = m_nodes[ stack.back() ];
+        stack.pop_back();
+
+        if ( !overlap( node.min, node.max, min, max ) )
+            continue;
+
+        if ( node.isLeaf() ) {
+            if ( overlap( node.boxMin, node.boxMax, min, max ) )
+                result.push_back( node.userData );
+        } else {
+            stack.push_back( node.child1 );
+            stack.push_back( node.child2 );
+        }
+    }
+}
+
+void DynamicAabbTree::queryFrustum( const float44& viewProjection, std::vector< int >& result ) const
+{
+    if ( m_root == s_nullNode )
+        return;
+
+    Plane planes[ 6 ];
+    extractFrustumPlanes( viewProjection, planes );
+
+    // Stack entries - node index and whether the node is known to be entirely inside (its leaves aren't tested anymore).
+    std::vector< std::pair< int, bool > > stack;
+    stack.reserve( 64 );
+    stack.emplace_back( m_root, false );
+
+    while ( !stack.empty() )
+    {
+        const Node& node   = m_nodes[ stack.back().first ];
+        bool        inside = stack.back().second;
+        stack.pop_back();
+
+        if ( !inside )
+        {
+            const int classification = node.isLeaf()
+                ? classifyBox( planes, node.boxMin, node.boxMax )
+                : classifyBox( planes, node.min, node.max );
+
+            if ( classification < 0 )
+                continue;
+
+            inside = classification > 0;
+        }
+
+        if ( node.isLeaf() ) {
+            result.push_back( node.userData );
+        } else {
+            stack.emplace_back( node.child1, inside );
+            stack.emplace_back( node.child2, inside );
+        }
+    }
+}
+
+void DynamicAabbTree::queryNearest( const float3& point, const int count, std::vector< int >& result ) const
+{
+    if ( m_root == s_nullNode || count <= 0 )
+        return;
+
+    typedef std::pair< float, int > Entry; // Squared distance, node.
+
+    // Nodes to visit, nearest first.
+    std::priority_queue< Entry, std::vector< Entry >, std::greater< Entry > > nodes;
+    // Nearest leaves found so far, farthest on top.
+    std::priority_queue< Entry > nearest;
+
+    nodes.emplace( getDistanceSquare( point, m_nodes[ m_root ].min, m_nodes[ m_root ].max ), m_root );
+
+    while ( !nodes.empty() )
+    {
+        const Entry entry = nodes.top();
+        nodes.pop();
+
+        // Every remaining node is farther than all the found leaves.
+        if ( (int)nearest.size() == count && entry.first >= nearest.top().first )
+            break;
+
+        const Node& node = m_nodes[ entry.second ];
+
+        if ( node.isLeaf() )
+        {
+            const float distance = getDistanceSquare( point, node.boxMin, node.boxMax );
+
+            if ( (int)nearest.size() < count ) {
+                nearest.emplace( distance, entry.second );
+            } else if ( distance < nearest.top().first ) {
+                nearest.pop();
+                nearest.emplace( distance, entry.second );
+            }
+        }
+        else
+        {
+            nodes.emplace( getDistanceSquare( point, m_nodes[ node.child1 ].min, m_nodes[ node.child1 ].max ), node.child1 );
+            nodes.emplace( getDistanceSquare( point, m_nodes[ node.child2 ].min, m_nodes[ node.child2 ].max ), node.child2 );
+        }
+    }
+
+    const size_t firstIdx = result.size();
+    result.resize( firstIdx + nearest.size() );
+
+    for ( size_t i = result.size(); i > firstIdx; --i ) {
+        result[ i - 1 ] = m_nodes[ nearest.top().second ].userData;
+        nearest.pop();
+    }
+}
+
+void DynamicAabbTree::rayCast( const float3& origin, const float3& direction, const float maxDistance, const std::function< float( int, float ) >& callback ) const
+{
+    if ( m_root == s_nullNode )
+        return;
+
+    const float3 inverseDirection( 1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z );
+
+    float distanceLimit = maxDistance;
+
+    std::vector< int > stack;
+    stack.reserve( 64 );
+    stack.push_back( m_root );
+
+    while ( !stack.empty() )
+    {
+        const Node& node = m_nodes[ stack.back() ];
+        stack.pop_back();
+
+        float distance;
+
+        if ( !intersectRay( origin, inverseDirection, node.min, node.max, distanceLimit, distance ) )
+            continue;
+
+        if ( node.isLeaf() )
+        {
+            if ( intersectRay( origin, inverseDirection, node.boxMin, node.boxMax, distanceLimit, distance ) )
+                distanceLimit = std::min( distanceLimit, callback( node.userData, distance ) );
+        }
+        else
+        {
+            stack.push_back( node.child1 );
+            stack.push_back( node.child2 );
+        }
+    }
+}
+
+int DynamicAabbTree::allocateNode()
+{
+    int node;
+
+    if ( m_freeList != s_nullNode ) {
+        node       = m_freeList;
+        m_freeList = m_nodes[ node ].parent;
+    } else {
+        node = (int)m_nodes.size();
+        m_nodes.emplace_back();
+    }
+
+    m_nodes[ node ].parent   = s_nullNode;
+    m_nodes[ node ].child1   = s_nullNode;
+    m_nodes[ node ].child2   = s_nullNode;
+    m_nodes[ node ].height   = 0;
+    m_nodes[ node ].userData = -1;
+
+    return node;
+}
+
+void DynamicAabbTree::freeNode( const int node )
+{
+    m_nodes[ node ].parent = m_freeList;
+    m_nodes[ node ].height = -1;
+    m_freeList = node;
+}
+
+void DynamicAabbTree::insertLeaf( const int leaf )
+{
+    if ( m_root == s_nullNode ) {
+        m_root = leaf;
+        m_nodes[ leaf ].parent = s_nullNode;
+        return;
+    }
+
+    const float3 leafMin = m_nodes[ leaf ].min;
+    const float3 leafMax = m_nodes[ leaf ].max;
+
+    // Find the best sibling - descend to the child for which the increase of the total area is the smallest.
+    int sibling = m_root;
+    while ( !m_nodes[ sibling ].isLeaf() )
+    {
+        const Node& node = m_nodes[ sibling ];
+
+        const float area         = getArea( node.min, node.max );
+        const float combinedArea = getArea( min( node.min, leafMin ), max( node.max, leafMax ) );
+
+        // Cost of creating a new parent for this node and the leaf.
+        const float cost = 2.0f * combinedArea;
+
+        // Minimum cost of pushing the leaf further down the tree.
+        const float inheritanceCost = 2.0f * ( combinedArea - area );
+
+        float childCosts[ 2 ];
+        const int children[ 2 ] = { node.child1, node.child2 };
+        for ( int i = 0; i < 2; ++i )
+        {
+            const Node& child = m_nodes[ children[ i ] ];
+
+            const float childArea = getArea( min( child.min, leafMin ), max( child.max, leafMax ) );
+
+            childCosts[ i ] = child.isLeaf()
+                ? childArea + inheritanceCost
+                : childArea - getArea( child.min, child.max ) + inheritanceCost;
+        }
+
+        if ( cost < childCosts[ 0 ] && cost < childCosts[ 1 ] )
+            break;
+
+        sibling = childCosts[ 0 ] < childCosts[ 1 ] ? node.child1 : node.child2;
+    }
+
+    // Create a new parent for the sibling and the leaf.
+    const int oldParent = m_nodes[ sibling ].parent;
+    const int newParent = allocateNode();
+
+    m_nodes[ newParent ].parent = oldParent;
+    m_nodes[ newParent ].min    = min( leafMin, m_nodes[ sibling ].min );
+    m_nodes[ newParent ].max    = max( leafMax, m_nodes[ sibling ].max );
+    m_nodes[ newParent ].height = m_nodes[ sibling ].height + 1;
+    m_nodes[ newParent ].child1 = sibling;
+    m_nodes[ newParent ].child2 = leaf;
+
+    if ( oldParent != s_nullNode ) {
+        if ( m_nodes[ oldParent ].child1 == sibling )
+            m_nodes[ oldParent ].child1 = newParent;
+        else
+            m_nodes[ oldParent ].child2 = newParent;
+    } else {
+        m_root = newParent;
+    }
+
+    m_nodes[ sibling ].parent = newParent;
+    m_nodes[ leaf ].parent    = newParent;
+
+    // Fix heights and boxes of the ancestors.
+    for ( int node = m_nodes[ leaf ].parent; node != s_nullNode; node = m_nodes[ node ].parent )
+    {
+        node = balance( node );
+
+        const Node& child1 = m_nodes[ m_nodes[ node ].child1 ];
+        const Node& child2 = m_nodes[ m_nodes[ node ].child2 ];
+
+        m_nodes[ node ].height = 1 + std::max( child1.height, child2.height );
+        m_nodes[ node ].min    = min( child1.min, child2.min );
+        m_nodes[ node ].max    = max( child1.max, child2.max );
+    }
+}
+
+void DynamicAabbTree::removeLeaf( const int leaf )
+{
+    if ( leaf == m_root ) {
+        m_root = s_nullNode;
+        return;
+    }
+
+    const int parent      = m_nodes[ leaf ].parent;
+    const int grandParent = m_nodes[ parent ].parent;
+    const int sibling     = m_nodes[ parent ].child1 == leaf ? m_nodes[ parent ].child2 : m_nodes[ parent ].child1;
+
+    // Replace the parent with the sibling.
+    if ( grandParent != s_nullNode )
+    {
+        if ( m_nodes[ grandParent ].child1 == parent )
+            m_nodes[ grandParent ].child1 = sibling;
+        else
+            m_nodes[ grandParent ].child2 = sibling;
+
+        m_nodes[ sibling ].parent = grandParent;
+        freeNode( parent );
+
+        for ( int node = grandParent; node != s_nullNode; node = m_nodes[ node ].parent )
+        {
+            node = balance( node );
+
+            const Node& child1 = m_nodes[ m_nodes[ node ].child1 ];
+            const Node& child2 = m_nodes[ m_nodes[ node ].child2 ];
+
+            m_nodes[ node ].height = 1 + std::max( child1.height, child2.height );
+            m_nodes[ node ].min    = min( child1.min, child2.min );
+            m_nodes[ node ].max    = max( child1.max, child2.max );
+        }
+    }
+    else
+    {
+        m_root = sibling;
+        m_nodes[ sibling ].parent = s_nullNode;
+        freeNode( parent );
+    }
+
+    m_nodes[ leaf ].parent = s_nullNode;
+}
+
+int DynamicAabbTree::balance( const int a )
+{
+    // Node a with children b and c - if one of them is higher by more than 1, its higher child takes a's place.
+    if ( m_nodes[ a ].isLeaf() || m_nodes[ a ].height < 2 )
+        return a;
+
+    const int b = m_nodes[ a ].child1;
+    const int c = m_nodes[ a ].child2;
+
+    const int heightDifference = m_nodes[ c ].height - m_nodes[ b ].height;
+
+    if ( heightDifference >= -1 && heightDifference <= 1 )
+        return a;
+
+    // Higher child (rotated up) and the other one.
+    const int high = heightDifference > 1 ? c : b;
+    const int low  = heightDifference > 1 ? b : c;
+
+    const int f = m_nodes[ high ].child1;
+    const int g = m_nodes[ high ].child2;
+
+    // Swap a and high.
+    m_nodes[ high ].child1 = a;
+    m_nodes[ high ].parent = m_nodes[ a ].parent;
+    m_nodes[ a ].parent    = high;
+
+    if ( m_nodes[ high ].parent != s_nullNode ) {
+        if ( m_nodes[ m_nodes[ high ].parent ].child1 == a )
+            m_nodes[ m_nodes[ high ].parent ].child1 = high;
+        else
+            m_nodes[ m_nodes[ high ].parent ].child2 = high;
+    } else {
+        m_root = high;
+    }
+
+    // The higher grandchild stays under high, the lower one goes under a.
+    const int keep = m_nodes[ f ].height > m_nodes[ g ].height ? f : g;
+    const int move = keep == f ? g : f;
+
+    m_nodes[ high ].child2 = keep;
+
+    if ( high == c )
+        m_nodes[ a ].child2 = move;
+    else
+        m_nodes[ a ].child1 = move;
+
+    m_nodes[ move ].parent = a;
+
+    m_nodes[ a ].min    = min( m_nodes[ low ].min, m_nodes[ move ].min );
+    m_nodes[ a ].max    = max( m_nodes[ low ].max, m_nodes[ move ].max );
+    m_nodes[ a ].height = 1 + std::max( m_nodes[ low ].height, m_nodes[ move ].height );
+
+    m_nodes[ high ].min    = min( m_nodes[ a ].min, m_nodes[ keep ].min );
+    m_nodes[ high ].max    = max( m_nodes[ a ].max, m_nodes[ keep ].max );
+    m_nodes[ high ].height = 1 + std::max( m_nodes[ a ].height, m_nodes[ keep ].height );
+
+    return high;
+}
+
+void DynamicAabbTree::checkProxy( const int proxy, const char* errorMessage ) const
+{
+    if ( proxy < 0 || proxy >= (int)m_nodes.size() || m_nodes[ proxy ].height != 0 )
+        throw std::exception( errorMessage );
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+
+#include "float3.h"
+#include "float44.h"
+#include "BoundingBox.h"
+
+namespace Engine1
+{
+    // Bounding volume hierarchy over moving boxes - finds the ones in a box, in a view frustum, along a ray or nearest to a point
+    // without testing all of them. Each leaf (proxy) keeps its exact box and a "fat" box enlarged by a margin. The tree only changes
+    // when the exact box leaves the fat box, so small moves (animation, physics) are cheap. Leaves are inserted next to the node which
+    // increases the surface area of the tree the least and rotations keep the tree balanced (as in Box2D's dynamic tree).
+    class DynamicAabbTree
+    {
+        public:
+
+        static const int s_nullNode;
+
+        DynamicAabbTree( const float margin = 0.2f );
+        ~DynamicAabbTree();
+
+        // Removes all the proxies.
+        void clear();
+
+        // Returns the proxy id - stays the same until the proxy is destroyed. User data is what the queries return.
+        int  createProxy( const BoundingBox& box, const int userData );
+        void destroyProxy( const int proxy );
+
+        // Returns true if the box left the fat box and the proxy was reinserted.
+        bool moveProxy( const int proxy, const BoundingBox& box );
+
+        int         getUserData( const int proxy ) const;
+        BoundingBox getBoundingBox( const int proxy ) const;
+        BoundingBox getFatBoundingBox( const int proxy ) const;
+
+        int getProxyCount() const;
+
+        // Longest path from the root to a leaf. 0 for an empty tree or a single proxy.
+        int getHeight() const;
+
+        // Queries test the exact boxes of the proxies and append user data of the found ones to the result. They don't modify the tree,
+        // so they can run in parallel with each other (but not with clear, createProxy, destroyProxy or moveProxy).
+
+        void queryBox( const BoundingBox& box, std::vector< int >& result ) const;
+
+        // viewProjection - world to clip space (p * view * projection), D3D clip space (0 <= z <= w).
+        void queryFrustum( const float44& viewProjection, std::vector< int >& result ) const;
+
+        // Up to count proxies nearest to the point, nearest first. Distance is measured to the box - 0 if the point is inside.
+        void queryNearest( const float3& point, const int count, std::vector< int >& result ) const;
+
+        // Calls callback( userData, distance ) for the proxies whose boxes the ray enters before maxDistance, in no particular order.
+        // Callback returns the new max distance - e.g. distance of a hit found by a precise test, so farther proxies are skipped.
+        void rayCast( const float3& origin, const float3& direction, const float maxDistance, const std::function< float( int, float ) >& callback ) const;
+
+        private:
+
+        struct Node
+        {
+            bool isLeaf() const;
+
+            // Fat box for leaves.
+            float3 min;
+            float3 max;
+
+            // Exact box - leaves only.
+            float3 boxMin;
+            float3 boxMax;
+
+            // Next free node for nodes in the free list.
+            int parent;
+            int child1;
+            int child2;
+
+            // 0 for leaves, -1 for free nodes.
+            int height;
+            int userData;
+        };
+
+        int  allocateNode();
+        void freeNode( const int node );
+
+        void insertLeaf( const int leaf );
+        void removeLeaf( const int leaf );
+
+        // Rotates the subtree if it's unbalanced. Returns the new root of the subtree.
+        int balance( const int node );
+
+        void checkProxy( const int proxy, const char* errorMessage ) const;
+
+        float m_margin;
+
+        std::vector< Node > m_nodes;
+        int                 m_root;
+        int                 m_freeList;
+        int                 m_proxyCount;
+    };
+}
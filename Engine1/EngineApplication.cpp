@@ -516,6 +516,10 @@ void EngineApplication::onKeyPress( int key )
     if ( key == InputManager::Keys::spacebar && ctrlPressed && shiftPressed )
         Settings::modify().debug.snappingMode = !settings().debug.snappingMode;
 
+    // [Ctrl + Shift + F12] - Capture render commands of the next frame and log their statistics.
+    if ( key == InputManager::Keys::f12 && ctrlPressed && shiftPressed )
+        m_renderer.captureNextFrame();
+
     // [left/right] - Select next/prev actor or light.
     if ( key == InputManager::Keys::right )
         m_sceneManager.selectNext();
@@ -766,12 +770,7 @@ bool EngineApplication::onFrame( const double frameTimeMs, const bool lockCursor
 
     bool modifyingScene = false;
 
-    const auto frameTimeS = (frameTimeMs / 1000.0);
-
-    m_sceneManager.getLightAnimator().update( (float)frameTimeS * settings().animation.lightsPlaybackSpeed );
-    m_sceneManager.getCameraAnimator().update( (float)frameTimeS * settings().animation.cameraPlaybackSpeed );
-    m_sceneManager.getActorAnimator().update( (float)frameTimeS * settings().animation.actorsPlaybackSpeed );
-    m_sceneManager.getModelAnimator().update( (float)frameTimeS * settings().animation.actorsPlaybackSpeed );
+    // Animators are updated by Application::run - together with physics, on worker threads.
 
     // Set renderer exposure from settings.
     m_renderer.setExposure( settings().rendering.postProcess.exposure );
@@ -918,19 +917,6 @@ bool EngineApplication::onFrame( const double frameTimeMs, const bool lockCursor
     m_inputManager.lockCursor( lockCursor );
     m_inputManager.updateMouseState();
 
-    { // Update animations.
-        const std::unordered_set< std::shared_ptr<Actor> >& sceneActors = m_sceneManager.getScene()->getActors();
-
-        for ( const std::shared_ptr<Actor>& actor : sceneActors ) {
-            if ( actor->getType() != Actor::Type::SkeletonActor )
-                continue;
-
-            const std::shared_ptr< SkeletonActor > skeletonActor = std::dynamic_pointer_cast<SkeletonActor>( actor );
-
-            skeletonActor->updateAnimation( (float)frameTimeMs / 1000.0f );
-        }
-    }
-
     { // Update color multipliers from Settings.
         auto& selectedBlockActors = m_sceneManager.getSelectedBlockActors();
         auto& selectedSkeletonActors = m_sceneManager.getSelectedSkeletonActors();
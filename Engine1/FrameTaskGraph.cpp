@@ -0,0 +1,258 @@
+#include "FrameTaskGraph.h"
+
+#include <algorithm>
+
+#include "JobSystem.h"
+
+using namespace Engine1;
+
+FrameTaskGraph::FrameTaskGraph() :
+    FrameTaskGraph( JobSystem::get() )
+{}
+
+FrameTaskGraph::FrameTaskGraph( JobSystem& jobSystem ) :
+    m_jobSystem( jobSystem ),
+    m_finishedTaskCount( 0 )
+{
+    m_statistics = Statistics();
+}
+
+FrameTaskGraph::~FrameTaskGraph()
+{}
+
+void FrameTaskGraph::clear()
+{
+    m_tasks.clear();
+    m_taskOrder.clear();
+    m_taskStatistics.clear();
+
+    m_statistics = Statistics();
+}
+
+int FrameTaskGraph::addTask( const std::string& name, const std::function< void() >& function, const bool mainThread )
+{
+    Task task;
+    task.name              = name;
+    task.function          = function;
+    task.mainThread        = mainThread;
+    task.prerequisiteCount = 0;
+
+    m_tasks.push_back( task );
+    m_taskOrder.clear();
+
+    return (int)m_tasks.size() - 1;
+}
+
+void FrameTaskGraph::addDependency( const int task, const int prerequisite )
+{
+    checkTask( task, "FrameTaskGraph::addDependency - task index out of range." );
+    checkTask( prerequisite, "FrameTaskGraph::addDependency - prerequisite index out of range." );
+
+    if ( task == prerequisite )
+        throw std::exception( "FrameTaskGraph::addDependency - task can't depend on itself." );
+
+    m_tasks[ prerequisite ].dependents.push_back( task );
+    ++m_tasks[ task ].prerequisiteCount;
+
+    m_taskOrder.clear();
+}
+
+void FrameTaskGraph::execute()
+{
+    if ( m_taskOrder.size() != m_tasks.size() )
+        sortTasks();
+
+    const int taskCount = (int)m_tasks.size();
+
+    m_remainingPrerequisiteCounts.resize( taskCount );
+    for ( int taskIdx = 0; taskIdx < taskCount; ++taskIdx )
+        m_remainingPrerequisiteCounts[ taskIdx ] = m_tasks[ taskIdx ].prerequisiteCount;
+
+    m_skipped.assign( taskCount, false );
+    m_taskStatistics.assign( taskCount, TaskStatistics() );
+    m_readyMainThreadTasks.clear();
+    m_finishedTaskCount = 0;
+    m_exception         = nullptr;
+    m_startTime.reset();
+
+    for ( int taskIdx = 0; taskIdx < taskCount; ++taskIdx ) {
+        if ( m_tasks[ taskIdx ].prerequisiteCount == 0 )
+            start( taskIdx );
+    }
+
+    // Run main thread tasks when they become ready, until all the tasks finish.
+    for ( ;; ) {
+        int task = -1;
+
+        {
+            std::unique_lock< std::mutex > lock( m_mutex );
+            m_stateChanged.wait( lock, [ this, taskCount ]() { return !m_readyMainThreadTasks.empty() || m_finishedTaskCount == taskCount; } );
+
+            if ( m_readyMainThreadTasks.empty() )
+                break;
+
+            task = m_readyMainThreadTasks.back();
+            m_readyMainThreadTasks.pop_back();
+        }
+
+        run( task );
+    }
+
+    updateStatistics();
+
+    if ( m_exception )
+        std::rethrow_exception( m_exception );
+}
+
+int FrameTaskGraph::getTaskCount() const
+{
+    return (int)m_tasks.size();
+}
+
+const std::string& FrameTaskGraph::getTaskName( const int task ) const
+{
+    checkTask( task, "FrameTaskGraph::getTaskName - task index out of range." );
+
+    return m_tasks[ task ].name;
+}
+
+const FrameTaskGraph::TaskStatistics& FrameTaskGraph::getTaskStatistics( const int task ) const
+{
+    if ( task < 0 || task >= (int)m_taskStatistics.size() )
+        throw std::exception( "FrameTaskGraph::getTaskStatistics - task index out of range or the graph wasn't executed." );
+
+    return m_taskStatistics[ task ];
+}
+
+const FrameTaskGraph::Statistics& FrameTaskGraph::getStatistics() const
+{
+    return m_statistics;
+}
+
+void FrameTaskGraph::checkTask( const int task, const char* errorMessage ) const
+{
+    if ( task < 0 || task >= (int)m_tasks.size() )
+        throw std::exception( errorMessage );
+}
+
+void FrameTaskGraph::sortTasks()
+{
+    m_taskOrder.clear();
+    m_taskOrder.reserve( m_tasks.size() );
+
+    std::vector< int > prerequisiteCounts( m_tasks.size() );
+    for ( int taskIdx = 0; taskIdx < (int)m_tasks.size(); ++taskIdx ) {
+        prerequisiteCounts[ taskIdx ] = m_tasks[ taskIdx ].prerequisiteCount;
+
+        if ( prerequisiteCounts[ taskIdx ] == 0 )
+            m_taskOrder.push_back( taskIdx );
+    }
+
+    for ( size_t orderIdx = 0; orderIdx < m_taskOrder.size(); ++orderIdx ) {
+        for ( const int dependent : m_tasks[ m_taskOrder[ orderIdx ] ].dependents ) {
+            if ( --prerequisiteCounts[ dependent ] == 0 )
+                m_taskOrder.push_back( dependent );
+        }
+    }
+
+    if ( m_taskOrder.size() != m_tasks.size() ) {
+        m_taskOrder.clear();
+        throw std::exception( "FrameTaskGraph::sortTasks - task dependencies have a cycle." );
+    }
+}
+
+void FrameTaskGraph::start( const int task )
+{
+    // Without worker threads all the tasks run on the calling thread.
+    if ( m_tasks[ task ].mainThread || m_jobSystem.getThreadCount() <= 1 )
+    {
+        {
+            std::lock_guard< std::mutex > lock( m_mutex );
+            m_readyMainThreadTasks.push_back( task );
+        }
+
+        m_stateChanged.notify_all();
+    }
+    else
+    {
+        m_jobSystem.submit( [ this, task ]() { run( task ); } );
+    }
+}
+
+void FrameTaskGraph::run( const int task )
+{
+    bool failed = false;
+
+    if ( !m_skipped[ task ] )
+    {
+        const Timer startTime;
+
+        try {
+            m_tasks[ task ].function();
+        } catch ( ... ) {
+            std::lock_guard< std::mutex > lock( m_mutex );
+
+            failed = true;
+            if ( !m_exception )
+                m_exception = std::current_exception();
+        }
+
+        const Timer endTime;
+
+        m_taskStatistics[ task ].startTime = Timer::getElapsedTime( startTime, m_startTime );
+        m_taskStatistics[ task ].duration  = Timer::getElapsedTime( endTime, startTime );
+    }
+
+    std::vector< int > readyTasks;
+
+    {
+        std::lock_guard< std::mutex > lock( m_mutex );
+
+        for ( const int dependent : m_tasks[ task ].dependents )
+        {
+            // Skipped and failed tasks skip their dependents.
+            if ( m_skipped[ task ] || failed )
+                m_skipped[ dependent ] = true;
+
+            if ( --m_remainingPrerequisiteCounts[ dependent ] == 0 )
+                readyTasks.push_back( dependent );
+        }
+
+        ++m_finishedTaskCount;
+
+        // Notified under the lock - execute may return (and the graph be destroyed) as soon as the lock is released.
+        if ( m_finishedTaskCount == (int)m_tasks.size() )
+            m_stateChanged.notify_all();
+    }
+
+    for ( const int readyTask : readyTasks )
+        start( readyTask );
+}
+
+void FrameTaskGraph::updateStatistics()
+{
+    const Timer endTime;
+
+    m_statistics = Statistics();
+    m_statistics.frameTime   = Timer::getElapsedTime( endTime, m_startTime );
+    m_statistics.threadCount = m_jobSystem.getThreadCount();
+
+    // Time at which each task's chain of prerequisites ends, if all the tasks started as soon as possible.
+    std::vector< double > chainEndTimes( m_tasks.size(), 0.0 );
+
+    for ( const int task : m_taskOrder )
+    {
+        const double duration = m_skipped[ task ] ? 0.0 : m_taskStatistics[ task ].duration;
+
+        m_statistics.busyTime += duration;
+
+        chainEndTimes[ task ] += duration;
+        m_statistics.criticalPathTime = std::max( m_statistics.criticalPathTime, chainEndTimes[ task ] );
+
+        for ( const int dependent : m_tasks[ task ].dependents )
+            chainEndTimes[ dependent ] = std::max( chainEndTimes[ dependent ], chainEndTimes[ task ] );
+    }
+
+    if ( m_statistics.frameTime > 0.0 )
+        m_statistics.coreUtilization = (float)( m_statistics.busyTime / ( m_statistics.frameTime * m_statistics.threadCount ) );
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+#include "Timer.h"
+
+namespace Engine1
+{
+    class JobSystem;
+
+    // Tasks of a frame with dependencies between them. Tasks run on the JobSystem as soon as all their prerequisites finish.
+    // Main thread tasks (e.g. the ones using the D3D11 immediate context or the window) run on the thread calling execute.
+    // The graph is built once and can be executed many times - it's how Application overlaps simulation of the next frame
+    // with render submission of the current one.
+    class FrameTaskGraph
+    {
+        public:
+
+        struct TaskStatistics
+        {
+            // In milliseconds, relative to the start of execute.
+            double startTime;
+            double duration;
+        };
+
+        struct Statistics
+        {
+            // Wall time of execute in milliseconds.
+            double frameTime;
+            // Sum of the task durations.
+            double busyTime;
+            // Longest chain of dependent tasks - frame time with unlimited threads.
+            double criticalPathTime;
+            // Worker threads + the thread calling execute.
+            int    threadCount;
+            // Fraction of the available thread time spent in tasks.
+            float  coreUtilization;
+        };
+
+        // Uses the shared JobSystem instance.
+        FrameTaskGraph();
+        FrameTaskGraph( JobSystem& jobSystem );
+        ~FrameTaskGraph();
+
+        // Removes all the tasks.
+        void clear();
+
+        // Returns the task index.
+        int addTask( const std::string& name, const std::function< void() >& function, const bool mainThread = false );
+
+        // Task won't start before the prerequisite finishes.
+        void addDependency( const int task, const int prerequisite );
+
+        // Runs all the tasks and returns when they finish. Tasks depending on a task which threw are skipped.
+        // Rethrows the first exception thrown by a task. Throws if the dependencies have a cycle.
+        void execute();
+
+        int                getTaskCount() const;
+        const std::string& getTaskName( const int task ) const;
+
+        // Statistics of the last execute.
+        const TaskStatistics& getTaskStatistics( const int task ) const;
+        const Statistics&     getStatistics() const;
+
+        private:
+
+        struct Task
+        {
+            std::string             name;
+            std::function< void() > function;
+            bool                    mainThread;
+            std::vector< int >      dependents;
+            int                     prerequisiteCount;
+        };
+
+        void checkTask( const int task, const char* errorMessage ) const;
+
+        // Throws if the dependencies have a cycle. Fills m_taskOrder.
+        void sortTasks();
+
+        void start( const int task );
+        void run( const int task );
+
+        void updateStatistics();
+
+        JobSystem& m_jobSystem;
+
+        std::vector< Task > m_tasks;
+        // Tasks in an order respecting the dependencies.
+        std::vector< int >  m_taskOrder;
+
+        // State of the current execute.
+        std::mutex                      m_mutex;
+        std::condition_variable         m_stateChanged;
+        std::vector< int >              m_remainingPrerequisiteCounts;
+        std::vector< unsigned char >    m_skipped;
+        std::vector< int >              m_readyMainThreadTasks;
+        int                             m_finishedTaskCount;
+        std::exception_ptr              m_exception;
+        Timer                           m_startTime;
+
+        std::vector< TaskStatistics > m_taskStatistics;
+        Statistics                    m_statistics;
+
+        // Copying is not allowed.
+        FrameTaskGraph( const FrameTaskGraph& ) = delete;
+        FrameTaskGraph& operator=( const FrameTaskGraph& ) = delete;
+    };
+}
@@ -0,0 +1,150 @@
+#include "JobSystem.h"
+
+#include <atomic>
+#include <algorithm>
+#include <exception>
+
+using namespace Engine1;
+
+JobSystem& JobSystem::get()
+{
+    static JobSystem jobSystem( std::max( 1, (int)std::thread::hardware_concurrency() - 1 ) );
+
+    return jobSystem;
+}
+
+JobSystem::JobSystem( const int workerThreadCount ) :
+    m_executeThreads( true )
+{
+    for ( int i = 0; i < workerThreadCount; ++i )
+        m_threads.push_back( std::thread( &JobSystem::executeJobs, this ) );
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard< std::mutex > jobsLock( m_jobsMutex );
+        m_executeThreads = false;
+    }
+
+    m_jobsNotEmpty.notify_all();
+
+    for ( auto& thread : m_threads )
+        thread.join();
+}
+
+int JobSystem::getThreadCount() const
+{
+    return (int)m_threads.size() + 1;
+}
+
+void JobSystem::parallelFor( const int count, const int minChunkSize, const std::function< void( int, int ) >& function )
+{
+    if ( count <= 0 )
+        return;
+
+    const int chunkSize  = std::max( std::max( 1, minChunkSize ), ( count + getThreadCount() * 4 - 1 ) / ( getThreadCount() * 4 ) );
+    const int chunkCount = ( count + chunkSize - 1 ) / chunkSize;
+
+    if ( chunkCount == 1 ) {
+        function( 0, count );
+        return;
+    }
+
+    struct SharedState
+    {
+        std::atomic< int >      nextChunk;
+        std::atomic< int >      processedChunks;
+        std::mutex              mutex;
+        std::condition_variable allProcessed;
+        std::exception_ptr      exception;
+    };
+
+    auto state = std::make_shared< SharedState >();
+    state->nextChunk       = 0;
+    state->processedChunks = 0;
+
+    // Note: function is captured by reference - it's safe, because this method doesn't return before all chunks are processed.
+    // Helpers starting after that find no chunks left and don't touch the function.
+    auto processChunks = [ state, &function, count, chunkSize, chunkCount ]()
+    {
+        for ( ;; ) {
+            const int chunkIdx = state->nextChunk++;
+            if ( chunkIdx >= chunkCount )
+                return;
+
+            try {
+                const int begin = chunkIdx * chunkSize;
+                function( begin, std::min( count, begin + chunkSize ) );
+            } catch ( ... ) {
+                std::lock_guard< std::mutex > lock( state->mutex );
+                if ( !state->exception )
+                    state->exception = std::current_exception();
+            }
+
+            if ( ++state->processedChunks == chunkCount ) {
+                std::lock_guard< std::mutex > lock( state->mutex );
+                state->allProcessed.notify_all();
+            }
+        }
+    };
+
+    { // Let worker threads help with processing the chunks.
+        const int helperCount = std::min( (int)m_threads.size(), chunkCount - 1 );
+
+        std::lock_guard< std::mutex > jobsLock( m_jobsMutex );
+        for ( int i = 0; i < helperCount; ++i )
+            m_jobs.push_back( processChunks );
+    }
+
+    m_jobsNotEmpty.notify_all();
+
+    // Calling thread processes chunks as well.
+    processChunks();
+
+    {
+        std::unique_lock< std::mutex > lock( state->mutex );
+        state->allProcessed.wait( lock, [ &state, chunkCount ]() { return state->processedChunks == chunkCount; } );
+    }
+
+    if ( state->exception )
+        std::rethrow_exception( state->exception );
+}
+
+std::shared_future< void > JobSystem::submit( std::function< void() > job )
+{
+    auto task = std::make_shared< std::packaged_task< void() > >( job );
+
+    std::shared_future< void > future = task->get_future().share();
+
+    {
+        std::lock_guard< std::mutex > jobsLock( m_jobsMutex );
+        m_jobs.push_back( [ task ]() { ( *task )(); } );
+    }
+
+    m_jobsNotEmpty.notify_one();
+
+    return future;
+}
+
+void JobSystem::executeJobs()
+{
+    for ( ;; ) {
+        std::function< void() > job;
+
+        { // Wait for a job - hold lock.
+            std::unique_lock< std::mutex > jobsLock( m_jobsMutex );
+
+            m_jobsNotEmpty.wait( jobsLock, [ this ]() { return !m_jobs.empty() || !m_executeThreads; } );
+
+            // Terminate thread if requested.
+            if ( !m_executeThreads )
+                return;
+
+            job = m_jobs.front();
+            m_jobs.pop_front();
+        }
+
+        job();
+    }
+}
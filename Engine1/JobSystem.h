@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+#include <list>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+namespace Engine1
+{
+    // Pool of worker threads running CPU jobs (asset processing, animation, culling etc.).
+    // parallelFor can be called from inside a job - the calling thread always processes chunks itself, so nested calls can't deadlock.
+    class JobSystem
+    {
+        public:
+
+        // Shared instance using all hardware threads (the thread calling parallelFor counts as one of them).
+        static JobSystem& get();
+
+        JobSystem( const int workerThreadCount );
+        ~JobSystem();
+
+        // Number of threads which can execute jobs in parallel (worker threads + the calling thread).
+        int getThreadCount() const;
+
+        // Splits range [0, count) into chunks of at least minChunkSize elements and calls function( begin, end ) for each chunk in parallel.
+        // Returns when all chunks are processed. Rethrows the first exception thrown by any chunk.
+        void parallelFor( const int count, const int minChunkSize, const std::function< void( int, int ) >& function );
+
+        // Runs the job on one of the worker threads.
+        std::shared_future< void > submit( std::function< void() > job );
+
+        private:
+
+        void executeJobs();
+
+        bool m_executeThreads;
+
+        std::vector< std::thread >              m_threads;
+        std::mutex                              m_jobsMutex;
+        std::condition_variable                 m_jobsNotEmpty;
+        std::list< std::function< void() > >   m_jobs;
+
+        // Copying is not allowed.
+        JobSystem( const JobSystem& ) = delete;
+        JobSystem& operator=( const JobSystem& ) = delete;
+    };
+}
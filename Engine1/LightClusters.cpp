@@ -0,0 +1,439 @@
+#include "LightClusters.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Light.h"
+#include "SpotLight.h"
+#include "MathUtil.h"
+#include "SimdMath.h"
+
+using namespace Engine1;
+
+const int   LightClusters::s_tileCountX        = 16;
+const int   LightClusters::s_tileCountY        = 9;
+const int   LightClusters::s_sliceCount        = 24;
+const int   LightClusters::s_clusterCount      = s_tileCountX * s_tileCountY * s_sliceCount;
+const float LightClusters::s_attenuationCutoff = 0.002f;
+
+namespace
+{
+    // Clusters are tested in groups of 4 - clusters per slice is a multiple of it.
+    const int groupSize = 4;
+
+    struct Sphere
+    {
+        float3 center;
+        float  radius;
+    };
+
+    float3 transformPoint( const float3& point, const float44& transform )
+    {
+        const float4 result = float4( point, 1.0f ) * transform;
+        return float3( result.x, result.y, result.z );
+    }
+
+    float3 transformDirection( const float3& direction, const float44& transform )
+    {
+        const float4 result = float4( direction, 0.0f ) * transform;
+        return float3( result.x, result.y, result.z );
+    }
+
+    // Same as in the shading shaders - remapped, so it reaches zero at the cutoff.
+    float getAttenuation( const Light& light, const float distance )
+    {
+        const float attenuation = 1.0f / ( 1.0f + light.getLinearAttenuationFactor() * distance + light.getQuadraticAttenuationFactor() * distance * distance );
+
+        return std::max( 0.0f, ( attenuation - LightClusters::s_attenuationCutoff ) / ( 1.0f - LightClusters::s_attenuationCutoff ) );
+    }
+
+    float getLuminance( const float3& color )
+    {
+        return color.x * 0.2126f + color.y * 0.7152f + color.z * 0.0722f;
+    }
+}
+
+LightClusters::LightClusters() :
+    m_fieldOfView( 0.0f ),
+    m_aspectRatio( 0.0f ),
+    m_zNear( 0.0f ),
+    m_zFar( 0.0f )
+{
+    m_statistics = Statistics();
+}
+
+LightClusters::~LightClusters()
+{}
+
+float LightClusters::getLightRange( const Light& light )
+{
+    const float linear    = light.getLinearAttenuationFactor();
+    const float quadratic = light.getQuadraticAttenuationFactor();
+
+    // Solve: 1 / ( 1 + linear * d + quadratic * d^2 ) = cutoff.
+    const float constant = 1.0f / s_attenuationCutoff - 1.0f;
+
+    if ( quadratic > 0.0f )
+        return ( -linear + std::sqrt( linear * linear + 4.0f * quadratic * constant ) ) / ( 2.0f * quadratic );
+    else if ( linear > 0.0f )
+        return constant / linear;
+    else
+        return FLT_MAX;
+}
+
+void LightClusters::build( const float44& viewMatrix, const float fieldOfView, const float aspectRatio, const float zNear, const float zFar,
+                           const std::vector< std::shared_ptr< Light > >& lights, const std::vector< BoundingBox >& receivers )
+{
+    if ( lights.size() > 0xFFFF )
+        throw std::exception( "LightClusters::build - too many lights." );
+
+    if ( zNear <= 0.0f || zFar <= zNear )
+        throw std::exception( "LightClusters::build - invalid depth range." );
+
+    updateClusterBounds( fieldOfView, aspectRatio, zNear, zFar );
+    updateClusterVisibility( viewMatrix, receivers );
+
+    const int lightCount          = (int)lights.size();
+    const int clusterCountInSlice = s_tileCountX * s_tileCountY;
+
+    m_lightImportance.assign( lightCount, 0.0f );
+    m_pairs.clear();
+
+    for ( int lightIdx = 0; lightIdx < lightCount; ++lightIdx )
+    {
+        const Light& light = *lights[ lightIdx ];
+
+        Sphere sphere;
+        sphere.center = transformPoint( light.getPosition(), viewMatrix );
+        sphere.radius = getLightRange( light );
+
+        if ( sphere.center.z + sphere.radius < m_zNear || sphere.center.z - sphere.radius > m_zFar )
+            continue;
+
+        bool           isConeUsed = false;
+        MathUtil::Cone cone;
+
+        if ( light.getType() == Light::Type::SpotLight )
+        {
+            const SpotLight& spotLight = static_cast< const SpotLight& >( light );
+
+            std::tie( isConeUsed, cone ) = MathUtil::calculateEmitterCone( sphere.center, transformDirection( spotLight.getDirection(), viewMatrix ), spotLight.getConeAngle(), light.getEmitterRadius() );
+        }
+
+        // Only the slices overlapping the sphere's depth range have to be tested.
+        const int beginCluster = getSlice( sphere.center.z - sphere.radius ) * clusterCountInSlice;
+        const int endCluster   = ( getSlice( sphere.center.z + sphere.radius ) + 1 ) * clusterCountInSlice;
+
+        const float3 lightColor      = light.getColor();
+        const float  lightLuminance  = getLuminance( lightColor );
+        const float  radiusSquare    = sphere.radius * sphere.radius;
+
+        for ( int i = beginCluster; i < endCluster; i += groupSize )
+        {
+            // Distance from the sphere center to the box (zero inside) and optionally from the bounding sphere of the box to the cone.
+#if ENGINE1_MATH_SIMD >= 1
+            const __m128 zero = _mm_setzero_ps();
+
+            const __m128 centerX = _mm_set1_ps( sphere.center.x );
+            const __m128 centerY = _mm_set1_ps( sphere.center.y );
+            const __m128 centerZ = _mm_set1_ps( sphere.center.z );
+
+            const __m128 dx = _mm_max_ps( zero, _mm_max_ps( _mm_sub_ps( _mm_loadu_ps( &m_minX[ i ] ), centerX ), _mm_sub_ps( centerX, _mm_loadu_ps( &m_maxX[ i ] ) ) ) );
+            const __m128 dy = _mm_max_ps( zero, _mm_max_ps( _mm_sub_ps( _mm_loadu_ps( &m_minY[ i ] ), centerY ), _mm_sub_ps( centerY, _mm_loadu_ps( &m_maxY[ i ] ) ) ) );
+            const __m128 dz = _mm_max_ps( zero, _mm_max_ps( _mm_sub_ps( _mm_loadu_ps( &m_minZ[ i ] ), centerZ ), _mm_sub_ps( centerZ, _mm_loadu_ps( &m_maxZ[ i ] ) ) ) );
+
+            const __m128 distanceSquare = _mm_add_ps( _mm_add_ps( _mm_mul_ps( dx, dx ), _mm_mul_ps( dy, dy ) ), _mm_mul_ps( dz, dz ) );
+
+            __m128 intersects = _mm_cmple_ps( distanceSquare, _mm_set1_ps( radiusSquare ) );
+
+            if ( isConeUsed )
+            {
+                const __m128 radius = _mm_loadu_ps( &m_radius[ i ] );
+
+                const __m128 apexToCenterX = _mm_sub_ps( _mm_loadu_ps( &m_centerX[ i ] ), _mm_set1_ps( cone.apex.x ) );
+                const __m128 apexToCenterY = _mm_sub_ps( _mm_loadu_ps( &m_centerY[ i ] ), _mm_set1_ps( cone.apex.y ) );
+                const __m128 apexToCenterZ = _mm_sub_ps( _mm_loadu_ps( &m_centerZ[ i ] ), _mm_set1_ps( cone.apex.z ) );
+
+                const __m128 distanceAlong = _mm_add_ps(
+                    _mm_add_ps( _mm_mul_ps( apexToCenterX, _mm_set1_ps( cone.direction.x ) ), _mm_mul_ps( apexToCenterY, _mm_set1_ps( cone.direction.y ) ) ),
+                    _mm_mul_ps( apexToCenterZ, _mm_set1_ps( cone.direction.z ) )
+                );
+
+                const __m128 lengthSquare = _mm_add_ps(
+                    _mm_add_ps( _mm_mul_ps( apexToCenterX, apexToCenterX ), _mm_mul_ps( apexToCenterY, apexToCenterY ) ),
+                    _mm_mul_ps( apexToCenterZ, apexToCenterZ )
+                );
+
+                const __m128 distanceAcross = _mm_sqrt_ps( _mm_max_ps( zero, _mm_sub_ps( lengthSquare, _mm_mul_ps( distanceAlong, distanceAlong ) ) ) );
+
+                // Distance from the sphere center to the cone surface (as in MathUtil::intersectSphereWithCone).
+                const __m128 distanceToCone = _mm_sub_ps( _mm_mul_ps( _mm_set1_ps( cone.cosAngle ), distanceAcross ), _mm_mul_ps( _mm_set1_ps( cone.sinAngle ), distanceAlong ) );
+
+                intersects = _mm_and_ps( intersects, _mm_cmple_ps( distanceToCone, radius ) );
+                intersects = _mm_and_ps( intersects, _mm_cmpge_ps( distanceAlong, _mm_sub_ps( zero, radius ) ) );
+            }
+
+            const int intersectionMask = _mm_movemask_ps( intersects );
+#else
+            int intersectionMask = 0;
+
+            for ( int lane = 0; lane < groupSize; ++lane )
+            {
+                const int   clusterIdx = i + lane;
+                const float dx         = std::max( 0.0f, std::max( m_minX[ clusterIdx ] - sphere.center.x, sphere.center.x - m_maxX[ clusterIdx ] ) );
+                const float dy         = std::max( 0.0f, std::max( m_minY[ clusterIdx ] - sphere.center.y, sphere.center.y - m_maxY[ clusterIdx ] ) );
+                const float dz         = std::max( 0.0f, std::max( m_minZ[ clusterIdx ] - sphere.center.z, sphere.center.z - m_maxZ[ clusterIdx ] ) );
+
+                bool intersects = dx * dx + dy * dy + dz * dz <= radiusSquare;
+
+                if ( isConeUsed && intersects )
+                    intersects = MathUtil::intersectSphereWithCone( float3( m_centerX[ clusterIdx ], m_centerY[ clusterIdx ], m_centerZ[ clusterIdx ] ), m_radius[ clusterIdx ], cone );
+
+                intersectionMask |= ( intersects ? 1 : 0 ) << lane;
+            }
+#endif
+
+            if ( intersectionMask == 0 )
+                continue;
+
+            for ( int lane = 0; lane < groupSize; ++lane )
+            {
+                if ( !( ( intersectionMask >> lane ) & 1 ) )
+                    continue;
+
+                const int clusterIdx = i + lane;
+
+                m_pairs.push_back( ( clusterIdx << 16 ) | lightIdx );
+
+                if ( m_clusterWeights[ clusterIdx ] > 0.0f )
+                {
+                    const float3 clusterCenter( m_centerX[ clusterIdx ], m_centerY[ clusterIdx ], m_centerZ[ clusterIdx ] );
+
+                    m_lightImportance[ lightIdx ] += m_clusterWeights[ clusterIdx ] * lightLuminance * getAttenuation( light, ( clusterCenter - sphere.center ).length() );
+                }
+            }
+        }
+    }
+
+    // Counting sort of the light-cluster pairs by cluster. Pairs were added light by light, so light indices in each cluster are sorted.
+    m_clusterLightOffsets.assign( s_clusterCount + 1, 0 );
+    m_clusterLightIndices.resize( m_pairs.size() );
+
+    for ( const unsigned int pair : m_pairs )
+        ++m_clusterLightOffsets[ ( pair >> 16 ) + 1 ];
+
+    for ( int clusterIdx = 0; clusterIdx < s_clusterCount; ++clusterIdx )
+        m_clusterLightOffsets[ clusterIdx + 1 ] += m_clusterLightOffsets[ clusterIdx ];
+
+    // Offsets are used as write positions - each ends up at the beginning of the next cluster and is then shifted back.
+    for ( const unsigned int pair : m_pairs )
+        m_clusterLightIndices[ m_clusterLightOffsets[ pair >> 16 ]++ ] = (unsigned short)( pair & 0xFFFF );
+
+    for ( int clusterIdx = s_clusterCount; clusterIdx > 0; --clusterIdx )
+        m_clusterLightOffsets[ clusterIdx ] = m_clusterLightOffsets[ clusterIdx - 1 ];
+
+    m_clusterLightOffsets[ 0 ] = 0;
+
+    m_lightsByImportance.clear();
+    for ( int lightIdx = 0; lightIdx < lightCount; ++lightIdx )
+    {
+        if ( m_lightImportance[ lightIdx ] > 0.0f )
+            m_lightsByImportance.push_back( lightIdx );
+    }
+
+    std::stable_sort( m_lightsByImportance.begin(), m_lightsByImportance.end(), [this]( const int lightIdx1, const int lightIdx2 ) {
+        return m_lightImportance[ lightIdx1 ] > m_lightImportance[ lightIdx2 ];
+    } );
+
+    m_statistics.lightCount            = lightCount;
+    m_statistics.visibleLightCount     = (int)m_lightsByImportance.size();
+    m_statistics.lightClusterPairCount = (int)m_clusterLightIndices.size();
+    m_statistics.visibleClusterCount   = (int)std::count_if( m_clusterWeights.begin(), m_clusterWeights.end(), []( const float weight ) { return weight > 0.0f; } );
+}
+
+void LightClusters::updateClusterBounds( const float fieldOfView, const float aspectRatio, const float zNear, const float zFar )
+{
+    if ( fieldOfView == m_fieldOfView && aspectRatio == m_aspectRatio && zNear == m_zNear && zFar == m_zFar && !m_minX.empty() )
+        return;
+
+    m_fieldOfView = fieldOfView;
+    m_aspectRatio = aspectRatio;
+    m_zNear       = zNear;
+    m_zFar        = zFar;
+
+    for ( std::vector< float >* bounds : { &m_minX, &m_minY, &m_minZ, &m_maxX, &m_maxY, &m_maxZ, &m_centerX, &m_centerY, &m_centerZ, &m_radius } )
+        bounds->resize( s_clusterCount );
+
+    const float tanHalfFovY = std::tan( fieldOfView * 0.5f );
+    const float tanHalfFovX = tanHalfFovY * aspectRatio;
+
+    for ( int slice = 0; slice < s_sliceCount; ++slice )
+    {
+        const float sliceNear = zNear * std::pow( zFar / zNear, (float)slice / (float)s_sliceCount );
+        const float sliceFar  = zNear * std::pow( zFar / zNear, (float)( slice + 1 ) / (float)s_sliceCount );
+
+        for ( int tileY = 0; tileY < s_tileCountY; ++tileY )
+        {
+            // Tile rows go from the top of the screen.
+            const float slopeYMin = ( 1.0f - 2.0f * (float)( tileY + 1 ) / (float)s_tileCountY ) * tanHalfFovY;
+            const float slopeYMax = ( 1.0f - 2.0f * (float)tileY / (float)s_tileCountY ) * tanHalfFovY;
+
+            for ( int tileX = 0; tileX < s_tileCountX; ++tileX )
+            {
+                const float slopeXMin = ( -1.0f + 2.0f * (float)tileX / (float)s_tileCountX ) * tanHalfFovX;
+                const float slopeXMax = ( -1.0f + 2.0f * (float)( tileX + 1 ) / (float)s_tileCountX ) * tanHalfFovX;
+
+                const int clusterIdx = getClusterIndex( tileX, tileY, slice );
+
+                m_minX[ clusterIdx ] = std::min( slopeXMin * sliceNear, slopeXMin * sliceFar );
+                m_maxX[ clusterIdx ] = std::max( slopeXMax * sliceNear, slopeXMax * sliceFar );
+                m_minY[ clusterIdx ] = std::min( slopeYMin * sliceNear, slopeYMin * sliceFar );
+                m_maxY[ clusterIdx ] = std::max( slopeYMax * sliceNear, slopeYMax * sliceFar );
+                m_minZ[ clusterIdx ] = sliceNear;
+                m_maxZ[ clusterIdx ] = sliceFar;
+
+                const float3 boxMin( m_minX[ clusterIdx ], m_minY[ clusterIdx ], m_minZ[ clusterIdx ] );
+                const float3 boxMax( m_maxX[ clusterIdx ], m_maxY[ clusterIdx ], m_maxZ[ clusterIdx ] );
+
+                m_centerX[ clusterIdx ] = ( boxMin.x + boxMax.x ) * 0.5f;
+                m_centerY[ clusterIdx ] = ( boxMin.y + boxMax.y ) * 0.5f;
+                m_centerZ[ clusterIdx ] = ( boxMin.z + boxMax.z ) * 0.5f;
+                m_radius[ clusterIdx ]  = ( boxMax - boxMin ).length() * 0.5f;
+            }
+        }
+    }
+}
+
+void LightClusters::updateClusterVisibility( const float44& viewMatrix, const std::vector< BoundingBox >& receivers )
+{
+    const int tileCount = s_tileCountX * s_tileCountY;
+
+    // Slice count means that nothing is visible in the tile.
+    m_tileFrontSlices.assign( tileCount, s_sliceCount );
+
+    const float tanHalfFovY = std::tan( m_fieldOfView * 0.5f );
+    const float tanHalfFovX = tanHalfFovY * m_aspectRatio;
+
+    for ( const BoundingBox& receiver : receivers )
+    {
+        const float3 boxMin = receiver.getMin();
+        const float3 boxMax = receiver.getMax();
+
+        if ( boxMin.x > boxMax.x )
+            continue;
+
+        float zMin = FLT_MAX, zMax = -FLT_MAX;
+        float slopeXMin = FLT_MAX, slopeXMax = -FLT_MAX, slopeYMin = FLT_MAX, slopeYMax = -FLT_MAX;
+
+        for ( int cornerIdx = 0; cornerIdx < 8; ++cornerIdx )
+        {
+            const float3 corner = transformPoint( float3(
+                cornerIdx & 1 ? boxMax.x : boxMin.x,
+                cornerIdx & 2 ? boxMax.y : boxMin.y,
+                cornerIdx & 4 ? boxMax.z : boxMin.z ), viewMatrix );
+
+            zMin = std::min( zMin, corner.z );
+            zMax = std::max( zMax, corner.z );
+
+            if ( corner.z > 0.0f )
+            {
+                slopeXMin = std::min( slopeXMin, corner.x / corner.z );
+                slopeXMax = std::max( slopeXMax, corner.x / corner.z );
+                slopeYMin = std::min( slopeYMin, corner.y / corner.z );
+                slopeYMax = std::max( slopeYMax, corner.y / corner.z );
+            }
+        }
+
+        if ( zMax < m_zNear || zMin > m_zFar )
+            continue;
+
+        int tileXBegin = 0, tileXEnd = s_tileCountX, tileYBegin = 0, tileYEnd = s_tileCountY;
+
+        // Boxes crossing the near plane may cover any part of the screen.
+        if ( zMin > m_zNear )
+        {
+            if ( slopeXMax < -tanHalfFovX || slopeXMin > tanHalfFovX || slopeYMax < -tanHalfFovY || slopeYMin > tanHalfFovY )
+                continue;
+
+            auto getTile = []( const float coordinate, const int tileCount ) {
+                return std::min( tileCount - 1, std::max( 0, (int)std::floor( coordinate * (float)tileCount ) ) );
+            };
+
+            tileXBegin = getTile( ( slopeXMin / tanHalfFovX + 1.0f ) * 0.5f, s_tileCountX );
+            tileXEnd   = getTile( ( slopeXMax / tanHalfFovX + 1.0f ) * 0.5f, s_tileCountX ) + 1;
+            tileYBegin = getTile( ( 1.0f - slopeYMax / tanHalfFovY ) * 0.5f, s_tileCountY );
+            tileYEnd   = getTile( ( 1.0f - slopeYMin / tanHalfFovY ) * 0.5f, s_tileCountY ) + 1;
+        }
+
+        const int frontSlice = getSlice( zMin );
+
+        for ( int tileY = tileYBegin; tileY < tileYEnd; ++tileY )
+        {
+            for ( int tileX = tileXBegin; tileX < tileXEnd; ++tileX )
+            {
+                int& tileFrontSlice = m_tileFrontSlices[ tileY * s_tileCountX + tileX ];
+                tileFrontSlice = std::min( tileFrontSlice, frontSlice );
+            }
+        }
+    }
+
+    m_clusterWeights.assign( s_clusterCount, 0.0f );
+
+    for ( int tileY = 0; tileY < s_tileCountY; ++tileY )
+    {
+        for ( int tileX = 0; tileX < s_tileCountX; ++tileX )
+        {
+            const int frontSlice = m_tileFrontSlices[ tileY * s_tileCountX + tileX ];
+
+            if ( frontSlice < s_sliceCount )
+                m_clusterWeights[ getClusterIndex( tileX, tileY, frontSlice ) ] = 1.0f / (float)tileCount;
+        }
+    }
+}
+
+int LightClusters::getClusterIndex( const int tileX, const int tileY, const int slice )
+{
+    return ( slice * s_tileCountY + tileY ) * s_tileCountX + tileX;
+}
+
+int LightClusters::getSlice( const float viewDepth ) const
+{
+    if ( viewDepth <= m_zNear )
+        return 0;
+    else if ( viewDepth >= m_zFar )
+        return s_sliceCount - 1;
+
+    const int slice = (int)( std::log( viewDepth / m_zNear ) / std::log( m_zFar / m_zNear ) * (float)s_sliceCount );
+
+    return std::min( s_sliceCount - 1, std::max( 0, slice ) );
+}
+
+const std::vector< unsigned int >& LightClusters::getClusterLightOffsets() const
+{
+    return m_clusterLightOffsets;
+}
+
+const std::vector< unsigned short >& LightClusters::getClusterLightIndices() const
+{
+    return m_clusterLightIndices;
+}
+
+int LightClusters::getClusterLightCount( const int clusterIdx ) const
+{
+    return (int)( m_clusterLightOffsets[ clusterIdx + 1 ] - m_clusterLightOffsets[ clusterIdx ] );
+}
+
+const std::vector< float >& LightClusters::getLightImportance() const
+{
+    return m_lightImportance;
+}
+
+const std::vector< int >& LightClusters::getLightsByImportance() const
+{
+    return m_lightsByImportance;
+}
+
+const LightClusters::Statistics& LightClusters::getStatistics() const
+{
+    return m_statistics;
+}
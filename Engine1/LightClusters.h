@@ -0,0 +1,103 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "float44.h"
+#include "BoundingBox.h"
+
+namespace Engine1
+{
+    class Light;
+
+    // Assigns lights to the clusters of a froxel grid - the view frustum split into screen tiles and exponentially spaced depth slices -
+    // and ranks the lights by their estimated contribution to the visible part of the screen.
+    // Cluster bounds are kept in flat arrays (one per component) and tested against light spheres (and spot light cones) with SIMD, 4 clusters at a time.
+    // Light lists are stored as on the GPU - a flat array of light indices and per-cluster offsets into it.
+    class LightClusters
+    {
+        public:
+
+        static const int s_tileCountX;
+        static const int s_tileCountY;
+        static const int s_sliceCount;
+        static const int s_clusterCount;
+
+        // Same as lightAttenuationFactorCutoff in Shaders/Common/Constants.hlsl - shading ignores lights attenuated below it.
+        static const float s_attenuationCutoff;
+
+        struct Statistics
+        {
+            int lightCount;
+            int visibleLightCount;
+            int lightClusterPairCount;
+            int visibleClusterCount;
+        };
+
+        LightClusters();
+        ~LightClusters();
+
+        // Distance at which the light's attenuation drops below the shading cutoff. FLT_MAX for lights without attenuation.
+        static float getLightRange( const Light& light );
+
+        // viewMatrix - world to view space, fieldOfView - vertical, in radians.
+        // Receivers - world bounding boxes of the visible surfaces (e.g. actors visible from the camera).
+        // Only the front-most cluster covered by some receiver in each tile is visible and counts towards light importance.
+        void build( const float44& viewMatrix, const float fieldOfView, const float aspectRatio, const float zNear, const float zFar,
+                    const std::vector< std::shared_ptr< Light > >& lights, const std::vector< BoundingBox >& receivers );
+
+        // Tile (0, 0) is in the top-left corner of the screen. Slice 0 is the closest to the camera.
+        static int getClusterIndex( const int tileX, const int tileY, const int slice );
+
+        // Slice containing the given view space depth (clamped to the valid range).
+        int getSlice( const float viewDepth ) const;
+
+        // Lights of cluster i are getClusterLightIndices()[ getClusterLightOffsets()[ i ] ] ... [ getClusterLightOffsets()[ i + 1 ] - 1 ],
+        // as indices into the lights passed to build - in increasing order.
+        const std::vector< unsigned int >&   getClusterLightOffsets() const;
+        const std::vector< unsigned short >& getClusterLightIndices() const;
+
+        int getClusterLightCount( const int clusterIdx ) const;
+
+        // Estimated contribution of each light (in the order passed to build) - luminance * attenuation summed over the visible clusters,
+        // weighted by their screen area (fraction of the screen).
+        const std::vector< float >& getLightImportance() const;
+
+        // Indices of the lights which contribute to some visible cluster - the most important first.
+        const std::vector< int >& getLightsByImportance() const;
+
+        // Statistics of the last build.
+        const Statistics& getStatistics() const;
+
+        private:
+
+        void updateClusterBounds( const float fieldOfView, const float aspectRatio, const float zNear, const float zFar );
+        void updateClusterVisibility( const float44& viewMatrix, const std::vector< BoundingBox >& receivers );
+
+        float m_fieldOfView;
+        float m_aspectRatio;
+        float m_zNear;
+        float m_zFar;
+
+        // View space bounds of the clusters - boxes and bounding spheres.
+        std::vector< float > m_minX, m_minY, m_minZ;
+        std::vector< float > m_maxX, m_maxY, m_maxZ;
+        std::vector< float > m_centerX, m_centerY, m_centerZ, m_radius;
+
+        // Fraction of the screen covered by the cluster, if it's the front-most visible cluster in its tile. Zero otherwise.
+        std::vector< float > m_clusterWeights;
+
+        std::vector< unsigned int >   m_clusterLightOffsets;
+        std::vector< unsigned short > m_clusterLightIndices;
+
+        std::vector< float > m_lightImportance;
+        std::vector< int >   m_lightsByImportance;
+
+        // Reused between calls to avoid allocations.
+        std::vector< int >            m_tileFrontSlices;
+        // Light-cluster pairs - cluster index in the high 16 bits, light index in the low 16 bits.
+        std::vector< unsigned int >   m_pairs;
+
+        Statistics m_statistics;
+    };
+}
@@ -0,0 +1,301 @@
+#include "MathBatch.h"
+
+#include "float3.h"
+#include "float43.h"
+#include "float44.h"
+#include "quat.h"
+#include "SimdMath.h"
+
+using namespace Engine1;
+
+// Kernels read float3 and float43 arrays as packed floats.
+static_assert( sizeof( float3 ) == 3 * sizeof( float ), "MathBatch - float3 has to be packed." );
+static_assert( sizeof( float43 ) == 4 * sizeof( float3 ), "MathBatch - float43 has to be packed." );
+
+namespace
+{
+#if ENGINE1_MATH_SIMD >= 1
+    // Converts 4 float3 stored one after another (x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3) into registers holding one component of each.
+    inline void transposeToComponents( const __m128 a, const __m128 b, const __m128 c, __m128& x, __m128& y, __m128& z )
+    {
+        x = _mm_shuffle_ps( a, _mm_shuffle_ps( b, c, _MM_SHUFFLE( 1, 1, 2, 2 ) ), _MM_SHUFFLE( 2, 0, 3, 0 ) );
+        y = _mm_shuffle_ps( _mm_shuffle_ps( a, b, _MM_SHUFFLE( 0, 0, 1, 1 ) ), _mm_shuffle_ps( b, c, _MM_SHUFFLE( 2, 2, 3, 3 ) ), _MM_SHUFFLE( 2, 0, 2, 0 ) );
+        z = _mm_shuffle_ps( _mm_shuffle_ps( a, b, _MM_SHUFFLE( 1, 1, 2, 2 ) ), c, _MM_SHUFFLE( 3, 0, 2, 0 ) );
+    }
+
+    // Inverse of transposeToComponents.
+    inline void transposeToFloat3( const __m128 x, const __m128 y, const __m128 z, __m128& a, __m128& b, __m128& c )
+    {
+        a = _mm_shuffle_ps( _mm_shuffle_ps( x, y, _MM_SHUFFLE( 0, 0, 0, 0 ) ), _mm_shuffle_ps( z, x, _MM_SHUFFLE( 1, 1, 0, 0 ) ), _MM_SHUFFLE( 2, 0, 2, 0 ) );
+        b = _mm_shuffle_ps( _mm_shuffle_ps( y, z, _MM_SHUFFLE( 1, 1, 1, 1 ) ), _mm_shuffle_ps( x, y, _MM_SHUFFLE( 2, 2, 2, 2 ) ), _MM_SHUFFLE( 2, 0, 2, 0 ) );
+        c = _mm_shuffle_ps( _mm_shuffle_ps( z, x, _MM_SHUFFLE( 3, 3, 2, 2 ) ), _mm_shuffle_ps( y, z, _MM_SHUFFLE( 3, 3, 3, 3 ) ), _MM_SHUFFLE( 2, 0, 2, 0 ) );
+    }
+#endif
+
+#if ENGINE1_MATH_SIMD >= 2
+    // Same as above for two groups of 4 float3 - shuffles work within 128-bit lanes.
+    inline void transposeToComponents( const __m256 a, const __m256 b, const __m256 c, __m256& x, __m256& y, __m256& z )
+    {
+        x = _mm256_shuffle_ps( a, _mm256_shuffle_ps( b, c, _MM_SHUFFLE( 1, 1, 2, 2 ) ), _MM_SHUFFLE( 2, 0, 3, 0 ) );
+        y = _mm256_shuffle_ps( _mm256_shuffle_ps( a, b, _MM_SHUFFLE( 0, 0, 1, 1 ) ), _mm256_shuffle_ps( b, c, _MM_SHUFFLE( 2, 2, 3, 3 ) ), _MM_SHUFFLE( 2, 0, 2, 0 ) );
+        z = _mm256_shuffle_ps( _mm256_shuffle_ps( a, b, _MM_SHUFFLE( 1, 1, 2, 2 ) ), c, _MM_SHUFFLE( 3, 0, 2, 0 ) );
+    }
+
+    inline void transposeToFloat3( const __m256 x, const __m256 y, const __m256 z, __m256& a, __m256& b, __m256& c )
+    {
+        a = _mm256_shuffle_ps( _mm256_shuffle_ps( x, y, _MM_SHUFFLE( 0, 0, 0, 0 ) ), _mm256_shuffle_ps( z, x, _MM_SHUFFLE( 1, 1, 0, 0 ) ), _MM_SHUFFLE( 2, 0, 2, 0 ) );
+        b = _mm256_shuffle_ps( _mm256_shuffle_ps( y, z, _MM_SHUFFLE( 1, 1, 1, 1 ) ), _mm256_shuffle_ps( x, y, _MM_SHUFFLE( 2, 2, 2, 2 ) ), _MM_SHUFFLE( 2, 0, 2, 0 ) );
+        c = _mm256_shuffle_ps( _mm256_shuffle_ps( z, x, _MM_SHUFFLE( 3, 3, 2, 2 ) ), _mm256_shuffle_ps( y, z, _MM_SHUFFLE( 3, 3, 3, 3 ) ), _MM_SHUFFLE( 2, 0, 2, 0 ) );
+    }
+#endif
+
+#if ENGINE1_MATH_SIMD >= 1
+    // Loads a float into all lanes - straight from memory with AVX, load and shuffle with SSE.
+    inline __m128 broadcast( const float* value )
+    {
+#if ENGINE1_MATH_SIMD >= 2
+        return _mm_broadcast_ss( value );
+#else
+        return _mm_load1_ps( value );
+#endif
+    }
+#endif
+
+    // Processes the points in groups (8 with AVX, 4 with SSE) - returns the number of processed points, the rest is left for the scalar code.
+    int transformVectors( const float3* vectors, const float43& transform, const bool translate, float3* result, const int count )
+    {
+        int i = 0;
+
+#if ENGINE1_MATH_SIMD >= 2
+        {
+            const __m256 m11 = _mm256_set1_ps( transform.m11 ), m12 = _mm256_set1_ps( transform.m12 ), m13 = _mm256_set1_ps( transform.m13 );
+            const __m256 m21 = _mm256_set1_ps( transform.m21 ), m22 = _mm256_set1_ps( transform.m22 ), m23 = _mm256_set1_ps( transform.m23 );
+            const __m256 m31 = _mm256_set1_ps( transform.m31 ), m32 = _mm256_set1_ps( transform.m32 ), m33 = _mm256_set1_ps( transform.m33 );
+            const __m256 t1  = _mm256_set1_ps( translate ? transform.t1 : 0.0f );
+            const __m256 t2  = _mm256_set1_ps( translate ? transform.t2 : 0.0f );
+            const __m256 t3  = _mm256_set1_ps( translate ? transform.t3 : 0.0f );
+
+            for ( ; i + 8 <= count; i += 8 ) {
+                // Points 0 - 3 go to the lower lanes, points 4 - 7 to the upper lanes.
+                const float* source = &vectors[ i ].x;
+                const __m256 a = _mm256_insertf128_ps( _mm256_castps128_ps256( _mm_loadu_ps( source ) ), _mm_loadu_ps( source + 12 ), 1 );
+                const __m256 b = _mm256_insertf128_ps( _mm256_castps128_ps256( _mm_loadu_ps( source + 4 ) ), _mm_loadu_ps( source + 16 ), 1 );
+                const __m256 c = _mm256_insertf128_ps( _mm256_castps128_ps256( _mm_loadu_ps( source + 8 ) ), _mm_loadu_ps( source + 20 ), 1 );
+
+                __m256 x, y, z;
+                transposeToComponents( a, b, c, x, y, z );
+
+                const __m256 resultX = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( x, m11 ), _mm256_mul_ps( y, m21 ) ), _mm256_add_ps( _mm256_mul_ps( z, m31 ), t1 ) );
+                const __m256 resultY = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( x, m12 ), _mm256_mul_ps( y, m22 ) ), _mm256_add_ps( _mm256_mul_ps( z, m32 ), t2 ) );
+                const __m256 resultZ = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( x, m13 ), _mm256_mul_ps( y, m23 ) ), _mm256_add_ps( _mm256_mul_ps( z, m33 ), t3 ) );
+
+                __m256 resultA, resultB, resultC;
+                transposeToFloat3( resultX, resultY, resultZ, resultA, resultB, resultC );
+
+                float* destination = &result[ i ].x;
+                _mm_storeu_ps( destination,      _mm256_castps256_ps128( resultA ) );
+                _mm_storeu_ps( destination + 4,  _mm256_castps256_ps128( resultB ) );
+                _mm_storeu_ps( destination + 8,  _mm256_castps256_ps128( resultC ) );
+                _mm_storeu_ps( destination + 12, _mm256_extractf128_ps( resultA, 1 ) );
+                _mm_storeu_ps( destination + 16, _mm256_extractf128_ps( resultB, 1 ) );
+                _mm_storeu_ps( destination + 20, _mm256_extractf128_ps( resultC, 1 ) );
+            }
+        }
+#endif
+
+#if ENGINE1_MATH_SIMD >= 1
+        const __m128 m11 = _mm_set1_ps( transform.m11 ), m12 = _mm_set1_ps( transform.m12 ), m13 = _mm_set1_ps( transform.m13 );
+        const __m128 m21 = _mm_set1_ps( transform.m21 ), m22 = _mm_set1_ps( transform.m22 ), m23 = _mm_set1_ps( transform.m23 );
+        const __m128 m31 = _mm_set1_ps( transform.m31 ), m32 = _mm_set1_ps( transform.m32 ), m33 = _mm_set1_ps( transform.m33 );
+        const __m128 t1  = _mm_set1_ps( translate ? transform.t1 : 0.0f );
+        const __m128 t2  = _mm_set1_ps( translate ? transform.t2 : 0.0f );
+        const __m128 t3  = _mm_set1_ps( translate ? transform.t3 : 0.0f );
+
+        for ( ; i + 4 <= count; i += 4 ) {
+            const float* source = &vectors[ i ].x;
+            const __m128 a = _mm_loadu_ps( source );
+            const __m128 b = _mm_loadu_ps( source + 4 );
+            const __m128 c = _mm_loadu_ps( source + 8 );
+
+            __m128 x, y, z;
+            transposeToComponents( a, b, c, x, y, z );
+
+            const __m128 resultX = _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, m11 ), _mm_mul_ps( y, m21 ) ), _mm_add_ps( _mm_mul_ps( z, m31 ), t1 ) );
+            const __m128 resultY = _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, m12 ), _mm_mul_ps( y, m22 ) ), _mm_add_ps( _mm_mul_ps( z, m32 ), t2 ) );
+            const __m128 resultZ = _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, m13 ), _mm_mul_ps( y, m23 ) ), _mm_add_ps( _mm_mul_ps( z, m33 ), t3 ) );
+
+            __m128 resultA, resultB, resultC;
+            transposeToFloat3( resultX, resultY, resultZ, resultA, resultB, resultC );
+
+            float* destination = &result[ i ].x;
+            _mm_storeu_ps( destination,     resultA );
+            _mm_storeu_ps( destination + 4, resultB );
+            _mm_storeu_ps( destination + 8, resultC );
+        }
+#endif
+
+        return i;
+    }
+}
+
+void MathBatch::transformPoints( const float3* points, const float43& transform, float3* result, const int count )
+{
+    for ( int i = transformVectors( points, transform, true, result, count ); i < count; ++i )
+        result[ i ] = points[ i ] * transform;
+}
+
+void MathBatch::transformDirections( const float3* directions, const float43& transform, float3* result, const int count )
+{
+    const float33 rotation = transform.getOrientation();
+
+    for ( int i = transformVectors( directions, transform, false, result, count ); i < count; ++i )
+        result[ i ] = directions[ i ] * rotation;
+}
+
+void MathBatch::normalize( const float3* vectors, float3* result, const int count )
+{
+    int i = 0;
+
+#if ENGINE1_MATH_SIMD >= 1
+    const __m128 one = _mm_set1_ps( 1.0f );
+
+    for ( ; i + 4 <= count; i += 4 ) {
+        const float* source = &vectors[ i ].x;
+
+        __m128 x, y, z;
+        transposeToComponents( _mm_loadu_ps( source ), _mm_loadu_ps( source + 4 ), _mm_loadu_ps( source + 8 ), x, y, z );
+
+        const __m128 lengthInverse = _mm_div_ps( one, _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, x ), _mm_mul_ps( y, y ) ), _mm_mul_ps( z, z ) ) ) );
+
+        __m128 resultA, resultB, resultC;
+        transposeToFloat3( _mm_mul_ps( x, lengthInverse ), _mm_mul_ps( y, lengthInverse ), _mm_mul_ps( z, lengthInverse ), resultA, resultB, resultC );
+
+        float* destination = &result[ i ].x;
+        _mm_storeu_ps( destination,     resultA );
+        _mm_storeu_ps( destination + 4, resultB );
+        _mm_storeu_ps( destination + 8, resultC );
+    }
+#endif
+
+    for ( ; i < count; ++i ) {
+        result[ i ] = vectors[ i ];
+        result[ i ].normalize();
+    }
+}
+
+void MathBatch::multiply( const float43* a, const float43* b, float43* result, const int count )
+{
+    int i = 0;
+
+#if ENGINE1_MATH_SIMD >= 1
+    // Elements of the left matrix are broadcast from memory instead of being shuffled out of registers as in float43::operator*.
+    // Transposing 4 matrices into registers holding one element of each costs more shuffles than the 36 multiplications it would save.
+    for ( ; i < count; ++i ) {
+        const __m128 row1        = _mm_loadu_ps( &b[ i ].m11 );
+        const __m128 row2        = _mm_loadu_ps( &b[ i ].m21 );
+        const __m128 row3        = _mm_loadu_ps( &b[ i ].m31 );
+        const __m128 translation = Simd::loadFloat3( &b[ i ].t1 );
+
+        const float* source = &a[ i ].m11;
+        const __m128 resultRow1 = _mm_add_ps( _mm_add_ps( _mm_mul_ps( broadcast( source ), row1 ), _mm_mul_ps( broadcast( source + 1 ), row2 ) ), _mm_mul_ps( broadcast( source + 2 ), row3 ) );
+        const __m128 resultRow2 = _mm_add_ps( _mm_add_ps( _mm_mul_ps( broadcast( source + 3 ), row1 ), _mm_mul_ps( broadcast( source + 4 ), row2 ) ), _mm_mul_ps( broadcast( source + 5 ), row3 ) );
+        const __m128 resultRow3 = _mm_add_ps( _mm_add_ps( _mm_mul_ps( broadcast( source + 6 ), row1 ), _mm_mul_ps( broadcast( source + 7 ), row2 ) ), _mm_mul_ps( broadcast( source + 8 ), row3 ) );
+        const __m128 resultRow4 = _mm_add_ps( _mm_add_ps( _mm_mul_ps( broadcast( source + 9 ), row1 ), _mm_mul_ps( broadcast( source + 10 ), row2 ) ), _mm_add_ps( _mm_mul_ps( broadcast( source + 11 ), row3 ), translation ) );
+
+        // Last lane of each row store is overwritten by the next row.
+        float* destination = &result[ i ].m11;
+        _mm_storeu_ps( destination,     resultRow1 );
+        _mm_storeu_ps( destination + 3, resultRow2 );
+        _mm_storeu_ps( destination + 6, resultRow3 );
+        Simd::storeFloat3( destination + 9, resultRow4 );
+    }
+#endif
+
+    for ( ; i < count; ++i )
+        result[ i ] = a[ i ] * b[ i ];
+}
+
+void MathBatch::multiply( const float44* a, const float44* b, float44* result, const int count )
+{
+    int i = 0;
+
+#if ENGINE1_MATH_SIMD >= 2
+    // Two rows of the left matrix per register - each row of the right matrix is broadcast to both halves.
+    for ( ; i < count; ++i ) {
+        const __m256 row1 = _mm256_broadcast_ps( reinterpret_cast< const __m128* >( &b[ i ].m11 ) );
+        const __m256 row2 = _mm256_broadcast_ps( reinterpret_cast< const __m128* >( &b[ i ].m21 ) );
+        const __m256 row3 = _mm256_broadcast_ps( reinterpret_cast< const __m128* >( &b[ i ].m31 ) );
+        const __m256 row4 = _mm256_broadcast_ps( reinterpret_cast< const __m128* >( &b[ i ].m41 ) );
+
+        const __m256 rows12 = _mm256_loadu_ps( &a[ i ].m11 );
+        const __m256 rows34 = _mm256_loadu_ps( &a[ i ].m31 );
+
+        const __m256 result12 = _mm256_add_ps(
+            _mm256_add_ps( _mm256_mul_ps( _mm256_permute_ps( rows12, 0x00 ), row1 ), _mm256_mul_ps( _mm256_permute_ps( rows12, 0x55 ), row2 ) ),
+            _mm256_add_ps( _mm256_mul_ps( _mm256_permute_ps( rows12, 0xAA ), row3 ), _mm256_mul_ps( _mm256_permute_ps( rows12, 0xFF ), row4 ) )
+        );
+        const __m256 result34 = _mm256_add_ps(
+            _mm256_add_ps( _mm256_mul_ps( _mm256_permute_ps( rows34, 0x00 ), row1 ), _mm256_mul_ps( _mm256_permute_ps( rows34, 0x55 ), row2 ) ),
+            _mm256_add_ps( _mm256_mul_ps( _mm256_permute_ps( rows34, 0xAA ), row3 ), _mm256_mul_ps( _mm256_permute_ps( rows34, 0xFF ), row4 ) )
+        );
+
+        _mm256_storeu_ps( &result[ i ].m11, result12 );
+        _mm256_storeu_ps( &result[ i ].m31, result34 );
+    }
+#endif
+
+    for ( ; i < count; ++i )
+        result[ i ] = a[ i ] * b[ i ];
+}
+
+void MathBatch::multiply( const quat* a, const quat* b, quat* result, const int count )
+{
+    int i = 0;
+
+#if ENGINE1_MATH_SIMD >= 1
+    // Quaternions are transposed, so each register holds one component of 4 quaternions - no shuffles needed in the products.
+    for ( ; i + 4 <= count; i += 4 ) {
+        __m128 aw = _mm_loadu_ps( &a[ i ].w );
+        __m128 ax = _mm_loadu_ps( &a[ i + 1 ].w );
+        __m128 ay = _mm_loadu_ps( &a[ i + 2 ].w );
+        __m128 az = _mm_loadu_ps( &a[ i + 3 ].w );
+        _MM_TRANSPOSE4_PS( aw, ax, ay, az );
+
+        __m128 bw = _mm_loadu_ps( &b[ i ].w );
+        __m128 bx = _mm_loadu_ps( &b[ i + 1 ].w );
+        __m128 by = _mm_loadu_ps( &b[ i + 2 ].w );
+        __m128 bz = _mm_loadu_ps( &b[ i + 3 ].w );
+        _MM_TRANSPOSE4_PS( bw, bx, by, bz );
+
+        __m128 resultW = _mm_sub_ps( _mm_sub_ps( _mm_mul_ps( aw, bw ), _mm_mul_ps( ax, bx ) ), _mm_add_ps( _mm_mul_ps( ay, by ), _mm_mul_ps( az, bz ) ) );
+        __m128 resultX = _mm_sub_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( aw, bx ), _mm_mul_ps( ax, bw ) ), _mm_mul_ps( az, by ) ), _mm_mul_ps( ay, bz ) );
+        __m128 resultY = _mm_sub_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( aw, by ), _mm_mul_ps( ay, bw ) ), _mm_mul_ps( ax, bz ) ), _mm_mul_ps( az, bx ) );
+        __m128 resultZ = _mm_sub_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( aw, bz ), _mm_mul_ps( az, bw ) ), _mm_mul_ps( ay, bx ) ), _mm_mul_ps( ax, by ) );
+        _MM_TRANSPOSE4_PS( resultW, resultX, resultY, resultZ );
+
+        _mm_storeu_ps( &result[ i ].w, resultW );
+        _mm_storeu_ps( &result[ i + 1 ].w, resultX );
+        _mm_storeu_ps( &result[ i + 2 ].w, resultY );
+        _mm_storeu_ps( &result[ i + 3 ].w, resultZ );
+    }
+#endif
+
+    for ( ; i < count; ++i )
+        result[ i ] = a[ i ] * b[ i ];
+}
+
+void MathBatch::multiply( const float43* matrices, const float43& transform, float43* result, const int count )
+{
+    // Matrices are arrays of 4 rows - all rows are transformed as directions and then the translation is added to the last row of each matrix.
+    const int    transformedCount = transformVectors( reinterpret_cast< const float3* >( matrices ), transform, false, reinterpret_cast< float3* >( result ), count * 4 ) / 4;
+    const float3 translation      = transform.getTranslation();
+
+    for ( int i = 0; i < transformedCount; ++i ) {
+        result[ i ].t1 += translation.x;
+        result[ i ].t2 += translation.y;
+        result[ i ].t3 += translation.z;
+    }
+
+    for ( int i = transformedCount; i < count; ++i )
+        result[ i ] = matrices[ i ] * transform;
+}
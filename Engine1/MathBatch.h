@@ -0,0 +1,34 @@
+#pragma once
+
+namespace Engine1
+{
+    class float3;
+    class float43;
+    class float44;
+    class quat;
+
+    // Batched kernels for the math types - 4 elements per instruction with SSE, 8 with AVX (see SimdMath.h for the backend selection).
+    // Results are the same as applying the corresponding operators one element at a time.
+    // Result arrays may be the same as one of the input arrays, but may not partially overlap them.
+    class MathBatch
+    {
+        public:
+
+        // result[ i ] = points[ i ] * transform
+        static void transformPoints( const float3* points, const float43& transform, float3* result, const int count );
+
+        // Ignores the translation of the transform. Directions are not normalized.
+        static void transformDirections( const float3* directions, const float43& transform, float3* result, const int count );
+
+        // Same as float3::normalize - vectors have to be non-zero.
+        static void normalize( const float3* vectors, float3* result, const int count );
+
+        // result[ i ] = a[ i ] * b[ i ]
+        static void multiply( const float43* a, const float43* b, float43* result, const int count );
+        static void multiply( const float44* a, const float44* b, float44* result, const int count );
+        static void multiply( const quat* a, const quat* b, quat* result, const int count );
+
+        // result[ i ] = matrices[ i ] * transform
+        static void multiply( const float43* matrices, const float43& transform, float43* result, const int count );
+    };
+}
@@ -7,6 +7,8 @@
 
 #include "BlockActor.h"
 #include "BlockModel.h"
+#include "SkeletonActor.h"
+#include "SkeletonModel.h"
 
 using namespace Engine1;
 
@@ -328,6 +330,38 @@ std::tuple< bool, float > MathUtil::intersectRayWithBlockActor( const float3& ra
     return std::make_tuple( hit, hitDistance );
 }
 
+std::tuple< bool, float > MathUtil::intersectRayWithSkeletonActor( const float3& rayOriginWorld, const float3& rayDirWorld, const SkeletonActor& actor, const float maxDist )
+{
+    if ( !actor.getModel() || !actor.getModel()->getMesh() )
+        return std::make_tuple( false, 0.0f );
+
+    const float43& worldToLocalMatrix = actor.getPose().getScaleOrientationTranslationInverse();
+
+    const float3 rayOriginLocal = rayOriginWorld * worldToLocalMatrix;
+    const float3 rayDirLocal    = ((rayOriginWorld + rayDirWorld) * worldToLocalMatrix) - rayOriginLocal;
+
+    const SkeletonBoneBounds& boneBounds = actor.getBoneBounds();
+
+    if ( boneBounds.isEmpty() )
+    {
+        bool  hit         = false;
+        float hitDistance = FLT_MAX;
+        std::tie( hit, hitDistance ) = intersectRayWithBoundingBox( rayOriginLocal, rayDirLocal, actor.getModel()->getMesh()->getBoundingBox() );
+
+        if ( !hit || hitDistance > maxDist )
+            return std::make_tuple( false, 0.0f );
+
+        return std::make_tuple( true, hitDistance );
+    }
+
+    bool          hit         = false;
+    float         hitDistance = FLT_MAX;
+    unsigned char boneIndex   = 0;
+    std::tie( hit, hitDistance, boneIndex ) = boneBounds.intersectRay( rayOriginLocal, rayDirLocal, maxDist );
+
+    return std::make_tuple( hit, hitDistance );
+}
+
 bool MathUtil::rayTriangleIntersect( const float3& rayOrigin, const float3& rayDir, 
                                      const float3& vertexPos1, const float3& vertexPos2, const float3& vertexPos3 )
 {
@@ -390,30 +424,19 @@ uint64_t MathUtil::ceilToNextPowerOfTwo( uint64_t value )
 
 BoundingBox MathUtil::boundingBoxLocalToWorld( const BoundingBox& bboxInLocalSpace, const float43& bboxPose )
 {
-    const float3 localMin = bboxInLocalSpace.getMin();
-    const float3 localMax = bboxInLocalSpace.getMax();
-
-    float3 worldMin( FLT_MAX, FLT_MAX, FLT_MAX );
-    float3 worldMax( -FLT_MAX, -FLT_MAX, -FLT_MAX );
-
-    std::array< float3, 8 > vertexWorldPositions;
-
-    // Calculate vertex positions in world space for all 8 corners of the bounding box.
-    vertexWorldPositions[ 0 ] = localMin * bboxPose;
-    vertexWorldPositions[ 1 ] = float3( localMax.x, localMin.y, localMin.z ) * bboxPose;
-    vertexWorldPositions[ 2 ] = float3( localMax.x, localMin.y, localMax.z ) * bboxPose;
-    vertexWorldPositions[ 3 ] = float3( localMin.x, localMin.y, localMax.z ) * bboxPose;
-    vertexWorldPositions[ 4 ] = float3( localMin.x, localMax.y, localMin.z ) * bboxPose;
-    vertexWorldPositions[ 5 ] = float3( localMax.x, localMax.y, localMin.z ) * bboxPose;
-    vertexWorldPositions[ 6 ] = localMax * bboxPose;
-    vertexWorldPositions[ 7 ] = float3( localMin.x, localMax.y, localMax.z ) * bboxPose;
-
-    for ( const float3& vertexPosition : vertexWorldPositions ) {
-        worldMin = min( worldMin, vertexPosition );
-        worldMax = max( worldMax, vertexPosition );
-    }
-
-    return BoundingBox( worldMin, worldMax );
+    // Transform the center and project the half-extents onto the world axes (absolute values of the rotation/scale part),
+    // which gives the same box as transforming all 8 corners.
+    const float3 center = bboxInLocalSpace.getCenter();
+    const float3 extent = bboxInLocalSpace.getDimensions() * 0.5f;
+
+    const float3 worldCenter = center * bboxPose;
+    const float3 worldExtent(
+        std::abs( bboxPose.m11 ) * extent.x + std::abs( bboxPose.m21 ) * extent.y + std::abs( bboxPose.m31 ) * extent.z,
+        std::abs( bboxPose.m12 ) * extent.x + std::abs( bboxPose.m22 ) * extent.y + std::abs( bboxPose.m32 ) * extent.z,
+        std::abs( bboxPose.m13 ) * extent.x + std::abs( bboxPose.m23 ) * extent.y + std::abs( bboxPose.m33 ) * extent.z
+    );
+
+    return BoundingBox( worldCenter - worldExtent, worldCenter + worldExtent );
 }
 
 bool MathUtil::intersectBoundingBoxes( const BoundingBox& bbBox1, const BoundingBox& bbBox2 )
@@ -431,4 +454,30 @@ bool MathUtil::intersectBoundingBoxes( const BoundingBox& bbBox1, const Bounding
     if ( min1.z > max2.z ) return false;
 
     return true;
+}
+
+std::tuple< bool, MathUtil::Cone > MathUtil::calculateEmitterCone( const float3& lightPosition, const float3& lightDirection, const float coneAngle, const float emitterRadius )
+{
+    Cone cone;
+    cone.direction = lightDirection;
+    cone.direction.normalize();
+    cone.sinAngle  = std::sin( coneAngle );
+    cone.cosAngle  = std::cos( coneAngle );
+    cone.apex      = lightPosition - cone.direction * ( emitterRadius / std::max( cone.sinAngle, epsilonFifty ) );
+
+    return std::make_tuple( coneAngle < piHalf, cone );
+}
+
+bool MathUtil::intersectSphereWithCone( const float3& sphereCenter, const float sphereRadius, const Cone& cone )
+{
+    const float3 apexToCenter  = sphereCenter - cone.apex;
+    const float  distanceAlong = dot( apexToCenter, cone.direction );
+
+    if ( distanceAlong < -sphereRadius )
+        return false;
+
+    const float distanceAcross = std::sqrt( std::max( 0.0f, apexToCenter.lengthSquare() - distanceAlong * distanceAlong ) );
+
+    // Distance from the sphere center to the cone surface.
+    return cone.cosAngle * distanceAcross - cone.sinAngle * distanceAlong <= sphereRadius;
 }
\ No newline at end of file
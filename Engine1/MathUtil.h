@@ -19,6 +19,7 @@
 namespace Engine1
 {
     class BlockActor;
+    class SkeletonActor;
 
     namespace MathUtil
     {
@@ -82,6 +83,9 @@ namespace Engine1
 
         std::tuple< bool, float > intersectRayWithBlockActor( const float3& rayOriginWorld, const float3& rayDirWorld, const BlockActor& actor, const float maxDist = FLT_MAX );
 
+        // Tests the ray against the bone bounds of the actor in its current skeleton pose (or against the mesh box if the mesh has no bone boxes).
+        std::tuple< bool, float > intersectRayWithSkeletonActor( const float3& rayOriginWorld, const float3& rayDirWorld, const SkeletonActor& actor, const float maxDist = FLT_MAX );
+
         bool rayTriangleIntersect( const float3& rayOrigin, const float3& rayDir, const float3& vertexPos1, const float3& vertexPos2, const float3& vertexPos3 );
         float calcDistToTriangle( const float3& rayOrigin, const float3& rayDir, const float3& vertexPos1, const float3& vertexPos2, const float3& vertexPos3 );
 
@@ -92,6 +96,21 @@ namespace Engine1
         BoundingBox boundingBoxLocalToWorld( const BoundingBox& bboxInLocalSpace, const float43& bboxPose );
 
         bool intersectBoundingBoxes( const BoundingBox& bbBox1, const BoundingBox& bbBox2 );
+
+        struct Cone
+        {
+            float3 apex;
+            float3 direction;
+            float  sinAngle;
+            float  cosAngle;
+        };
+
+        // Cone containing the whole spherical emitter of a spot light - apex moved back, so the cone surface passes the emitter's edge.
+        // Returns false if the cone is not narrower than a half-space (intersectSphereWithCone is not valid for such cones).
+        std::tuple< bool, Cone > calculateEmitterCone( const float3& lightPosition, const float3& lightDirection, const float coneAngle, const float emitterRadius );
+
+        // Conservative test - may report an intersection for spheres close to the apex, behind the cone.
+        bool intersectSphereWithCone( const float3& sphereCenter, const float sphereRadius, const Cone& cone );
     }
 
     template< typename T >
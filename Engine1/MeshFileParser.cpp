@@ -239,8 +239,6 @@ std::vector< std::shared_ptr<SkeletonMesh> > MeshFileParser::parseSkeletonMeshFi
             mesh.m_triangles.push_back( *reinterpret_cast<uint3*>( aimesh.mFaces[ i ].mIndices ) );
         }
 
-        mesh.bonesPerVertexCount = BonesPerVertexCount::Type::FOUR;  //TODO: should be deduced from the file.
-
         { // Get bind pose for each bone.
             for ( unsigned int boneIndex = 1; boneIndex <= aimesh.mNumBones; ++boneIndex ) {
                 aiBone& aibone = *aimesh.mBones[ boneIndex - 1 ];
@@ -272,15 +270,11 @@ std::vector< std::shared_ptr<SkeletonMesh> > MeshFileParser::parseSkeletonMeshFi
             }
         }
 
-        { // Allocate memory for bones' weights and indices, zero the memory.
-            const int count = (int)mesh.m_vertices.size() * static_cast<int>( mesh.bonesPerVertexCount );
-            mesh.m_vertexBones.reserve( count );
-            mesh.m_vertexWeights.reserve( count );
-            for ( int i = 0; i < count; ++i ) {
-                mesh.m_vertexBones.push_back( 0 );
-                mesh.m_vertexWeights.push_back( 0.0f );
-            }
-        }
+        // Build the bone hierarchy once all the bones are added - so later it's only read (possibly from many threads).
+        mesh.updateBoneHierarchy();
+
+        // Allocate memory for bones' weights and indices, zero the memory.
+        mesh.setBonesPerVertexCount( BonesPerVertexCount::Type::FOUR ); //TODO: should be deduced from the file.
 
         { // Assign the bones to the vertices.
             for ( unsigned int boneIndex = 1; boneIndex <= aimesh.mNumBones && boneIndex < 256; ++boneIndex ) {
@@ -2,11 +2,24 @@
 
 #include "BlockMesh.h"
 #include "float43.h"
+#include "MathBatch.h"
+#include "JobSystem.h"
 
 #include <algorithm>
 
 using namespace Engine1;
 
+const int MeshUtil::s_minVertexCountPerJob = 2048;
+
+namespace
+{
+    // Determinant of the linear part of the transform - negative for transforms which mirror geometry.
+    float getDeterminant( const float43& transform )
+    {
+        return dot( transform.getRow1(), cross( transform.getRow2(), transform.getRow3() ) );
+    }
+}
+
 std::shared_ptr< BlockMesh > MeshUtil::mergeMeshes( const std::vector< std::shared_ptr< BlockMesh > >& meshes, const std::vector< float43 >& transforms )
 {
     if ( meshes.empty() )
@@ -51,14 +64,27 @@ std::shared_ptr< BlockMesh > MeshUtil::mergeMeshes( const std::vector< std::shar
 
         const int meshVertexCount = (int)mesh->getVertices().size();
 
-        std::memcpy( &mergedMesh->getVertices()[ vertexIndexShift ], mesh->getVertices().data(), meshVertexCount * sizeof( float3 ) );
-        std::memcpy( &mergedMesh->getNormals()[ vertexIndexShift ], mesh->getNormals().data(), meshVertexCount * sizeof( float3 ) );
-        std::memcpy( &mergedMesh->getTangents()[ vertexIndexShift ], mesh->getTangents().data(), meshVertexCount * sizeof( float3 ) );
+        if ( transforms.empty() )
+        {
+            std::memcpy( &mergedMesh->getVertices()[ vertexIndexShift ], mesh->getVertices().data(), meshVertexCount * sizeof( float3 ) );
 
-        // Transform newly merged vertices.
-        if ( !transforms.empty() )
+            if ( hasNormalsTangents ) {
+                std::memcpy( &mergedMesh->getNormals()[ vertexIndexShift ], mesh->getNormals().data(), meshVertexCount * sizeof( float3 ) );
+                std::memcpy( &mergedMesh->getTangents()[ vertexIndexShift ], mesh->getTangents().data(), meshVertexCount * sizeof( float3 ) );
+            }
+        }
+        else
         {
-            MeshUtil::transformVertices( *mergedMesh, transforms[meshIdx], vertexIndexShift, vertexIndexShift + meshVertexCount );
+            // Transform vertices straight into the merged mesh.
+            MeshUtil::transformVertices( 
+                mesh->getVertices().data(), 
+                hasNormalsTangents ? mesh->getNormals().data() : nullptr, 
+                hasNormalsTangents ? mesh->getTangents().data() : nullptr, 
+                meshVertexCount, transforms[ meshIdx ],
+                &mergedMesh->getVertices()[ vertexIndexShift ], 
+                hasNormalsTangents ? &mergedMesh->getNormals()[ vertexIndexShift ] : nullptr, 
+                hasNormalsTangents ? &mergedMesh->getTangents()[ vertexIndexShift ] : nullptr
+            );
         }
 
         // Copy texcoords or fill with zeros if not present in input mesh.
@@ -78,6 +104,13 @@ std::shared_ptr< BlockMesh > MeshUtil::mergeMeshes( const std::vector< std::shar
         for ( int triangleIndex = 0; triangleIndex < meshTriangleCount; ++triangleIndex )
             mergedMeshTriangles[ triangleIndexShift + triangleIndex ] = mesh->getTriangles()[ triangleIndex ] + vertexIndexShiftVec;
 
+        // Mirroring transform turns triangles inside out - restore their winding order.
+        if ( !transforms.empty() && getDeterminant( transforms[ meshIdx ] ) < 0.0f )
+        {
+            for ( int triangleIndex = triangleIndexShift; triangleIndex < triangleIndexShift + meshTriangleCount; ++triangleIndex )
+                std::swap( mergedMeshTriangles[ triangleIndex ].x, mergedMeshTriangles[ triangleIndex ].z );
+        }
+
         vertexIndexShift   += (int)mesh->getVertices().size();
         triangleIndexShift += (int)mesh->getTriangles().size();
     }
@@ -125,14 +158,63 @@ void MeshUtil::invertVertexWindingOrder( BlockMesh& mesh )
 
 void MeshUtil::transformVertices( BlockMesh& mesh, const float43& transform, const int startVertexIdx, const int endVertexIndex )
 {
-    const auto rotation = transform.getOrientation();
+    if ( startVertexIdx < 0 || endVertexIndex > (int)mesh.m_vertices.size() || startVertexIdx > endVertexIndex )
+        throw std::exception( "MeshUtil::transformVertices - vertex range is out of bounds." );
 
-    for ( int idx = startVertexIdx; idx <= endVertexIndex; ++idx )
-        mesh.m_vertices[idx] = mesh.m_vertices[idx] * transform;
+    float3* vertices = mesh.m_vertices.data() + startVertexIdx;
+    float3* normals  = mesh.m_normals.empty()  ? nullptr : mesh.m_normals.data() + startVertexIdx;
+    float3* tangents = mesh.m_tangents.empty() ? nullptr : mesh.m_tangents.data() + startVertexIdx;
 
-    for ( int idx = startVertexIdx; idx <= endVertexIndex; ++idx )
-        mesh.m_normals[idx] = mesh.m_normals[idx] * rotation;
+    transformVertices( vertices, normals, tangents, endVertexIndex - startVertexIdx, transform, vertices, normals, tangents );
+}
+
+void MeshUtil::transformVertices( 
+    const float3* vertices, const float3* normals, const float3* tangents, const int vertexCount, const float43& transform, 
+    float3* resultVertices, float3* resultNormals, float3* resultTangents )
+{
+    const float3 row1 = transform.getRow1();
+    const float3 row2 = transform.getRow2();
+    const float3 row3 = transform.getRow3();
+
+    const float mirrorSign = getDeterminant( transform ) < 0.0f ? -1.0f : 1.0f;
+
+    // Rows of the cofactor matrix - the inverse-transpose scaled by the determinant. 
+    // Scale doesn't matter as normals get normalized, but the sign does - it's corrected to match the inverse-transpose.
+    const float3 normalRow1 = cross( row2, row3 ) * mirrorSign;
+    const float3 normalRow2 = cross( row3, row1 ) * mirrorSign;
+    const float3 normalRow3 = cross( row1, row2 ) * mirrorSign;
+
+    const float43 normalTransform(
+        normalRow1.x, normalRow1.y, normalRow1.z,
+        normalRow2.x, normalRow2.y, normalRow2.z,
+        normalRow3.x, normalRow3.y, normalRow3.z,
+        0.0f, 0.0f, 0.0f
+    );
+
+    // Bitangent is reconstructed as cross( tangent, normal ) - mirroring flips it, so tangent is negated to compensate.
+    const float43 tangentTransform(
+        row1.x * mirrorSign, row1.y * mirrorSign, row1.z * mirrorSign,
+        row2.x * mirrorSign, row2.y * mirrorSign, row2.z * mirrorSign,
+        row3.x * mirrorSign, row3.y * mirrorSign, row3.z * mirrorSign,
+        0.0f, 0.0f, 0.0f
+    );
+
+    auto transformChunk = [&]( const int begin, const int end )
+    {
+        const int count = end - begin;
+
+        MathBatch::transformPoints( vertices + begin, transform, resultVertices + begin, count );
 
-    for ( int idx = startVertexIdx; idx <= endVertexIndex; ++idx )
-        mesh.m_tangents[idx] = mesh.m_tangents[idx] * rotation;
-}
\ No newline at end of file
+        if ( normals && resultNormals ) {
+            MathBatch::transformDirections( normals + begin, normalTransform, resultNormals + begin, count );
+            MathBatch::normalize( resultNormals + begin, resultNormals + begin, count );
+        }
+
+        if ( tangents && resultTangents ) {
+            MathBatch::transformDirections( tangents + begin, tangentTransform, resultTangents + begin, count );
+            MathBatch::normalize( resultTangents + begin, resultTangents + begin, count );
+        }
+    };
+
+    JobSystem::get().parallelFor( vertexCount, s_minVertexCountPerJob, transformChunk );
+}
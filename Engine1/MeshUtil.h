@@ -6,6 +6,7 @@
 namespace Engine1
 {
     class BlockMesh;
+    class float3;
     class float43;
 
     class MeshUtil
@@ -19,7 +20,20 @@ namespace Engine1
         static void flipNormals( BlockMesh& mesh );
         static void invertVertexWindingOrder( BlockMesh& mesh );
 
+        static const int s_minVertexCountPerJob;
+
+        // Transforms vertices in range [startVertexIdx, endVertexIndex) in place. Normals and tangents are transformed only if the mesh has them.
         static void transformVertices( BlockMesh& mesh, const float43& transform, const int startVertexIdx, const int endVertexIndex );
+
+        // Positions are transformed by the full transform, normals by the inverse-transpose of its linear part (stay perpendicular 
+        // to surfaces under non-uniform scale) and tangents by its linear part. Normals and tangents are normalized.
+        // For mirroring transforms tangents are negated, so cross( tangent, normal ) keeps pointing the same way relative to the surface.
+        // Normals and tangents may be null (are skipped then). Results may be the same arrays as the inputs.
+        // Vertices are processed in parallel chunks (on the shared JobSystem), each chunk with SIMD.
+        static void transformVertices( 
+            const float3* vertices, const float3* normals, const float3* tangents, const int vertexCount, const float43& transform, 
+            float3* resultVertices, float3* resultNormals, float3* resultTangents 
+        );
     };
 };
 
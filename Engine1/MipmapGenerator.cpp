@@ -0,0 +1,466 @@
+#include "MipmapGenerator.h"
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <emmintrin.h>
+
+#include "uchar4.h"
+#include "float2.h"
+#include "float3.h"
+#include "float4.h"
+#include "JobSystem.h"
+
+using namespace Engine1;
+
+const int MipmapGenerator::s_minPixelCountPerJob = 64 * 64;
+
+namespace
+{
+    // Kaiser filter: taps cover 3 destination pixels (6 source pixels), window shape parameter 4.
+    const int   kaiserTapCount = 6;
+    const float kaiserRadius   = 3.0f;
+    const float kaiserAlpha    = 4.0f;
+
+    // Modified Bessel function of the first kind, order 0.
+    float besselI0( const float x )
+    {
+        float sum  = 1.0f;
+        float term = 1.0f;
+        for ( int k = 1; k < 20; ++k ) {
+            term *= ( x * 0.5f / (float)k ) * ( x * 0.5f / (float)k );
+            sum  += term;
+        }
+
+        return sum;
+    }
+
+    // Weights are the same for each destination pixel - only the source offset changes.
+    struct KaiserWeights
+    {
+        float weights[ kaiserTapCount ];
+
+        KaiserWeights()
+        {
+            const float pi = 3.14159265358979f;
+
+            float sum = 0.0f;
+            for ( int i = 0; i < kaiserTapCount; ++i ) {
+                // Distance from the destination pixel center in source pixels: -2.5, -1.5, ..., 2.5.
+                const float distance = (float)i - ( kaiserTapCount - 1 ) * 0.5f;
+
+                // Sinc with cutoff at half of the source frequency.
+                const float x    = distance * 0.5f * pi;
+                const float sinc = sinf( x ) / x;
+
+                const float t      = distance / kaiserRadius;
+                const float window = besselI0( kaiserAlpha * sqrtf( std::max( 0.0f, 1.0f - t * t ) ) ) / besselI0( kaiserAlpha );
+
+                weights[ i ] = sinc * window;
+                sum += weights[ i ];
+            }
+
+            for ( int i = 0; i < kaiserTapCount; ++i )
+                weights[ i ] /= sum;
+        }
+    };
+
+    const KaiserWeights& getKaiserWeights()
+    {
+        static const KaiserWeights kaiserWeights;
+        return kaiserWeights;
+    }
+
+    struct SrgbTables
+    {
+        static const int linearToSrgbSize = 4096;
+
+        float         srgbToLinear[ 256 ];
+        unsigned char linearToSrgb[ linearToSrgbSize ];
+
+        SrgbTables()
+        {
+            for ( int i = 0; i < 256; ++i ) {
+                const float value = (float)i / 255.0f;
+                srgbToLinear[ i ] = value <= 0.04045f ? value / 12.92f : powf( ( value + 0.055f ) / 1.055f, 2.4f );
+            }
+
+            for ( int i = 0; i < linearToSrgbSize; ++i ) {
+                const float value = (float)i / (float)( linearToSrgbSize - 1 );
+                const float srgb  = value <= 0.0031308f ? value * 12.92f : 1.055f * powf( value, 1.0f / 2.4f ) - 0.055f;
+                linearToSrgb[ i ] = (unsigned char)std::min( 255.0f, std::max( 0.0f, srgb * 255.0f + 0.5f ) );
+            }
+        }
+
+        unsigned char toSrgb( const float linear ) const
+        {
+            const float clamped = std::min( 1.0f, std::max( 0.0f, linear ) );
+            return linearToSrgb[ (int)( clamped * (float)( linearToSrgbSize - 1 ) + 0.5f ) ];
+        }
+    };
+
+    const SrgbTables& getSrgbTables()
+    {
+        static const SrgbTables srgbTables;
+        return srgbTables;
+    }
+
+    // Returns the source row (or column) index used as the second sample - clamped for textures with only one row/column.
+    inline int secondSampleIdx( const int dstIdx, const int srcSize )
+    {
+        return std::min( srcSize - 1, 2 * dstIdx + 1 );
+    }
+
+    // Scalar box filter for one destination row. Truncating integer division matches the original (GPU-independent) CPU mipmaps.
+    void boxRowUchar( const unsigned char* top, const unsigned char* bottom, unsigned char* dst, const int beginX, const int dstWidth, const int srcWidth, const int channelCount )
+    {
+        for ( int x = beginX; x < dstWidth; ++x ) {
+            const int left  = 2 * x * channelCount;
+            const int right = secondSampleIdx( x, srcWidth ) * channelCount;
+
+            for ( int c = 0; c < channelCount; ++c )
+                dst[ x * channelCount + c ] = (unsigned char)( ( (int)top[ left + c ] + (int)top[ right + c ] + (int)bottom[ left + c ] + (int)bottom[ right + c ] ) / 4 );
+        }
+    }
+
+    void boxRowFloat( const float* top, const float* bottom, float* dst, const int beginX, const int dstWidth, const int srcWidth, const int channelCount )
+    {
+        for ( int x = beginX; x < dstWidth; ++x ) {
+            const int left  = 2 * x * channelCount;
+            const int right = secondSampleIdx( x, srcWidth ) * channelCount;
+
+            for ( int c = 0; c < channelCount; ++c )
+                dst[ x * channelCount + c ] = ( top[ left + c ] + top[ right + c ] + bottom[ left + c ] + bottom[ right + c ] ) / 4.0f;
+        }
+    }
+
+    // Processes 4 destination pixels per iteration. Returns index of the first unprocessed destination pixel.
+    int boxRowUchar4Sse( const unsigned char* top, const unsigned char* bottom, unsigned char* dst, const int dstWidth )
+    {
+        const __m128i zero = _mm_setzero_si128();
+
+        int x = 0;
+        for ( ; x + 4 <= dstWidth; x += 4 ) {
+            const __m128i top0    = _mm_loadu_si128( (const __m128i*)( top + x * 8 ) );
+            const __m128i top1    = _mm_loadu_si128( (const __m128i*)( top + x * 8 + 16 ) );
+            const __m128i bottom0 = _mm_loadu_si128( (const __m128i*)( bottom + x * 8 ) );
+            const __m128i bottom1 = _mm_loadu_si128( (const __m128i*)( bottom + x * 8 + 16 ) );
+
+            // Each 16-bit vector holds two source pixels - sum top and bottom rows.
+            const __m128i sum01 = _mm_add_epi16( _mm_unpacklo_epi8( top0, zero ), _mm_unpacklo_epi8( bottom0, zero ) );
+            const __m128i sum23 = _mm_add_epi16( _mm_unpackhi_epi8( top0, zero ), _mm_unpackhi_epi8( bottom0, zero ) );
+            const __m128i sum45 = _mm_add_epi16( _mm_unpacklo_epi8( top1, zero ), _mm_unpacklo_epi8( bottom1, zero ) );
+            const __m128i sum67 = _mm_add_epi16( _mm_unpackhi_epi8( top1, zero ), _mm_unpackhi_epi8( bottom1, zero ) );
+
+            // Sum neighboring pixels - result is in the lower half of each vector.
+            const __m128i dst0 = _mm_add_epi16( sum01, _mm_srli_si128( sum01, 8 ) );
+            const __m128i dst1 = _mm_add_epi16( sum23, _mm_srli_si128( sum23, 8 ) );
+            const __m128i dst2 = _mm_add_epi16( sum45, _mm_srli_si128( sum45, 8 ) );
+            const __m128i dst3 = _mm_add_epi16( sum67, _mm_srli_si128( sum67, 8 ) );
+
+            const __m128i dst01 = _mm_srli_epi16( _mm_unpacklo_epi64( dst0, dst1 ), 2 );
+            const __m128i dst23 = _mm_srli_epi16( _mm_unpacklo_epi64( dst2, dst3 ), 2 );
+
+            _mm_storeu_si128( (__m128i*)( dst + x * 4 ), _mm_packus_epi16( dst01, dst23 ) );
+        }
+
+        return x;
+    }
+
+    // Processes 16 destination pixels per iteration. Returns index of the first unprocessed destination pixel.
+    int boxRowUchar1Sse( const unsigned char* top, const unsigned char* bottom, unsigned char* dst, const int dstWidth )
+    {
+        const __m128i lowByteMask = _mm_set1_epi16( 0x00FF );
+
+        int x = 0;
+        for ( ; x + 16 <= dstWidth; x += 16 ) {
+            __m128i result[ 2 ];
+            for ( int half = 0; half < 2; ++half ) {
+                const __m128i topPixels    = _mm_loadu_si128( (const __m128i*)( top + x * 2 + half * 16 ) );
+                const __m128i bottomPixels = _mm_loadu_si128( (const __m128i*)( bottom + x * 2 + half * 16 ) );
+
+                const __m128i topSum    = _mm_add_epi16( _mm_and_si128( topPixels, lowByteMask ), _mm_srli_epi16( topPixels, 8 ) );
+                const __m128i bottomSum = _mm_add_epi16( _mm_and_si128( bottomPixels, lowByteMask ), _mm_srli_epi16( bottomPixels, 8 ) );
+
+                result[ half ] = _mm_srli_epi16( _mm_add_epi16( topSum, bottomSum ), 2 );
+            }
+
+            _mm_storeu_si128( (__m128i*)( dst + x ), _mm_packus_epi16( result[ 0 ], result[ 1 ] ) );
+        }
+
+        return x;
+    }
+
+    // Note: Summation order is the same as in the scalar version, so results are identical.
+    int boxRowFloat4Sse( const float* top, const float* bottom, float* dst, const int dstWidth )
+    {
+        const __m128 quarter = _mm_set1_ps( 0.25f );
+
+        for ( int x = 0; x < dstWidth; ++x ) {
+            __m128 sum = _mm_add_ps( _mm_loadu_ps( top + x * 8 ), _mm_loadu_ps( top + x * 8 + 4 ) );
+            sum = _mm_add_ps( sum, _mm_loadu_ps( bottom + x * 8 ) );
+            sum = _mm_add_ps( sum, _mm_loadu_ps( bottom + x * 8 + 4 ) );
+
+            _mm_storeu_ps( dst + x * 4, _mm_mul_ps( sum, quarter ) );
+        }
+
+        return dstWidth;
+    }
+
+    int boxRowFloat2Sse( const float* top, const float* bottom, float* dst, const int dstWidth )
+    {
+        const __m128 quarter = _mm_set1_ps( 0.25f );
+
+        int x = 0;
+        for ( ; x + 2 <= dstWidth; x += 2 ) {
+            const __m128 top0    = _mm_loadu_ps( top + x * 4 );
+            const __m128 top1    = _mm_loadu_ps( top + x * 4 + 4 );
+            const __m128 bottom0 = _mm_loadu_ps( bottom + x * 4 );
+            const __m128 bottom1 = _mm_loadu_ps( bottom + x * 4 + 4 );
+
+            // Split into left and right pixels of each 2x2 block.
+            __m128 sum = _mm_add_ps( _mm_shuffle_ps( top0, top1, _MM_SHUFFLE( 1, 0, 1, 0 ) ), _mm_shuffle_ps( top0, top1, _MM_SHUFFLE( 3, 2, 3, 2 ) ) );
+            sum = _mm_add_ps( sum, _mm_shuffle_ps( bottom0, bottom1, _MM_SHUFFLE( 1, 0, 1, 0 ) ) );
+            sum = _mm_add_ps( sum, _mm_shuffle_ps( bottom0, bottom1, _MM_SHUFFLE( 3, 2, 3, 2 ) ) );
+
+            _mm_storeu_ps( dst + x * 2, _mm_mul_ps( sum, quarter ) );
+        }
+
+        return x;
+    }
+
+    int boxRowFloat1Sse( const float* top, const float* bottom, float* dst, const int dstWidth )
+    {
+        const __m128 quarter = _mm_set1_ps( 0.25f );
+
+        int x = 0;
+        for ( ; x + 4 <= dstWidth; x += 4 ) {
+            const __m128 top0    = _mm_loadu_ps( top + x * 2 );
+            const __m128 top1    = _mm_loadu_ps( top + x * 2 + 4 );
+            const __m128 bottom0 = _mm_loadu_ps( bottom + x * 2 );
+            const __m128 bottom1 = _mm_loadu_ps( bottom + x * 2 + 4 );
+
+            // Split into even and odd pixels.
+            __m128 sum = _mm_add_ps( _mm_shuffle_ps( top0, top1, _MM_SHUFFLE( 2, 0, 2, 0 ) ), _mm_shuffle_ps( top0, top1, _MM_SHUFFLE( 3, 1, 3, 1 ) ) );
+            sum = _mm_add_ps( sum, _mm_shuffle_ps( bottom0, bottom1, _MM_SHUFFLE( 2, 0, 2, 0 ) ) );
+            sum = _mm_add_ps( sum, _mm_shuffle_ps( bottom0, bottom1, _MM_SHUFFLE( 3, 1, 3, 1 ) ) );
+
+            _mm_storeu_ps( dst + x, _mm_mul_ps( sum, quarter ) );
+        }
+
+        return x;
+    }
+}
+
+template< typename Function >
+void MipmapGenerator::forEachRows( const int rowCount, const int rowWidth, const Function& function )
+{
+    if ( rowCount * rowWidth < 2 * s_minPixelCountPerJob ) {
+        function( 0, rowCount );
+        return;
+    }
+
+    const int minRowsPerJob = std::max( 1, s_minPixelCountPerJob / std::max( 1, rowWidth ) );
+
+    JobSystem::get().parallelFor( rowCount, minRowsPerJob, function );
+}
+
+void MipmapGenerator::downsample( const unsigned char* src, const int srcWidth, const int srcHeight, unsigned char* dst, const int dstWidth, const int dstHeight, const Options& options )
+{
+    downsampleUchar( src, srcWidth, srcHeight, dst, dstWidth, dstHeight, 1, options );
+}
+
+void MipmapGenerator::downsample( const uchar4* src, const int srcWidth, const int srcHeight, uchar4* dst, const int dstWidth, const int dstHeight, const Options& options )
+{
+    downsampleUchar( (const unsigned char*)src, srcWidth, srcHeight, (unsigned char*)dst, dstWidth, dstHeight, 4, options );
+}
+
+void MipmapGenerator::downsample( const float* src, const int srcWidth, const int srcHeight, float* dst, const int dstWidth, const int dstHeight, const Options& options )
+{
+    downsampleFloat( src, srcWidth, srcHeight, dst, dstWidth, dstHeight, 1, options );
+}
+
+void MipmapGenerator::downsample( const float2* src, const int srcWidth, const int srcHeight, float2* dst, const int dstWidth, const int dstHeight, const Options& options )
+{
+    downsampleFloat( (const float*)src, srcWidth, srcHeight, (float*)dst, dstWidth, dstHeight, 2, options );
+}
+
+void MipmapGenerator::downsample( const float3* src, const int srcWidth, const int srcHeight, float3* dst, const int dstWidth, const int dstHeight, const Options& options )
+{
+    downsampleFloat( (const float*)src, srcWidth, srcHeight, (float*)dst, dstWidth, dstHeight, 3, options );
+}
+
+void MipmapGenerator::downsample( const float4* src, const int srcWidth, const int srcHeight, float4* dst, const int dstWidth, const int dstHeight, const Options& options )
+{
+    downsampleFloat( (const float*)src, srcWidth, srcHeight, (float*)dst, dstWidth, dstHeight, 4, options );
+}
+
+void MipmapGenerator::downsampleUchar( const unsigned char* src, const int srcWidth, const int srcHeight, unsigned char* dst, const int dstWidth, const int dstHeight,
+                                       const int channelCount, const Options& options )
+{
+    if ( dstWidth != std::max( 1, srcWidth / 2 ) || dstHeight != std::max( 1, srcHeight / 2 ) )
+        throw std::exception( "MipmapGenerator::downsampleUchar - destination dimensions don't match source dimensions." );
+
+    const int srcRowSize = srcWidth * channelCount;
+    const int dstRowSize = dstWidth * channelCount;
+
+    // Alpha channel is never gamma-corrected.
+    const bool hasAlpha = channelCount == 4;
+
+    if ( options.filter == Filter::Kaiser )
+    {
+        // Convert to linear floats, filter and convert back.
+        const SrgbTables& srgbTables = getSrgbTables();
+
+        std::vector< float > srcFloat( (size_t)srcRowSize * srcHeight );
+        std::vector< float > dstFloat( (size_t)dstRowSize * dstHeight );
+
+        forEachRows( srcHeight, srcWidth, [ & ]( const int beginY, const int endY ) {
+            for ( int i = beginY * srcRowSize; i < endY * srcRowSize; ++i ) {
+                const bool linear = !options.srgb || ( hasAlpha && i % 4 == 3 );
+                srcFloat[ i ] = linear ? (float)src[ i ] / 255.0f : srgbTables.srgbToLinear[ src[ i ] ];
+            }
+        } );
+
+        downsampleKaiser( srcFloat.data(), srcWidth, srcHeight, dstFloat.data(), dstWidth, dstHeight, channelCount );
+
+        forEachRows( dstHeight, dstWidth, [ & ]( const int beginY, const int endY ) {
+            for ( int i = beginY * dstRowSize; i < endY * dstRowSize; ++i ) {
+                const bool linear = !options.srgb || ( hasAlpha && i % 4 == 3 );
+                dst[ i ] = linear
+                    ? (unsigned char)( std::min( 1.0f, std::max( 0.0f, dstFloat[ i ] ) ) * 255.0f + 0.5f )
+                    : srgbTables.toSrgb( dstFloat[ i ] );
+            }
+        } );
+
+        return;
+    }
+
+    if ( options.srgb )
+    {
+        const SrgbTables& srgbTables = getSrgbTables();
+
+        forEachRows( dstHeight, dstWidth, [ & ]( const int beginY, const int endY ) {
+            for ( int y = beginY; y < endY; ++y ) {
+                const unsigned char* top    = src + (size_t)( 2 * y ) * srcRowSize;
+                const unsigned char* bottom = src + (size_t)secondSampleIdx( y, srcHeight ) * srcRowSize;
+                unsigned char*       dstRow = dst + (size_t)y * dstRowSize;
+
+                for ( int x = 0; x < dstWidth; ++x ) {
+                    const int left  = 2 * x * channelCount;
+                    const int right = secondSampleIdx( x, srcWidth ) * channelCount;
+
+                    for ( int c = 0; c < channelCount; ++c ) {
+                        if ( hasAlpha && c == 3 ) {
+                            dstRow[ x * channelCount + c ] = (unsigned char)( ( (int)top[ left + c ] + (int)top[ right + c ] + (int)bottom[ left + c ] + (int)bottom[ right + c ] ) / 4 );
+                        } else {
+                            const float linear = ( srgbTables.srgbToLinear[ top[ left + c ] ] + srgbTables.srgbToLinear[ top[ right + c ] ]
+                                                   + srgbTables.srgbToLinear[ bottom[ left + c ] ] + srgbTables.srgbToLinear[ bottom[ right + c ] ] ) * 0.25f;
+
+                            dstRow[ x * channelCount + c ] = srgbTables.toSrgb( linear );
+                        }
+                    }
+                }
+            }
+        } );
+
+        return;
+    }
+
+    forEachRows( dstHeight, dstWidth, [ & ]( const int beginY, const int endY ) {
+        for ( int y = beginY; y < endY; ++y ) {
+            const unsigned char* top    = src + (size_t)( 2 * y ) * srcRowSize;
+            const unsigned char* bottom = src + (size_t)secondSampleIdx( y, srcHeight ) * srcRowSize;
+            unsigned char*       dstRow = dst + (size_t)y * dstRowSize;
+
+            // Vector kernels need two source pixels for each destination pixel.
+            int x = 0;
+            if ( srcWidth >= 2 ) {
+                if ( channelCount == 4 )      x = boxRowUchar4Sse( top, bottom, dstRow, dstWidth );
+                else if ( channelCount == 1 ) x = boxRowUchar1Sse( top, bottom, dstRow, dstWidth );
+            }
+
+            boxRowUchar( top, bottom, dstRow, x, dstWidth, srcWidth, channelCount );
+        }
+    } );
+}
+
+void MipmapGenerator::downsampleFloat( const float* src, const int srcWidth, const int srcHeight, float* dst, const int dstWidth, const int dstHeight,
+                                       const int channelCount, const Options& options )
+{
+    if ( dstWidth != std::max( 1, srcWidth / 2 ) || dstHeight != std::max( 1, srcHeight / 2 ) )
+        throw std::exception( "MipmapGenerator::downsampleFloat - destination dimensions don't match source dimensions." );
+
+    // Float textures are assumed to be linear already - sRGB option doesn't apply.
+    if ( options.filter == Filter::Kaiser ) {
+        downsampleKaiser( src, srcWidth, srcHeight, dst, dstWidth, dstHeight, channelCount );
+        return;
+    }
+
+    const int srcRowSize = srcWidth * channelCount;
+    const int dstRowSize = dstWidth * channelCount;
+
+    forEachRows( dstHeight, dstWidth, [ & ]( const int beginY, const int endY ) {
+        for ( int y = beginY; y < endY; ++y ) {
+            const float* top    = src + (size_t)( 2 * y ) * srcRowSize;
+            const float* bottom = src + (size_t)secondSampleIdx( y, srcHeight ) * srcRowSize;
+            float*       dstRow = dst + (size_t)y * dstRowSize;
+
+            int x = 0;
+            if ( srcWidth >= 2 ) {
+                if ( channelCount == 4 )      x = boxRowFloat4Sse( top, bottom, dstRow, dstWidth );
+                else if ( channelCount == 2 ) x = boxRowFloat2Sse( top, bottom, dstRow, dstWidth );
+                else if ( channelCount == 1 ) x = boxRowFloat1Sse( top, bottom, dstRow, dstWidth );
+            }
+
+            boxRowFloat( top, bottom, dstRow, x, dstWidth, srcWidth, channelCount );
+        }
+    } );
+}
+
+void MipmapGenerator::downsampleKaiser( const float* src, const int srcWidth, const int srcHeight, float* dst, const int dstWidth, const int dstHeight, const int channelCount )
+{
+    const float* weights = getKaiserWeights().weights;
+    const int    firstTapOffset = -( kaiserTapCount / 2 - 1 ); // Relative to 2 * dst index.
+
+    // Horizontal pass: srcWidth x srcHeight -> dstWidth x srcHeight.
+    std::vector< float > temp( (size_t)dstWidth * srcHeight * channelCount );
+
+    forEachRows( srcHeight, dstWidth, [ & ]( const int beginY, const int endY ) {
+        for ( int y = beginY; y < endY; ++y ) {
+            const float* srcRow  = src + (size_t)y * srcWidth * channelCount;
+            float*       tempRow = temp.data() + (size_t)y * dstWidth * channelCount;
+
+            for ( int x = 0; x < dstWidth; ++x ) {
+                for ( int c = 0; c < channelCount; ++c ) {
+                    float sum = 0.0f;
+                    for ( int tap = 0; tap < kaiserTapCount; ++tap ) {
+                        const int srcX = std::min( srcWidth - 1, std::max( 0, 2 * x + firstTapOffset + tap ) );
+                        sum += srcRow[ srcX * channelCount + c ] * weights[ tap ];
+                    }
+
+                    tempRow[ x * channelCount + c ] = sum;
+                }
+            }
+        }
+    } );
+
+    // Vertical pass: dstWidth x srcHeight -> dstWidth x dstHeight.
+    const int rowSize = dstWidth * channelCount;
+
+    forEachRows( dstHeight, dstWidth, [ & ]( const int beginY, const int endY ) {
+        for ( int y = beginY; y < endY; ++y ) {
+            float* dstRow = dst + (size_t)y * rowSize;
+
+            std::fill( dstRow, dstRow + rowSize, 0.0f );
+
+            for ( int tap = 0; tap < kaiserTapCount; ++tap ) {
+                const int    srcY    = std::min( srcHeight - 1, std::max( 0, 2 * y + firstTapOffset + tap ) );
+                const float* tempRow = temp.data() + (size_t)srcY * rowSize;
+
+                for ( int i = 0; i < rowSize; ++i )
+                    dstRow[ i ] += tempRow[ i ] * weights[ tap ];
+            }
+        }
+    } );
+}
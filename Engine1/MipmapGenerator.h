@@ -0,0 +1,59 @@
+#pragma once
+
+namespace Engine1
+{
+    class uchar4;
+    class float2;
+    class float3;
+    class float4;
+
+    // Computes mipmap levels of textures stored on CPU - one level from the previous one.
+    // Box filtering uses SSE2 kernels for the common pixel types. Large levels are processed by many threads (rows are split between jobs).
+    class MipmapGenerator
+    {
+        public:
+
+        enum class Filter : char
+        {
+            Box = 0,
+            Kaiser // Kaiser-windowed sinc - sharper than box, but slower.
+        };
+
+        struct Options
+        {
+            Options() : filter( Filter::Box ), srgb( false ) {}
+            Options( const Filter filter, const bool srgb ) : filter( filter ), srgb( srgb ) {}
+
+            Filter filter;
+
+            // Average colors in linear space instead of in gamma space. Affects only 8-bit pixel types (alpha channel of uchar4 is always treated as linear).
+            bool srgb;
+        };
+
+        // Destination dimensions have to be: max( 1, srcWidth / 2 ) x max( 1, srcHeight / 2 ). 
+        // For odd dimensions the last column/row is skipped (same as in the GPU mipmap generation).
+        static void downsample( const unsigned char* src, const int srcWidth, const int srcHeight, unsigned char* dst, const int dstWidth, const int dstHeight, const Options& options = Options() );
+        static void downsample( const uchar4* src, const int srcWidth, const int srcHeight, uchar4* dst, const int dstWidth, const int dstHeight, const Options& options = Options() );
+        static void downsample( const float* src, const int srcWidth, const int srcHeight, float* dst, const int dstWidth, const int dstHeight, const Options& options = Options() );
+        static void downsample( const float2* src, const int srcWidth, const int srcHeight, float2* dst, const int dstWidth, const int dstHeight, const Options& options = Options() );
+        static void downsample( const float3* src, const int srcWidth, const int srcHeight, float3* dst, const int dstWidth, const int dstHeight, const Options& options = Options() );
+        static void downsample( const float4* src, const int srcWidth, const int srcHeight, float4* dst, const int dstWidth, const int dstHeight, const Options& options = Options() );
+
+        private:
+
+        static void downsampleUchar( const unsigned char* src, const int srcWidth, const int srcHeight, unsigned char* dst, const int dstWidth, const int dstHeight, 
+                                     const int channelCount, const Options& options );
+        static void downsampleFloat( const float* src, const int srcWidth, const int srcHeight, float* dst, const int dstWidth, const int dstHeight, 
+                                     const int channelCount, const Options& options );
+
+        // Separable Kaiser filter on linear float data.
+        static void downsampleKaiser( const float* src, const int srcWidth, const int srcHeight, float* dst, const int dstWidth, const int dstHeight, const int channelCount );
+
+        // Calls function( beginRow, endRow ) for all the rows - in parallel if there is enough work.
+        template< typename Function >
+        static void forEachRows( const int rowCount, const int rowWidth, const Function& function );
+
+        // Levels smaller than that are processed on the calling thread only.
+        static const int s_minPixelCountPerJob;
+    };
+}
@@ -4,19 +4,24 @@
 #include <algorithm>
 #include <array>
 #include <memory>
+#include <string>
+#include <cmath>
 
 #include "BlockModel.h"
 
 #include "Texture2DTypes.h"
 #include "TextureUtil.h"
 #include "MeshUtil.h"
+#include "Timer.h"
 
 using namespace Engine1;
 
-std::shared_ptr< BlockModel > ModelUtil::mergeModels( 
+std::vector< std::shared_ptr< BlockModel > > ModelUtil::mergeModels( 
     const std::vector< std::shared_ptr< BlockModel > >& models, 
     const std::vector< float43 >& transforms, 
-    ID3D11Device3& device )
+    ID3D11Device3& device,
+    const TextureAtlasPacker::Options& atlasOptions,
+    MergeStatistics* statistics )
 {
     // We assume that there is one texture of each type (albedo, roughness etc) for each texcoord in each model. Or there may be zero texture of given type for all models.
 
@@ -30,59 +35,20 @@ std::shared_ptr< BlockModel > ModelUtil::mergeModels(
     // 7. Create a texture of needed dimensions for each type.
     // 8. Copy/re-size textures into their placements.
 
-    // #TODO: Adding a border of a few pixels to each sub-texture. Otherwise, textures blend with each other because of bilinear filtering or higher level mipmap sampling during rendering.
+    // Each sub-texture is surrounded by a gutter (repeated edge pixels). Otherwise, textures blend with each other because of bilinear filtering or higher level mipmap sampling during rendering.
+    // Textures which don't fit in a single atlas page are placed on next pages - one merged model is created per page.
 
     if ( !transforms.empty() && transforms.size() != models.size() )
         throw std::exception( "ModelUtil::mergeModels - different number of transforms passed compared to the number of models." );
     // -------------------------------
 
-    // Check that all models have meshes and power-of-two textures.
+    // Check that all models have meshes.
     std::string error;
 
     for ( auto& model : models )
     {
         if ( !model->getMesh() )
             error += "ModelUtil::mergeModels - some models don't have a mesh.\n";
-
-        // Check if all textures have power-of-two dimensions.
-        // #TODO: This limitation should be removed in the future.
-        for ( int textureType = 0; textureType < (int)Model::TextureType::COUNT; ++textureType )
-        {
-            const auto texType = (Model::TextureType)textureType;
-
-            const auto textures = model->getTextures( texType );
-            for ( const auto& texture : textures )
-            {
-                const auto& tex = std::get< 0 >( texture );
-
-                if ( !tex )
-                    continue;
-
-                int2 dimensions( int2::ZERO );
-                if ( texType == Model::TextureType::Alpha
-                    || texType == Model::TextureType::Metalness
-                    || texType == Model::TextureType::Roughness
-                    || texType == Model::TextureType::RefractiveIndex )
-                {
-                    auto& texU = static_cast< Texture2D< unsigned char >& >( *std::get< 0 >( texture ) );
-
-                    dimensions = texU.getDimensions();
-                }
-                else
-                {
-                    auto& texU4 = static_cast< Texture2D< uchar4 >& >( *std::get< 0 >( texture ) );
-
-                    dimensions = texU4.getDimensions();
-                }
-
-                if ( !MathUtil::isPowerOfTwo( dimensions.x ) || !MathUtil::isPowerOfTwo( dimensions.y ) )
-                {
-                    std::string path = std::get< 0 >( texture )->getFileInfo().getPath();
-
-                    error += "ModelUtil::mergeModels - the texture does not have power-of-two dimensions: " + path + "\n";
-                }
-            }
-        }
     }
 
     if ( !error.empty() )
@@ -174,6 +140,8 @@ std::shared_ptr< BlockModel > ModelUtil::mergeModels(
         }
     }
 
+    const Timer packingStartTime;
+
     // Calculate dimensions of each set, which are required to store 
     // the set without loosing resolution for any type of texture.
     std::vector< int2 > textureSetDimensions;
@@ -185,181 +153,255 @@ std::shared_ptr< BlockModel > ModelUtil::mergeModels(
         textureSetDimensions.push_back( textureSet.m_dimensions );
     }
 
-    int2                                       mergedTextureDimensions;
+    const bool hasTextures = maxTextureCount > 0;
+
+    TextureAtlasPacker::Result                 atlasLayout;
     std::vector< std::pair< float2, float2 > > mergedTexturesTexcoords;
 
-    // Calculate where textures need to be placed within the merged texture.
-    std::tie( mergedTextureDimensions, mergedTexturesTexcoords ) 
-        = TextureUtil::prepareTextureMerge( textureSetDimensions );
+    // Calculate where textures need to be placed within the merged textures (and on which page).
+    if ( hasTextures )
+    {
+        std::tie( atlasLayout, mergedTexturesTexcoords ) 
+            = TextureUtil::prepareTextureMerge( textureSetDimensions, atlasOptions );
+    }
+    else
+    {
+        // Nothing to pack - all models go to a single merged model.
+        atlasLayout.pageDimensions.push_back( int2::ZERO );
+        atlasLayout.placements.resize( textureSets.size(), { 0, int2::ZERO } );
+        atlasLayout.usedArea = 0;
+    }
 
-    std::array< std::shared_ptr< Asset >, (int)Model::TextureType::COUNT > mergedTextures;
+    const Timer packingEndTime;
 
-    // For each texture type, iterate over all sets and calculate 
-    // what are the needed merged texture dimensions (per type) 
-    // to fit textures in their texcoord range.
-    // Then, merge the textures of given type.
-    for ( int textureType = 0; textureType < (int)Model::TextureType::COUNT; ++textureType )
+    if ( statistics )
     {
-        const auto texType = (Model::TextureType)textureType;
+        statistics->pageCount         = (int)atlasLayout.pageDimensions.size();
+        statistics->packingEfficiency = atlasLayout.getEfficiency();
+        statistics->packingTime       = Timer::getElapsedTime( packingEndTime, packingStartTime );
+        statistics->textureMergeTime  = 0.0;
+        statistics->meshMergeTime     = 0.0;
+    }
 
-        int2 neededDimensions( int2::ZERO );
-        for ( int textureSetIdx = 0; textureSetIdx < textureSets.size(); ++textureSetIdx )
-        {
-            const auto& textureSet    = textureSets[ textureSetIdx ];
-            const int2  dimensions    = textureSet.getTextureDimensions( texType );
-            const auto& texcoords     = mergedTexturesTexcoords[ textureSetIdx ];
-            const auto  texcoordsSpan = texcoords.second - texcoords.first;
+    std::vector< std::shared_ptr< BlockModel > > mergedModels;
+
+    for ( int pageIndex = 0; pageIndex < (int)atlasLayout.pageDimensions.size(); ++pageIndex )
+    {
+        const Timer textureMergeStartTime;
+
+        const int2 pageDimensions = atlasLayout.pageDimensions[ pageIndex ];
 
-            neededDimensions.x = std::max( (int)((float)dimensions.x * ( 1.0f / texcoordsSpan.x )), neededDimensions.x );
-            neededDimensions.y = std::max( (int)((float)dimensions.y * ( 1.0f / texcoordsSpan.y )), neededDimensions.y );
+        // Texture sets placed on this page.
+        std::vector< int > pageTextureSetIndices;
+        for ( int textureSetIdx = 0; textureSetIdx < (int)textureSets.size(); ++textureSetIdx )
+        {
+            if ( atlasLayout.placements[ textureSetIdx ].pageIndex == pageIndex )
+                pageTextureSetIndices.push_back( textureSetIdx );
         }
 
-        // Gather textures to be merged.
-        std::vector< std::shared_ptr< Asset > > texturesToMerge;
-        std::vector< float4 >                   colorMultipliersToMerge;
-        texturesToMerge.reserve( textureSets.size() );
-        colorMultipliersToMerge.reserve( textureSets.size() );
-        for ( auto& textureSet : textureSets )
+        std::array< std::shared_ptr< Asset >, (int)Model::TextureType::COUNT > mergedTextures;
+
+        // For each texture type, iterate over all sets on the page and calculate 
+        // what are the needed merged texture dimensions (per type) 
+        // to fit textures in their texcoord range.
+        // Then, merge the textures of given type.
+        for ( int textureType = 0; textureType < (int)Model::TextureType::COUNT && hasTextures; ++textureType )
         {
-            auto& texture = textureSet.m_textures[ textureType ];
+            const auto texType = (Model::TextureType)textureType;
 
-            if ( texture )
+            int2 neededDimensions( int2::ZERO );
+            for ( const int textureSetIdx : pageTextureSetIndices )
             {
-                texturesToMerge.push_back( texture );
-                colorMultipliersToMerge.push_back( textureSet.m_colorMultipliers[ textureType ] );
+                const auto& textureSet    = textureSets[ textureSetIdx ];
+                const int2  dimensions    = textureSet.getTextureDimensions( texType );
+                const auto& texcoords     = mergedTexturesTexcoords[ textureSetIdx ];
+                const auto  texcoordsSpan = texcoords.second - texcoords.first;
+
+                neededDimensions.x = std::max( (int)std::round( (float)dimensions.x * ( 1.0f / texcoordsSpan.x ) ), neededDimensions.x );
+                neededDimensions.y = std::max( (int)std::round( (float)dimensions.y * ( 1.0f / texcoordsSpan.y ) ), neededDimensions.y );
             }
-        }
 
-        if ( texturesToMerge.empty() )
-            continue;
+            // Gather textures to be merged.
+            std::vector< std::shared_ptr< Asset > >    texturesToMerge;
+            std::vector< float4 >                      colorMultipliersToMerge;
+            std::vector< std::pair< float2, float2 > > texcoordsToMerge;
+            texturesToMerge.reserve( pageTextureSetIndices.size() );
+            colorMultipliersToMerge.reserve( pageTextureSetIndices.size() );
+            texcoordsToMerge.reserve( pageTextureSetIndices.size() );
+            for ( const int textureSetIdx : pageTextureSetIndices )
+            {
+                auto& textureSet = textureSets[ textureSetIdx ];
+                auto& texture    = textureSet.m_textures[ textureType ];
 
-        // Merge textures.
-        if ( texType == Model::TextureType::Alpha || texType == Model::TextureType::Metalness ||
-             texType == Model::TextureType::Roughness || texType == Model::TextureType::RefractiveIndex ) 
-        {
-            auto texturesToMergeU 
-                = reinterpret_cast< std::vector< std::shared_ptr< Texture2D< unsigned char > > >& >( texturesToMerge );
-
-            mergedTextures[ textureType ] = TextureUtil::mergeTextures( 
-                texturesToMergeU, 
-                colorMultipliersToMerge,
-                mergedTexturesTexcoords, 
-                neededDimensions,
-                device, 
-                DXGI_FORMAT_R8_UNORM, DXGI_FORMAT_R8_UNORM 
-            );
+                if ( texture )
+                {
+                    texturesToMerge.push_back( texture );
+                    colorMultipliersToMerge.push_back( textureSet.m_colorMultipliers[ textureType ] );
+                    texcoordsToMerge.push_back( mergedTexturesTexcoords[ textureSetIdx ] );
+                }
+            }
 
-            // Save temporary merged result - to help in debugging.
-            auto tex = std::dynamic_pointer_cast< Texture2D< unsigned char > >( mergedTextures[ textureType ] );
-            assert(tex);
-            tex->saveToFile( "Temp/merged_temp_" + Model::textureTypeToString( texType ) + ".tif", Texture2DFileInfo::Format::TIFF );
-        } 
-        else 
-        {
-            auto texturesToMergeU4 
-                = reinterpret_cast< std::vector< std::shared_ptr< Texture2D< uchar4 > > >& >( texturesToMerge );
-
-            mergedTextures[ textureType ] = TextureUtil::mergeTextures( 
-                texturesToMergeU4, 
-                colorMultipliersToMerge,
-                mergedTexturesTexcoords, 
-                neededDimensions,
-                device, 
-                DXGI_FORMAT_B8G8R8A8_UNORM, DXGI_FORMAT_B8G8R8A8_UNORM 
+            if ( texturesToMerge.empty() )
+                continue;
+
+            // Gutter is scaled together with the texture type (it may be stored in lower resolution than the set).
+            const int gutter = std::min(
+                atlasOptions.gutter * neededDimensions.x / pageDimensions.x,
+                atlasOptions.gutter * neededDimensions.y / pageDimensions.y
             );
 
-            // Save temporary merged result - to help in debugging.
-            auto tex = std::dynamic_pointer_cast< Texture2D< uchar4 > >( mergedTextures[ textureType ] );
-            assert(tex);
-            tex->saveToFile( "Temp/merged_temp_" + Model::textureTypeToString( texType ) + ".png", Texture2DFileInfo::Format::PNG );
+            const std::string debugFileName = "Temp/merged_temp_" + Model::textureTypeToString( texType ) + "_" + std::to_string( pageIndex );
+
+            // Merge textures.
+            if ( texType == Model::TextureType::Alpha || texType == Model::TextureType::Metalness ||
+                 texType == Model::TextureType::Roughness || texType == Model::TextureType::RefractiveIndex ) 
+            {
+                auto texturesToMergeU 
+                    = reinterpret_cast< std::vector< std::shared_ptr< Texture2D< unsigned char > > >& >( texturesToMerge );
+
+                mergedTextures[ textureType ] = TextureUtil::mergeTextures( 
+                    texturesToMergeU, 
+                    colorMultipliersToMerge,
+                    texcoordsToMerge, 
+                    neededDimensions,
+                    device, 
+                    DXGI_FORMAT_R8_UNORM, DXGI_FORMAT_R8_UNORM,
+                    gutter
+                );
+
+                // Save temporary merged result - to help in debugging.
+                auto tex = std::dynamic_pointer_cast< Texture2D< unsigned char > >( mergedTextures[ textureType ] );
+                assert(tex);
+                tex->saveToFile( debugFileName + ".tif", Texture2DFileInfo::Format::TIFF );
+            } 
+            else 
+            {
+                auto texturesToMergeU4 
+                    = reinterpret_cast< std::vector< std::shared_ptr< Texture2D< uchar4 > > >& >( texturesToMerge );
+
+                mergedTextures[ textureType ] = TextureUtil::mergeTextures( 
+                    texturesToMergeU4, 
+                    colorMultipliersToMerge,
+                    texcoordsToMerge, 
+                    neededDimensions,
+                    device, 
+                    DXGI_FORMAT_B8G8R8A8_UNORM, DXGI_FORMAT_B8G8R8A8_UNORM,
+                    gutter
+                );
+
+                // Save temporary merged result - to help in debugging.
+                auto tex = std::dynamic_pointer_cast< Texture2D< uchar4 > >( mergedTextures[ textureType ] );
+                assert(tex);
+                tex->saveToFile( debugFileName + ".png", Texture2DFileInfo::Format::PNG );
+            }
         }
-    }
 
-    // Gather meshes to be merged.
-    std::vector< std::shared_ptr< BlockMesh > > meshes;
-    meshes.reserve( models.size() );
-    for ( auto& model : models )
-        meshes.push_back( model->getMesh() );
+        const Timer meshMergeStartTime;
 
-    // Merge the meshes.
-    std::shared_ptr< BlockMesh > mergedMesh = MeshUtil::mergeMeshes( meshes, transforms );
+        // Gather models (and their meshes) placed on this page.
+        std::vector< int >                          pageModelIndices;
+        std::vector< std::shared_ptr< BlockMesh > > meshes;
+        std::vector< float43 >                      pageTransforms;
+        for ( int modelIndex = 0; modelIndex < (int)models.size(); ++modelIndex )
+        {
+            if ( atlasLayout.placements[ modelToTextureSetMapping[ modelIndex ] ].pageIndex != pageIndex )
+                continue;
 
-    { // Recalculate merged mesh texcoords to match the merged textures.
-        std::vector< float2 > meshTexcoordOffsets;
-        meshTexcoordOffsets.reserve( meshes.size() );
+            pageModelIndices.push_back( modelIndex );
+            meshes.push_back( models[ modelIndex ]->getMesh() );
 
-        // Check if all texcoords for a given source mesh are zeros -
-        // apply (0.5, 0.5) offset then.
-        // Without such offset texcoords after merge would end up in the top-left corner 
-        // of the input textures in the atlas. That would cause unwanted blending between them when using bilinear sampling.
-        for ( const auto& mesh : meshes )
-        {
-            bool allTexcoordsAreZeros = true;
+            if ( !transforms.empty() )
+                pageTransforms.push_back( transforms[ modelIndex ] );
+        }
+
+        // Merge the meshes.
+        std::shared_ptr< BlockMesh > mergedMesh = MeshUtil::mergeMeshes( meshes, pageTransforms );
+
+        if ( hasTextures )
+        { // Recalculate merged mesh texcoords to match the merged textures.
+            std::vector< float2 > meshTexcoordOffsets;
+            meshTexcoordOffsets.reserve( meshes.size() );
 
-            for ( const auto& texcoord : mesh->getTexcoords() )
+            // Check if all texcoords for a given source mesh are zeros -
+            // apply (0.5, 0.5) offset then.
+            // Without such offset texcoords after merge would end up in the top-left corner 
+            // of the input textures in the atlas. That would cause unwanted blending between them when using bilinear sampling.
+            for ( const auto& mesh : meshes )
             {
-                if ( !MathUtil::areEqual( texcoord, float2::ZERO, 0.0f, 0.0001f ) ) 
+                bool allTexcoordsAreZeros = true;
+
+                for ( const auto& texcoord : mesh->getTexcoords() )
                 {
-                    allTexcoordsAreZeros = false;
-                    break;
+                    if ( !MathUtil::areEqual( texcoord, float2::ZERO, 0.0f, 0.0001f ) ) 
+                    {
+                        allTexcoordsAreZeros = false;
+                        break;
+                    }
                 }
-            }
 
-            meshTexcoordOffsets.push_back( 
-                allTexcoordsAreZeros ? float2::HALF : float2::ZERO
-            );
-        }
-
-        std::vector< float2 >& mergedMeshTexcoords = mergedMesh->getTexcoords( 0 );
+                meshTexcoordOffsets.push_back( 
+                    allTexcoordsAreZeros ? float2::HALF : float2::ZERO
+                );
+            }
 
-        int vertexStartIndex = 0, vertexEndIndex = 0;
+            std::vector< float2 >& mergedMeshTexcoords = mergedMesh->getTexcoords( 0 );
 
-        for ( int modelIndex = 0; modelIndex < models.size(); ++modelIndex ) 
-        {
-            const auto& mesh                = models[ modelIndex ]->getMesh();
-            const auto& extraTexcoordOffset = meshTexcoordOffsets[ modelIndex ];
-            const auto& mergedTexcoords     = mergedTexturesTexcoords[ modelToTextureSetMapping[ modelIndex ] ];
+            int vertexStartIndex = 0, vertexEndIndex = 0;
 
-            vertexEndIndex += (int)mesh->getVertices().size();
-            // Recalculate texcoords.
-            for ( int vertexIndex = vertexStartIndex; vertexIndex < vertexEndIndex; ++vertexIndex )
+            for ( int pageModelIndex = 0; pageModelIndex < (int)pageModelIndices.size(); ++pageModelIndex ) 
             {
-                float2 texcoord = mergedMeshTexcoords[ vertexIndex ];
+                const int   modelIndex          = pageModelIndices[ pageModelIndex ];
+                const auto& mesh                = meshes[ pageModelIndex ];
+                const auto& extraTexcoordOffset = meshTexcoordOffsets[ pageModelIndex ];
+                const auto& mergedTexcoords     = mergedTexturesTexcoords[ modelToTextureSetMapping[ modelIndex ] ];
+
+                vertexEndIndex += (int)mesh->getVertices().size();
+                // Recalculate texcoords.
+                for ( int vertexIndex = vertexStartIndex; vertexIndex < vertexEndIndex; ++vertexIndex )
+                {
+                    float2 texcoord = mergedMeshTexcoords[ vertexIndex ];
 
-                // Wrap UVs to 0-1 range (original ones could be negative, or greater than 1, less then -1).
-                texcoord.x = fmod( texcoord.x, 1.0f );
-                texcoord.y = fmod( texcoord.y, 1.0f );
+                    // Wrap UVs to 0-1 range (original ones could be negative, or greater than 1, less then -1).
+                    texcoord.x = fmod( texcoord.x, 1.0f );
+                    texcoord.y = fmod( texcoord.y, 1.0f );
 
-                if (texcoord.x < 0.0f)
-                    texcoord.x += 1.0f;
+                    if (texcoord.x < 0.0f)
+                        texcoord.x += 1.0f;
 
-                if (texcoord.y < 0.0f)
-                    texcoord.y += 1.0f;
+                    if (texcoord.y < 0.0f)
+                        texcoord.y += 1.0f;
 
-                mergedMeshTexcoords[ vertexIndex ] 
-                    = mergedTexcoords.first + ( texcoord + extraTexcoordOffset ) * (mergedTexcoords.second - mergedTexcoords.first);
+                    mergedMeshTexcoords[ vertexIndex ] 
+                        = mergedTexcoords.first + ( texcoord + extraTexcoordOffset ) * (mergedTexcoords.second - mergedTexcoords.first);
+                }
 
-                // Debug test.
-                //static_cast< Texture2DGeneric< uchar4 >& >( *mergedTextures[ (int)Model::TextureType::Albedo ] ).setDataPixel( 
-                //    mergedMeshTexcoords[ vertexIndex ], uchar4( 255, 0, 0, 255 ), 0 );
+                vertexStartIndex = vertexEndIndex;
             }
+        }
+
+        std::shared_ptr< BlockModel > mergedModel = std::make_shared< BlockModel >();
+        { // Create merged model.
+            mergedModel->setMesh( mergedMesh );
 
-            vertexStartIndex = vertexEndIndex;
+            for ( int textureType = 0; textureType < (int)Model::TextureType::COUNT; ++textureType ) 
+            {
+                if ( mergedTextures[ textureType ] )
+                    mergedModel->addTexture( ( Model::TextureType )textureType, mergedTextures[ textureType ], 0 );
+            }
         }
-    }
 
-    std::shared_ptr< BlockModel > mergedModel = std::make_shared< BlockModel >();
-    { // Create merged model.
-        mergedModel->setMesh( mergedMesh );
+        mergedModels.push_back( mergedModel );
+
+        const Timer meshMergeEndTime;
 
-        for ( int textureType = 0; textureType < (int)Model::TextureType::COUNT; ++textureType ) 
+        if ( statistics )
         {
-            if ( mergedTextures[ textureType ] )
-                mergedModel->addTexture( ( Model::TextureType )textureType, mergedTextures[ textureType ], 0 );
+            statistics->textureMergeTime += Timer::getElapsedTime( meshMergeStartTime, textureMergeStartTime );
+            statistics->meshMergeTime    += Timer::getElapsedTime( meshMergeEndTime, meshMergeStartTime );
         }
     }
 
-    return mergedModel;
+    return mergedModels;
 }
 
 std::string ModelUtil::getDescription( const BlockModel& model, const bool printPath, const bool printDimensions )
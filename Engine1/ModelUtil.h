@@ -6,6 +6,7 @@
 
 #include "MathUtil.h"
 #include "Model.h"
+#include "TextureAtlasPacker.h"
 
 struct ID3D11Device3;
 
@@ -17,10 +18,23 @@ namespace Engine1
     {
         public:
 
-        static std::shared_ptr< BlockModel > mergeModels( 
+        struct MergeStatistics
+        {
+            int    pageCount;
+            float  packingEfficiency; // Ratio of texture area to the total area of atlas pages.
+            double packingTime;       // In milliseconds.
+            double textureMergeTime;  // In milliseconds.
+            double meshMergeTime;     // In milliseconds.
+        };
+
+        // Merges models into a single model per atlas page - textures of all models are packed into atlases
+        // and texcoords of merged meshes are remapped accordingly. Usually all textures fit in a single page.
+        static std::vector< std::shared_ptr< BlockModel > > mergeModels( 
             const std::vector< std::shared_ptr< BlockModel > >& models, 
             const std::vector< float43 >& transforms, 
-            ID3D11Device3& device 
+            ID3D11Device3& device,
+            const TextureAtlasPacker::Options& atlasOptions = TextureAtlasPacker::Options(),
+            MergeStatistics* statistics = nullptr
         );
 
         private: 
@@ -1,181 +1,167 @@
 #include "MyXAFFileParser.h"
 
-#include <sstream>
+#include <cmath>
+#include <algorithm>
+#include <utility>
 
 using namespace Engine1;
 
-std::vector<std::string> MyXAFFileParser::debug;
-
-MyXAFFileParser::MyXAFFileParser() {}
-
-
-MyXAFFileParser::~MyXAFFileParser() {}
-
-void MyXAFFileParser::parseSkeletonAnimationFile( const std::vector<char>& file, const SkeletonMesh& skeletonMesh, SkeletonAnimation& skeletonAnimation, const bool invertZCoordinate ) {
-	// XML parser modifies the input text so copy is needed.
-	std::vector<char> xmlText( file );
-
-	debug.clear();
-
-	rapidxml::xml_document<> xmlDocument;
-	xmlDocument.parse<0>( (char*)xmlText.data( ) );    // 0 means default parse flags.
+namespace
+{
+	const double powersOf10[] = {
+		1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
 
-	SceneInfo sceneInfo;
+	// Highest mantissa which can still be multiplied by 10 and have a digit added without overflow.
+	const unsigned long long maxMantissa = 999999999999999999ull;
 
-	const rapidxml::xml_node<char>* node = xmlDocument.first_node( );
-	
-	// Parse scene info.
-	while ( node )  
+	bool isWhitespace( const char c )
 	{
-		if ( node && nameEquals( *node, "SceneInfo" ) ) {
-			sceneInfo = parseSceneInfo( *node );
-			break;
-		}
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+	}
 
-		node = next( node );
+	bool isDigit( const char c )
+	{
+		return c >= '0' && c <= '9';
 	}
 
-	// Throw if scene info wasn't found.
-	if ( !node )
-		throw std::exception( "MyXAFFileParser::parseSkeletonAnimationFile() - xml node \"SceneInfo\" wasn't found." ); 
-	
-	// Find first "Node" node.
-	node = findNext( xmlDocument.first_node( ), "Node" );
-
-	// Parse all "Node" nodes.
-	while ( node ) {
-		parseNode( *node, sceneInfo, skeletonMesh, skeletonAnimation, invertZCoordinate );
-		node = findNextSibling( node, "Node" );
+	double getPowerOf10( const int exponent )
+	{
+		return exponent < (int)( sizeof( powersOf10 ) / sizeof( powersOf10[ 0 ] ) ) ? powersOf10[ exponent ] : std::pow( 10.0, exponent );
 	}
 }
 
-bool MyXAFFileParser::nameEquals( const rapidxml::xml_node<char>& node, std::string name )
+MyXAFFileParser::MyXAFFileParser() {}
+
+
+MyXAFFileParser::~MyXAFFileParser() {}
+
+void MyXAFFileParser::parseSkeletonAnimationFile( const std::vector<char>& file, const SkeletonMesh& skeletonMesh, SkeletonAnimation& skeletonAnimation, const bool invertZCoordinate )
 {
-	return name.compare( 0, node.name_size(), node.name() ) == 0;
+	// Reader doesn't modify the text - no copy is needed.
+	XmlStreamReader reader( file.data(), file.size() );
+
+	parse( reader, skeletonMesh, skeletonAnimation, invertZCoordinate );
 }
 
-const rapidxml::xml_node<char>* MyXAFFileParser::next( const rapidxml::xml_node<char>* node )
+void MyXAFFileParser::parseSkeletonAnimationFile( std::istream& stream, const SkeletonMesh& skeletonMesh, SkeletonAnimation& skeletonAnimation, const bool invertZCoordinate )
 {
-	if ( !node )
-		return nullptr;
-
-	if ( node->first_node( ) ) 
-		return node->first_node( );
-	else if ( node->next_sibling( ) ) 
-		return node->next_sibling( );
-	else if ( node->parent( ) ) {
-		// Find first parent node which has siblings.
-		while ( node->parent( ) && !node->next_sibling( ) ) 
-			node = node->parent( );
-
-		if ( node->parent() && node->next_sibling() )
-			return node->next_sibling();
-		else
-			return nullptr; // Next node wasn't found.
-	} else {
-		return nullptr;
-	}
+	XmlStreamReader reader( stream );
+
+	parse( reader, skeletonMesh, skeletonAnimation, invertZCoordinate );
 }
 
-const rapidxml::xml_node<char>* MyXAFFileParser::findNext( const rapidxml::xml_node<char>* startNode, std::string name )
+void MyXAFFileParser::parse( XmlStreamReader& reader, const SkeletonMesh& skeletonMesh, SkeletonAnimation& skeletonAnimation, const bool invertZCoordinate )
 {
-	const rapidxml::xml_node<char>* node = startNode;
+	SceneInfo sceneInfo;
+	bool      hasSceneInfo = false;
 
-	while ( node && !nameEquals( *node, name ) )
-		node = next( node );
+	// Depth and bone index of the "Node" elements being parsed (nodes can be nested).
+	std::vector< std::pair< int, unsigned char > > nodes;
 
-	return node;
-}
+	int depth        = 0;
+	int samplesDepth = -1; // Depth of the "Samples" element being parsed.
 
-const rapidxml::xml_node<char>* MyXAFFileParser::findNextSibling( const rapidxml::xml_node<char>* startNode, std::string name )
-{
-	const rapidxml::xml_node<char>* node = startNode->next_sibling();
+	XmlStreamReader::Event event;
+	while ( ( event = reader.next() ) != XmlStreamReader::Event::EndOfDocument )
+	{
+		if ( event == XmlStreamReader::Event::EndElement ) {
+			if ( depth == samplesDepth )
+				samplesDepth = -1;
 
-	while ( node && !nameEquals( *node, name ) )
-		node = node->next_sibling();
+			if ( !nodes.empty() && depth == nodes.back().first )
+				nodes.pop_back();
 
-	return node;
-}
+			--depth;
+			continue;
+		}
 
-MyXAFFileParser::SceneInfo MyXAFFileParser::parseSceneInfo( const rapidxml::xml_node<char>& node )
-{
-	rapidxml::xml_attribute<char>* startTickAttribute     = node.first_attribute( "startTick", 9, true );
-	rapidxml::xml_attribute<char>* endTickAttribute       = node.first_attribute( "endTick", 7, true );
-	rapidxml::xml_attribute<char>* frameRateAttribute     = node.first_attribute( "frameRate", 9, true );
-	rapidxml::xml_attribute<char>* ticksPerFrameAttribute = node.first_attribute( "ticksPerFrame", 13, true );
+		++depth;
 
-	if ( !startTickAttribute || !endTickAttribute || !frameRateAttribute || !ticksPerFrameAttribute )
-		throw std::exception( "MyXAFFileParser::parseSceneInfo() - xml node \"SceneInfo\" misses one or more attributes (\"startTick\", \"endTick\", \"frameRate\", \"ticksPerFrame\")." );
+		const XmlStreamReader::Text& name = reader.getName();
 
-	SceneInfo sceneInfo;
+		if ( depth == samplesDepth + 1 && name.equals( "S" ) ) {
+			parseS( reader, sceneInfo, nodes.back().second, skeletonAnimation, invertZCoordinate );
+		} else if ( name.equals( "Node" ) ) {
+			if ( !hasSceneInfo ) throw std::exception( "MyXAFFileParser::parseSkeletonAnimationFile() - xml node \"SceneInfo\" wasn't found before the first \"Node\"." );
 
-	sceneInfo.startTick     = parseInt( std::string( startTickAttribute->value(), startTickAttribute->value_size() ) );
-	sceneInfo.endTick       = parseInt( std::string( endTickAttribute->value( ), endTickAttribute->value_size( ) ) );
-	sceneInfo.frameRate     = parseInt( std::string( frameRateAttribute->value( ), frameRateAttribute->value_size( ) ) );
-	sceneInfo.ticksPerFrame = parseInt( std::string( ticksPerFrameAttribute->value( ), ticksPerFrameAttribute->value_size( ) ) );
+			nodes.emplace_back( depth, parseNode( reader, skeletonMesh ) );
+		} else if ( name.equals( "Samples" ) && !nodes.empty() && depth == nodes.back().first + 1 ) {
+			samplesDepth = depth;
+		} else if ( name.equals( "SceneInfo" ) && !hasSceneInfo ) {
+			sceneInfo    = parseSceneInfo( reader );
+			hasSceneInfo = true;
 
-	return sceneInfo;
+			// Allocate all the poses up front.
+			if ( sceneInfo.endTick >= sceneInfo.startTick )
+				skeletonAnimation.getOrAddPose( ( sceneInfo.endTick - sceneInfo.startTick ) / sceneInfo.ticksPerFrame );
+		}
+	}
+
+	// Throw if scene info wasn't found.
+	if ( !hasSceneInfo )
+		throw std::exception( "MyXAFFileParser::parseSkeletonAnimationFile() - xml node \"SceneInfo\" wasn't found." );
 }
 
-void MyXAFFileParser::parseNode( const rapidxml::xml_node<char>& node, const SceneInfo& sceneInfo, const SkeletonMesh& skeletonMesh, SkeletonAnimation& skeletonAnimation, const bool invertZCoordinate )
+MyXAFFileParser::SceneInfo MyXAFFileParser::parseSceneInfo( const XmlStreamReader& reader )
 {
-	const rapidxml::xml_attribute<char>* nameAttribute = node.first_attribute( "name", 4, true );
-	if ( !nameAttribute ) throw std::exception( "MyXAFFileParser::parseNode() - xml node \"Node\" has no attribute \"name\" which identifies a bone." );
+	XmlStreamReader::Text startTick, endTick, frameRate, ticksPerFrame;
+
+	if ( !reader.findAttribute( "startTick", startTick ) || !reader.findAttribute( "endTick", endTick )
+		|| !reader.findAttribute( "frameRate", frameRate ) || !reader.findAttribute( "ticksPerFrame", ticksPerFrame ) )
+		throw std::exception( "MyXAFFileParser::parseSceneInfo() - xml node \"SceneInfo\" misses one or more attributes (\"startTick\", \"endTick\", \"frameRate\", \"ticksPerFrame\")." );
 
-	const std::string   boneName( nameAttribute->value( ), nameAttribute->value_size( ) );
-	const unsigned char boneIndex = skeletonMesh.getBoneIndex( boneName );
+	SceneInfo sceneInfo;
 
-	debug.push_back( boneName );
+	sceneInfo.startTick     = parseInt( startTick );
+	sceneInfo.endTick       = parseInt( endTick );
+	sceneInfo.frameRate     = parseInt( frameRate );
+	sceneInfo.ticksPerFrame = parseInt( ticksPerFrame );
 
-	const rapidxml::xml_node<char>* samplesNode = node.first_node();
-	if ( samplesNode && !nameEquals( *samplesNode, "Samples" ) != 0 )
-		findNextSibling( samplesNode, "Samples" );
+	if ( sceneInfo.ticksPerFrame <= 0 ) throw std::exception( "MyXAFFileParser::parseSceneInfo() - attribute \"ticksPerFrame\" has to be positive." );
 
-	if ( !samplesNode ) throw std::exception( "MyXAFFileParser::parseNode() - xml node \"Node\" has no child \"Samples\" which contains bones' poses." );
-	
-	parseSamples( *samplesNode, sceneInfo, boneIndex, skeletonAnimation, invertZCoordinate );
+	return sceneInfo;
 }
 
-void MyXAFFileParser::parseSamples( const rapidxml::xml_node<char>& node, const SceneInfo& sceneInfo, const unsigned char boneIndex, SkeletonAnimation& skeletonAnimation, const bool invertZCoordinate )
+unsigned char MyXAFFileParser::parseNode( const XmlStreamReader& reader, const SkeletonMesh& skeletonMesh )
 {
-	const rapidxml::xml_node<char>* sNode = node.first_node();
+	XmlStreamReader::Text name;
+	if ( !reader.findAttribute( "name", name ) ) throw std::exception( "MyXAFFileParser::parseNode() - xml node \"Node\" has no attribute \"name\" which identifies a bone." );
 
-	while ( sNode )
-	{
-		parseS( *sNode, sceneInfo, boneIndex, skeletonAnimation, invertZCoordinate );
-		sNode = findNextSibling( sNode, "S" );
-	}
+	return skeletonMesh.getBoneIndex( name.toString() );
 }
 
-void MyXAFFileParser::parseS( const rapidxml::xml_node<char>& node, const SceneInfo& sceneInfo, const unsigned char boneIndex, SkeletonAnimation& skeletonAnimation, const bool invertZCoordinate )
+void MyXAFFileParser::parseS( const XmlStreamReader& reader, const SceneInfo& sceneInfo, const unsigned char boneIndex, SkeletonAnimation& skeletonAnimation, const bool invertZCoordinate )
 {
-	rapidxml::xml_attribute<char>* tAttribute = node.first_attribute( "t", 1, true );
-	rapidxml::xml_attribute<char>* vAttribute = node.first_attribute( "v", 1, true );
-	if ( !tAttribute || !vAttribute ) throw std::exception( "MyXAFFileParser::parseS() - xml node \"S\" has no attribute \"t\" (time) or \"v\" (bone pose matrix)." );
+	XmlStreamReader::Text t, v;
+	if ( !reader.findAttribute( "t", t ) || !reader.findAttribute( "v", v ) ) throw std::exception( "MyXAFFileParser::parseS() - xml node \"S\" has no attribute \"t\" (time) or \"v\" (bone pose matrix)." );
 
-	int     timeTick = parseInt( std::string( tAttribute->value( ), tAttribute->value_size( ) ) );
-	float43 bonePose = parseMatrix( std::string( vAttribute->value(), vAttribute->value_size() ), invertZCoordinate );
+	const int timeTick = parseInt( t );
+	if ( timeTick < sceneInfo.startTick ) throw std::exception( "MyXAFFileParser::parseS() - sample time is before the start of the scene." );
 
 	int poseIndexInAnimation = ( timeTick - sceneInfo.startTick ) / sceneInfo.ticksPerFrame;
-	
+
 	SkeletonPose& pose = skeletonAnimation.getOrAddPose( poseIndexInAnimation );
 
-	pose.setBonePose( boneIndex, bonePose );
+	pose.setBonePose( boneIndex, parseMatrix( v, invertZCoordinate ) );
 }
 
-float43 MyXAFFileParser::parseMatrix( std::string text, const bool invertZCoordinate ) {
-	float m11 = parseFloat( text ),
-		m12 = parseFloat( text ),
-		m13 = parseFloat( text ),
-		m21 = parseFloat( text ),
-		m22 = parseFloat( text ),
-		m23 = parseFloat( text ),
-		m31 = parseFloat( text ),
-		m32 = parseFloat( text ),
-		m33 = parseFloat( text ),
-		m41 = parseFloat( text ),
-		m42 = parseFloat( text ),
-		m43 = parseFloat( text );
+float43 MyXAFFileParser::parseMatrix( const XmlStreamReader::Text& text, const bool invertZCoordinate ) {
+	const char* position = text.begin;
+
+	float m11 = parseFloat( position, text.end ),
+		m12 = parseFloat( position, text.end ),
+		m13 = parseFloat( position, text.end ),
+		m21 = parseFloat( position, text.end ),
+		m22 = parseFloat( position, text.end ),
+		m23 = parseFloat( position, text.end ),
+		m31 = parseFloat( position, text.end ),
+		m32 = parseFloat( position, text.end ),
+		m33 = parseFloat( position, text.end ),
+		m41 = parseFloat( position, text.end ),
+		m42 = parseFloat( position, text.end ),
+		m43 = parseFloat( position, text.end );
 
 	if ( invertZCoordinate ) {
 		m13 = -m13;
@@ -184,7 +170,7 @@ float43 MyXAFFileParser::parseMatrix( std::string text, const bool invertZCoordi
 		m43 = -m43;
 	}
 
-	return float43( 
+	return float43(
 		m11, m12, m13,
 		m21, m22, m23,
 		m31, m32, m33,
@@ -192,47 +178,82 @@ float43 MyXAFFileParser::parseMatrix( std::string text, const bool invertZCoordi
 	);
 }
 
-float MyXAFFileParser::parseFloat( std::string& text ) {
-	std::stringstream ss;
+float MyXAFFileParser::parseFloat( const char*& text, const char* end ) {
+	// Digits are accumulated as an integer which is scaled by a power of ten once.
+	while ( text != end && isWhitespace( *text ) )
+		++text;
 
-	size_t startPos = text.find_first_not_of( " " );
-	size_t endPos = text.find_first_of( " \n", startPos );
-	
-	size_t valueLength = 0;
-	if ( endPos != std::string::npos )  
-        valueLength = endPos - startPos;
-	else			   
-        valueLength = text.length() - startPos;
+	const bool isNegative = text != end && *text == '-';
+	if ( text != end && ( *text == '-' || *text == '+' ) )
+		++text;
 
-	if ( valueLength == 0 ) throw std::exception( "MyXAFFileParser::parseFloat - parsing failure." );
-	ss.str( "" );
-	ss << text.substr( startPos, valueLength ) << '\0';
-	float value;
-	ss >> value;
+	unsigned long long mantissa   = 0;
+	int                exponent   = 0;
+	int                digitCount = 0;
 
-	text = text.substr( startPos + valueLength );
+	for ( ; text != end && isDigit( *text ); ++text, ++digitCount ) {
+		if ( mantissa <= maxMantissa )
+			mantissa = mantissa * 10 + ( *text - '0' );
+		else
+			++exponent; // Digits beyond the precision of the mantissa.
+	}
 
-	return value;
+	if ( text != end && *text == '.' ) {
+		for ( ++text; text != end && isDigit( *text ); ++text, ++digitCount ) {
+			if ( mantissa <= maxMantissa ) {
+				mantissa = mantissa * 10 + ( *text - '0' );
+				--exponent;
+			}
+		}
+	}
+
+	if ( digitCount == 0 ) throw std::exception( "MyXAFFileParser::parseFloat - parsing failure." );
+
+	if ( text != end && ( *text == 'e' || *text == 'E' ) ) {
+		++text;
+
+		const bool isExponentNegative = text != end && *text == '-';
+		if ( text != end && ( *text == '-' || *text == '+' ) )
+			++text;
+
+		if ( text == end || !isDigit( *text ) ) throw std::exception( "MyXAFFileParser::parseFloat - parsing failure." );
+
+		int explicitExponent = 0;
+		for ( ; text != end && isDigit( *text ); ++text )
+			explicitExponent = std::min( explicitExponent * 10 + ( *text - '0' ), 1000 );
+
+		exponent += isExponentNegative ? -explicitExponent : explicitExponent;
+	}
+
+	// Mantissa can exceed 2^53 and so isn't always exact in double - the error stays a few double ulps, far below float precision.
+	double value = (double)mantissa;
+	if ( exponent < 0 )
+		value /= getPowerOf10( -exponent );
+	else if ( exponent > 0 )
+		value *= getPowerOf10( exponent );
+
+	return (float)( isNegative ? -value : value );
 }
 
-int MyXAFFileParser::parseInt( std::string text )
+int MyXAFFileParser::parseInt( const XmlStreamReader::Text& text )
 {
-	std::stringstream ss;
+	const char* position = text.begin;
+
+	while ( position != text.end && isWhitespace( *position ) )
+		++position;
 
-	size_t startPos = text.find_first_not_of( " " );
-	size_t endPos = text.find_first_of( " \n", startPos );
+	const bool isNegative = position != text.end && *position == '-';
+	if ( position != text.end && ( *position == '-' || *position == '+' ) )
+		++position;
 
-	size_t valueLength = 0;
-	if ( endPos != std::string::npos )  
-        valueLength = endPos - startPos;
-	else			   
-        valueLength = text.length() - startPos;
+	if ( position == text.end || !isDigit( *position ) ) throw std::exception( "MyXAFFileParser::parseInt - parsing failure." );
 
-	if ( valueLength == 0 ) throw std::exception( "MyXAFFileParser::parseInt - parsing failure." );
-	ss.str( "" );
-	ss << text.substr( startPos, valueLength ) << '\0';
-	int value;
-	ss >> value;
+	long long value = 0;
+	for ( ; position != text.end && isDigit( *position ); ++position ) {
+		value = value * 10 + ( *position - '0' );
 
-	return value;
-}
\ No newline at end of file
+		if ( value > 0x7FFFFFFFll ) throw std::exception( "MyXAFFileParser::parseInt - value is out of range." );
+	}
+
+	return (int)( isNegative ? -value : value );
+}
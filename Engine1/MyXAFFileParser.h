@@ -1,23 +1,25 @@
 #pragma once
 
 #include <vector>
+#include <istream>
 #include "SkeletonMesh.h"
 #include "SkeletonAnimation.h"
-#include "rapidxml.hpp"
+#include "XmlStreamReader.h"
 
 namespace Engine1
 {
+    // Imports XAF files with a streaming XML reader - poses are written to the animation while the file is being read
+    // and no document tree is built. Parser has no state of its own - several animations can be imported in parallel.
     class MyXAFFileParser
     {
         public:
         MyXAFFileParser();
         ~MyXAFFileParser();
 
-        static std::vector<std::string> debug;
-
         public:
         // Returns skeleton animation in skeleton space.
         static void parseSkeletonAnimationFile( const std::vector<char>& file, const SkeletonMesh& skeletonMesh, SkeletonAnimation& skeletonAnimation, const bool invertZCoordinate );
+        static void parseSkeletonAnimationFile( std::istream& stream, const SkeletonMesh& skeletonMesh, SkeletonAnimation& skeletonAnimation, const bool invertZCoordinate );
 
         private:
 
@@ -29,22 +31,14 @@ namespace Engine1
             int ticksPerFrame;
         };
 
-        static bool nameEquals( const rapidxml::xml_node<char>& node, std::string name );
-
-        static const rapidxml::xml_node<char>* next( const rapidxml::xml_node<char>* node );
-
-        static const rapidxml::xml_node<char>* findNext( const rapidxml::xml_node<char>* startNode, std::string name );
-        static const rapidxml::xml_node<char>* findNextSibling( const rapidxml::xml_node<char>* startNode, std::string name );
+        static void parse( XmlStreamReader& reader, const SkeletonMesh& skeletonMesh, SkeletonAnimation& skeletonAnimation, const bool invertZCoordinate );
 
-        static SceneInfo parseSceneInfo( const rapidxml::xml_node<char>& node );
+        static SceneInfo     parseSceneInfo( const XmlStreamReader& reader );
+        static unsigned char parseNode( const XmlStreamReader& reader, const SkeletonMesh& skeletonMesh );
+        static void          parseS( const XmlStreamReader& reader, const SceneInfo& sceneInfo, const unsigned char boneIndex, SkeletonAnimation& skeletonAnimation, const bool invertZCoordinate );
 
-        static void      parseNode( const rapidxml::xml_node<char>& node, const SceneInfo& sceneInfo, const SkeletonMesh& skeletonMesh, SkeletonAnimation& skeletonAnimation, const bool invertZCoordinate );
-        static void      parseSamples( const rapidxml::xml_node<char>& node, const SceneInfo& sceneInfo, const unsigned char boneIndex, SkeletonAnimation& skeletonAnimation, const bool invertZCoordinate );
-        static void      parseS( const rapidxml::xml_node<char>& node, const SceneInfo& sceneInfo, const unsigned char boneIndex, SkeletonAnimation& skeletonAnimation, const bool invertZCoordinate );
-
-        static float43   parseMatrix( std::string text, const bool invertZCoordinate = false );
-        static float     parseFloat( std::string& text );
-        static int       parseInt( std::string text );
+        static float43   parseMatrix( const XmlStreamReader::Text& text, const bool invertZCoordinate = false );
+        static float     parseFloat( const char*& text, const char* end );
+        static int       parseInt( const XmlStreamReader::Text& text );
     };
 }
-
@@ -0,0 +1,226 @@
+#include "NullRenderCommandBackend.h"
+
+#include <algorithm>
+
+using namespace Engine1;
+
+NullRenderCommandBackend::NullRenderCommandBackend()
+{
+    reset();
+}
+
+NullRenderCommandBackend::~NullRenderCommandBackend()
+{}
+
+void NullRenderCommandBackend::reset()
+{
+    m_viewport = { float2::ZERO, float2::ZERO, 0.0f, 0.0f };
+
+    m_renderTargetViews.clear();
+    m_depthStencilView = nullptr;
+    m_unorderedAccessViews.clear();
+    m_vertexShader      = nullptr;
+    m_fragmentShader    = nullptr;
+    m_computeShader     = nullptr;
+    m_rasterizerState   = nullptr;
+    m_depthStencilState = nullptr;
+    m_blendState        = nullptr;
+
+    m_statistics = Statistics();
+    m_passStatistics.clear();
+    m_passNames.clear();
+    m_openPasses.clear();
+}
+
+void NullRenderCommandBackend::execute( const RenderCommandList& commandList, const RenderCommand& command )
+{
+    const RenderHandle* handles = commandList.getHandles().data() + command.firstHandle;
+
+    m_commandStatistics = Statistics();
+    m_commandStatistics.commandCount = 1;
+
+    switch ( command.type )
+    {
+        case RenderCommandType::BeginPass:
+        {
+            const std::string name = static_cast< const char* >( handles[ 0 ] );
+
+            const auto it = m_passStatistics.find( name );
+            if ( it == m_passStatistics.end() ) {
+                m_passNames.push_back( name );
+                m_openPasses.push_back( &m_passStatistics.emplace( name, Statistics() ).first->second );
+            } else {
+                m_openPasses.push_back( &it->second );
+            }
+
+            // Pass markers are not counted as commands.
+            return;
+        }
+        case RenderCommandType::EndPass:
+        {
+            if ( m_openPasses.empty() )
+                throw std::exception( "NullRenderCommandBackend::execute - pass ended without being begun." );
+
+            m_openPasses.pop_back();
+            return;
+        }
+        case RenderCommandType::SetViewport:
+        {
+            const RenderViewport& viewport = commandList.getViewports()[ command.arguments[ 0 ] ];
+
+            bind( viewport.dimensions.x == m_viewport.dimensions.x && viewport.dimensions.y == m_viewport.dimensions.y &&
+                  viewport.topLeft.x == m_viewport.topLeft.x && viewport.topLeft.y == m_viewport.topLeft.y &&
+                  viewport.depthMin == m_viewport.depthMin && viewport.depthMax == m_viewport.depthMax );
+
+            m_viewport = viewport;
+            break;
+        }
+        case RenderCommandType::SetRenderTargets:
+        {
+            const unsigned int   rtvCount = command.arguments[ 0 ];
+            const unsigned int   uavCount = command.arguments[ 1 ];
+            const RenderHandle*  rtvs     = handles;
+            const RenderHandle   dsv      = handles[ rtvCount ];
+            const RenderHandle*  uavs     = handles + rtvCount + 1;
+
+            bind( rtvCount == m_renderTargetViews.size() && std::equal( rtvs, rtvs + rtvCount, m_renderTargetViews.begin() ) &&
+                  dsv == m_depthStencilView &&
+                  uavCount == m_unorderedAccessViews.size() && std::equal( uavs, uavs + uavCount, m_unorderedAccessViews.begin() ) );
+
+            m_renderTargetViews.assign( rtvs, rtvs + rtvCount );
+            m_depthStencilView = dsv;
+            m_unorderedAccessViews.assign( uavs, uavs + uavCount );
+            break;
+        }
+        case RenderCommandType::UnbindRenderTargets:
+        {
+            ++m_commandStatistics.barrierCount;
+
+            m_renderTargetViews.clear();
+            m_depthStencilView = nullptr;
+            m_unorderedAccessViews.clear();
+            break;
+        }
+        case RenderCommandType::SetRenderingShaders:
+        {
+            // Enabling rendering shaders disables the compute shader - as in DX11RendererCore.
+            bind( handles[ 0 ] == m_vertexShader && handles[ 1 ] == m_fragmentShader && ( !handles[ 0 ] || !m_computeShader ) );
+
+            m_vertexShader   = handles[ 0 ];
+            m_fragmentShader = handles[ 1 ];
+
+            if ( m_vertexShader )
+                m_computeShader = nullptr;
+
+            break;
+        }
+        case RenderCommandType::SetComputeShader:
+        {
+            bind( handles[ 0 ] == m_computeShader && ( !handles[ 0 ] || !m_vertexShader ) );
+
+            m_computeShader = handles[ 0 ];
+
+            if ( m_computeShader ) {
+                m_vertexShader   = nullptr;
+                m_fragmentShader = nullptr;
+            }
+
+            break;
+        }
+        case RenderCommandType::SetRasterizerState:
+        {
+            bind( handles[ 0 ] == m_rasterizerState );
+            m_rasterizerState = handles[ 0 ];
+            break;
+        }
+        case RenderCommandType::SetDepthStencilState:
+        {
+            bind( handles[ 0 ] == m_depthStencilState );
+            m_depthStencilState = handles[ 0 ];
+            break;
+        }
+        case RenderCommandType::SetBlendState:
+        {
+            bind( handles[ 0 ] == m_blendState );
+            m_blendState = handles[ 0 ];
+            break;
+        }
+        case RenderCommandType::UnbindShaderInputs:
+        {
+            ++m_commandStatistics.barrierCount;
+            break;
+        }
+        case RenderCommandType::Draw:
+        {
+            if ( !m_vertexShader )
+                throw std::exception( "NullRenderCommandBackend::execute - draw without a vertex shader." );
+
+            if ( m_renderTargetViews.empty() && !m_depthStencilView )
+                throw std::exception( "NullRenderCommandBackend::execute - draw without render targets." );
+
+            ++m_commandStatistics.drawCount;
+            m_commandStatistics.instanceCount += (int)command.arguments[ 1 ];
+            break;
+        }
+        case RenderCommandType::Dispatch:
+        {
+            if ( !m_computeShader )
+                throw std::exception( "NullRenderCommandBackend::execute - dispatch without a compute shader." );
+
+            ++m_commandStatistics.dispatchCount;
+            break;
+        }
+        case RenderCommandType::Copy:
+        {
+            if ( handles[ 0 ] == handles[ 1 ] && command.arguments[ 0 ] == command.arguments[ 1 ] )
+                throw std::exception( "NullRenderCommandBackend::execute - copy from a subresource to itself." );
+
+            ++m_commandStatistics.copyCount;
+            break;
+        }
+    }
+
+    add( m_statistics, m_commandStatistics );
+
+    if ( !m_openPasses.empty() )
+        add( *m_openPasses.back(), m_commandStatistics );
+}
+
+const NullRenderCommandBackend::Statistics& NullRenderCommandBackend::getStatistics() const
+{
+    return m_statistics;
+}
+
+NullRenderCommandBackend::Statistics NullRenderCommandBackend::getPassStatistics( const std::string& name ) const
+{
+    const auto it = m_passStatistics.find( name );
+    if ( it == m_passStatistics.end() )
+        return Statistics();
+
+    return it->second;
+}
+
+const std::vector< std::string >& NullRenderCommandBackend::getPassNames() const
+{
+    return m_passNames;
+}
+
+void NullRenderCommandBackend::bind( const bool isRedundant )
+{
+    ++m_commandStatistics.bindCount;
+
+    if ( isRedundant )
+        ++m_commandStatistics.redundantBindCount;
+}
+
+void NullRenderCommandBackend::add( Statistics& statistics, const Statistics& change )
+{
+    statistics.commandCount       += change.commandCount;
+    statistics.drawCount          += change.drawCount;
+    statistics.instanceCount      += change.instanceCount;
+    statistics.dispatchCount      += change.dispatchCount;
+    statistics.copyCount          += change.copyCount;
+    statistics.barrierCount       += change.barrierCount;
+    statistics.bindCount          += change.bindCount;
+    statistics.redundantBindCount += change.redundantBindCount;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include "RenderCommandList.h"
+
+namespace Engine1
+{
+    // Executes recorded commands without a GPU - tracks the bound pipeline state, validates draws and dispatches against it
+    // and counts the work of the whole stream and of each named pass. Used to build and profile frames headless.
+    class NullRenderCommandBackend : public RenderCommandBackend
+    {
+        public:
+
+        struct Statistics
+        {
+            int commandCount;
+            int drawCount;
+            int instanceCount;
+            int dispatchCount;
+            int copyCount;
+            // Unbinding of render targets or shader inputs - the points where DX11 resolves resource hazards.
+            int barrierCount;
+            // Changes of shaders, pipeline states, render targets and viewport.
+            int bindCount;
+            // Binds which set the state that was already bound.
+            int redundantBindCount;
+        };
+
+        NullRenderCommandBackend();
+        ~NullRenderCommandBackend();
+
+        // Unbinds everything and clears the statistics.
+        void reset();
+
+        void execute( const RenderCommandList& commandList, const RenderCommand& command ) override;
+
+        // Statistics of all the commands executed since the last reset.
+        const Statistics& getStatistics() const;
+
+        // Statistics summed over all the occurrences of the pass. Commands of a nested pass count only towards the nested pass.
+        Statistics getPassStatistics( const std::string& name ) const;
+
+        // Names of the executed passes, in the order of their first occurrence.
+        const std::vector< std::string >& getPassNames() const;
+
+        private:
+
+        void bind( const bool isRedundant );
+
+        static void add( Statistics& statistics, const Statistics& change );
+
+        RenderViewport              m_viewport;
+        std::vector< RenderHandle > m_renderTargetViews;
+        RenderHandle                m_depthStencilView;
+        std::vector< RenderHandle > m_unorderedAccessViews;
+        RenderHandle                m_vertexShader;
+        RenderHandle                m_fragmentShader;
+        RenderHandle                m_computeShader;
+        RenderHandle                m_rasterizerState;
+        RenderHandle                m_depthStencilState;
+        RenderHandle                m_blendState;
+
+        Statistics                          m_statistics;
+        std::map< std::string, Statistics > m_passStatistics;
+        std::vector< std::string >          m_passNames;
+        std::vector< Statistics* >          m_openPasses;
+
+        // Change caused by the currently executed command.
+        Statistics m_commandStatistics;
+    };
+}
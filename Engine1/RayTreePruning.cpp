@@ -0,0 +1,100 @@
+#include "RayTreePruning.h"
+
+#include <algorithm>
+
+using namespace Engine1;
+
+const std::vector< float > RayTreePruning::s_emptyContribution;
+
+RayTreePruning::RayTreePruning()
+{}
+
+RayTreePruning::~RayTreePruning()
+{}
+
+void RayTreePruning::clear()
+{
+    m_estimates.clear();
+}
+
+void RayTreePruning::remove( const RenderingStage stage )
+{
+    m_estimates.erase( stage );
+}
+
+void RayTreePruning::update( const RenderingStage stage, const std::vector< uchar4 >& contributionRoughness, const int2 dimensions )
+{
+    if ( getRenderingStageLevel( stage ) < 1 )
+        throw std::exception( "RayTreePruning::update - main image can't be pruned." );
+
+    if ( dimensions.x <= 0 || dimensions.y <= 0 || contributionRoughness.size() != (size_t)dimensions.x * (size_t)dimensions.y )
+        throw std::exception( "RayTreePruning::update - image size doesn't match the given dimensions." );
+
+    // Contribution of the previous stage. Main image (and a previous stage without a matching estimate) contributes fully.
+    const auto prevIt = m_estimates.find( getPrevRenderingStage( stage ) );
+    const std::vector< float >* prevTotalContribution
+        = ( prevIt != m_estimates.end() && prevIt->second.dimensions == dimensions ) ? &prevIt->second.totalContribution : nullptr;
+
+    Estimate& estimate = m_estimates[ stage ];
+    estimate.dimensions = dimensions;
+    estimate.totalContribution.resize( contributionRoughness.size() );
+
+    double contributionSum    = 0.0;
+    float  maxContribution    = 0.0f;
+    for ( size_t pixelIdx = 0; pixelIdx < contributionRoughness.size(); ++pixelIdx )
+    {
+        float totalContribution = getPixelContribution( contributionRoughness[ pixelIdx ] );
+
+        if ( prevTotalContribution )
+            totalContribution *= ( *prevTotalContribution )[ pixelIdx ];
+
+        estimate.totalContribution[ pixelIdx ] = totalContribution;
+        contributionSum += totalContribution;
+        maxContribution  = std::max( maxContribution, totalContribution );
+    }
+
+    estimate.contribution    = (float)( contributionSum / (double)contributionRoughness.size() );
+    estimate.maxContribution = maxContribution;
+}
+
+bool RayTreePruning::hasEstimate( const RenderingStage stage ) const
+{
+    return m_estimates.find( stage ) != m_estimates.end();
+}
+
+float RayTreePruning::getContribution( const RenderingStage stage ) const
+{
+    const auto it = m_estimates.find( stage );
+    if ( it == m_estimates.end() )
+        return 1.0f;
+
+    return it->second.contribution;
+}
+
+float RayTreePruning::getMaxContribution( const RenderingStage stage ) const
+{
+    const auto it = m_estimates.find( stage );
+    if ( it == m_estimates.end() )
+        return 1.0f;
+
+    return it->second.maxContribution;
+}
+
+const std::vector< float >& RayTreePruning::getTotalContribution( const RenderingStage stage ) const
+{
+    const auto it = m_estimates.find( stage );
+    if ( it == m_estimates.end() )
+        return s_emptyContribution;
+
+    return it->second.totalContribution;
+}
+
+bool RayTreePruning::isStageVisible( const RenderingStage stage, const float contributionThreshold ) const
+{
+    return getMaxContribution( stage ) >= contributionThreshold;
+}
+
+float RayTreePruning::getPixelContribution( const uchar4& contributionRoughness )
+{
+    return (float)std::max( contributionRoughness.x, std::max( contributionRoughness.y, contributionRoughness.z ) ) / 255.0f;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "RenderingStage.h"
+#include "uchar4.h"
+#include "int2.h"
+
+namespace Engine1
+{
+    // Estimates how much each reflection/refraction stage contributes to the final image and decides which stages can be skipped.
+    // Input is a reduced resolution version of the stage's contribution-roughness image, as written by ReflectionRefractionShadingRenderer -
+    // rgb is the contribution term of the stage (computed from metalness, roughness, albedo and refractive index of the surface the rays leave),
+    // alpha is roughness. Shaders don't multiply the term by the contribution of the previous stages, so it's accumulated here -
+    // total contribution of a pixel is the product of the terms along the path from the main image.
+    // Stages are pruned based on their largest total contribution to a pixel - so a stage is kept even if it covers a small part of the screen
+    // (e.g. a small mirror), as long as it contributes noticeably there.
+    class RayTreePruning
+    {
+        public:
+
+        RayTreePruning();
+        ~RayTreePruning();
+
+        // Removes all the estimates.
+        void clear();
+
+        // Removes the stage's estimate - the stage is rendered until it gets a new one.
+        void remove( const RenderingStage stage );
+
+        // Replaces the stage's estimate. Image of the previous stage should be updated first (and have the same dimensions) -
+        // otherwise the stage's contribution is not reduced by the previous stages (which gives a conservative estimate).
+        void update( const RenderingStage stage, const std::vector< uchar4 >& contributionRoughness, const int2 dimensions );
+
+        bool hasEstimate( const RenderingStage stage ) const;
+
+        // Average total contribution of the stage to the screen, in range <0, 1>. 1 for stages without an estimate.
+        float getContribution( const RenderingStage stage ) const;
+
+        // Largest total contribution of the stage to a single pixel (at the dimensions given to update), in range <0, 1>. 1 for stages without an estimate.
+        float getMaxContribution( const RenderingStage stage ) const;
+
+        // Per-pixel total contribution of the stage at the dimensions given to update. Empty for stages without an estimate.
+        const std::vector< float >& getTotalContribution( const RenderingStage stage ) const;
+
+        // Whether the stage should be rendered - its max contribution reaches the threshold. Stages without an estimate are always rendered.
+        bool isStageVisible( const RenderingStage stage, const float contributionThreshold ) const;
+
+        // Contribution term of a single pixel - the largest of the color components.
+        static float getPixelContribution( const uchar4& contributionRoughness );
+
+        private:
+
+        struct Estimate
+        {
+            int2                 dimensions;
+            std::vector< float > totalContribution;
+            float                contribution;
+            float                maxContribution;
+        };
+
+        std::map< RenderingStage, Estimate > m_estimates;
+
+        static const std::vector< float > s_emptyContribution;
+    };
+}
@@ -0,0 +1,186 @@
+#include "RenderCommandList.h"
+
+using namespace Engine1;
+
+RenderCommandList::RenderCommandList()
+{}
+
+RenderCommandList::~RenderCommandList()
+{}
+
+void RenderCommandList::clear()
+{
+    m_commands.clear();
+    m_handles.clear();
+    m_viewports.clear();
+}
+
+void RenderCommandList::beginPass( const char* name )
+{
+    if ( !name )
+        throw std::exception( "RenderCommandList::beginPass - pass name is null." );
+
+    addHandle( addCommand( RenderCommandType::BeginPass ), name );
+}
+
+void RenderCommandList::endPass()
+{
+    addCommand( RenderCommandType::EndPass );
+}
+
+void RenderCommandList::setViewport( const float2& dimensions, const float2& topLeft, const float depthMin, const float depthMax )
+{
+    RenderCommand& command = addCommand( RenderCommandType::SetViewport );
+    command.arguments[ 0 ] = (unsigned int)m_viewports.size();
+
+    m_viewports.push_back( { dimensions, topLeft, depthMin, depthMax } );
+}
+
+void RenderCommandList::setRenderTargets( const RenderHandle* renderTargetViews, const int renderTargetViewCount, const RenderHandle depthStencilView,
+                                          const RenderHandle* unorderedAccessViews, const int unorderedAccessViewCount )
+{
+    if ( renderTargetViewCount < 0 || unorderedAccessViewCount < 0 )
+        throw std::exception( "RenderCommandList::setRenderTargets - negative view count." );
+
+    RenderCommand& command = addCommand( RenderCommandType::SetRenderTargets );
+    command.arguments[ 0 ] = (unsigned int)renderTargetViewCount;
+    command.arguments[ 1 ] = (unsigned int)unorderedAccessViewCount;
+
+    for ( int i = 0; i < renderTargetViewCount; ++i )
+        addHandle( command, renderTargetViews[ i ] );
+
+    addHandle( command, depthStencilView );
+
+    for ( int i = 0; i < unorderedAccessViewCount; ++i )
+        addHandle( command, unorderedAccessViews[ i ] );
+}
+
+void RenderCommandList::unbindRenderTargets()
+{
+    addCommand( RenderCommandType::UnbindRenderTargets );
+}
+
+void RenderCommandList::setRenderingShaders( const RenderHandle vertexShader, const RenderHandle fragmentShader )
+{
+    RenderCommand& command = addCommand( RenderCommandType::SetRenderingShaders );
+    addHandle( command, vertexShader );
+    addHandle( command, fragmentShader );
+}
+
+void RenderCommandList::setComputeShader( const RenderHandle computeShader )
+{
+    addHandle( addCommand( RenderCommandType::SetComputeShader ), computeShader );
+}
+
+void RenderCommandList::setRasterizerState( const RenderHandle rasterizerState )
+{
+    addHandle( addCommand( RenderCommandType::SetRasterizerState ), rasterizerState );
+}
+
+void RenderCommandList::setDepthStencilState( const RenderHandle depthStencilState )
+{
+    addHandle( addCommand( RenderCommandType::SetDepthStencilState ), depthStencilState );
+}
+
+void RenderCommandList::setBlendState( const RenderHandle blendState )
+{
+    addHandle( addCommand( RenderCommandType::SetBlendState ), blendState );
+}
+
+void RenderCommandList::unbindShaderInputs()
+{
+    addCommand( RenderCommandType::UnbindShaderInputs );
+}
+
+void RenderCommandList::draw( const RenderHandle mesh, const unsigned int indexCount, const unsigned int instanceCount )
+{
+    RenderCommand& command = addCommand( RenderCommandType::Draw );
+    command.arguments[ 0 ] = indexCount;
+    command.arguments[ 1 ] = instanceCount;
+
+    addHandle( command, mesh );
+}
+
+void RenderCommandList::dispatch( const uint3& groupCount )
+{
+    RenderCommand& command = addCommand( RenderCommandType::Dispatch );
+    command.arguments[ 0 ] = groupCount.x;
+    command.arguments[ 1 ] = groupCount.y;
+    command.arguments[ 2 ] = groupCount.z;
+}
+
+void RenderCommandList::copy( const RenderHandle destination, const unsigned int destinationSubresource,
+                              const RenderHandle source, const unsigned int sourceSubresource )
+{
+    RenderCommand& command = addCommand( RenderCommandType::Copy );
+    command.arguments[ 0 ] = destinationSubresource;
+    command.arguments[ 1 ] = sourceSubresource;
+
+    addHandle( command, destination );
+    addHandle( command, source );
+}
+
+void RenderCommandList::execute( RenderCommandBackend& backend ) const
+{
+    for ( const RenderCommand& command : m_commands )
+        backend.execute( *this, command );
+}
+
+const std::vector< RenderCommand >& RenderCommandList::getCommands() const
+{
+    return m_commands;
+}
+
+const std::vector< RenderHandle >& RenderCommandList::getHandles() const
+{
+    return m_handles;
+}
+
+const std::vector< RenderViewport >& RenderCommandList::getViewports() const
+{
+    return m_viewports;
+}
+
+const char* RenderCommandList::getTypeName( const RenderCommandType type )
+{
+    switch ( type )
+    {
+        case RenderCommandType::BeginPass:            return "BeginPass";
+        case RenderCommandType::EndPass:              return "EndPass";
+        case RenderCommandType::SetViewport:          return "SetViewport";
+        case RenderCommandType::SetRenderTargets:     return "SetRenderTargets";
+        case RenderCommandType::UnbindRenderTargets:  return "UnbindRenderTargets";
+        case RenderCommandType::SetRenderingShaders:  return "SetRenderingShaders";
+        case RenderCommandType::SetComputeShader:     return "SetComputeShader";
+        case RenderCommandType::SetRasterizerState:   return "SetRasterizerState";
+        case RenderCommandType::SetDepthStencilState: return "SetDepthStencilState";
+        case RenderCommandType::SetBlendState:        return "SetBlendState";
+        case RenderCommandType::UnbindShaderInputs:   return "UnbindShaderInputs";
+        case RenderCommandType::Draw:                 return "Draw";
+        case RenderCommandType::Dispatch:             return "Dispatch";
+        case RenderCommandType::Copy:                 return "Copy";
+    }
+
+    throw std::exception( "RenderCommandList::getTypeName - unknown command type." );
+}
+
+RenderCommand& RenderCommandList::addCommand( const RenderCommandType type )
+{
+    RenderCommand command;
+    command.type           = type;
+    command.firstHandle    = (unsigned int)m_handles.size();
+    command.handleCount    = 0;
+    command.arguments[ 0 ] = 0;
+    command.arguments[ 1 ] = 0;
+    command.arguments[ 2 ] = 0;
+
+    m_commands.push_back( command );
+
+    return m_commands.back();
+}
+
+void RenderCommandList::addHandle( RenderCommand& command, const RenderHandle handle )
+{
+    m_handles.push_back( handle );
+    ++command.handleCount;
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <vector>
+
+#include "float2.h"
+#include "uint3.h"
+
+namespace Engine1
+{
+    class RenderCommandList;
+
+    // Opaque GPU object - the address of a shader, pipeline state, view, mesh or texture resource.
+    // Null stands for an unbound slot or the default pipeline state.
+    typedef const void* RenderHandle;
+
+    enum class RenderCommandType : unsigned char
+    {
+        BeginPass,
+        EndPass,
+        SetViewport,
+        SetRenderTargets,
+        UnbindRenderTargets,
+        SetRenderingShaders,
+        SetComputeShader,
+        SetRasterizerState,
+        SetDepthStencilState,
+        SetBlendState,
+        UnbindShaderInputs,
+        Draw,
+        Dispatch,
+        Copy
+    };
+
+    struct RenderCommand
+    {
+        RenderCommandType type;
+
+        // Range of the command's handles in RenderCommandList::getHandles(). Per command type:
+        //     BeginPass            - pass name (const char*).
+        //     SetRenderTargets     - render target views, depth-stencil view, unordered access views.
+        //     SetRenderingShaders  - vertex shader, fragment shader.
+        //     SetComputeShader, Set*State - shader or state.
+        //     Draw                 - mesh.
+        //     Copy                 - destination resource, source resource.
+        unsigned int firstHandle;
+        unsigned int handleCount;
+
+        // SetViewport      - viewport index in RenderCommandList::getViewports().
+        // SetRenderTargets - render target view count, unordered access view count.
+        // Draw             - index count, instance count.
+        // Dispatch         - group counts.
+        // Copy             - destination subresource, source subresource.
+        unsigned int arguments[ 3 ];
+    };
+
+    struct RenderViewport
+    {
+        float2 dimensions;
+        float2 topLeft;
+        float  depthMin;
+        float  depthMax;
+    };
+
+    // Consumes a recorded command stream - e.g. NullRenderCommandBackend, which tracks the pipeline state and counts the work instead of calling the GPU.
+    class RenderCommandBackend
+    {
+        public:
+
+        virtual ~RenderCommandBackend() {}
+
+        virtual void execute( const RenderCommandList& commandList, const RenderCommand& command ) = 0;
+    };
+
+    // Platform independent stream of the pipeline operations of a frame - bindings, draws, dispatches, copies and barriers (unbinding outputs and inputs).
+    // Commands are stored in flat arrays, so recording a frame doesn't allocate once the arrays have grown to the frame's size.
+    // DX11RendererCore records each call it receives into the attached list - before filtering redundant state changes - so the structure
+    // and cost of a frame can be analyzed without a GPU (see Renderer::captureNextFrame). It's not a replayable frame - shader constants
+    // and input resources are bound by the shader classes directly on the device context and aren't recorded.
+    class RenderCommandList
+    {
+        public:
+
+        RenderCommandList();
+        ~RenderCommandList();
+
+        // Removes all the commands. Memory is kept for the next frame.
+        void clear();
+
+        // Pass names have to outlive the list - string literals are expected.
+        void beginPass( const char* name );
+        void endPass();
+
+        void setViewport( const float2& dimensions, const float2& topLeft, const float depthMin, const float depthMax );
+        void setRenderTargets( const RenderHandle* renderTargetViews, const int renderTargetViewCount, const RenderHandle depthStencilView,
+                               const RenderHandle* unorderedAccessViews, const int unorderedAccessViewCount );
+        void unbindRenderTargets();
+
+        // Fragment shader may be null - for depth-only rendering.
+        void setRenderingShaders( const RenderHandle vertexShader, const RenderHandle fragmentShader );
+        void setComputeShader( const RenderHandle computeShader );
+
+        // Null state stands for the default state.
+        void setRasterizerState( const RenderHandle rasterizerState );
+        void setDepthStencilState( const RenderHandle depthStencilState );
+        void setBlendState( const RenderHandle blendState );
+
+        void unbindShaderInputs();
+
+        void draw( const RenderHandle mesh, const unsigned int indexCount, const unsigned int instanceCount = 1 );
+        void dispatch( const uint3& groupCount );
+        void copy( const RenderHandle destination, const unsigned int destinationSubresource,
+                   const RenderHandle source, const unsigned int sourceSubresource );
+
+        // Passes the commands to the backend in the recorded order.
+        void execute( RenderCommandBackend& backend ) const;
+
+        const std::vector< RenderCommand >&  getCommands() const;
+        const std::vector< RenderHandle >&   getHandles() const;
+        const std::vector< RenderViewport >& getViewports() const;
+
+        static const char* getTypeName( const RenderCommandType type );
+
+        private:
+
+        RenderCommand& addCommand( const RenderCommandType type );
+        void           addHandle( RenderCommand& command, const RenderHandle handle );
+
+        std::vector< RenderCommand >  m_commands;
+        std::vector< RenderHandle >   m_handles;
+        std::vector< RenderViewport > m_viewports;
+    };
+}
@@ -0,0 +1,205 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+
+using namespace Engine1;
+
+const int RenderQueue::s_passBitCount     = 4;
+const int RenderQueue::s_shaderBitCount   = 4;
+const int RenderQueue::s_modelBitCount    = 20;
+const int RenderQueue::s_materialBitCount = 16;
+const int RenderQueue::s_depthBitCount    = 20;
+
+RenderQueue::RenderQueue() :
+    m_maxDepth( 1.0f )
+{
+    m_statistics = Statistics();
+}
+
+RenderQueue::~RenderQueue()
+{}
+
+void RenderQueue::clear( const float maxDepth )
+{
+    if ( maxDepth <= 0.0f )
+        throw std::exception( "RenderQueue::clear - max depth has to be positive." );
+
+    m_maxDepth = maxDepth;
+
+    // Ids of deleted models are never reused - start over long before running out of them.
+    if ( m_modelIds.size() >= ( 1u << ( s_modelBitCount - 1 ) ) )
+        m_modelIds.clear();
+
+    m_draws.clear();
+    m_keys.clear();
+    m_order.clear();
+    m_instancedDraws.clear();
+    m_instanceWorldMatrices.clear();
+}
+
+void RenderQueue::add( const BlockModel& model, const float43& worldMatrix, const float viewDepth, const int pass, const int shader, const int material )
+{
+    m_keys.push_back( createKey( pass, shader, getModelId( model ), material, viewDepth, m_maxDepth ) );
+    m_order.push_back( (unsigned int)m_draws.size() );
+    m_draws.push_back( { &model, worldMatrix } );
+}
+
+void RenderQueue::sort()
+{
+    radixSort( m_keys, m_order, m_tmpKeys, m_tmpOrder );
+
+    m_instancedDraws.clear();
+    m_instanceWorldMatrices.resize( m_draws.size() );
+
+    // Draws differing only in depth are merged.
+    const unsigned long long depthMask = ( 1ull << s_depthBitCount ) - 1;
+    const int                materialShift = s_depthBitCount;
+    const int                shaderShift   = s_depthBitCount + s_materialBitCount + s_modelBitCount;
+
+    for ( size_t i = 0; i < m_order.size(); ++i )
+    {
+        const Draw& draw = m_draws[ m_order[ i ] ];
+
+        m_instanceWorldMatrices[ i ] = draw.worldMatrix;
+
+        if ( i > 0 && ( m_keys[ i ] & ~depthMask ) == ( m_keys[ i - 1 ] & ~depthMask ) ) {
+            ++m_instancedDraws.back().instanceCount;
+            continue;
+        }
+
+        InstancedDraw instancedDraw;
+        instancedDraw.model         = draw.model;
+        instancedDraw.shader        = (int)( ( m_keys[ i ] >> shaderShift ) & ( ( 1ull << s_shaderBitCount ) - 1 ) );
+        instancedDraw.material      = (int)( ( m_keys[ i ] >> materialShift ) & ( ( 1ull << s_materialBitCount ) - 1 ) );
+        instancedDraw.firstInstance = (int)i;
+        instancedDraw.instanceCount = 1;
+
+        m_instancedDraws.push_back( instancedDraw );
+    }
+}
+
+void RenderQueue::submit( RenderQueueBackend& backend )
+{
+    m_statistics = Statistics();
+    m_statistics.drawCount          = (int)m_draws.size();
+    m_statistics.instancedDrawCount = (int)m_instancedDraws.size();
+
+    const InstancedDraw* previousDraw = nullptr;
+
+    for ( const InstancedDraw& instancedDraw : m_instancedDraws )
+    {
+        if ( !previousDraw || instancedDraw.shader != previousDraw->shader ) {
+            backend.bindShader( instancedDraw.shader );
+            ++m_statistics.shaderBindCount;
+        }
+
+        // Shader change may reset the model's state in the backend.
+        if ( !previousDraw || instancedDraw.shader != previousDraw->shader || instancedDraw.model != previousDraw->model || instancedDraw.material != previousDraw->material ) {
+            backend.bindModel( *instancedDraw.model, instancedDraw.material );
+            ++m_statistics.modelBindCount;
+        }
+
+        backend.drawInstances( *instancedDraw.model, &m_instanceWorldMatrices[ instancedDraw.firstInstance ], instancedDraw.instanceCount );
+
+        previousDraw = &instancedDraw;
+    }
+}
+
+unsigned long long RenderQueue::createKey( const int pass, const int shader, const int modelId, const int material, const float viewDepth, const float maxDepth )
+{
+    if ( pass < 0 || pass >= ( 1 << s_passBitCount ) )
+        throw std::exception( "RenderQueue::createKey - pass out of range." );
+
+    if ( shader < 0 || shader >= ( 1 << s_shaderBitCount ) )
+        throw std::exception( "RenderQueue::createKey - shader out of range." );
+
+    if ( modelId < 0 || modelId >= ( 1 << s_modelBitCount ) )
+        throw std::exception( "RenderQueue::createKey - model id out of range." );
+
+    if ( material < 0 || material >= ( 1 << s_materialBitCount ) )
+        throw std::exception( "RenderQueue::createKey - material out of range." );
+
+    const unsigned int maxDepthValue = ( 1u << s_depthBitCount ) - 1;
+    const unsigned int depth         = (unsigned int)( std::min( 1.0f, std::max( 0.0f, viewDepth / maxDepth ) ) * (float)maxDepthValue );
+
+    unsigned long long key = (unsigned long long)pass;
+    key = ( key << s_shaderBitCount )   | (unsigned long long)shader;
+    key = ( key << s_modelBitCount )    | (unsigned long long)modelId;
+    key = ( key << s_materialBitCount ) | (unsigned long long)material;
+    key = ( key << s_depthBitCount )    | (unsigned long long)depth;
+
+    return key;
+}
+
+void RenderQueue::radixSort( std::vector< unsigned long long >& keys, std::vector< unsigned int >& indices,
+                             std::vector< unsigned long long >& tmpKeys, std::vector< unsigned int >& tmpIndices )
+{
+    const int byteCount   = sizeof( unsigned long long );
+    const int bucketCount = 256;
+
+    const size_t count = keys.size();
+
+    if ( indices.size() != count )
+        throw std::exception( "RenderQueue::radixSort - key and index counts differ." );
+
+    tmpKeys.resize( count );
+    tmpIndices.resize( count );
+
+    // Histograms of all the bytes in one pass over the keys.
+    std::vector< unsigned int > histograms( byteCount * bucketCount, 0 );
+
+    for ( const unsigned long long key : keys )
+    {
+        for ( int byteIdx = 0; byteIdx < byteCount; ++byteIdx )
+            ++histograms[ byteIdx * bucketCount + ( ( key >> ( byteIdx * 8 ) ) & 0xFF ) ];
+    }
+
+    // Least significant byte first - each pass is stable, so the order of the previous passes is kept for equal bytes.
+    for ( int byteIdx = 0; byteIdx < byteCount; ++byteIdx )
+    {
+        unsigned int* histogram = &histograms[ byteIdx * bucketCount ];
+
+        // All keys have the same byte (e.g. unused key bits) - nothing to reorder.
+        if ( count == 0 || histogram[ ( keys[ 0 ] >> ( byteIdx * 8 ) ) & 0xFF ] == count )
+            continue;
+
+        unsigned int offset = 0;
+        for ( int bucketIdx = 0; bucketIdx < bucketCount; ++bucketIdx ) {
+            const unsigned int bucketSize = histogram[ bucketIdx ];
+            histogram[ bucketIdx ] = offset;
+            offset += bucketSize;
+        }
+
+        for ( size_t i = 0; i < count; ++i )
+        {
+            const unsigned int destination = histogram[ ( keys[ i ] >> ( byteIdx * 8 ) ) & 0xFF ]++;
+
+            tmpKeys[ destination ]    = keys[ i ];
+            tmpIndices[ destination ] = indices[ i ];
+        }
+
+        keys.swap( tmpKeys );
+        indices.swap( tmpIndices );
+    }
+}
+
+const RenderQueue::Statistics& RenderQueue::getStatistics() const
+{
+    return m_statistics;
+}
+
+int RenderQueue::getModelId( const BlockModel& model )
+{
+    const auto it = m_modelIds.find( &model );
+    if ( it != m_modelIds.end() )
+        return it->second;
+
+    const int modelId = (int)m_modelIds.size();
+
+    if ( modelId >= ( 1 << s_modelBitCount ) )
+        throw std::exception( "RenderQueue::add - too many models." );
+
+    m_modelIds.emplace( &model, modelId );
+
+    return modelId;
+}
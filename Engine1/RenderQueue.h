@@ -0,0 +1,114 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+
+#include "float43.h"
+
+namespace Engine1
+{
+    class BlockModel;
+
+    // Executes the draws of a RenderQueue - DX11 deferred renderer when rendering, a state counting mock in unit tests.
+    class RenderQueueBackend
+    {
+        public:
+
+        virtual ~RenderQueueBackend() {}
+
+        // Called when the shader of the following draws differs from the previous one.
+        virtual void bindShader( const int shader ) = 0;
+
+        // Called when the model or material of the following draws differs from the previous one.
+        virtual void bindModel( const BlockModel& model, const int material ) = 0;
+
+        // Draws the bound model once per world matrix.
+        virtual void drawInstances( const BlockModel& model, const float43* worldMatrices, const int instanceCount ) = 0;
+    };
+
+    // Collects the draws of a frame, sorts them by a packed 64-bit key (pass, shader, model, material, depth) with a radix sort
+    // and merges consecutive draws of the same model and material into instanced draws - so state is set once per group instead of once per actor.
+    //
+    // Key layout, from the most significant bits:
+    //     pass     (4 bits)  - caller defined, e.g. opaque geometry before debug geometry.
+    //     shader   (4 bits)  - caller defined.
+    //     model    (20 bits) - assigned by the queue on first use, stable between frames.
+    //     material (16 bits) - caller defined variant of the model's textures and parameters.
+    //     depth    (20 bits) - view depth quantized over [0, maxDepth], so each group is drawn front to back.
+    class RenderQueue
+    {
+        public:
+
+        static const int s_passBitCount;
+        static const int s_shaderBitCount;
+        static const int s_modelBitCount;
+        static const int s_materialBitCount;
+        static const int s_depthBitCount;
+
+        struct Statistics
+        {
+            int drawCount;
+            int instancedDrawCount;
+            int shaderBindCount;
+            int modelBindCount;
+        };
+
+        RenderQueue();
+        ~RenderQueue();
+
+        // Removes all the draws. Model ids are kept.
+        void clear( const float maxDepth );
+
+        void add( const BlockModel& model, const float43& worldMatrix, const float viewDepth, const int pass = 0, const int shader = 0, const int material = 0 );
+
+        // Sorts the draws and builds the instanced draws. Has to be called before submit, after the last add.
+        void sort();
+
+        void submit( RenderQueueBackend& backend );
+
+        static unsigned long long createKey( const int pass, const int shader, const int modelId, const int material, const float viewDepth, const float maxDepth );
+
+        // Sorts the keys in increasing order. Indices are reordered together with the keys. Equal keys keep their relative order.
+        static void radixSort( std::vector< unsigned long long >& keys, std::vector< unsigned int >& indices,
+                               std::vector< unsigned long long >& tmpKeys, std::vector< unsigned int >& tmpIndices );
+
+        // Statistics of the last submit.
+        const Statistics& getStatistics() const;
+
+        private:
+
+        struct Draw
+        {
+            const BlockModel* model;
+            float43           worldMatrix;
+        };
+
+        struct InstancedDraw
+        {
+            const BlockModel* model;
+            int               shader;
+            int               material;
+            int               firstInstance;
+            int               instanceCount;
+        };
+
+        int getModelId( const BlockModel& model );
+
+        float m_maxDepth;
+
+        std::unordered_map< const BlockModel*, int > m_modelIds;
+
+        std::vector< Draw >               m_draws;
+        std::vector< unsigned long long > m_keys;
+        std::vector< unsigned int >       m_order;
+
+        std::vector< InstancedDraw > m_instancedDraws;
+        std::vector< float43 >       m_instanceWorldMatrices;
+
+        // Reused between calls to avoid allocations.
+        std::vector< unsigned long long > m_tmpKeys;
+        std::vector< unsigned int >       m_tmpOrder;
+
+        Statistics m_statistics;
+    };
+}
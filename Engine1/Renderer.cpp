@@ -34,6 +34,76 @@ using namespace Engine1;
 
 using Microsoft::WRL::ComPtr;
 
+const int Renderer::s_contributionReadbackLatency = 2;
+
+namespace
+{
+    // Render queue passes and materials used by the primary layer.
+    enum class RenderQueuePass : int
+    {
+        Actors       = 0,
+        LightSources = 1
+    };
+
+    enum class RenderQueueMaterial : int
+    {
+        Default       = 0,
+        SelectedActor = 1,
+        SelectedLight = 2,
+        DisabledLight = 3
+    };
+
+    const float4 renderQueueMaterialExtraEmissive[] = {
+        float4( 0.0f, 0.0f, 0.0f, 0.0f ),
+        float4( 0.1f, 0.1f, 0.0f, 1.0f ),
+        float4( 0.0f, 0.0f, 1.0f, 1.0f ),
+        float4( 0.0f, 1.0f, 0.0f, 1.0f )
+    };
+
+    // Draws the instanced draws of a render queue with the deferred renderer.
+    class DeferredRenderQueueBackend : public RenderQueueBackend
+    {
+        public:
+
+        DeferredRenderQueueBackend( 
+            DX11DeferredRenderer& deferredRenderer, 
+            const DX11DeferredRenderer::DeferredRenderTargets& renderTargets, 
+            const DX11DeferredRenderer::Settings& settings, 
+            const float44& viewMatrix ) :
+            m_deferredRenderer( deferredRenderer ),
+            m_renderTargets( renderTargets ),
+            m_settings( settings ),
+            m_viewMatrix( viewMatrix )
+        {}
+
+        // Only the block model shader is used - it's enabled together with the model.
+        void bindShader( const int shader ) override
+        {}
+
+        void bindModel( const BlockModel& model, const int material ) override
+        {
+            m_deferredRenderer.bindModel( m_renderTargets, m_settings, model, renderQueueMaterialExtraEmissive[ material ] );
+        }
+
+        void drawInstances( const BlockModel& model, const float43* worldMatrices, const int instanceCount ) override
+        {
+            m_deferredRenderer.renderInstances( m_settings, model, worldMatrices, instanceCount, m_viewMatrix );
+        }
+
+        private:
+
+        DX11DeferredRenderer&                              m_deferredRenderer;
+        const DX11DeferredRenderer::DeferredRenderTargets& m_renderTargets;
+        const DX11DeferredRenderer::Settings&              m_settings;
+        const float44&                                     m_viewMatrix;
+    };
+
+    float getViewDepth( const float3& position, const float44& viewMatrix )
+    {
+        return ( float4( position, 1.0f ) * viewMatrix ).z;
+    }
+}
+
 Renderer::Renderer( DX11RendererCore& rendererCore, Profiler& profiler, RenderTargetManager& renderTargetManager ) :
     m_rendererCore( rendererCore ),
     m_profiler( profiler ),
@@ -62,7 +132,9 @@ Renderer::Renderer( DX11RendererCore& rendererCore, Profiler& profiler, RenderTa
     m_antialiasingRenderer( rendererCore ),
     m_debugViewType( View::Final ),
     m_exposure( 1.0f ),
-    m_minBrightness( 1.0f )
+    m_minBrightness( 1.0f ),
+    m_frameIdx( 0 ),
+    m_captureNextFrame( false )
 {}
 
 Renderer::~Renderer()
@@ -124,26 +196,25 @@ void Renderer::renderShadowMaps( const Scene& scene )
 
         m_shadowMapRenderer.clearRenderTarget( 1.0f ); //#TODO: What clear value?
 
-        for ( const auto& actor : scene.getActors() )
+        const Scene::BlockActorArrays& blockActors = scene.getBlockActors();
+        for ( int actorIdx = 0; actorIdx < blockActors.size(); ++actorIdx )
         {
-            if ( actor->getType() == Actor::Type::BlockActor )
-            {
-                const BlockActor& blockActor = static_cast< BlockActor& >( *actor );
-
-                if ( !blockActor.getModel() || !blockActor.getModel()->getMesh() )
-                    continue;
+            if ( ( blockActors.flags[ actorIdx ] & Scene::s_hasMeshFlag ) == 0 )
+                continue;
 
-                m_shadowMapRenderer.render( *blockActor.getModel()->getMesh(), blockActor.getPose(), viewMatrix, perspectiveMatrix );
-            }
-            else if ( actor->getType() == Actor::Type::BlockActor ) 
-            {
-                const SkeletonActor& skeletonActor = static_cast< SkeletonActor& >( *actor );
+            m_shadowMapRenderer.render( *blockActors.models[ actorIdx ]->getMesh(), blockActors.poses[ actorIdx ], viewMatrix, perspectiveMatrix );
+        }
 
-                if ( !skeletonActor.getModel() || !skeletonActor.getModel()->getMesh() )
-                    continue;
+        const Scene::SkeletonActorArrays& skeletonActors = scene.getSkeletonActors();
+        for ( int actorIdx = 0; actorIdx < skeletonActors.size(); ++actorIdx )
+        {
+            if ( ( skeletonActors.flags[ actorIdx ] & Scene::s_hasMeshFlag ) == 0 )
+                continue;
 
-                m_shadowMapRenderer.render( *skeletonActor.getModel()->getMesh(), skeletonActor.getPose(), viewMatrix, perspectiveMatrix, skeletonActor.getSkeletonPose() );
-            }
+            m_shadowMapRenderer.render( 
+                *skeletonActors.models[ actorIdx ]->getMesh(), skeletonActors.poses[ actorIdx ], viewMatrix, perspectiveMatrix, 
+                skeletonActors.actors[ actorIdx ]->getSkeletonPose() 
+            );
         }
 
         spotLight.setShadowMap( m_shadowMapRenderer.getRenderTarget() );
@@ -157,29 +228,173 @@ Renderer::Output Renderer::renderScene(
     const bool wireframeMode,
     const Selection& selection,
     const std::shared_ptr< BlockMesh > selectionVolumeMesh )
+{
+    if ( !m_captureNextFrame )
+        return renderFrame( scene, camera, wireframeMode, selection, selectionVolumeMesh );
+
+    m_captureNextFrame = false;
+
+    m_capturedCommandList.clear();
+    m_rendererCore.setCommandList( &m_capturedCommandList );
+
+    const Output output = renderFrame( scene, camera, wireframeMode, selection, selectionVolumeMesh );
+
+    m_rendererCore.setCommandList( nullptr );
+
+    analyzeCapturedFrame();
+
+    return output;
+}
+
+void Renderer::captureNextFrame()
+{
+    m_captureNextFrame = true;
+}
+
+const RenderCommandList& Renderer::getCapturedCommandList() const
+{
+    return m_capturedCommandList;
+}
+
+const NullRenderCommandBackend& Renderer::getCapturedFrameAnalysis() const
+{
+    return m_capturedFrameAnalysis;
+}
+
+void Renderer::analyzeCapturedFrame()
+{
+    m_capturedFrameAnalysis.reset();
+
+    std::string log = "\n\nRenderer::analyzeCapturedFrame - " + std::to_string( m_capturedCommandList.getCommands().size() ) + " commands";
+
+    try 
+    {
+        m_capturedCommandList.execute( m_capturedFrameAnalysis );
+    } 
+    catch ( const std::exception& e ) 
+    {
+        // Invalid stream is a finding of the capture, not an error of the frame - the frame was already rendered.
+        OutputDebugStringW( StringUtil::widen( log + ", invalid: " + e.what() + "\n\n" ).c_str() );
+        return;
+    }
+
+    const auto getStatisticsText = []( const NullRenderCommandBackend::Statistics& statistics ) {
+        return std::to_string( statistics.drawCount ) + " draws (" + std::to_string( statistics.instanceCount ) + " instances), "
+            + std::to_string( statistics.dispatchCount ) + " dispatches, " + std::to_string( statistics.copyCount ) + " copies, "
+            + std::to_string( statistics.barrierCount ) + " barriers, " + std::to_string( statistics.redundantBindCount ) + " of "
+            + std::to_string( statistics.bindCount ) + " binds redundant";
+    };
+
+    log += ": " + getStatisticsText( m_capturedFrameAnalysis.getStatistics() ) + "\n";
+
+    for ( const std::string& passName : m_capturedFrameAnalysis.getPassNames() )
+        log += "    " + passName + ": " + getStatisticsText( m_capturedFrameAnalysis.getPassStatistics( passName ) ) + "\n";
+
+    OutputDebugStringW( StringUtil::widen( log + "\n" ).c_str() );
+}
+
+Renderer::Output Renderer::renderFrame( 
+    const Scene& scene, const Camera& camera,
+    const bool wireframeMode,
+    const Selection& selection,
+    const std::shared_ptr< BlockMesh > selectionVolumeMesh )
 {
     // Render shadow maps. #TODO: Should NOT be done every frame.
     //renderShadowMaps( scene );
 
-    const auto& lights                  = scene.getLightsVec();
-    const auto  lightsEnabled           = SceneUtil::filterLightsByState( lights, true );
+    ++m_frameIdx;
+
+    const float zNear = settings().rendering.zNear;
+    const float zFar  = settings().rendering.zFar;
+
+    const float44 viewMatrix = MathUtil::lookAtTransformation( 
+        camera.getLookAtPoint(), 
+        camera.getPosition(), 
+        camera.getUp() 
+    );
+
+    { // Cull actors outside of the view frustum or hidden behind large occluders.
+        const float44 projectionMatrix = MathUtil::perspectiveProjectionTransformation( 
+            camera.getFieldOfView(), 
+            (float)m_imageDimensions.x / (float)m_imageDimensions.y, 
+            zNear, 
+            zFar 
+        );
 
-    const auto  lightsCastingShadows    = settings().rendering.shadows.enabled 
-        ? SceneUtil::filterLightsByShadowCasting( lightsEnabled, true )
-        : std::vector< std::shared_ptr< Light > >();
+        ActorCulling::Settings cullingSettings;
+        cullingSettings.frustumCulling            = settings().rendering.culling.frustumCulling;
+        cullingSettings.occlusionCulling          = settings().rendering.culling.occlusionCulling;
+        cullingSettings.occlusionBufferDimensions = int2( settings().rendering.culling.occlusionBufferWidth, settings().rendering.culling.occlusionBufferHeight );
+        cullingSettings.maxOccluderCount          = settings().rendering.culling.maxOccluderCount;
 
-    const auto  lightsNotCastingShadows = settings().rendering.shadows.enabled
-        ? SceneUtil::filterLightsByShadowCasting( lightsEnabled, false )
-        : lightsEnabled;
+        m_actorCulling.update( scene );
+        m_actorCulling.cull( viewMatrix * projectionMatrix, cullingSettings );
+    }
+
+    // Light lists are members - their memory is reused between frames.
+    SceneUtil::filterLightsByState( scene.getLights(), true, m_lightsEnabled );
+
+    std::vector< std::shared_ptr< Light > >& lightsCastingShadows    = m_lightsCastingShadows;
+    std::vector< std::shared_ptr< Light > >& lightsNotCastingShadows = m_lightsNotCastingShadows;
+
+    lightsCastingShadows.clear();
+    lightsNotCastingShadows.clear();
+
+    if ( settings().rendering.shadows.enabled )
+    {
+        // Full ray traced shadow chain runs per light - only the shadow casting lights contributing the most to the visible surfaces get it.
+        m_lightClusters.build( 
+            viewMatrix, camera.getFieldOfView(), (float)m_imageDimensions.x / (float)m_imageDimensions.y, zNear, zFar, 
+            m_lightsEnabled, m_actorCulling.getVisibleBoundingBoxes() 
+        );
+
+        m_isLightShadowed.assign( m_lightsEnabled.size(), false );
+
+        for ( const int lightIdx : m_lightClusters.getLightsByImportance() )
+        {
+            if ( (int)lightsCastingShadows.size() >= settings().rendering.shadows.maxShadowedLightCount )
+                break;
+
+            if ( m_lightsEnabled[ lightIdx ]->isCastingShadows() ) {
+                lightsCastingShadows.push_back( m_lightsEnabled[ lightIdx ] );
+                m_isLightShadowed[ lightIdx ] = true;
+            }
+        }
+
+        // Lights which don't reach any visible cluster (e.g. with no visible geometry in range) still get the remaining slots - 
+        // their shadows may be visible after all, as light clusters only cover the visible actor bounds.
+        for ( size_t lightIdx = 0; lightIdx < m_lightsEnabled.size(); ++lightIdx )
+        {
+            if ( (int)lightsCastingShadows.size() >= settings().rendering.shadows.maxShadowedLightCount )
+                break;
+
+            if ( !m_isLightShadowed[ lightIdx ] && m_lightsEnabled[ lightIdx ]->isCastingShadows() ) {
+                lightsCastingShadows.push_back( m_lightsEnabled[ lightIdx ] );
+                m_isLightShadowed[ lightIdx ] = true;
+            }
+        }
+
+        for ( size_t lightIdx = 0; lightIdx < m_lightsEnabled.size(); ++lightIdx )
+        {
+            if ( !m_isLightShadowed[ lightIdx ] )
+                lightsNotCastingShadows.push_back( m_lightsEnabled[ lightIdx ] );
+        }
+    }
+    else
+    {
+        lightsNotCastingShadows = m_lightsEnabled;
+    }
 
     m_layersRenderTargets.reserve( settings().rendering.reflectionsRefractions.maxLevel + 1 );
 
     Output output; 
+    m_rendererCore.beginPass( "renderPrimaryLayer" );
     output = renderPrimaryLayer( 
         scene, camera, lightsCastingShadows, lightsNotCastingShadows, 
         settings().rendering.reflectionsRefractions.debugViewStage, m_debugViewType, wireframeMode,
         selection, selectionVolumeMesh 
     );
+    m_rendererCore.endPass();
 
     // Release all temporary render targets.
     m_layersRenderTargets.clear();
@@ -190,6 +405,7 @@ Renderer::Output Renderer::renderScene(
     assert( output.float4Image );
 
     m_profiler.beginEvent( Profiler::GlobalEventType::PostProcess );
+    m_rendererCore.beginPass( "postProcess" );
 
     decltype(output.float4Image) currentRenderTargetHDR = output.float4Image;
     output.float4Image.reset();
@@ -214,6 +430,8 @@ Renderer::Output Renderer::renderScene(
 
         if ( m_debugViewType == View::BloomBrightPixels ) 
         {
+            m_rendererCore.endPass();
+
             output.reset();
             output.float4Image = currentRenderTargetHDR;
 
@@ -241,6 +459,7 @@ Renderer::Output Renderer::renderScene(
         finalOutput.uchar4Image = currentRenderTargetLDR;
     }
 
+    m_rendererCore.endPass();
     m_profiler.endEvent( Profiler::GlobalEventType::PostProcess );
 
     return finalOutput;
@@ -260,8 +479,8 @@ void Renderer::renderText(
     defferedSettings.fieldOfView     = 0.0f; // Not used.
     defferedSettings.imageDimensions = (float2)m_imageDimensions;
     defferedSettings.wireframeMode   = false;
-    defferedSettings.zNear           = 0.1f;
-    defferedSettings.zFar            = 1000.0f;
+    defferedSettings.zNear           = settings().rendering.zNear;
+    defferedSettings.zFar            = settings().rendering.zFar;
 
     m_deferredRenderer.render( deferredRenderTargets, defferedSettings, text, font, position, color );
 }
@@ -317,8 +536,8 @@ Renderer::Output Renderer::renderPrimaryLayer(
         defferedSettings.fieldOfView     = camera.getFieldOfView();
         defferedSettings.imageDimensions = (float2)m_imageDimensions;
         defferedSettings.wireframeMode   = wireframeMode;
-        defferedSettings.zNear           = 0.1f;
-        defferedSettings.zFar            = 1000.0f;
+        defferedSettings.zNear           = settings().rendering.zNear;
+        defferedSettings.zFar            = settings().rendering.zFar;
 
         float44 viewMatrix = MathUtil::lookAtTransformation( 
             camera.getLookAtPoint(), 
@@ -328,11 +547,12 @@ Renderer::Output Renderer::renderPrimaryLayer(
 
         m_profiler.beginEvent( Profiler::GlobalEventType::DeferredRendering );
 
-        float4 actorSelectionEmissiveColor( 0.1f, 0.1f, 0.0f, 1.0f );
+        // Block models go through the render queue - sorted and drawn in instanced draws, one per model and material.
+        m_renderQueue.clear( defferedSettings.zFar );
 
-        // Render actors in the scene.
-        const std::unordered_set< std::shared_ptr<Actor> >& actors = scene.getActors();
-        for ( const std::shared_ptr<Actor> actor : actors ) 
+        // Render visible actors in the scene (culled in renderScene).
+        const std::vector< std::shared_ptr<Actor> >& actors = m_actorCulling.getVisibleActors();
+        for ( const std::shared_ptr<Actor>& actor : actors ) 
         {
             if ( actor->getType() == Actor::Type::BlockActor ) 
             {
@@ -344,17 +564,14 @@ Renderer::Output Renderer::renderPrimaryLayer(
                 if ( !blockModel->isInGpuMemory() )
                     continue;
 
-                const float4 extraEmissive = isSelected ? actorSelectionEmissiveColor : float4::ZERO;
-                
-                m_deferredRenderer.render( 
-                    defferedRenderTargets,
-                    defferedSettings,
+                m_renderQueue.add( 
                     *blockModel, 
                     blockActor->getPose(), 
-                    viewMatrix, 
-                    extraEmissive
+                    getViewDepth( blockActor->getPose().getTranslation(), viewMatrix ), 
+                    (int)RenderQueuePass::Actors, 
+                    0, 
+                    (int)( isSelected ? RenderQueueMaterial::SelectedActor : RenderQueueMaterial::Default )
                 );
-
             } 
             else if ( actor->getType() == Actor::Type::SkeletonActor ) 
             {
@@ -366,7 +583,7 @@ Renderer::Output Renderer::renderPrimaryLayer(
                 if ( skeletonModel->isInGpuMemory() )
                     continue;
 
-                const float4 extraEmissive = isSelected ? actorSelectionEmissiveColor : float4::ZERO;
+                const float4 extraEmissive = renderQueueMaterialExtraEmissive[ (int)( isSelected ? RenderQueueMaterial::SelectedActor : RenderQueueMaterial::Default ) ];
 
                 m_deferredRenderer.render( 
                     defferedRenderTargets,
@@ -380,9 +597,6 @@ Renderer::Output Renderer::renderPrimaryLayer(
             }
         }
 
-        float4 lightSelectionEmissiveColor( 0.0f, 0.0f, 1.0f, 1.0f );
-        float4 lightDisabledEmissiveColor( 0.0f, 1.0f, 0.0f, 1.0f );
-
         // Render light sources in the scene.
         if ( m_lightModel && settings().debug.renderLightSources ) 
         {
@@ -393,21 +607,26 @@ Renderer::Output Renderer::renderPrimaryLayer(
 
                 lightPose.setTranslation( light->getPosition() );
 
-                float4 extraEmissive = isSelected ?
-                    lightSelectionEmissiveColor :
-                    ( light->isEnabled() ? float4::ZERO : lightDisabledEmissiveColor );
+                const RenderQueueMaterial material = isSelected ?
+                    RenderQueueMaterial::SelectedLight :
+                    ( light->isEnabled() ? RenderQueueMaterial::Default : RenderQueueMaterial::DisabledLight );
 
-                m_deferredRenderer.render( 
-                    defferedRenderTargets,
-                    defferedSettings, 
+                m_renderQueue.add( 
                     *m_lightModel, 
                     lightPose, 
-                    viewMatrix, 
-                    extraEmissive 
+                    getViewDepth( light->getPosition(), viewMatrix ), 
+                    (int)RenderQueuePass::LightSources, 
+                    0, 
+                    (int)material 
                 );
             }
         }
 
+        m_renderQueue.sort();
+
+        DeferredRenderQueueBackend renderQueueBackend( m_deferredRenderer, defferedRenderTargets, defferedSettings, viewMatrix );
+        m_renderQueue.submit( renderQueueBackend );
+
         // Render selection volume.
         if ( selectionVolumeMesh )
         {
@@ -475,7 +694,11 @@ Renderer::Output Renderer::renderPrimaryLayer(
 
     m_profiler.endEvent( RenderingStage::Main, Profiler::EventTypePerStage::ShadingNoShadows );
 
-    const auto blockActors = SceneUtil::filterActorsByType< BlockActor >( scene.getActorsVec() );
+    const auto& blockActors = scene.getBlockActors().actors;
+
+    // Only surfaces of the actors visible from the camera receive shadows in the primary layer.
+    m_shadowCasterCulling.update( blockActors );
+    m_shadowCasterCulling.setReceivers( m_actorCulling.getVisibleBoundingBoxes() );
 
     auto finalDistanceToOccluderHardShadowImageDimensions = 
         m_imageDimensions / settings().rendering.shadows.distanceToOccluderSearch.hardShadows.outputDimensionsDivider;
@@ -552,7 +775,7 @@ Renderer::Output Renderer::renderPrimaryLayer(
             distanceToOccluderMediumShadowRenderTarget,
             distanceToOccluderSoftShadowRenderTarget,
             //m_rasterizeShadowRenderer.getShadowTexture(),
-            blockActors
+            m_shadowCasterCulling.cull( *lightsCastingShadows[ lightIdx ] )
         );
 
         m_profiler.endEvent( RenderingStage::Main, lightIdx, Profiler::EventTypePerStagePerLight::RaytracingShadows );
@@ -958,22 +1181,26 @@ Renderer::Output Renderer::renderPrimaryLayer(
 
     Output output;
 
+    m_rendererCore.beginPass( "renderSecondaryLayers" );
     output = renderSecondaryLayers(
         settings().rendering.reflectionsRefractions.maxLevel,
         camera, blockActors, lightsCastingShadows, lightsNotCastingShadows,
         RenderingStage::R,
         settings().rendering.reflectionsRefractions.debugViewStage, m_debugViewType
     );
+    m_rendererCore.endPass();
 
     if ( !output.isEmpty() )
         return output;
 
+    m_rendererCore.beginPass( "renderSecondaryLayers" );
     output = renderSecondaryLayers(
         settings().rendering.reflectionsRefractions.maxLevel,
         camera, blockActors, lightsCastingShadows, lightsNotCastingShadows,
         RenderingStage::T,
         settings().rendering.reflectionsRefractions.debugViewStage, m_debugViewType
     );
+    m_rendererCore.endPass();
 
     if ( !output.isEmpty() )
         return output;
@@ -1010,7 +1237,16 @@ Renderer::Output Renderer::renderSecondaryLayers(
     std::shared_ptr< Texture2D< float2  > >        frameFloat2;
     std::shared_ptr< Texture2D< float  > >         frameFloat;
 
-    renderSecondaryLayer( renderingStage, camera, blockActors, lightsCastingShadows, lightsNotCastingShadows );
+    // Stage viewed in debug mode and the stages leading to it are always rendered.
+    const bool canBePruned = debugViewType == View::Final || !isRenderingStageInSubtree( debugViewStage, renderingStage );
+
+    m_rendererCore.beginPass( "renderSecondaryLayer" );
+    const bool layerRendered = renderSecondaryLayer( renderingStage, canBePruned, camera, blockActors, lightsCastingShadows, lightsNotCastingShadows );
+    m_rendererCore.endPass();
+
+    // Pruned stage - its children contribute even less.
+    if ( !layerRendered )
+        return Output();
 
     if ( renderingStage == debugViewStage )
     {
@@ -1056,8 +1292,8 @@ Renderer::Output Renderer::renderSecondaryLayers(
     return output;
 }
 
-void Renderer::renderSecondaryLayer(
-    const RenderingStage renderingStage, const Camera& camera,
+bool Renderer::renderSecondaryLayer(
+    const RenderingStage renderingStage, const bool canBePruned, const Camera& camera,
     const std::vector< std::shared_ptr< BlockActor > >& blockActors,
     const std::vector< std::shared_ptr< Light > >& lightsCastingShadows,
     const std::vector< std::shared_ptr< Light > >& lightsNotCastingShadows )
@@ -1154,6 +1390,15 @@ void Renderer::renderSecondaryLayer(
 
     m_profiler.endEvent( renderingStage, Profiler::EventTypePerStage::ReflectionTransmissionShading );
 
+    // Estimate is read back even if the stage ends up pruned - to notice when it becomes visible again.
+    if ( settings().rendering.reflectionsRefractions.pruning.enabled 
+         && !updateContributionEstimate( renderingStage, *currLayerRTs.contributionRoughness ) 
+         && canBePruned )
+    {
+        m_profiler.endEvent( renderingStage, Profiler::EventTypePerStage::Total_WO_Combining );
+        return false;
+    }
+
     RaytraceRenderer::InputTextures2 raytracerInputs;
     raytracerInputs.contribution                   = currLayerRTs.contributionRoughness;
     raytracerInputs.prevHitPosition                = prevLayerRTs.hitPosition;
@@ -1259,6 +1504,10 @@ void Renderer::renderSecondaryLayer(
 
     m_profiler.endEvent( renderingStage, Profiler::EventTypePerStage::ShadingNoShadows );
 
+    // Reflected/refracted rays can hit any actor - all of them are shadow receivers.
+    m_shadowCasterCulling.update( blockActors );
+    m_shadowCasterCulling.setAllActorsAsReceivers();
+
     auto finalDistanceToOccluderHardShadowImageDimensions = 
         m_imageDimensions / settings().rendering.shadows.distanceToOccluderSearch.hardShadows.outputDimensionsDivider;
 
@@ -1309,7 +1558,7 @@ void Renderer::renderSecondaryLayer(
             distanceToOccluderHardShadowRenderTarget,
             distanceToOccluderMediumShadowRenderTarget,
             distanceToOccluderSoftShadowRenderTarget,
-            blockActors
+            m_shadowCasterCulling.cull( *lightsCastingShadows[ lightIdx ] )
         );
 
         m_profiler.endEvent( renderingStage, lightIdx, Profiler::EventTypePerStagePerLight::RaytracingShadows );
@@ -1558,6 +1807,61 @@ void Renderer::renderSecondaryLayer(
 
     m_profiler.endEvent( renderingStage, Profiler::EventTypePerStage::HitDistanceSearch );
     m_profiler.endEvent( renderingStage, Profiler::EventTypePerStage::Total_WO_Combining );
+
+    return true;
+}
+
+bool Renderer::updateContributionEstimate( const RenderingStage renderingStage, RenderTargetTexture2D< uchar4 >& contributionRoughness )
+{
+    const int  mipmapLevel = std::max( 0, std::min( settings().rendering.reflectionsRefractions.pruning.readbackMipmapLevel, contributionRoughness.getMipMapCountOnGpu() - 1 ) );
+    const int2 dimensions  = contributionRoughness.getDimensions( mipmapLevel );
+
+    auto& readback = m_contributionReadbacks[ renderingStage ];
+
+    // (Re)create the staging textures - first use, changed mipmap level or image dimensions.
+    if ( readback.textures.empty() || int2( readback.textures.front()->getWidth(), readback.textures.front()->getHeight() ) != dimensions )
+    {
+        readback.textures.clear();
+        readback.frames.clear();
+
+        for ( int textureIdx = 0; textureIdx <= s_contributionReadbackLatency; ++textureIdx ) {
+            readback.textures.push_back( std::make_shared< StagingTexture2D< uchar4 > >( *m_device.Get(), dimensions.x, dimensions.y, DXGI_FORMAT_R8G8B8A8_UINT ) );
+            readback.frames.push_back( -1 );
+        }
+    }
+
+    // Stage wasn't reached in the previous frame (e.g. its parent was pruned) - copies in the ring and the estimate
+    // describe an older view, so they are dropped and the stage is rendered until a fresh copy is read back.
+    if ( readback.lastFrame != m_frameIdx - 1 )
+    {
+        std::fill( readback.frames.begin(), readback.frames.end(), -1 );
+        m_rayTreePruning.remove( renderingStage );
+    }
+
+    readback.lastFrame = m_frameIdx;
+
+    contributionRoughness.createMipMapsOnGpu( *m_deviceContext.Get() );
+
+    const int writeIdx = (int)( m_frameIdx % (long long)readback.textures.size() );
+    m_rendererCore.copyTextureGpu( *readback.textures[ writeIdx ], 0, contributionRoughness, mipmapLevel );
+    readback.frames[ writeIdx ] = m_frameIdx;
+
+    // Read the newest copy which is old enough for the GPU to have finished it.
+    int readIdx = -1;
+    for ( int textureIdx = 0; textureIdx < (int)readback.textures.size(); ++textureIdx )
+    {
+        const long long frame = readback.frames[ textureIdx ];
+
+        if ( frame >= 0 && frame <= m_frameIdx - s_contributionReadbackLatency && ( readIdx < 0 || frame > readback.frames[ readIdx ] ) )
+            readIdx = textureIdx;
+    }
+
+    if ( readIdx >= 0 ) {
+        readback.textures[ readIdx ]->loadGpuToCpu( *m_deviceContext.Get() );
+        m_rayTreePruning.update( renderingStage, readback.textures[ readIdx ]->getData(), dimensions );
+    }
+
+    return m_rayTreePruning.isStageVisible( renderingStage, settings().rendering.reflectionsRefractions.pruning.contributionThreshold );
 }
 
 void Renderer::combineLayers( const RenderingStage renderingStage, const Camera& camera )
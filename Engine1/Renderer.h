@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <map>
 #include <wrl.h>
 #include "Texture2D.h"
 
@@ -26,6 +27,14 @@
 #include "ExtractBrightPixelsRenderer.h"
 #include "ToneMappingRenderer.h"
 #include "AntialiasingRenderer.h"
+#include "ActorCulling.h"
+#include "ShadowCasterCulling.h"
+#include "LightClusters.h"
+#include "RenderQueue.h"
+#include "RayTreePruning.h"
+#include "RenderCommandList.h"
+#include "NullRenderCommandBackend.h"
+#include "StagingTexture2D.h"
 
 #include "RenderingStage.h"
 
@@ -192,6 +201,14 @@ namespace Engine1
             const std::shared_ptr< BlockMesh > selectionVolumeMesh 
         );
 
+        // Records the next frame rendered by renderScene into a command list and executes it with NullRenderCommandBackend -
+        // which validates the stream and counts the work of each pass. The statistics are logged to the debug output.
+        void captureNextFrame();
+
+        // Commands and analysis of the last captured frame.
+        const RenderCommandList&        getCapturedCommandList() const;
+        const NullRenderCommandBackend& getCapturedFrameAnalysis() const;
+
         void renderText( 
             const std::string& text, 
             Font& font, 
@@ -214,6 +231,15 @@ namespace Engine1
 
         private:
 
+        Output renderFrame( 
+            const Scene& scene, const Camera& camera,
+            const bool wireframeMode,
+            const Selection& selection,
+            const std::shared_ptr< BlockMesh > selectionVolumeMesh 
+        );
+
+        void analyzeCapturedFrame();
+
         Output renderPrimaryLayer( 
             const Scene& scene, const Camera& camera, 
             const std::vector< std::shared_ptr< Light > >& lightsCastingShadows,
@@ -234,13 +260,19 @@ namespace Engine1
             const View debugViewType
         );
 
-        void renderSecondaryLayer(
-            const RenderingStage renderingStage, const Camera& camera,
+        // Returns false if the stage was pruned after computing its contribution (nothing else was rendered).
+        // Stages which can't be pruned still get their contribution estimate updated.
+        bool renderSecondaryLayer(
+            const RenderingStage renderingStage, const bool canBePruned, const Camera& camera,
             const std::vector< std::shared_ptr< BlockActor > >& blockActors,
             const std::vector< std::shared_ptr< Light > >& lightsCastingShadows,
             const std::vector< std::shared_ptr< Light > >& lightsNotCastingShadows
         );
 
+        // Reads back a mipmap of the stage's contribution image and updates its contribution estimate.
+        // Returns whether the stage contributes enough to be rendered.
+        bool updateContributionEstimate( const RenderingStage renderingStage, RenderTargetTexture2D< uchar4 >& contributionRoughness );
+
         void combineLayers( const RenderingStage renderingStage, const Camera& camera );
 
         void performBloom( 
@@ -301,10 +333,42 @@ namespace Engine1
         AntialiasingRenderer                m_antialiasingRenderer;
         BokehBlurRenderer                   m_bokehBlurRenderer;
 
+        ActorCulling        m_actorCulling;
+        ShadowCasterCulling m_shadowCasterCulling;
+        LightClusters       m_lightClusters;
+        RenderQueue         m_renderQueue;
+
+        // Lights of the current frame - kept between frames to reuse their memory.
+        std::vector< std::shared_ptr< Light > > m_lightsEnabled;
+        std::vector< std::shared_ptr< Light > > m_lightsCastingShadows;
+        std::vector< std::shared_ptr< Light > > m_lightsNotCastingShadows;
+        std::vector< bool >                     m_isLightShadowed;
+
         std::vector< LayerRenderTargets > m_layersRenderTargets;
 
+        // Contribution images are copied to a ring of staging textures and read a few frames later - to avoid waiting for the GPU.
+        struct ContributionReadback
+        {
+            std::vector< std::shared_ptr< StagingTexture2D< uchar4 > > > textures;
+            // Frame in which each texture was copied to. -1 if not yet.
+            std::vector< long long > frames;
+            // Last frame in which the stage was rendered - copies older than a skipped frame are stale.
+            long long lastFrame = -1;
+        };
+
+        static const int s_contributionReadbackLatency;
+
+        long long m_frameIdx;
+
+        RayTreePruning                                   m_rayTreePruning;
+        std::map< RenderingStage, ContributionReadback > m_contributionReadbacks;
+
         std::shared_ptr<const BlockModel> m_lightModel;
 
+        bool                     m_captureNextFrame;
+        RenderCommandList        m_capturedCommandList;
+        NullRenderCommandBackend m_capturedFrameAnalysis;
+
         Output getLayerRenderTarget( View view, int level );
 
         // Copying is not allowed.
@@ -63,6 +63,16 @@ int Engine1::getRenderingStageRefractionLevelCount( RenderingStage stage )
     return refractionLevel;
 }
 
+bool Engine1::isRenderingStageInSubtree( const RenderingStage stage, const RenderingStage subtreeRoot )
+{
+    const int levelDifference = getRenderingStageLevel( stage ) - getRenderingStageLevel( subtreeRoot );
+
+    if ( levelDifference < 0 )
+        return false;
+
+    return ( (int)stage >> levelDifference ) == (int)subtreeRoot;
+}
+
 std::string Engine1::renderingStageToString( const RenderingStage stageType )
 {
     switch (stageType)
@@ -58,5 +58,8 @@ namespace Engine1
     int                getRenderingStageLevel( const RenderingStage stage );
     int                getRenderingStageRefractionLevelCount( RenderingStage stage );
 
+    // Whether the stage is the subtree root itself or one of its descendants (stages of the rays spawned from it).
+    bool               isRenderingStageInSubtree( const RenderingStage stage, const RenderingStage subtreeRoot );
+
     std::string renderingStageToString( const RenderingStage stageType );
 }
@@ -3,11 +3,66 @@
 #include "SceneParser.h"
 #include "BinaryFile.h"
 #include "SceneFileInfo.h"
+#include "Actor.h"
+#include "BlockActor.h"
+#include "SkeletonActor.h"
+#include "BlockModel.h"
+#include "SkeletonModel.h"
+#include "BlockMesh.h"
+#include "SkeletonMesh.h"
+#include "Light.h"
+#include "MathUtil.h"
+#include "JobSystem.h"
 
 #include <tuple>
+#include <cfloat>
 
 using namespace Engine1;
 
+const unsigned char Scene::s_castsShadowFlag = 1;
+const unsigned char Scene::s_hasMeshFlag     = 2;
+
+const int Scene::s_minActorCountPerJob = 4096;
+
+namespace
+{
+    const BoundingBox emptyBoundingBox( float3( FLT_MAX, FLT_MAX, FLT_MAX ), float3( -FLT_MAX, -FLT_MAX, -FLT_MAX ) );
+
+    BoundingBox getLocalBoundingBox( const BlockActor& actor )
+    {
+        return actor.getModel()->getMesh()->getBoundingBox();
+    }
+
+    BoundingBox getLocalBoundingBox( const SkeletonActor& actor )
+    {
+        return actor.getBoundingBox();
+    }
+
+    void updateLocalData( BlockActor& actor )
+    {}
+
+    void updateLocalData( SkeletonActor& actor )
+    {
+        // Pose could have been modified through a non-const reference.
+        actor.updateBoneBounds();
+    }
+}
+
+Scene::Handle::Handle() :
+    slot( -1 ),
+    generation( 0 )
+{}
+
+bool Scene::Handle::operator==( const Handle& other ) const
+{
+    return slot == other.slot && generation == other.generation;
+}
+
+bool Scene::Handle::operator!=( const Handle& other ) const
+{
+    return !( *this == other );
+}
+
 std::tuple< std::shared_ptr<Scene>, std::shared_ptr<std::vector< std::shared_ptr<FileInfo> > > > Scene::createFromFile( std::string path )
 {
     std::shared_ptr<std::vector<char>> data = BinaryFile::load( path );
@@ -23,7 +78,6 @@ std::tuple< std::shared_ptr<Scene>, std::shared_ptr<std::vector< std::shared_ptr
 Scene::Scene()
 {}
 
-
 Scene::~Scene()
 {}
 
@@ -42,12 +96,32 @@ SceneFileInfo& Scene::getFileInfo()
     return m_fileInfo;
 }
 
-void Scene::addActor( std::shared_ptr<Actor> actor )
+Scene::Handle Scene::addActor( std::shared_ptr<Actor> actor )
 {
     if ( !actor )
         throw std::exception( "Scene::addActor - nullptr passed." );
 
-    m_actors.insert( actor );
+    const Handle existingHandle = getHandle( *actor );
+    if ( existingHandle.slot >= 0 )
+        return existingHandle;
+
+    const Handle handle = allocateSlot( m_actorSlots, m_freeActorSlots );
+    Slot& slot = m_actorSlots[ handle.slot ];
+
+    slot.index = (int)m_actors.size();
+    m_actors.push_back( actor );
+    m_actorIndexSlots.push_back( handle.slot );
+    m_actorSlotsByObject[ actor.get() ] = handle.slot;
+
+    if ( actor->getType() == Actor::Type::BlockActor ) {
+        slot.typeIndex = m_blockActors.size();
+        addToArrays( m_blockActors, m_blockActorSlots, std::static_pointer_cast< BlockActor >( actor ), handle.slot );
+    } else if ( actor->getType() == Actor::Type::SkeletonActor ) {
+        slot.typeIndex = m_skeletonActors.size();
+        addToArrays( m_skeletonActors, m_skeletonActorSlots, std::static_pointer_cast< SkeletonActor >( actor ), handle.slot );
+    }
+
+    return handle;
 }
 
 void Scene::removeActor( std::shared_ptr<Actor> actor )
@@ -55,20 +129,73 @@ void Scene::removeActor( std::shared_ptr<Actor> actor )
     if ( !actor )
         throw std::exception( "Scene::removeActor - nullptr passed." );
 
-    m_actors.erase( actor );
+    const Handle handle = getHandle( *actor );
+    if ( handle.slot >= 0 )
+        removeActor( handle );
+}
+
+void Scene::removeActor( const Handle handle )
+{
+    if ( !isHandleValid( m_actorSlots, handle ) )
+        return;
+
+    const Slot slot = m_actorSlots[ handle.slot ];
+    const std::shared_ptr< Actor > actor = m_actors[ slot.index ];
+
+    if ( slot.proxy >= 0 )
+        m_spatialIndex.destroyProxy( slot.proxy );
+
+    if ( actor->getType() == Actor::Type::BlockActor )
+        removeFromArrays( m_blockActors, m_blockActorSlots, slot.typeIndex );
+    else if ( actor->getType() == Actor::Type::SkeletonActor )
+        removeFromArrays( m_skeletonActors, m_skeletonActorSlots, slot.typeIndex );
+
+    // Move the last actor into the freed place.
+    m_actors[ slot.index ]          = m_actors.back();
+    m_actorIndexSlots[ slot.index ] = m_actorIndexSlots.back();
+    m_actorSlots[ m_actorIndexSlots[ slot.index ] ].index = slot.index;
+
+    m_actors.pop_back();
+    m_actorIndexSlots.pop_back();
+
+    m_actorSlotsByObject.erase( actor.get() );
+    releaseSlot( m_actorSlots, m_freeActorSlots, handle.slot );
 }
 
 void Scene::removeAllActors()
 {
+    for ( const int slot : m_actorIndexSlots )
+        releaseSlot( m_actorSlots, m_freeActorSlots, slot );
+
     m_actors.clear();
+    m_actorIndexSlots.clear();
+    m_actorSlotsByObject.clear();
+
+    m_blockActors = BlockActorArrays();
+    m_blockActorSlots.clear();
+    m_skeletonActors = SkeletonActorArrays();
+    m_skeletonActorSlots.clear();
+
+    m_spatialIndex.clear();
 }
 
-void Scene::addLight( std::shared_ptr<Light> light )
+Scene::Handle Scene::addLight( std::shared_ptr<Light> light )
 {
     if ( !light )
         throw std::exception( "Scene::addLight - nullptr passed." );
 
-    m_lights.insert( light );
+    const Handle existingHandle = getHandle( *light );
+    if ( existingHandle.slot >= 0 )
+        return existingHandle;
+
+    const Handle handle = allocateSlot( m_lightSlots, m_freeLightSlots );
+
+    m_lightSlots[ handle.slot ].index = (int)m_lights.size();
+    m_lights.push_back( light );
+    m_lightIndexSlots.push_back( handle.slot );
+    m_lightSlotsByObject[ light.get() ] = handle.slot;
+
+    return handle;
 }
 
 void Scene::removeLight( std::shared_ptr<Light> light )
@@ -76,12 +203,165 @@ void Scene::removeLight( std::shared_ptr<Light> light )
     if ( !light )
         throw std::exception( "Scene::removeLight - nullptr passed." );
 
-    m_lights.erase( light );
+    const Handle handle = getHandle( *light );
+    if ( handle.slot >= 0 )
+        removeLight( handle );
+}
+
+void Scene::removeLight( const Handle handle )
+{
+    if ( !isHandleValid( m_lightSlots, handle ) )
+        return;
+
+    const int index = m_lightSlots[ handle.slot ].index;
+
+    m_lightSlotsByObject.erase( m_lights[ index ].get() );
+
+    // Move the last light into the freed place.
+    m_lights[ index ]          = m_lights.back();
+    m_lightIndexSlots[ index ] = m_lightIndexSlots.back();
+    m_lightSlots[ m_lightIndexSlots[ index ] ].index = index;
+
+    m_lights.pop_back();
+    m_lightIndexSlots.pop_back();
+
+    releaseSlot( m_lightSlots, m_freeLightSlots, handle.slot );
 }
 
 void Scene::removeAllLights()
 {
+    for ( const int slot : m_lightIndexSlots )
+        releaseSlot( m_lightSlots, m_freeLightSlots, slot );
+
     m_lights.clear();
+    m_lightIndexSlots.clear();
+    m_lightSlotsByObject.clear();
+}
+
+Scene::Handle Scene::getHandle( const Actor& actor ) const
+{
+    const auto it = m_actorSlotsByObject.find( &actor );
+    if ( it == m_actorSlotsByObject.end() )
+        return Handle();
+
+    Handle handle;
+    handle.slot       = it->second;
+    handle.generation = m_actorSlots[ it->second ].generation;
+
+    return handle;
+}
+
+Scene::Handle Scene::getHandle( const Light& light ) const
+{
+    const auto it = m_lightSlotsByObject.find( &light );
+    if ( it == m_lightSlotsByObject.end() )
+        return Handle();
+
+    Handle handle;
+    handle.slot       = it->second;
+    handle.generation = m_lightSlots[ it->second ].generation;
+
+    return handle;
+}
+
+std::shared_ptr< Actor > Scene::getActor( const Handle handle ) const
+{
+    if ( !isHandleValid( m_actorSlots, handle ) )
+        return nullptr;
+
+    return m_actors[ m_actorSlots[ handle.slot ].index ];
+}
+
+std::shared_ptr< Light > Scene::getLight( const Handle handle ) const
+{
+    if ( !isHandleValid( m_lightSlots, handle ) )
+        return nullptr;
+
+    return m_lights[ m_lightSlots[ handle.slot ].index ];
+}
+
+int Scene::getActorIndex( const Actor& actor ) const
+{
+    const auto it = m_actorSlotsByObject.find( &actor );
+
+    return it != m_actorSlotsByObject.end() ? m_actorSlots[ it->second ].index : -1;
+}
+
+int Scene::getLightIndex( const Light& light ) const
+{
+    const auto it = m_lightSlotsByObject.find( &light );
+
+    return it != m_lightSlotsByObject.end() ? m_lightSlots[ it->second ].index : -1;
+}
+
+const std::vector< std::shared_ptr<Actor> >& Scene::getActors() const
+{
+    return m_actors;
+}
+
+const std::vector< std::shared_ptr<Light> >& Scene::getLights() const
+{
+    return m_lights;
+}
+
+const Scene::BlockActorArrays& Scene::getBlockActors() const
+{
+    return m_blockActors;
+}
+
+const Scene::SkeletonActorArrays& Scene::getSkeletonActors() const
+{
+    return m_skeletonActors;
+}
+
+void Scene::updateActorData()
+{
+    updateArrays( m_blockActors );
+    updateArrays( m_skeletonActors );
+
+    updateSpatialIndex( m_blockActors, m_blockActorSlots );
+    updateSpatialIndex( m_skeletonActors, m_skeletonActorSlots );
+}
+
+void Scene::findActors( const BoundingBox& box, std::vector< std::shared_ptr<Actor> >& result ) const
+{
+    std::vector< int > slots;
+    m_spatialIndex.queryBox( box, slots );
+
+    for ( const int slot : slots )
+        result.push_back( getActorInSlot( slot ) );
+}
+
+void Scene::findActorsInFrustum( const float44& viewProjection, std::vector< std::shared_ptr<Actor> >& result ) const
+{
+    std::vector< int > slots;
+    m_spatialIndex.queryFrustum( viewProjection, slots );
+
+    for ( const int slot : slots )
+        result.push_back( getActorInSlot( slot ) );
+}
+
+void Scene::findNearestActors( const float3& point, const int count, std::vector< std::shared_ptr<Actor> >& result ) const
+{
+    std::vector< int > slots;
+    m_spatialIndex.queryNearest( point, count, slots );
+
+    for ( const int slot : slots )
+        result.push_back( getActorInSlot( slot ) );
+}
+
+void Scene::rayCastActors( const float3& origin, const float3& direction, const float maxDistance,
+                           const std::function< float( const std::shared_ptr<Actor>&, float ) >& callback ) const
+{
+    m_spatialIndex.rayCast( origin, direction, maxDistance, [ this, &callback ]( const int slot, const float distance )
+    {
+        return callback( getActorInSlot( slot ), distance );
+    } );
+}
+
+const DynamicAabbTree& Scene::getSpatialIndex() const
+{
+    return m_spatialIndex;
 }
 
 void Scene::saveToFile( const std::string& path ) const
@@ -93,24 +373,140 @@ void Scene::saveToFile( const std::string& path ) const
     BinaryFile::save( path, data );
 }
 
-const std::unordered_set< std::shared_ptr<Actor> >& Scene::getActors( ) const
+Scene::Handle Scene::allocateSlot( std::vector< Slot >& slots, std::vector< int >& freeSlots )
 {
-    return m_actors;
+    Handle handle;
+
+    if ( freeSlots.empty() ) 
+    {
+        Slot slot;
+        slot.index      = -1;
+        slot.typeIndex  = -1;
+        slot.generation = 0;
+        slot.proxy      = -1;
+
+        handle.slot = (int)slots.size();
+        slots.push_back( slot );
+    } 
+    else 
+    {
+        handle.slot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+
+    handle.generation = slots[ handle.slot ].generation;
+
+    return handle;
 }
 
-std::vector< std::shared_ptr<Actor> > Scene::getActorsVec() const
+void Scene::releaseSlot( std::vector< Slot >& slots, std::vector< int >& freeSlots, const int slot )
 {
-    return std::vector< std::shared_ptr<Actor> >( m_actors.begin(), m_actors.end() );
+    // New generation invalidates the handles of the removed object.
+    ++slots[ slot ].generation;
+    slots[ slot ].index     = -1;
+    slots[ slot ].typeIndex = -1;
+    slots[ slot ].proxy     = -1;
+
+    freeSlots.push_back( slot );
 }
 
-const std::unordered_set< std::shared_ptr<Light> >& Scene::getLights() const
+bool Scene::isHandleValid( const std::vector< Slot >& slots, const Handle handle )
 {
-    return m_lights;
+    return handle.slot >= 0 && handle.slot < (int)slots.size() 
+        && slots[ handle.slot ].generation == handle.generation 
+        && slots[ handle.slot ].index >= 0;
+}
+
+template< typename ActorType, typename ModelType >
+void Scene::addToArrays( ActorArrays< ActorType, ModelType >& arrays, std::vector< int >& arraySlots, const std::shared_ptr< ActorType >& actor, const int slot )
+{
+    arrays.actors.push_back( actor );
+    arrays.poses.push_back( actor->getPose() );
+    arrays.bounds.push_back( emptyBoundingBox );
+    arrays.models.push_back( nullptr );
+    arrays.flags.push_back( 0 );
+
+    arraySlots.push_back( slot );
+
+    // Valid right away - scenes are often rendered or queried before the next updateActorData.
+    updateArraysElement( arrays, arrays.size() - 1 );
+    updateProxy( slot, arrays.flags.back(), arrays.bounds.back() );
 }
 
-std::vector< std::shared_ptr<Light> > Scene::getLightsVec( ) const
+template< typename ActorType, typename ModelType >
+void Scene::removeFromArrays( ActorArrays< ActorType, ModelType >& arrays, std::vector< int >& arraySlots, const int typeIndex )
 {
-    return std::vector< std::shared_ptr<Light> >( m_lights.begin(), m_lights.end() );
+    // Move the last actor of the type into the freed place.
+    arrays.actors[ typeIndex ] = arrays.actors.back();
+    arrays.poses[ typeIndex ]  = arrays.poses.back();
+    arrays.bounds[ typeIndex ] = arrays.bounds.back();
+    arrays.models[ typeIndex ] = arrays.models.back();
+    arrays.flags[ typeIndex ]  = arrays.flags.back();
+    arraySlots[ typeIndex ]    = arraySlots.back();
+
+    m_actorSlots[ arraySlots[ typeIndex ] ].typeIndex = typeIndex;
+
+    arrays.actors.pop_back();
+    arrays.poses.pop_back();
+    arrays.bounds.pop_back();
+    arrays.models.pop_back();
+    arrays.flags.pop_back();
+    arraySlots.pop_back();
 }
 
+template< typename ActorType, typename ModelType >
+void Scene::updateArrays( ActorArrays< ActorType, ModelType >& arrays )
+{
+    JobSystem::get().parallelFor( arrays.size(), s_minActorCountPerJob, [ &arrays ]( const int begin, const int end )
+    {
+        for ( int i = begin; i < end; ++i )
+            updateArraysElement( arrays, i );
+    } );
+}
+
+template< typename ActorType, typename ModelType >
+void Scene::updateArraysElement( ActorArrays< ActorType, ModelType >& arrays, const int typeIndex )
+{
+    ActorType&  actor = *arrays.actors[ typeIndex ];
+    const auto& model = actor.getModel();
+
+    updateLocalData( actor );
+
+    const bool hasMesh = model && model->getMesh();
+
+    arrays.poses[ typeIndex ]  = actor.getPose();
+    arrays.models[ typeIndex ] = model.get();
+    arrays.flags[ typeIndex ]  = ( actor.isCastingShadows() ? s_castsShadowFlag : 0 ) | ( hasMesh ? s_hasMeshFlag : 0 );
+    arrays.bounds[ typeIndex ] = hasMesh ? MathUtil::boundingBoxLocalToWorld( getLocalBoundingBox( actor ), arrays.poses[ typeIndex ] ) : emptyBoundingBox;
+}
 
+template< typename ActorType, typename ModelType >
+void Scene::updateSpatialIndex( const ActorArrays< ActorType, ModelType >& arrays, const std::vector< int >& arraySlots )
+{
+    // Serial - most actors stay within their fat boxes, which is just a containment test.
+    for ( int i = 0; i < arrays.size(); ++i )
+        updateProxy( arraySlots[ i ], arrays.flags[ i ], arrays.bounds[ i ] );
+}
+
+void Scene::updateProxy( const int slot, const unsigned char flags, const BoundingBox& bounds )
+{
+    Slot& slotData = m_actorSlots[ slot ];
+
+    if ( flags & s_hasMeshFlag ) 
+    {
+        if ( slotData.proxy >= 0 )
+            m_spatialIndex.moveProxy( slotData.proxy, bounds );
+        else
+            slotData.proxy = m_spatialIndex.createProxy( bounds, slot );
+    } 
+    else if ( slotData.proxy >= 0 ) 
+    {
+        m_spatialIndex.destroyProxy( slotData.proxy );
+        slotData.proxy = -1;
+    }
+}
+
+std::shared_ptr< Actor > Scene::getActorInSlot( const int slot ) const
+{
+    return m_actors[ m_actorSlots[ slot ].index ];
+}
@@ -1,24 +1,74 @@
 #pragma once
 
-#include <unordered_set>
+#include <unordered_map>
 #include <vector>
 #include <memory>
+#include <functional>
 
 #include "SceneFileInfo.h"
+#include "float43.h"
+#include "float44.h"
+#include "BoundingBox.h"
+#include "DynamicAabbTree.h"
 
 namespace Engine1
 {
     class Actor;
+    class BlockActor;
+    class SkeletonActor;
+    class BlockModel;
+    class SkeletonModel;
     class Light;
     class SceneParser;
     class FileInfo;
 
+    // Actors and lights are kept in dense arrays - iteration doesn't allocate and removal swaps the last element into the freed place
+    // (so the order changes). Handles stay valid until the object is removed and never refer to a different object afterwards.
+    // Besides the list of all the actors, each actor type has its own arrays of the data hot loops need (poses, world bounds, models, flags).
+    // Actor objects stay the owners of that data - it is copied into the arrays when an actor is added and by updateActorData, once per frame.
+    // World bounds of the actors with a mesh are also kept in a spatial index (dynamic AABB tree), which answers box, frustum,
+    // nearest and ray queries without testing every actor.
     class Scene
     {
         friend class SceneParser;
 
         public:
 
+        struct Handle
+        {
+            Handle();
+
+            bool operator==( const Handle& other ) const;
+            bool operator!=( const Handle& other ) const;
+
+            int          slot;
+            unsigned int generation;
+        };
+
+        // Data of a single actor type, one element per actor.
+        template< typename ActorType, typename ModelType >
+        struct ActorArrays
+        {
+            std::vector< std::shared_ptr< ActorType > > actors;
+            std::vector< float43 >                      poses;
+            // World bounds. Empty (min > max) for actors without a mesh.
+            std::vector< BoundingBox >                  bounds;
+            // Stable only while the model is loaded - used to group actors by model, not to access it.
+            std::vector< const ModelType* >             models;
+            // Combination of s_castsShadowFlag, s_hasMeshFlag.
+            std::vector< unsigned char >                flags;
+
+            int size() const { return (int)actors.size(); }
+        };
+
+        typedef ActorArrays< BlockActor, BlockModel >       BlockActorArrays;
+        typedef ActorArrays< SkeletonActor, SkeletonModel > SkeletonActorArrays;
+
+        static const unsigned char s_castsShadowFlag;
+        static const unsigned char s_hasMeshFlag;
+
+        static const int s_minActorCountPerJob;
+
         // Returns the parsed scene (with models containing only file info) and a vector of unique models (their file infos) in that scene.
         static std::tuple< std::shared_ptr<Scene>, std::shared_ptr<std::vector< std::shared_ptr<FileInfo> > > > createFromFile( std::string path );
 
@@ -29,27 +79,114 @@ namespace Engine1
         const SceneFileInfo& getFileInfo() const;
         SceneFileInfo&       getFileInfo();
 
-        void addActor( std::shared_ptr<Actor> actor );
-        void removeActor( std::shared_ptr<Actor> actor );
-        void removeAllActors();
+        // Adding an actor which is already in the scene returns its existing handle.
+        Handle addActor( std::shared_ptr<Actor> actor );
+        void   removeActor( std::shared_ptr<Actor> actor );
+        void   removeActor( const Handle handle );
+        void   removeAllActors();
+
+        Handle addLight( std::shared_ptr<Light> light );
+        void   removeLight( std::shared_ptr<Light> light );
+        void   removeLight( const Handle handle );
+        void   removeAllLights( );
+
+        // Invalid handle if the object is not in the scene.
+        Handle getHandle( const Actor& actor ) const;
+        Handle getHandle( const Light& light ) const;
+
+        // nullptr for handles of removed objects.
+        std::shared_ptr< Actor > getActor( const Handle handle ) const;
+        std::shared_ptr< Light > getLight( const Handle handle ) const;
+
+        // Index in getActors/getLights, -1 if the object is not in the scene. Changes when other objects are removed.
+        int getActorIndex( const Actor& actor ) const;
+        int getLightIndex( const Light& light ) const;
+
+        const std::vector< std::shared_ptr<Actor> >& getActors() const;
+        const std::vector< std::shared_ptr<Light> >& getLights() const;
 
-        void addLight( std::shared_ptr<Light> light );
-        void removeLight( std::shared_ptr<Light> light );
-        void removeAllLights( );
+        // Poses, bounds, models and flags are as of the last updateActorData (or as of adding the actor, for actors added since).
+        const BlockActorArrays&    getBlockActors() const;
+        const SkeletonActorArrays& getSkeletonActors() const;
 
-        const std::unordered_set< std::shared_ptr<Actor> >& getActors() const;
-        std::vector< std::shared_ptr<Actor> >               getActorsVec() const;
-        const std::unordered_set< std::shared_ptr<Light> >& getLights( ) const;
-        std::vector< std::shared_ptr<Light> >               getLightsVec( ) const;
+        // Copies poses, models and flags from the actors, recomputes their world bounds and updates the spatial index. Has to be called
+        // after actors are moved, animated, or their models change - before the data is read.
+        void updateActorData();
+
+        // Spatial queries test the world bounds as of the last updateActorData (or as of adding the actor, for actors added since)
+        // and append the found actors to the result.
+        void findActors( const BoundingBox& box, std::vector< std::shared_ptr<Actor> >& result ) const;
+        void findActorsInFrustum( const float44& viewProjection, std::vector< std::shared_ptr<Actor> >& result ) const;
+        // Nearest first.
+        void findNearestActors( const float3& point, const int count, std::vector< std::shared_ptr<Actor> >& result ) const;
+
+        // Calls callback( actor, distance ) for the actors whose bounds the ray enters before maxDistance. Callback returns the new
+        // max distance - e.g. distance of a hit on the actor's mesh, so actors behind it are skipped.
+        void rayCastActors( const float3& origin, const float3& direction, const float maxDistance,
+                            const std::function< float( const std::shared_ptr<Actor>&, float ) >& callback ) const;
+
+        const DynamicAabbTree& getSpatialIndex() const;
 
         void saveToFile( const std::string& path ) const;
 
         private:
 
+        struct Slot
+        {
+            // Index in the list of all the objects and in the arrays of the object's type.
+            int          index;
+            int          typeIndex;
+            unsigned int generation;
+            // Proxy in the spatial index, -1 for actors without a mesh and for lights.
+            int          proxy;
+        };
+
+        static Handle allocateSlot( std::vector< Slot >& slots, std::vector< int >& freeSlots );
+        static void   releaseSlot( std::vector< Slot >& slots, std::vector< int >& freeSlots, const int slot );
+        static bool   isHandleValid( const std::vector< Slot >& slots, const Handle handle );
+
+        template< typename ActorType, typename ModelType >
+        void addToArrays( ActorArrays< ActorType, ModelType >& arrays, std::vector< int >& arraySlots, const std::shared_ptr< ActorType >& actor, const int slot );
+
+        template< typename ActorType, typename ModelType >
+        void removeFromArrays( ActorArrays< ActorType, ModelType >& arrays, std::vector< int >& arraySlots, const int typeIndex );
+
+        template< typename ActorType, typename ModelType >
+        static void updateArrays( ActorArrays< ActorType, ModelType >& arrays );
+
+        template< typename ActorType, typename ModelType >
+        static void updateArraysElement( ActorArrays< ActorType, ModelType >& arrays, const int typeIndex );
+
+        template< typename ActorType, typename ModelType >
+        void updateSpatialIndex( const ActorArrays< ActorType, ModelType >& arrays, const std::vector< int >& arraySlots );
+
+        // Creates, moves or destroys the proxy of the actor in the slot, depending on whether it has a mesh.
+        void updateProxy( const int slot, const unsigned char flags, const BoundingBox& bounds );
+
+        std::shared_ptr< Actor > getActorInSlot( const int slot ) const;
+
         SceneFileInfo m_fileInfo;
 
-        std::unordered_set< std::shared_ptr<Actor> > m_actors;
-        std::unordered_set< std::shared_ptr<Light> > m_lights;
+        std::vector< std::shared_ptr<Actor> > m_actors;
+        // Slot of each element of m_actors.
+        std::vector< int >                    m_actorIndexSlots;
+        std::vector< Slot >                   m_actorSlots;
+        std::vector< int >                    m_freeActorSlots;
+        std::unordered_map< const Actor*, int > m_actorSlotsByObject;
+
+        BlockActorArrays    m_blockActors;
+        std::vector< int >  m_blockActorSlots;
+        SkeletonActorArrays m_skeletonActors;
+        std::vector< int >  m_skeletonActorSlots;
+
+        // User data of the proxies are actor slots.
+        DynamicAabbTree     m_spatialIndex;
+
+        std::vector< std::shared_ptr<Light> > m_lights;
+        std::vector< int >                    m_lightIndexSlots;
+        std::vector< Slot >                   m_lightSlots;
+        std::vector< int >                    m_freeLightSlots;
+        std::unordered_map< const Light*, int > m_lightSlotsByObject;
     };
 }
 
@@ -28,6 +28,7 @@
 #include "SpotLight.h"
 
 #include "BlockModelImporter.h"
+#include "BlockCompressedTexture.h"
 
 #include "AssetPathManager.h"
 #include "Settings.h"
@@ -40,7 +41,9 @@ SceneManager::SceneManager( AssetManager& assetManager ) :
     m_scenePath( "Assets/Scenes/new.scene" ),
     m_cameraPath( "Assets/Scenes/new.camera" ),
     m_camera( std::make_shared< FreeCamera >() ),
-    m_scene( std::make_shared< Scene >() )
+    m_scene( std::make_shared< Scene >() ),
+    m_buildingSceneDependencyGraph( false ),
+    m_sceneRootAssetCount( 0 )
 {
     // Setup the camera.
     m_camera->setUp( float3( 0.0f, 1.0f, 0.0f ) );
@@ -103,16 +106,44 @@ void SceneManager::loadScene( std::string path )
 {
     std::shared_ptr< std::vector < std::shared_ptr< FileInfo > > > fileInfos;
 
+    const Timer loadingStartTime;
+
     std::tie( m_scene, fileInfos ) = Scene::createFromFile( path );
 
     // Load all assets.
-    for ( const std::shared_ptr<FileInfo>& fileInfo : *fileInfos )
-        m_assetManager.loadAsync( *fileInfo );
+    const bool preloadDependencies = settings().loading.preloadSceneDependencies;
+
+    {
+        std::lock_guard< std::mutex > lock( m_sceneLoadingMutex );
+
+        // Report progress while the models are read to build the graph.
+        m_sceneDependencyGraph         = nullptr;
+        m_buildingSceneDependencyGraph = preloadDependencies;
+        m_sceneRootAssetCount          = (int)fileInfos->size();
+        m_sceneLoadingStartTime.reset();
+    }
+
+    std::shared_ptr< AssetDependencyGraph > dependencyGraph;
+
+    if ( preloadDependencies ) {
+        // Queue all sub-assets of all models at once (shared ones only once), before the models which use them.
+        dependencyGraph = std::make_shared< AssetDependencyGraph >();
+        dependencyGraph->build( *fileInfos, *m_device.Get() );
+        dependencyGraph->loadAsync( m_assetManager );
+
+        std::lock_guard< std::mutex > lock( m_sceneLoadingMutex );
+
+        m_sceneDependencyGraph         = dependencyGraph;
+        m_buildingSceneDependencyGraph = false;
+    } else {
+
+        for ( const std::shared_ptr<FileInfo>& fileInfo : *fileInfos )
+            m_assetManager.loadAsync( *fileInfo );
+    }
 
     int loadedAssetsCount = 0;
 
     // Wait for all assets to be loaded.
-    const Timer loadingStartTime;
     const float maxLoadingTime = 60.0f;
     for ( const std::shared_ptr<FileInfo>& fileInfo : *fileInfos ) {
         const Timer currTime;
@@ -126,14 +157,18 @@ void SceneManager::loadScene( std::string path )
         }
     }
 
+    const Timer loadingEndTime;
+
     OutputDebugStringW( StringUtil::widen( 
         "\n\nSceneManager::loadScene - loaded " 
         + std::to_string( loadedAssetsCount ) 
-        + "\\" + std::to_string( fileInfos->size() ) + " assets.\n\n" ).c_str() 
+        + "\\" + std::to_string( fileInfos->size() ) + " assets"
+        + ( dependencyGraph ? " (" + std::to_string( dependencyGraph->getAssetCount() ) + " with dependencies, preloaded)" : "" )
+        + " in " + std::to_string( Timer::getElapsedTime( loadingEndTime, loadingStartTime ) ) + " ms.\n\n" ).c_str() 
     );
 
     // Swap actors' empty models with the loaded models. Create BVH trees. Load models to GPU.
-    const std::unordered_set< std::shared_ptr< Actor > > sceneActors = m_scene->getActors();
+    const std::vector< std::shared_ptr< Actor > > sceneActors = m_scene->getActors();
     for ( const std::shared_ptr< Actor >& actor : sceneActors ) {
         if ( actor->getType() == Actor::Type::BlockActor ) {
 
@@ -170,6 +205,35 @@ void SceneManager::loadScene( std::string path )
             }
         }
     }
+
+    // Actors were added with the empty models - refresh their bounds and flags, so the scene can be rendered or queried right away.
+    m_scene->updateActorData();
+}
+
+AssetDependencyGraph::Progress SceneManager::getSceneLoadingProgress() const
+{
+    std::shared_ptr< AssetDependencyGraph > dependencyGraph;
+    AssetDependencyGraph::Progress          progress;
+
+    {
+        std::lock_guard< std::mutex > lock( m_sceneLoadingMutex );
+
+        dependencyGraph = m_sceneDependencyGraph;
+
+        const Timer currTime;
+        progress.totalCount             = m_buildingSceneDependencyGraph ? m_sceneRootAssetCount : 0;
+        progress.loadedCount            = 0;
+        progress.failedCount            = 0;
+        progress.elapsedTime            = m_buildingSceneDependencyGraph ? (float)( Timer::getElapsedTime( currTime, m_sceneLoadingStartTime ) / 1000.0 ) : 0.0f;
+        progress.estimatedRemainingTime = m_buildingSceneDependencyGraph ? -1.0f : 0.0f;
+        progress.buildingGraph          = m_buildingSceneDependencyGraph;
+    }
+
+    // Graph isn't modified after it's published - only its assets' states change, which are read lock-free.
+    if ( dependencyGraph )
+        return dependencyGraph->getProgress( m_assetManager );
+
+    return progress;
 }
 
 void SceneManager::saveScene( std::string path )
@@ -574,12 +638,16 @@ SceneManager::pickActorOrLight( const float2& targetPixel, const float screenWid
         }
     }
 
-    for ( const std::shared_ptr< Actor >& actor : m_scene->getActors() ) 
+    // Actors could have been moved since the last frame's update of the spatial index.
+    m_scene->updateActorData();
+
+    // Test meshes only of the actors whose bounds the ray enters before the nearest hit found so far.
+    m_scene->rayCastActors( rayOriginWorld, rayDirWorld, minHitDistance, [ & ]( const std::shared_ptr< Actor >& actor, float )
     {
         if ( actor->getType() == Actor::Type::BlockActor ) {
             const std::shared_ptr< BlockActor >& blockActor = std::static_pointer_cast<BlockActor>( actor );
             if ( !blockActor->getModel() || !blockActor->getModel()->getMesh() )
-                continue;
+                return minHitDistance;
 
             std::tie( hitOccurred, hitDistance ) = MathUtil::intersectRayWithBlockActor( rayOriginWorld, rayDirWorld, *blockActor, minHitDistance );
 
@@ -590,18 +658,18 @@ SceneManager::pickActorOrLight( const float2& targetPixel, const float screenWid
         } else if ( actor->getType() == Actor::Type::SkeletonActor ) {
             const std::shared_ptr< SkeletonActor >& skeletonActor = std::static_pointer_cast<SkeletonActor>( actor );
             if ( !skeletonActor->getModel() || !skeletonActor->getModel()->getMesh() )
-                continue;
-
-            const BoundingBox bbBoxLocal = skeletonActor->getModel()->getMesh()->getBoundingBox();
+                return minHitDistance;
 
-            std::tie( hitOccurred, hitDistance ) = MathUtil::intersectRayWithBoundingBox( rayOriginWorld, rayDirWorld, skeletonActor->getPose(), bbBoxLocal );
+            std::tie( hitOccurred, hitDistance ) = MathUtil::intersectRayWithSkeletonActor( rayOriginWorld, rayDirWorld, *skeletonActor, minHitDistance );
 
             if ( hitOccurred && hitDistance < minHitDistance ) {
                 minHitDistance = hitDistance;
                 hitActor = skeletonActor;
             }
         }
-    }
+
+        return minHitDistance;
+    } );
 
     if ( hitActor )
         return std::make_tuple( hitActor, nullptr, minHitDistance );
@@ -628,19 +696,20 @@ void SceneManager::mergeSelectedActors()
             transforms.push_back( actor->getPose() * firstTransformInv );
         }
 
-        std::shared_ptr< BlockModel > mergedModel = ModelUtil::mergeModels( models, transforms, *m_device.Get() );
-
-        if ( mergedModel->getMesh() ) {
-            mergedModel->getMesh()->recalculateBoundingBox();
+        ModelUtil::MergeStatistics mergeStatistics;
 
-            if ( !mergedModel->getMesh()->getBvhTree() ) {
-                mergedModel->getMesh()->buildBvhTree();
-                mergedModel->getMesh()->loadBvhTreeToGpu( *m_device.Get() );
-            }
-        }
+        const Timer mergeStartTime;
+        const std::vector< std::shared_ptr< BlockModel > > mergedModels = ModelUtil::mergeModels( models, transforms, *m_device.Get(), TextureAtlasPacker::Options(), &mergeStatistics );
+        const Timer mergeEndTime;
 
-        if ( !mergedModel->isInGpuMemory() )
-            mergedModel->loadCpuToGpu( *m_device.Get(), *m_deviceContext.Get() );
+        OutputDebugStringW( StringUtil::widen(
+            "SceneManager::mergeSelectedActors - merged " + std::to_string( models.size() ) + " models into " + std::to_string( mergeStatistics.pageCount ) + " atlas page(s)"
+            + ", packing efficiency " + std::to_string( (int)( mergeStatistics.packingEfficiency * 100.0f ) ) + "%"
+            + ", merge time " + std::to_string( Timer::getElapsedTime( mergeEndTime, mergeStartTime ) ) + " ms"
+            + " (packing " + std::to_string( mergeStatistics.packingTime ) + " ms"
+            + ", textures " + std::to_string( mergeStatistics.textureMergeTime ) + " ms"
+            + ", meshes " + std::to_string( mergeStatistics.meshMergeTime ) + " ms).\n"
+        ).c_str() );
 
         // Create a name for the merged model.
         std::string mergedFullName = "merged";
@@ -654,7 +723,7 @@ void SceneManager::mergeSelectedActors()
             mergedFullName += "_" + modelName;
         }
 
-        std::string mergedHashedName = "merged_" + std::to_string( std::hash< std::string >{}( mergedFullName ) );
+        const std::string mergedBaseName = "merged_" + std::to_string( std::hash< std::string >{}( mergedFullName ) );
 
         auto firstModelPath = models.front()->getFileInfo().getPath();
         auto firstModelName = FileUtil::getFileNameFromPath( firstModelPath );
@@ -662,119 +731,156 @@ void SceneManager::mergeSelectedActors()
         folderName = StringUtil::replaceSubstring( folderName, "Assets\\Models\\", "" );
         folderName = StringUtil::replaceAllSubstrings( folderName, "\\", "" );
 
-        { // Save merged model, mesh and textures to files.
-            std::string mergedMeshPath    = "Assets\\Meshes\\" + folderName + "\\" + mergedHashedName + ".obj";
-            std::string mergedMeshPath2   = "Assets\\Meshes\\" + folderName + "\\" + mergedHashedName + ".blockmesh";
-            std::string mergedTexturePath = "Assets\\Textures\\" + folderName + "\\" + mergedHashedName;
-            std::string mergedModelPath   = "Assets\\Models\\" + folderName + "\\" + mergedHashedName + ".blockmodel";
+        for ( int pageIndex = 0; pageIndex < (int)mergedModels.size(); ++pageIndex )
+        {
+            const std::shared_ptr< BlockModel >& mergedModel = mergedModels[ pageIndex ];
 
-            if ( mergedModel->getMesh() ) 
-            {
-                mergedModel->getMesh()->getFileInfo().setPath( mergedMeshPath2 );
-                mergedModel->getMesh()->getFileInfo().setFormat( BlockMeshFileInfo::Format::BLOCKMESH );
-                mergedModel->getMesh()->getFileInfo().setIndexInFile( 0 );
+            // Each atlas page gets its own merged model.
+            const std::string mergedHashedName = mergedModels.size() > 1 ? mergedBaseName + "_" + std::to_string( pageIndex ) : mergedBaseName;
+
+            if ( mergedModel->getMesh() ) {
+                mergedModel->getMesh()->recalculateBoundingBox();
 
-                mergedModel->getMesh()->saveToFile( mergedMeshPath, BlockMeshFileInfo::Format::OBJ );
-                mergedModel->getMesh()->saveToFile( mergedMeshPath2, BlockMeshFileInfo::Format::BLOCKMESH );
+                if ( !mergedModel->getMesh()->getBvhTree() ) {
+                    mergedModel->getMesh()->buildBvhTree();
+                    mergedModel->getMesh()->loadBvhTreeToGpu( *m_device.Get() );
+                }
             }
 
-            int textureIndex = 0;
-            for ( auto& texture : mergedModel->getAlphaTextures() ) 
-            {
-                std::string path = mergedTexturePath + "_" + std::to_string( textureIndex++ ) + "_AL.tiff";
+            if ( !mergedModel->isInGpuMemory() )
+                mergedModel->loadCpuToGpu( *m_device.Get(), *m_deviceContext.Get() );
 
-                texture.getTexture()->getFileInfo().setPath( path );
-                texture.getTexture()->getFileInfo().setFormat( Texture2DFileInfo::Format::TIFF );
-                texture.getTexture()->getFileInfo().setPixelType( Texture2DFileInfo::PixelType::UCHAR );
+            { // Save merged model, mesh and textures to files.
+                std::string mergedMeshPath    = "Assets\\Meshes\\" + folderName + "\\" + mergedHashedName + ".obj";
+                std::string mergedMeshPath2   = "Assets\\Meshes\\" + folderName + "\\" + mergedHashedName + ".blockmesh";
+                std::string mergedTexturePath = "Assets\\Textures\\" + folderName + "\\" + mergedHashedName;
+                std::string mergedModelPath   = "Assets\\Models\\" + folderName + "\\" + mergedHashedName + ".blockmodel";
 
-                texture.getTexture()->saveToFile( path, Texture2DFileInfo::Format::TIFF );
-            }
+                if ( mergedModel->getMesh() ) 
+                {
+                    mergedModel->getMesh()->getFileInfo().setPath( mergedMeshPath2 );
+                    mergedModel->getMesh()->getFileInfo().setFormat( BlockMeshFileInfo::Format::BLOCKMESH );
+                    mergedModel->getMesh()->getFileInfo().setIndexInFile( 0 );
 
-            textureIndex = 0;
-            for ( auto& texture : mergedModel->getEmissiveTextures() ) 
-            {
-                std::string path = mergedTexturePath + "_" + std::to_string( textureIndex++ ) + "_E.png";
+                    mergedModel->getMesh()->saveToFile( mergedMeshPath, BlockMeshFileInfo::Format::OBJ );
+                    mergedModel->getMesh()->saveToFile( mergedMeshPath2, BlockMeshFileInfo::Format::BLOCKMESH );
+                }
+
+                // Saves a block-compressed copy of the texture next to the source image (with .dds extension).
+                const bool saveBlockCompressed = settings().textures.saveBlockCompressed;
+                auto saveBlockCompressedCopy = [ saveBlockCompressed ]( const auto& texture, const Model::TextureType textureType, const std::string& path ) {
+                    if ( !saveBlockCompressed )
+                        return;
+
+                    const std::string compressedPath = path.substr( 0, path.rfind( "." ) ) + ".dds";
+                    BlockCompressedTexture::createFromTexture( texture, BlockCompressedTexture::getFormat( textureType ) )->saveToFile( compressedPath );
+                };
+
+                int textureIndex = 0;
+                for ( auto& texture : mergedModel->getAlphaTextures() ) 
+                {
+                    std::string path = mergedTexturePath + "_" + std::to_string( textureIndex++ ) + "_AL.tiff";
+
+                    texture.getTexture()->getFileInfo().setPath( path );
+                    texture.getTexture()->getFileInfo().setFormat( Texture2DFileInfo::Format::TIFF );
+                    texture.getTexture()->getFileInfo().setPixelType( Texture2DFileInfo::PixelType::UCHAR );
+
+                    texture.getTexture()->saveToFile( path, Texture2DFileInfo::Format::TIFF );
+                    saveBlockCompressedCopy( *texture.getTexture(), Model::TextureType::Alpha, path );
+                }
+
+                textureIndex = 0;
+                for ( auto& texture : mergedModel->getEmissiveTextures() ) 
+                {
+                    std::string path = mergedTexturePath + "_" + std::to_string( textureIndex++ ) + "_E.png";
                 
-                texture.getTexture()->getFileInfo().setPath( path );
-                texture.getTexture()->getFileInfo().setFormat( Texture2DFileInfo::Format::PNG );
-                texture.getTexture()->getFileInfo().setPixelType( Texture2DFileInfo::PixelType::UCHAR4 );
+                    texture.getTexture()->getFileInfo().setPath( path );
+                    texture.getTexture()->getFileInfo().setFormat( Texture2DFileInfo::Format::PNG );
+                    texture.getTexture()->getFileInfo().setPixelType( Texture2DFileInfo::PixelType::UCHAR4 );
 
-                texture.getTexture()->saveToFile( path, Texture2DFileInfo::Format::PNG );
-            }
+                    texture.getTexture()->saveToFile( path, Texture2DFileInfo::Format::PNG );
+                    saveBlockCompressedCopy( *texture.getTexture(), Model::TextureType::Emissive, path );
+                }
 
-            textureIndex = 0;
-            for ( auto& texture : mergedModel->getAlbedoTextures() ) 
-            {
-                std::string path = mergedTexturePath + "_" + std::to_string( textureIndex++ ) + "_A.png";
+                textureIndex = 0;
+                for ( auto& texture : mergedModel->getAlbedoTextures() ) 
+                {
+                    std::string path = mergedTexturePath + "_" + std::to_string( textureIndex++ ) + "_A.png";
 
-                texture.getTexture()->getFileInfo().setPath( path );
-                texture.getTexture()->getFileInfo().setFormat( Texture2DFileInfo::Format::PNG );
-                texture.getTexture()->getFileInfo().setPixelType( Texture2DFileInfo::PixelType::UCHAR4 );
+                    texture.getTexture()->getFileInfo().setPath( path );
+                    texture.getTexture()->getFileInfo().setFormat( Texture2DFileInfo::Format::PNG );
+                    texture.getTexture()->getFileInfo().setPixelType( Texture2DFileInfo::PixelType::UCHAR4 );
 
-                texture.getTexture()->saveToFile( path, Texture2DFileInfo::Format::PNG );
-            }
+                    texture.getTexture()->saveToFile( path, Texture2DFileInfo::Format::PNG );
+                    saveBlockCompressedCopy( *texture.getTexture(), Model::TextureType::Albedo, path );
+                }
 
-            textureIndex = 0;
-            for ( auto& texture : mergedModel->getMetalnessTextures() ) 
-            {
-                std::string path = mergedTexturePath + "_" + std::to_string( textureIndex++ ) + "_M.tiff";
+                textureIndex = 0;
+                for ( auto& texture : mergedModel->getMetalnessTextures() ) 
+                {
+                    std::string path = mergedTexturePath + "_" + std::to_string( textureIndex++ ) + "_M.tiff";
                 
-                texture.getTexture()->getFileInfo().setPath( path );
-                texture.getTexture()->getFileInfo().setFormat( Texture2DFileInfo::Format::TIFF );
-                texture.getTexture()->getFileInfo().setPixelType( Texture2DFileInfo::PixelType::UCHAR );
+                    texture.getTexture()->getFileInfo().setPath( path );
+                    texture.getTexture()->getFileInfo().setFormat( Texture2DFileInfo::Format::TIFF );
+                    texture.getTexture()->getFileInfo().setPixelType( Texture2DFileInfo::PixelType::UCHAR );
 
-                texture.getTexture()->saveToFile( path, Texture2DFileInfo::Format::TIFF );
-            }
+                    texture.getTexture()->saveToFile( path, Texture2DFileInfo::Format::TIFF );
+                    saveBlockCompressedCopy( *texture.getTexture(), Model::TextureType::Metalness, path );
+                }
 
-            textureIndex = 0;
-            for ( auto& texture : mergedModel->getRoughnessTextures() ) 
-            {
-                std::string path = mergedTexturePath + "_" + std::to_string( textureIndex++ ) + "_R.tiff";
+                textureIndex = 0;
+                for ( auto& texture : mergedModel->getRoughnessTextures() ) 
+                {
+                    std::string path = mergedTexturePath + "_" + std::to_string( textureIndex++ ) + "_R.tiff";
                 
-                texture.getTexture()->getFileInfo().setPath( path );
-                texture.getTexture()->getFileInfo().setFormat( Texture2DFileInfo::Format::TIFF );
-                texture.getTexture()->getFileInfo().setPixelType( Texture2DFileInfo::PixelType::UCHAR );
+                    texture.getTexture()->getFileInfo().setPath( path );
+                    texture.getTexture()->getFileInfo().setFormat( Texture2DFileInfo::Format::TIFF );
+                    texture.getTexture()->getFileInfo().setPixelType( Texture2DFileInfo::PixelType::UCHAR );
 
-                texture.getTexture()->saveToFile( path, Texture2DFileInfo::Format::TIFF );
-            }
+                    texture.getTexture()->saveToFile( path, Texture2DFileInfo::Format::TIFF );
+                    saveBlockCompressedCopy( *texture.getTexture(), Model::TextureType::Roughness, path );
+                }
 
-            textureIndex = 0;
-            for ( auto& texture : mergedModel->getNormalTextures() ) 
-            {
-                std::string path = mergedTexturePath + "_" + std::to_string( textureIndex++ ) + "_N.png";
+                textureIndex = 0;
+                for ( auto& texture : mergedModel->getNormalTextures() ) 
+                {
+                    std::string path = mergedTexturePath + "_" + std::to_string( textureIndex++ ) + "_N.png";
                 
-                texture.getTexture()->getFileInfo().setPath( path );
-                texture.getTexture()->getFileInfo().setFormat( Texture2DFileInfo::Format::PNG );
-                texture.getTexture()->getFileInfo().setPixelType( Texture2DFileInfo::PixelType::UCHAR4 );
+                    texture.getTexture()->getFileInfo().setPath( path );
+                    texture.getTexture()->getFileInfo().setFormat( Texture2DFileInfo::Format::PNG );
+                    texture.getTexture()->getFileInfo().setPixelType( Texture2DFileInfo::PixelType::UCHAR4 );
 
-                texture.getTexture()->saveToFile( path, Texture2DFileInfo::Format::PNG );
-            }
+                    texture.getTexture()->saveToFile( path, Texture2DFileInfo::Format::PNG );
+                    saveBlockCompressedCopy( *texture.getTexture(), Model::TextureType::Normal, path );
+                }
 
-            textureIndex = 0;
-            for ( auto& texture : mergedModel->getRefractiveIndexTextures() ) 
-            {
-                std::string path = mergedTexturePath + "_" + std::to_string( textureIndex++ ) + "_I.tiff";
+                textureIndex = 0;
+                for ( auto& texture : mergedModel->getRefractiveIndexTextures() ) 
+                {
+                    std::string path = mergedTexturePath + "_" + std::to_string( textureIndex++ ) + "_I.tiff";
                 
-                texture.getTexture()->getFileInfo().setPath( path );
-                texture.getTexture()->getFileInfo().setFormat( Texture2DFileInfo::Format::TIFF );
-                texture.getTexture()->getFileInfo().setPixelType( Texture2DFileInfo::PixelType::UCHAR );
+                    texture.getTexture()->getFileInfo().setPath( path );
+                    texture.getTexture()->getFileInfo().setFormat( Texture2DFileInfo::Format::TIFF );
+                    texture.getTexture()->getFileInfo().setPixelType( Texture2DFileInfo::PixelType::UCHAR );
 
-                texture.getTexture()->saveToFile( path, Texture2DFileInfo::Format::TIFF );
-            }
+                    texture.getTexture()->saveToFile( path, Texture2DFileInfo::Format::TIFF );
+                    saveBlockCompressedCopy( *texture.getTexture(), Model::TextureType::RefractiveIndex, path );
+                }
 
-            // Set file info for the merged model, so the scene knows in which file it's stored.
-            BlockModelFileInfo mergedModelFileInfo( mergedModelPath, BlockModelFileInfo::Format::BLOCKMODEL, 0 );
-            mergedModel->setFileInfo( mergedModelFileInfo );
+                // Set file info for the merged model, so the scene knows in which file it's stored.
+                BlockModelFileInfo mergedModelFileInfo( mergedModelPath, BlockModelFileInfo::Format::BLOCKMODEL, 0 );
+                mergedModel->setFileInfo( mergedModelFileInfo );
 
-            mergedModel->saveToFile( mergedModelPath );
-        }
+                mergedModel->saveToFile( mergedModelPath );
+            }
 
-        const auto& pose = m_selection.getBlockActors().front()->getPose();
+            const auto& pose = m_selection.getBlockActors().front()->getPose();
 
-        // Add new actor to the scene.
-        //m_selectedBlockActors.clear();
-        auto newActor = std::make_shared< BlockActor >( mergedModel, pose );
-        m_scene->addActor( newActor );
+            // Add new actor to the scene.
+            //m_selectedBlockActors.clear();
+            auto newActor = std::make_shared< BlockActor >( mergedModel, pose );
+            m_scene->addActor( newActor );
+        }
     } catch ( std::exception& e ) {
         OutputDebugStringW( StringUtil::widen( e.what() + std::string( "\n" ) ).c_str() );
     }
@@ -924,8 +1030,8 @@ bool SceneManager::isSelectionEmpty()
 
 void SceneManager::selectAll()
 {
-    m_selection.replace( m_scene->getActorsVec() );
-    m_selection.add( m_scene->getLightsVec() );
+    m_selection.replace( m_scene->getActors() );
+    m_selection.add( m_scene->getLights() );
 }
 
 void SceneManager::clearSelection()
@@ -971,8 +1077,6 @@ void SceneManager::unselectLight( const std::shared_ptr< Light >& light )
 
 void SceneManager::selectNext()
 {
-    // #TODO: Should fix - it fails in many cases.
-
     std::shared_ptr< Actor > selectedActor;
     std::shared_ptr< Light > selectedLight;
 
@@ -985,38 +1089,37 @@ void SceneManager::selectNext()
 
     if ( selectedActor )
     {
-        auto it = m_scene->getActors().find( selectedActor );
+        const auto& actors = m_scene->getActors();
+        const int   idx    = m_scene->getActorIndex( *selectedActor );
 
-        if ( it == m_scene->getActors().end() ) 
+        if ( idx < 0 ) 
             return;
 
-        if ( ++it == m_scene->getActors().end() )
-            it = m_scene->getActors().begin();
+        const auto& nextActor = actors[ ( idx + 1 ) % actors.size() ];
 
         clearSelection();
 
-        m_selection.add( selectedActor );
+        if ( nextActor->getType() == Actor::Type::BlockActor )
+            m_selection.add( std::static_pointer_cast<BlockActor>( nextActor ) );
+        else if ( nextActor->getType() == Actor::Type::SkeletonActor )
+            m_selection.add( std::static_pointer_cast<SkeletonActor>( nextActor ) );
     }
     else if ( selectedLight )
     {
-        auto it = m_scene->getLights().find( selectedLight );
+        const auto& lights = m_scene->getLights();
+        const int   idx    = m_scene->getLightIndex( *selectedLight );
 
-        if ( it == m_scene->getLights().end() )
+        if ( idx < 0 )
             return;
 
-        if ( ++it == m_scene->getLights().end() )
-            it = m_scene->getLights().begin();
-
         clearSelection();
 
-        m_selection.add( selectedLight );
+        m_selection.add( lights[ ( idx + 1 ) % lights.size() ] );
     }
 }
 
 void SceneManager::selectPrev()
 {
-    // #TODO: Shoudl fix - it fails in many cases.
-
     std::shared_ptr< Actor > selectedActor;
     std::shared_ptr< Light > selectedLight;
 
@@ -1029,32 +1132,32 @@ void SceneManager::selectPrev()
 
     if ( selectedActor ) 
     {
-        auto it = m_scene->getActors().find( selectedActor );
+        const auto& actors = m_scene->getActors();
+        const int   idx    = m_scene->getActorIndex( *selectedActor );
 
-        if ( it == m_scene->getActors().begin() )
-            it = m_scene->getActors().end();
+        if ( idx < 0 )
+            return;
 
-        --it;
+        const auto& prevActor = actors[ ( idx + actors.size() - 1 ) % actors.size() ];
 
         clearSelection();
 
-        if ( selectedActor->getType() == Actor::Type::BlockActor )
-            m_selection.add( std::static_pointer_cast<BlockActor>( *it ) );
-        else if ( selectedActor->getType() == Actor::Type::SkeletonActor )
-            m_selection.add( std::static_pointer_cast<SkeletonActor>( *it ) );
+        if ( prevActor->getType() == Actor::Type::BlockActor )
+            m_selection.add( std::static_pointer_cast<BlockActor>( prevActor ) );
+        else if ( prevActor->getType() == Actor::Type::SkeletonActor )
+            m_selection.add( std::static_pointer_cast<SkeletonActor>( prevActor ) );
     } 
     else if ( selectedLight ) 
     {
-        auto it = m_scene->getLights().find( selectedLight );
+        const auto& lights = m_scene->getLights();
+        const int   idx    = m_scene->getLightIndex( *selectedLight );
 
-        if ( it == m_scene->getLights().begin() )
-            it = m_scene->getLights().end();
-
-        --it;
+        if ( idx < 0 )
+            return;
 
         clearSelection();
 
-        m_selection.add( *it );
+        m_selection.add( lights[ ( idx + lights.size() - 1 ) % lights.size() ] );
     }
 }
 
@@ -1224,7 +1327,14 @@ void SceneManager::selectAllInsideSelectionVolume()
 {
     clearSelection();
 
-    for ( auto& actor : m_scene->getActors() ) 
+    // Actors could have been moved since the last frame's update of the spatial index.
+    m_scene->updateActorData();
+
+    // Precise tests only for the actors whose world bounds intersect the volume.
+    std::vector< std::shared_ptr< Actor > > candidates;
+    m_scene->findActors( m_selectionVolume, candidates );
+
+    for ( auto& actor : candidates ) 
     {
         if ( actor->getType() == Actor::Type::BlockActor ) 
         {
@@ -1246,10 +1356,20 @@ void SceneManager::selectAllInsideSelectionVolume()
             if ( !skeletonActor->getModel() || !skeletonActor->getModel()->getMesh() )
                 continue;
 
-            const BoundingBox bbBoxLocal = skeletonActor->getModel()->getMesh()->getBoundingBox();
-            const BoundingBox bbBoxWorld = MathUtil::boundingBoxLocalToWorld( bbBoxLocal, skeletonActor->getPose() );
+            // Test the bones in the current pose - falls back to the mesh box if the mesh has no bone boxes.
+            const SkeletonBoneBounds& boneBounds = skeletonActor->getBoneBounds();
 
-            if ( MathUtil::intersectBoundingBoxes( m_selectionVolume, bbBoxWorld ) )
+            bool intersects = false;
+            if ( !boneBounds.isEmpty() ) {
+                intersects = boneBounds.intersects( m_selectionVolume, skeletonActor->getPose() );
+            } else {
+                const BoundingBox bbBoxLocal = skeletonActor->getModel()->getMesh()->getBoundingBox();
+                const BoundingBox bbBoxWorld = MathUtil::boundingBoxLocalToWorld( bbBoxLocal, skeletonActor->getPose() );
+
+                intersects = MathUtil::intersectBoundingBoxes( m_selectionVolume, bbBoxWorld );
+            }
+
+            if ( intersects )
                 m_selection.add( skeletonActor );
         }
     }
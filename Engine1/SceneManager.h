@@ -3,6 +3,7 @@
 #include <vector>
 #include <memory>
 #include <tuple>
+#include <mutex>
 #include <wrl.h>
 
 #include "FreeCamera.h"
@@ -17,6 +18,7 @@
 
 #include "Selection.h"
 #include "Animator.h"
+#include "AssetDependencyGraph.h"
 
 struct ID3D11Device3;
 struct ID3D11DeviceContext3;
@@ -55,6 +57,9 @@ namespace Engine1
         void loadScene( std::string path );
         void saveScene( std::string path );
 
+        // Progress of loading assets of the last loaded scene. Can be called from other threads while the scene is being loaded.
+        AssetDependencyGraph::Progress getSceneLoadingProgress() const;
+
         void loadAsset( std::string fileName, const bool replaceSelected = false, const bool invertZ = true, const bool invertVertexWindingOrder = true, const bool invertUVs = true );
 
         void unloadAll();
@@ -127,6 +132,13 @@ namespace Engine1
         std::string m_scenePath;
         std::shared_ptr< Scene > m_scene;
 
+        // Guards the graph pointer and the loading state - progress is read from other threads while the scene is being loaded.
+        mutable std::mutex                      m_sceneLoadingMutex;
+        std::shared_ptr< AssetDependencyGraph > m_sceneDependencyGraph;
+        bool                                    m_buildingSceneDependencyGraph;
+        int                                     m_sceneRootAssetCount;
+        Timer                                   m_sceneLoadingStartTime;
+
         Selection m_selection;
 
         BoundingBox                   m_selectionVolume;
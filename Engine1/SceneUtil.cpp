@@ -53,6 +53,36 @@ std::vector< std::shared_ptr< Light > > SceneUtil::filterLightsByType( const std
     return filteredLights;
 }
 
+void SceneUtil::filterLightsByState( const std::vector< std::shared_ptr< Light > >& lights, const bool enabled, std::vector< std::shared_ptr< Light > >& filteredLights )
+{
+    filteredLights.clear();
+
+    for ( auto& light : lights ) {
+        if ( light->isEnabled() == enabled )
+            filteredLights.push_back( light );
+    }
+}
+
+void SceneUtil::filterLightsByShadowCasting( const std::vector< std::shared_ptr< Light > >& lights, const bool castShadows, std::vector< std::shared_ptr< Light > >& filteredLights )
+{
+    filteredLights.clear();
+
+    for ( auto& light : lights ) {
+        if ( light->isCastingShadows() == castShadows )
+            filteredLights.push_back( light );
+    }
+}
+
+void SceneUtil::filterLightsByType( const std::vector< std::shared_ptr< Light > >& lights, const Light::Type type, std::vector< std::shared_ptr< Light > >& filteredLights )
+{
+    filteredLights.clear();
+
+    for ( auto& light : lights ) {
+        if ( light->getType() == type )
+            filteredLights.push_back( light );
+    }
+}
+
 template<>
 std::vector< std::shared_ptr< BlockActor > > SceneUtil::filterActorsByType< BlockActor >( const std::vector< std::shared_ptr< Actor > >& actors )
 {
@@ -17,6 +17,11 @@ namespace Engine1
         static std::vector< std::shared_ptr< Light > > filterLightsByShadowCasting( const std::vector< std::shared_ptr< Light > >& lights, const bool castShadows );
         static std::vector< std::shared_ptr< Light > > filterLightsByType( const std::vector< std::shared_ptr< Light > >& lights, const Light::Type type );
 
+        // Same as above, but write to the given vector (replacing its content) - so its memory can be reused between frames.
+        static void filterLightsByState( const std::vector< std::shared_ptr< Light > >& lights, const bool enabled, std::vector< std::shared_ptr< Light > >& filteredLights );
+        static void filterLightsByShadowCasting( const std::vector< std::shared_ptr< Light > >& lights, const bool castShadows, std::vector< std::shared_ptr< Light > >& filteredLights );
+        static void filterLightsByType( const std::vector< std::shared_ptr< Light > >& lights, const Light::Type type, std::vector< std::shared_ptr< Light > >& filteredLights );
+
         template< typename ActorType >
         static std::vector< std::shared_ptr< ActorType > > filterActorsByType( const std::vector< std::shared_ptr< Actor > >& actors ); 
     };
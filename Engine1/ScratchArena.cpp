@@ -0,0 +1,64 @@
+#include "ScratchArena.h"
+
+#include <cstdint>
+#include <exception>
+
+using namespace Engine1;
+
+ScratchArena::ScratchArena() :
+    m_offset( 0 ),
+    m_alignmentOffset( 0 )
+{}
+
+ScratchArena::~ScratchArena()
+{}
+
+void ScratchArena::reset( const size_t capacity )
+{
+    m_offset = 0;
+
+    if ( capacity <= getCapacity() )
+        return;
+
+    // Extra bytes allow to align the start of the memory.
+    m_memory.resize( capacity + s_alignment );
+
+    const uintptr_t address = reinterpret_cast< uintptr_t >( m_memory.data() );
+    m_alignmentOffset = (size_t)( ( s_alignment - address % s_alignment ) % s_alignment );
+}
+
+void* ScratchArena::allocate( const size_t size )
+{
+    const size_t alignedSize = getAlignedSize( size );
+
+    if ( alignedSize > getCapacity() - m_offset )
+        throw std::exception( "ScratchArena::allocate - not enough capacity left in the arena." );
+
+    void* memory = m_memory.data() + m_alignmentOffset + m_offset;
+    m_offset += alignedSize;
+
+    return memory;
+}
+
+size_t ScratchArena::getMarker() const
+{
+    return m_offset;
+}
+
+void ScratchArena::release( const size_t marker )
+{
+    if ( marker > m_offset )
+        throw std::exception( "ScratchArena::release - marker is past the allocated memory." );
+
+    m_offset = marker;
+}
+
+size_t ScratchArena::getCapacity() const
+{
+    return m_memory.empty() ? 0 : m_memory.size() - s_alignment;
+}
+
+size_t ScratchArena::getAlignedSize( const size_t size )
+{
+    return ( size + s_alignment - 1 ) / s_alignment * s_alignment;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+
+namespace Engine1
+{
+    // Linear allocator for temporary data which lives only during a single operation (e.g. evaluating a pose for one frame).
+    // Allocations are released all at once (or back to a marker) and the memory is reused - once the arena has grown
+    // to the needed capacity, it doesn't allocate any memory. Destructors of allocated objects are never called.
+    class ScratchArena
+    {
+        public:
+
+        // All allocations are aligned to this value.
+        static const size_t s_alignment = 16;
+
+        ScratchArena();
+        ~ScratchArena();
+
+        // Releases all the allocations and makes sure the arena can hold at least the given number of bytes.
+        void reset( const size_t capacity = 0 );
+
+        // Throws if the arena doesn't have enough capacity left - it never grows between resets, so the pointers stay valid.
+        void* allocate( const size_t size );
+
+        template< typename T >
+        T* allocate( const int count );
+
+        // Allocations made after getting the marker can be released with release( marker ).
+        size_t getMarker() const;
+        void   release( const size_t marker );
+
+        size_t getCapacity() const;
+
+        // Rounds the size up to the alignment - sum of the aligned sizes is the capacity needed for these allocations.
+        static size_t getAlignedSize( const size_t size );
+
+        private:
+
+        std::vector< char > m_memory;
+
+        // Offset from the first aligned byte of m_memory.
+        size_t m_offset;
+        size_t m_alignmentOffset;
+
+        // Copying is not allowed.
+        ScratchArena( const ScratchArena& ) = delete;
+        ScratchArena& operator=( const ScratchArena& ) = delete;
+    };
+
+    template< typename T >
+    T* ScratchArena::allocate( const int count )
+    {
+        return static_cast< T* >( allocate( sizeof( T ) * (size_t)count ) );
+    }
+}
@@ -43,13 +43,14 @@ Settings& Settings::modify()
 
 void Settings::initializeInternal()
 {
-    main.fullscreen       = false;
-    main.screenDimensions = int2( 1024 /*1920*/, 768 /*1080*/ );
-    main.verticalSync     = false;
-    main.limitFPS         = false;
-    main.displayFrequency = 60;
-    main.screenColorDepth = 32;
-    main.zBufferDepth     = 32;
+    main.fullscreen           = false;
+    main.screenDimensions     = int2( 1024 /*1920*/, 768 /*1080*/ );
+    main.verticalSync         = false;
+    main.limitFPS             = false;
+    main.pipelinedFrameUpdate = true;
+    main.displayFrequency     = 60;
+    main.screenColorDepth     = 32;
+    main.zBufferDepth         = 32;
 
     paths.assets                    = "Assets";
     paths.testAssets                = "TestAssets";
@@ -103,6 +104,8 @@ void Settings::initializeInternal()
     debug.lightColorChanged = false;
 
     rendering.fieldOfViewDegress = 70.0f;
+    rendering.zNear              = 0.1f;
+    rendering.zFar               = 1000.0f;
 
     rendering.skyColor = float3(0.12f, 0.53f, 1.0f);
 
@@ -119,6 +122,12 @@ void Settings::initializeInternal()
     rendering.optimization.blurShadowsPositionSampleMipmapLevel       = 0;
     rendering.optimization.blurShadowsNormalSampleMipmapLevel         = 0;
 
+    rendering.culling.frustumCulling        = true;
+    rendering.culling.occlusionCulling      = false;
+    rendering.culling.occlusionBufferWidth  = 256;
+    rendering.culling.occlusionBufferHeight = 128;
+    rendering.culling.maxOccluderCount      = 16;
+
     animation.cameraPlaybackSpeed = 1.0f;
     animation.lightsPlaybackSpeed = 1.0f;
     animation.actorsPlaybackSpeed = 1.0f;
@@ -140,6 +149,7 @@ void Settings::initializeInternal()
     rendering.ambientOcclusion.assao.detailShadowStrength                = 0.5f;
 
     rendering.shadows.enabled                       = true;
+    rendering.shadows.maxShadowedLightCount         = 4;
     rendering.shadows.enableAlteringRayDirection    = false;
     rendering.shadows.enableBlurShadowPattern       = false;
     rendering.shadows.useSeparableShadowPatternBlur = false;
@@ -212,6 +222,10 @@ void Settings::initializeInternal()
     rendering.reflectionsRefractions.radialBlurEnabled = true;
     rendering.reflectionsRefractions.debugHitDistPower = 0.5f;
 
+    rendering.reflectionsRefractions.pruning.enabled               = true;
+    rendering.reflectionsRefractions.pruning.contributionThreshold = 0.01f;
+    rendering.reflectionsRefractions.pruning.readbackMipmapLevel   = 4;
+
     rendering.hitDistanceSearch.resolutionDivider          = 4;
     rendering.hitDistanceSearch.decreaseBlurForSmallValues = false;
     rendering.hitDistanceSearch.maxHitDistForDecreasedBlur = 0.15f;
@@ -236,8 +250,12 @@ void Settings::initializeInternal()
 
     physics.fixedStepDuration = 1.0f / 60.0f;
 
+    textures.saveBlockCompressed = true;
+
     importer.defaultWhiteUchar4TextureFileName = "default_white_uchar4.png";
 
+    loading.preloadSceneDependencies = true;
+
     profiling.display.enabled            = false;
     profiling.display.coloredByTimeTaken = true;
     profiling.display.startWithStage     = RenderingStage::Main;
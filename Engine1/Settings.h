@@ -39,6 +39,8 @@ namespace Engine1
             int2 screenDimensions;
             bool verticalSync;
             bool limitFPS;
+            // Simulate the next frame (physics, animation) on worker threads while the current frame is rendered.
+            bool pipelinedFrameUpdate;
             int  displayFrequency;
             char screenColorDepth;
             char zBufferDepth;
@@ -117,6 +119,10 @@ namespace Engine1
         {
             float fieldOfViewDegress;
 
+            // Depth range of the camera projection - used by rasterization, culling and light clusters.
+            float zNear;
+            float zFar;
+
             // Color used when ray doesn't hit any geometry.
             float3 skyColor;
 
@@ -140,6 +146,16 @@ namespace Engine1
                 // #TODO: Add the same settings for combining stage - separate for primary/secondary reflections
             } optimization;
 
+            struct Culling
+            {
+                bool frustumCulling;
+                // Tests actors against a low resolution depth buffer rasterized on the CPU from the largest occluders.
+                bool occlusionCulling;
+                int  occlusionBufferWidth;
+                int  occlusionBufferHeight;
+                int  maxOccluderCount;
+            } culling;
+
             struct AmbientOcclusion
             {
                 struct ASSAO
@@ -166,6 +182,10 @@ namespace Engine1
             {
                 bool enabled;
 
+                // Only this many shadow casting lights - the ones contributing the most to the visible part of the screen - 
+                // get ray traced shadows. The remaining lights are shaded without shadows.
+                int maxShadowedLightCount;
+
                 // If enabled, rays at different pixels aim at different parts of area light.
                 // Averaging values from neighboring pixels gives correct shadow value.
                 // It makes shadow edges smooth, and fixes a lot of artifacts for large area lights.
@@ -310,6 +330,18 @@ namespace Engine1
                 // To test how roughness could impact blur radius depending on hit-distance.
                 float debugHitDistPower;
 
+                // Skipping of stages with negligible contribution to the final image (see RayTreePruning).
+                struct Pruning
+                {
+                    bool enabled;
+
+                    // Stages contributing less than this to every pixel (of the read back mipmap) are not rendered.
+                    float contributionThreshold;
+
+                    // Mipmap of the contribution image read back to the CPU to estimate the contribution.
+                    int readbackMipmapLevel;
+                } pruning;
+
             } reflectionsRefractions;
 
             struct HitDistanceSearch
@@ -391,6 +423,9 @@ namespace Engine1
                 std::shared_ptr< Texture2D< unsigned char > > roughness;
                 std::shared_ptr< Texture2D< unsigned char > > refractiveIndex;
             } defaults;
+
+            // Whether to also save block-compressed (BCn) copies of textures (as .dds files next to the source images) when saving merged models.
+            bool saveBlockCompressed;
         } textures;
 
         struct Physics
@@ -405,6 +440,13 @@ namespace Engine1
             std::string defaultWhiteUchar4TextureFileName;
         } importer;
 
+        struct Loading
+        {
+            // Whether to read scene models up front to find all their sub-assets (meshes, textures) 
+            // and queue loading of all of them at once - shared sub-assets first.
+            bool preloadSceneDependencies;
+        } loading;
+
         struct Profiling
         {
             struct Display
@@ -25,6 +25,8 @@ std::string SettingsHelper::compareSettings( const Settings& settings1, const Se
     text += (settings1.debug.snappingMode               != settings2.debug.snappingMode)               ? std::string("debug.snappingMode = ")               + (settings1.debug.snappingMode ? "true" : "false") + "\n" : "";
 
     text += (settings1.rendering.fieldOfViewDegress       != settings2.rendering.fieldOfViewDegress)     ? std::string("rendering.fieldOfViewDegress = ")     + std::to_string(settings1.rendering.fieldOfViewDegress) + "\n" : "";
+    text += (settings1.rendering.zNear                    != settings2.rendering.zNear)                  ? std::string("rendering.zNear = ")                  + std::to_string(settings1.rendering.zNear) + "\n" : "";
+    text += (settings1.rendering.zFar                     != settings2.rendering.zFar)                   ? std::string("rendering.zFar = ")                   + std::to_string(settings1.rendering.zFar) + "\n" : "";
     
     text += (settings1.rendering.postProcess.exposure     != settings2.rendering.postProcess.exposure)               ? std::string("rendering.postProcess.exposure = ")               + std::to_string(settings1.rendering.postProcess.exposure) + "\n" : "";
     text += (settings1.rendering.postProcess.antialiasing != settings2.rendering.postProcess.antialiasing)           ? std::string("rendering.postProcess.antialiasing = ")           + (settings1.rendering.postProcess.antialiasing ? "true" : "false") + "\n" : "";
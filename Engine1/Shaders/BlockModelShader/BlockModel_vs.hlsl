@@ -1,10 +1,12 @@
 #pragma pack_matrix(column_major) //informs only about the memory layout of input matrices
 
+#define MAX_INSTANCE_COUNT 64
+
 cbuffer ConstantBuffer
 {
-	matrix worldMatrix;
 	matrix viewMatrix;
 	matrix projectionMatrix;
+	matrix worldMatrix[ MAX_INSTANCE_COUNT ]; // Indexed by instance id - copies of the model drawn in a single call. Last - only the used ones are updated.
 };
 
 struct VertexInputType 
@@ -25,14 +27,14 @@ struct PixelInputType
 	float2 texCoord      : TEXCOORD4;
 };
 
-PixelInputType main( VertexInputType input ) {
+PixelInputType main( VertexInputType input, uint instanceId : SV_InstanceID ) {
 	PixelInputType output;
 
 	// Change the position vector to be 4 units for proper matrix calculations.
 	input.position.w = 1.0f;
 
 	// Calculate the position of the vertex against the world, view, and projection matrices.
-	output.position = mul( input.position, worldMatrix );
+	output.position = mul( input.position, worldMatrix[ instanceId ] );
 
     output.positionWorld = output.position.xyz;
 
@@ -41,11 +43,11 @@ PixelInputType main( VertexInputType input ) {
 
 	// Normal
 	input.normal.w = 0.0f;
-	output.normal = mul( input.normal, worldMatrix ).xyz;
+	output.normal = mul( input.normal, worldMatrix[ instanceId ] ).xyz;
 
     // For normal mapping.
     input.tangent.w = 0.0f;
-    output.tangent = mul( input.tangent, worldMatrix ).xyz;
+    output.tangent = mul( input.tangent, worldMatrix[ instanceId ] ).xyz;
     output.bitangent = cross(output.tangent, output.normal);
 
 	// Texcoord
@@ -0,0 +1,207 @@
+#include "ShadowCasterCulling.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "BlockActor.h"
+#include "BlockModel.h"
+#include "BlockMesh.h"
+#include "Light.h"
+#include "SpotLight.h"
+#include "MathUtil.h"
+
+using namespace Engine1;
+
+const int ShadowCasterCulling::s_clusterGridSize = 4;
+
+namespace
+{
+    bool isEmptyBox( const float3& boxMin, const float3& boxMax )
+    {
+        return boxMin.x > boxMax.x;
+    }
+
+    // Projection of the box onto the axis.
+    void project( const float3& boxMin, const float3& boxMax, const float3& axis, float& projectionMin, float& projectionMax )
+    {
+        const float center = dot( ( boxMin + boxMax ) * 0.5f, axis );
+        const float extent = dot( ( boxMax - boxMin ) * 0.5f, float3( std::abs( axis.x ), std::abs( axis.y ), std::abs( axis.z ) ) );
+
+        projectionMin = center - extent;
+        projectionMax = center + extent;
+    }
+
+    // Separating axis test of a box and the convex hull of two other boxes. Only a few axes are tested - 
+    // world axes, the direction between the hull boxes and the axes perpendicular to it - so the test is conservative 
+    // (may report an intersection which doesn't exist).
+    bool intersectsHull( const float3& boxMin, const float3& boxMax, const float3& hullBox1Min, const float3& hullBox1Max, const float3& hullBox2Min, const float3& hullBox2Max )
+    {
+        const float3 direction = ( hullBox2Min + hullBox2Max ) * 0.5f - ( hullBox1Min + hullBox1Max ) * 0.5f;
+
+        const float3 axes[ 7 ] = {
+            float3( 1.0f, 0.0f, 0.0f ),
+            float3( 0.0f, 1.0f, 0.0f ),
+            float3( 0.0f, 0.0f, 1.0f ),
+            direction,
+            cross( direction, float3( 1.0f, 0.0f, 0.0f ) ),
+            cross( direction, float3( 0.0f, 1.0f, 0.0f ) ),
+            cross( direction, float3( 0.0f, 0.0f, 1.0f ) )
+        };
+
+        for ( const float3& axis : axes )
+        {
+            if ( axis.lengthSquare() < MathUtil::epsilon )
+                continue;
+
+            float boxProjectionMin, boxProjectionMax, hull1ProjectionMin, hull1ProjectionMax, hull2ProjectionMin, hull2ProjectionMax;
+            project( boxMin, boxMax, axis, boxProjectionMin, boxProjectionMax );
+            project( hullBox1Min, hullBox1Max, axis, hull1ProjectionMin, hull1ProjectionMax );
+            project( hullBox2Min, hullBox2Max, axis, hull2ProjectionMin, hull2ProjectionMax );
+
+            // Projection of the hull is the range spanning the projections of both boxes.
+            if ( boxProjectionMax < std::min( hull1ProjectionMin, hull2ProjectionMin ) || boxProjectionMin > std::max( hull1ProjectionMax, hull2ProjectionMax ) )
+                return false;
+        }
+
+        return true;
+    }
+
+    // Tests the bounding sphere of the box against the cone.
+    bool intersectsCone( const float3& boxMin, const float3& boxMax, const MathUtil::Cone& cone )
+    {
+        return MathUtil::intersectSphereWithCone( ( boxMin + boxMax ) * 0.5f, ( boxMax - boxMin ).length() * 0.5f, cone );
+    }
+}
+
+ShadowCasterCulling::ShadowCasterCulling()
+{
+    m_statistics = Statistics();
+}
+
+ShadowCasterCulling::~ShadowCasterCulling()
+{}
+
+void ShadowCasterCulling::update( const std::vector< std::shared_ptr< BlockActor > >& actors )
+{
+    m_casters.clear();
+    m_casterBoxes.clear();
+    m_actorBoxes.clear();
+
+    for ( const auto& actor : actors )
+    {
+        if ( !actor || !actor->getModel() || !actor->getModel()->getMesh() )
+            continue;
+
+        const BoundingBox box = MathUtil::boundingBoxLocalToWorld( actor->getModel()->getMesh()->getBoundingBox(), actor->getPose() );
+
+        m_actorBoxes.push_back( { box.getMin(), box.getMax() } );
+
+        if ( actor->isCastingShadows() ) {
+            m_casters.push_back( actor );
+            m_casterBoxes.push_back( m_actorBoxes.back() );
+        }
+    }
+}
+
+void ShadowCasterCulling::setReceivers( const std::vector< BoundingBox >& receivers )
+{
+    m_receiverBoxes.clear();
+
+    for ( const BoundingBox& receiver : receivers )
+    {
+        if ( !isEmptyBox( receiver.getMin(), receiver.getMax() ) )
+            m_receiverBoxes.push_back( { receiver.getMin(), receiver.getMax() } );
+    }
+}
+
+void ShadowCasterCulling::setAllActorsAsReceivers()
+{
+    m_receiverBoxes = m_actorBoxes;
+}
+
+const std::vector< std::shared_ptr< BlockActor > >& ShadowCasterCulling::cull( const Light& light )
+{
+    const float  emitterRadius = light.getEmitterRadius();
+    const float3 lightMin      = light.getPosition() - float3( emitterRadius, emitterRadius, emitterRadius );
+    const float3 lightMax      = light.getPosition() + float3( emitterRadius, emitterRadius, emitterRadius );
+
+    bool           isConeUsed = false;
+    MathUtil::Cone cone;
+
+    if ( light.getType() == Light::Type::SpotLight )
+    {
+        const SpotLight& spotLight = static_cast< const SpotLight& >( light );
+
+        std::tie( isConeUsed, cone ) = MathUtil::calculateEmitterCone( spotLight.getPosition(), spotLight.getDirection(), spotLight.getConeAngle(), emitterRadius );
+    }
+
+    // Group receivers lit by the light into a grid of clusters.
+    float3 receiversMin( FLT_MAX, FLT_MAX, FLT_MAX ), receiversMax( -FLT_MAX, -FLT_MAX, -FLT_MAX );
+    for ( const Box& receiver : m_receiverBoxes ) 
+    {
+        if ( isConeUsed && !intersectsCone( receiver.min, receiver.max, cone ) )
+            continue;
+
+        receiversMin = min( receiversMin, ( receiver.min + receiver.max ) * 0.5f );
+        receiversMax = max( receiversMax, ( receiver.min + receiver.max ) * 0.5f );
+    }
+
+    m_clusterBoxes.assign( s_clusterGridSize * s_clusterGridSize * s_clusterGridSize, { float3( FLT_MAX, FLT_MAX, FLT_MAX ), float3( -FLT_MAX, -FLT_MAX, -FLT_MAX ) } );
+
+    const float3 cellSize = ( receiversMax - receiversMin ) / (float)s_clusterGridSize;
+
+    auto getCellCoordinate = [&]( const float position, const float gridMin, const float size ) 
+    {
+        return size > 0.0f ? std::min( s_clusterGridSize - 1, std::max( 0, (int)( ( position - gridMin ) / size ) ) ) : 0;
+    };
+
+    for ( const Box& receiver : m_receiverBoxes ) 
+    {
+        if ( isConeUsed && !intersectsCone( receiver.min, receiver.max, cone ) )
+            continue;
+
+        const float3 center = ( receiver.min + receiver.max ) * 0.5f;
+
+        const int cellX = getCellCoordinate( center.x, receiversMin.x, cellSize.x );
+        const int cellY = getCellCoordinate( center.y, receiversMin.y, cellSize.y );
+        const int cellZ = getCellCoordinate( center.z, receiversMin.z, cellSize.z );
+
+        Box& cluster = m_clusterBoxes[ ( cellZ * s_clusterGridSize + cellY ) * s_clusterGridSize + cellX ];
+        cluster.min = min( cluster.min, receiver.min );
+        cluster.max = max( cluster.max, receiver.max );
+    }
+
+    m_clusterBoxes.erase( 
+        std::remove_if( m_clusterBoxes.begin(), m_clusterBoxes.end(), []( const Box& cluster ) { return isEmptyBox( cluster.min, cluster.max ); } ), 
+        m_clusterBoxes.end() 
+    );
+
+    // Select casters between the light and some receiver cluster.
+    m_relevantCasters.clear();
+    for ( size_t casterIdx = 0; casterIdx < m_casters.size(); ++casterIdx )
+    {
+        const Box& caster = m_casterBoxes[ casterIdx ];
+
+        if ( isConeUsed && !intersectsCone( caster.min, caster.max, cone ) )
+            continue;
+
+        for ( const Box& cluster : m_clusterBoxes )
+        {
+            if ( intersectsHull( caster.min, caster.max, lightMin, lightMax, cluster.min, cluster.max ) ) {
+                m_relevantCasters.push_back( m_casters[ casterIdx ] );
+                break;
+            }
+        }
+    }
+
+    m_statistics.casterCount          = (int)m_casters.size();
+    m_statistics.relevantCasterCount  = (int)m_relevantCasters.size();
+    m_statistics.receiverClusterCount = (int)m_clusterBoxes.size();
+
+    return m_relevantCasters;
+}
+
+const ShadowCasterCulling::Statistics& ShadowCasterCulling::getStatistics() const
+{
+    return m_statistics;
+}
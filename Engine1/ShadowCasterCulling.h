@@ -0,0 +1,72 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "float3.h"
+#include "BoundingBox.h"
+
+namespace Engine1
+{
+    class BlockActor;
+    class Light;
+
+    // Selects the actors which can cast shadows from a given light onto the surfaces visible in the frame - 
+    // so the ray-traced shadow passes don't test (and dispatch for) actors which can't affect the result.
+    //
+    // An actor is relevant if its world bounding box intersects the convex hull of the light's emitter and some receiver.
+    // Receivers are grouped into a small grid of clusters (each cluster bounded by the box of its receivers).
+    // For spot lights receivers and casters outside of the light cone are skipped.
+    // Light attenuation never reaches zero, so light range is not used.
+    class ShadowCasterCulling
+    {
+        public:
+
+        // Number of receiver clusters along each axis.
+        static const int s_clusterGridSize;
+
+        struct Statistics
+        {
+            int casterCount;
+            int relevantCasterCount;
+            int receiverClusterCount;
+        };
+
+        ShadowCasterCulling();
+        ~ShadowCasterCulling();
+
+        // Gathers the shadow casting actors and the world bounding boxes of all the actors.
+        void update( const std::vector< std::shared_ptr< BlockActor > >& actors );
+
+        // Boxes of the surfaces which are shaded - e.g. actors visible from the camera. Empty boxes (min > max) are ignored.
+        void setReceivers( const std::vector< BoundingBox >& receivers );
+
+        // All the updated actors are receivers - for secondary layers, where shaded surfaces can be anywhere.
+        void setAllActorsAsReceivers();
+
+        // Returns the casters which may shadow any of the receivers (in the same order as passed to update).
+        const std::vector< std::shared_ptr< BlockActor > >& cull( const Light& light );
+
+        // Statistics of the last cull.
+        const Statistics& getStatistics() const;
+
+        private:
+
+        struct Box
+        {
+            float3 min;
+            float3 max;
+        };
+
+        std::vector< std::shared_ptr< BlockActor > > m_casters;
+        std::vector< Box >                           m_casterBoxes;
+        std::vector< Box >                           m_actorBoxes;
+        std::vector< Box >                           m_receiverBoxes;
+
+        // Reused between calls to avoid allocations.
+        std::vector< Box >                           m_clusterBoxes;
+        std::vector< std::shared_ptr< BlockActor > > m_relevantCasters;
+
+        Statistics m_statistics;
+    };
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+// Backend of the math types (float4, float43, float44, quat) and of MathBatch, selected at compile time:
+// 0 - scalar code,
+// 1 - SSE2 (default - always available on x64),
+// 2 - AVX for the batch kernels which benefit from 8-wide registers (requires building with /arch:AVX).
+// Memory layout of the types doesn't depend on the backend - float3 stays 12 bytes, as vertex buffers and PhysX depend on it,
+// so all the loads and stores are unaligned and never touch memory past the end of the object.
+#ifndef ENGINE1_MATH_SIMD
+#define ENGINE1_MATH_SIMD 1
+#endif
+
+#if ENGINE1_MATH_SIMD >= 1
+#include <emmintrin.h>
+#endif
+
+#if ENGINE1_MATH_SIMD >= 2
+#include <immintrin.h>
+#endif
+
+#if ENGINE1_MATH_SIMD >= 1
+
+namespace Engine1
+{
+    namespace Simd
+    {
+        // Loads 3 floats (last lane is 0).
+        inline __m128 loadFloat3( const float* data )
+        {
+            const __m128 xy = _mm_castpd_ps( _mm_load_sd( reinterpret_cast< const double* >( data ) ) );
+            const __m128 z  = _mm_load_ss( data + 2 );
+
+            return _mm_movelh_ps( xy, z );
+        }
+
+        // Stores the first 3 lanes.
+        inline void storeFloat3( float* data, const __m128 value )
+        {
+            _mm_store_sd( reinterpret_cast< double* >( data ), _mm_castps_pd( value ) );
+            _mm_store_ss( data + 2, _mm_movehl_ps( value, value ) );
+        }
+
+        template< int lane >
+        inline __m128 splat( const __m128 value )
+        {
+            return _mm_shuffle_ps( value, value, _MM_SHUFFLE( lane, lane, lane, lane ) );
+        }
+
+        // Row vector times a matrix given by its rows.
+        inline __m128 transform( const __m128 vec, const __m128 row1, const __m128 row2, const __m128 row3, const __m128 row4 )
+        {
+            return _mm_add_ps(
+                _mm_add_ps( _mm_mul_ps( splat< 0 >( vec ), row1 ), _mm_mul_ps( splat< 1 >( vec ), row2 ) ),
+                _mm_add_ps( _mm_mul_ps( splat< 2 >( vec ), row3 ), _mm_mul_ps( splat< 3 >( vec ), row4 ) )
+            );
+        }
+
+        // Row vector (with implicit w = 1) times a 4x3 matrix given by its rows. Last lane of the vector is ignored.
+        inline __m128 transformPoint( const __m128 vec, const __m128 row1, const __m128 row2, const __m128 row3, const __m128 translation )
+        {
+            return _mm_add_ps(
+                _mm_add_ps( _mm_mul_ps( splat< 0 >( vec ), row1 ), _mm_mul_ps( splat< 1 >( vec ), row2 ) ),
+                _mm_add_ps( _mm_mul_ps( splat< 2 >( vec ), row3 ), translation )
+            );
+        }
+    }
+}
+
+#endif
@@ -2,14 +2,17 @@
 
 #include "SkeletonModel.h"
 #include "SkeletonAnimation.h"
+#include "SkeletonMesh.h"
 
 using namespace Engine1;
 
 SkeletonActor::SkeletonActor( std::shared_ptr<SkeletonModel> model, const float43& pose ) :
     m_pose( pose ),
     m_model( model ),
+    m_boneBoundsDirty( true ),
     m_animationProgress( 0.0f ),
-    m_animationSpeed( 0.0f )
+    m_animationSpeed( 0.0f ),
+    m_hasAnimatedPose( false )
 {
     resetSkeletonPose();
 }
@@ -18,10 +21,13 @@ SkeletonActor::SkeletonActor( std::shared_ptr<SkeletonModel> model, const float4
     m_pose( pose ),
     m_skeletonPose( skeletonPose ),
     m_model( model ),
+    m_boneBoundsDirty( true ),
     m_animationProgress( 0.0f ),
-    m_animationSpeed( 0.0f )
+    m_animationSpeed( 0.0f ),
+    m_hasAnimatedPose( false )
 {
     //#TODO: should it check whether skeletonPose is correct for the passed mesh?
+    updateBoneBounds();
 }
 
 SkeletonActor::~SkeletonActor( )
@@ -51,9 +57,30 @@ const SkeletonPose& SkeletonActor::getSkeletonPose( ) const
 
 SkeletonPose& SkeletonActor::getSkeletonPose( )
 {
+    // Pose may be modified through the returned reference.
+    m_boneBoundsDirty = true;
+
     return m_skeletonPose;
 }
 
+const SkeletonBoneBounds& SkeletonActor::getBoneBounds() const
+{
+    return m_boneBounds;
+}
+
+BoundingBox SkeletonActor::getBoundingBox() const
+{
+    const SkeletonBoneBounds& boneBounds = getBoneBounds();
+
+    if ( !boneBounds.isEmpty() )
+        return boneBounds.getBoundingBox();
+
+    if ( m_model && m_model->getMesh() )
+        return m_model->getMesh()->getBoundingBox();
+
+    return BoundingBox();
+}
+
 std::shared_ptr<const SkeletonModel> SkeletonActor::getModel( ) const
 {
     return m_model;
@@ -81,8 +108,11 @@ void SkeletonActor::setPose( const float43& pose )
 
 void SkeletonActor::setSkeletonPose( const SkeletonPose& poseInSkeletonSpace )
 {
-    this->m_skeletonPose = poseInSkeletonSpace;
+    this->m_skeletonPose    = poseInSkeletonSpace;
+    this->m_boneBoundsDirty = true;
     //#TODO: should it check whether skeletonPose is correct for the passed mesh?
+
+    updateBoneBounds();
 }
 
 void SkeletonActor::setModel( std::shared_ptr<SkeletonModel> model )
@@ -95,26 +125,55 @@ void SkeletonActor::setModel( std::shared_ptr<SkeletonModel> model )
 
 void SkeletonActor::resetSkeletonPose()
 {
+    m_boneBoundsDirty = true;
+    m_hasAnimatedPose = false; // Sampled for the previous model.
+
     if ( m_model && m_model->getMesh() )
         m_skeletonPose = SkeletonPose::createIdentityPoseInSkeletonSpace( *m_model->getMesh() );
     else
         m_skeletonPose.clear();
+
+    updateBoneBounds();
+}
+
+void SkeletonActor::updateBoneBounds()
+{
+    if ( !m_boneBoundsDirty )
+        return;
+
+    if ( m_model && m_model->getMesh() )
+        m_boneBounds.update( *m_model->getMesh(), m_skeletonPose );
+    else
+        m_boneBounds.clear();
+
+    m_boneBoundsDirty = false;
 }
 
 void SkeletonActor::startAnimation( const std::shared_ptr< SkeletonAnimation > animationInSkeletonSpace )
 {
-    if ( !m_model || !m_model->getMesh() || !animationInSkeletonSpace || animationInSkeletonSpace->getKeyframeCount() == 0 ||
-         animationInSkeletonSpace->getPose( 0 ).getBonesCount() != m_model->getMesh()->getBoneCount() )
+    if ( !m_model || !m_model->getMesh() || !animationInSkeletonSpace || animationInSkeletonSpace->getKeyframeCount() == 0 )
+        return;
+
+    // Decoded for compressed animations as well.
+    const SkeletonPose firstPose = animationInSkeletonSpace->getKeyframePose( 0 );
+    if ( firstPose.getBonesCount() != m_model->getMesh()->getBoneCount() )
         return;
 
     this->m_animation         = animationInSkeletonSpace;
     this->m_animationProgress = 0.0f;
+    this->m_hasAnimatedPose   = false;
     this->m_animationSpeed    = 1.0f / (float)animationInSkeletonSpace->getKeyframeCount(); // Temporarily assuming that whole animation takes 1 second.
 
-    setSkeletonPose( animationInSkeletonSpace->getPose( 0 ) );
+    setSkeletonPose( firstPose );
 }
 
 void SkeletonActor::updateAnimation( const float deltaTime )
+{
+    evaluateAnimation( deltaTime );
+    applyAnimation();
+}
+
+void SkeletonActor::evaluateAnimation( const float deltaTime )
 {
     if (!m_animation)
         return;
@@ -122,5 +181,24 @@ void SkeletonActor::updateAnimation( const float deltaTime )
     m_animationProgress += m_animationSpeed * deltaTime;
     m_animationProgress = fmod( m_animationProgress, 1.0f );
 
-    setSkeletonPose( m_animation->getInterpolatedPose( m_animationProgress ) );
+    m_animatedPose = m_animation->getInterpolatedPose( m_animationProgress );
+
+    if ( m_model && m_model->getMesh() )
+        m_animatedBoneBounds.update( *m_model->getMesh(), m_animatedPose );
+    else
+        m_animatedBoneBounds.clear();
+
+    m_hasAnimatedPose = true;
+}
+
+void SkeletonActor::applyAnimation()
+{
+    if ( !m_hasAnimatedPose )
+        return;
+
+    m_skeletonPose = m_animatedPose;
+    m_boneBounds   = m_animatedBoneBounds;
+
+    m_boneBoundsDirty = false;
+    m_hasAnimatedPose = false;
 }
@@ -6,6 +6,7 @@
 
 #include "float43.h"
 #include "SkeletonPose.h"
+#include "SkeletonBoneBounds.h"
 
 namespace Engine1
 {
@@ -27,6 +28,14 @@ namespace Engine1
         const SkeletonPose&                  getSkeletonPose() const;
         SkeletonPose&                        getSkeletonPose();
 
+        // Bone bounds (in mesh space) for the current skeleton pose. Recalculated by the setters - if the pose is modified
+        // through the non-const getSkeletonPose(), they are stale until updateBoneBounds is called (Scene::updateActorData does that).
+        const SkeletonBoneBounds&            getBoneBounds() const;
+
+        // Box (in mesh space) tightly bounding the mesh in the current skeleton pose. Falls back to the box of the mesh in bind pose
+        // if the mesh has no bone bounding boxes.
+        BoundingBox                          getBoundingBox() const;
+
         std::shared_ptr< const SkeletonModel > getModel() const;
         std::shared_ptr< SkeletonModel >       getModel();
 
@@ -39,10 +48,22 @@ namespace Engine1
 
         void resetSkeletonPose();
 
+        // Recalculates bone bounds if the pose was modified through the non-const getSkeletonPose().
+        void updateBoneBounds();
+
         // Temporary.
         void startAnimation( const std::shared_ptr< SkeletonAnimation > animationInSkeletonSpace );
+
+        // Same as evaluateAnimation followed by applyAnimation.
         void updateAnimation( const float deltaTime );
 
+        // Advances the animation and samples the pose (and its bone bounds) without changing the current pose,
+        // so the actor can be rendered by another thread meanwhile.
+        void evaluateAnimation( const float deltaTime );
+
+        // Sets the pose sampled by the last evaluateAnimation.
+        void applyAnimation();
+
         private:
 
         float43 m_pose;
@@ -50,10 +71,18 @@ namespace Engine1
 
         std::shared_ptr< SkeletonModel > m_model;
 
+        SkeletonBoneBounds m_boneBounds;
+        bool               m_boneBoundsDirty;
+
         // Temporary.
         std::shared_ptr< SkeletonAnimation > m_animation;
         float m_animationProgress;
         float m_animationSpeed;
+
+        // Result of the last evaluateAnimation.
+        SkeletonPose       m_animatedPose;
+        SkeletonBoneBounds m_animatedBoneBounds;
+        bool               m_hasAnimatedPose;
     };
 }
 
@@ -7,16 +7,21 @@
 #include "StringUtil.h"
 
 #include "MyXAFFileParser.h"
-
-#include "TextFile.h"
+#include "SkeletonPoseMath.h"
 
 using namespace Engine1;
 
 std::shared_ptr<SkeletonAnimation> SkeletonAnimation::createFromFile( const std::string& path, const SkeletonAnimationFileInfo::Format format, const SkeletonMesh& mesh, const bool invertZCoordinate )
 {
-	std::shared_ptr< std::vector<char> > fileData = TextFile::load( path );
+	std::shared_ptr<SkeletonAnimation> animation = std::make_shared<SkeletonAnimation>( );
+
+	if ( SkeletonAnimationFileInfo::Format::XAF == format ) {
+		// File is parsed while being read - it's never loaded into memory as a whole.
+		std::ifstream file( path.c_str(), std::ifstream::in | std::ifstream::binary );
+		if ( !file.is_open() ) throw std::exception( ( "SkeletonAnimation::createFromFile - failed to open file. (" + path + ")" ).c_str() );
 
-	std::shared_ptr<SkeletonAnimation> animation = createFromMemory( *fileData, format, mesh, invertZCoordinate );
+		MyXAFFileParser::parseSkeletonAnimationFile( file, mesh, *animation, invertZCoordinate );
+	}
 
 	animation->getFileInfo().setPath( path );
 	animation->getFileInfo().setFormat( format );
@@ -41,8 +46,10 @@ std::shared_ptr<SkeletonAnimation> SkeletonAnimation::calculateAnimationInSkelet
 {
 	std::shared_ptr<SkeletonAnimation> animationInSkeletonSpace = std::make_shared<SkeletonAnimation>( );
 
-	for ( const SkeletonPose& poseInParentSpace : animationInParentSpace.m_skeletonPoses )
-		animationInSkeletonSpace->m_skeletonPoses.push_back( SkeletonPose::calculatePoseInSkeletonSpace( poseInParentSpace, skeletonMesh ) );
+	// Compressed animations are decompressed - the result isn't compressed.
+	const unsigned int keyframeCount = animationInParentSpace.getKeyframeCount();
+	for ( unsigned int keyframe = 0; keyframe < keyframeCount; ++keyframe )
+		animationInSkeletonSpace->m_skeletonPoses.push_back( SkeletonPose::calculatePoseInSkeletonSpace( animationInParentSpace.getKeyframePose( keyframe ), skeletonMesh ) );
 
 	return animationInSkeletonSpace;
 }
@@ -51,8 +58,10 @@ std::shared_ptr<SkeletonAnimation> SkeletonAnimation::calculateAnimationInParent
 {
 	std::shared_ptr<SkeletonAnimation> animationInParentSpace = std::make_shared<SkeletonAnimation>( );
 
-	for ( const SkeletonPose& poseInSkeletonSpace : animationInSkeletonSpace.m_skeletonPoses )  
-		animationInParentSpace->m_skeletonPoses.push_back( SkeletonPose::calculatePoseInParentSpace( poseInSkeletonSpace, skeletonMesh ) );
+	// Compressed animations are decompressed - the result isn't compressed.
+	const unsigned int keyframeCount = animationInSkeletonSpace.getKeyframeCount();
+	for ( unsigned int keyframe = 0; keyframe < keyframeCount; ++keyframe )
+		animationInParentSpace->m_skeletonPoses.push_back( SkeletonPose::calculatePoseInParentSpace( animationInSkeletonSpace.getKeyframePose( keyframe ), skeletonMesh ) );
 
 	return animationInParentSpace;
 }
@@ -63,7 +72,8 @@ SkeletonAnimation::SkeletonAnimation()
 SkeletonAnimation::SkeletonAnimation( SkeletonAnimation&& other )
 {
 	// TODO: should be tested.
-	m_skeletonPoses = std::move( other.m_skeletonPoses );
+	m_skeletonPoses       = std::move( other.m_skeletonPoses );
+	m_compressedAnimation = std::move( other.m_compressedAnimation );
 }
 
 SkeletonAnimation::~SkeletonAnimation() 
@@ -111,6 +121,9 @@ void SkeletonAnimation::addPose( SkeletonPose& pose )
 
 SkeletonPose SkeletonAnimation::getInterpolatedPose( float progress )
 {
+	if ( m_compressedAnimation )
+		return m_compressedAnimation->samplePose( progress );
+
 	const float frame               = progress * (float)( m_skeletonPoses.size() - 1 );
 	const unsigned int prevKeyframe = std::max( 0u, (unsigned int)frame );
     const unsigned int nextKeyframe = std::min( (unsigned int)m_skeletonPoses.size( ) - 1, (unsigned int)frame + 1 );
@@ -122,8 +135,67 @@ SkeletonPose SkeletonAnimation::getInterpolatedPose( float progress )
 		return SkeletonPose::blendPoses( m_skeletonPoses.at( prevKeyframe ), m_skeletonPoses.at( nextKeyframe ), fraction );
 }
 
+void SkeletonAnimation::samplePose( float progress, quat* orientations, float3* translations, float3* scales, const int boneCount ) const
+{
+	if ( m_compressedAnimation ) {
+		m_compressedAnimation->samplePose( progress, orientations, translations, scales, boneCount );
+		return;
+	}
+
+	if ( m_skeletonPoses.empty() ) throw std::exception( "SkeletonAnimation::samplePose() - animation has no keyframes." );
+
+	progress = std::min( std::max( progress, 0.0f ), 1.0f );
+
+	const float        frame        = progress * (float)( m_skeletonPoses.size() - 1 );
+	const unsigned int prevKeyframe = (unsigned int)frame;
+	const unsigned int nextKeyframe = std::min( (unsigned int)m_skeletonPoses.size() - 1, prevKeyframe + 1 );
+	const float        fraction     = frame - (float)prevKeyframe;
+
+	const SkeletonPose& prevPose = m_skeletonPoses[ prevKeyframe ];
+	const SkeletonPose& nextPose = m_skeletonPoses[ nextKeyframe ];
+
+	const int prevCount = std::min( boneCount, (int)prevPose.getOrientations().size() );
+	const int nextCount = std::min( boneCount, (int)nextPose.getOrientations().size() );
+	const int count     = std::min( prevCount, nextCount );
+
+	SkeletonPoseMath::slerp( prevPose.getOrientations().data(), nextPose.getOrientations().data(), fraction, orientations, count );
+	SkeletonPoseMath::lerp( prevPose.getTranslations().data(), nextPose.getTranslations().data(), fraction, translations, count );
+	SkeletonPoseMath::lerp( prevPose.getScales().data(), nextPose.getScales().data(), fraction, scales, count );
+
+	// Bones present only in one of the poses are not blended.
+	for ( int i = 0; i < boneCount; ++i ) {
+		const unsigned char boneIndex = (unsigned char)( i + 1 );
+		const bool          inPrev    = i < prevCount && prevPose.hasBone( boneIndex );
+		const bool          inNext    = i < nextCount && nextPose.hasBone( boneIndex );
+
+		if ( inPrev && inNext )
+			continue;
+
+		if ( inPrev || inNext ) {
+			const SkeletonPose& sourcePose = inPrev ? prevPose : nextPose;
+
+			orientations[ i ] = sourcePose.getOrientations()[ i ];
+			translations[ i ] = sourcePose.getTranslations()[ i ];
+			scales[ i ]       = sourcePose.getScales()[ i ];
+		} else {
+			orientations[ i ] = quat( 1.0f, 0.0f, 0.0f, 0.0f );
+			translations[ i ] = float3::ZERO;
+			scales[ i ]       = float3::ONE;
+		}
+	}
+}
+
 SkeletonPose& SkeletonAnimation::getPose( unsigned int keyframe )
 {
+	if ( m_compressedAnimation ) throw std::exception( "SkeletonAnimation::getPose() - animation is compressed." );
+	if ( keyframe >= m_skeletonPoses.size() ) throw std::exception( "SkeletonAnimation::getPose() - keyframe is out of range." );
+
+	return m_skeletonPoses.at( keyframe );
+}
+
+const SkeletonPose& SkeletonAnimation::getPose( unsigned int keyframe ) const
+{
+	if ( m_compressedAnimation ) throw std::exception( "SkeletonAnimation::getPose() - animation is compressed." );
 	if ( keyframe >= m_skeletonPoses.size() ) throw std::exception( "SkeletonAnimation::getPose() - keyframe is out of range." );
 
 	return m_skeletonPoses.at( keyframe );
@@ -131,13 +203,45 @@ SkeletonPose& SkeletonAnimation::getPose( unsigned int keyframe )
 
 SkeletonPose& SkeletonAnimation::getOrAddPose( unsigned int keyframe )
 {
+	if ( m_compressedAnimation ) throw std::exception( "SkeletonAnimation::getOrAddPose() - animation is compressed." );
+
 	while ( m_skeletonPoses.size( ) <= keyframe )
 		m_skeletonPoses.push_back( SkeletonPose() );
 
 	return m_skeletonPoses.at( keyframe );
 }
 
-unsigned int SkeletonAnimation::getKeyframeCount()
+SkeletonPose SkeletonAnimation::getKeyframePose( unsigned int keyframe ) const
 {
+	if ( !m_compressedAnimation )
+		return m_skeletonPoses.at( keyframe );
+
+	const unsigned int keyframeCount = m_compressedAnimation->getKeyframeCount();
+	if ( keyframe >= keyframeCount ) 
+		throw std::exception( "SkeletonAnimation::getKeyframePose - keyframe out of range." );
+
+	return m_compressedAnimation->samplePose( keyframeCount > 1 ? (float)keyframe / (float)( keyframeCount - 1 ) : 0.0f );
+}
+
+unsigned int SkeletonAnimation::getKeyframeCount() const
+{
+	if ( m_compressedAnimation )
+		return m_compressedAnimation->getKeyframeCount();
+
 	return (unsigned int)m_skeletonPoses.size();
 }
+
+void SkeletonAnimation::compress( const CompressedSkeletonAnimation::Options& options, CompressedSkeletonAnimation::Statistics* statistics )
+{
+	if ( m_compressedAnimation ) throw std::exception( "SkeletonAnimation::compress() - animation is already compressed." );
+
+	m_compressedAnimation = CompressedSkeletonAnimation::compress( *this, options, statistics );
+
+	// Release the memory of the poses.
+	std::vector< SkeletonPose >().swap( m_skeletonPoses );
+}
+
+bool SkeletonAnimation::isCompressed() const
+{
+	return m_compressedAnimation != nullptr;
+}
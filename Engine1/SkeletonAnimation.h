@@ -7,6 +7,7 @@
 
 #include "SkeletonMesh.h"
 #include "SkeletonPose.h"
+#include "CompressedSkeletonAnimation.h"
 
 #include "SkeletonAnimationFileInfo.h"
 
@@ -39,12 +40,25 @@ namespace Engine1
         void addPose( SkeletonPose& pose );
         SkeletonPose getInterpolatedPose( float progress );
 
-        SkeletonPose& getPose( unsigned int keyframe );
+        // Samples the pose into dense arrays (indexed by boneIndex - 1, boneCount elements each) without allocating memory.
+        // Bones which are not in the animation (or don't fit in the arrays) get identity poses.
+        void samplePose( float progress, quat* orientations, float3* translations, float3* scales, const int boneCount ) const;
+
+        SkeletonPose&       getPose( unsigned int keyframe );
+        const SkeletonPose& getPose( unsigned int keyframe ) const;
 
         // Returns pose at given keyframe. If there is no pose at such keyframe - new poses are added until (keyframe + 1) exist. 
         SkeletonPose& getOrAddPose( unsigned int keyframe );
 
-        unsigned int getKeyframeCount();
+        // Unlike getPose, works for compressed animations too (decodes the keyframe).
+        SkeletonPose getKeyframePose( unsigned int keyframe ) const;
+
+        unsigned int getKeyframeCount() const;
+
+        // Replaces the keyframe poses with compressed tracks. Poses are sampled from the compressed data from now on
+        // - they can no longer be accessed or modified with getPose/getOrAddPose.
+        void compress( const CompressedSkeletonAnimation::Options& options = CompressedSkeletonAnimation::Options(), CompressedSkeletonAnimation::Statistics* statistics = nullptr );
+        bool isCompressed() const;
 
         private:
 
@@ -52,6 +66,8 @@ namespace Engine1
 
         std::vector< SkeletonPose > m_skeletonPoses;
 
+        std::shared_ptr< const CompressedSkeletonAnimation > m_compressedAnimation;
+
         // Copying animation in not allowed.
         SkeletonAnimation( const SkeletonAnimation& ) = delete;
         SkeletonAnimation& operator=(const SkeletonAnimation&) = delete;
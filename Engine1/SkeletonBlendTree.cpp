@@ -0,0 +1,519 @@
+#include "SkeletonBlendTree.h"
+
+#include <cmath>
+#include <string>
+#include <algorithm>
+
+#include "SkeletonAnimation.h"
+#include "SkeletonPoseMath.h"
+#include "ScratchArena.h"
+#include "JobSystem.h"
+
+using namespace Engine1;
+
+namespace
+{
+    const int minInstanceCountPerJob = 16;
+
+    // Each thread reuses its arena for all the evaluated instances.
+    thread_local ScratchArena threadScratchArena;
+
+    float clamp01( const float value )
+    {
+        return std::min( std::max( value, 0.0f ), 1.0f );
+    }
+
+    // Normalized linear interpolation along the shorter arc.
+    quat nlerp( const quat& from, const quat& to, const float factor )
+    {
+        const float toFactor = quat::dot( from, to ) < 0.0f ? -factor : factor;
+
+        quat result(
+            from.w * ( 1.0f - factor ) + to.w * toFactor,
+            from.x * ( 1.0f - factor ) + to.x * toFactor,
+            from.y * ( 1.0f - factor ) + to.y * toFactor,
+            from.z * ( 1.0f - factor ) + to.z * toFactor
+        );
+        result.normalize();
+
+        return result;
+    }
+}
+
+SkeletonBlendTree::Instance::Instance( const std::shared_ptr< const SkeletonBlendTree >& tree ) :
+    tree( tree ),
+    parameters( tree ? tree->getParameterCount() : 0, 0.0f )
+{}
+
+void SkeletonBlendTree::evaluate( std::vector< Instance >& instances )
+{
+    JobSystem::get().parallelFor( (int)instances.size(), minInstanceCountPerJob, [ &instances ]( const int begin, const int end )
+    {
+        for ( int instanceIdx = begin; instanceIdx < end; ++instanceIdx )
+        {
+            Instance& instance = instances[ instanceIdx ];
+
+            if ( !instance.tree ) throw std::exception( "SkeletonBlendTree::evaluate - instance has no tree." );
+            if ( (int)instance.parameters.size() < instance.tree->getParameterCount() ) throw std::exception( "SkeletonBlendTree::evaluate - instance has too few parameters." );
+
+            instance.tree->evaluate( instance.parameters.data(), instance.pose, threadScratchArena );
+        }
+    } );
+}
+
+SkeletonBlendTree::SkeletonBlendTree( const int boneCount ) :
+    m_boneCount( boneCount ),
+    m_parameterCount( 0 ),
+    m_rootNode( -1 )
+{
+    if ( boneCount < 0 || boneCount > SkeletonPose::s_maxBoneCount ) throw std::exception( "SkeletonBlendTree::SkeletonBlendTree - bone count is out of range." );
+}
+
+SkeletonBlendTree::~SkeletonBlendTree()
+{}
+
+int SkeletonBlendTree::addClip( const std::shared_ptr< const SkeletonAnimation >& animation, const int progressParameter )
+{
+    if ( !animation ) throw std::exception( "SkeletonBlendTree::addClip - animation is nullptr." );
+    if ( animation->getKeyframeCount() == 0 ) throw std::exception( "SkeletonBlendTree::addClip - animation has no keyframes." );
+
+    checkParameter( progressParameter );
+
+    Node node;
+    node.type            = NodeType::Clip;
+    node.parameters[ 0 ] = progressParameter;
+    node.animation       = animation;
+
+    return addNode( node );
+}
+
+int SkeletonBlendTree::addLerp( const int fromNode, const int toNode, const int factorParameter )
+{
+    checkNode( fromNode );
+    checkNode( toNode );
+    checkParameter( factorParameter );
+
+    Node node;
+    node.type            = NodeType::Lerp;
+    node.children[ 0 ]   = fromNode;
+    node.children[ 1 ]   = toNode;
+    node.parameters[ 0 ] = factorParameter;
+    node.scratchSize     = std::max( m_nodes[ fromNode ].scratchSize, getPoseSize() + m_nodes[ toNode ].scratchSize );
+
+    return addNode( node );
+}
+
+int SkeletonBlendTree::addAdditive( const int baseNode, const int additiveNode, const int referenceNode, const int weightParameter )
+{
+    checkNode( baseNode );
+    checkNode( additiveNode );
+    checkNode( referenceNode );
+    checkParameter( weightParameter );
+
+    Node node;
+    node.type            = NodeType::Additive;
+    node.children[ 0 ]   = baseNode;
+    node.children[ 1 ]   = additiveNode;
+    node.children[ 2 ]   = referenceNode;
+    node.parameters[ 0 ] = weightParameter;
+    node.scratchSize     = std::max( m_nodes[ baseNode ].scratchSize, 2 * getPoseSize() + std::max( m_nodes[ additiveNode ].scratchSize, m_nodes[ referenceNode ].scratchSize ) );
+
+    return addNode( node );
+}
+
+int SkeletonBlendTree::addMaskedLayer( const int baseNode, const int layerNode, const std::vector< float >& boneWeights, const int weightParameter )
+{
+    checkNode( baseNode );
+    checkNode( layerNode );
+    checkParameter( weightParameter );
+
+    if ( (int)boneWeights.size() != m_boneCount ) throw std::exception( "SkeletonBlendTree::addMaskedLayer - bone weight count has to be equal to the bone count." );
+
+    Node node;
+    node.type            = NodeType::MaskedLayer;
+    node.children[ 0 ]   = baseNode;
+    node.children[ 1 ]   = layerNode;
+    node.parameters[ 0 ] = weightParameter;
+    node.firstItem       = (int)m_boneWeights.size();
+    node.itemCount       = m_boneCount;
+    node.scratchSize     = std::max( m_nodes[ baseNode ].scratchSize, getPoseSize() + m_nodes[ layerNode ].scratchSize );
+
+    for ( const float weight : boneWeights )
+        m_boneWeights.push_back( clamp01( weight ) );
+
+    return addNode( node );
+}
+
+int SkeletonBlendTree::addBlendSpace1D( std::vector< std::pair< float, int > > samples, const int positionParameter )
+{
+    if ( samples.empty() ) throw std::exception( "SkeletonBlendTree::addBlendSpace1D - blend space has no samples." );
+
+    checkParameter( positionParameter );
+
+    std::sort( samples.begin(), samples.end(), []( const std::pair< float, int >& sample1, const std::pair< float, int >& sample2 ) { return sample1.first < sample2.first; } );
+
+    Node node;
+    node.type            = NodeType::BlendSpace1D;
+    node.parameters[ 0 ] = positionParameter;
+    node.firstItem       = (int)m_blendSpaceSamples.size();
+    node.itemCount       = (int)samples.size();
+
+    for ( const auto& sample : samples )
+        checkNode( sample.second );
+
+    for ( const auto& sample : samples )
+    {
+        m_blendSpaceSamples.push_back( { float2( sample.first, 0.0f ), sample.second } );
+        node.scratchSize = std::max( node.scratchSize, m_nodes[ sample.second ].scratchSize );
+    }
+
+    node.scratchSize += getPoseSize();
+
+    return addNode( node );
+}
+
+int SkeletonBlendTree::addBlendSpace2D( const std::vector< std::pair< float2, int > >& samples, const int positionXParameter, const int positionYParameter )
+{
+    if ( samples.empty() ) throw std::exception( "SkeletonBlendTree::addBlendSpace2D - blend space has no samples." );
+
+    checkParameter( positionXParameter );
+    checkParameter( positionYParameter );
+
+    Node node;
+    node.type            = NodeType::BlendSpace2D;
+    node.parameters[ 0 ] = positionXParameter;
+    node.parameters[ 1 ] = positionYParameter;
+    node.firstItem       = (int)m_blendSpaceSamples.size();
+    node.itemCount       = (int)samples.size();
+
+    for ( int sampleIdx = 0; sampleIdx < (int)samples.size(); ++sampleIdx )
+    {
+        checkNode( samples[ sampleIdx ].second );
+
+        for ( int otherSampleIdx = 0; otherSampleIdx < sampleIdx; ++otherSampleIdx )
+        {
+            if ( samples[ otherSampleIdx ].first == samples[ sampleIdx ].first ) throw std::exception( "SkeletonBlendTree::addBlendSpace2D - samples have to be at different positions." );
+        }
+    }
+
+    for ( const auto& sample : samples )
+    {
+        m_blendSpaceSamples.push_back( { sample.first, sample.second } );
+        node.scratchSize = std::max( node.scratchSize, m_nodes[ sample.second ].scratchSize );
+    }
+
+    node.scratchSize += ScratchArena::getAlignedSize( samples.size() * sizeof( float ) ) + getPoseSize();
+
+    return addNode( node );
+}
+
+void SkeletonBlendTree::setRootNode( const int node )
+{
+    checkNode( node );
+
+    m_rootNode = node;
+}
+
+int SkeletonBlendTree::getBoneCount() const
+{
+    return m_boneCount;
+}
+
+int SkeletonBlendTree::getNodeCount() const
+{
+    return (int)m_nodes.size();
+}
+
+int SkeletonBlendTree::getParameterCount() const
+{
+    return m_parameterCount;
+}
+
+size_t SkeletonBlendTree::getScratchSize() const
+{
+    if ( m_rootNode < 0 )
+        return 0;
+
+    return getPoseSize() + m_nodes[ m_rootNode ].scratchSize;
+}
+
+void SkeletonBlendTree::evaluate( const float* parameters, SkeletonPose& pose, ScratchArena& arena ) const
+{
+    if ( m_rootNode < 0 ) throw std::exception( "SkeletonBlendTree::evaluate - tree has no nodes." );
+
+    arena.reset( getScratchSize() );
+
+    const PoseBuffer result = allocatePose( arena );
+
+    evaluateNode( m_rootNode, parameters, result, arena );
+
+    pose.setBonePoses( result.orientations, result.translations, result.scales, m_boneCount );
+}
+
+SkeletonBlendTree::Node::Node() :
+    type( NodeType::Clip ),
+    children{ -1, -1, -1 },
+    parameters{ -1, -1 },
+    firstItem( 0 ),
+    itemCount( 0 ),
+    scratchSize( 0 )
+{}
+
+int SkeletonBlendTree::addNode( const Node& node )
+{
+    m_nodes.push_back( node );
+
+    m_rootNode = (int)m_nodes.size() - 1;
+
+    return m_rootNode;
+}
+
+void SkeletonBlendTree::checkNode( const int node ) const
+{
+    if ( node < 0 || node >= (int)m_nodes.size() ) throw std::exception( ( "SkeletonBlendTree::checkNode - node doesn't exist (node " + std::to_string( node ) + ")." ).c_str() );
+}
+
+void SkeletonBlendTree::checkParameter( const int parameter )
+{
+    if ( parameter < 0 ) throw std::exception( "SkeletonBlendTree::checkParameter - parameter index cannot be negative." );
+
+    m_parameterCount = std::max( m_parameterCount, parameter + 1 );
+}
+
+size_t SkeletonBlendTree::getPoseSize() const
+{
+    return ScratchArena::getAlignedSize( m_boneCount * sizeof( quat ) ) + 2 * ScratchArena::getAlignedSize( m_boneCount * sizeof( float3 ) );
+}
+
+SkeletonBlendTree::PoseBuffer SkeletonBlendTree::allocatePose( ScratchArena& arena ) const
+{
+    PoseBuffer pose;
+    pose.orientations = arena.allocate< quat >( m_boneCount );
+    pose.translations = arena.allocate< float3 >( m_boneCount );
+    pose.scales       = arena.allocate< float3 >( m_boneCount );
+
+    return pose;
+}
+
+void SkeletonBlendTree::evaluateNode( const int nodeIndex, const float* parameters, const PoseBuffer& result, ScratchArena& arena ) const
+{
+    const Node&  node   = m_nodes[ nodeIndex ];
+    const size_t marker = arena.getMarker();
+
+    // Blends the pose of the child node into the result.
+    auto blendChild = [ & ]( const int childNode, const float factor )
+    {
+        const PoseBuffer childPose = allocatePose( arena );
+
+        evaluateNode( childNode, parameters, childPose, arena );
+
+        SkeletonPoseMath::slerp( result.orientations, childPose.orientations, factor, result.orientations, m_boneCount );
+        SkeletonPoseMath::lerp( result.translations, childPose.translations, factor, result.translations, m_boneCount );
+        SkeletonPoseMath::lerp( result.scales, childPose.scales, factor, result.scales, m_boneCount );
+
+        arena.release( marker );
+    };
+
+    switch ( node.type )
+    {
+        case NodeType::Clip:
+        {
+            node.animation->samplePose( parameters[ node.parameters[ 0 ] ], result.orientations, result.translations, result.scales, m_boneCount );
+            break;
+        }
+        case NodeType::Lerp:
+        {
+            const float factor = clamp01( parameters[ node.parameters[ 0 ] ] );
+
+            // Skip the child which doesn't contribute to the result.
+            evaluateNode( factor < 1.0f ? node.children[ 0 ] : node.children[ 1 ], parameters, result, arena );
+
+            if ( factor > 0.0f && factor < 1.0f )
+                blendChild( node.children[ 1 ], factor );
+
+            break;
+        }
+        case NodeType::Additive:
+        {
+            const float weight = clamp01( parameters[ node.parameters[ 0 ] ] );
+
+            evaluateNode( node.children[ 0 ], parameters, result, arena );
+
+            if ( weight <= 0.0f )
+                break;
+
+            const PoseBuffer additivePose  = allocatePose( arena );
+            const PoseBuffer referencePose = allocatePose( arena );
+
+            evaluateNode( node.children[ 1 ], parameters, additivePose, arena );
+            evaluateNode( node.children[ 2 ], parameters, referencePose, arena );
+
+            const quat identity( 1.0f, 0.0f, 0.0f, 0.0f );
+
+            for ( int i = 0; i < m_boneCount; ++i )
+            {
+                // Difference is defined so that adding it to the reference pose gives the additive pose.
+                const quat   orientationDiff = nlerp( identity, additivePose.orientations[ i ] * quat::conjugate( referencePose.orientations[ i ] ), weight );
+                const float3 translationDiff = additivePose.translations[ i ] - referencePose.translations[ i ];
+                const float3 scaleDiff       = additivePose.scales[ i ] / referencePose.scales[ i ];
+
+                result.orientations[ i ] = orientationDiff * result.orientations[ i ];
+                result.translations[ i ] += translationDiff * weight;
+                result.scales[ i ]       = result.scales[ i ] * ( float3::ONE + ( scaleDiff - float3::ONE ) * weight );
+            }
+
+            arena.release( marker );
+            break;
+        }
+        case NodeType::MaskedLayer:
+        {
+            const float weight = clamp01( parameters[ node.parameters[ 0 ] ] );
+
+            evaluateNode( node.children[ 0 ], parameters, result, arena );
+
+            if ( weight <= 0.0f )
+                break;
+
+            const PoseBuffer layerPose = allocatePose( arena );
+
+            evaluateNode( node.children[ 1 ], parameters, layerPose, arena );
+
+            const float* boneWeights = &m_boneWeights[ node.firstItem ];
+
+            for ( int i = 0; i < m_boneCount; ++i )
+            {
+                const float factor = boneWeights[ i ] * weight;
+                if ( factor <= 0.0f )
+                    continue;
+
+                result.orientations[ i ] = nlerp( result.orientations[ i ], layerPose.orientations[ i ], factor );
+                result.translations[ i ] = result.translations[ i ] + ( layerPose.translations[ i ] - result.translations[ i ] ) * factor;
+                result.scales[ i ]       = result.scales[ i ] + ( layerPose.scales[ i ] - result.scales[ i ] ) * factor;
+            }
+
+            arena.release( marker );
+            break;
+        }
+        case NodeType::BlendSpace1D:
+        {
+            const float             position = parameters[ node.parameters[ 0 ] ];
+            const BlendSpaceSample* samples  = &m_blendSpaceSamples[ node.firstItem ];
+
+            // First sample after the position.
+            int nextIdx = 0;
+            while ( nextIdx < node.itemCount && samples[ nextIdx ].position.x <= position )
+                ++nextIdx;
+
+            if ( nextIdx == 0 || nextIdx == node.itemCount )
+            {
+                // Position is outside of the samples range.
+                evaluateNode( samples[ nextIdx == 0 ? 0 : node.itemCount - 1 ].node, parameters, result, arena );
+                break;
+            }
+
+            const BlendSpaceSample& prevSample = samples[ nextIdx - 1 ];
+            const BlendSpaceSample& nextSample = samples[ nextIdx ];
+
+            const float factor = ( position - prevSample.position.x ) / ( nextSample.position.x - prevSample.position.x );
+
+            evaluateNode( prevSample.node, parameters, result, arena );
+
+            if ( factor > 0.0f )
+                blendChild( nextSample.node, factor );
+
+            break;
+        }
+        case NodeType::BlendSpace2D:
+        {
+            const float2 position( parameters[ node.parameters[ 0 ] ], parameters[ node.parameters[ 1 ] ] );
+
+            float* weights = arena.allocate< float >( node.itemCount );
+            calculateBlendSpaceWeights( node, position, weights );
+
+            const size_t weightsMarker = arena.getMarker();
+
+            // Running blend - each sample is blended with the weight relative to the accumulated weight of the previous ones.
+            float accumulatedWeight = 0.0f;
+            for ( int sampleIdx = 0; sampleIdx < node.itemCount; ++sampleIdx )
+            {
+                if ( weights[ sampleIdx ] <= 0.0f )
+                    continue;
+
+                const int sampleNode = m_blendSpaceSamples[ node.firstItem + sampleIdx ].node;
+
+                accumulatedWeight += weights[ sampleIdx ];
+
+                if ( accumulatedWeight == weights[ sampleIdx ] )
+                {
+                    evaluateNode( sampleNode, parameters, result, arena );
+                }
+                else
+                {
+                    const PoseBuffer samplePose = allocatePose( arena );
+
+                    evaluateNode( sampleNode, parameters, samplePose, arena );
+
+                    const float factor = weights[ sampleIdx ] / accumulatedWeight;
+
+                    SkeletonPoseMath::slerp( result.orientations, samplePose.orientations, factor, result.orientations, m_boneCount );
+                    SkeletonPoseMath::lerp( result.translations, samplePose.translations, factor, result.translations, m_boneCount );
+                    SkeletonPoseMath::lerp( result.scales, samplePose.scales, factor, result.scales, m_boneCount );
+
+                    arena.release( weightsMarker );
+                }
+            }
+
+            arena.release( marker );
+            break;
+        }
+    }
+}
+
+void SkeletonBlendTree::calculateBlendSpaceWeights( const Node& node, const float2& position, float* weights ) const
+{
+    const BlendSpaceSample* samples = &m_blendSpaceSamples[ node.firstItem ];
+
+    float weightSum = 0.0f;
+    for ( int i = 0; i < node.itemCount; ++i )
+    {
+        const float2 toPosition = position - samples[ i ].position;
+
+        // Weight falls off linearly towards each of the other samples.
+        float weight = 1.0f;
+        for ( int j = 0; j < node.itemCount && weight > 0.0f; ++j )
+        {
+            if ( i == j )
+                continue;
+
+            const float2 toSample = samples[ j ].position - samples[ i ].position;
+
+            weight = std::min( weight, clamp01( 1.0f - dot( toPosition, toSample ) / dot( toSample, toSample ) ) );
+        }
+
+        weights[ i ] = weight;
+        weightSum   += weight;
+    }
+
+    if ( weightSum > 0.0f )
+    {
+        for ( int i = 0; i < node.itemCount; ++i )
+            weights[ i ] /= weightSum;
+
+        return;
+    }
+
+    // Fall back to the closest sample (shouldn't happen - there is always a sample with non-zero weight).
+    int closestIdx = 0;
+    for ( int i = 0; i < node.itemCount; ++i )
+    {
+        weights[ i ] = 0.0f;
+
+        const float2 toSample        = position - samples[ i ].position;
+        const float2 toClosestSample = position - samples[ closestIdx ].position;
+
+        if ( dot( toSample, toSample ) < dot( toClosestSample, toClosestSample ) )
+            closestIdx = i;
+    }
+
+    weights[ closestIdx ] = 1.0f;
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+
+#include "SkeletonPose.h"
+#include "float2.h"
+
+namespace Engine1
+{
+    class SkeletonAnimation;
+    class ScratchArena;
+
+    // Graph of operations combining skeleton animations into a single pose - clip sampling, blending, additive and masked layers, blend spaces.
+    // Nodes are evaluated over dense per-bone arrays (indexed by boneIndex - 1) allocated from a scratch arena, so evaluation doesn't allocate memory
+    // once the arena and the result pose have grown to the needed size. All poses produced by the tree contain bones 1 - boneCount.
+    //
+    // All the clips should be in the same space. Additive and masked layers are meant to be used with poses in parent space
+    // (see SkeletonAnimation::calculateAnimationInParentSpace) - result can be converted with SkeletonPose::calculatePoseInSkeletonSpace.
+    //
+    // Nodes can only reference nodes added before them. Node values (progress, factors, weights, positions) are read from the parameters
+    // passed to evaluate, so a single tree can be shared by many characters.
+    class SkeletonBlendTree
+    {
+        public:
+
+        // State of a single character using the tree.
+        struct Instance
+        {
+            Instance( const std::shared_ptr< const SkeletonBlendTree >& tree );
+
+            std::shared_ptr< const SkeletonBlendTree > tree;
+
+            std::vector< float > parameters; // Has tree->getParameterCount() elements.
+            SkeletonPose         pose;       // Result of the last evaluation.
+        };
+
+        // Evaluates the instances in parallel on the JobSystem. Each thread uses its own scratch arena.
+        static void evaluate( std::vector< Instance >& instances );
+
+        // boneCount is usually the bone count of the skeleton mesh.
+        SkeletonBlendTree( const int boneCount );
+        ~SkeletonBlendTree();
+
+        // Each method returns the index of the added node.
+
+        // Samples the animation at the progress (in range 0 - 1) read from the parameter.
+        int addClip( const std::shared_ptr< const SkeletonAnimation >& animation, const int progressParameter );
+
+        // Blends the poses with the factor (in range 0 - 1) read from the parameter. Only one child is evaluated for factor equal to 0 or 1.
+        int addLerp( const int fromNode, const int toNode, const int factorParameter );
+
+        // Adds the difference between the additive and the reference pose (e.g. the first frame of the additive clip) to the base pose, scaled by the weight.
+        int addAdditive( const int baseNode, const int additiveNode, const int referenceNode, const int weightParameter );
+
+        // Blends the layer over the base pose with per-bone weights (indexed by boneIndex - 1) scaled by the weight read from the parameter.
+        int addMaskedLayer( const int baseNode, const int layerNode, const std::vector< float >& boneWeights, const int weightParameter );
+
+        // Blends the two samples surrounding the position read from the parameter. Samples are pairs of position and node.
+        int addBlendSpace1D( std::vector< std::pair< float, int > > samples, const int positionParameter );
+
+        // Blends the samples with weights calculated by gradient band interpolation - each sample has weight 1 at its position
+        // and 0 at the positions of the other samples.
+        int addBlendSpace2D( const std::vector< std::pair< float2, int > >& samples, const int positionXParameter, const int positionYParameter );
+
+        // Root is the last added node by default.
+        void setRootNode( const int node );
+
+        int getBoneCount() const;
+        int getNodeCount() const;
+        int getParameterCount() const;
+
+        // Number of bytes needed in the scratch arena to evaluate the tree.
+        size_t getScratchSize() const;
+
+        // Parameters array has to contain getParameterCount() values. Resets the arena.
+        void evaluate( const float* parameters, SkeletonPose& pose, ScratchArena& arena ) const;
+
+        private:
+
+        enum class NodeType : char
+        {
+            Clip,
+            Lerp,
+            Additive,
+            MaskedLayer,
+            BlendSpace1D,
+            BlendSpace2D
+        };
+
+        struct Node
+        {
+            Node();
+
+            NodeType type;
+
+            int children[ 3 ];   // Used depending on the type (see the add methods).
+            int parameters[ 2 ];
+
+            std::shared_ptr< const SkeletonAnimation > animation;
+
+            int firstItem;  // First bone weight of a masked layer or first sample of a blend space.
+            int itemCount;
+
+            size_t scratchSize; // Bytes of the arena needed to evaluate the node (excluding its result).
+        };
+
+        struct PoseBuffer
+        {
+            quat*   orientations;
+            float3* translations;
+            float3* scales;
+        };
+
+        struct BlendSpaceSample
+        {
+            float2 position;
+            int    node;
+        };
+
+        int addNode( const Node& node );
+
+        void checkNode( const int node ) const;
+        void checkParameter( const int parameter );
+
+        size_t getPoseSize() const;
+
+        PoseBuffer allocatePose( ScratchArena& arena ) const;
+
+        void evaluateNode( const int nodeIndex, const float* parameters, const PoseBuffer& result, ScratchArena& arena ) const;
+
+        // Calculates gradient band weights of the blend space samples (summing to 1) at the position.
+        void calculateBlendSpaceWeights( const Node& node, const float2& position, float* weights ) const;
+
+        int m_boneCount;
+        int m_parameterCount;
+        int m_rootNode;
+
+        std::vector< Node >             m_nodes;
+        std::vector< float >            m_boneWeights;
+        std::vector< BlendSpaceSample > m_blendSpaceSamples;
+
+        // Copying is not allowed.
+        SkeletonBlendTree( const SkeletonBlendTree& ) = delete;
+        SkeletonBlendTree& operator=( const SkeletonBlendTree& ) = delete;
+    };
+}
@@ -0,0 +1,286 @@
+#include "SkeletonBoneBounds.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "SkeletonMesh.h"
+#include "SkeletonPose.h"
+#include "SkeletonSkinning.h"
+
+using namespace Engine1;
+
+namespace
+{
+    const int maxBoneCount = 255;
+
+    // Transforms the box and returns the box bounding the result - using the center and the extents of the box,
+    // instead of transforming all the corners.
+    void transformBox( const float3& boxMin, const float3& boxMax, const float43& transform, float3& resultMin, float3& resultMax )
+    {
+        const float3 center = ( boxMin + boxMax ) * 0.5f;
+        const float3 extent = ( boxMax - boxMin ) * 0.5f;
+
+        const float3 resultCenter = center * transform;
+        const float3 resultExtent(
+            std::abs( transform.m11 ) * extent.x + std::abs( transform.m21 ) * extent.y + std::abs( transform.m31 ) * extent.z,
+            std::abs( transform.m12 ) * extent.x + std::abs( transform.m22 ) * extent.y + std::abs( transform.m32 ) * extent.z,
+            std::abs( transform.m13 ) * extent.x + std::abs( transform.m23 ) * extent.y + std::abs( transform.m33 ) * extent.z
+        );
+
+        resultMin = resultCenter - resultExtent;
+        resultMax = resultCenter + resultExtent;
+    }
+
+    bool isEmptyBox( const float3& boxMin, const float3& boxMax )
+    {
+        return boxMin.x > boxMax.x;
+    }
+
+    bool overlap( const float3& min1, const float3& max1, const float3& min2, const float3& max2 )
+    {
+        return min1.x <= max2.x && max1.x >= min2.x
+            && min1.y <= max2.y && max1.y >= min2.y
+            && min1.z <= max2.z && max1.z >= min2.z;
+    }
+
+    // Returns the distance to the box along the ray (0 if the ray starts inside) or -1 if the ray misses the box.
+    float intersectRayWithBox( const float3& rayOrigin, const float3& rayDirInv, const float3& boxMin, const float3& boxMax )
+    {
+        const float3 t1 = ( boxMin - rayOrigin ) * rayDirInv;
+        const float3 t2 = ( boxMax - rayOrigin ) * rayDirInv;
+
+        const float tmin = std::max( std::max( std::min( t1.x, t2.x ), std::min( t1.y, t2.y ) ), std::min( t1.z, t2.z ) );
+        const float tmax = std::min( std::min( std::max( t1.x, t2.x ), std::max( t1.y, t2.y ) ), std::max( t1.z, t2.z ) );
+
+        if ( tmax < tmin || tmax < 0.0f )
+            return -1.0f;
+
+        return std::max( tmin, 0.0f );
+    }
+}
+
+SkeletonBoneBounds::SkeletonBoneBounds() :
+    m_min( FLT_MAX, FLT_MAX, FLT_MAX ),
+    m_max( -FLT_MAX, -FLT_MAX, -FLT_MAX )
+{}
+
+SkeletonBoneBounds::~SkeletonBoneBounds()
+{}
+
+bool SkeletonBoneBounds::update( const SkeletonMesh& mesh, const SkeletonPose& poseInSkeletonSpace )
+{
+    const std::vector< BoundingBox >&                  boneBoxes            = mesh.getBoneBoundingBoxes();
+    const std::vector< std::vector< unsigned char > >& bonesSharingVertices = mesh.getBonesSharingVertices();
+    const int                                          boneCount            = (int)mesh.getBoneCount();
+
+    if ( boneCount == 0 || (int)boneBoxes.size() != boneCount || (int)bonesSharingVertices.size() != boneCount || poseInSkeletonSpace.getBonesCount() != boneCount || (int)poseInSkeletonSpace.getOrientations().size() != boneCount )
+    {
+        clear();
+        return false;
+    }
+
+    SkeletonSkinning::calculateSkinningMatrices( mesh, poseInSkeletonSpace, m_skinningMatrices );
+
+    m_boneMin.resize( boneCount );
+    m_boneMax.resize( boneCount );
+    m_subtreeMin.resize( boneCount );
+    m_subtreeMax.resize( boneCount );
+
+    m_min = float3( FLT_MAX, FLT_MAX, FLT_MAX );
+    m_max = float3( -FLT_MAX, -FLT_MAX, -FLT_MAX );
+
+    // Boxes of the vertices moved rigidly with each bone - stored temporarily in the subtree boxes.
+    for ( int i = 0; i < boneCount; ++i )
+    {
+        const BoundingBox& boxInBoneSpace = boneBoxes[ i ];
+
+        if ( isEmptyBox( boxInBoneSpace.getMin(), boxInBoneSpace.getMax() ) )
+        {
+            m_subtreeMin[ i ] = boxInBoneSpace.getMin();
+            m_subtreeMax[ i ] = boxInBoneSpace.getMax();
+            continue;
+        }
+
+        // Box is in the bone's bind space - move it to mesh space (bind pose) and then along with the bone.
+        transformBox( boxInBoneSpace.getMin(), boxInBoneSpace.getMax(), mesh.getBone( (unsigned char)( i + 1 ) ).getBindPose() * m_skinningMatrices[ i ], m_subtreeMin[ i ], m_subtreeMax[ i ] );
+    }
+
+    // Blended vertex lies between its positions moved rigidly with each of its bones (weights sum up to 1)
+    // - so the box of a bone has to contain the rigid boxes of all the bones sharing vertices with it.
+    for ( int i = 0; i < boneCount; ++i )
+    {
+        m_boneMin[ i ] = m_subtreeMin[ i ];
+        m_boneMax[ i ] = m_subtreeMax[ i ];
+
+        if ( isEmptyBox( m_boneMin[ i ], m_boneMax[ i ] ) )
+            continue;
+
+        for ( const unsigned char otherBoneIndex : bonesSharingVertices[ i ] )
+        {
+            m_boneMin[ i ] = min( m_boneMin[ i ], m_subtreeMin[ otherBoneIndex - 1 ] );
+            m_boneMax[ i ] = max( m_boneMax[ i ], m_subtreeMax[ otherBoneIndex - 1 ] );
+        }
+
+        m_min = min( m_min, m_boneMin[ i ] );
+        m_max = max( m_max, m_boneMax[ i ] );
+    }
+
+    // Subtree boxes are accumulated from the leaves up - children come after their parents in the hierarchy order.
+    const std::vector< unsigned char >& parentBoneIndices     = mesh.getParentBoneIndices();
+    const std::vector< unsigned char >& bonesInHierarchyOrder = mesh.getBonesInHierarchyOrder();
+
+    m_subtreeMin = m_boneMin;
+    m_subtreeMax = m_boneMax;
+
+    m_rootBones.clear();
+    m_firstChildBones.assign( boneCount, 0 );
+    m_nextSiblingBones.assign( boneCount, 0 );
+
+    for ( auto it = bonesInHierarchyOrder.rbegin(); it != bonesInHierarchyOrder.rend(); ++it )
+    {
+        const unsigned char boneIndex       = *it;
+        const unsigned char parentBoneIndex = parentBoneIndices[ boneIndex - 1 ];
+
+        if ( parentBoneIndex == 0 )
+        {
+            m_rootBones.push_back( boneIndex );
+            continue;
+        }
+
+        m_subtreeMin[ parentBoneIndex - 1 ] = min( m_subtreeMin[ parentBoneIndex - 1 ], m_subtreeMin[ boneIndex - 1 ] );
+        m_subtreeMax[ parentBoneIndex - 1 ] = max( m_subtreeMax[ parentBoneIndex - 1 ], m_subtreeMax[ boneIndex - 1 ] );
+
+        m_nextSiblingBones[ boneIndex - 1 ]      = m_firstChildBones[ parentBoneIndex - 1 ];
+        m_firstChildBones[ parentBoneIndex - 1 ] = boneIndex;
+    }
+
+    return true;
+}
+
+void SkeletonBoneBounds::clear()
+{
+    m_boneMin.clear();
+    m_boneMax.clear();
+    m_subtreeMin.clear();
+    m_subtreeMax.clear();
+    m_rootBones.clear();
+    m_firstChildBones.clear();
+    m_nextSiblingBones.clear();
+
+    m_min = float3( FLT_MAX, FLT_MAX, FLT_MAX );
+    m_max = float3( -FLT_MAX, -FLT_MAX, -FLT_MAX );
+}
+
+bool SkeletonBoneBounds::isEmpty() const
+{
+    return isEmptyBox( m_min, m_max );
+}
+
+BoundingBox SkeletonBoneBounds::getBoundingBox() const
+{
+    return BoundingBox( m_min, m_max );
+}
+
+BoundingBox SkeletonBoneBounds::getBoneBoundingBox( const unsigned char boneIndex ) const
+{
+    if ( boneIndex == 0 || boneIndex > m_boneMin.size() ) throw std::exception( "SkeletonBoneBounds::getBoneBoundingBox - there is no bone with such index." );
+
+    return BoundingBox( m_boneMin[ boneIndex - 1 ], m_boneMax[ boneIndex - 1 ] );
+}
+
+std::tuple< bool, float, unsigned char > SkeletonBoneBounds::intersectRay( const float3& rayOrigin, const float3& rayDir, const float maxDistance ) const
+{
+    bool          hit          = false;
+    float         hitDistance  = maxDistance;
+    unsigned char hitBoneIndex = 0;
+
+    if ( isEmpty() )
+        return std::make_tuple( false, 0.0f, (unsigned char)0 );
+
+    const float3 rayDirInv( 1.0f / rayDir.x, 1.0f / rayDir.y, 1.0f / rayDir.z );
+
+    const float meshDistance = intersectRayWithBox( rayOrigin, rayDirInv, m_min, m_max );
+    if ( meshDistance < 0.0f || meshDistance > hitDistance )
+        return std::make_tuple( false, 0.0f, (unsigned char)0 );
+
+    unsigned char stack[ maxBoneCount ];
+    int           stackSize = 0;
+
+    for ( const unsigned char boneIndex : m_rootBones )
+        stack[ stackSize++ ] = boneIndex;
+
+    while ( stackSize > 0 )
+    {
+        const unsigned char boneIndex = stack[ --stackSize ];
+        const int           i         = boneIndex - 1;
+
+        // Skip the whole subtree if the ray misses it or hits it further than the closest hit so far.
+        const float subtreeDistance = intersectRayWithBox( rayOrigin, rayDirInv, m_subtreeMin[ i ], m_subtreeMax[ i ] );
+        if ( subtreeDistance < 0.0f || subtreeDistance > hitDistance )
+            continue;
+
+        if ( !isEmptyBox( m_boneMin[ i ], m_boneMax[ i ] ) )
+        {
+            const float boneDistance = intersectRayWithBox( rayOrigin, rayDirInv, m_boneMin[ i ], m_boneMax[ i ] );
+            if ( boneDistance >= 0.0f && boneDistance <= hitDistance )
+            {
+                hit          = true;
+                hitDistance  = boneDistance;
+                hitBoneIndex = boneIndex;
+            }
+        }
+
+        for ( unsigned char childBoneIndex = m_firstChildBones[ i ]; childBoneIndex != 0; childBoneIndex = m_nextSiblingBones[ childBoneIndex - 1 ] )
+            stack[ stackSize++ ] = childBoneIndex;
+    }
+
+    if ( !hit )
+        return std::make_tuple( false, 0.0f, (unsigned char)0 );
+
+    return std::make_tuple( true, hitDistance, hitBoneIndex );
+}
+
+bool SkeletonBoneBounds::intersects( const BoundingBox& boxInWorldSpace, const float43& pose ) const
+{
+    if ( isEmpty() )
+        return false;
+
+    const float3 worldMin = boxInWorldSpace.getMin();
+    const float3 worldMax = boxInWorldSpace.getMax();
+
+    float3 boxMin, boxMax;
+    transformBox( m_min, m_max, pose, boxMin, boxMax );
+
+    if ( !overlap( boxMin, boxMax, worldMin, worldMax ) )
+        return false;
+
+    unsigned char stack[ maxBoneCount ];
+    int           stackSize = 0;
+
+    for ( const unsigned char boneIndex : m_rootBones )
+        stack[ stackSize++ ] = boneIndex;
+
+    while ( stackSize > 0 )
+    {
+        const int i = stack[ --stackSize ] - 1;
+
+        if ( isEmptyBox( m_subtreeMin[ i ], m_subtreeMax[ i ] ) )
+            continue;
+
+        transformBox( m_subtreeMin[ i ], m_subtreeMax[ i ], pose, boxMin, boxMax );
+        if ( !overlap( boxMin, boxMax, worldMin, worldMax ) )
+            continue;
+
+        if ( !isEmptyBox( m_boneMin[ i ], m_boneMax[ i ] ) )
+        {
+            transformBox( m_boneMin[ i ], m_boneMax[ i ], pose, boxMin, boxMax );
+            if ( overlap( boxMin, boxMax, worldMin, worldMax ) )
+                return true;
+        }
+
+        for ( unsigned char childBoneIndex = m_firstChildBones[ i ]; childBoneIndex != 0; childBoneIndex = m_nextSiblingBones[ childBoneIndex - 1 ] )
+            stack[ stackSize++ ] = childBoneIndex;
+    }
+
+    return false;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+#include <tuple>
+#include <float.h>
+
+#include "float3.h"
+#include "float43.h"
+#include "BoundingBox.h"
+
+namespace Engine1
+{
+    class SkeletonMesh;
+    class SkeletonPose;
+
+    // Bounding boxes of the bones of a skeleton mesh in a given pose (in mesh space) - calculated from the bone bounding boxes
+    // precomputed by the mesh, transformed by the skinning matrices. Each box contains all the linear-blend skinned vertices
+    // attached to the bone (with weights summing up to 1) - the box of a bone is extended by the boxes of the bones sharing vertices with it,
+    // because a blended vertex lies between the positions it would have if attached rigidly to each of its bones.
+    //
+    // Skeleton hierarchy serves as a BVH - each bone also stores the box of its whole subtree,
+    // so ray and volume queries skip the limbs they don't touch.
+    class SkeletonBoneBounds
+    {
+        public:
+
+        SkeletonBoneBounds();
+        ~SkeletonBoneBounds();
+
+        // Returns false (and clears the bounds) if the mesh has no bone bounding boxes or the pose doesn't contain all the bones of the mesh.
+        // Doesn't allocate memory when updated again for a mesh with the same bone count.
+        bool update( const SkeletonMesh& mesh, const SkeletonPose& poseInSkeletonSpace );
+
+        void clear();
+
+        bool isEmpty() const;
+
+        // Box containing all the bone boxes.
+        BoundingBox getBoundingBox() const;
+
+        // Box of a single bone (boneIndex is in range 1 - 255). Empty (min > max) for bones without vertices.
+        BoundingBox getBoneBoundingBox( const unsigned char boneIndex ) const;
+
+        // Finds the closest bone box hit by the ray (in mesh space). Returns ( hit, distance, boneIndex ).
+        std::tuple< bool, float, unsigned char > intersectRay( const float3& rayOrigin, const float3& rayDir, const float maxDistance = FLT_MAX ) const;
+
+        // Checks if any of the bone boxes - placed in world space with the given pose - intersects the world space box.
+        bool intersects( const BoundingBox& boxInWorldSpace, const float43& pose ) const;
+
+        private:
+
+        std::vector< float43 > m_skinningMatrices;
+
+        // Indexed by boneIndex - 1.
+        std::vector< float3 > m_boneMin;
+        std::vector< float3 > m_boneMax;
+        std::vector< float3 > m_subtreeMin;
+        std::vector< float3 > m_subtreeMax;
+
+        // Skeleton hierarchy - bone indices, 0 means no bone.
+        std::vector< unsigned char > m_rootBones;
+        std::vector< unsigned char > m_firstChildBones;
+        std::vector< unsigned char > m_nextSiblingBones;
+
+        float3 m_min;
+        float3 m_max;
+    };
+}
@@ -80,7 +80,8 @@ std::vector< std::shared_ptr<SkeletonMesh> > SkeletonMesh::createFromMemory( std
 }
 
 SkeletonMesh::SkeletonMesh() :
-bonesPerVertexCount( BonesPerVertexCount::Type::ZERO )
+bonesPerVertexCount( BonesPerVertexCount::Type::ZERO ),
+m_isBoneHierarchyDirty( false )
 {}
 
 SkeletonMesh::~SkeletonMesh() 
@@ -617,6 +618,15 @@ BonesPerVertexCount::Type SkeletonMesh::getBonesPerVertexCount( ) const
 	return bonesPerVertexCount;
 }
 
+void SkeletonMesh::setBonesPerVertexCount( const BonesPerVertexCount::Type bonesPerVertexCount )
+{
+	this->bonesPerVertexCount = bonesPerVertexCount;
+
+	const int count = (int)m_vertices.size() * static_cast<int>( bonesPerVertexCount );
+	m_vertexBones.assign( count, 0 );
+	m_vertexWeights.assign( count, 0.0f );
+}
+
 SkeletonMesh::Bone::Bone() :
 	name( "" ),
 	parentBoneIndex( 0 )
@@ -660,6 +670,8 @@ void SkeletonMesh::addOrModifyBone( const unsigned char boneIndex, const std::st
 
 	// Assign the bone.
 	m_bones.at( boneIndex - 1 ) = Bone( name, parentBoneIndex, bindPose );
+
+	m_isBoneHierarchyDirty = true;
 }
 
 void SkeletonMesh::addOrModifyBone( const unsigned char boneIndex, const std::string& name, const unsigned char parentBoneIndex, const float43& bindPose, const float43& bindPoseInv )
@@ -683,6 +695,8 @@ void SkeletonMesh::addOrModifyBone( const unsigned char boneIndex, const std::st
 
 	// Assign the bone.
 	m_bones.at( boneIndex - 1 ) = Bone( name, parentBoneIndex, bindPose, bindPoseInv );
+
+	m_isBoneHierarchyDirty = true;
 }
 
 unsigned char SkeletonMesh::getBoneIndex( const std::string& name ) const
@@ -717,12 +731,124 @@ const SkeletonMesh::Bone& SkeletonMesh::getBone( unsigned char index ) const
 	return m_bones.at( index - 1 );
 }
 
+const std::vector< unsigned char >& SkeletonMesh::getBonesInHierarchyOrder() const
+{
+	if ( m_isBoneHierarchyDirty )
+		updateBoneHierarchy();
+
+	return m_bonesInHierarchyOrder;
+}
+
+const std::vector< unsigned char >& SkeletonMesh::getParentBoneIndices() const
+{
+	if ( m_isBoneHierarchyDirty )
+		updateBoneHierarchy();
+
+	return m_parentBoneIndices;
+}
+
+void SkeletonMesh::updateBoneHierarchy() const
+{
+	const int boneCount = (int)m_bones.size();
+
+	m_parentBoneIndices.resize( boneCount );
+	for ( int i = 0; i < boneCount; ++i ) {
+		const unsigned char parentBoneIndex = m_bones[ i ].getParentBoneIndex();
+
+		// Bones with missing parents are treated as roots.
+		m_parentBoneIndices[ i ] = parentBoneIndex <= boneCount ? parentBoneIndex : 0;
+	}
+
+	// Group bones by parent (counting sort) - children of bone i are children[ childrenStart[ i ] ... childrenStart[ i + 1 ] ).
+	std::vector< int >           childrenStart( boneCount + 2, 0 );
+	std::vector< unsigned char > children( boneCount );
+
+	for ( int i = 0; i < boneCount; ++i )
+		++childrenStart[ m_parentBoneIndices[ i ] + 1 ];
+
+	for ( int i = 1; i <= boneCount + 1; ++i )
+		childrenStart[ i ] += childrenStart[ i - 1 ];
+
+	std::vector< int > childrenEnd( childrenStart.begin(), childrenStart.end() - 1 );
+	for ( int i = 0; i < boneCount; ++i )
+		children[ childrenEnd[ m_parentBoneIndices[ i ] ]++ ] = (unsigned char)( i + 1 );
+
+	// Breadth-first traversal from the roots (children of "bone 0") - each bone is visited after its parent.
+	m_bonesInHierarchyOrder.assign( children.begin() + childrenStart[ 0 ], children.begin() + childrenStart[ 1 ] );
+	m_bonesInHierarchyOrder.reserve( boneCount );
+
+	for ( size_t orderIndex = 0; orderIndex < m_bonesInHierarchyOrder.size(); ++orderIndex ) {
+		const unsigned char parentBoneIndex = m_bonesInHierarchyOrder[ orderIndex ];
+
+		m_bonesInHierarchyOrder.insert( m_bonesInHierarchyOrder.end(), children.begin() + childrenStart[ parentBoneIndex ], children.begin() + childrenStart[ parentBoneIndex + 1 ] );
+	}
+
+	// Bones in cycles are unreachable from the roots - they can't be ordered and are not evaluated.
+
+	m_isBoneHierarchyDirty = false;
+}
+
 void SkeletonMesh::recalculateBoundingBox()
 {
     m_boundingBox = MathUtil::calculateBoundingBox( m_vertices );
+
+    const int boneCount      = (int)m_bones.size();
+    const int bonesPerVertex = static_cast< int >( bonesPerVertexCount );
+
+    std::vector< float3 > boneMin( boneCount, float3( FLT_MAX, FLT_MAX, FLT_MAX ) );
+    std::vector< float3 > boneMax( boneCount, float3( -FLT_MAX, -FLT_MAX, -FLT_MAX ) );
+
+    // Which bones share a vertex (boneCount x boneCount, indexed by boneIndex - 1).
+    std::vector< bool > isSharingVertices( boneCount * boneCount, false );
+
+    if ( bonesPerVertex > 0 && m_vertexBones.size() >= m_vertices.size() * bonesPerVertex && m_vertexWeights.size() >= m_vertices.size() * bonesPerVertex ) {
+        for ( size_t vertexIndex = 0; vertexIndex < m_vertices.size(); ++vertexIndex ) {
+            for ( int i = 0; i < bonesPerVertex; ++i ) {
+                const unsigned char boneIndex = m_vertexBones[ vertexIndex * bonesPerVertex + i ];
+                if ( boneIndex == 0 || boneIndex > boneCount || m_vertexWeights[ vertexIndex * bonesPerVertex + i ] <= 0.0f )
+                    continue;
+
+                const float3 vertexInBoneSpace = m_vertices[ vertexIndex ] * m_bones[ boneIndex - 1 ].bindPoseInv;
+
+                boneMin[ boneIndex - 1 ] = min( boneMin[ boneIndex - 1 ], vertexInBoneSpace );
+                boneMax[ boneIndex - 1 ] = max( boneMax[ boneIndex - 1 ], vertexInBoneSpace );
+
+                for ( int j = 0; j < i; ++j ) {
+                    const unsigned char otherBoneIndex = m_vertexBones[ vertexIndex * bonesPerVertex + j ];
+                    if ( otherBoneIndex == 0 || otherBoneIndex > boneCount || otherBoneIndex == boneIndex || m_vertexWeights[ vertexIndex * bonesPerVertex + j ] <= 0.0f )
+                        continue;
+
+                    isSharingVertices[ ( boneIndex - 1 ) * boneCount + otherBoneIndex - 1 ] = true;
+                    isSharingVertices[ ( otherBoneIndex - 1 ) * boneCount + boneIndex - 1 ] = true;
+                }
+            }
+        }
+    }
+
+    m_boneBoundingBoxes.clear();
+    for ( int i = 0; i < boneCount; ++i )
+        m_boneBoundingBoxes.push_back( BoundingBox( boneMin[ i ], boneMax[ i ] ) );
+
+    m_bonesSharingVertices.assign( boneCount, std::vector< unsigned char >() );
+    for ( int i = 0; i < boneCount; ++i ) {
+        for ( int j = 0; j < boneCount; ++j ) {
+            if ( isSharingVertices[ i * boneCount + j ] )
+                m_bonesSharingVertices[ i ].push_back( (unsigned char)( j + 1 ) );
+        }
+    }
 }
 
 BoundingBox SkeletonMesh::getBoundingBox() const
 {
     return m_boundingBox;
 }
+
+const std::vector< BoundingBox >& SkeletonMesh::getBoneBoundingBoxes() const
+{
+    return m_boneBoundingBoxes;
+}
+
+const std::vector< std::vector< unsigned char > >& SkeletonMesh::getBonesSharingVertices() const
+{
+    return m_bonesSharingVertices;
+}
@@ -111,6 +111,9 @@ namespace Engine1
         unsigned char             getBoneCount() const;
         BonesPerVertexCount::Type getBonesPerVertexCount() const;
 
+        // Detaches all the vertices from bones and allocates (zeroed) bone slots for each vertex.
+        void setBonesPerVertexCount( const BonesPerVertexCount::Type bonesPerVertexCount );
+
         void addOrModifyBone( const unsigned char boneIndex, const std::string& name, const unsigned char parentBoneIndex, const float43& bindPose );
         void addOrModifyBone( const unsigned char boneIndex, const std::string& name, const unsigned char parentBoneIndex, const float43& bindPose, const float43& bindPoseInv );
 
@@ -123,10 +126,25 @@ namespace Engine1
         const Bone& getBone( const std::string& name ) const;
         const Bone& getBone( unsigned char index ) const;
 
+        // Bone indices ordered so that each bone comes after its parent (root bones first).
+        // Allows to calculate poses of all the bones in a single pass over the hierarchy.
+        const std::vector< unsigned char >& getBonesInHierarchyOrder() const;
+
+        // Parent bone index of each bone (indexed by boneIndex - 1). 0 means that the bone is a root.
+        const std::vector< unsigned char >& getParentBoneIndices() const;
+
+        // Recalculates the bounding box and the bounding boxes of the bones.
         void recalculateBoundingBox();
         // Returns <min, max> of the bounding box.
         BoundingBox getBoundingBox() const;
 
+        // Bounding boxes of the vertices attached to each bone (indexed by boneIndex - 1), in the bone's bind space (vertex * bindPoseInv).
+        // Boxes of bones without any attached vertices are empty (min > max).
+        const std::vector< BoundingBox >& getBoneBoundingBoxes() const;
+
+        // Bones which share at least one vertex with the given bone (indexed by boneIndex - 1) - calculated along with the bone bounding boxes.
+        const std::vector< std::vector< unsigned char > >& getBonesSharingVertices() const;
+
         private:
 
         SkeletonMeshFileInfo m_fileInfo;
@@ -152,8 +170,19 @@ namespace Engine1
 
         std::vector< Bone > m_bones;
 
+        // Built on first use after bones have been added or modified (importing n bones would be O(n^2) otherwise).
+        // Note: Not thread-safe until built - importers build it once all the bones are added.
+        mutable std::vector< unsigned char > m_bonesInHierarchyOrder;
+        mutable std::vector< unsigned char > m_parentBoneIndices;
+        mutable bool                         m_isBoneHierarchyDirty;
+
+        void updateBoneHierarchy() const;
+
         BoundingBox m_boundingBox;
 
+        std::vector< BoundingBox >                  m_boneBoundingBoxes;
+        std::vector< std::vector< unsigned char > > m_bonesSharingVertices;
+
         // Copying mesh in not allowed.
         SkeletonMesh( const SkeletonMesh& ) = delete;
         SkeletonMesh& operator=(const SkeletonMesh&) = delete;
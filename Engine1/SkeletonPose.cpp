@@ -1,13 +1,35 @@
 #include "SkeletonPose.h"
 
 #include <string>
+#include <algorithm>
 
 #include "SkeletonMesh.h"
+#include "SkeletonPoseMath.h"
 
 #include "MathUtil.h"
+#include "float33.h"
 
 using namespace Engine1;
 
+namespace
+{
+    const quat identityOrientation( 1.0f, 0.0f, 0.0f, 0.0f );
+
+    // Rotates the vector the same way as multiplying it by float43( orientation ) does.
+    float3 rotate( const quat& orientation, const float3& vec )
+    {
+        const float3 axis( orientation.x, orientation.y, orientation.z );
+        const float3 temp = cross( axis, vec ) * 2.0f;
+
+        return vec + temp * orientation.w + cross( axis, temp );
+    }
+
+    quat conjugate( const quat& orientation )
+    {
+        return quat( orientation.w, -orientation.x, -orientation.y, -orientation.z );
+    }
+}
+
 SkeletonPose SkeletonPose::createIdentityPoseInSkeletonSpace( const SkeletonMesh& skeletonMesh )
 {
     return calculatePoseInSkeletonSpace( createIdentityPoseInParentSpace( skeletonMesh ), skeletonMesh );
@@ -18,7 +40,7 @@ SkeletonPose SkeletonPose::createIdentityPoseInParentSpace( const SkeletonMesh&
     SkeletonPose poseInParentSpace;
     const unsigned char boneCount = skeletonMesh.getBoneCount();
     for ( unsigned char boneIndex = 1; boneIndex <= boneCount; ++boneIndex )
-        poseInParentSpace.setBonePose( boneIndex, float43::IDENTITY );
+        poseInParentSpace.setBonePose( boneIndex, identityOrientation, float3::ZERO, float3::ONE );
 
     return poseInParentSpace;
 }
@@ -27,182 +49,292 @@ SkeletonPose SkeletonPose::blendPoses( const SkeletonPose& pose1, const Skeleton
 {
 	SkeletonPose combinedPose;
 
-	// Iterate over bones from pose 1 and combine them with bones from pose 2.
-	for ( const std::pair<unsigned char, float43>& boneFromPose1 : pose1.bonesPoses ) {
-		const unsigned char boneIndex = boneFromPose1.first;
+	const int arraySize = (int)std::max( pose1.m_orientations.size(), pose2.m_orientations.size() );
+	if ( arraySize == 0 )
+		return combinedPose;
 
-		if ( pose2.hasBone( boneIndex ) ) { // Bone is present in both poses.
+	combinedPose.reserveBone( (unsigned char)arraySize );
 
-			const float43& bonePose1 = pose1.getBonePose( boneIndex );
-			const float43& bonePose2 = pose2.getBonePose( boneIndex );
+	// Poses sampled from the same animation contain the same bones - blend whole arrays with the batched kernels.
+	if ( pose1.m_presentBones == pose2.m_presentBones && pose1.m_orientations.size() == pose2.m_orientations.size() ) {
+		SkeletonPoseMath::slerp( pose1.m_orientations.data(), pose2.m_orientations.data(), factor, combinedPose.m_orientations.data(), arraySize );
+		SkeletonPoseMath::lerp( pose1.m_translations.data(), pose2.m_translations.data(), factor, combinedPose.m_translations.data(), arraySize );
+		SkeletonPoseMath::lerp( pose1.m_scales.data(), pose2.m_scales.data(), factor, combinedPose.m_scales.data(), arraySize );
 
-			// Blend poses.
-			const float43 combinedBonePose = float43::slerp( bonePose1, bonePose2, factor );
+		combinedPose.m_presentBones = pose1.m_presentBones;
+		combinedPose.m_boneCount    = pose1.m_boneCount;
 
-			// Save combined pose.
-			combinedPose.setBonePose( boneIndex, combinedBonePose );
-		}
+		return combinedPose;
 	}
 
-	// Iterate over bones from pose 1 and add those which are not present in the combined pose.
-	for ( const std::pair<unsigned char, float43>& boneFromPose1 : pose1.bonesPoses ) {
-		const unsigned char boneIndex = boneFromPose1.first;
-
-		if ( !combinedPose.hasBone( boneIndex ) ) { // Bone is not present in the combined pose.
-			// Save bone from pose 1.
-			combinedPose.setBonePose( boneIndex, boneFromPose1.second );
+	// Single pass over the bones - blend bones present in both poses, copy bones present in one of them.
+	for ( int i = 0; i < arraySize; ++i ) {
+		const unsigned char boneIndex = (unsigned char)( i + 1 );
+
+		const bool inPose1 = pose1.hasBone( boneIndex );
+		const bool inPose2 = pose2.hasBone( boneIndex );
+
+		if ( inPose1 && inPose2 ) {
+			combinedPose.m_orientations[ i ] = quat::slerp( pose1.m_orientations[ i ], pose2.m_orientations[ i ], factor );
+			combinedPose.m_translations[ i ] = pose1.m_translations[ i ] * ( 1.0f - factor ) + pose2.m_translations[ i ] * factor;
+			combinedPose.m_scales[ i ]       = pose1.m_scales[ i ] * ( 1.0f - factor ) + pose2.m_scales[ i ] * factor;
+		} else if ( inPose1 || inPose2 ) {
+			const SkeletonPose& sourcePose = inPose1 ? pose1 : pose2;
+
+			combinedPose.m_orientations[ i ] = sourcePose.m_orientations[ i ];
+			combinedPose.m_translations[ i ] = sourcePose.m_translations[ i ];
+			combinedPose.m_scales[ i ]       = sourcePose.m_scales[ i ];
+		} else {
+			continue;
 		}
-	}
 
-	// Iterate over bones from pose 2 and add those which are not present in the combined pose.
-	for ( const std::pair<unsigned char, float43>& boneFromPose2 : pose2.bonesPoses ) {
-		const unsigned char boneIndex = boneFromPose2.first;
-
-		if ( !combinedPose.hasBone( boneIndex ) ) { // Bone is not present in the combined pose.
-			// Save bone from pose 2.
-			combinedPose.setBonePose( boneIndex, boneFromPose2.second );
-		}
+		combinedPose.markBonePresent( boneIndex );
 	}
 
 	return combinedPose;
 }
 
 SkeletonPose SkeletonPose::calculatePoseInSkeletonSpace( const SkeletonPose& poseInParentSpace, const SkeletonMesh& skeletonMesh ) {
-	SkeletonPose poseInSkeletonSpace;
+	const std::vector< unsigned char >& parentBoneIndices = skeletonMesh.getParentBoneIndices();
+	const int                           arraySize         = (int)poseInParentSpace.m_orientations.size();
 
 	// Check if pose in parent space contains also parent bones for all the bones. Otherwise, calculating pose in skeleton space is impossible.
-	for ( std::pair<unsigned char, float43> bone : poseInParentSpace.bonesPoses ) {
-		unsigned char parentBoneIndex = skeletonMesh.getBone( bone.first ).getParentBoneIndex( );
+	for ( int i = 0; i < arraySize; ++i ) {
+		const unsigned char boneIndex = (unsigned char)( i + 1 );
+		if ( !poseInParentSpace.hasBone( boneIndex ) )
+			continue;
+
+		if ( i >= (int)parentBoneIndices.size() ) throw std::exception( ( std::string( "SkeletonPose::calculatePoseInSkeletonSpace - pose contains a bone which doesn't exist in the skeleton (bone " ) + std::to_string( boneIndex ) + std::string( ")" ) ).c_str() );
+
+		unsigned char parentBoneIndex = parentBoneIndices[ i ];
 		if ( parentBoneIndex != 0 && !poseInParentSpace.hasBone( parentBoneIndex ) ) throw std::exception( ( std::string( "SkeletonPose::calculatePoseInSkeletonSpace - cannot calculate pose in skeleton space, because parent pose is not known for some bones (for bone" ) + std::to_string( parentBoneIndex ) + std::string( ")" ) ).c_str( ) );
 	}
 
-	unsigned char boneIndex = 1;
-	while ( poseInSkeletonSpace.getBonesCount( ) < poseInParentSpace.getBonesCount() ) { // Iterate the bones until they are all calculated.
-	
-		if ( !poseInSkeletonSpace.hasBone( boneIndex ) ) {							 // If the bone hasn't yet been calculated.
-			unsigned char parentBoneIndex = skeletonMesh.getBone( boneIndex ).getParentBoneIndex();
-			if ( parentBoneIndex == 0 ) {											 // And it has no parent (is a root bone)
-	
-				float43 bonePoseInParentSpace = poseInParentSpace.getBonePose( boneIndex );
-	
-				// Root bone's pose in skeleton space is the same as it's pose in parent space
-				float43 bonePoseInSkeletonSpace = bonePoseInParentSpace;
-
-				// Save bone's pose in skeleton space.
-				poseInSkeletonSpace.setBonePose( boneIndex, bonePoseInSkeletonSpace );
-
-			} else if ( poseInSkeletonSpace.hasBone( parentBoneIndex ) ) {		     // But it's parent has already been calculated (otherwise, we cannot calculate that bone yet).
-				float43 parentBonePoseInSkeletonSpace = poseInSkeletonSpace.getBonePose( parentBoneIndex );
-				float43 bonePoseInParentSpace = poseInParentSpace.getBonePose( boneIndex );
-	
-				// Calculate bone's pose in skeleton space
-				float43 bonePoseInSkeletonSpace = bonePoseInParentSpace * parentBonePoseInSkeletonSpace;
-
-				// Save bone's pose in skeleton space.
-				poseInSkeletonSpace.setBonePose( boneIndex, bonePoseInSkeletonSpace );
-			}
+	SkeletonPose poseInSkeletonSpace;
+	if ( arraySize == 0 )
+		return poseInSkeletonSpace;
+
+	poseInSkeletonSpace.reserveBone( (unsigned char)arraySize );
+
+	const quat*   localOrientations = poseInParentSpace.m_orientations.data();
+	const float3* localTranslations = poseInParentSpace.m_translations.data();
+	const float3* localScales       = poseInParentSpace.m_scales.data();
+	quat*         orientations      = poseInSkeletonSpace.m_orientations.data();
+	float3*       translations      = poseInSkeletonSpace.m_translations.data();
+	float3*       scales            = poseInSkeletonSpace.m_scales.data();
+
+	// Parents are always visited before their children - their poses in skeleton space are already known.
+	for ( const unsigned char boneIndex : skeletonMesh.getBonesInHierarchyOrder() ) {
+		const int i = boneIndex - 1;
+		if ( i >= arraySize || !poseInParentSpace.hasBone( boneIndex ) )
+			continue;
+
+		const unsigned char parentBoneIndex = parentBoneIndices[ i ];
+		if ( parentBoneIndex == 0 ) {
+			// Root bone's pose in skeleton space is the same as it's pose in parent space
+			orientations[ i ] = localOrientations[ i ];
+			translations[ i ] = localTranslations[ i ];
+			scales[ i ]       = localScales[ i ];
+		} else {
+			const int p = parentBoneIndex - 1;
+
+			// Bone's pose in skeleton space = bone's pose in parent space * parent's pose in skeleton space.
+			orientations[ i ] = localOrientations[ i ] * orientations[ p ];
+			translations[ i ] = rotate( orientations[ p ], localTranslations[ i ] * scales[ p ] ) + translations[ p ];
+			scales[ i ]       = localScales[ i ] * scales[ p ];
 		}
-	
-											
-		if ( !poseInParentSpace.hasBone( boneIndex ) ) boneIndex = 0;		// If reached the last bone, itarate the bones again.
-		else ++boneIndex;													// Otherwise, go to the next bone.
+
+		poseInSkeletonSpace.markBonePresent( boneIndex );
 	}
 
 	return poseInSkeletonSpace;
 }
 
 SkeletonPose SkeletonPose::calculatePoseInParentSpace( const SkeletonPose& poseInSkeletonSpace, const SkeletonMesh& skeletonMesh ) {
+	const std::vector< unsigned char >& parentBoneIndices = skeletonMesh.getParentBoneIndices();
+	const int                           arraySize         = (int)poseInSkeletonSpace.m_orientations.size();
+
 	SkeletonPose poseInParentSpace;
+	if ( arraySize == 0 )
+		return poseInParentSpace;
+
+	poseInParentSpace.reserveBone( (unsigned char)arraySize );
+
+	for ( int i = 0; i < arraySize; ++i ) {
+		const unsigned char boneIndex = (unsigned char)( i + 1 );
+		if ( !poseInSkeletonSpace.hasBone( boneIndex ) )
+			continue;
+
+		if ( i >= (int)parentBoneIndices.size() ) throw std::exception( ( std::string( "SkeletonPose::calculatePoseInParentSpace - pose contains a bone which doesn't exist in the skeleton (bone " ) + std::to_string( boneIndex ) + std::string( ")" ) ).c_str() );
+
+		const unsigned char parentBoneIndex = parentBoneIndices[ i ];
 
-	
-	for ( std::pair<unsigned char, float43> bone : poseInSkeletonSpace.bonesPoses ) {
-		unsigned char parentBoneIndex = skeletonMesh.getBone( bone.first ).getParentBoneIndex( );
-		
 		if ( parentBoneIndex != 0 ) { // If bone is not the root.
-			
-			float44 bonePoseInSkeletonSpace( bone.second );
-			float43 bonePoseInParentSpace;
-			
 			// Calculate pose in parent space only for bones for which parent pose is also available.
-			if ( poseInSkeletonSpace.hasBone( parentBoneIndex ) ) {
-				float44 parentBonePoseInSkeletonSpace = poseInSkeletonSpace.getBonePose( parentBoneIndex );
+			if ( !poseInSkeletonSpace.hasBone( parentBoneIndex ) )
+				continue;
 
-				// Calculate bone's pose in parent space
-				bonePoseInParentSpace = ( bonePoseInSkeletonSpace * parentBonePoseInSkeletonSpace.getScaleOrientationTranslationInverse( ) ).getOrientationTranslation( );
+			const int    p                 = parentBoneIndex - 1;
+			const quat   parentOrientation = poseInSkeletonSpace.m_orientations[ p ];
+			const float3 parentScale       = poseInSkeletonSpace.m_scales[ p ];
 
-				// Safe bone's pose in parent space.
-				poseInParentSpace.setBonePose( bone.first, bonePoseInParentSpace );
-			}
+			// Invert: bone's pose in skeleton space = bone's pose in parent space * parent's pose in skeleton space.
+			poseInParentSpace.m_orientations[ i ] = poseInSkeletonSpace.m_orientations[ i ] * conjugate( parentOrientation );
+			poseInParentSpace.m_translations[ i ] = rotate( conjugate( parentOrientation ), poseInSkeletonSpace.m_translations[ i ] - poseInSkeletonSpace.m_translations[ p ] ) / parentScale;
+			poseInParentSpace.m_scales[ i ]       = poseInSkeletonSpace.m_scales[ i ] / parentScale;
 		} else { // If bone is the root.
-			// Safe bone's pose in parent space - same as in skeleton space.
-			poseInParentSpace.setBonePose( bone.first, bone.second );
+			// Pose in parent space is the same as in skeleton space.
+			poseInParentSpace.m_orientations[ i ] = poseInSkeletonSpace.m_orientations[ i ];
+			poseInParentSpace.m_translations[ i ] = poseInSkeletonSpace.m_translations[ i ];
+			poseInParentSpace.m_scales[ i ]       = poseInSkeletonSpace.m_scales[ i ];
 		}
+
+		poseInParentSpace.markBonePresent( boneIndex );
 	}
 
 	return poseInParentSpace;
 }
 
-SkeletonPose::SkeletonPose( ) {}
-
-SkeletonPose::SkeletonPose( const SkeletonPose& obj ) 
-{
-    bonesPoses.clear();
+SkeletonPose::SkeletonPose( ) :
+	m_presentBones(),
+	m_boneCount( 0 )
+{}
 
-	// Copy the vector.
-	bonesPoses.insert( bonesPoses.begin(), obj.bonesPoses.begin( ), obj.bonesPoses.end( ) );
-}
+SkeletonPose::SkeletonPose( const SkeletonPose& obj ) :
+	m_orientations( obj.m_orientations ),
+	m_translations( obj.m_translations ),
+	m_scales( obj.m_scales ),
+	m_presentBones( obj.m_presentBones ),
+	m_boneCount( obj.m_boneCount )
+{}
 
 SkeletonPose::~SkeletonPose( ) {}
 
 SkeletonPose& SkeletonPose::operator = ( const SkeletonPose& obj )
 {
-    bonesPoses.clear();
+	// Assigning vectors reuses their memory - poses are re-assigned every frame.
+	m_orientations = obj.m_orientations;
+	m_translations = obj.m_translations;
+	m_scales       = obj.m_scales;
+	m_presentBones = obj.m_presentBones;
+	m_boneCount    = obj.m_boneCount;
+
+	return *this;
+}
+
+void SkeletonPose::setBonePose( const unsigned char boneIndex, const float43& bonePose ) {
+	// Scale is the length of the base vectors (matrix rows).
+	float3 scale( bonePose.getRow1().length(), bonePose.getRow2().length(), bonePose.getRow3().length() );
+
+	float3 row1 = bonePose.getRow1(), row2 = bonePose.getRow2(), row3 = bonePose.getRow3();
+	if ( scale.x > 0.0f ) row1 /= scale.x; else scale.x = 1.0f;
+	if ( scale.y > 0.0f ) row2 /= scale.y; else scale.y = 1.0f;
+	if ( scale.z > 0.0f ) row3 /= scale.z; else scale.z = 1.0f;
 
-    // Copy the vector.
-    bonesPoses.insert( bonesPoses.begin( ), obj.bonesPoses.begin( ), obj.bonesPoses.end( ) );
+	quat orientation( float33( row1, row2, row3 ) );
+	orientation.normalize();
 
-    return *this;
+	setBonePose( boneIndex, orientation, bonePose.getTranslation(), scale );
 }
 
-void SkeletonPose::setBonePose( const unsigned char boneIndex, const float43& bonePose ) {
+void SkeletonPose::setBonePose( const unsigned char boneIndex, const quat& orientation, const float3& translation, const float3& scale ) {
 	// Note: boneIndex is in range 1 - 255.
 	if ( boneIndex == 0 ) throw std::exception( "SkeletonPose::setBone - boneIndex cannot be 0." );
 
-	// Find the bone or insert it in the vector.
-	for ( unsigned int vectorIndex = 0; vectorIndex <= bonesPoses.size( ); ++vectorIndex ) {
-		if ( ( bonesPoses.size( ) == vectorIndex ) || ( bonesPoses.size( ) > vectorIndex + 1 && bonesPoses.at( vectorIndex + 1 ).first < boneIndex ) ) { // There is no bone with such index.
-			bonesPoses.insert( bonesPoses.begin( ) + vectorIndex, std::make_pair( boneIndex, bonePose ) ); // Insert the bone.
-			break;
-		} else if ( bonesPoses.at( vectorIndex ).first == boneIndex ) { // Bone with such index was found.
-			bonesPoses.at( vectorIndex ).second = bonePose; // Edit the bone.
-			break; 
-		}
-	}
+	reserveBone( boneIndex );
+
+	m_orientations[ boneIndex - 1 ] = orientation;
+	m_translations[ boneIndex - 1 ] = translation;
+	m_scales[ boneIndex - 1 ]       = scale;
+
+	markBonePresent( boneIndex );
+}
+
+void SkeletonPose::setBonePoses( const quat* orientations, const float3* translations, const float3* scales, const int boneCount )
+{
+	if ( boneCount < 0 || boneCount > s_maxBoneCount ) throw std::exception( "SkeletonPose::setBonePoses - bone count is out of range." );
+
+	m_orientations.assign( orientations, orientations + boneCount );
+	m_translations.assign( translations, translations + boneCount );
+	m_scales.assign( scales, scales + boneCount );
+
+	m_presentBones.fill( 0 );
+	for ( int bit = 0; bit < boneCount; bit += 64 )
+		m_presentBones[ bit >> 6 ] = boneCount - bit >= 64 ? ~0ull : ( 1ull << ( boneCount - bit ) ) - 1;
+
+	m_boneCount = (unsigned char)boneCount;
 }
 
 float43 SkeletonPose::getBonePose( const unsigned char boneIndex ) const {
-	// Find the bone.
-	for ( unsigned int vectorIndex = 0; vectorIndex <= bonesPoses.size(); ++vectorIndex ) {
-		if ( bonesPoses.at( vectorIndex ).first == boneIndex ) return bonesPoses.at( vectorIndex ).second;
-	}
+	if ( !hasBone( boneIndex ) ) throw std::exception( ( std::string( "SkeletonPose::getBonePose - there is no bone with such index (boneIndex = " ) + std::to_string( boneIndex ) + std::string( " )." ) ).c_str( ) );
+
+	float43 bonePose( m_orientations[ boneIndex - 1 ] );
+	bonePose.scale( m_scales[ boneIndex - 1 ] );
+	bonePose.setTranslation( m_translations[ boneIndex - 1 ] );
 
-	throw std::exception( ( std::string( "SkeletonPose::getBonePose - there is no bone with such index (boneIndex = " ) + std::to_string( boneIndex ) + std::string( " )." ) ).c_str( ) );
+	return bonePose;
+}
+
+void SkeletonPose::getBonePoses( std::vector< float43 >& bonePoses ) const
+{
+	bonePoses.resize( m_orientations.size() );
+
+	SkeletonPoseMath::composeMatrices( m_orientations.data(), m_translations.data(), m_scales.data(), bonePoses.data(), (int)m_orientations.size() );
 }
 
 unsigned char SkeletonPose::getBonesCount( ) const {
-	return (unsigned char)bonesPoses.size( );
+	return m_boneCount;
+}
+
+const std::vector< quat >& SkeletonPose::getOrientations() const
+{
+	return m_orientations;
+}
+
+const std::vector< float3 >& SkeletonPose::getTranslations() const
+{
+	return m_translations;
+}
+
+const std::vector< float3 >& SkeletonPose::getScales() const
+{
+	return m_scales;
 }
 
 void SkeletonPose::clear()
 {
-    bonesPoses.clear();
+	m_orientations.clear();
+	m_translations.clear();
+	m_scales.clear();
+	m_presentBones.fill( 0 );
+	m_boneCount = 0;
 }
 
 bool SkeletonPose::hasBone( const unsigned char boneIndex ) const {
-	// Find the bone.
-	for ( unsigned int vectorIndex = 0; vectorIndex < bonesPoses.size( ); ++vectorIndex ) {
-		if ( bonesPoses.at( vectorIndex ).first == boneIndex ) return true;
-	}
+	if ( boneIndex == 0 )
+		return false;
+
+	const int bit = boneIndex - 1;
+	return ( m_presentBones[ bit >> 6 ] & ( 1ull << ( bit & 63 ) ) ) != 0;
+}
 
-	return false;
-}
\ No newline at end of file
+void SkeletonPose::reserveBone( const unsigned char boneIndex )
+{
+	if ( m_orientations.size() >= boneIndex )
+		return;
+
+	m_orientations.resize( boneIndex, identityOrientation );
+	m_translations.resize( boneIndex, float3::ZERO );
+	m_scales.resize( boneIndex, float3::ONE );
+}
+
+void SkeletonPose::markBonePresent( const unsigned char boneIndex )
+{
+	const int                bit  = boneIndex - 1;
+	const unsigned long long mask = 1ull << ( bit & 63 );
+
+	if ( ( m_presentBones[ bit >> 6 ] & mask ) == 0 ) {
+		m_presentBones[ bit >> 6 ] |= mask;
+		++m_boneCount;
+	}
+}
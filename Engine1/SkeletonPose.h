@@ -1,8 +1,11 @@
 #pragma once
 
 #include <vector>
+#include <array>
 #include <tuple>
 #include "float44.h"
+#include "float3.h"
+#include "quat.h"
 
 
 
@@ -13,11 +16,17 @@ namespace Engine1
     // Object of this class stores poses of skeleton bones. All bones are either in "skeleton space" or "parent space".
     // "Skeleton space" mean that bone pose is in local space of the mesh. This pose is used mainly for rendering.
     // "Parent space" means that bone pose in the space of its parent bone. This pose is used mainly to combine poses together.
+    //
+    // Bone poses are stored as dense arrays (indexed by boneIndex - 1) of orientations, translations and scales,
+    // with a bitmask marking which bones are present in the pose. Non-uniform scale of a parent bone
+    // is applied to the translations of its children, but doesn't skew them (there is no shear in the representation).
     class SkeletonPose
     {
 
         public:
 
+        static const int s_maxBoneCount = 255;
+
         static SkeletonPose createIdentityPoseInSkeletonSpace( const SkeletonMesh& skeletonMesh );
         static SkeletonPose createIdentityPoseInParentSpace( const SkeletonMesh& skeletonMesh );
 
@@ -25,11 +34,12 @@ namespace Engine1
         // Both blended poses should be in skeleton space or in parent space.
         static SkeletonPose blendPoses( const SkeletonPose& pose1, const SkeletonPose& pose2, float factor );
 
-        // Blends poses of the corresponding bones in both poses. If a bone is present only in one pose, it is used without blending. 
+        // Blends poses of the corresponding bones in both poses. If a bone is present only in one pose, it is used without blending.
         // If a pose contains only a subset of bones, the last bone in the chain is ignored, as it has no information about it's pose relative to it's parent (such bone has an identity pose).
         // Can be used to blend any poses in parent space (containing the same or different subset of bones).
         //static SkeletonPose blendPosesInParentSpace( const SkeletonPose& poseInParentSpace1, const SkeletonPose& poseInParentSpace2, const SkeletonMesh& mesh, float factor );
 
+        // Single pass over the bones in the hierarchy order precomputed by the skeleton mesh.
         static SkeletonPose calculatePoseInSkeletonSpace( const SkeletonPose& poseInParentSpace, const SkeletonMesh& skeletonMesh );
         static SkeletonPose calculatePoseInParentSpace( const SkeletonPose& poseInSkeletonSpace, const SkeletonMesh& skeletonMesh );
 
@@ -41,23 +51,45 @@ namespace Engine1
 
         // boneIndex is in range 1 - 255.
         void setBonePose( const unsigned char boneIndex, const float43& bonePose );
+        void setBonePose( const unsigned char boneIndex, const quat& orientation, const float3& translation, const float3& scale = float3::ONE );
+
+        // Sets poses of bones 1 - boneCount from dense arrays (indexed by boneIndex - 1). Other bones are removed from the pose.
+        // Reuses the memory of the pose.
+        void setBonePoses( const quat* orientations, const float3* translations, const float3* scales, const int boneCount );
 
         // boneIndex is in range 1 - 255.
         float43 getBonePose( const unsigned char boneIndex ) const;
 
+        // Matrices of all the bones at once (indexed by boneIndex - 1). Matrices of bones not present in the pose are undefined.
+        void getBonePoses( std::vector< float43 >& bonePoses ) const;
+
+        // boneIndex is in range 1 - 255.
+        bool hasBone( const unsigned char boneIndex ) const;
+
         unsigned char getBonesCount() const;
 
+        // Dense per-bone arrays (indexed by boneIndex - 1). Values for bones not present in the pose are undefined.
+        const std::vector< quat >&   getOrientations() const;
+        const std::vector< float3 >& getTranslations() const;
+        const std::vector< float3 >& getScales() const;
+
         void clear();
 
         private:
 
-        // boneIndex is in range 1 - 255.
-        bool hasBone( const unsigned char boneIndex ) const;
+        // Makes sure the arrays can store the bone with the given index.
+        void reserveBone( const unsigned char boneIndex );
 
-        // Pairs of <bone index, bone pose>.
-        std::vector< std::pair<unsigned char, float43 > > bonesPoses;
+        void markBonePresent( const unsigned char boneIndex );
 
+        std::vector< quat >   m_orientations;
+        std::vector< float3 > m_translations;
+        std::vector< float3 > m_scales;
+
+        // Bit (boneIndex - 1) is set if the bone is present in the pose.
+        std::array< unsigned long long, 4 > m_presentBones;
+
+        unsigned char m_boneCount;
     };
 }
 
-
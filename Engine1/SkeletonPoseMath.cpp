@@ -0,0 +1,286 @@
+#include "SkeletonPoseMath.h"
+
+#include <cmath>
+#include <emmintrin.h>
+
+#include "quat.h"
+#include "float3.h"
+#include "float43.h"
+
+using namespace Engine1;
+
+namespace
+{
+    // Correction of the nlerp interpolation factor, so the interpolated angle follows slerp
+    // (polynomial fitted to slerp over the whole range of angles between the quaternions).
+    // cosOmega is the absolute value of the dot product of the interpolated quaternions.
+    float correctFactor( const float factor, const float cosOmega )
+    {
+        const float a = 1.0904f + cosOmega * ( -3.2452f + cosOmega * ( 3.55645f - cosOmega * 1.43519f ) );
+        const float b = 0.848013f + cosOmega * ( -1.06021f + cosOmega * 0.215638f );
+        const float k = a * ( factor - 0.5f ) * ( factor - 0.5f ) + b;
+
+        return factor + factor * ( factor - 0.5f ) * ( factor - 1.0f ) * k;
+    }
+
+    __m128 correctFactor( const __m128 factor, const __m128 cosOmega )
+    {
+        const __m128 a = _mm_add_ps( _mm_set1_ps( 1.0904f ), _mm_mul_ps( cosOmega, _mm_add_ps( _mm_set1_ps( -3.2452f ), _mm_mul_ps( cosOmega, _mm_sub_ps( _mm_set1_ps( 3.55645f ), _mm_mul_ps( cosOmega, _mm_set1_ps( 1.43519f ) ) ) ) ) ) );
+        const __m128 b = _mm_add_ps( _mm_set1_ps( 0.848013f ), _mm_mul_ps( cosOmega, _mm_add_ps( _mm_set1_ps( -1.06021f ), _mm_mul_ps( cosOmega, _mm_set1_ps( 0.215638f ) ) ) ) );
+
+        const __m128 half     = _mm_set1_ps( 0.5f );
+        const __m128 centered = _mm_sub_ps( factor, half );
+        const __m128 k        = _mm_add_ps( _mm_mul_ps( a, _mm_mul_ps( centered, centered ) ), b );
+
+        return _mm_add_ps( factor, _mm_mul_ps( _mm_mul_ps( factor, centered ), _mm_mul_ps( _mm_sub_ps( factor, _mm_set1_ps( 1.0f ) ), k ) ) );
+    }
+
+    quat interpolate( const quat& from, const quat& to, const float factor, const bool correct )
+    {
+        float cosOmega = quat::dot( from, to );
+        const float sign = cosOmega < 0.0f ? -1.0f : 1.0f;
+        cosOmega *= sign;
+
+        const float toFactor   = correct ? correctFactor( factor, cosOmega ) : factor;
+        const float fromFactor = 1.0f - toFactor;
+
+        quat result(
+            from.w * fromFactor + to.w * toFactor * sign,
+            from.x * fromFactor + to.x * toFactor * sign,
+            from.y * fromFactor + to.y * toFactor * sign,
+            from.z * fromFactor + to.z * toFactor * sign
+        );
+
+        const float length = std::sqrt( result.w * result.w + result.x * result.x + result.y * result.y + result.z * result.z );
+        result.w /= length;
+        result.x /= length;
+        result.y /= length;
+        result.z /= length;
+
+        return result;
+    }
+
+    // Processes 4 quaternions at a time - they are transposed, so each register holds one component of 4 quaternions.
+    void interpolate( const quat* from, const quat* to, const float factor, quat* result, const int count, const bool correct )
+    {
+        const __m128 factors  = _mm_set1_ps( factor );
+        const __m128 signMask = _mm_set1_ps( -0.0f );
+
+        int i = 0;
+        for ( ; i + 4 <= count; i += 4 ) {
+            __m128 fromW = _mm_loadu_ps( &from[ i ].w );
+            __m128 fromX = _mm_loadu_ps( &from[ i + 1 ].w );
+            __m128 fromY = _mm_loadu_ps( &from[ i + 2 ].w );
+            __m128 fromZ = _mm_loadu_ps( &from[ i + 3 ].w );
+            _MM_TRANSPOSE4_PS( fromW, fromX, fromY, fromZ );
+
+            __m128 toW = _mm_loadu_ps( &to[ i ].w );
+            __m128 toX = _mm_loadu_ps( &to[ i + 1 ].w );
+            __m128 toY = _mm_loadu_ps( &to[ i + 2 ].w );
+            __m128 toZ = _mm_loadu_ps( &to[ i + 3 ].w );
+            _MM_TRANSPOSE4_PS( toW, toX, toY, toZ );
+
+            const __m128 dot = _mm_add_ps( _mm_add_ps( _mm_mul_ps( fromW, toW ), _mm_mul_ps( fromX, toX ) ), _mm_add_ps( _mm_mul_ps( fromY, toY ), _mm_mul_ps( fromZ, toZ ) ) );
+
+            // Flip the sign of the target quaternion if the dot product is negative - interpolate along the shorter arc.
+            const __m128 sign     = _mm_and_ps( dot, signMask );
+            const __m128 cosOmega = _mm_andnot_ps( signMask, dot );
+
+            const __m128 correctedFactors = correct ? correctFactor( factors, cosOmega ) : factors;
+            const __m128 fromFactors      = _mm_sub_ps( _mm_set1_ps( 1.0f ), correctedFactors );
+            const __m128 toFactors        = _mm_xor_ps( correctedFactors, sign );
+
+            __m128 w = _mm_add_ps( _mm_mul_ps( fromW, fromFactors ), _mm_mul_ps( toW, toFactors ) );
+            __m128 x = _mm_add_ps( _mm_mul_ps( fromX, fromFactors ), _mm_mul_ps( toX, toFactors ) );
+            __m128 y = _mm_add_ps( _mm_mul_ps( fromY, fromFactors ), _mm_mul_ps( toY, toFactors ) );
+            __m128 z = _mm_add_ps( _mm_mul_ps( fromZ, fromFactors ), _mm_mul_ps( toZ, toFactors ) );
+
+            const __m128 length = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( w, w ), _mm_mul_ps( x, x ) ), _mm_add_ps( _mm_mul_ps( y, y ), _mm_mul_ps( z, z ) ) ) );
+            w = _mm_div_ps( w, length );
+            x = _mm_div_ps( x, length );
+            y = _mm_div_ps( y, length );
+            z = _mm_div_ps( z, length );
+
+            _MM_TRANSPOSE4_PS( w, x, y, z );
+            _mm_storeu_ps( &result[ i ].w, w );
+            _mm_storeu_ps( &result[ i + 1 ].w, x );
+            _mm_storeu_ps( &result[ i + 2 ].w, y );
+            _mm_storeu_ps( &result[ i + 3 ].w, z );
+        }
+
+        for ( ; i < count; ++i )
+            result[ i ] = interpolate( from[ i ], to[ i ], factor, correct );
+    }
+
+    // Loads components of 4 float3 vectors into separate registers.
+    void loadTransposed( const float3* vectors, __m128& x, __m128& y, __m128& z )
+    {
+        x = _mm_setr_ps( vectors[ 0 ].x, vectors[ 1 ].x, vectors[ 2 ].x, vectors[ 3 ].x );
+        y = _mm_setr_ps( vectors[ 0 ].y, vectors[ 1 ].y, vectors[ 2 ].y, vectors[ 3 ].y );
+        z = _mm_setr_ps( vectors[ 0 ].z, vectors[ 1 ].z, vectors[ 2 ].z, vectors[ 3 ].z );
+    }
+
+    // Loads matrix rows without reading past the end of the matrix. The 4th component of each row is undefined.
+    void loadRows( const float43& matrix, __m128& row1, __m128& row2, __m128& row3, __m128& translation )
+    {
+        const float* values = &matrix.m11;
+
+        row1        = _mm_loadu_ps( values );
+        row2        = _mm_loadu_ps( values + 3 );
+        row3        = _mm_loadu_ps( values + 6 );
+        translation = _mm_loadu_ps( values + 8 );
+        translation = _mm_shuffle_ps( translation, translation, _MM_SHUFFLE( 3, 3, 2, 1 ) );
+    }
+
+    // Stores matrix rows without writing past the end of the matrix.
+    void storeRows( float43& matrix, const __m128 row1, const __m128 row2, const __m128 row3, const __m128 translation )
+    {
+        float* values = &matrix.m11;
+
+        // Each store overwrites the 4th component of the previous one.
+        _mm_storeu_ps( values, row1 );
+        _mm_storeu_ps( values + 3, row2 );
+        _mm_storeu_ps( values + 6, row3 );
+
+        // ( m33, t1, t2, t3 ).
+        const __m128 temp = _mm_shuffle_ps( row3, translation, _MM_SHUFFLE( 0, 0, 2, 2 ) );
+        _mm_storeu_ps( values + 8, _mm_shuffle_ps( temp, translation, _MM_SHUFFLE( 2, 1, 2, 0 ) ) );
+    }
+
+    __m128 transformRow( const __m128 row, const __m128 parentRow1, const __m128 parentRow2, const __m128 parentRow3 )
+    {
+        return _mm_add_ps(
+            _mm_add_ps(
+                _mm_mul_ps( _mm_shuffle_ps( row, row, _MM_SHUFFLE( 0, 0, 0, 0 ) ), parentRow1 ),
+                _mm_mul_ps( _mm_shuffle_ps( row, row, _MM_SHUFFLE( 1, 1, 1, 1 ) ), parentRow2 )
+            ),
+            _mm_mul_ps( _mm_shuffle_ps( row, row, _MM_SHUFFLE( 2, 2, 2, 2 ) ), parentRow3 )
+        );
+    }
+}
+
+void SkeletonPoseMath::nlerp( const quat* from, const quat* to, const float factor, quat* result, const int count )
+{
+    interpolate( from, to, factor, result, count, false );
+}
+
+void SkeletonPoseMath::slerp( const quat* from, const quat* to, const float factor, quat* result, const int count )
+{
+    interpolate( from, to, factor, result, count, true );
+}
+
+void SkeletonPoseMath::lerp( const float3* from, const float3* to, const float factor, float3* result, const int count )
+{
+    // float3 arrays are tightly packed - interpolate them as flat arrays of floats.
+    const float* fromValues   = &from[ 0 ].x;
+    const float* toValues     = &to[ 0 ].x;
+    float*       resultValues = &result[ 0 ].x;
+
+    const int    valueCount = count * 3;
+    const __m128 factors    = _mm_set1_ps( factor );
+
+    int i = 0;
+    for ( ; i + 4 <= valueCount; i += 4 ) {
+        const __m128 fromValue = _mm_loadu_ps( fromValues + i );
+        const __m128 toValue   = _mm_loadu_ps( toValues + i );
+
+        _mm_storeu_ps( resultValues + i, _mm_add_ps( fromValue, _mm_mul_ps( _mm_sub_ps( toValue, fromValue ), factors ) ) );
+    }
+
+    for ( ; i < valueCount; ++i )
+        resultValues[ i ] = fromValues[ i ] + ( toValues[ i ] - fromValues[ i ] ) * factor;
+}
+
+void SkeletonPoseMath::composeMatrices( const quat* orientations, const float3* translations, const float3* scales, float43* matrices, const int count )
+{
+    const __m128 one = _mm_set1_ps( 1.0f );
+
+    int i = 0;
+    for ( ; i + 4 <= count; i += 4 ) {
+        __m128 w = _mm_loadu_ps( &orientations[ i ].w );
+        __m128 x = _mm_loadu_ps( &orientations[ i + 1 ].w );
+        __m128 y = _mm_loadu_ps( &orientations[ i + 2 ].w );
+        __m128 z = _mm_loadu_ps( &orientations[ i + 3 ].w );
+        _MM_TRANSPOSE4_PS( w, x, y, z );
+
+        __m128 scaleX, scaleY, scaleZ, translationX, translationY, translationZ;
+        loadTransposed( scales + i, scaleX, scaleY, scaleZ );
+        loadTransposed( translations + i, translationX, translationY, translationZ );
+
+        // Same as float43::setOrientation.
+        const __m128 ww = _mm_add_ps( w, w );
+        const __m128 xx = _mm_add_ps( x, x );
+        const __m128 yy = _mm_add_ps( y, y );
+        const __m128 zz = _mm_add_ps( z, z );
+
+        __m128 m11 = _mm_mul_ps( _mm_sub_ps( one, _mm_add_ps( _mm_mul_ps( yy, y ), _mm_mul_ps( zz, z ) ) ), scaleX );
+        __m128 m12 = _mm_mul_ps( _mm_add_ps( _mm_mul_ps( xx, y ), _mm_mul_ps( ww, z ) ), scaleX );
+        __m128 m13 = _mm_mul_ps( _mm_sub_ps( _mm_mul_ps( xx, z ), _mm_mul_ps( ww, y ) ), scaleX );
+
+        __m128 m21 = _mm_mul_ps( _mm_sub_ps( _mm_mul_ps( xx, y ), _mm_mul_ps( ww, z ) ), scaleY );
+        __m128 m22 = _mm_mul_ps( _mm_sub_ps( one, _mm_add_ps( _mm_mul_ps( xx, x ), _mm_mul_ps( zz, z ) ) ), scaleY );
+        __m128 m23 = _mm_mul_ps( _mm_add_ps( _mm_mul_ps( yy, z ), _mm_mul_ps( ww, x ) ), scaleY );
+
+        __m128 m31 = _mm_mul_ps( _mm_add_ps( _mm_mul_ps( xx, z ), _mm_mul_ps( ww, y ) ), scaleZ );
+        __m128 m32 = _mm_mul_ps( _mm_sub_ps( _mm_mul_ps( yy, z ), _mm_mul_ps( ww, x ) ), scaleZ );
+        __m128 m33 = _mm_mul_ps( _mm_sub_ps( one, _mm_add_ps( _mm_mul_ps( xx, x ), _mm_mul_ps( yy, y ) ) ), scaleZ );
+
+        // Each matrix is 12 floats - transpose 3 blocks of 4 components into 4 matrices.
+        _MM_TRANSPOSE4_PS( m11, m12, m13, m21 );
+        _MM_TRANSPOSE4_PS( m22, m23, m31, m32 );
+        _MM_TRANSPOSE4_PS( m33, translationX, translationY, translationZ );
+
+        float* values = &matrices[ i ].m11;
+        _mm_storeu_ps( values,      m11 );
+        _mm_storeu_ps( values + 4,  m22 );
+        _mm_storeu_ps( values + 8,  m33 );
+        _mm_storeu_ps( values + 12, m12 );
+        _mm_storeu_ps( values + 16, m23 );
+        _mm_storeu_ps( values + 20, translationX );
+        _mm_storeu_ps( values + 24, m13 );
+        _mm_storeu_ps( values + 28, m31 );
+        _mm_storeu_ps( values + 32, translationY );
+        _mm_storeu_ps( values + 36, m21 );
+        _mm_storeu_ps( values + 40, m32 );
+        _mm_storeu_ps( values + 44, translationZ );
+    }
+
+    for ( ; i < count; ++i ) {
+        matrices[ i ] = float43( orientations[ i ] );
+        matrices[ i ].scale( scales[ i ] );
+        matrices[ i ].setTranslation( translations[ i ] );
+    }
+}
+
+void SkeletonPoseMath::concatenateParentChain(
+    const float43* matricesInParentSpace,
+    const unsigned char* parentBoneIndices,
+    const unsigned char* bonesInHierarchyOrder,
+    const int orderCount,
+    float43* matricesInSkeletonSpace )
+{
+    for ( int orderIndex = 0; orderIndex < orderCount; ++orderIndex ) {
+        const int i = bonesInHierarchyOrder[ orderIndex ] - 1;
+
+        const unsigned char parentBoneIndex = parentBoneIndices[ i ];
+        if ( parentBoneIndex == 0 ) {
+            matricesInSkeletonSpace[ i ] = matricesInParentSpace[ i ];
+            continue;
+        }
+
+        __m128 row1, row2, row3, translation;
+        loadRows( matricesInParentSpace[ i ], row1, row2, row3, translation );
+
+        __m128 parentRow1, parentRow2, parentRow3, parentTranslation;
+        loadRows( matricesInSkeletonSpace[ parentBoneIndex - 1 ], parentRow1, parentRow2, parentRow3, parentTranslation );
+
+        // Bone's matrix in skeleton space = bone's matrix in parent space * parent's matrix in skeleton space.
+        storeRows(
+            matricesInSkeletonSpace[ i ],
+            transformRow( row1, parentRow1, parentRow2, parentRow3 ),
+            transformRow( row2, parentRow1, parentRow2, parentRow3 ),
+            transformRow( row3, parentRow1, parentRow2, parentRow3 ),
+            _mm_add_ps( transformRow( translation, parentRow1, parentRow2, parentRow3 ), parentTranslation )
+        );
+    }
+}
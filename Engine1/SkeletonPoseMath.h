@@ -0,0 +1,37 @@
+#pragma once
+
+namespace Engine1
+{
+    class quat;
+    class float3;
+    class float43;
+
+    // Batched (SSE) kernels operating on arrays of bone transforms - 4 bones are processed per instruction.
+    // Arrays may overlap only if the result array is the same as one of the inputs.
+    class SkeletonPoseMath
+    {
+        public:
+
+        // Normalized linear interpolation. Quaternions are negated when needed to interpolate along the shorter arc.
+        static void nlerp( const quat* from, const quat* to, const float factor, quat* result, const int count );
+
+        // Approximated spherical linear interpolation - nlerp with the interpolation factor corrected
+        // by a polynomial fitted to slerp (angular error below 0.001 radians).
+        static void slerp( const quat* from, const quat* to, const float factor, quat* result, const int count );
+
+        static void lerp( const float3* from, const float3* to, const float factor, float3* result, const int count );
+
+        // Builds matrices from orientations, translations and scales - same as float43( orientation ) scaled and translated.
+        static void composeMatrices( const quat* orientations, const float3* translations, const float3* scales, float43* matrices, const int count );
+
+        // Calculates skeleton-space matrices from parent-space matrices (both indexed by boneIndex - 1).
+        // Bones are visited in the given order, which has to list each parent before its children. Parent index 0 means a root bone.
+        static void concatenateParentChain(
+            const float43* matricesInParentSpace,
+            const unsigned char* parentBoneIndices,
+            const unsigned char* bonesInHierarchyOrder,
+            const int orderCount,
+            float43* matricesInSkeletonSpace
+        );
+    };
+}
@@ -0,0 +1,298 @@
+#include "SkeletonSkinning.h"
+
+#include <cmath>
+#include <emmintrin.h>
+
+#include "SkeletonMesh.h"
+#include "SkeletonPose.h"
+#include "BlockMesh.h"
+#include "JobSystem.h"
+#include "float33.h"
+#include "quat.h"
+
+using namespace Engine1;
+
+const int SkeletonSkinning::s_minVertexCountPerJob = 2048;
+
+namespace
+{
+    // Matrix rows - the 4th component is unused.
+    struct BoneMatrix
+    {
+        __m128 row1, row2, row3, translation;
+    };
+
+    // Rigid part of the bone transformation as a unit dual quaternion ( w, x, y, z ) and the scale applied before it.
+    struct BoneDualQuaternion
+    {
+        __m128 real, dual, scale;
+    };
+
+    BoneMatrix toBoneMatrix( const float43& matrix )
+    {
+        BoneMatrix boneMatrix;
+        boneMatrix.row1        = _mm_setr_ps( matrix.m11, matrix.m12, matrix.m13, 0.0f );
+        boneMatrix.row2        = _mm_setr_ps( matrix.m21, matrix.m22, matrix.m23, 0.0f );
+        boneMatrix.row3        = _mm_setr_ps( matrix.m31, matrix.m32, matrix.m33, 0.0f );
+        boneMatrix.translation = _mm_setr_ps( matrix.t1, matrix.t2, matrix.t3, 0.0f );
+
+        return boneMatrix;
+    }
+
+    BoneDualQuaternion toBoneDualQuaternion( const float43& matrix )
+    {
+        // Scale is the length of the matrix rows - same decomposition as in SkeletonPose.
+        float3 scale( matrix.getRow1().length(), matrix.getRow2().length(), matrix.getRow3().length() );
+
+        float3 row1 = matrix.getRow1(), row2 = matrix.getRow2(), row3 = matrix.getRow3();
+        if ( scale.x > 0.0f ) row1 /= scale.x; else scale.x = 1.0f;
+        if ( scale.y > 0.0f ) row2 /= scale.y; else scale.y = 1.0f;
+        if ( scale.z > 0.0f ) row3 /= scale.z; else scale.z = 1.0f;
+
+        quat orientation( float33( row1, row2, row3 ) );
+        orientation.normalize();
+
+        // Dual part = 0.5 * ( 0, translation ) * orientation (Hamilton product).
+        const float3 axis( orientation.x, orientation.y, orientation.z );
+        const float3 translation = matrix.getTranslation();
+        const float3 dualAxis    = ( translation * orientation.w + cross( translation, axis ) ) * 0.5f;
+        const float  dualW       = -0.5f * dot( translation, axis );
+
+        BoneDualQuaternion boneDualQuaternion;
+        boneDualQuaternion.real  = _mm_setr_ps( orientation.w, orientation.x, orientation.y, orientation.z );
+        boneDualQuaternion.dual  = _mm_setr_ps( dualW, dualAxis.x, dualAxis.y, dualAxis.z );
+        boneDualQuaternion.scale = _mm_setr_ps( scale.x, scale.y, scale.z, 0.0f );
+
+        return boneDualQuaternion;
+    }
+
+    // Converts blended (not normalized) dual quaternion and scale back to matrix rows.
+    BoneMatrix toBoneMatrix( const __m128 real, const __m128 dual, const __m128 scale )
+    {
+        alignas( 16 ) float r[ 4 ], d[ 4 ], s[ 4 ];
+        _mm_store_ps( r, real );
+        _mm_store_ps( d, dual );
+        _mm_store_ps( s, scale );
+
+        const float length = std::sqrt( r[ 0 ] * r[ 0 ] + r[ 1 ] * r[ 1 ] + r[ 2 ] * r[ 2 ] + r[ 3 ] * r[ 3 ] );
+        const float w = r[ 0 ] / length, x = r[ 1 ] / length, y = r[ 2 ] / length, z = r[ 3 ] / length;
+        const float dw = d[ 0 ] / length, dx = d[ 1 ] / length, dy = d[ 2 ] / length, dz = d[ 3 ] / length;
+
+        // Translation = 2 * dual * conjugate( real ) (vector part).
+        const float tx = 2.0f * ( w * dx - dw * x + ( dy * -z - dz * -y ) );
+        const float ty = 2.0f * ( w * dy - dw * y + ( dz * -x - dx * -z ) );
+        const float tz = 2.0f * ( w * dz - dw * z + ( dx * -y - dy * -x ) );
+
+        // Same as float43::setOrientation, rows scaled.
+        const float ww = 2.0f * w, xx = 2.0f * x, yy = 2.0f * y, zz = 2.0f * z;
+
+        BoneMatrix boneMatrix;
+        boneMatrix.row1        = _mm_mul_ps( _mm_setr_ps( 1.0f - yy * y - zz * z, xx * y + ww * z, xx * z - ww * y, 0.0f ), _mm_set1_ps( s[ 0 ] ) );
+        boneMatrix.row2        = _mm_mul_ps( _mm_setr_ps( xx * y - ww * z, 1.0f - xx * x - zz * z, yy * z + ww * x, 0.0f ), _mm_set1_ps( s[ 1 ] ) );
+        boneMatrix.row3        = _mm_mul_ps( _mm_setr_ps( xx * z + ww * y, yy * z - ww * x, 1.0f - xx * x - yy * y, 0.0f ), _mm_set1_ps( s[ 2 ] ) );
+        boneMatrix.translation = _mm_setr_ps( tx, ty, tz, 0.0f );
+
+        return boneMatrix;
+    }
+
+    __m128 transformDirection( const float3& direction, const BoneMatrix& matrix )
+    {
+        return _mm_add_ps(
+            _mm_add_ps( _mm_mul_ps( _mm_set1_ps( direction.x ), matrix.row1 ), _mm_mul_ps( _mm_set1_ps( direction.y ), matrix.row2 ) ),
+            _mm_mul_ps( _mm_set1_ps( direction.z ), matrix.row3 )
+        );
+    }
+
+    float3 toFloat3( const __m128 value )
+    {
+        alignas( 16 ) float values[ 4 ];
+        _mm_store_ps( values, value );
+
+        return float3( values[ 0 ], values[ 1 ], values[ 2 ] );
+    }
+
+    float3 toNormalizedFloat3( const __m128 value )
+    {
+        const __m128 squared = _mm_mul_ps( value, value );
+        const __m128 length  = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_shuffle_ps( squared, squared, _MM_SHUFFLE( 0, 0, 0, 0 ) ), _mm_shuffle_ps( squared, squared, _MM_SHUFFLE( 1, 1, 1, 1 ) ) ), _mm_shuffle_ps( squared, squared, _MM_SHUFFLE( 2, 2, 2, 2 ) ) ) );
+
+        return toFloat3( _mm_div_ps( value, _mm_max_ps( length, _mm_set1_ps( 1e-20f ) ) ) );
+    }
+}
+
+void SkeletonSkinning::calculateSkinningMatrices( const SkeletonMesh& mesh, const SkeletonPose& poseInSkeletonSpace, std::vector< float43 >& skinningMatrices )
+{
+    const unsigned char boneCount = mesh.getBoneCount();
+
+    if ( poseInSkeletonSpace.getBonesCount() != boneCount || (int)poseInSkeletonSpace.getOrientations().size() != boneCount )
+        throw std::exception( "SkeletonSkinning::calculateSkinningMatrices - pose doesn't contain all the bones of the mesh." );
+
+    poseInSkeletonSpace.getBonePoses( skinningMatrices );
+
+    // Same transformation as in SkeletonModel_vs.hlsl - to bone's coordinate system, along with the bone, back to mesh's coordinate system.
+    for ( unsigned char boneIndex = 1; boneIndex <= boneCount; ++boneIndex ) {
+        const SkeletonMesh::Bone& bone = mesh.getBone( boneIndex );
+
+        float43& skinningMatrix = skinningMatrices[ boneIndex - 1 ];
+        skinningMatrix = bone.getBindPose() * ( skinningMatrix * bone.getBindPose() ) * bone.getBindPoseInv();
+    }
+}
+
+void SkeletonSkinning::skin(
+    const SkeletonMesh& mesh,
+    const SkeletonPose& poseInSkeletonSpace,
+    const Mode mode,
+    std::vector< float3 >& vertices,
+    std::vector< float3 >& normals,
+    std::vector< float3 >& tangents )
+{
+    const int bonesPerVertex = static_cast< int >( mesh.getBonesPerVertexCount() );
+    if ( bonesPerVertex == 0 ) throw std::exception( "SkeletonSkinning::skin - mesh's number-of-bones-per-vertex is ZERO." );
+
+    const std::vector< float3 >&        inputVertices = mesh.getVertices();
+    const std::vector< float3 >&        inputNormals  = mesh.getNormals();
+    const std::vector< float3 >&        inputTangents = mesh.getTangents();
+    const std::vector< unsigned char >& vertexBones   = mesh.getVertexBones();
+    const std::vector< float >&         vertexWeights = mesh.getVertexWeights();
+
+    const int  vertexCount  = (int)inputVertices.size();
+    const bool hasNormals   = inputNormals.size() == inputVertices.size();
+    const bool hasTangents  = inputTangents.size() == inputVertices.size();
+
+    if ( (int)vertexBones.size() < vertexCount * bonesPerVertex || (int)vertexWeights.size() < vertexCount * bonesPerVertex )
+        throw std::exception( "SkeletonSkinning::skin - mesh's vertex bones/weights don't match the number of vertices." );
+
+    std::vector< float43 > skinningMatrices;
+    calculateSkinningMatrices( mesh, poseInSkeletonSpace, skinningMatrices );
+
+    const int boneCount = (int)skinningMatrices.size();
+
+    std::vector< BoneMatrix >         boneMatrices;
+    std::vector< BoneDualQuaternion > boneDualQuaternions;
+    if ( mode == Mode::LinearBlend ) {
+        boneMatrices.reserve( boneCount );
+        for ( const float43& skinningMatrix : skinningMatrices )
+            boneMatrices.push_back( toBoneMatrix( skinningMatrix ) );
+    } else {
+        boneDualQuaternions.reserve( boneCount );
+        for ( const float43& skinningMatrix : skinningMatrices )
+            boneDualQuaternions.push_back( toBoneDualQuaternion( skinningMatrix ) );
+    }
+
+    vertices.resize( vertexCount );
+    normals.resize( hasNormals ? vertexCount : 0 );
+    tangents.resize( hasTangents ? vertexCount : 0 );
+
+    const auto skinVertices = [ & ]( const int begin, const int end )
+    {
+        for ( int vertexIndex = begin; vertexIndex < end; ++vertexIndex ) {
+            const unsigned char* bones   = &vertexBones[ vertexIndex * bonesPerVertex ];
+            const float*         weights = &vertexWeights[ vertexIndex * bonesPerVertex ];
+
+            // Blend the transformations of all the bones affecting the vertex.
+            BoneMatrix matrix;
+            bool       isAttached = false;
+
+            if ( mode == Mode::LinearBlend ) {
+                matrix.row1 = matrix.row2 = matrix.row3 = matrix.translation = _mm_setzero_ps();
+
+                for ( int i = 0; i < bonesPerVertex; ++i ) {
+                    if ( bones[ i ] == 0 || bones[ i ] > boneCount || weights[ i ] <= 0.0f )
+                        continue;
+
+                    const BoneMatrix& boneMatrix = boneMatrices[ bones[ i ] - 1 ];
+                    const __m128      weight     = _mm_set1_ps( weights[ i ] );
+
+                    matrix.row1        = _mm_add_ps( matrix.row1, _mm_mul_ps( boneMatrix.row1, weight ) );
+                    matrix.row2        = _mm_add_ps( matrix.row2, _mm_mul_ps( boneMatrix.row2, weight ) );
+                    matrix.row3        = _mm_add_ps( matrix.row3, _mm_mul_ps( boneMatrix.row3, weight ) );
+                    matrix.translation = _mm_add_ps( matrix.translation, _mm_mul_ps( boneMatrix.translation, weight ) );
+
+                    isAttached = true;
+                }
+            } else {
+                __m128 real  = _mm_setzero_ps();
+                __m128 dual  = _mm_setzero_ps();
+                __m128 scale = _mm_setzero_ps();
+                __m128 pivot = _mm_setzero_ps();
+
+                for ( int i = 0; i < bonesPerVertex; ++i ) {
+                    if ( bones[ i ] == 0 || bones[ i ] > boneCount || weights[ i ] <= 0.0f )
+                        continue;
+
+                    const BoneDualQuaternion& boneDualQuaternion = boneDualQuaternions[ bones[ i ] - 1 ];
+
+                    // Take the dual quaternion with the sign closer to the first bone - q and -q are the same transformation, but don't blend well.
+                    if ( !isAttached )
+                        pivot = boneDualQuaternion.real;
+
+                    const __m128 product = _mm_mul_ps( pivot, boneDualQuaternion.real );
+                    alignas( 16 ) float products[ 4 ];
+                    _mm_store_ps( products, product );
+
+                    const float  sign   = ( products[ 0 ] + products[ 1 ] + products[ 2 ] + products[ 3 ] ) < 0.0f ? -1.0f : 1.0f;
+                    const __m128 weight = _mm_set1_ps( weights[ i ] * sign );
+
+                    real  = _mm_add_ps( real, _mm_mul_ps( boneDualQuaternion.real, weight ) );
+                    dual  = _mm_add_ps( dual, _mm_mul_ps( boneDualQuaternion.dual, weight ) );
+                    scale = _mm_add_ps( scale, _mm_mul_ps( boneDualQuaternion.scale, _mm_set1_ps( weights[ i ] ) ) );
+
+                    isAttached = true;
+                }
+
+                if ( isAttached )
+                    matrix = toBoneMatrix( real, dual, scale );
+            }
+
+            if ( !isAttached ) {
+                vertices[ vertexIndex ] = inputVertices[ vertexIndex ];
+                if ( hasNormals )  normals[ vertexIndex ]  = inputNormals[ vertexIndex ];
+                if ( hasTangents ) tangents[ vertexIndex ] = inputTangents[ vertexIndex ];
+                continue;
+            }
+
+            vertices[ vertexIndex ] = toFloat3( _mm_add_ps( transformDirection( inputVertices[ vertexIndex ], matrix ), matrix.translation ) );
+
+            if ( hasNormals )
+                normals[ vertexIndex ] = toNormalizedFloat3( transformDirection( inputNormals[ vertexIndex ], matrix ) );
+
+            if ( hasTangents )
+                tangents[ vertexIndex ] = toNormalizedFloat3( transformDirection( inputTangents[ vertexIndex ], matrix ) );
+        }
+    };
+
+    JobSystem::get().parallelFor( vertexCount, s_minVertexCountPerJob, skinVertices );
+}
+
+void SkeletonSkinning::skin( const SkeletonMesh& mesh, const SkeletonPose& poseInSkeletonSpace, const Mode mode, BlockMesh& skinnedMesh )
+{
+    if ( skinnedMesh.getVertices().size() != mesh.getVertices().size() )
+        throw std::exception( "SkeletonSkinning::skin - skinned mesh has different number of vertices than the skeleton mesh." );
+
+    skin( mesh, poseInSkeletonSpace, mode, skinnedMesh.getVertices(), skinnedMesh.getNormals(), skinnedMesh.getTangents() );
+
+    skinnedMesh.recalculateBoundingBox();
+}
+
+std::shared_ptr< BlockMesh > SkeletonSkinning::createSkinnedMesh( const SkeletonMesh& mesh )
+{
+    const int vertexCount       = (int)mesh.getVertices().size();
+    const int texcoordsSetCount = mesh.getTexcoordsCount();
+
+    std::shared_ptr< BlockMesh > skinnedMesh = std::make_shared< BlockMesh >( vertexCount, !mesh.getNormals().empty(), texcoordsSetCount, (int)mesh.getTriangles().size() );
+
+    skinnedMesh->getVertices() = mesh.getVertices();
+    skinnedMesh->getTriangles() = mesh.getTriangles();
+
+    if ( !mesh.getNormals().empty() ) {
+        skinnedMesh->getNormals()  = mesh.getNormals();
+        skinnedMesh->getTangents() = mesh.getTangents();
+    }
+
+    for ( int setIndex = 0; setIndex < texcoordsSetCount; ++setIndex )
+        skinnedMesh->getTexcoords( setIndex ) = mesh.getTexcoords( setIndex );
+
+    skinnedMesh->recalculateBoundingBox();
+
+    return skinnedMesh;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+
+#include "float3.h"
+#include "float43.h"
+
+namespace Engine1
+{
+    class SkeletonMesh;
+    class SkeletonPose;
+    class BlockMesh;
+
+    // Skins skeleton meshes on the CPU - produces the same vertices as SkeletonModel_vs.hlsl does on the GPU,
+    // so animated meshes can be used by the raytracing passes and for picking.
+    // Vertices are processed in parallel chunks (on the shared JobSystem), each vertex with SSE.
+    class SkeletonSkinning
+    {
+        public:
+
+        enum class Mode : char
+        {
+            LinearBlend = 0,
+            // Blends bone transformations as dual quaternions - avoids the volume loss (candy-wrapper effect)
+            // of linear blending at twisted joints. Bone scale is blended linearly and applied before the rigid transformation.
+            DualQuaternion
+        };
+
+        static const int s_minVertexCountPerJob;
+
+        // Calculates the matrix transforming vertices from the bind pose to the given pose for each bone (indexed by boneIndex - 1).
+        // Pose has to contain all the bones of the mesh.
+        static void calculateSkinningMatrices( const SkeletonMesh& mesh, const SkeletonPose& poseInSkeletonSpace, std::vector< float43 >& skinningMatrices );
+
+        // Outputs are resized to the mesh's vertex count (normals and tangents only if the mesh has them).
+        // Normals and tangents are normalized. Vertices not attached to any bone are left unchanged.
+        static void skin(
+            const SkeletonMesh& mesh,
+            const SkeletonPose& poseInSkeletonSpace,
+            const Mode mode,
+            std::vector< float3 >& vertices,
+            std::vector< float3 >& normals,
+            std::vector< float3 >& tangents
+        );
+
+        // Skins into a mesh created with createSkinnedMesh (or any mesh with the same vertex layout) and updates its bounding box.
+        // Only CPU data is updated.
+        static void skin( const SkeletonMesh& mesh, const SkeletonPose& poseInSkeletonSpace, const Mode mode, BlockMesh& skinnedMesh );
+
+        // Creates a mesh with triangles and texcoords of the skeleton mesh, to be skinned into.
+        static std::shared_ptr< BlockMesh > createSkinnedMesh( const SkeletonMesh& mesh );
+    };
+}
@@ -0,0 +1,244 @@
+#include "SoftwareDepthBuffer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "float43.h"
+
+using namespace Engine1;
+
+const int SoftwareDepthBuffer::s_tileSize = 8;
+
+namespace
+{
+    // Clip space w below which vertices are treated as crossing the near plane.
+    const float minW = 0.0001f;
+
+    struct ScreenVertex
+    {
+        float x;
+        float y;
+        float z;
+    };
+
+    // Twice the signed area of the triangle (a, b, p).
+    float edgeFunction( const ScreenVertex& a, const ScreenVertex& b, const float px, const float py )
+    {
+        return ( b.x - a.x ) * ( py - a.y ) - ( b.y - a.y ) * ( px - a.x );
+    }
+}
+
+SoftwareDepthBuffer::SoftwareDepthBuffer() :
+    m_dimensions( 0, 0 ),
+    m_tileCount( 0, 0 ),
+    m_viewProjection( float44::IDENTITY )
+{}
+
+SoftwareDepthBuffer::~SoftwareDepthBuffer()
+{}
+
+void SoftwareDepthBuffer::reset( const int2& dimensions, const float44& viewProjection )
+{
+    if ( dimensions.x <= 0 || dimensions.y <= 0 )
+        throw std::exception( "SoftwareDepthBuffer::reset - dimensions have to be positive." );
+
+    m_dimensions     = dimensions;
+    m_tileCount      = int2( ( dimensions.x + s_tileSize - 1 ) / s_tileSize, ( dimensions.y + s_tileSize - 1 ) / s_tileSize );
+    m_viewProjection = viewProjection;
+
+    m_depth.assign( dimensions.x * dimensions.y, 1.0f );
+    m_tileMaxDepth.assign( m_tileCount.x * m_tileCount.y, 1.0f );
+}
+
+void SoftwareDepthBuffer::rasterizeTriangles( const std::vector< float3 >& vertices, const std::vector< uint3 >& triangles, const float43& worldMatrix )
+{
+    const float44 worldViewProjection = float44( worldMatrix ) * m_viewProjection;
+
+    // Project all vertices once - vertices crossing the near plane are marked with w <= minW.
+    m_clipVertices.resize( vertices.size() );
+    for ( size_t i = 0; i < vertices.size(); ++i )
+        m_clipVertices[ i ] = float4( vertices[ i ], 1.0f ) * worldViewProjection;
+
+    const float width  = (float)m_dimensions.x;
+    const float height = (float)m_dimensions.y;
+
+    auto toScreen = [&]( const float4& clip ) 
+    {
+        const float wInverse = 1.0f / clip.w;
+
+        ScreenVertex vertex;
+        vertex.x = ( clip.x * wInverse * 0.5f + 0.5f ) * width;
+        vertex.y = ( 0.5f - clip.y * wInverse * 0.5f ) * height;
+        vertex.z = clip.z * wInverse;
+
+        return vertex;
+    };
+
+    for ( const uint3& triangle : triangles )
+    {
+        const float4& clip0 = m_clipVertices[ triangle.x ];
+        const float4& clip1 = m_clipVertices[ triangle.y ];
+        const float4& clip2 = m_clipVertices[ triangle.z ];
+
+        if ( clip0.w <= minW || clip1.w <= minW || clip2.w <= minW )
+            continue;
+
+        ScreenVertex v0 = toScreen( clip0 );
+        ScreenVertex v1 = toScreen( clip1 );
+        ScreenVertex v2 = toScreen( clip2 );
+
+        float area = edgeFunction( v0, v1, v2.x, v2.y );
+        if ( area == 0.0f )
+            continue;
+
+        // Double sided - make the winding consistent.
+        if ( area < 0.0f ) {
+            std::swap( v1, v2 );
+            area = -area;
+        }
+
+        // Pixels whose centers may be covered by the triangle.
+        const int minX = std::max( 0,                    (int)std::ceil( std::min( { v0.x, v1.x, v2.x } ) - 0.5f ) );
+        const int maxX = std::min( m_dimensions.x - 1,   (int)std::floor( std::max( { v0.x, v1.x, v2.x } ) - 0.5f ) );
+        const int minY = std::max( 0,                    (int)std::ceil( std::min( { v0.y, v1.y, v2.y } ) - 0.5f ) );
+        const int maxY = std::min( m_dimensions.y - 1,   (int)std::floor( std::max( { v0.y, v1.y, v2.y } ) - 0.5f ) );
+
+        if ( minX > maxX || minY > maxY )
+            continue;
+
+        // Edge functions and depth are linear in screen space - step them incrementally.
+        const float areaInverse = 1.0f / area;
+        const float startX      = (float)minX + 0.5f;
+        const float startY      = (float)minY + 0.5f;
+
+        const float stepX0 = -( v2.y - v1.y ), stepY0 = v2.x - v1.x;
+        const float stepX1 = -( v0.y - v2.y ), stepY1 = v0.x - v2.x;
+        const float stepX2 = -( v1.y - v0.y ), stepY2 = v1.x - v0.x;
+
+        float rowEdge0 = edgeFunction( v1, v2, startX, startY );
+        float rowEdge1 = edgeFunction( v2, v0, startX, startY );
+        float rowEdge2 = edgeFunction( v0, v1, startX, startY );
+
+        for ( int y = minY; y <= maxY; ++y )
+        {
+            float edge0 = rowEdge0;
+            float edge1 = rowEdge1;
+            float edge2 = rowEdge2;
+
+            float* depthRow = &m_depth[ y * m_dimensions.x ];
+
+            for ( int x = minX; x <= maxX; ++x )
+            {
+                if ( edge0 >= 0.0f && edge1 >= 0.0f && edge2 >= 0.0f )
+                {
+                    const float depth = ( edge0 * v0.z + edge1 * v1.z + edge2 * v2.z ) * areaInverse;
+
+                    if ( depth >= 0.0f && depth < depthRow[ x ] )
+                        depthRow[ x ] = depth;
+                }
+
+                edge0 += stepX0;
+                edge1 += stepX1;
+                edge2 += stepX2;
+            }
+
+            rowEdge0 += stepY0;
+            rowEdge1 += stepY1;
+            rowEdge2 += stepY2;
+        }
+    }
+}
+
+void SoftwareDepthBuffer::finishRasterization()
+{
+    for ( int tileY = 0; tileY < m_tileCount.y; ++tileY )
+    {
+        for ( int tileX = 0; tileX < m_tileCount.x; ++tileX )
+        {
+            const int endX = std::min( ( tileX + 1 ) * s_tileSize, m_dimensions.x );
+            const int endY = std::min( ( tileY + 1 ) * s_tileSize, m_dimensions.y );
+
+            float maxDepth = 0.0f;
+            for ( int y = tileY * s_tileSize; y < endY; ++y ) {
+                for ( int x = tileX * s_tileSize; x < endX; ++x )
+                    maxDepth = std::max( maxDepth, m_depth[ y * m_dimensions.x + x ] );
+            }
+
+            m_tileMaxDepth[ tileY * m_tileCount.x + tileX ] = maxDepth;
+        }
+    }
+}
+
+bool SoftwareDepthBuffer::isOccluded( const float3& boxMin, const float3& boxMax ) const
+{
+    if ( m_depth.empty() )
+        return false;
+
+    float minScreenX = FLT_MAX, maxScreenX = -FLT_MAX;
+    float minScreenY = FLT_MAX, maxScreenY = -FLT_MAX;
+    float minDepth   = FLT_MAX;
+
+    for ( int corner = 0; corner < 8; ++corner )
+    {
+        const float4 clip = float4(
+            corner & 1 ? boxMax.x : boxMin.x,
+            corner & 2 ? boxMax.y : boxMin.y,
+            corner & 4 ? boxMax.z : boxMin.z,
+            1.0f
+        ) * m_viewProjection;
+
+        if ( clip.w <= minW )
+            return false;
+
+        const float wInverse = 1.0f / clip.w;
+        const float screenX  = ( clip.x * wInverse * 0.5f + 0.5f ) * (float)m_dimensions.x;
+        const float screenY  = ( 0.5f - clip.y * wInverse * 0.5f ) * (float)m_dimensions.y;
+
+        minScreenX = std::min( minScreenX, screenX );
+        maxScreenX = std::max( maxScreenX, screenX );
+        minScreenY = std::min( minScreenY, screenY );
+        maxScreenY = std::max( maxScreenY, screenY );
+        minDepth   = std::min( minDepth, clip.z * wInverse );
+    }
+
+    // All pixels touched by the box's screen rectangle.
+    const int minX = std::max( 0,                  (int)std::floor( minScreenX ) );
+    const int maxX = std::min( m_dimensions.x - 1, (int)std::floor( maxScreenX ) );
+    const int minY = std::max( 0,                  (int)std::floor( minScreenY ) );
+    const int maxY = std::min( m_dimensions.y - 1, (int)std::floor( maxScreenY ) );
+
+    if ( minX > maxX || minY > maxY )
+        return false;
+
+    // Test whole tiles first and only go down to pixels for tiles with some occluder depth behind the box.
+    for ( int tileY = minY / s_tileSize; tileY <= maxY / s_tileSize; ++tileY )
+    {
+        for ( int tileX = minX / s_tileSize; tileX <= maxX / s_tileSize; ++tileX )
+        {
+            if ( m_tileMaxDepth[ tileY * m_tileCount.x + tileX ] < minDepth )
+                continue;
+
+            const int startX = std::max( minX, tileX * s_tileSize ), endX = std::min( maxX, ( tileX + 1 ) * s_tileSize - 1 );
+            const int startY = std::max( minY, tileY * s_tileSize ), endY = std::min( maxY, ( tileY + 1 ) * s_tileSize - 1 );
+
+            for ( int y = startY; y <= endY; ++y ) {
+                for ( int x = startX; x <= endX; ++x ) {
+                    if ( m_depth[ y * m_dimensions.x + x ] >= minDepth )
+                        return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+int2 SoftwareDepthBuffer::getDimensions() const
+{
+    return m_dimensions;
+}
+
+float SoftwareDepthBuffer::getDepth( const int2& pixel ) const
+{
+    return m_depth[ pixel.y * m_dimensions.x + pixel.x ];
+}
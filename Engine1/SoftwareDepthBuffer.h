@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+
+#include "int2.h"
+#include "float3.h"
+#include "float4.h"
+#include "float44.h"
+#include "uint3.h"
+
+namespace Engine1
+{
+    class float43;
+
+    // Low resolution depth buffer rasterized on the CPU - used for occlusion culling against a few large occluders, 
+    // before anything is submitted to the GPU. 
+    // Depth is post-projective z / w (D3D convention: 0 at the near plane, 1 at the far plane). Matrices are in the row-vector convention.
+    //
+    // Occluders are sampled at pixel centers, so an occluder edge may hide an object which is visible through less than a pixel
+    // (a few pixels of the full resolution image). Everything else is conservative.
+    class SoftwareDepthBuffer
+    {
+        public:
+
+        static const int s_tileSize;
+
+        SoftwareDepthBuffer();
+        ~SoftwareDepthBuffer();
+
+        // Resizes the buffer (only if dimensions changed) and clears it to the far plane.
+        void reset( const int2& dimensions, const float44& viewProjection );
+
+        // Rasterizes triangles (double sided). Triangles crossing the near plane are skipped.
+        void rasterizeTriangles( const std::vector< float3 >& vertices, const std::vector< uint3 >& triangles, const float43& worldMatrix );
+
+        // Has to be called after rasterizing all occluders and before testing any boxes.
+        void finishRasterization();
+
+        // Checks if a world space box is completely hidden behind the rasterized occluders.
+        // Boxes crossing the near plane or outside of the screen are never occluded.
+        bool isOccluded( const float3& boxMin, const float3& boxMax ) const;
+
+        int2  getDimensions() const;
+        float getDepth( const int2& pixel ) const;
+
+        private:
+
+        int2 m_dimensions;
+        int2 m_tileCount;
+
+        float44 m_viewProjection;
+
+        std::vector< float > m_depth;
+
+        // Max depth of each tile - allows to accept most boxes without testing each pixel.
+        std::vector< float > m_tileMaxDepth;
+
+        // Reused between calls to avoid allocations.
+        std::vector< float4 > m_clipVertices;
+    };
+}
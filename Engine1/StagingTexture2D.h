@@ -145,9 +145,12 @@ namespace Engine1
         HRESULT result = deviceContext.Map( m_texture.Get(), 0, D3D11_MAP_READ, 0, &mappedResource );
         if ( result < 0 ) throw std::exception( "StagingTexture2D::loadGpuToCpu - mapping texture for read failed." );
 
-        const int size = getSize();
-        m_data.resize( size );
-        std::memcpy( m_data.data(), mappedResource.pData, size );
+        m_data.resize( getWidth() * getHeight() );
+
+        // Rows of the mapped texture may be padded.
+        const int lineSize = getWidth() * getBytesPerPixel();
+        for ( int cY = 0; cY < getHeight(); ++cY )
+            std::memcpy( (char*)m_data.data() + cY * lineSize, (char*)mappedResource.pData + cY * mappedResource.RowPitch, lineSize );
 
         deviceContext.Unmap( m_texture.Get(), 0 );
     }
@@ -181,8 +184,9 @@ namespace Engine1
         const int maxY = coords.y + dimensions.y;
         
         for ( int cY = coords.y; cY < maxY; ++cY ) {
-            const int dataShift = ( cY * getWidth() + coords.x ) * getBytesPerPixel();
-            std::memcpy( (char*)m_data.data() + dataShift, (char*)mappedResource.pData + dataShift, dimensions.x * getBytesPerPixel() );
+            const int dataShift   = ( cY * getWidth() + coords.x ) * getBytesPerPixel();
+            const int mappedShift = cY * mappedResource.RowPitch + coords.x * getBytesPerPixel();
+            std::memcpy( (char*)m_data.data() + dataShift, (char*)mappedResource.pData + mappedShift, dimensions.x * getBytesPerPixel() );
         }
 
         deviceContext.Unmap( m_texture.Get(), 0 );
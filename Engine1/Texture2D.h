@@ -15,6 +15,7 @@
 #include "ImageLibrary.h"
 #include "BinaryFile.h"
 #include "TextureBase.h"
+#include "MipmapGenerator.h"
 
 #include "DX11Util.h"
 
@@ -66,7 +67,7 @@ namespace Engine1
         void unloadFromCpu();
         void unloadFromGpu();
 
-		void createMipmapsOnCpu(const int width, const int height, const int maxMipmapLevel = 0);
+		void createMipmapsOnCpu(const int width, const int height, const int maxMipmapLevel = 0, const MipmapGenerator::Options& options = MipmapGenerator::Options());
 		void createMipMapsOnGpu(ID3D11DeviceContext3& deviceContext);
 
         int  getMipMapCountOnCpu()  const;
@@ -180,9 +181,6 @@ namespace Engine1
         D3D11_MAP    getMapForWriteFlag();
 		unsigned int getTextureMiscFlags();
 
-        // Special averaging method used to avoid overflow for small integer types during mipmap calculations.
-        PixelType average( PixelType val1, PixelType val2, PixelType val3, PixelType val4 ) const;
-
         PixelType weightedAverage( 
             PixelType val1, float weight1, 
             PixelType val2, float weight2, 
@@ -609,7 +607,7 @@ namespace Engine1
 
     template< typename PixelType >
     void Texture2D< PixelType >
-        ::createMipmapsOnCpu( const int width, const int height, const int maxMipmapLevel )
+        ::createMipmapsOnCpu( const int width, const int height, const int maxMipmapLevel, const MipmapGenerator::Options& options )
     {
         // If there is no image or it's 1x1 pixel - return.
         if ( m_dataMipmaps.empty() || m_dataMipmaps.front().size() <= 1 )
@@ -627,41 +625,22 @@ namespace Engine1
         // Loop until last mipmap is 1x1 pixel or we hit max given mipmap level.
         while ( m_dataMipmaps.back().size() > 1 && ( maxMipmapLevel <= 0 || m_dataMipmaps.size() <= maxMipmapLevel ) )
         {
-            const std::vector< PixelType >& prevMipmap = m_dataMipmaps.back();
-
             // Add next empty mipmap.
             m_dataMipmaps.push_back( std::vector< PixelType >() );
-            auto& nextMipmap = m_dataMipmaps.back();
+
+            const std::vector< PixelType >& prevMipmap = m_dataMipmaps[ m_dataMipmaps.size() - 2 ];
+            std::vector< PixelType >&       nextMipmap = m_dataMipmaps.back();
 
             const int nextMipmapWidth  = std::max( 1, prevMipmapWidth / 2 );
             const int nextMipmapHeight = std::max( 1, prevMipmapHeight / 2 );
 
             nextMipmap.resize( nextMipmapWidth * nextMipmapHeight );
 
-            for ( int y = 0; y < nextMipmapHeight; ++y )
-            {
-                for ( int x = 0; x < nextMipmapWidth; ++x ) 
-                {
-                    // Restrict pixel coords to avoid reading outside of texture.
-                    const int topRowY      = 2 * y;
-                    const int bottomRowY   = std::min( prevMipmapHeight - 1, 2 * y + 1 );
-                    const int leftColumnX  = 2 * x;
-                    const int rightColumnX = std::min( prevMipmapWidth - 1, 2 * x + 1 );
-
-                    const int topLeftIdx     = topRowY    * prevMipmapWidth + leftColumnX;
-                    const int topRightIdx    = topRowY    * prevMipmapWidth + rightColumnX;
-                    const int bottomLeftIdx  = bottomRowY * prevMipmapWidth + leftColumnX;
-                    const int bottomRightIdx = bottomRowY * prevMipmapWidth + rightColumnX;
-
-                    nextMipmap[ y * nextMipmapWidth + x ] = 
-                        average(
-                            prevMipmap[ topLeftIdx ],
-                            prevMipmap[ topRightIdx ],
-                            prevMipmap[ bottomLeftIdx ],
-                            prevMipmap[ bottomRightIdx ]
-                        );
-                }
-            }
+            MipmapGenerator::downsample( 
+                prevMipmap.data(), prevMipmapWidth, prevMipmapHeight, 
+                nextMipmap.data(), nextMipmapWidth, nextMipmapHeight, 
+                options 
+            );
 
             prevMipmapWidth  = nextMipmapWidth;
             prevMipmapHeight = nextMipmapHeight;
@@ -1188,45 +1167,6 @@ namespace Engine1
         return result;
     }
 
-    template<>
-    inline unsigned char Texture2D< unsigned char >
-        ::average( unsigned char val1, unsigned char val2, unsigned char val3, unsigned char val4 ) const
-    {
-        // Note: Unsafe cast to smaller type.
-        return (unsigned char)( ((int)val1 + (int)val2 + (int)val3 + (int)val4) / 4 );
-    }
-
-    template<>
-    inline uchar4 Texture2D< uchar4 >
-        ::average( uchar4 val1, uchar4 val2, uchar4 val3, uchar4 val4 ) const
-    {
-        uint4 value = ((uint4)val1 + (uint4)val2 + (uint4)val3 + (uint4)val4) / 4;
-
-        // Note: Unsafe cast to smaller type.
-        return uchar4( (unsigned char)value.x, (unsigned char)value.y, (unsigned char)value.z, (unsigned char)value.w );
-    }
-
-    template<>
-    inline float Texture2D< float >
-        ::average( float val1, float val2, float val3, float val4 ) const
-    {
-        return (val1 + val2 + val3 + val4) / 4.0f;
-    }
-
-    template<>
-    inline float3 Texture2D< float3 >
-        ::average( float3 val1, float3 val2, float3 val3, float3 val4 ) const
-    {
-        return (val1 + val2 + val3 + val4) / 4.0f;
-    }
-
-    template<>
-    inline float4 Texture2D< float4 >
-        ::average( float4 val1, float4 val2, float4 val3, float4 val4 ) const
-    {
-        return (val1 + val2 + val3 + val4) / 4.0f;
-    }
-
     template<>
     inline unsigned char Texture2D< unsigned char >
         ::weightedAverage( 
@@ -0,0 +1,318 @@
+#include "TextureAtlasPacker.h"
+
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <limits>
+
+using namespace Engine1;
+
+namespace
+{
+    struct Rect
+    {
+        int x, y, width, height;
+
+        bool intersects( const Rect& other ) const
+        {
+            return x < other.x + other.width && other.x < x + width
+                && y < other.y + other.height && other.y < y + height;
+        }
+
+        bool contains( const Rect& other ) const
+        {
+            return other.x >= x && other.y >= y
+                && other.x + other.width <= x + width && other.y + other.height <= y + height;
+        }
+    };
+
+    // Keeps a list of maximal free rectangles (which may overlap each other).
+    class MaxRectsBin
+    {
+        public:
+
+        MaxRectsBin( const int2 dimensions )
+        {
+            m_freeRects.push_back( { 0, 0, dimensions.x, dimensions.y } );
+        }
+
+        bool insert( const int2 dimensions, Rect& placedRect )
+        {
+            // Best-short-side-fit - choose the free rectangle which leaves the least space along its shorter side.
+            int bestShortSideFit = std::numeric_limits< int >::max();
+            int bestLongSideFit  = std::numeric_limits< int >::max();
+            int bestIndex        = -1;
+
+            for ( int i = 0; i < (int)m_freeRects.size(); ++i ) {
+                const Rect& freeRect = m_freeRects[ i ];
+
+                if ( freeRect.width < dimensions.x || freeRect.height < dimensions.y )
+                    continue;
+
+                const int leftoverX    = freeRect.width - dimensions.x;
+                const int leftoverY    = freeRect.height - dimensions.y;
+                const int shortSideFit = std::min( leftoverX, leftoverY );
+                const int longSideFit  = std::max( leftoverX, leftoverY );
+
+                if ( shortSideFit < bestShortSideFit || ( shortSideFit == bestShortSideFit && longSideFit < bestLongSideFit ) ) {
+                    bestShortSideFit = shortSideFit;
+                    bestLongSideFit  = longSideFit;
+                    bestIndex        = i;
+                }
+            }
+
+            if ( bestIndex < 0 )
+                return false;
+
+            placedRect = { m_freeRects[ bestIndex ].x, m_freeRects[ bestIndex ].y, dimensions.x, dimensions.y };
+
+            splitFreeRects( placedRect );
+            pruneFreeRects();
+
+            return true;
+        }
+
+        private:
+
+        // Replaces each free rectangle overlapping the placed one with up to four maximal rectangles around it.
+        void splitFreeRects( const Rect& placedRect )
+        {
+            const int freeRectCount = (int)m_freeRects.size();
+            for ( int i = 0; i < freeRectCount; ++i ) {
+                const Rect freeRect = m_freeRects[ i ];
+
+                if ( !freeRect.intersects( placedRect ) )
+                    continue;
+
+                if ( placedRect.x > freeRect.x )
+                    m_freeRects.push_back( { freeRect.x, freeRect.y, placedRect.x - freeRect.x, freeRect.height } );
+
+                if ( placedRect.x + placedRect.width < freeRect.x + freeRect.width )
+                    m_freeRects.push_back( { placedRect.x + placedRect.width, freeRect.y, freeRect.x + freeRect.width - placedRect.x - placedRect.width, freeRect.height } );
+
+                if ( placedRect.y > freeRect.y )
+                    m_freeRects.push_back( { freeRect.x, freeRect.y, freeRect.width, placedRect.y - freeRect.y } );
+
+                if ( placedRect.y + placedRect.height < freeRect.y + freeRect.height )
+                    m_freeRects.push_back( { freeRect.x, placedRect.y + placedRect.height, freeRect.width, freeRect.y + freeRect.height - placedRect.y - placedRect.height } );
+
+                m_freeRects[ i ].width = 0; // Mark for removal.
+            }
+        }
+
+        // Removes split rectangles and rectangles fully contained in other free rectangles.
+        void pruneFreeRects()
+        {
+            m_freeRects.erase(
+                std::remove_if( m_freeRects.begin(), m_freeRects.end(), []( const Rect& rect ) { return rect.width == 0; } ),
+                m_freeRects.end()
+            );
+
+            for ( int i = 0; i < (int)m_freeRects.size(); ++i ) {
+                for ( int j = i + 1; j < (int)m_freeRects.size(); ) {
+                    if ( m_freeRects[ i ].contains( m_freeRects[ j ] ) ) {
+                        m_freeRects.erase( m_freeRects.begin() + j );
+                    } else if ( m_freeRects[ j ].contains( m_freeRects[ i ] ) ) {
+                        m_freeRects.erase( m_freeRects.begin() + i );
+                        --i;
+                        break;
+                    } else {
+                        ++j;
+                    }
+                }
+            }
+        }
+
+        std::vector< Rect > m_freeRects;
+    };
+}
+
+float TextureAtlasPacker::Result::getEfficiency() const
+{
+    long long totalArea = 0;
+    for ( const int2& dimensions : pageDimensions )
+        totalArea += (long long)dimensions.x * dimensions.y;
+
+    return totalArea > 0 ? (float)( (double)usedArea / (double)totalArea ) : 0.0f;
+}
+
+TextureAtlasPacker::Result TextureAtlasPacker::pack( const std::vector< int2 >& dimensions, const Options& options )
+{
+    if ( options.maxPageSize <= 0 || options.gutter < 0 )
+        throw std::exception( "TextureAtlasPacker::pack - incorrect options passed." );
+
+    const int count = (int)dimensions.size();
+
+    Result result;
+    result.placements.resize( count, { 0, int2::ZERO } );
+    result.usedArea = 0;
+
+    if ( count == 0 )
+        return result;
+
+    std::vector< int2 > paddedDimensions;
+    paddedDimensions.reserve( count );
+
+    long long paddedArea = 0;
+    int2      maxPaddedDimensions( 0, 0 );
+
+    for ( const int2& rectDimensions : dimensions ) {
+        if ( rectDimensions.x <= 0 || rectDimensions.y <= 0 )
+            throw std::exception( "TextureAtlasPacker::pack - one of the rectangles has zero or negative dimensions." );
+
+        const int2 padded = rectDimensions + int2( 2 * options.gutter, 2 * options.gutter );
+
+        if ( padded.x > options.maxPageSize || padded.y > options.maxPageSize )
+            throw std::exception( "TextureAtlasPacker::pack - one of the rectangles (with gutter) is larger than the maximal page size." );
+
+        paddedDimensions.push_back( padded );
+
+        result.usedArea       += (long long)rectDimensions.x * rectDimensions.y;
+        paddedArea            += (long long)padded.x * padded.y;
+        maxPaddedDimensions.x  = std::max( maxPaddedDimensions.x, padded.x );
+        maxPaddedDimensions.y  = std::max( maxPaddedDimensions.y, padded.y );
+    }
+
+    // Place the largest rectangles first - by the longer side, then by the shorter side.
+    std::vector< int > sortedIndices( count );
+    std::iota( sortedIndices.begin(), sortedIndices.end(), 0 );
+    std::stable_sort( sortedIndices.begin(), sortedIndices.end(), [ &paddedDimensions ]( const int index1, const int index2 ) {
+        const int2& dimensions1 = paddedDimensions[ index1 ];
+        const int2& dimensions2 = paddedDimensions[ index2 ];
+
+        const int maxDimension1 = std::max( dimensions1.x, dimensions1.y ), maxDimension2 = std::max( dimensions2.x, dimensions2.y );
+        if ( maxDimension1 != maxDimension2 )
+            return maxDimension1 > maxDimension2;
+
+        return std::min( dimensions1.x, dimensions1.y ) > std::min( dimensions2.x, dimensions2.y );
+    } );
+
+    { // Try to fit everything in a single page - for a range of page widths find the smallest height which holds all the rectangles
+      // and keep the layout with the smallest area.
+        const int minSide = (int)std::ceil( std::sqrt( (double)paddedArea ) );
+
+        const int minWidth = std::min( options.maxPageSize, roundUpToMultipleOf4( std::max( maxPaddedDimensions.x, minSide * 3 / 4 ) ) );
+        const int maxWidth = options.maxPageSize;
+
+        long long                bestArea = std::numeric_limits< long long >::max();
+        std::vector< Placement > placements( count );
+        // Failed packs leave partial layouts - attempts are made here and kept only if successful.
+        std::vector< Placement > attemptPlacements( count );
+
+        // Very wide pages are only checked until any layout is found.
+        for ( int width = minWidth; width <= maxWidth && ( result.pageDimensions.empty() || width <= minSide * 2 ); width = width < maxWidth ? std::min( maxWidth, width + std::max( 4, roundUpToMultipleOf4( width / 16 ) ) ) : maxWidth + 1 ) {
+            int2 usedDimensions;
+
+            // Check if the rectangles fit at all with this width.
+            int maxHeight = options.maxPageSize;
+            if ( !packSinglePage( paddedDimensions, sortedIndices, int2( width, maxHeight ), placements, usedDimensions ) )
+                continue;
+
+            // Binary search for the smallest height (in steps of 4 pixels). Placements of the last successful pack are kept - 
+            // packing again into the final height could fail or produce a different layout.
+            int minHeight = std::min( maxHeight, roundUpToMultipleOf4( std::max( maxPaddedDimensions.y, (int)( ( paddedArea + width - 1 ) / width ) ) ) );
+            maxHeight     = std::min( maxHeight, roundUpToMultipleOf4( usedDimensions.y ) );
+            while ( maxHeight - minHeight >= 4 ) {
+                const int height = std::min( maxHeight - 4, roundUpToMultipleOf4( ( minHeight + maxHeight ) / 2 ) );
+
+                int2 attemptUsedDimensions;
+                if ( packSinglePage( paddedDimensions, sortedIndices, int2( width, height ), attemptPlacements, attemptUsedDimensions ) ) {
+                    placements.swap( attemptPlacements );
+                    usedDimensions = attemptUsedDimensions;
+                    maxHeight      = std::min( height, roundUpToMultipleOf4( usedDimensions.y ) );
+                } else {
+                    minHeight = height + 4;
+                }
+            }
+
+            const int2 pageDimensions(
+                std::min( options.maxPageSize, roundUpToMultipleOf4( usedDimensions.x ) ),
+                std::min( options.maxPageSize, roundUpToMultipleOf4( usedDimensions.y ) )
+            );
+
+            const long long area = (long long)pageDimensions.x * pageDimensions.y;
+            if ( area < bestArea ) {
+                bestArea = area;
+
+                result.pageDimensions = { pageDimensions };
+                result.placements     = placements;
+            }
+        }
+    }
+
+    if ( result.pageDimensions.empty() )
+    {
+        // Doesn't fit in a single page - fill pages of maximal size one by one.
+        std::vector< int > remainingIndices = sortedIndices;
+
+        while ( !remainingIndices.empty() ) {
+            const int pageIndex      = (int)result.pageDimensions.size();
+            const int remainingCount = (int)remainingIndices.size();
+
+            int2 usedDimensions;
+            packPage( paddedDimensions, remainingIndices, int2( options.maxPageSize, options.maxPageSize ), pageIndex, result.placements, usedDimensions );
+
+            if ( (int)remainingIndices.size() == remainingCount )
+                throw std::exception( "TextureAtlasPacker::pack - failed to place any rectangle on an empty page." );
+
+            result.pageDimensions.push_back( int2(
+                std::min( options.maxPageSize, roundUpToMultipleOf4( usedDimensions.x ) ),
+                std::min( options.maxPageSize, roundUpToMultipleOf4( usedDimensions.y ) )
+            ) );
+        }
+    }
+
+    // Placements should point at the rectangles themselves, not their gutters.
+    for ( Placement& placement : result.placements )
+        placement.topLeft += int2( options.gutter, options.gutter );
+
+    return result;
+}
+
+bool TextureAtlasPacker::packPage(
+    const std::vector< int2 >& paddedDimensions,
+    std::vector< int >& remainingIndices,
+    const int2 pageDimensions,
+    const int pageIndex,
+    std::vector< Placement >& placements,
+    int2& usedDimensions )
+{
+    MaxRectsBin bin( pageDimensions );
+
+    usedDimensions = int2::ZERO;
+
+    std::vector< int > notPlacedIndices;
+    for ( const int index : remainingIndices ) {
+        Rect placedRect;
+        if ( bin.insert( paddedDimensions[ index ], placedRect ) ) {
+            placements[ index ].pageIndex = pageIndex;
+            placements[ index ].topLeft   = int2( placedRect.x, placedRect.y );
+
+            usedDimensions.x = std::max( usedDimensions.x, placedRect.x + placedRect.width );
+            usedDimensions.y = std::max( usedDimensions.y, placedRect.y + placedRect.height );
+        } else {
+            notPlacedIndices.push_back( index );
+        }
+    }
+
+    remainingIndices.swap( notPlacedIndices );
+
+    return remainingIndices.empty();
+}
+
+bool TextureAtlasPacker::packSinglePage(
+    const std::vector< int2 >& paddedDimensions,
+    const std::vector< int >& sortedIndices,
+    const int2 pageDimensions,
+    std::vector< Placement >& placements,
+    int2& usedDimensions )
+{
+    std::vector< int > remainingIndices = sortedIndices;
+
+    return packPage( paddedDimensions, remainingIndices, pageDimensions, 0, placements, usedDimensions );
+}
+
+int TextureAtlasPacker::roundUpToMultipleOf4( const int value )
+{
+    return ( value + 3 ) & ~3;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+
+#include "int2.h"
+
+namespace Engine1
+{
+    // Packs rectangles of arbitrary dimensions into one or more atlas pages using the MaxRects algorithm
+    // (best-short-side-fit heuristic). Rectangles are not rotated.
+    // Each rectangle is surrounded by a gutter, which is later filled by repeating the edge pixels of the texture
+    // - this prevents neighboring textures from bleeding into each other with bilinear filtering and lower mipmaps.
+    // Pure CPU - doesn't touch any textures, only computes the placements.
+    class TextureAtlasPacker
+    {
+        public:
+
+        struct Options
+        {
+            Options( const int maxPageSize = 4096, const int gutter = 4 ) :
+                maxPageSize( maxPageSize ),
+                gutter( gutter )
+            {}
+
+            int maxPageSize; // Maximal width and height of a single page (in pixels).
+            int gutter;      // Padding added on each side of each rectangle (in pixels).
+        };
+
+        struct Placement
+        {
+            int  pageIndex;
+            int2 topLeft;   // Position of the rectangle within the page, excluding the gutter (in pixels).
+        };
+
+        struct Result
+        {
+            std::vector< int2 >      pageDimensions;
+            std::vector< Placement > placements; // Ordered the same as the input rectangles.
+
+            long long usedArea; // Sum of input rectangle areas (without gutters).
+
+            // Ratio of the used area to the total area of all pages.
+            float getEfficiency() const;
+        };
+
+        // Tries to fit all the rectangles in a single page with the smallest area (searching over page widths and heights).
+        // Rectangles which don't fit within maxPageSize are moved to next pages.
+        // Page dimensions are multiples of 4 to keep the atlas block-compression friendly.
+        static Result pack( const std::vector< int2 >& dimensions, const Options& options = Options() );
+
+        private:
+
+        // Returns false if some rectangles couldn't be placed within a page of given dimensions.
+        // Rectangles which have been placed are removed from the remaining indices.
+        static bool packPage(
+            const std::vector< int2 >& paddedDimensions,
+            std::vector< int >& remainingIndices,
+            const int2 pageDimensions,
+            const int pageIndex,
+            std::vector< Placement >& placements,
+            int2& usedDimensions
+        );
+
+        static bool packSinglePage(
+            const std::vector< int2 >& paddedDimensions,
+            const std::vector< int >& sortedIndices,
+            const int2 pageDimensions,
+            std::vector< Placement >& placements,
+            int2& usedDimensions
+        );
+
+        static int roundUpToMultipleOf4( const int value );
+    };
+}
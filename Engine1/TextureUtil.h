@@ -3,125 +3,28 @@
 #include <memory>
 #include <vector>
 #include <algorithm>
+#include <tuple>
+#include <cstring>
+#include <cmath>
 
 #include "Texture2DTypes.h"
 
 #include "MathUtil.h"
+#include "JobSystem.h"
+#include "TextureAtlasPacker.h"
 
-#include "int3.h"
+#include "int2.h"
 #include "float2.h"
 
 namespace Engine1
 {
     class TextureUtil
     {
-        private:
-
-        class TextureBin
-        {
-            private:
-
-            int2 m_dimensions;
-            bool m_horizontal; // Matters only if bin has children.
-
-            std::unique_ptr< TextureBin > m_firstChild, m_secondChild;
-
-            bool m_empty;
-
-            public:
-
-            TextureBin( const int2 textureDimensions, bool empty ) :
-                m_dimensions( textureDimensions ),
-                m_horizontal( false ),
-                m_empty( empty )
-            {} // Should check texture dimensions in constructor?
-
-            int2 getDimensions()
-            {
-                return m_dimensions;
-            }
-
-            // Assumption - no texture should be bigger than the bin it is inserted into.
-            // Returns true if insertion has succeeded and a position (in pixels) of the inserted texture within the merged texture.
-            std::pair< bool, int2 > insert( const int2 textureDimensions )
-            {
-                if ( !m_empty || m_dimensions.x < textureDimensions.x || m_dimensions.y < textureDimensions.y )
-                    return std::make_pair( false, int2::ZERO ); // This bin is already filled or it's too small - cannot insert.
-
-                // This bin has sufficient size.
-                // If this bin already has children (is divided) - try to insert in one of them.
-                if ( m_firstChild || m_secondChild ) {
-                    std::pair< bool, int2 > inserted;
-                    if ( m_firstChild )
-                        inserted = m_firstChild->insert( textureDimensions );
-
-                    if ( m_secondChild && !inserted.first )
-                    {
-                        inserted = m_secondChild->insert( textureDimensions );
-
-                        // Add half of bin's width/height to the returned texture's position 
-                        // - because it was placed in the second child.
-                        if ( inserted.first )
-                            inserted.second += m_horizontal ? int2( m_dimensions.x / 2, 0 ) : int2( 0, m_dimensions.y / 2 );
-                    }
-
-                    return inserted;
-                } else // This bin doesn't have children (isn't divided).
-                {
-                    if ( m_dimensions.x == textureDimensions.x && m_dimensions.y == textureDimensions.y ) {
-                        m_empty = false; // This bin has exactly the size of the texture - fill it.
-
-                        return std::make_pair( true, int2::ZERO );
-                    } else {
-                        // This bin is too wide - divide horizontally, too high - divide vertically.
-                        const bool divideHorizontally = m_dimensions.x > textureDimensions.x;
-                        divide( divideHorizontally );
-
-                        // Try to insert again.
-                        return insert( textureDimensions );
-                    }
-                }
-            }
-
-            // Can only be called on the root bin (without parent).
-            // The bin creates a new enlarged root bin and attaches to it as one of its children.
-            // Returns the new root bin.
-            static std::unique_ptr< TextureBin > enlarge( std::unique_ptr< TextureBin >& rootBin )
-            {
-                std::unique_ptr< TextureBin > neighborBin = std::make_unique< TextureBin >( rootBin->m_dimensions, true );
-
-                const bool horizontal = rootBin->m_dimensions.x <= rootBin->m_dimensions.y;
-                const int  newWidth   = horizontal ? rootBin->m_dimensions.x * 2 : rootBin->m_dimensions.x;
-                const int  newHeight  = !horizontal ? rootBin->m_dimensions.y * 2 : rootBin->m_dimensions.y;
-
-                std::unique_ptr< TextureBin > newRootBin = std::make_unique< TextureBin >( int2( newWidth, newHeight ), true );
-
-                // Attach the children to the new root bin.
-                newRootBin->m_horizontal = horizontal;
-                newRootBin->m_firstChild = std::move( rootBin ); // Enlarged bin becomes the first child.
-                newRootBin->m_secondChild = std::move( neighborBin );
-
-                return newRootBin;
-            }
-
-            private:
-
-            void divide( const bool horizontally )
-            {
-                assert( m_empty ); // Only an empty bin can be divided.
-
-                int2 newDimensions;
-                newDimensions.x =  horizontally ? m_dimensions.x / 2 : m_dimensions.x;
-                newDimensions.y = !horizontally ? m_dimensions.y / 2 : m_dimensions.y;
-
-                m_horizontal  = horizontally;
-                m_firstChild  = std::make_unique< TextureBin >( newDimensions, true );
-                m_secondChild = std::make_unique< TextureBin >( newDimensions, true );
-            }
-        };
-
         public:
 
+        // Copies source region into destination region - directly (row by row) if the regions have the same size 
+        // and the color multiplier equals (1,1,1,1), otherwise with bilinear re-sampling. Rows are processed in parallel.
+        // Destination region is surrounded by a gutter of given width (in pixels), filled by repeating the edge pixels of the region.
         template< typename PixelType >
         static void copyTextureCpu( 
             Texture2D< PixelType >& destTexture, 
@@ -130,12 +33,14 @@ namespace Engine1
             float2 destBottomRightTexcoords,
             float2 srcTopLeftTexcoords, 
             float2 srcBottomRightTexcoords,
-            float4 colorMultiplier = float4::ONE )
+            float4 colorMultiplier = float4::ONE,
+            const int gutter = 0 )
         {
             if ( srcTopLeftTexcoords.x < 0.0f || srcBottomRightTexcoords.x < srcTopLeftTexcoords.x || srcBottomRightTexcoords.x > 1.0f
                  || srcTopLeftTexcoords.y < 0.0f || srcBottomRightTexcoords.y < srcTopLeftTexcoords.y || srcBottomRightTexcoords.y > 1.0f
                  || destTopLeftTexcoords.x < 0.0f || destBottomRightTexcoords.x < destTopLeftTexcoords.x || destBottomRightTexcoords.x > 1.0f
-                 || destTopLeftTexcoords.y < 0.0f || destBottomRightTexcoords.y < destTopLeftTexcoords.y || destBottomRightTexcoords.y > 1.0f ) 
+                 || destTopLeftTexcoords.y < 0.0f || destBottomRightTexcoords.y < destTopLeftTexcoords.y || destBottomRightTexcoords.y > 1.0f
+                 || gutter < 0 ) 
             {
                 throw std::exception( "TextureUtil::copyTexture - incorrect region defined." );
             }
@@ -143,10 +48,14 @@ namespace Engine1
             const int2 srcDimensions  = srcTexture.getDimensions();
             const int2 destDimensions = destTexture.getDimensions();
 
-            const int2 srcTopLeft           = (int2)(srcTopLeftTexcoords * (float2)srcDimensions);
-            const int2 srcRegionDimensions  = (int2)((srcBottomRightTexcoords - srcTopLeftTexcoords) * (float2)srcDimensions);
-            const int2 destTopLeft          = (int2)(destTopLeftTexcoords * (float2)destDimensions);
-            const int2 destRegionDimensions = (int2)((destBottomRightTexcoords - destTopLeftTexcoords) * (float2)destDimensions);
+            // Rounding (instead of truncation) keeps regions exact for non-power-of-two textures.
+            const int2 srcTopLeft           = toPixels( srcTopLeftTexcoords, srcDimensions );
+            const int2 srcRegionDimensions  = toPixels( srcBottomRightTexcoords, srcDimensions ) - srcTopLeft;
+            const int2 destTopLeft          = toPixels( destTopLeftTexcoords, destDimensions );
+            const int2 destRegionDimensions = toPixels( destBottomRightTexcoords, destDimensions ) - destTopLeft;
+
+            if ( destRegionDimensions.x <= 0 || destRegionDimensions.y <= 0 )
+                return;
 
             const std::vector< PixelType >& srcData  = srcTexture.getData();
             std::vector< PixelType >&       destData = destTexture.getData();
@@ -158,15 +67,18 @@ namespace Engine1
                 // and color multiplier equals (1,1,1,1).
                 const int2 dimensions = srcRegionDimensions;
 
-                for ( int y = 0; y < dimensions.y; ++y )
+                JobSystem::get().parallelFor( dimensions.y, s_minRowCountPerJob, [ & ]( const int beginY, const int endY )
                 {
-                    // Copy one line of data.
-                    std::memcpy( 
-                        &destData[ (destTopLeft.y + y) * destDimensions.x + destTopLeft.x ],
-                        &srcData[ (srcTopLeft.y + y) * srcDimensions.x + srcTopLeft.x ],
-                        dimensions.x * sizeof( PixelType )
-                    );
-                }
+                    for ( int y = beginY; y < endY; ++y )
+                    {
+                        // Copy one line of data.
+                        std::memcpy( 
+                            &destData[ (destTopLeft.y + y) * destDimensions.x + destTopLeft.x ],
+                            &srcData[ (srcTopLeft.y + y) * srcDimensions.x + srcTopLeft.x ],
+                            dimensions.x * sizeof( PixelType )
+                        );
+                    }
+                } );
             }
             else
             {
@@ -174,115 +86,58 @@ namespace Engine1
                 // as source and destination regions have different dimensions.
                 const float2 srcTexcoordsSpan = srcBottomRightTexcoords - srcTopLeftTexcoords;
 
-                int2 destPos;
-                for ( destPos.y = 0; destPos.y < destRegionDimensions.y; ++destPos.y )
+                JobSystem::get().parallelFor( destRegionDimensions.y, s_minRowCountPerJob, [ & ]( const int beginY, const int endY )
                 {
-                    for ( destPos.x = 0; destPos.x < destRegionDimensions.x; ++destPos.x )
+                    int2 destPos;
+                    for ( destPos.y = beginY; destPos.y < endY; ++destPos.y )
                     {
-                        const float2 srcTexcoords = srcTopLeftTexcoords + srcTexcoordsSpan * ((float2)destPos / (float2)destRegionDimensions);
+                        for ( destPos.x = 0; destPos.x < destRegionDimensions.x; ++destPos.x )
+                        {
+                            const float2 srcTexcoords = srcTopLeftTexcoords + srcTexcoordsSpan * ((float2)destPos / (float2)destRegionDimensions);
 
-                        const PixelType srcPixel = srcTexture.sampleBilinearData( srcTexcoords, 0 );
+                            const PixelType srcPixel = srcTexture.sampleBilinearData( srcTexcoords, 0 );
 
-                        destData[ (destTopLeft.y + destPos.y) * destDimensions.x + destTopLeft.x + destPos.x ] = (PixelType)(float4( srcPixel ) * colorMultiplier);
+                            destData[ (destTopLeft.y + destPos.y) * destDimensions.x + destTopLeft.x + destPos.x ] = (PixelType)(float4( srcPixel ) * colorMultiplier);
+                        }
                     }
-                }
+                } );
             }
+
+            if ( gutter > 0 )
+                fillGutter( destData, destDimensions, destTopLeft, destRegionDimensions, gutter );
         }
 
         // Textures are not rotated during merge (for simplicity).
-        // Returns merged texture dimensions and a vector of texcoords 
-        // (for top-left and bottom-right corner) describing where input textures 
-        // need to be placed within the merged texture.
+        // Returns the atlas layout (page dimensions, page index of each texture, packing efficiency) and a vector of texcoords 
+        // (for top-left and bottom-right corner, relative to the texture's page) describing where input textures 
+        // need to be placed within the merged textures. Gutters are not included in the texcoords.
         // Order of vector of texcoords is the same as the order of input textures. 
-        static std::tuple< int2, std::vector< std::pair< float2, float2 > > >
-        prepareTextureMerge( const std::vector< int2 >& texturesDimensions )
+        static std::tuple< TextureAtlasPacker::Result, std::vector< std::pair< float2, float2 > > >
+        prepareTextureMerge( const std::vector< int2 >& texturesDimensions, const TextureAtlasPacker::Options& options = TextureAtlasPacker::Options() )
         {
-            for ( auto& dimensions : texturesDimensions ) {
-                if ( !MathUtil::isPowerOfTwo( dimensions.x ) || !MathUtil::isPowerOfTwo( dimensions.y ) )
-                    throw std::exception( "TextureUtil::prepareTextureMerge - one of the textures does not have power-of-two dimensions." );
-            }
+            const TextureAtlasPacker::Result layout = TextureAtlasPacker::pack( texturesDimensions, options );
 
             const int textureCount = (int)texturesDimensions.size();
 
-            // Copy input vector, store element's index within input vector as an extra component.
-            std::vector< int3 > sortedTextures;
-            sortedTextures.reserve( textureCount );
-            for( int idx = 0; idx < textureCount; ++idx )
-            {
-                sortedTextures.emplace_back( 
-                    texturesDimensions[ idx ].x, 
-                    texturesDimensions[ idx ].y, 
-                    idx 
-                );
-            }
-
-            // Sort textures by increasing dimensions.
-            std::sort( 
-                sortedTextures.begin(), 
-                sortedTextures.end(), 
-                []( const int3& texture1, const int3& texture2 )
-                { 
-                    const int tex1MaxDimension = std::max( texture1.x, texture1.y );
-                    const int tex1MinDimension = std::min( texture1.x, texture1.y );
-                    const int tex2MaxDimension = std::max( texture2.x, texture2.y );
-                    const int tex2MinDimension = std::min( texture2.x, texture2.y );
-
-                    // Note: Handle cases where the maximal dimensions are the same, 
-                    // but smaller one are different: Ex. (256, 128) vs (256, 64).
-                    if ( tex1MaxDimension > tex2MaxDimension )       return false;
-                    else if ( tex2MaxDimension > tex1MaxDimension )  return true;
-                    else if ( tex1MinDimension >= tex2MinDimension ) return false;
-                    else                                             return true;
-                }
-            );
-
-            auto rootBin = std::make_unique< TextureBin >( (int2)sortedTextures.back(), false );
-
-            std::vector< int2 > positionsTemp;
-            positionsTemp.resize( textureCount, int2::ZERO );
-
-            { // Insert textures in the bin.
-                int idx = (int)textureCount - 2;
-                while ( idx >= 0 )
-                {
-                    std::pair< bool, int2 > inserted = rootBin->insert( (int2)sortedTextures[ idx ] );
-                    if ( inserted.first )
-                    {
-                        positionsTemp[ idx ] = inserted.second;
-
-                        --idx; // Insertion succeeded - continue.
-                    }
-                    else
-                    {
-                        // Insertion failed - enlarge the root bin.
-                        rootBin = TextureBin::enlarge( rootBin ); 
-                    }
-                }
-            }
-
-            // Create a vector of texcoords describing 
-            // where to place input texture within the merged texture.
-            // (for left-top and bottom-right corners) 
-            // (ordered the same as input vector of texture dimensions).
             std::vector< std::pair< float2, float2 > > texcoords;
             texcoords.resize( textureCount );
-            for ( int sortedIdx = 0; sortedIdx < textureCount; ++sortedIdx )
+            for ( int idx = 0; idx < textureCount; ++idx )
             {
-                const int idxInInputVector = sortedTextures[ sortedIdx ].z;
+                const TextureAtlasPacker::Placement& placement      = layout.placements[ idx ];
+                const float2                         pageDimensions = (float2)layout.pageDimensions[ placement.pageIndex ];
 
                 // Top-left corner texcoords.
-                texcoords[ idxInInputVector ].first  
-                    = (float2)positionsTemp[ sortedIdx ] / (float2)rootBin->getDimensions();
+                texcoords[ idx ].first  = (float2)placement.topLeft / pageDimensions;
 
                 // Bottom-right corner texcoords.
-                texcoords[ idxInInputVector ].second 
-                    = (float2)( positionsTemp[ sortedIdx ] + texturesDimensions[ idxInInputVector ] ) / (float2)rootBin->getDimensions();
+                texcoords[ idx ].second = (float2)( placement.topLeft + texturesDimensions[ idx ] ) / pageDimensions;
             }
 
-            return std::make_tuple( rootBin->getDimensions(), texcoords );
+            return std::make_tuple( layout, texcoords );
         }
 
         // Textures are not rotated during merge (for simplicity).
+        // Gutter (in pixels of the merged texture) is filled around each texture.
         // Returns the merged texture or nullptr if merge failed.
         template< typename PixelType >
         static std::shared_ptr< RenderTargetTexture2D< PixelType > >
@@ -293,7 +148,8 @@ namespace Engine1
             const int2 mergedTextureDimensions,
             ID3D11Device3& device,
             DXGI_FORMAT textureFormat, 
-            DXGI_FORMAT viewFormat )
+            DXGI_FORMAT viewFormat,
+            const int gutter = 0 )
         {
             if ( textures.empty() || texcoords.empty() || colorMultipliers.empty() )
                 throw std::exception( "TextureUtil::mergeTextures - no input textures, texcoords or color multipleirs were passed." );
@@ -301,11 +157,6 @@ namespace Engine1
             if ( textures.size() != texcoords.size() || textures.size() != colorMultipliers.size() )
                 throw std::exception( "TextureUtil::mergeTextures - input texture count is different than number of texcoords or color multipliers." );
 
-            for ( auto& texture : textures ) {
-                if ( !MathUtil::isPowerOfTwo( texture->getWidth() ) || !MathUtil::isPowerOfTwo( texture->getHeight() ) )
-                    throw std::exception( "TextureUtil::mergeTextures - one of the textures does not have power-of-two dimensions." );
-            }
-
             const int textureCount = (int)textures.size();
 
             // Create a new texture.
@@ -322,7 +173,8 @@ namespace Engine1
                     texcoords[ idx ].second,
                     float2::ZERO,
                     float2::ONE,
-                    colorMultipliers[ idx ]
+                    colorMultipliers[ idx ],
+                    gutter
                 );
             }
 
@@ -347,6 +199,41 @@ namespace Engine1
 
             return text;
         }
+
+        private:
+
+        static const int s_minRowCountPerJob = 32;
+
+        static int2 toPixels( const float2 texcoords, const int2 dimensions )
+        {
+            return int2( (int)std::round( texcoords.x * (float)dimensions.x ), (int)std::round( texcoords.y * (float)dimensions.y ) );
+        }
+
+        // Extends the edge pixels of the region into the surrounding gutter (clipped to texture bounds).
+        template< typename PixelType >
+        static void fillGutter( std::vector< PixelType >& data, const int2 dimensions, const int2 regionTopLeft, const int2 regionDimensions, const int gutter )
+        {
+            const int beginY = std::max( 0, regionTopLeft.y - gutter );
+            const int endY   = std::min( dimensions.y, regionTopLeft.y + regionDimensions.y + gutter );
+            const int leftX  = std::max( 0, regionTopLeft.x - gutter );
+            const int rightX = std::min( dimensions.x, regionTopLeft.x + regionDimensions.x + gutter );
+
+            JobSystem::get().parallelFor( endY - beginY, s_minRowCountPerJob, [ & ]( const int beginRow, const int endRow )
+            {
+                for ( int y = beginY + beginRow; y < beginY + endRow; ++y )
+                {
+                    PixelType* row = &data[ y * dimensions.x ];
+
+                    // Rows above and below the region repeat its first/last row.
+                    const int srcY = std::min( std::max( y, regionTopLeft.y ), regionTopLeft.y + regionDimensions.y - 1 );
+                    if ( srcY != y )
+                        std::memcpy( row + regionTopLeft.x, &data[ srcY * dimensions.x + regionTopLeft.x ], regionDimensions.x * sizeof( PixelType ) );
+
+                    std::fill( row + leftX, row + regionTopLeft.x, row[ regionTopLeft.x ] );
+                    std::fill( row + regionTopLeft.x + regionDimensions.x, row + rightX, row[ regionTopLeft.x + regionDimensions.x - 1 ] );
+                }
+            } );
+        }
     };
 };
 
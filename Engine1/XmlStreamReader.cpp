@@ -0,0 +1,298 @@
+#include "XmlStreamReader.h"
+
+#include <cstring>
+#include <algorithm>
+
+using namespace Engine1;
+
+namespace
+{
+    bool isWhitespace( const char c )
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    void appendUtf8( std::string& text, const unsigned long codePoint )
+    {
+        if ( codePoint < 0x80 ) {
+            text += (char)codePoint;
+        } else if ( codePoint < 0x800 ) {
+            text += (char)( 0xC0 | ( codePoint >> 6 ) );
+            text += (char)( 0x80 | ( codePoint & 0x3F ) );
+        } else if ( codePoint < 0x10000 ) {
+            text += (char)( 0xE0 | ( codePoint >> 12 ) );
+            text += (char)( 0x80 | ( ( codePoint >> 6 ) & 0x3F ) );
+            text += (char)( 0x80 | ( codePoint & 0x3F ) );
+        } else {
+            text += (char)( 0xF0 | ( codePoint >> 18 ) );
+            text += (char)( 0x80 | ( ( codePoint >> 12 ) & 0x3F ) );
+            text += (char)( 0x80 | ( ( codePoint >> 6 ) & 0x3F ) );
+            text += (char)( 0x80 | ( codePoint & 0x3F ) );
+        }
+    }
+}
+
+bool XmlStreamReader::Text::equals( const char* text ) const
+{
+    const char* c = begin;
+    for ( ; c != end && *text != 0; ++c, ++text ) {
+        if ( *c != *text )
+            return false;
+    }
+
+    return c == end && *text == 0;
+}
+
+std::string XmlStreamReader::Text::toString() const
+{
+    std::string text;
+    text.reserve( end - begin );
+
+    for ( const char* c = begin; c != end; ++c ) {
+        const char* referenceEnd = *c == '&' ? std::find( c, end, ';' ) : end;
+        if ( referenceEnd == end ) {
+            text += *c;
+            continue;
+        }
+
+        const std::string reference( c + 1, referenceEnd );
+
+        if      ( reference == "lt" )   text += '<';
+        else if ( reference == "gt" )   text += '>';
+        else if ( reference == "amp" )  text += '&';
+        else if ( reference == "quot" ) text += '"';
+        else if ( reference == "apos" ) text += '\'';
+        else if ( reference.size() > 1 && reference[ 0 ] == '#' ) {
+            const bool isHexadecimal = reference[ 1 ] == 'x';
+            appendUtf8( text, std::strtoul( reference.c_str() + ( isHexadecimal ? 2 : 1 ), nullptr, isHexadecimal ? 16 : 10 ) );
+        } else {
+            // Unknown entity - leave it as it is.
+            text.append( c, referenceEnd + 1 );
+        }
+
+        c = referenceEnd;
+    }
+
+    return text;
+}
+
+XmlStreamReader::XmlStreamReader( const char* data, const size_t size ) :
+    m_stream( nullptr ),
+    m_chunkSize( 0 ),
+    m_isDataEnd( true ),
+    m_data( data ),
+    m_size( size ),
+    m_position( 0 ),
+    m_isEndPending( false )
+{
+    const void* nullCharacter = std::memchr( data, 0, size );
+    if ( nullCharacter )
+        m_size = (const char*)nullCharacter - data;
+
+    m_name.begin = m_name.end = data;
+}
+
+XmlStreamReader::XmlStreamReader( std::istream& stream, const size_t chunkSize ) :
+    m_stream( &stream ),
+    m_chunkSize( std::max( chunkSize, (size_t)16 ) ),
+    m_isDataEnd( false ),
+    m_data( nullptr ),
+    m_size( 0 ),
+    m_position( 0 ),
+    m_isEndPending( false )
+{
+    m_name.begin = m_name.end = nullptr;
+}
+
+XmlStreamReader::Event XmlStreamReader::next()
+{
+    if ( m_isEndPending ) {
+        m_isEndPending = false;
+        return Event::EndElement;
+    }
+
+    while ( true ) {
+        // Skip the text before the next markup.
+        const char* markupStartPtr = m_position < m_size ? (const char*)std::memchr( m_data + m_position, '<', m_size - m_position ) : nullptr;
+        if ( !markupStartPtr ) {
+            m_position = m_size;
+            if ( !readChunk( m_position ) )
+                return Event::EndOfDocument;
+
+            continue;
+        }
+
+        size_t markupStart = markupStartPtr - m_data;
+        size_t markupEnd;
+        while ( ( markupEnd = findMarkupEnd( markupStart ) ) == std::string::npos ) {
+            // Read which finds no more data still marks the data end - the markup is checked once more, as a complete one
+            // (data can end exactly at a chunk boundary).
+            const bool wasDataEnd = m_isDataEnd;
+            if ( !readChunk( markupStart ) && wasDataEnd ) throw std::exception( "XmlStreamReader::next - data ends inside of a markup." );
+        }
+
+        m_position = markupEnd + 1;
+
+        // Skip comments, CDATA, processing instructions and declarations.
+        if ( m_data[ markupStart + 1 ] == '!' || m_data[ markupStart + 1 ] == '?' )
+            continue;
+
+        return parseElement( markupStart, markupEnd );
+    }
+}
+
+const XmlStreamReader::Text& XmlStreamReader::getName() const
+{
+    return m_name;
+}
+
+bool XmlStreamReader::findAttribute( const char* name, Text& value ) const
+{
+    for ( const Attribute& attribute : m_attributes ) {
+        if ( attribute.name.equals( name ) ) {
+            value = attribute.value;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+size_t XmlStreamReader::findMarkupEnd( const size_t markupStart ) const
+{
+    const char* begin = m_data + markupStart;
+    const char* end   = m_data + m_size;
+
+    // Type of the markup can't be recognized until its longest prefix ("<![CDATA[") is available.
+    if ( ( end - begin < 9 && !m_isDataEnd ) || end - begin < 2 )
+        return std::string::npos;
+
+    const auto findSequence = [ & ]( const size_t prefixLength, const char* sequence ) -> size_t
+    {
+        const size_t sequenceLength = std::strlen( sequence );
+        const char*  found          = std::search( std::min( begin + prefixLength, end ), end, sequence, sequence + sequenceLength );
+
+        return found != end ? ( found - m_data ) + sequenceLength - 1 : std::string::npos;
+    };
+
+    if ( end - begin >= 4 && std::strncmp( begin, "<!--", 4 ) == 0 )
+        return findSequence( 4, "-->" );
+
+    if ( end - begin >= 9 && std::strncmp( begin, "<![CDATA[", 9 ) == 0 )
+        return findSequence( 9, "]]>" );
+
+    if ( begin[ 1 ] == '?' )
+        return findSequence( 2, "?>" );
+
+    // Element tag or declaration - ends with the first '>' which is outside of quotes and brackets (DOCTYPE internal subset).
+    const bool isDeclaration = begin[ 1 ] == '!';
+
+    char quote        = 0;
+    int  bracketDepth = 0;
+    for ( const char* c = begin + 1; c != end; ++c ) {
+        if ( quote ) {
+            if ( *c == quote )
+                quote = 0;
+        } else if ( *c == '"' || *c == '\'' ) {
+            quote = *c;
+        } else if ( *c == '[' && isDeclaration ) {
+            ++bracketDepth;
+        } else if ( *c == ']' && isDeclaration ) {
+            --bracketDepth;
+        } else if ( *c == '>' && bracketDepth <= 0 ) {
+            return c - m_data;
+        }
+    }
+
+    return std::string::npos;
+}
+
+bool XmlStreamReader::readChunk( size_t& keepFrom )
+{
+    if ( m_isDataEnd )
+        return false;
+
+    const size_t keptSize = m_size - keepFrom;
+
+    if ( m_buffer.size() < keptSize + m_chunkSize )
+        m_buffer.resize( keptSize + m_chunkSize );
+
+    if ( keptSize > 0 )
+        std::memmove( m_buffer.data(), m_buffer.data() + keepFrom, keptSize );
+
+    m_stream->read( m_buffer.data() + keptSize, m_chunkSize );
+
+    const size_t readSize = (size_t)m_stream->gcount();
+    if ( readSize < m_chunkSize )
+        m_isDataEnd = true;
+
+    m_data   = m_buffer.data();
+    m_size   = keptSize + readSize;
+    keepFrom = 0;
+
+    return readSize > 0;
+}
+
+XmlStreamReader::Event XmlStreamReader::parseElement( const size_t markupStart, const size_t markupEnd )
+{
+    const char* c   = m_data + markupStart + 1;
+    const char* end = m_data + markupEnd;
+
+    const bool isEndElement = *c == '/';
+    if ( isEndElement )
+        ++c;
+
+    m_name.begin = c;
+    while ( c != end && !isWhitespace( *c ) && *c != '/' )
+        ++c;
+    m_name.end = c;
+
+    if ( m_name.begin == m_name.end ) throw std::exception( "XmlStreamReader::next - element has no name." );
+
+    m_attributes.clear();
+
+    if ( isEndElement )
+        return Event::EndElement;
+
+    while ( true ) {
+        while ( c != end && isWhitespace( *c ) )
+            ++c;
+
+        if ( c == end )
+            break;
+
+        if ( *c == '/' && c + 1 == end ) {
+            m_isEndPending = true;
+            break;
+        }
+
+        Attribute attribute;
+        attribute.name.begin = c;
+        while ( c != end && !isWhitespace( *c ) && *c != '=' )
+            ++c;
+        attribute.name.end = c;
+
+        while ( c != end && isWhitespace( *c ) )
+            ++c;
+
+        if ( c == end || *c != '=' || attribute.name.begin == attribute.name.end )
+            throw std::exception( ( "XmlStreamReader::next - malformed attribute of element \"" + m_name.toString() + "\"." ).c_str() );
+
+        ++c;
+        while ( c != end && isWhitespace( *c ) )
+            ++c;
+
+        if ( c == end || ( *c != '"' && *c != '\'' ) )
+            throw std::exception( ( "XmlStreamReader::next - attribute value of element \"" + m_name.toString() + "\" isn't quoted." ).c_str() );
+
+        // Closing quote is always present - markup end is searched for outside of quotes.
+        const char quote = *c++;
+        attribute.value.begin = c;
+        attribute.value.end   = std::find( c, end, quote );
+        c = attribute.value.end + 1;
+
+        m_attributes.push_back( attribute );
+    }
+
+    return Event::StartElement;
+}
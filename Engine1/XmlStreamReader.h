@@ -0,0 +1,83 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <istream>
+
+namespace Engine1
+{
+    // Pull-style XML tokenizer. Reports elements one by one without building a document tree
+    // and reads stream input in chunks, so only the current element has to fit in memory.
+    // Only element names and attributes are reported - text content, comments, CDATA sections,
+    // processing instructions and DOCTYPE declarations are skipped.
+    // Each reader has its own state - separate readers can be used on different threads.
+    class XmlStreamReader
+    {
+        public:
+
+        enum class Event
+        {
+            StartElement,
+            EndElement, // Reported for empty elements (<a/>) as well - right after their start.
+            EndOfDocument
+        };
+
+        struct Text
+        {
+            const char* begin;
+            const char* end;
+
+            bool        equals( const char* text ) const;
+            std::string toString() const; // Decodes character and entity references.
+        };
+
+        // Reads from memory. Data isn't copied and has to outlive the reader. Reading stops at the first null character.
+        XmlStreamReader( const char* data, const size_t size );
+
+        // Reads from the stream in chunks. The buffer grows if a single element doesn't fit in the chunk.
+        XmlStreamReader( std::istream& stream, const size_t chunkSize = s_defaultChunkSize );
+
+        Event next();
+
+        // Name and attributes of the current element. Valid until next() is called.
+        const Text& getName() const;
+        bool        findAttribute( const char* name, Text& value ) const;
+
+        private:
+
+        static const size_t s_defaultChunkSize = 64 * 1024;
+
+        struct Attribute
+        {
+            Text name;
+            Text value;
+        };
+
+        // Returns the position of the character ending the markup which starts at the given position, or npos if the data ends before it.
+        size_t findMarkupEnd( const size_t markupStart ) const;
+
+        // Moves the data from the given position to the beginning of the buffer and reads the next chunk after it.
+        // Position is updated to point to the same data. Returns false if there is no more data to read.
+        bool readChunk( size_t& keepFrom );
+
+        // Parses the element tag between the given positions ('<' and '>' characters).
+        Event parseElement( const size_t markupStart, const size_t markupEnd );
+
+        std::istream*     m_stream;
+        size_t            m_chunkSize;
+        std::vector<char> m_buffer;
+        bool              m_isDataEnd; // Whole input is in the buffer.
+
+        const char* m_data;
+        size_t      m_size;
+        size_t      m_position;
+
+        Text                     m_name;
+        std::vector< Attribute > m_attributes;
+        bool                     m_isEndPending; // End of the last reported empty element.
+
+        // Copying reader in not allowed.
+        XmlStreamReader( const XmlStreamReader& ) = delete;
+        XmlStreamReader& operator=( const XmlStreamReader& ) = delete;
+    };
+}
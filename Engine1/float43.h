@@ -6,6 +6,7 @@
 
 #include "float33.h"
 #include "quat.h"
+#include "SimdMath.h"
 
 #include "PhysX/foundation/PxMat44.h"
 
@@ -195,6 +196,23 @@ namespace Engine1
 
         float43 operator * (const float43& mat) const
         {
+#if ENGINE1_MATH_SIMD >= 1
+            // Rows are loaded with the first element of the next row in the last lane - it only affects the last lane of the results,
+            // which gets overwritten by the next row when stored.
+            const __m128 row1        = _mm_loadu_ps( &mat.m11 );
+            const __m128 row2        = _mm_loadu_ps( &mat.m21 );
+            const __m128 row3        = _mm_loadu_ps( &mat.m31 );
+            const __m128 translation = Simd::loadFloat3( &mat.t1 );
+            const __m128 zero        = _mm_setzero_ps();
+
+            float43 result;
+            _mm_storeu_ps( &result.m11, Simd::transformPoint( _mm_loadu_ps( &m11 ), row1, row2, row3, zero ) );
+            _mm_storeu_ps( &result.m21, Simd::transformPoint( _mm_loadu_ps( &m21 ), row1, row2, row3, zero ) );
+            _mm_storeu_ps( &result.m31, Simd::transformPoint( _mm_loadu_ps( &m31 ), row1, row2, row3, zero ) );
+            Simd::storeFloat3( &result.t1, Simd::transformPoint( Simd::loadFloat3( &t1 ), row1, row2, row3, translation ) );
+
+            return result;
+#else
             return float43(
                 m11 * mat.m11 + m12 * mat.m21 + m13 * mat.m31,
                 m11 * mat.m12 + m12 * mat.m22 + m13 * mat.m32,
@@ -209,6 +227,7 @@ namespace Engine1
                 t1  * mat.m12 + t2  * mat.m22 + t3  * mat.m32 + mat.t2,
                 t1  * mat.m13 + t2  * mat.m23 + t3  * mat.m33 + mat.t3
                 );
+#endif
         }
 
         float43 operator * (const float value) const
@@ -71,6 +71,12 @@ void float44::rotate( const float3& rotationAngles )
 
 float4 Engine1::operator * (const float4& a, const float44& b)
 {
+#if ENGINE1_MATH_SIMD >= 1
+	float4 result;
+	_mm_storeu_ps( &result.x, Simd::transform( _mm_loadu_ps( &a.x ), _mm_loadu_ps( &b.m11 ), _mm_loadu_ps( &b.m21 ), _mm_loadu_ps( &b.m31 ), _mm_loadu_ps( &b.m41 ) ) );
+
+	return result;
+#else
 	return
 		float4(
 		a.x * b.m11 + a.y * b.m21 + a.z * b.m31 + a.w * b.m41,
@@ -78,6 +84,7 @@ float4 Engine1::operator * (const float4& a, const float44& b)
 		a.x * b.m13 + a.y * b.m23 + a.z * b.m33 + a.w * b.m43,
 		a.x * b.m14 + a.y * b.m24 + a.z * b.m34 + a.w * b.m44
 		);
+#endif
 }
 
 float44 Engine1::operator * (const float value, const float44& b)
@@ -9,6 +9,7 @@
 #include "float33.h"
 #include "float43.h"
 #include "quat.h"
+#include "SimdMath.h"
 
 #include "PhysX/foundation/PxMat44.h"
 
@@ -181,6 +182,20 @@ namespace Engine1
 
         float44 operator * (const float44& mat) const
         {
+#if ENGINE1_MATH_SIMD >= 1
+            const __m128 row1 = _mm_loadu_ps( &mat.m11 );
+            const __m128 row2 = _mm_loadu_ps( &mat.m21 );
+            const __m128 row3 = _mm_loadu_ps( &mat.m31 );
+            const __m128 row4 = _mm_loadu_ps( &mat.m41 );
+
+            float44 result;
+            _mm_storeu_ps( &result.m11, Simd::transform( _mm_loadu_ps( &m11 ), row1, row2, row3, row4 ) );
+            _mm_storeu_ps( &result.m21, Simd::transform( _mm_loadu_ps( &m21 ), row1, row2, row3, row4 ) );
+            _mm_storeu_ps( &result.m31, Simd::transform( _mm_loadu_ps( &m31 ), row1, row2, row3, row4 ) );
+            _mm_storeu_ps( &result.m41, Simd::transform( _mm_loadu_ps( &m41 ), row1, row2, row3, row4 ) );
+
+            return result;
+#else
             return float44(
                 m11 * mat.m11 + m12 * mat.m21 + m13 * mat.m31 + m14 * mat.m41,
                 m11 * mat.m12 + m12 * mat.m22 + m13 * mat.m32 + m14 * mat.m42,
@@ -202,6 +217,7 @@ namespace Engine1
                 m41 * mat.m13 + m42 * mat.m23 + m43 * mat.m33 + m44 * mat.m43,
                 m41 * mat.m14 + m42 * mat.m24 + m43 * mat.m34 + m44 * mat.m44
                 );
+#endif
         }
 
         float44 operator * (const float value) const
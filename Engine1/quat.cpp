@@ -5,6 +5,7 @@
 
 #include "float3.h"
 #include "MathUtil.h"
+#include "SimdMath.h"
 
 using namespace Engine1;
 
@@ -145,10 +146,25 @@ quat quat::operator * ( const quat& q ) const
 {
 	quat result;
 
+#if ENGINE1_MATH_SIMD >= 1
+	// Same terms as below - lanes hold ( w, x, y, z ).
+	const __m128 a        = _mm_loadu_ps( &w );
+	const __m128 b        = _mm_loadu_ps( &q.w );
+	const __m128 signMask = _mm_set_ps( 0.0f, 0.0f, 0.0f, -0.0f );
+
+	const __m128 term1 = _mm_mul_ps( Simd::splat< 0 >( a ), b );
+	const __m128 term2 = _mm_mul_ps( _mm_shuffle_ps( a, a, _MM_SHUFFLE( 3, 2, 1, 1 ) ), _mm_shuffle_ps( b, b, _MM_SHUFFLE( 0, 0, 0, 1 ) ) );
+	const __m128 term3 = _mm_mul_ps( _mm_shuffle_ps( a, a, _MM_SHUFFLE( 2, 1, 3, 2 ) ), _mm_shuffle_ps( b, b, _MM_SHUFFLE( 1, 3, 2, 2 ) ) );
+	const __m128 term4 = _mm_mul_ps( _mm_shuffle_ps( a, a, _MM_SHUFFLE( 1, 3, 2, 3 ) ), _mm_shuffle_ps( b, b, _MM_SHUFFLE( 2, 1, 3, 3 ) ) );
+
+	_mm_storeu_ps( &result.w, _mm_sub_ps( _mm_add_ps( term1, _mm_xor_ps( _mm_add_ps( term2, term3 ), signMask ) ), term4 ) );
+#else
+
 	result.w = w * q.w - x * q.x - y * q.y - z * q.z;
 	result.x = w * q.x + x * q.w + z * q.y - y * q.z;
 	result.y = w * q.y + y * q.w + x * q.z - z * q.x;
 	result.z = w * q.z + z * q.w + y * q.x - x * q.y;
+#endif
 
 	return result;
 }
@@ -0,0 +1,160 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ActorCulling.h"
+#include "BlockActor.h"
+#include "BlockModel.h"
+#include "BlockMesh.h"
+#include "MathUtil.h"
+#include "Scene.h"
+#include "Timer.h"
+
+#include "BlockActorFixtures.h"
+
+using namespace Engine1;
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace UnitTests::BlockActorFixtures;
+
+namespace UnitTests
+{
+	TEST_CLASS( ActorCullingTests )
+	{
+	private:
+
+	// Camera at the origin, looking along +z.
+	static float44 createViewProjection()
+	{
+		const float44 view       = MathUtil::lookAtTransformation( float3( 0.0f, 0.0f, 1.0f ), float3::ZERO, float3( 0.0f, 1.0f, 0.0f ) );
+		const float44 projection = MathUtil::perspectiveProjectionTransformation( MathUtil::degreesToRadians( 70.0f ), 16.0f / 9.0f, 0.1f, 1000.0f );
+
+		return view * projection;
+	}
+
+	static bool isVisible( const ActorCulling& culling, const std::shared_ptr< Actor >& actor )
+	{
+		const auto& visibleActors = culling.getVisibleActors();
+		return std::find( visibleActors.begin(), visibleActors.end(), actor ) != visibleActors.end();
+	}
+
+	public:
+
+	TEST_METHOD( ActorCulling_Frustum_Culling )
+	{
+		const auto model = createBoxModel( float3( 1.0f, 1.0f, 1.0f ) );
+
+		const auto inFront         = createActor( model, float3( 0.0f, 0.0f, 10.0f ) );
+		const auto behind          = createActor( model, float3( 0.0f, 0.0f, -10.0f ) );
+		const auto onTheLeft       = createActor( model, float3( -100.0f, 0.0f, 10.0f ) );
+		const auto tooFar          = createActor( model, float3( 0.0f, 0.0f, 2000.0f ) );
+		const auto crossingTheEdge = createActor( model, float3( 0.0f, 8.0f, 10.0f ) ); // Center is outside, but part of the box is inside.
+
+		ActorCulling culling;
+		culling.update( { inFront, behind, onTheLeft, tooFar, crossingTheEdge } );
+
+		ActorCulling::Settings settings;
+		culling.cull( createViewProjection(), settings );
+
+		Assert::AreEqual( 2, culling.getStatistics().visibleActorCount );
+		Assert::IsTrue( isVisible( culling, inFront ) );
+		Assert::IsTrue( isVisible( culling, crossingTheEdge ) );
+
+		// No culling.
+		settings.frustumCulling = false;
+		culling.cull( createViewProjection(), settings );
+
+		Assert::AreEqual( 5, culling.getStatistics().visibleActorCount );
+	}
+
+	// Scene renders right after it's loaded - its arrays have to be valid before the first Scene::updateActorData.
+	TEST_METHOD( ActorCulling_Scene_Without_Update )
+	{
+		const auto model = createBoxModel( float3( 1.0f, 1.0f, 1.0f ) );
+
+		const auto inFront = createActor( model, float3( 0.0f, 0.0f, 10.0f ) );
+		const auto behind  = createActor( model, float3( 0.0f, 0.0f, -10.0f ) );
+
+		Scene scene;
+		scene.addActor( inFront );
+		scene.addActor( behind );
+
+		ActorCulling culling;
+		culling.update( scene );
+
+		ActorCulling::Settings settings;
+		culling.cull( createViewProjection(), settings );
+
+		Assert::AreEqual( 1, culling.getStatistics().visibleActorCount );
+		Assert::IsTrue( isVisible( culling, inFront ) );
+	}
+
+	TEST_METHOD( ActorCulling_Occlusion_Culling )
+	{
+		const auto wall    = createActor( createBoxModel( float3( 10.0f, 10.0f, 0.5f ) ), float3( 0.0f, 0.0f, 10.0f ) );
+		const auto hidden  = createActor( createBoxModel( float3( 1.0f, 1.0f, 1.0f ) ), float3( 0.0f, 0.0f, 20.0f ) );
+		const auto inFront = createActor( createBoxModel( float3( 1.0f, 1.0f, 1.0f ) ), float3( 0.0f, 0.0f, 5.0f ) );
+		const auto peeking = createActor( createBoxModel( float3( 1.0f, 1.0f, 1.0f ) ), float3( 20.0f, 0.0f, 20.0f ) ); // Partially behind the wall.
+
+		ActorCulling culling;
+		culling.update( { wall, hidden, inFront, peeking } );
+
+		ActorCulling::Settings settings;
+		settings.occlusionCulling = true;
+		culling.cull( createViewProjection(), settings );
+
+		Assert::IsTrue( culling.getStatistics().occluderCount >= 1 );
+		Assert::IsTrue( isVisible( culling, wall ) );
+		Assert::IsFalse( isVisible( culling, hidden ) );
+		Assert::IsTrue( isVisible( culling, inFront ) );
+		Assert::IsTrue( isVisible( culling, peeking ) );
+	}
+
+	TEST_METHOD( ActorCulling_Benchmark )
+	{
+		std::mt19937 random( 5 );
+		std::uniform_real_distribution< float > position( -500.0f, 500.0f );
+
+		const auto smallModel    = createBoxModel( float3( 1.0f, 1.0f, 1.0f ) );
+		const auto occluderModel = createBoxModel( float3( 20.0f, 10.0f, 1.0f ) );
+
+		for ( const int actorCount : { 10000, 100000 } )
+		{
+			std::vector< std::shared_ptr< Actor > > actors;
+			for ( int i = 0; i < actorCount; ++i )
+				actors.push_back( createActor( i % 100 == 0 ? occluderModel : smallModel, float3( position( random ), 0.0f, position( random ) ) ) );
+
+			ActorCulling culling;
+			culling.update( actors );
+
+			for ( const bool occlusionCulling : { false, true } )
+			{
+				ActorCulling::Settings settings;
+				settings.occlusionCulling = occlusionCulling;
+
+				culling.cull( createViewProjection(), settings ); // Warm up.
+
+				const int   repeatCount = 10;
+				const Timer startTime;
+				for ( int i = 0; i < repeatCount; ++i )
+					culling.cull( createViewProjection(), settings );
+				const Timer endTime;
+
+				const ActorCulling::Statistics& statistics = culling.getStatistics();
+
+				Logger::WriteMessage( (
+					std::to_string( actorCount ) + " actors" + ( occlusionCulling ? " (frustum + occlusion)" : " (frustum)" ) + ": " 
+					+ std::to_string( Timer::getElapsedTime( endTime, startTime ) / repeatCount ) + " ms per cull (update " + std::to_string( statistics.updateDuration ) + " ms), "
+					+ std::to_string( 100.0 * ( actorCount - statistics.frustumVisibleActorCount ) / actorCount ) + "% outside frustum, "
+					+ std::to_string( 100.0 * ( statistics.frustumVisibleActorCount - statistics.visibleActorCount ) / actorCount ) + "% occluded by " 
+					+ std::to_string( statistics.occluderCount ) + " occluders\n"
+				).c_str() );
+			}
+		}
+	}
+	};
+}
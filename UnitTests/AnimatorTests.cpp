@@ -0,0 +1,140 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <vector>
+#include <string>
+#include <tuple>
+
+#include "Animator.h"
+#include "BlockActor.h"
+#include "MathUtil.h"
+#include "Timer.h"
+
+using namespace Engine1;
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTests
+{
+	TEST_CLASS( AnimatorTests )
+	{
+	private:
+
+	static void addKeyframe( Animator< BlockActor >& animator, const std::shared_ptr< BlockActor >& actor, const float3& translation, const float time )
+	{
+		actor->getPose().setTranslation( translation );
+		animator.addKeyframe( actor, time );
+	}
+
+	public:
+
+	TEST_METHOD( Animator_Interpolates_Keyframes_And_Reverses_At_The_End )
+	{
+		Animator< BlockActor > animator;
+
+		auto actor = std::make_shared< BlockActor >( nullptr );
+		addKeyframe( animator, actor, float3( 0.0f, 0.0f, 0.0f ), 0.0f );
+		addKeyframe( animator, actor, float3( 1.0f, 0.0f, 0.0f ), 1.0f );
+		addKeyframe( animator, actor, float3( 1.0f, 4.0f, 0.0f ), 3.0f );
+
+		Assert::AreEqual( 3, animator.getKeyframeCount( actor ) );
+
+		animator.setPlaying( actor, true );
+
+		animator.update( 0.05f );
+		Assert::IsTrue( MathUtil::areEqual( float3( 0.05f, 0.0f, 0.0f ), actor->getPose().getTranslation(), 0.0f, 0.0001f ) );
+
+		// Skip to the second segment.
+		animator.setPlaybackTime( actor, 1.95f );
+		animator.update( 0.05f );
+		Assert::IsTrue( MathUtil::areEqual( float3( 1.0f, 2.0f, 0.0f ), actor->getPose().getTranslation(), 0.0f, 0.0001f ) );
+
+		// Playback reverses after the last keyframe.
+		animator.setPlaybackTime( actor, 2.95f );
+		animator.update( 0.1f );
+		Assert::IsTrue( MathUtil::areEqual( float3( 1.0f, 3.9f, 0.0f ), actor->getPose().getTranslation(), 0.0f, 0.0001f ) );
+		animator.update( 0.1f );
+		Assert::IsTrue( MathUtil::areEqual( float3( 1.0f, 3.7f, 0.0f ), actor->getPose().getTranslation(), 0.0f, 0.0001f ) );
+	}
+
+	TEST_METHOD( Animator_Removes_Animations_Of_Deleted_Objects )
+	{
+		Animator< BlockActor > animator;
+
+		std::vector< std::shared_ptr< BlockActor > > actors;
+		for ( int i = 0; i < 3; ++i ) {
+			actors.push_back( std::make_shared< BlockActor >( nullptr ) );
+			addKeyframe( animator, actors.back(), float3::ZERO, 0.0f );
+			addKeyframe( animator, actors.back(), float3( (float)i, 0.0f, 0.0f ), 1.0f );
+			animator.setPlaying( actors.back(), true );
+		}
+
+		actors.erase( actors.begin() );
+		animator.update( 0.05f );
+
+		Assert::AreEqual( 2, animator.getKeyframeCount( actors[ 0 ] ) );
+		Assert::AreEqual( 2, animator.getKeyframeCount( actors[ 1 ] ) );
+		Assert::IsTrue( MathUtil::areEqual( float3( 0.1f, 0.0f, 0.0f ), actors[ 1 ]->getPose().getTranslation(), 0.0f, 0.0001f ) );
+
+		// New object doesn't inherit the animation even if it's allocated at the address of a deleted one.
+		auto newActor = std::make_shared< BlockActor >( nullptr );
+		Assert::AreEqual( 0, animator.getKeyframeCount( newActor ) );
+	}
+
+	TEST_METHOD( Animator_Evaluate_Doesnt_Modify_Objects_Until_Apply )
+	{
+		Animator< BlockActor > animator;
+
+		auto actor = std::make_shared< BlockActor >( nullptr );
+		addKeyframe( animator, actor, float3( 0.0f, 0.0f, 0.0f ), 0.0f );
+		addKeyframe( animator, actor, float3( 1.0f, 0.0f, 0.0f ), 1.0f );
+
+		animator.setPlaying( actor, true );
+
+		animator.evaluate( 0.05f );
+		Assert::IsTrue( MathUtil::areEqual( float3( 1.0f, 0.0f, 0.0f ), actor->getPose().getTranslation(), 0.0f, 0.0001f ) );
+
+		animator.apply();
+		Assert::IsTrue( MathUtil::areEqual( float3( 0.05f, 0.0f, 0.0f ), actor->getPose().getTranslation(), 0.0f, 0.0001f ) );
+
+		// Values are applied once - a pose set afterwards is kept until the next evaluate.
+		actor->getPose().setTranslation( float3( 0.0f, 2.0f, 0.0f ) );
+		animator.apply();
+		Assert::IsTrue( MathUtil::areEqual( float3( 0.0f, 2.0f, 0.0f ), actor->getPose().getTranslation(), 0.0f, 0.0001f ) );
+
+		// Object deleted between evaluate and apply.
+		animator.evaluate( 0.05f );
+		actor.reset();
+		animator.apply();
+	}
+
+	TEST_METHOD( Animator_Benchmark_10k_Actors )
+	{
+		const int actorCount = 10000, keyframeCount = 100, updateCount = 100;
+
+		Animator< BlockActor > animator;
+
+		std::vector< std::shared_ptr< BlockActor > > actors;
+		for ( int i = 0; i < actorCount; ++i ) {
+			actors.push_back( std::make_shared< BlockActor >( nullptr ) );
+
+			for ( int keyframe = 0; keyframe < keyframeCount; ++keyframe )
+				addKeyframe( animator, actors.back(), float3( (float)keyframe, (float)i, 0.0f ), (float)keyframe );
+
+			animator.setPlaying( actors.back(), true );
+		}
+
+		const Timer startTime;
+		for ( int i = 0; i < updateCount; ++i )
+			animator.update( 0.05f );
+		const Timer endTime;
+
+		Logger::WriteMessage( (
+			"Animator (" + std::to_string( actorCount ) + " actors): update " + std::to_string( Timer::getElapsedTime( endTime, startTime ) / updateCount ) + " ms, "
+			+ "keyframe size " + std::to_string( sizeof( float ) + sizeof( AnimationChannels< BlockActor > ) ) + " bytes "
+			+ "(whole object: " + std::to_string( sizeof( std::tuple< BlockActor, float > ) ) + " bytes)\n"
+		).c_str() );
+
+		Assert::IsTrue( MathUtil::areEqual( float3( 5.0f, 0.0f, 0.0f ), actors[ 0 ]->getPose().getTranslation(), 0.0f, 0.001f ) );
+	}
+	};
+}
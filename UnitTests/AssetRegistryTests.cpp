@@ -0,0 +1,277 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <thread>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <functional>
+
+#include "AssetId.h"
+#include "AssetRegistry.h"
+#include "FileInfo.h"
+#include "StringUtil.h"
+#include "Timer.h"
+
+using namespace Engine1;
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTests
+{
+    // Minimal asset used only to fill the registry.
+    class TestAsset : public Asset
+    {
+        public:
+
+        TestAsset( const int value = 0 ) : value( value ) {}
+
+        Type getType() const { return Type::BlockMesh; }
+        const FileInfo& getFileInfo() const { throw std::exception( "TestAsset::getFileInfo - not supported." ); }
+        FileInfo& getFileInfo() { throw std::exception( "TestAsset::getFileInfo - not supported." ); }
+        std::vector< std::shared_ptr<const Asset> > getSubAssets() const { return std::vector< std::shared_ptr<const Asset> >(); }
+        std::vector< std::shared_ptr<Asset> > getSubAssets() { return std::vector< std::shared_ptr<Asset> >(); }
+        void swapSubAsset( std::shared_ptr<Asset> oldAsset, std::shared_ptr<Asset> newAsset ) {}
+
+        const int value;
+    };
+
+	TEST_CLASS( AssetRegistryTests )
+	{
+	public:
+
+	TEST_METHOD( AssetId_Case_Insensitive_Path )
+	{
+		const AssetId id1( Asset::Type::Texture2D, "Assets/Textures/Concrete/concrete_A.tiff", 0 );
+		const AssetId id2( Asset::Type::Texture2D, "assets/textures/CONCRETE/Concrete_a.TIFF", 0 );
+
+		Assert::IsTrue( id1 == id2 );
+		Assert::IsTrue( id1.isValid() );
+	}
+
+	TEST_METHOD( AssetId_Differs_By_Type_And_Index )
+	{
+		const AssetId id( Asset::Type::BlockMesh, "Assets/Meshes/Basic/cube.blockmesh", 0 );
+
+		Assert::IsTrue( id != AssetId( Asset::Type::BlockModel, "Assets/Meshes/Basic/cube.blockmesh", 0 ) );
+		Assert::IsTrue( id != AssetId( Asset::Type::BlockMesh, "Assets/Meshes/Basic/cube.blockmesh", 1 ) );
+		Assert::IsTrue( id != AssetId( Asset::Type::BlockMesh, "Assets/Meshes/Basic/cube-small.blockmesh", 0 ) );
+	}
+
+	TEST_METHOD( AssetRegistry_Loading_States )
+	{
+		AssetRegistry registry( 64 );
+		const AssetId id( Asset::Type::BlockMesh, "a.blockmesh" );
+
+		Assert::IsFalse( registry.isLoadedOrLoading( id ) );
+		Assert::IsNull( registry.get( id ).get() );
+
+		Assert::IsTrue( registry.markLoading( id ) );
+		Assert::IsFalse( registry.markLoading( id ), L"AssetRegistry::markLoading succeeded twice for the same asset" );
+		Assert::IsTrue( registry.isLoadedOrLoading( id ) );
+		Assert::IsFalse( registry.isLoaded( id ) );
+
+		registry.markFailed( id );
+		Assert::IsFalse( registry.isLoadedOrLoading( id ) );
+
+		Assert::IsTrue( registry.markLoading( id ), L"AssetRegistry::markLoading failed after the previous load failed" );
+
+		std::shared_ptr< Asset > asset = std::make_shared< TestAsset >();
+		registry.markLoaded( id, asset );
+
+		Assert::IsTrue( registry.isLoaded( id ) );
+		Assert::IsTrue( registry.get( id ) == asset );
+
+		// Loaded asset shouldn't be replaced.
+		registry.markLoaded( id, std::make_shared< TestAsset >() );
+		Assert::IsTrue( registry.get( id ) == asset );
+
+		registry.clear();
+		Assert::IsFalse( registry.isLoadedOrLoading( id ) );
+	}
+
+	TEST_METHOD( AssetRegistry_Full )
+	{
+		AssetRegistry registry( 4 );
+
+		for ( int i = 0; i < 4; ++i )
+			Assert::IsTrue( registry.markLoading( AssetId( Asset::Type::BlockMesh, "a.blockmesh", i ) ) );
+
+		try {
+			registry.markLoading( AssetId( Asset::Type::BlockMesh, "a.blockmesh", 4 ) );
+			Assert::Fail( L"AssetRegistry::markLoading didn't throw when the registry was full" );
+		} catch ( std::exception& ) {
+			// Correct exception.
+		}
+
+		for ( int i = 0; i < 4; ++i )
+			Assert::IsTrue( registry.isLoadedOrLoading( AssetId( Asset::Type::BlockMesh, "a.blockmesh", i ) ) );
+	}
+
+	TEST_METHOD( AssetRegistry_Concurrent_Inserts )
+	{
+		const int threadCount     = 8;
+		const int assetsPerThread = 1000;
+
+		AssetRegistry registry( 1 << 14 );
+		std::atomic< int > successfulMarks( 0 );
+
+		// All threads try to load the same set of assets - each asset should be marked as loading exactly once.
+		std::vector< std::thread > threads;
+		for ( int threadIdx = 0; threadIdx < threadCount; ++threadIdx ) {
+			threads.push_back( std::thread( [ &registry, &successfulMarks, assetsPerThread ]() {
+				for ( int i = 0; i < assetsPerThread; ++i ) {
+					const AssetId id( Asset::Type::Texture2D, "texture.png", i );
+					if ( registry.markLoading( id ) ) {
+						++successfulMarks;
+						registry.markLoaded( id, std::make_shared< TestAsset >() );
+					}
+				}
+			} ) );
+		}
+
+		for ( auto& thread : threads )
+			thread.join();
+
+		Assert::AreEqual( assetsPerThread, successfulMarks.load() );
+
+		for ( int i = 0; i < assetsPerThread; ++i )
+			Assert::IsTrue( registry.isLoaded( AssetId( Asset::Type::Texture2D, "texture.png", i ) ) );
+	}
+
+	TEST_METHOD( AssetRegistry_Clear_While_Reading )
+	{
+		const int threadCount = 4;
+		const int assetCount  = 256;
+		const int clearCount  = 200;
+
+		AssetRegistry registry( 1024 );
+
+		std::vector< AssetId > ids;
+		for ( int i = 0; i < assetCount; ++i )
+			ids.push_back( AssetId( Asset::Type::BlockMesh, "a.blockmesh", i ) );
+
+		std::atomic< bool > run( true );
+		std::atomic< int >  wrongAssets( 0 );
+		std::atomic< int >  foundAssets( 0 );
+
+		// Readers copy and use the assets while they are being cleared and loaded again (possibly into different slots).
+		std::vector< std::thread > threads;
+		for ( int threadIdx = 0; threadIdx < threadCount; ++threadIdx ) {
+			threads.push_back( std::thread( [ & ]() {
+				int localFound = 0;
+				while ( run ) {
+					for ( int i = 0; i < assetCount; ++i ) {
+						const std::shared_ptr< Asset > asset = registry.get( ids[ i ] );
+						if ( !asset )
+							continue;
+
+						++localFound;
+						if ( static_cast< const TestAsset& >( *asset ).value != i )
+							++wrongAssets;
+					}
+				}
+				foundAssets += localFound;
+			} ) );
+		}
+
+		for ( int clear = 0; clear < clearCount; ++clear ) {
+			// Load in a different order each time, so ids land in different slots.
+			for ( int j = 0; j < assetCount; ++j ) {
+				const int i = ( j * 7 + clear ) % assetCount;
+				registry.markLoading( ids[ i ] );
+				registry.markLoaded( ids[ i ], std::make_shared< TestAsset >( i ) );
+			}
+
+			registry.clear();
+		}
+
+		run = false;
+		for ( auto& thread : threads )
+			thread.join();
+
+		Assert::AreEqual( 0, wrongAssets.load() );
+		Assert::IsNull( registry.get( ids[ 0 ] ).get() );
+	}
+
+	// Compares contended lookup throughput of the registry with the previous approach (string ids in a mutex-guarded map).
+	TEST_METHOD( AssetRegistry_Benchmark_Contended_Lookups )
+	{
+		const int assetCount        = 2000;
+		const int lookupsPerThread  = 200000;
+		int       threadCount       = (int)std::thread::hardware_concurrency();
+		if ( threadCount <= 0 ) threadCount = 4;
+
+		std::vector< std::string > paths;
+		for ( int i = 0; i < assetCount; ++i )
+			paths.push_back( "Assets/Textures/Benchmark/texture_" + std::to_string( i ) + "_A.png" );
+
+		AssetRegistry                                             registry;
+		std::mutex                                                mapMutex;
+		std::unordered_map< std::string, std::shared_ptr<Asset> > map;
+
+		std::vector< AssetId > ids;
+		for ( const std::string& path : paths ) {
+			std::shared_ptr< Asset > asset = std::make_shared< TestAsset >();
+
+			ids.push_back( AssetId( Asset::Type::Texture2D, path ) );
+			registry.markLoading( ids.back() );
+			registry.markLoaded( ids.back(), asset );
+
+			map.insert( std::make_pair( "(" + Asset::toString( Asset::Type::Texture2D ) + ") " + StringUtil::toLowercase( path ) + " [0]", asset ) );
+		}
+
+		auto runThreads = [ threadCount ]( std::function< void( int ) > work ) {
+			Timer startTime;
+			std::vector< std::thread > threads;
+			for ( int threadIdx = 0; threadIdx < threadCount; ++threadIdx )
+				threads.push_back( std::thread( work, threadIdx ) );
+			for ( auto& thread : threads )
+				thread.join();
+			Timer endTime;
+			return Timer::getElapsedTime( endTime, startTime );
+		};
+
+		std::atomic< int > found( 0 );
+
+		const double mapTime = runThreads( [ & ]( int threadIdx ) {
+			int localFound = 0;
+			for ( int i = 0; i < lookupsPerThread; ++i ) {
+				const std::string& path = paths[ ( i * 7 + threadIdx ) % assetCount ];
+				const std::string id = "(" + Asset::toString( Asset::Type::Texture2D ) + ") " + StringUtil::toLowercase( path ) + " [0]";
+
+				std::lock_guard< std::mutex > lock( mapMutex );
+				if ( map.find( id ) != map.end() ) ++localFound;
+			}
+			found += localFound;
+		} );
+
+		const double registryTime = runThreads( [ & ]( int threadIdx ) {
+			int localFound = 0;
+			for ( int i = 0; i < lookupsPerThread; ++i ) {
+				const std::string& path = paths[ ( i * 7 + threadIdx ) % assetCount ];
+				if ( registry.get( AssetId( Asset::Type::Texture2D, path ) ) ) ++localFound;
+			}
+			found += localFound;
+		} );
+
+		const double registryCachedIdTime = runThreads( [ & ]( int threadIdx ) {
+			int localFound = 0;
+			for ( int i = 0; i < lookupsPerThread; ++i ) {
+				if ( registry.isLoaded( ids[ ( i * 7 + threadIdx ) % assetCount ] ) ) ++localFound;
+			}
+			found += localFound;
+		} );
+
+		Assert::AreEqual( 3 * threadCount * lookupsPerThread, found.load() );
+
+		const double lookupCount = (double)threadCount * lookupsPerThread;
+		Logger::WriteMessage( ( "Contended lookups, " + std::to_string( threadCount ) + " threads (lookups per ms):\n" 
+			+ "  mutex + unordered_map<string>: " + std::to_string( lookupCount / mapTime ) + "\n"
+			+ "  AssetRegistry (hashing path):  " + std::to_string( lookupCount / registryTime ) + "\n"
+			+ "  AssetRegistry (cached id):     " + std::to_string( lookupCount / registryCachedIdTime ) + "\n" ).c_str() );
+	}
+
+	};
+}
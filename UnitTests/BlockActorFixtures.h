@@ -0,0 +1,55 @@
+#pragma once
+
+#include <memory>
+
+#include "BlockActor.h"
+#include "BlockModel.h"
+#include "BlockMesh.h"
+
+// Block actors with box models - shared by the tests of the scene and of the culling.
+namespace UnitTests
+{
+	namespace BlockActorFixtures
+	{
+		// Box mesh [-1, 1] in each axis, scaled.
+		inline std::shared_ptr< Engine1::BlockModel > createBoxModel( const Engine1::float3& scale = Engine1::float3( 1.0f, 1.0f, 1.0f ) )
+		{
+			auto mesh = std::make_shared< Engine1::BlockMesh >( 8, false, 0, 12 );
+
+			for ( int corner = 0; corner < 8; ++corner ) {
+				mesh->getVertices()[ corner ] = Engine1::float3(
+					corner & 1 ? scale.x : -scale.x,
+					corner & 2 ? scale.y : -scale.y,
+					corner & 4 ? scale.z : -scale.z
+				);
+			}
+
+			const Engine1::uint3 triangles[ 12 ] = {
+				Engine1::uint3( 0, 1, 3 ), Engine1::uint3( 0, 3, 2 ), Engine1::uint3( 4, 6, 7 ), Engine1::uint3( 4, 7, 5 ), // -z, +z
+				Engine1::uint3( 0, 4, 5 ), Engine1::uint3( 0, 5, 1 ), Engine1::uint3( 2, 3, 7 ), Engine1::uint3( 2, 7, 6 ), // -y, +y
+				Engine1::uint3( 0, 2, 6 ), Engine1::uint3( 0, 6, 4 ), Engine1::uint3( 1, 5, 7 ), Engine1::uint3( 1, 7, 3 )  // -x, +x
+			};
+
+			for ( int i = 0; i < 12; ++i )
+				mesh->getTriangles()[ i ] = triangles[ i ];
+
+			mesh->recalculateBoundingBox();
+
+			auto model = std::make_shared< Engine1::BlockModel >();
+			model->setMesh( mesh );
+
+			return model;
+		}
+
+		inline std::shared_ptr< Engine1::BlockActor > createActor( const std::shared_ptr< Engine1::BlockModel >& model, const Engine1::float3& position, const bool castsShadows = true )
+		{
+			Engine1::float43 pose( Engine1::float43::IDENTITY );
+			pose.setTranslation( position );
+
+			auto actor = std::make_shared< Engine1::BlockActor >( model, pose );
+			actor->setCastingShadows( castsShadows );
+
+			return actor;
+		}
+	}
+}
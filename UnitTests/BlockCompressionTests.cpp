@@ -0,0 +1,130 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <vector>
+#include <string>
+#include <cmath>
+
+#include "BlockCompression.h"
+#include "uchar4.h"
+#include "Timer.h"
+
+using namespace Engine1;
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTests
+{
+	TEST_CLASS( BlockCompressionTests )
+	{
+	private:
+
+	// Smooth gradients with some high-frequency detail - similar to typical albedo/roughness maps.
+	static std::vector< uchar4 > createTestImage( const int width, const int height )
+	{
+		std::vector< uchar4 > pixels( width * height );
+		for ( int y = 0; y < height; ++y ) {
+			for ( int x = 0; x < width; ++x ) {
+				const float u = (float)x / (float)width;
+				const float v = (float)y / (float)height;
+
+				pixels[ y * width + x ] = uchar4(
+					(unsigned char)( 255.0f * u ),
+					(unsigned char)( 128.0f + 127.0f * std::sin( u * 10.0f + v * 3.0f ) ),
+					(unsigned char)( 255.0f * v * v ),
+					(unsigned char)( 20.0f + 200.0f * u * v )
+				);
+			}
+		}
+
+		return pixels;
+	}
+
+	static int getChannelCount( const BlockCompression::Format format )
+	{
+		switch ( format ) {
+			case BlockCompression::Format::BC1: return 3;
+			case BlockCompression::Format::BC4: return 1;
+			case BlockCompression::Format::BC5: return 2;
+			default:                            return 4;
+		}
+	}
+
+	public:
+
+	TEST_METHOD( BlockCompression_Encoded_Size )
+	{
+		// Dimensions not divisible by 4 are rounded up to whole blocks.
+		Assert::AreEqual( 8,      BlockCompression::getEncodedSize( BlockCompression::Format::BC1, 1, 1 ) );
+		Assert::AreEqual( 16 * 8, BlockCompression::getEncodedSize( BlockCompression::Format::BC4, 13, 15 ) );
+		Assert::AreEqual( 16 * 16, BlockCompression::getEncodedSize( BlockCompression::Format::BC7, 16, 16 ) );
+
+		const std::vector< uchar4 > pixels = createTestImage( 13, 7 );
+		Assert::AreEqual( (size_t)( 4 * 2 * 16 ), BlockCompression::encode( pixels.data(), 13, 7, BlockCompression::Format::BC5 ).size() );
+	}
+
+	TEST_METHOD( BlockCompression_Solid_Colors_Are_Exact )
+	{
+		// Colors representable exactly in 5:6:5 (BC1) and any values in BC4.
+		const std::vector< uchar4 > pixels( 8 * 8, uchar4( 255, 0, 132, 255 ) );
+
+		const BlockCompression::Format formats[] = { BlockCompression::Format::BC1, BlockCompression::Format::BC3, BlockCompression::Format::BC4, BlockCompression::Format::BC5 };
+		for ( const BlockCompression::Format format : formats ) {
+			const std::vector< unsigned char > blocks = BlockCompression::encode( pixels.data(), 8, 8, format );
+
+			std::vector< uchar4 > decoded( pixels.size() );
+			BlockCompression::decode( blocks.data(), 8, 8, format, decoded.data() );
+
+			Assert::IsTrue( std::isinf( BlockCompression::calculatePsnr( pixels.data(), decoded.data(), 8 * 8, getChannelCount( format ) ) ) );
+		}
+
+		const std::vector< unsigned char > values( 5 * 3, 77 );
+		const std::vector< unsigned char > blocks = BlockCompression::encode( values.data(), 5, 3 );
+
+		std::vector< unsigned char > decoded( values.size() );
+		BlockCompression::decode( blocks.data(), 5, 3, decoded.data() );
+
+		Assert::IsTrue( values == decoded );
+	}
+
+	TEST_METHOD( BlockCompression_BC7_Uses_Mode_6 )
+	{
+		const std::vector< uchar4 > pixels = createTestImage( 4, 4 );
+		const std::vector< unsigned char > blocks = BlockCompression::encode( pixels.data(), 4, 4, BlockCompression::Format::BC7 );
+
+		Assert::AreEqual( (int)0x40, (int)( blocks[ 0 ] & 0x7F ) );
+	}
+
+	TEST_METHOD( BlockCompression_Quality_And_Throughput )
+	{
+		const int width = 1024, height = 1024;
+
+		const std::vector< uchar4 > pixels = createTestImage( width, height );
+
+		// Minimal expected PSNR for each format on the test image (in dB).
+		const BlockCompression::Format formats[]   = { BlockCompression::Format::BC1, BlockCompression::Format::BC3, BlockCompression::Format::BC4, BlockCompression::Format::BC5, BlockCompression::Format::BC7 };
+		const float                    minPsnr[]   = { 35.0f, 35.0f, 40.0f, 40.0f, 40.0f };
+
+		for ( int i = 0; i < 5; ++i ) {
+			const Timer encodeStartTime;
+			const std::vector< unsigned char > blocks = BlockCompression::encode( pixels.data(), width, height, formats[ i ] );
+			const Timer encodeEndTime;
+
+			std::vector< uchar4 > decoded( pixels.size() );
+			BlockCompression::decode( blocks.data(), width, height, formats[ i ], decoded.data() );
+
+			const float  psnr              = BlockCompression::calculatePsnr( pixels.data(), decoded.data(), width * height, getChannelCount( formats[ i ] ) );
+			const double encodeTime        = Timer::getElapsedTime( encodeEndTime, encodeStartTime );
+			const double megapixelsPerSecond = ( (double)width * height / 1000000.0 ) / ( encodeTime / 1000.0 );
+
+			Logger::WriteMessage( (
+				BlockCompression::formatToString( formats[ i ] )
+				+ ": PSNR " + std::to_string( psnr ) + " dB"
+				+ ", encoding " + std::to_string( megapixelsPerSecond ) + " MP/s"
+				+ ", size " + std::to_string( blocks.size() ) + " B (uncompressed " + std::to_string( width * height * getChannelCount( formats[ i ] ) ) + " B)\n"
+			).c_str() );
+
+			Assert::IsTrue( psnr >= minPsnr[ i ] );
+		}
+	}
+	};
+}
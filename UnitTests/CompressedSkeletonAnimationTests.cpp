@@ -0,0 +1,162 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cmath>
+
+#include "SkeletonAnimation.h"
+#include "CompressedSkeletonAnimation.h"
+#include "MathUtil.h"
+#include "Timer.h"
+
+using namespace Engine1;
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTests
+{
+	TEST_CLASS( CompressedSkeletonAnimationTests )
+	{
+	private:
+
+	// Mocap-like animation - bones swing smoothly with different frequencies, every fourth bone doesn't move,
+	// only the root bone is translated over time.
+	static void createAnimation( SkeletonAnimation& animation, const int boneCount, const int keyframeCount )
+	{
+		for ( int keyframe = 0; keyframe < keyframeCount; ++keyframe ) {
+			const float time = keyframe / 30.0f;
+
+			SkeletonPose& pose = animation.getOrAddPose( keyframe );
+			for ( int boneIndex = 1; boneIndex <= boneCount; ++boneIndex ) {
+				const bool  isStatic = boneIndex % 4 == 0;
+				const float angle    = isStatic ? 0.3f : 0.6f * std::sin( time * ( 1.0f + 0.1f * boneIndex ) + boneIndex );
+
+				float3 axis( std::sin( (float)boneIndex ), std::cos( (float)boneIndex ), 0.5f );
+				axis.normalize();
+
+				const quat orientation( std::cos( angle * 0.5f ), axis.x * std::sin( angle * 0.5f ), axis.y * std::sin( angle * 0.5f ), axis.z * std::sin( angle * 0.5f ) );
+
+				const float3 translation = boneIndex == 1
+					? float3( time * 1.5f, 1.0f + 0.05f * std::sin( time * 8.0f ), 0.0f )
+					: float3( 0.0f, 0.1f * boneIndex, 0.0f );
+
+				pose.setBonePose( (unsigned char)boneIndex, orientation, translation );
+			}
+		}
+	}
+
+	static float getOrientationError( const quat& q1, const quat& q2 )
+	{
+		return 2.0f * std::acos( std::min( 1.0f, std::abs( quat::dot( q1, q2 ) ) ) );
+	}
+
+	public:
+
+	TEST_METHOD( CompressedSkeletonAnimation_Error_Is_Within_Bounds )
+	{
+		const int boneCount = 40, keyframeCount = 3000;
+
+		SkeletonAnimation animation;
+		createAnimation( animation, boneCount, keyframeCount );
+
+		const CompressedSkeletonAnimation::Options options;
+
+		CompressedSkeletonAnimation::Statistics statistics;
+		std::shared_ptr< CompressedSkeletonAnimation > compressedAnimation = CompressedSkeletonAnimation::compress( animation, options, &statistics );
+
+		Assert::IsTrue( statistics.maxOrientationError <= options.maxOrientationError );
+		Assert::IsTrue( statistics.maxTranslationError <= options.maxTranslationError );
+		Assert::IsTrue( statistics.maxScaleError <= options.maxScaleError );
+
+		// Scale tracks, translation tracks of all bones but the root and orientation tracks of static bones.
+		Assert::AreEqual( boneCount * 2 - 1 + boneCount / 4, statistics.constantTrackCount );
+		Assert::IsTrue( statistics.getCompressionRatio() > 8.0f );
+
+		// Sampling between the keyframes should match interpolating the original poses.
+		for ( const float progress : { 0.0f, 0.12345f, 0.5f, 0.87654f, 1.0f } ) {
+			const SkeletonPose expectedPose = animation.getInterpolatedPose( progress );
+			const SkeletonPose pose         = compressedAnimation->samplePose( progress );
+
+			Assert::AreEqual( boneCount, (int)pose.getBonesCount() );
+
+			for ( int i = 0; i < boneCount; ++i ) {
+				Assert::IsTrue( getOrientationError( expectedPose.getOrientations()[ i ], pose.getOrientations()[ i ] ) < 0.005f );
+				Assert::IsTrue( MathUtil::areEqual( expectedPose.getTranslations()[ i ], pose.getTranslations()[ i ], 0.0f, 0.005f ) );
+			}
+		}
+
+		Logger::WriteMessage( (
+			"Compressed animation (" + std::to_string( boneCount ) + " bones, " + std::to_string( keyframeCount ) + " keyframes): "
+			+ std::to_string( statistics.uncompressedSize ) + " -> " + std::to_string( statistics.compressedSize ) + " bytes (ratio " + std::to_string( statistics.getCompressionRatio() ) + "), "
+			+ std::to_string( statistics.keyCount ) + " of " + std::to_string( statistics.originalKeyCount ) + " keys, "
+			+ std::to_string( statistics.constantTrackCount ) + " of " + std::to_string( statistics.trackCount ) + " tracks constant, "
+			+ "max error: orientation " + std::to_string( statistics.maxOrientationError ) + " rad, translation " + std::to_string( statistics.maxTranslationError ) + "\n"
+		).c_str() );
+	}
+
+	TEST_METHOD( CompressedSkeletonAnimation_Compressed_Animation_Is_Sampled )
+	{
+		SkeletonAnimation animation;
+		createAnimation( animation, 8, 100 );
+
+		const SkeletonPose expectedPose         = animation.getInterpolatedPose( 0.3f );
+		const SkeletonPose expectedKeyframePose = animation.getPose( 33 );
+
+		animation.compress();
+
+		Assert::IsTrue( animation.isCompressed() );
+		Assert::AreEqual( 100u, animation.getKeyframeCount() );
+
+		const SkeletonPose pose = animation.getInterpolatedPose( 0.3f );
+		for ( int i = 0; i < 8; ++i )
+			Assert::IsTrue( getOrientationError( expectedPose.getOrientations()[ i ], pose.getOrientations()[ i ] ) < 0.005f );
+
+		// Keyframes are decoded (e.g. for conversions between skeleton and parent space).
+		const SkeletonPose keyframePose = animation.getKeyframePose( 33 );
+		for ( int i = 0; i < 8; ++i ) {
+			Assert::IsTrue( getOrientationError( expectedKeyframePose.getOrientations()[ i ], keyframePose.getOrientations()[ i ] ) < 0.005f );
+			Assert::IsTrue( MathUtil::areEqual( expectedKeyframePose.getTranslations()[ i ], keyframePose.getTranslations()[ i ], 0.0f, 0.005f ) );
+		}
+
+		try {
+			animation.getPose( 0 );
+		} catch ( ... ) {
+			return;
+		}
+
+		Assert::Fail( L"SkeletonAnimation::getPose didn't throw an exception for a compressed animation" );
+	}
+
+	TEST_METHOD( CompressedSkeletonAnimation_Benchmark_Sampling )
+	{
+		const int boneCount = 60, keyframeCount = 6000, sampleCount = 20000;
+
+		SkeletonAnimation animation;
+		createAnimation( animation, boneCount, keyframeCount );
+
+		std::shared_ptr< CompressedSkeletonAnimation > compressedAnimation = CompressedSkeletonAnimation::compress( animation );
+
+		SkeletonPose pose;
+
+		const Timer startTime;
+		for ( int i = 0; i < sampleCount; ++i )
+			compressedAnimation->samplePose( (float)i / sampleCount, pose );
+		const Timer endTime;
+
+		for ( int i = 0; i < sampleCount; ++i )
+			pose = animation.getInterpolatedPose( (float)i / sampleCount );
+		const Timer uncompressedEndTime;
+
+		const double posesPerSecond             = sampleCount / ( Timer::getElapsedTime( endTime, startTime ) / 1000.0 );
+		const double uncompressedPosesPerSecond = sampleCount / ( Timer::getElapsedTime( uncompressedEndTime, endTime ) / 1000.0 );
+
+		Logger::WriteMessage( (
+			"Sampling compressed animation (" + std::to_string( boneCount ) + " bones): " + std::to_string( posesPerSecond ) + " poses/s"
+			+ " (uncompressed: " + std::to_string( uncompressedPosesPerSecond ) + " poses/s)\n"
+		).c_str() );
+
+		Assert::AreEqual( boneCount, (int)pose.getBonesCount() );
+	}
+	};
+}
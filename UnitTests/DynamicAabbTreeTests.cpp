@@ -0,0 +1,382 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "DynamicAabbTree.h"
+#include "MathUtil.h"
+#include "Timer.h"
+
+using namespace Engine1;
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTests
+{
+	TEST_CLASS( DynamicAabbTreeTests )
+	{
+	private:
+
+	static BoundingBox createRandomBox( std::mt19937& random, const float extent, const float maxSize )
+	{
+		std::uniform_real_distribution< float > position( -extent, extent );
+		std::uniform_real_distribution< float > size( 0.1f, maxSize );
+
+		const float3 min( position( random ), position( random ), position( random ) );
+
+		return BoundingBox( min, min + float3( size( random ), size( random ), size( random ) ) );
+	}
+
+	static bool intersect( const BoundingBox& box1, const BoundingBox& box2 )
+	{
+		return box1.getMin().x <= box2.getMax().x && box2.getMin().x <= box1.getMax().x
+			&& box1.getMin().y <= box2.getMax().y && box2.getMin().y <= box1.getMax().y
+			&& box1.getMin().z <= box2.getMax().z && box2.getMin().z <= box1.getMax().z;
+	}
+
+	static float getDistance( const float3& point, const BoundingBox& box )
+	{
+		return max( max( box.getMin() - point, point - box.getMax() ), float3::ZERO ).length();
+	}
+
+	// Distance at which the ray enters the box (0 if it starts inside), FLT_MAX if it misses it.
+	static float getRayDistance( const float3& origin, const float3& direction, const BoundingBox& box )
+	{
+		const auto hit = MathUtil::intersectRayWithBoundingBox( origin, direction, box );
+
+		return std::get< 0 >( hit ) ? std::max( 0.0f, std::get< 1 >( hit ) ) : FLT_MAX;
+	}
+
+	static float3 normalized( float3 vector )
+	{
+		vector.normalize();
+		return vector;
+	}
+
+	static bool isInFrustum( const float44& viewProjection, const BoundingBox& box )
+	{
+		// Box is outside if all its corners are outside of one of the clip planes.
+		int outsideCounts[ 6 ] = { 0, 0, 0, 0, 0, 0 };
+
+		for ( int corner = 0; corner < 8; ++corner )
+		{
+			const float4 position(
+				( corner & 1 ) ? box.getMax().x : box.getMin().x,
+				( corner & 2 ) ? box.getMax().y : box.getMin().y,
+				( corner & 4 ) ? box.getMax().z : box.getMin().z,
+				1.0f
+			);
+
+			const float4 clip = position * viewProjection;
+
+			outsideCounts[ 0 ] += clip.x < -clip.w;
+			outsideCounts[ 1 ] += clip.x > clip.w;
+			outsideCounts[ 2 ] += clip.y < -clip.w;
+			outsideCounts[ 3 ] += clip.y > clip.w;
+			outsideCounts[ 4 ] += clip.z < 0.0f;
+			outsideCounts[ 5 ] += clip.z > clip.w;
+		}
+
+		return std::find( std::begin( outsideCounts ), std::end( outsideCounts ), 8 ) == std::end( outsideCounts );
+	}
+
+	static std::vector< int > sorted( std::vector< int > values )
+	{
+		std::sort( values.begin(), values.end() );
+		return values;
+	}
+
+	public:
+
+	TEST_METHOD( DynamicAabbTree_Proxies )
+	{
+		DynamicAabbTree tree( 0.5f );
+
+		Assert::AreEqual( 0, tree.getHeight() );
+
+		const int proxy1 = tree.createProxy( BoundingBox( float3( 0.0f, 0.0f, 0.0f ), float3( 1.0f, 1.0f, 1.0f ) ), 10 );
+		const int proxy2 = tree.createProxy( BoundingBox( float3( 5.0f, 0.0f, 0.0f ), float3( 6.0f, 1.0f, 1.0f ) ), 20 );
+
+		Assert::AreEqual( 2, tree.getProxyCount() );
+		Assert::AreEqual( 1, tree.getHeight() );
+		Assert::AreEqual( 20, tree.getUserData( proxy2 ) );
+		Assert::IsTrue( MathUtil::areEqual( float3( -0.5f, -0.5f, -0.5f ), tree.getFatBoundingBox( proxy1 ).getMin(), 0.0f, 0.0001f ) );
+
+		// Small move stays in the fat box.
+		Assert::IsFalse( tree.moveProxy( proxy1, BoundingBox( float3( 0.2f, 0.0f, 0.0f ), float3( 1.2f, 1.0f, 1.0f ) ) ) );
+		Assert::IsTrue( MathUtil::areEqual( float3( 1.2f, 1.0f, 1.0f ), tree.getBoundingBox( proxy1 ).getMax(), 0.0f, 0.0001f ) );
+
+		Assert::IsTrue( tree.moveProxy( proxy1, BoundingBox( float3( 2.0f, 0.0f, 0.0f ), float3( 3.0f, 1.0f, 1.0f ) ) ) );
+
+		tree.destroyProxy( proxy2 );
+		Assert::AreEqual( 1, tree.getProxyCount() );
+
+		Assert::ExpectException< std::exception >( [ & ]() { tree.destroyProxy( proxy2 ); } );
+		Assert::ExpectException< std::exception >( [ & ]() { tree.getUserData( -1 ); } );
+
+		std::vector< int > result;
+		tree.queryBox( BoundingBox( float3( 2.5f, 0.5f, 0.5f ), float3( 10.0f, 0.6f, 0.6f ) ), result );
+
+		Assert::AreEqual( (size_t)1, result.size() );
+		Assert::AreEqual( 10, result[ 0 ] );
+	}
+
+	// Compares results of all the queries with testing each box, while boxes are created, moved and destroyed.
+	TEST_METHOD( DynamicAabbTree_Queries_Match_Brute_Force )
+	{
+		const int boxCount = 2000, stepCount = 5, queryCount = 50;
+
+		std::mt19937 random( 7 );
+		std::uniform_real_distribution< float > offset( -1.0f, 1.0f );
+
+		DynamicAabbTree            tree;
+		std::vector< BoundingBox > boxes;
+		std::vector< int >         proxies;
+
+		for ( int i = 0; i < boxCount; ++i ) {
+			boxes.push_back( createRandomBox( random, 100.0f, 5.0f ) );
+			proxies.push_back( tree.createProxy( boxes.back(), i ) );
+		}
+
+		for ( int step = 0; step < stepCount; ++step )
+		{
+			// Move all the boxes - mostly within the fat box, some far away. Destroy every 10th box and create it again.
+			for ( int i = 0; i < boxCount; ++i )
+			{
+				const float3 move = ( i % 7 == 0 )
+					? float3( offset( random ), offset( random ), offset( random ) ) * 50.0f
+					: float3( offset( random ), offset( random ), offset( random ) ) * 0.1f;
+
+				boxes[ i ] = BoundingBox( boxes[ i ].getMin() + move, boxes[ i ].getMax() + move );
+
+				if ( i % 10 == step ) {
+					tree.destroyProxy( proxies[ i ] );
+					proxies[ i ] = tree.createProxy( boxes[ i ], i );
+				} else {
+					tree.moveProxy( proxies[ i ], boxes[ i ] );
+				}
+			}
+
+			Assert::AreEqual( boxCount, tree.getProxyCount() );
+			// Balanced tree of 2000 leaves has height 11 - rotations keep it within a small factor of that.
+			Assert::IsTrue( tree.getHeight() < 30 );
+
+			for ( int query = 0; query < queryCount; ++query )
+			{
+				std::vector< int > result, expected;
+
+				// Box.
+				const BoundingBox queryBox = createRandomBox( random, 100.0f, 40.0f );
+
+				tree.queryBox( queryBox, result );
+				for ( int i = 0; i < boxCount; ++i ) {
+					if ( intersect( boxes[ i ], queryBox ) )
+						expected.push_back( i );
+				}
+
+				Assert::IsTrue( sorted( expected ) == sorted( result ) );
+
+				// Frustum - far plane beyond all the boxes, where the comparison of z and w is too close to call.
+				const float3 eye( offset( random ) * 150.0f, offset( random ) * 150.0f, offset( random ) * 150.0f );
+				const float3 target( offset( random ) * 50.0f, offset( random ) * 50.0f, offset( random ) * 50.0f );
+
+				const float44 viewProjection
+					= MathUtil::lookAtTransformation( target, eye, float3( 0.0f, 1.0f, 0.0f ) )
+					* MathUtil::perspectiveProjectionTransformation( 1.0f, 1.5f, 0.1f, 1000.0f );
+
+				result.clear();
+				expected.clear();
+
+				tree.queryFrustum( viewProjection, result );
+				for ( int i = 0; i < boxCount; ++i ) {
+					if ( isInFrustum( viewProjection, boxes[ i ] ) )
+						expected.push_back( i );
+				}
+
+				Assert::IsTrue( sorted( expected ) == sorted( result ) );
+
+				// K nearest.
+				const float3 point( offset( random ) * 100.0f, offset( random ) * 100.0f, offset( random ) * 100.0f );
+				const int    count = 10;
+
+				result.clear();
+				tree.queryNearest( point, count, result );
+
+				std::vector< float > distances;
+				for ( const BoundingBox& box : boxes )
+					distances.push_back( getDistance( point, box ) );
+
+				std::vector< float > expectedDistances = distances;
+				std::sort( expectedDistances.begin(), expectedDistances.end() );
+
+				Assert::AreEqual( (size_t)count, result.size() );
+				for ( int i = 0; i < count; ++i )
+					Assert::AreEqual( expectedDistances[ i ], distances[ result[ i ] ], 0.0001f );
+
+				// Ray - nearest hit, with the callback shortening the ray.
+				const float3 direction = normalized( float3( offset( random ), offset( random ), offset( random ) ) * 100.0f - point );
+
+				float expectedHitDistance = FLT_MAX;
+				for ( const BoundingBox& box : boxes )
+					expectedHitDistance = std::min( expectedHitDistance, getRayDistance( point, direction, box ) );
+
+				float hitDistance = FLT_MAX;
+				tree.rayCast( point, direction, FLT_MAX, [ & ]( int, float distance ) {
+					hitDistance = std::min( hitDistance, distance );
+					return hitDistance;
+				} );
+
+				Assert::AreEqual( expectedHitDistance, hitDistance, 0.001f );
+			}
+		}
+
+		// Destroy all - tree is empty again.
+		for ( const int proxy : proxies )
+			tree.destroyProxy( proxy );
+
+		Assert::AreEqual( 0, tree.getProxyCount() );
+		Assert::AreEqual( 0, tree.getHeight() );
+	}
+
+	// Query latency with 100k boxes - tree vs testing each box.
+	TEST_METHOD( DynamicAabbTree_Benchmark_100k_Boxes )
+	{
+		const int boxCount = 100000, queryCount = 1000;
+
+		std::mt19937 random( 3 );
+		std::uniform_real_distribution< float > offset( -1.0f, 1.0f );
+
+		std::vector< BoundingBox > boxes;
+		for ( int i = 0; i < boxCount; ++i )
+			boxes.push_back( createRandomBox( random, 1000.0f, 4.0f ) );
+
+		DynamicAabbTree    tree;
+		std::vector< int > proxies( boxCount );
+
+		const Timer buildStartTime;
+		for ( int i = 0; i < boxCount; ++i )
+			proxies[ i ] = tree.createProxy( boxes[ i ], i );
+		const Timer buildEndTime;
+
+		// Small moves of all the boxes (animation, physics) - most stay in their fat boxes.
+		std::vector< BoundingBox > movedBoxes = boxes;
+		for ( BoundingBox& box : movedBoxes ) {
+			const float3 move = float3( offset( random ), offset( random ), offset( random ) ) * 0.15f;
+			box = BoundingBox( box.getMin() + move, box.getMax() + move );
+		}
+
+		int reinsertCount = 0;
+
+		const Timer moveStartTime;
+		for ( int i = 0; i < boxCount; ++i )
+			reinsertCount += tree.moveProxy( proxies[ i ], movedBoxes[ i ] ) ? 1 : 0;
+		const Timer moveEndTime;
+
+		std::vector< BoundingBox > queryBoxes;
+		std::vector< float3 >      queryPoints, queryDirections;
+		for ( int i = 0; i < queryCount; ++i ) {
+			queryBoxes.push_back( createRandomBox( random, 1000.0f, 50.0f ) );
+			queryPoints.push_back( float3( offset( random ), offset( random ), offset( random ) ) * 1000.0f );
+			queryDirections.push_back( normalized( float3( offset( random ), offset( random ), offset( random ) ) ) );
+		}
+
+		std::vector< int > result;
+		size_t treeBoxCount = 0, linearBoxCount = 0;
+
+		// Box.
+		const Timer treeBoxStartTime;
+		for ( const BoundingBox& queryBox : queryBoxes ) {
+			result.clear();
+			tree.queryBox( queryBox, result );
+			treeBoxCount += result.size();
+		}
+		const Timer treeBoxEndTime;
+
+		const Timer linearBoxStartTime;
+		for ( const BoundingBox& queryBox : queryBoxes ) {
+			for ( const BoundingBox& box : movedBoxes )
+				linearBoxCount += intersect( box, queryBox ) ? 1 : 0;
+		}
+		const Timer linearBoxEndTime;
+
+		// Ray - nearest hit.
+		std::vector< float > treeRayDistances( queryCount ), linearRayDistances( queryCount );
+
+		const Timer treeRayStartTime;
+		for ( int i = 0; i < queryCount; ++i ) {
+			float hitDistance = 3000.0f;
+			tree.rayCast( queryPoints[ i ], queryDirections[ i ], hitDistance, [ & ]( int, float distance ) {
+				return hitDistance = std::min( hitDistance, distance );
+			} );
+			treeRayDistances[ i ] = hitDistance;
+		}
+		const Timer treeRayEndTime;
+
+		const Timer linearRayStartTime;
+		for ( int i = 0; i < queryCount; ++i ) {
+			float hitDistance = 3000.0f;
+			for ( const BoundingBox& box : movedBoxes )
+				hitDistance = std::min( hitDistance, getRayDistance( queryPoints[ i ], queryDirections[ i ], box ) );
+			linearRayDistances[ i ] = hitDistance;
+		}
+		const Timer linearRayEndTime;
+
+		// 16 nearest.
+		const Timer treeNearestStartTime;
+		for ( const float3& point : queryPoints ) {
+			result.clear();
+			tree.queryNearest( point, 16, result );
+		}
+		const Timer treeNearestEndTime;
+
+		std::vector< float > distances( boxCount );
+
+		const Timer linearNearestStartTime;
+		for ( const float3& point : queryPoints ) {
+			for ( int i = 0; i < boxCount; ++i )
+				distances[ i ] = getDistance( point, movedBoxes[ i ] );
+			std::nth_element( distances.begin(), distances.begin() + 16, distances.end() );
+		}
+		const Timer linearNearestEndTime;
+
+		// Frustum - camera in the middle of the scene.
+		const float44 viewProjection
+			= MathUtil::lookAtTransformation( float3( 0.0f, 0.0f, 100.0f ), float3::ZERO, float3( 0.0f, 1.0f, 0.0f ) )
+			* MathUtil::perspectiveProjectionTransformation( 1.0f, 1.5f, 0.1f, 500.0f );
+
+		const Timer treeFrustumStartTime;
+		for ( int i = 0; i < 10; ++i ) {
+			result.clear();
+			tree.queryFrustum( viewProjection, result );
+		}
+		const Timer treeFrustumEndTime;
+
+		const auto getDuration = []( const Timer& endTime, const Timer& startTime, const int count ) {
+			return std::to_string( Timer::getElapsedTime( endTime, startTime ) * 1000.0 / count ) + " us";
+		};
+
+		Logger::WriteMessage( (
+			"DynamicAabbTree (" + std::to_string( boxCount ) + " boxes): build " + std::to_string( Timer::getElapsedTime( buildEndTime, buildStartTime ) ) + " ms, "
+			+ "move all " + std::to_string( Timer::getElapsedTime( moveEndTime, moveStartTime ) ) + " ms (" + std::to_string( reinsertCount ) + " reinserted), "
+			+ "height " + std::to_string( tree.getHeight() ) + "\n"
+			+ "Query latency - tree / linear: box " + getDuration( treeBoxEndTime, treeBoxStartTime, queryCount ) + " / " + getDuration( linearBoxEndTime, linearBoxStartTime, queryCount ) + ", "
+			+ "ray " + getDuration( treeRayEndTime, treeRayStartTime, queryCount ) + " / " + getDuration( linearRayEndTime, linearRayStartTime, queryCount ) + ", "
+			+ "16 nearest " + getDuration( treeNearestEndTime, treeNearestStartTime, queryCount ) + " / " + getDuration( linearNearestEndTime, linearNearestStartTime, queryCount ) + ", "
+			+ "frustum " + getDuration( treeFrustumEndTime, treeFrustumStartTime, 10 ) + " (" + std::to_string( result.size() ) + " boxes)\n"
+		).c_str() );
+
+		// Rays which only graze a box edge can be resolved differently by the two slab tests - allow a few of them.
+		int rayMismatchCount = 0;
+		for ( int i = 0; i < queryCount; ++i )
+			rayMismatchCount += std::abs( linearRayDistances[ i ] - treeRayDistances[ i ] ) > 0.01f ? 1 : 0;
+
+		Assert::AreEqual( linearBoxCount, treeBoxCount );
+		Assert::IsTrue( rayMismatchCount <= queryCount / 100 );
+	}
+	};
+}
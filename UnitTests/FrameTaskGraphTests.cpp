@@ -0,0 +1,259 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FrameTaskGraph.h"
+#include "Animator.h"
+#include "BlockActor.h"
+#include "RenderCommandList.h"
+#include "NullRenderCommandBackend.h"
+#include "MathUtil.h"
+#include "Timer.h"
+
+using namespace Engine1;
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTests
+{
+	TEST_CLASS( FrameTaskGraphTests )
+	{
+	private:
+
+	// Stand-ins for the GPU objects - only their addresses are recorded.
+	int m_vertexShader, m_fragmentShader, m_renderTarget, m_depthStencil, m_mesh;
+
+	// Keeps the thread busy for about the given time, as a simulation or submission step would.
+	static void spin( const double durationMs )
+	{
+		const Timer startTime;
+		for ( ;; ) {
+			const Timer time;
+			if ( Timer::getElapsedTime( time, startTime ) >= durationMs )
+				return;
+		}
+	}
+
+	// Sum of the actor translations - changes whenever any of the poses changes.
+	static float3 getPoseChecksum( const std::vector< std::shared_ptr< BlockActor > >& actors )
+	{
+		float3 checksum = float3::ZERO;
+		for ( const auto& actor : actors )
+			checksum += actor->getPose().getTranslation();
+
+		return checksum;
+	}
+
+	// Records a draw of each actor, reading its pose as the renderer does, and executes the commands without a GPU.
+	void submitFrame( const std::vector< std::shared_ptr< BlockActor > >& actors, RenderCommandList& commandList, NullRenderCommandBackend& backend )
+	{
+		const RenderHandle renderTargets[] = { &m_renderTarget };
+
+		commandList.clear();
+		commandList.beginPass( "render" );
+		commandList.setRenderingShaders( &m_vertexShader, &m_fragmentShader );
+		commandList.setRenderTargets( renderTargets, 1, &m_depthStencil, nullptr, 0 );
+
+		for ( const auto& actor : actors ) {
+			if ( actor->getPose().getTranslation().z >= 0.0f )
+				commandList.draw( &m_mesh, 36 );
+		}
+
+		commandList.unbindRenderTargets();
+		commandList.endPass();
+
+		backend.reset();
+		commandList.execute( backend );
+	}
+
+	public:
+
+	TEST_METHOD( FrameTaskGraph_Dependency_Order )
+	{
+		FrameTaskGraph graph;
+
+		std::mutex        orderMutex;
+		std::vector< int > order;
+
+		const auto addTask = [ & ]( const int id, const bool mainThread ) {
+			return graph.addTask( "task" + std::to_string( id ), [ &, id ]() {
+				spin( 1.0 );
+				std::lock_guard< std::mutex > lock( orderMutex );
+				order.push_back( id );
+			}, mainThread );
+		};
+
+		// Diamond - 0 before 1 and 2, both before 3 (which runs on the main thread).
+		const int task0 = addTask( 0, false );
+		const int task1 = addTask( 1, false );
+		const int task2 = addTask( 2, false );
+		const int task3 = addTask( 3, true );
+
+		graph.addDependency( task1, task0 );
+		graph.addDependency( task2, task0 );
+		graph.addDependency( task3, task1 );
+		graph.addDependency( task3, task2 );
+
+		// The graph can be executed many times.
+		for ( int frame = 0; frame < 3; ++frame )
+		{
+			order.clear();
+			graph.execute();
+
+			Assert::AreEqual( 4, (int)order.size() );
+			Assert::AreEqual( 0, order.front() );
+			Assert::AreEqual( 3, order.back() );
+
+			const FrameTaskGraph::Statistics& statistics = graph.getStatistics();
+			Assert::IsTrue( statistics.busyTime >= 4.0 );
+			Assert::IsTrue( statistics.criticalPathTime >= 3.0 );
+			Assert::IsTrue( statistics.criticalPathTime <= statistics.busyTime );
+			Assert::IsTrue( graph.getTaskStatistics( task3 ).startTime >= graph.getTaskStatistics( task1 ).startTime + graph.getTaskStatistics( task1 ).duration );
+		}
+
+		Assert::AreEqual( std::string( "task2" ), graph.getTaskName( task2 ) );
+	}
+
+	TEST_METHOD( FrameTaskGraph_Main_Thread_Tasks )
+	{
+		FrameTaskGraph graph;
+
+		const std::thread::id mainThreadId = std::this_thread::get_id();
+		std::atomic< int >    mainThreadTaskCount( 0 );
+
+		for ( int taskIdx = 0; taskIdx < 16; ++taskIdx )
+		{
+			graph.addTask( "main", [ & ]() {
+				if ( std::this_thread::get_id() == mainThreadId )
+					++mainThreadTaskCount;
+			}, true );
+
+			graph.addTask( "worker", []() { spin( 0.1 ); } );
+		}
+
+		graph.execute();
+
+		Assert::AreEqual( 16, mainThreadTaskCount.load() );
+	}
+
+	TEST_METHOD( FrameTaskGraph_Exceptions )
+	{
+		FrameTaskGraph graph;
+
+		bool dependentExecuted = false, independentExecuted = false;
+
+		const int failingTask     = graph.addTask( "failing", []() { throw std::exception( "failure" ); } );
+		const int dependentTask   = graph.addTask( "dependent", [ & ]() { dependentExecuted = true; }, true );
+		const int transitiveTask  = graph.addTask( "transitive", [ & ]() { dependentExecuted = true; } );
+		graph.addTask( "independent", [ & ]() { independentExecuted = true; } );
+
+		graph.addDependency( dependentTask, failingTask );
+		graph.addDependency( transitiveTask, dependentTask );
+
+		Assert::ExpectException< std::exception >( [ &graph ]() { graph.execute(); } );
+		Assert::IsFalse( dependentExecuted );
+		Assert::IsTrue( independentExecuted );
+
+		// Invalid dependencies.
+		Assert::ExpectException< std::exception >( [ &graph ]() { graph.addDependency( 0, 0 ); } );
+		Assert::ExpectException< std::exception >( [ &graph ]() { graph.addDependency( 0, 10 ); } );
+
+		graph.clear();
+
+		const int taskA = graph.addTask( "a", []() {} );
+		const int taskB = graph.addTask( "b", []() {} );
+		graph.addDependency( taskA, taskB );
+		graph.addDependency( taskB, taskA );
+
+		Assert::ExpectException< std::exception >( [ &graph ]() { graph.execute(); } );
+	}
+
+	// Headless frame loop - animation of many actors is evaluated on worker threads while the main thread submits draws of the previous frame.
+	// Logs CPU frame time and core utilization with the simulation running before the submission (sequential) and next to it (pipelined).
+	TEST_METHOD( FrameTaskGraph_Benchmark_Pipelined_Frame_Update )
+	{
+		const int actorCount = 20000, keyframeCount = 10, frameCount = 30;
+
+		Animator< BlockActor > animator;
+
+		std::vector< std::shared_ptr< BlockActor > > actors;
+		for ( int i = 0; i < actorCount; ++i ) {
+			actors.push_back( std::make_shared< BlockActor >( nullptr ) );
+
+			for ( int keyframe = 0; keyframe < keyframeCount; ++keyframe ) {
+				actors.back()->getPose().setTranslation( float3( (float)keyframe, (float)i, (float)( keyframe % 2 ) ) );
+				animator.addKeyframe( actors.back(), (float)keyframe );
+			}
+
+			animator.setPlaying( actors.back(), true );
+		}
+
+		RenderCommandList        commandList;
+		NullRenderCommandBackend backend;
+
+		double frameTimes[ 2 ];
+		for ( const bool pipelined : { false, true } )
+		{
+			FrameTaskGraph graph;
+
+			bool stablePoses = true;
+
+			// Physics stand-in - keeps a worker thread busy for a part of the frame.
+			const int physicsTask   = graph.addTask( "physics", []() { spin( 2.0 ); } );
+			const int animationTask = graph.addTask( "animation", [ &animator ]() { animator.evaluate( 0.05f ); } );
+			const int applyTask     = graph.addTask( "applySimulation", [ &animator ]() { animator.apply(); }, true );
+			const int renderTask    = graph.addTask( "render", [ & ]()
+			{
+				const float3 checksum = getPoseChecksum( actors );
+
+				submitFrame( actors, commandList, backend );
+
+				// Presentation stand-in.
+				spin( 2.0 );
+
+				if ( !MathUtil::areEqual( checksum, getPoseChecksum( actors ), 0.0f, 0.0f ) )
+					stablePoses = false;
+			}, true );
+
+			graph.addDependency( applyTask, physicsTask );
+			graph.addDependency( applyTask, animationTask );
+
+			if ( pipelined )
+				graph.addDependency( applyTask, renderTask );
+			else
+				graph.addDependency( renderTask, applyTask );
+
+			double frameTime = 0.0, criticalPathTime = 0.0;
+			float  coreUtilization = 0.0f;
+
+			for ( int frame = 0; frame < frameCount; ++frame )
+			{
+				graph.execute();
+
+				frameTime        += graph.getStatistics().frameTime;
+				criticalPathTime += graph.getStatistics().criticalPathTime;
+				coreUtilization  += graph.getStatistics().coreUtilization;
+			}
+
+			frameTimes[ pipelined ? 1 : 0 ] = frameTime / frameCount;
+
+			Logger::WriteMessage( (
+				std::string( pipelined ? "Pipelined" : "Sequential" ) + " frame update (" + std::to_string( actorCount ) + " actors, "
+				+ std::to_string( graph.getStatistics().threadCount ) + " threads): frame " + std::to_string( frameTime / frameCount ) + " ms, "
+				+ "critical path " + std::to_string( criticalPathTime / frameCount ) + " ms, "
+				+ "core utilization " + std::to_string( coreUtilization / frameCount * 100.0f ) + "%\n"
+			).c_str() );
+
+			// Renderer always sees poses of a single frame - simulation doesn't modify the scene until it's applied.
+			Assert::IsTrue( stablePoses );
+			Assert::AreEqual( actorCount, backend.getStatistics().drawCount );
+		}
+
+		// Timing depends on the machine and its load - only logged.
+		Logger::WriteMessage( ( "Pipelined / sequential frame time: " + std::to_string( frameTimes[ 1 ] / frameTimes[ 0 ] ) + "\n" ).c_str() );
+	}
+	};
+}
@@ -0,0 +1,207 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <string>
+
+#include "LightClusters.h"
+#include "PointLight.h"
+#include "SpotLight.h"
+#include "MathUtil.h"
+#include "Timer.h"
+
+using namespace Engine1;
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTests
+{
+	TEST_CLASS( LightClustersTests )
+	{
+	private:
+
+	static const float fieldOfView;
+	static const float aspectRatio;
+	static const float zNear;
+	static const float zFar;
+
+	// Camera at the origin looking along +z - view space is the same as world space.
+	static float44 getViewMatrix()
+	{
+		return MathUtil::lookAtTransformation( float3( 0.0f, 0.0f, 1.0f ), float3::ZERO, float3( 0.0f, 1.0f, 0.0f ) );
+	}
+
+	// Cluster containing the given view space point (which has to be inside the frustum).
+	static int getClusterIndex( const LightClusters& clusters, const float3& point )
+	{
+		const float tanHalfFovY = std::tan( fieldOfView * 0.5f );
+		const float tanHalfFovX = tanHalfFovY * aspectRatio;
+
+		const int tileX = std::min( LightClusters::s_tileCountX - 1, (int)( ( point.x / point.z / tanHalfFovX + 1.0f ) * 0.5f * LightClusters::s_tileCountX ) );
+		const int tileY = std::min( LightClusters::s_tileCountY - 1, (int)( ( 1.0f - point.y / point.z / tanHalfFovY ) * 0.5f * LightClusters::s_tileCountY ) );
+
+		return LightClusters::getClusterIndex( tileX, tileY, clusters.getSlice( point.z ) );
+	}
+
+	static bool containsLight( const LightClusters& clusters, const int clusterIdx, const int lightIdx )
+	{
+		const auto& offsets = clusters.getClusterLightOffsets();
+		const auto& indices = clusters.getClusterLightIndices();
+
+		return std::find( indices.begin() + offsets[ clusterIdx ], indices.begin() + offsets[ clusterIdx + 1 ], lightIdx ) != indices.begin() + offsets[ clusterIdx + 1 ];
+	}
+
+	public:
+
+	TEST_METHOD( LightClusters_Light_Lists )
+	{
+		std::mt19937 random( 3 );
+		std::uniform_real_distribution< float > lightPosition( -600.0f, 600.0f );
+		std::uniform_real_distribution< float > slope( -0.99f, 0.99f );
+		std::uniform_real_distribution< float > depth( zNear, zFar );
+
+		std::vector< std::shared_ptr< Light > > lights;
+		for ( int i = 0; i < 64; ++i )
+			lights.push_back( std::make_shared< PointLight >( float3( lightPosition( random ), lightPosition( random ), lightPosition( random ) ) ) );
+
+		LightClusters clusters;
+		clusters.build( getViewMatrix(), fieldOfView, aspectRatio, zNear, zFar, lights, {} );
+
+		const auto& offsets = clusters.getClusterLightOffsets();
+		const auto& indices = clusters.getClusterLightIndices();
+
+		Assert::AreEqual( LightClusters::s_clusterCount + 1, (int)offsets.size() );
+		Assert::AreEqual( (int)indices.size(), (int)offsets.back() );
+
+		for ( int clusterIdx = 0; clusterIdx < LightClusters::s_clusterCount; ++clusterIdx ) {
+			Assert::IsTrue( offsets[ clusterIdx ] <= offsets[ clusterIdx + 1 ] );
+			Assert::IsTrue( std::is_sorted( indices.begin() + offsets[ clusterIdx ], indices.begin() + offsets[ clusterIdx + 1 ] ) );
+		}
+
+		// Any point within a light's range has to be in a cluster which lists the light.
+		const float tanHalfFovY = std::tan( fieldOfView * 0.5f );
+		const float tanHalfFovX = tanHalfFovY * aspectRatio;
+
+		for ( int i = 0; i < 10000; ++i )
+		{
+			const float  pointDepth = depth( random );
+			const float3 point( slope( random ) * tanHalfFovX * pointDepth, slope( random ) * tanHalfFovY * pointDepth, pointDepth );
+			const int    clusterIdx = getClusterIndex( clusters, point );
+
+			for ( int lightIdx = 0; lightIdx < (int)lights.size(); ++lightIdx ) {
+				if ( ( lights[ lightIdx ]->getPosition() - point ).length() < LightClusters::getLightRange( *lights[ lightIdx ] ) )
+					Assert::IsTrue( containsLight( clusters, clusterIdx, lightIdx ) );
+			}
+		}
+
+		// Clusters beyond the range of a light don't list it.
+		const std::vector< std::shared_ptr< Light > > singleLight = { std::make_shared< PointLight >( float3( 0.0f, 0.0f, 10.0f ) ) };
+		const float range = LightClusters::getLightRange( *singleLight[ 0 ] );
+
+		clusters.build( getViewMatrix(), fieldOfView, aspectRatio, zNear, zFar, singleLight, {} );
+
+		Assert::IsTrue( containsLight( clusters, getClusterIndex( clusters, float3( 0.0f, 0.0f, 10.0f ) ), 0 ) );
+		Assert::IsFalse( containsLight( clusters, getClusterIndex( clusters, float3( 0.0f, 0.0f, 10.0f + range * 1.5f ) ), 0 ) );
+	}
+
+	TEST_METHOD( LightClusters_Spot_Light_Cone )
+	{
+		const std::vector< std::shared_ptr< Light > > lights = {
+			std::make_shared< SpotLight >( float3( 0.0f, 0.0f, 0.0f ), float3( 0.0f, 0.0f, 1.0f ), MathUtil::degreesToRadians( 5.0f ) )
+		};
+
+		LightClusters clusters;
+		clusters.build( getViewMatrix(), fieldOfView, aspectRatio, zNear, zFar, lights, {} );
+
+		const float tanHalfFovY = std::tan( fieldOfView * 0.5f );
+		const float tanHalfFovX = tanHalfFovY * aspectRatio;
+
+		Assert::IsTrue( containsLight( clusters, getClusterIndex( clusters, float3( 0.0f, 0.0f, 50.0f ) ), 0 ) );
+		Assert::IsFalse( containsLight( clusters, getClusterIndex( clusters, float3( 0.9f * tanHalfFovX * 50.0f, 0.9f * tanHalfFovY * 50.0f, 50.0f ) ), 0 ) );
+	}
+
+	TEST_METHOD( LightClusters_Importance )
+	{
+		// Wall in front of the camera, covering the whole screen.
+		const std::vector< BoundingBox > receivers = { BoundingBox( float3( -100.0f, -100.0f, 20.0f ), float3( 100.0f, 100.0f, 21.0f ) ) };
+
+		const auto nearTheWall    = std::make_shared< PointLight >( float3( 0.0f, 0.0f, 18.0f ) );
+		const auto farFromTheWall = std::make_shared< PointLight >( float3( 0.0f, 50.0f, 150.0f ) );
+		const auto dim            = std::make_shared< PointLight >( float3( 0.0f, 0.0f, 18.0f ), float3( 0.01f, 0.01f, 0.01f ) );
+		const auto outOfRange     = std::make_shared< PointLight >( float3( 0.0f, 0.0f, -2000.0f ) );
+		const auto facingAway     = std::make_shared< SpotLight >( float3( 0.0f, 0.0f, 10.0f ), float3( 0.0f, 0.0f, -1.0f ), MathUtil::degreesToRadians( 20.0f ) );
+
+		const std::vector< std::shared_ptr< Light > > lights = { outOfRange, dim, farFromTheWall, facingAway, nearTheWall };
+
+		LightClusters clusters;
+		clusters.build( getViewMatrix(), fieldOfView, aspectRatio, zNear, zFar, lights, receivers );
+
+		const auto& lightsByImportance = clusters.getLightsByImportance();
+
+		Assert::AreEqual( 3, (int)lightsByImportance.size() );
+		Assert::AreEqual( 4, lightsByImportance[ 0 ] );
+		Assert::AreEqual( 2, lightsByImportance[ 1 ] );
+		Assert::AreEqual( 1, lightsByImportance[ 2 ] );
+		Assert::AreEqual( 0.0f, clusters.getLightImportance()[ 0 ] );
+		Assert::AreEqual( 0.0f, clusters.getLightImportance()[ 3 ] );
+
+		Assert::AreEqual( LightClusters::s_tileCountX * LightClusters::s_tileCountY, clusters.getStatistics().visibleClusterCount );
+
+		// Nothing visible - no light contributes to the image.
+		clusters.build( getViewMatrix(), fieldOfView, aspectRatio, zNear, zFar, lights, {} );
+		Assert::AreEqual( 0, (int)clusters.getLightsByImportance().size() );
+	}
+
+	TEST_METHOD( LightClusters_Benchmark )
+	{
+		std::mt19937 random( 5 );
+		std::uniform_real_distribution< float > position( -300.0f, 300.0f );
+		std::uniform_real_distribution< float > size( 0.5f, 10.0f );
+
+		std::vector< BoundingBox > receivers;
+		for ( int i = 0; i < 2000; ++i ) {
+			const float3 center( position( random ), position( random ) * 0.1f, 20.0f + std::abs( position( random ) ) );
+			const float3 extent( size( random ), size( random ), size( random ) );
+			receivers.push_back( BoundingBox( center - extent, center + extent ) );
+		}
+
+		for ( const int lightCount : { 16, 256, 1024 } )
+		{
+			std::vector< std::shared_ptr< Light > > lights;
+			for ( int i = 0; i < lightCount; ++i ) {
+				const float3 lightPosition( position( random ), position( random ) * 0.1f + 20.0f, position( random ) );
+
+				if ( i % 2 == 0 )
+					lights.push_back( std::make_shared< PointLight >( lightPosition ) );
+				else
+					lights.push_back( std::make_shared< SpotLight >( lightPosition, float3( 0.0f, -1.0f, 0.0f ), MathUtil::degreesToRadians( 30.0f ) ) );
+			}
+
+			LightClusters clusters;
+
+			const int repeatCount = 10;
+
+			const Timer startTime;
+			for ( int i = 0; i < repeatCount; ++i )
+				clusters.build( getViewMatrix(), fieldOfView, aspectRatio, zNear, zFar, lights, receivers );
+			const Timer endTime;
+
+			const auto& statistics = clusters.getStatistics();
+
+			Logger::WriteMessage( (
+				std::to_string( lightCount ) + " lights: " + std::to_string( Timer::getElapsedTime( endTime, startTime ) / repeatCount ) + " ms per build, "
+				+ std::to_string( statistics.visibleLightCount ) + " lights visible, "
+				+ std::to_string( statistics.lightClusterPairCount ) + " light-cluster pairs, "
+				+ std::to_string( statistics.visibleClusterCount ) + " visible clusters\n"
+			).c_str() );
+		}
+	}
+	};
+
+	const float LightClustersTests::fieldOfView = MathUtil::degreesToRadians( 70.0f );
+	const float LightClustersTests::aspectRatio = 16.0f / 9.0f;
+	const float LightClustersTests::zNear       = 0.1f;
+	const float LightClustersTests::zFar        = 1000.0f;
+}
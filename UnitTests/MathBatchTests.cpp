@@ -0,0 +1,327 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <vector>
+#include <string>
+#include <random>
+#include <functional>
+
+#include "MathBatch.h"
+#include "MathUtil.h"
+#include "float43.h"
+#include "float44.h"
+#include "quat.h"
+#include "BoundingBox.h"
+#include "Timer.h"
+
+using namespace Engine1;
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTests
+{
+	TEST_CLASS( MathBatchTests )
+	{
+	private:
+
+	// Scalar versions of the operations - reference for the SIMD backend.
+
+	static float3 transformReference( const float3& a, const float43& b )
+	{
+		return float3(
+			a.x * b.m11 + a.y * b.m21 + a.z * b.m31 + b.t1,
+			a.x * b.m12 + a.y * b.m22 + a.z * b.m32 + b.t2,
+			a.x * b.m13 + a.y * b.m23 + a.z * b.m33 + b.t3
+		);
+	}
+
+	static float43 multiplyReference( const float43& a, const float43& b )
+	{
+		float43 result;
+		result.setRow1( transformReference( a.getRow1(), b ) - b.getTranslation() );
+		result.setRow2( transformReference( a.getRow2(), b ) - b.getTranslation() );
+		result.setRow3( transformReference( a.getRow3(), b ) - b.getTranslation() );
+		result.setTranslation( transformReference( a.getTranslation(), b ) );
+
+		return result;
+	}
+
+	static float44 multiplyReference( const float44& a, const float44& b )
+	{
+		float data[ 4 ][ 4 ];
+		for ( int row = 0; row < 4; ++row ) {
+			for ( int column = 0; column < 4; ++column ) {
+				data[ row ][ column ] = 0.0f;
+				for ( int i = 0; i < 4; ++i )
+					data[ row ][ column ] += ( &a.m11 )[ row * 4 + i ] * ( &b.m11 )[ i * 4 + column ];
+			}
+		}
+
+		return float44( data );
+	}
+
+	static quat multiplyReference( const quat& a, const quat& b )
+	{
+		return quat(
+			a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z,
+			a.w * b.x + a.x * b.w + a.z * b.y - a.y * b.z,
+			a.w * b.y + a.y * b.w + a.x * b.z - a.z * b.x,
+			a.w * b.z + a.z * b.w + a.y * b.x - a.x * b.y
+		);
+	}
+
+	static float43 createTransform( std::mt19937& random )
+	{
+		std::uniform_real_distribution< float > distribution( -1.0f, 1.0f );
+
+		quat orientation( distribution( random ), distribution( random ), distribution( random ), distribution( random ) );
+		orientation.normalize();
+
+		float43 transform( orientation );
+		transform.setRow1( transform.getRow1() * 2.0f ); // Non-uniform scale.
+		transform.setTranslation( float3( distribution( random ), distribution( random ), distribution( random ) ) * 10.0f );
+
+		return transform;
+	}
+
+	static std::vector< float3 > createPoints( std::mt19937& random, const int count )
+	{
+		std::uniform_real_distribution< float > distribution( -10.0f, 10.0f );
+
+		std::vector< float3 > points( count );
+		for ( float3& point : points )
+			point = float3( distribution( random ), distribution( random ), distribution( random ) );
+
+		return points;
+	}
+
+	static bool areEqual( const float43& a, const float43& b )
+	{
+		for ( int i = 0; i < 12; ++i ) {
+			if ( !MathUtil::areEqual( ( &a.m11 )[ i ], ( &b.m11 )[ i ], 0.0001f, 0.0001f ) )
+				return false;
+		}
+
+		return true;
+	}
+
+	static bool areEqual( const float44& a, const float44& b )
+	{
+		for ( int i = 0; i < 16; ++i ) {
+			if ( !MathUtil::areEqual( ( &a.m11 )[ i ], ( &b.m11 )[ i ], 0.0001f, 0.0001f ) )
+				return false;
+		}
+
+		return true;
+	}
+
+	// Returns nanoseconds per element.
+	static double measure( const int elementCount, const int repeatCount, const std::function< void() >& operation )
+	{
+		operation(); // Warm up.
+
+		const Timer startTime;
+		for ( int i = 0; i < repeatCount; ++i )
+			operation();
+		const Timer endTime;
+
+		return Timer::getElapsedTime( endTime, startTime ) * 1000000.0 / ( (double)elementCount * repeatCount );
+	}
+
+	static void logBenchmark( const std::string& operation, const double scalarTime, const double simdTime )
+	{
+		Logger::WriteMessage( (
+			operation + ": scalar " + std::to_string( scalarTime ) + " ns, SIMD " + std::to_string( simdTime ) + " ns per element (x"
+			+ std::to_string( scalarTime / simdTime ) + ")\n"
+		).c_str() );
+	}
+
+	public:
+
+	TEST_METHOD( MathBatch_Results_Match_Scalar_Operations )
+	{
+		std::mt19937 random( 7 );
+
+		// Counts not divisible by the SIMD width test the remainder loops.
+		for ( const int count : { 0, 1, 3, 4, 7, 8, 13, 33 } ) {
+			const float43 transform = createTransform( random );
+
+			const std::vector< float3 > points = createPoints( random, count );
+			std::vector< float3 >       transformedPoints( count ), transformedDirections( count ), normalizedPoints( count );
+			MathBatch::transformPoints( points.data(), transform, transformedPoints.data(), count );
+			MathBatch::transformDirections( points.data(), transform, transformedDirections.data(), count );
+			MathBatch::normalize( points.data(), normalizedPoints.data(), count );
+
+			std::vector< float43 > matrices1, matrices2;
+			std::vector< float44 > matrices3, matrices4;
+			std::vector< quat >    quats1, quats2;
+			for ( int i = 0; i < count; ++i ) {
+				matrices1.push_back( createTransform( random ) );
+				matrices2.push_back( createTransform( random ) );
+				matrices3.push_back( float44( createTransform( random ) ) );
+				matrices4.push_back( float44( createTransform( random ) ) );
+				matrices4.back().m14 = 0.5f; // Full 4x4 matrix.
+				quats1.push_back( quat( matrices1.back() ) );
+				quats2.push_back( quat( matrices2.back() ) );
+			}
+
+			std::vector< float43 > products43( count ), productsWithTransform( count );
+			std::vector< float44 > products44( count );
+			std::vector< quat >    productsQuat( count );
+			MathBatch::multiply( matrices1.data(), matrices2.data(), products43.data(), count );
+			MathBatch::multiply( matrices1.data(), transform, productsWithTransform.data(), count );
+			MathBatch::multiply( matrices3.data(), matrices4.data(), products44.data(), count );
+			MathBatch::multiply( quats1.data(), quats2.data(), productsQuat.data(), count );
+
+			for ( int i = 0; i < count; ++i ) {
+				Assert::IsTrue( MathUtil::areEqual( transformReference( points[ i ], transform ), transformedPoints[ i ], 0.0001f, 0.0001f ) );
+				Assert::IsTrue( MathUtil::areEqual( transformReference( points[ i ], transform ) - transform.getTranslation(), transformedDirections[ i ], 0.0001f, 0.0001f ) );
+
+				float3 normalizedPoint = points[ i ];
+				normalizedPoint.normalize();
+				Assert::IsTrue( MathUtil::areEqual( normalizedPoint, normalizedPoints[ i ], 0.0001f, 0.0001f ) );
+
+				// Single operations.
+				Assert::IsTrue( MathUtil::areEqual( transformReference( points[ i ], transform ), points[ i ] * transform, 0.0001f, 0.0001f ) );
+				Assert::IsTrue( areEqual( multiplyReference( matrices1[ i ], matrices2[ i ] ), matrices1[ i ] * matrices2[ i ] ) );
+				Assert::IsTrue( areEqual( multiplyReference( matrices3[ i ], matrices4[ i ] ), matrices3[ i ] * matrices4[ i ] ) );
+				Assert::IsTrue( MathUtil::areEqual( multiplyReference( quats1[ i ], quats2[ i ] ), quats1[ i ] * quats2[ i ], 0.0001f, 0.0001f ) );
+
+				Assert::IsTrue( areEqual( multiplyReference( matrices1[ i ], matrices2[ i ] ), products43[ i ] ) );
+				Assert::IsTrue( areEqual( multiplyReference( matrices1[ i ], transform ), productsWithTransform[ i ] ) );
+				Assert::IsTrue( areEqual( multiplyReference( matrices3[ i ], matrices4[ i ] ), products44[ i ] ) );
+				Assert::IsTrue( MathUtil::areEqual( multiplyReference( quats1[ i ], quats2[ i ] ), productsQuat[ i ], 0.0001f, 0.0001f ) );
+			}
+		}
+	}
+
+	TEST_METHOD( MathBatch_In_Place_Transform )
+	{
+		std::mt19937 random( 3 );
+
+		const float43         transform = createTransform( random );
+		const std::vector< float3 > points = createPoints( random, 21 );
+
+		std::vector< float3 > transformedPoints = points;
+		MathBatch::transformPoints( transformedPoints.data(), transform, transformedPoints.data(), (int)transformedPoints.size() );
+
+		for ( int i = 0; i < (int)points.size(); ++i )
+			Assert::IsTrue( MathUtil::areEqual( transformReference( points[ i ], transform ), transformedPoints[ i ], 0.0001f, 0.0001f ) );
+
+		std::vector< float43 > matrices1, matrices2;
+		for ( int i = 0; i < 11; ++i ) {
+			matrices1.push_back( createTransform( random ) );
+			matrices2.push_back( createTransform( random ) );
+		}
+
+		std::vector< float43 > products = matrices1;
+		MathBatch::multiply( products.data(), matrices2.data(), products.data(), (int)products.size() );
+
+		for ( int i = 0; i < (int)products.size(); ++i )
+			Assert::IsTrue( areEqual( multiplyReference( matrices1[ i ], matrices2[ i ] ), products[ i ] ) );
+	}
+
+	TEST_METHOD( MathUtil_boundingBoxLocalToWorld_Bounds_Transformed_Corners )
+	{
+		std::mt19937 random( 5 );
+
+		const BoundingBox box( float3( -1.0f, 2.0f, -3.0f ), float3( 4.0f, 5.0f, 6.0f ) );
+
+		for ( int i = 0; i < 10; ++i ) {
+			const float43     transform = createTransform( random );
+			const BoundingBox worldBox  = MathUtil::boundingBoxLocalToWorld( box, transform );
+
+			float3 cornersMin( FLT_MAX, FLT_MAX, FLT_MAX ), cornersMax( -FLT_MAX, -FLT_MAX, -FLT_MAX );
+			for ( int corner = 0; corner < 8; ++corner ) {
+				const float3 cornerPosition(
+					corner & 1 ? box.getMax().x : box.getMin().x,
+					corner & 2 ? box.getMax().y : box.getMin().y,
+					corner & 4 ? box.getMax().z : box.getMin().z
+				);
+
+				cornersMin = min( cornersMin, transformReference( cornerPosition, transform ) );
+				cornersMax = max( cornersMax, transformReference( cornerPosition, transform ) );
+			}
+
+			Assert::IsTrue( MathUtil::areEqual( cornersMin, worldBox.getMin(), 0.0001f, 0.0001f ) );
+			Assert::IsTrue( MathUtil::areEqual( cornersMax, worldBox.getMax(), 0.0001f, 0.0001f ) );
+		}
+	}
+
+	TEST_METHOD( MathBatch_Benchmark )
+	{
+		const int count = 100000, repeatCount = 20;
+
+		std::mt19937 random( 11 );
+
+		const float43 transform = createTransform( random );
+
+		const std::vector< float3 > points = createPoints( random, count );
+		std::vector< float3 >       transformedPoints( count );
+
+		std::vector< float43 > matrices1, matrices2, products43( count );
+		std::vector< float44 > matrices3, matrices4, products44( count );
+		std::vector< quat >    quats1, quats2, productsQuat( count );
+		for ( int i = 0; i < count; ++i ) {
+			matrices1.push_back( createTransform( random ) );
+			matrices2.push_back( createTransform( random ) );
+			matrices3.push_back( float44( matrices1.back() ) );
+			matrices4.push_back( float44( matrices2.back() ) );
+			quats1.push_back( quat( matrices1.back() ) );
+			quats2.push_back( quat( matrices2.back() ) );
+		}
+
+		logBenchmark( "float3 * float43 (single)",
+			measure( count, repeatCount, [&]() { for ( int i = 0; i < count; ++i ) transformedPoints[ i ] = transformReference( points[ i ], transform ); } ),
+			measure( count, repeatCount, [&]() { for ( int i = 0; i < count; ++i ) transformedPoints[ i ] = points[ i ] * transform; } ) );
+
+		logBenchmark( "MathBatch::transformPoints",
+			measure( count, repeatCount, [&]() { for ( int i = 0; i < count; ++i ) transformedPoints[ i ] = transformReference( points[ i ], transform ); } ),
+			measure( count, repeatCount, [&]() { MathBatch::transformPoints( points.data(), transform, transformedPoints.data(), count ); } ) );
+
+		logBenchmark( "float43 * float43 (single)",
+			measure( count, repeatCount, [&]() { for ( int i = 0; i < count; ++i ) products43[ i ] = multiplyReference( matrices1[ i ], matrices2[ i ] ); } ),
+			measure( count, repeatCount, [&]() { for ( int i = 0; i < count; ++i ) products43[ i ] = matrices1[ i ] * matrices2[ i ]; } ) );
+
+		logBenchmark( "MathBatch::multiply (float43)",
+			measure( count, repeatCount, [&]() { for ( int i = 0; i < count; ++i ) products43[ i ] = multiplyReference( matrices1[ i ], matrices2[ i ] ); } ),
+			measure( count, repeatCount, [&]() { MathBatch::multiply( matrices1.data(), matrices2.data(), products43.data(), count ); } ) );
+
+		logBenchmark( "MathBatch::multiply (float43 by one transform)",
+			measure( count, repeatCount, [&]() { for ( int i = 0; i < count; ++i ) products43[ i ] = multiplyReference( matrices1[ i ], transform ); } ),
+			measure( count, repeatCount, [&]() { MathBatch::multiply( matrices1.data(), transform, products43.data(), count ); } ) );
+
+		logBenchmark( "float44 * float44 (single)",
+			measure( count, repeatCount, [&]() { for ( int i = 0; i < count; ++i ) products44[ i ] = multiplyReference( matrices3[ i ], matrices4[ i ] ); } ),
+			measure( count, repeatCount, [&]() { for ( int i = 0; i < count; ++i ) products44[ i ] = matrices3[ i ] * matrices4[ i ]; } ) );
+
+		logBenchmark( "MathBatch::multiply (float44)",
+			measure( count, repeatCount, [&]() { for ( int i = 0; i < count; ++i ) products44[ i ] = multiplyReference( matrices3[ i ], matrices4[ i ] ); } ),
+			measure( count, repeatCount, [&]() { MathBatch::multiply( matrices3.data(), matrices4.data(), products44.data(), count ); } ) );
+
+		logBenchmark( "quat * quat (single)",
+			measure( count, repeatCount, [&]() { for ( int i = 0; i < count; ++i ) productsQuat[ i ] = multiplyReference( quats1[ i ], quats2[ i ] ); } ),
+			measure( count, repeatCount, [&]() { for ( int i = 0; i < count; ++i ) productsQuat[ i ] = quats1[ i ] * quats2[ i ]; } ) );
+
+		logBenchmark( "MathBatch::multiply (quat)",
+			measure( count, repeatCount, [&]() { for ( int i = 0; i < count; ++i ) productsQuat[ i ] = multiplyReference( quats1[ i ], quats2[ i ] ); } ),
+			measure( count, repeatCount, [&]() { MathBatch::multiply( quats1.data(), quats2.data(), productsQuat.data(), count ); } ) );
+
+		const BoundingBox box( float3( -1.0f, -1.0f, -1.0f ), float3( 1.0f, 1.0f, 1.0f ) );
+		std::vector< BoundingBox > worldBoxes( count );
+
+		logBenchmark( "MathUtil::boundingBoxLocalToWorld (8 corners vs extents)",
+			measure( count, repeatCount, [&]() {
+				for ( int i = 0; i < count; ++i ) {
+					float3 worldMin( FLT_MAX, FLT_MAX, FLT_MAX ), worldMax( -FLT_MAX, -FLT_MAX, -FLT_MAX );
+					for ( int corner = 0; corner < 8; ++corner ) {
+						const float3 cornerPosition = transformReference( float3( corner & 1 ? 1.0f : -1.0f, corner & 2 ? 1.0f : -1.0f, corner & 4 ? 1.0f : -1.0f ), matrices1[ i ] );
+						worldMin = min( worldMin, cornerPosition );
+						worldMax = max( worldMax, cornerPosition );
+					}
+					worldBoxes[ i ] = BoundingBox( worldMin, worldMax );
+				}
+			} ),
+			measure( count, repeatCount, [&]() { for ( int i = 0; i < count; ++i ) worldBoxes[ i ] = MathUtil::boundingBoxLocalToWorld( box, matrices1[ i ] ); } ) );
+	}
+	};
+}
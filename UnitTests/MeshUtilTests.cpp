@@ -0,0 +1,188 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <vector>
+#include <string>
+#include <random>
+
+#include "MeshUtil.h"
+#include "MathUtil.h"
+#include "float43.h"
+#include "quat.h"
+#include "Timer.h"
+
+using namespace Engine1;
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTests
+{
+	TEST_CLASS( MeshUtilTests )
+	{
+	private:
+
+	struct Vertices
+	{
+		std::vector< float3 > vertices;
+		std::vector< float3 > normals;
+		std::vector< float3 > tangents;
+		std::vector< float3 > bitangents;
+	};
+
+	// Random surface frames - normal, tangent and bitangent are orthonormal with bitangent = cross( tangent, normal ) as in the shaders.
+	static Vertices createVertices( std::mt19937& random, const int count )
+	{
+		std::uniform_real_distribution< float > distribution( -1.0f, 1.0f );
+
+		Vertices result;
+		for ( int i = 0; i < count; ++i ) {
+			quat orientation( distribution( random ), distribution( random ), distribution( random ), distribution( random ) );
+			orientation.normalize();
+
+			const float43 frame( orientation );
+
+			result.vertices.push_back( float3( distribution( random ), distribution( random ), distribution( random ) ) * 10.0f );
+			result.tangents.push_back( frame.getRow1() );
+			result.normals.push_back( frame.getRow3() );
+			result.bitangents.push_back( cross( frame.getRow1(), frame.getRow3() ) );
+		}
+
+		return result;
+	}
+
+	static float43 createTransform( const float3& scale )
+	{
+		quat orientation( 0.3f, -0.5f, 0.2f, 0.7f );
+		orientation.normalize();
+
+		float43 transform( orientation );
+		transform.setRow1( transform.getRow1() * scale.x );
+		transform.setRow2( transform.getRow2() * scale.y );
+		transform.setRow3( transform.getRow3() * scale.z );
+		transform.setTranslation( float3( 4.0f, -2.0f, 7.0f ) );
+
+		return transform;
+	}
+
+	static float3 normalized( float3 vector )
+	{
+		vector.normalize();
+		return vector;
+	}
+
+	static void checkTransformedVertices( const Vertices& input, const Vertices& result, const float43& transform, const bool isMirroring )
+	{
+		const float3 translation = transform.getTranslation();
+
+		for ( int i = 0; i < (int)input.vertices.size(); ++i ) {
+			Assert::IsTrue( MathUtil::areEqual( input.vertices[ i ] * transform, result.vertices[ i ], 0.0001f, 0.0001f ) );
+
+			Assert::IsTrue( MathUtil::areEqual( 1.0f, result.normals[ i ].length(), 0.0001f ) );
+			Assert::IsTrue( MathUtil::areEqual( 1.0f, result.tangents[ i ].length(), 0.0001f ) );
+
+			// Normal has to stay perpendicular to the transformed surface (spanned by the transformed tangent and bitangent).
+			const float3 surfaceTangent   = normalized( input.tangents[ i ] * transform - translation );
+			const float3 surfaceBitangent = normalized( input.bitangents[ i ] * transform - translation );
+			Assert::IsTrue( MathUtil::areEqual( 0.0f, dot( result.normals[ i ], surfaceTangent ), 0.0f, 0.0001f ) );
+			Assert::IsTrue( MathUtil::areEqual( 0.0f, dot( result.normals[ i ], surfaceBitangent ), 0.0f, 0.0001f ) );
+
+			// Normal keeps facing the same side of the surface.
+			const float3 surfaceNormal = normalized( input.normals[ i ] * transform - translation );
+			Assert::IsTrue( dot( result.normals[ i ], surfaceNormal ) > 0.0f );
+
+			// Tangent follows the surface, negated for mirroring transforms so the reconstructed bitangent keeps its direction.
+			Assert::IsTrue( MathUtil::areEqual( isMirroring ? -surfaceTangent : surfaceTangent, result.tangents[ i ], 0.0001f, 0.0001f ) );
+			Assert::IsTrue( dot( cross( result.tangents[ i ], result.normals[ i ] ), surfaceBitangent ) > 0.0f );
+		}
+	}
+
+	public:
+
+	TEST_METHOD( MeshUtil_transformVertices_Non_Uniform_Scale )
+	{
+		std::mt19937 random( 3 );
+
+		const Vertices input     = createVertices( random, 4099 ); // More than one job and not divisible by the SIMD width.
+		const float43  transform = createTransform( float3( 3.0f, 0.5f, 1.5f ) );
+
+		Vertices result = input;
+		MeshUtil::transformVertices(
+			input.vertices.data(), input.normals.data(), input.tangents.data(), (int)input.vertices.size(), transform,
+			result.vertices.data(), result.normals.data(), result.tangents.data()
+		);
+
+		checkTransformedVertices( input, result, transform, false );
+	}
+
+	TEST_METHOD( MeshUtil_transformVertices_Mirroring_In_Place )
+	{
+		std::mt19937 random( 5 );
+
+		const Vertices input     = createVertices( random, 37 );
+		const float43  transform = createTransform( float3( -2.0f, 1.0f, 1.0f ) );
+
+		Vertices result = input;
+		MeshUtil::transformVertices(
+			result.vertices.data(), result.normals.data(), result.tangents.data(), (int)result.vertices.size(), transform,
+			result.vertices.data(), result.normals.data(), result.tangents.data()
+		);
+
+		checkTransformedVertices( input, result, transform, true );
+
+		// Vertices only.
+		std::vector< float3 > vertices = input.vertices;
+		MeshUtil::transformVertices( vertices.data(), nullptr, nullptr, (int)vertices.size(), transform, vertices.data(), nullptr, nullptr );
+
+		for ( int i = 0; i < (int)vertices.size(); ++i )
+			Assert::IsTrue( MathUtil::areEqual( result.vertices[ i ], vertices[ i ], 0.0001f, 0.0001f ) );
+	}
+
+	TEST_METHOD( MeshUtil_transformVertices_Benchmark )
+	{
+		const int count = 1000000, repeatCount = 10;
+
+		std::mt19937 random( 7 );
+
+		const Vertices input     = createVertices( random, count );
+		const float43  transform = createTransform( float3( 3.0f, 0.5f, 1.5f ) );
+		Vertices       result    = input;
+
+		// Per-vertex loop, as done before the batched version.
+		const float33 orientation = transform.getOrientation();
+		auto transformScalar = [&]() {
+			for ( int i = 0; i < count; ++i ) {
+				result.vertices[ i ] = input.vertices[ i ] * transform;
+				result.normals[ i ]  = normalized( input.normals[ i ] * orientation );
+				result.tangents[ i ] = normalized( input.tangents[ i ] * orientation );
+			}
+		};
+
+		auto transformBatched = [&]() {
+			MeshUtil::transformVertices(
+				input.vertices.data(), input.normals.data(), input.tangents.data(), count, transform,
+				result.vertices.data(), result.normals.data(), result.tangents.data()
+			);
+		};
+
+		transformScalar(); // Warm up.
+		const Timer scalarStartTime;
+		for ( int i = 0; i < repeatCount; ++i )
+			transformScalar();
+		const Timer scalarEndTime;
+
+		transformBatched(); // Warm up.
+		const Timer batchedStartTime;
+		for ( int i = 0; i < repeatCount; ++i )
+			transformBatched();
+		const Timer batchedEndTime;
+
+		// Elapsed time is in milliseconds.
+		const double scalarVerticesPerSecond  = (double)count * repeatCount * 1000.0 / Timer::getElapsedTime( scalarEndTime, scalarStartTime );
+		const double batchedVerticesPerSecond = (double)count * repeatCount * 1000.0 / Timer::getElapsedTime( batchedEndTime, batchedStartTime );
+
+		Logger::WriteMessage( (
+			"MeshUtil::transformVertices: per-vertex " + std::to_string( scalarVerticesPerSecond / 1000000.0 ) + " M vertices/s, batched "
+			+ std::to_string( batchedVerticesPerSecond / 1000000.0 ) + " M vertices/s (x" + std::to_string( batchedVerticesPerSecond / scalarVerticesPerSecond ) + ")\n"
+		).c_str() );
+	}
+	};
+}
@@ -0,0 +1,234 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <functional>
+#include <cstdlib>
+
+#include "MipmapGenerator.h"
+#include "uchar4.h"
+#include "float4.h"
+#include "Timer.h"
+
+using namespace Engine1;
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTests
+{
+	TEST_CLASS( MipmapGeneratorTests )
+	{
+	private:
+
+	// The loop previously used by Texture2D::createMipmapsOnCpu - reference for correctness and speed.
+	template< typename PixelType, typename AverageFunction >
+	static void downsampleReference( const std::vector< PixelType >& src, const int srcWidth, const int srcHeight, std::vector< PixelType >& dst, AverageFunction average )
+	{
+		const int dstWidth  = std::max( 1, srcWidth / 2 );
+		const int dstHeight = std::max( 1, srcHeight / 2 );
+
+		dst.resize( dstWidth * dstHeight );
+
+		for ( int y = 0; y < dstHeight; ++y ) {
+			for ( int x = 0; x < dstWidth; ++x ) {
+				const int topRowY      = 2 * y;
+				const int bottomRowY   = std::min( srcHeight - 1, 2 * y + 1 );
+				const int leftColumnX  = 2 * x;
+				const int rightColumnX = std::min( srcWidth - 1, 2 * x + 1 );
+
+				dst[ y * dstWidth + x ] = average(
+					src[ topRowY * srcWidth + leftColumnX ],
+					src[ topRowY * srcWidth + rightColumnX ],
+					src[ bottomRowY * srcWidth + leftColumnX ],
+					src[ bottomRowY * srcWidth + rightColumnX ]
+				);
+			}
+		}
+	}
+
+	static uchar4 averageUchar4( uchar4 val1, uchar4 val2, uchar4 val3, uchar4 val4 )
+	{
+		return uchar4(
+			(unsigned char)( ( (int)val1.x + (int)val2.x + (int)val3.x + (int)val4.x ) / 4 ),
+			(unsigned char)( ( (int)val1.y + (int)val2.y + (int)val3.y + (int)val4.y ) / 4 ),
+			(unsigned char)( ( (int)val1.z + (int)val2.z + (int)val3.z + (int)val4.z ) / 4 ),
+			(unsigned char)( ( (int)val1.w + (int)val2.w + (int)val3.w + (int)val4.w ) / 4 )
+		);
+	}
+
+	static unsigned char averageUchar( unsigned char val1, unsigned char val2, unsigned char val3, unsigned char val4 )
+	{
+		return (unsigned char)( ( (int)val1 + (int)val2 + (int)val3 + (int)val4 ) / 4 );
+	}
+
+	static float averageFloat( float val1, float val2, float val3, float val4 )
+	{
+		return ( val1 + val2 + val3 + val4 ) / 4.0f;
+	}
+
+	static float4 averageFloat4( float4 val1, float4 val2, float4 val3, float4 val4 )
+	{
+		return ( val1 + val2 + val3 + val4 ) / 4.0f;
+	}
+
+	// Dimensions covering SIMD tails, odd sizes and single row/column textures.
+	static std::vector< std::pair< int, int > > getTestDimensions()
+	{
+		return { { 37, 19 }, { 256, 256 }, { 1, 7 }, { 7, 1 }, { 33, 2 }, { 1024, 512 } };
+	}
+
+	public:
+
+	TEST_METHOD( MipmapGenerator_Box_Matches_Reference_uchar4 )
+	{
+		for ( const auto& dimensions : getTestDimensions() ) {
+			const int width = dimensions.first, height = dimensions.second;
+
+			std::vector< uchar4 > src( width * height );
+			for ( int i = 0; i < width * height; ++i )
+				src[ i ] = uchar4( (unsigned char)( i * 7 ), (unsigned char)( i * 13 + 5 ), (unsigned char)( i * 31 ), (unsigned char)( 255 - i ) );
+
+			std::vector< uchar4 > expected;
+			downsampleReference( src, width, height, expected, averageUchar4 );
+
+			std::vector< uchar4 > result( expected.size() );
+			MipmapGenerator::downsample( src.data(), width, height, result.data(), std::max( 1, width / 2 ), std::max( 1, height / 2 ) );
+
+			for ( size_t i = 0; i < expected.size(); ++i )
+				Assert::IsTrue( expected[ i ] == result[ i ] );
+		}
+	}
+
+	TEST_METHOD( MipmapGenerator_Box_Matches_Reference_uchar )
+	{
+		for ( const auto& dimensions : getTestDimensions() ) {
+			const int width = dimensions.first, height = dimensions.second;
+
+			std::vector< unsigned char > src( width * height );
+			for ( int i = 0; i < width * height; ++i )
+				src[ i ] = (unsigned char)( i * 37 + i / 3 );
+
+			std::vector< unsigned char > expected;
+			downsampleReference( src, width, height, expected, averageUchar );
+
+			std::vector< unsigned char > result( expected.size() );
+			MipmapGenerator::downsample( src.data(), width, height, result.data(), std::max( 1, width / 2 ), std::max( 1, height / 2 ) );
+
+			Assert::IsTrue( expected == result );
+		}
+	}
+
+	TEST_METHOD( MipmapGenerator_Box_Matches_Reference_float_float4 )
+	{
+		for ( const auto& dimensions : getTestDimensions() ) {
+			const int width = dimensions.first, height = dimensions.second;
+
+			std::vector< float >  src( width * height );
+			std::vector< float4 > src4( width * height );
+			for ( int i = 0; i < width * height; ++i ) {
+				src[ i ]  = (float)( ( i * 7919 ) % 1000 ) * 0.001f;
+				src4[ i ] = float4( src[ i ], 1.0f - src[ i ], src[ i ] * 3.0f, 0.5f );
+			}
+
+			std::vector< float > expected;
+			downsampleReference( src, width, height, expected, averageFloat );
+
+			std::vector< float > result( expected.size() );
+			MipmapGenerator::downsample( src.data(), width, height, result.data(), std::max( 1, width / 2 ), std::max( 1, height / 2 ) );
+
+			Assert::IsTrue( expected == result );
+
+			std::vector< float4 > expected4;
+			downsampleReference( src4, width, height, expected4, averageFloat4 );
+
+			std::vector< float4 > result4( expected4.size() );
+			MipmapGenerator::downsample( src4.data(), width, height, result4.data(), std::max( 1, width / 2 ), std::max( 1, height / 2 ) );
+
+			for ( size_t i = 0; i < expected4.size(); ++i )
+				Assert::IsTrue( expected4[ i ] == result4[ i ] );
+		}
+	}
+
+	TEST_METHOD( MipmapGenerator_Srgb_And_Kaiser_Preserve_Constant_Color )
+	{
+		const int width = 64, height = 48;
+
+		const std::vector< uchar4 > src( width * height, uchar4( 200, 100, 10, 77 ) );
+		std::vector< uchar4 >       result( ( width / 2 ) * ( height / 2 ) );
+
+		const MipmapGenerator::Options optionsList[] = {
+			MipmapGenerator::Options( MipmapGenerator::Filter::Box, true ),
+			MipmapGenerator::Options( MipmapGenerator::Filter::Kaiser, false ),
+			MipmapGenerator::Options( MipmapGenerator::Filter::Kaiser, true )
+		};
+
+		for ( const MipmapGenerator::Options& options : optionsList ) {
+			MipmapGenerator::downsample( src.data(), width, height, result.data(), width / 2, height / 2, options );
+
+			for ( const uchar4& pixel : result )
+				Assert::IsTrue( pixel == src.front() );
+		}
+	}
+
+	TEST_METHOD( MipmapGenerator_Srgb_Averages_In_Linear_Space )
+	{
+		// Black and white checkerboard - linear average is 0.5, which is ~188 in sRGB (gamma-space average would give 127).
+		std::vector< uchar4 > src( 2 * 2 );
+		src[ 0 ] = src[ 3 ] = uchar4( 0, 0, 0, 0 );
+		src[ 1 ] = src[ 2 ] = uchar4( 255, 255, 255, 255 );
+
+		uchar4 result;
+		MipmapGenerator::downsample( src.data(), 2, 2, &result, 1, 1, MipmapGenerator::Options( MipmapGenerator::Filter::Box, true ) );
+
+		Assert::IsTrue( std::abs( 188 - (int)result.x ) <= 1 );
+		Assert::AreEqual( 127, (int)result.w ); // Alpha is averaged linearly.
+	}
+
+	TEST_METHOD( MipmapGenerator_Wrong_Dimensions )
+	{
+		std::vector< float > src( 16 ), dst( 4 );
+
+		try {
+			MipmapGenerator::downsample( src.data(), 4, 4, dst.data(), 4, 1 );
+		} catch ( ... ) {
+			return;
+		}
+
+		Assert::Fail( L"MipmapGenerator::downsample didn't throw an exception for wrong destination dimensions" );
+	}
+
+	TEST_METHOD( MipmapGenerator_Benchmark_Megapixels_Per_Second )
+	{
+		const int width = 4096, height = 4096, iterationCount = 5;
+
+		std::vector< uchar4 > src( width * height );
+		for ( int i = 0; i < width * height; ++i )
+			src[ i ] = uchar4( (unsigned char)i, (unsigned char)( i >> 3 ), (unsigned char)( i >> 7 ), 255 );
+
+		std::vector< uchar4 > dst( ( width / 2 ) * ( height / 2 ) );
+
+		auto measureMegapixelsPerSecond = [ & ]( const std::function< void() >& downsample ) {
+			const Timer startTime;
+			for ( int i = 0; i < iterationCount; ++i )
+				downsample();
+			const Timer endTime;
+
+			const double seconds = Timer::getElapsedTime( endTime, startTime ) / 1000.0;
+			return ( (double)width * height * iterationCount / 1000000.0 ) / seconds;
+		};
+
+		const double referenceSpeed = measureMegapixelsPerSecond( [ & ]() { downsampleReference( src, width, height, dst, averageUchar4 ); } );
+		const double boxSpeed       = measureMegapixelsPerSecond( [ & ]() { MipmapGenerator::downsample( src.data(), width, height, dst.data(), width / 2, height / 2 ); } );
+		const double srgbSpeed      = measureMegapixelsPerSecond( [ & ]() { MipmapGenerator::downsample( src.data(), width, height, dst.data(), width / 2, height / 2, MipmapGenerator::Options( MipmapGenerator::Filter::Box, true ) ); } );
+		const double kaiserSpeed    = measureMegapixelsPerSecond( [ & ]() { MipmapGenerator::downsample( src.data(), width, height, dst.data(), width / 2, height / 2, MipmapGenerator::Options( MipmapGenerator::Filter::Kaiser, false ) ); } );
+
+		Logger::WriteMessage( (
+			"Mipmap generation (uchar4, source megapixels per second): reference loop " + std::to_string( referenceSpeed )
+			+ ", box " + std::to_string( boxSpeed )
+			+ ", box sRGB " + std::to_string( srgbSpeed )
+			+ ", Kaiser " + std::to_string( kaiserSpeed ) + "\n"
+		).c_str() );
+	}
+	};
+}
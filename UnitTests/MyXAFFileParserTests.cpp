@@ -0,0 +1,241 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cmath>
+
+#include "MyXAFFileParser.h"
+#include "XmlStreamReader.h"
+#include "SkeletonAnimation.h"
+#include "SkeletonMesh.h"
+#include "MathUtil.h"
+#include "Timer.h"
+
+using namespace Engine1;
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTests
+{
+	TEST_CLASS( MyXAFFileParserTests )
+	{
+	private:
+
+	static std::string getBoneName( const int boneIndex )
+	{
+		return "Bip01 Bone" + std::to_string( boneIndex );
+	}
+
+	static void createSkeletonMesh( SkeletonMesh& mesh, const int boneCount )
+	{
+		for ( int boneIndex = 1; boneIndex <= boneCount; ++boneIndex )
+			mesh.addOrModifyBone( (unsigned char)boneIndex, getBoneName( boneIndex ), (unsigned char)( boneIndex - 1 ), float43::IDENTITY );
+	}
+
+	// Bone rotates around the Y axis and moves along the Z axis.
+	static float43 createBonePose( const int boneIndex, const int keyframe )
+	{
+		const float angle = 0.01f * keyframe + 0.1f * boneIndex;
+
+		return float43(
+			std::cos( angle ), 0.0f, -std::sin( angle ),
+			0.0f, 1.0f, 0.0f,
+			std::sin( angle ), 0.0f, std::cos( angle ),
+			0.5f * boneIndex, 1.0f, 0.25f * keyframe
+		);
+	}
+
+	// XAF file in the format exported by 3ds Max.
+	static std::string createXAFFile( const int boneCount, const int keyframeCount )
+	{
+		const int ticksPerFrame = 160;
+
+		std::string file;
+		file.reserve( (size_t)boneCount * keyframeCount * 160 );
+
+		file += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+		file += "<MaxAnimation version=\"1.00\" date=\"Mon Jan 01 00:00:00 2018\">\n";
+		file += "  <!-- <Node name=\"Commented out\"> -->\n";
+		file += "  <SceneInfo fileName=\"test.max\" startTick=\"0\" endTick=\"" + std::to_string( ( keyframeCount - 1 ) * ticksPerFrame )
+			+ "\" frameRate=\"30\" ticksPerFrame=\"" + std::to_string( ticksPerFrame ) + "\" />\n";
+
+		for ( int boneIndex = 1; boneIndex <= boneCount; ++boneIndex ) {
+			file += "  <Node name=\"" + getBoneName( boneIndex ) + "\" parentNode=\"Scene Root\" parentNodeType=\"Bone\">\n";
+			file += "    <Samples count=\"" + std::to_string( keyframeCount ) + "\">\n";
+
+			for ( int keyframe = 0; keyframe < keyframeCount; ++keyframe ) {
+				const float43 pose = createBonePose( boneIndex, keyframe );
+				const float   values[ 12 ] = { pose.m11, pose.m12, pose.m13, pose.m21, pose.m22, pose.m23, pose.m31, pose.m32, pose.m33, pose.t1, pose.t2, pose.t3 };
+
+				file += "      <S t=\"" + std::to_string( keyframe * ticksPerFrame ) + "\" v=\"";
+				for ( int i = 0; i < 12; ++i )
+					file += std::to_string( values[ i ] ) + ( i < 11 ? " " : "" );
+				file += "\"/>\n";
+			}
+
+			file += "    </Samples>\n  </Node>\n";
+		}
+
+		file += "</MaxAnimation>\n";
+
+		return file;
+	}
+
+	static void assertPosesAreEqual( SkeletonAnimation& animation, const int boneCount, const int keyframeCount )
+	{
+		Assert::AreEqual( keyframeCount, (int)animation.getKeyframeCount() );
+
+		for ( int keyframe = 0; keyframe < keyframeCount; ++keyframe ) {
+			for ( int boneIndex = 1; boneIndex <= boneCount; ++boneIndex ) {
+				const float43 expectedPose = createBonePose( boneIndex, keyframe );
+				const float43 pose         = animation.getPose( keyframe ).getBonePose( (unsigned char)boneIndex );
+
+				Assert::IsTrue( MathUtil::areEqual( float3( 1.0f, 2.0f, 3.0f ) * expectedPose, float3( 1.0f, 2.0f, 3.0f ) * pose, 0.0f, 0.0001f ) );
+			}
+		}
+	}
+
+	public:
+
+	TEST_METHOD( MyXAFFileParser_Parse_From_Memory_And_Stream )
+	{
+		const int boneCount = 3, keyframeCount = 20;
+
+		SkeletonMesh mesh;
+		createSkeletonMesh( mesh, boneCount );
+
+		const std::string       text = createXAFFile( boneCount, keyframeCount );
+		const std::vector<char> file( text.begin(), text.end() );
+
+		std::shared_ptr<SkeletonAnimation> animation = SkeletonAnimation::createFromMemory( file, SkeletonAnimationFileInfo::Format::XAF, mesh );
+		assertPosesAreEqual( *animation, boneCount, keyframeCount );
+
+		SkeletonAnimation streamedAnimation;
+		std::istringstream stream( text );
+		MyXAFFileParser::parseSkeletonAnimationFile( stream, mesh, streamedAnimation, false );
+		assertPosesAreEqual( streamedAnimation, boneCount, keyframeCount );
+
+		// Z axis is inverted in the translation as well.
+		SkeletonAnimation invertedAnimation;
+		MyXAFFileParser::parseSkeletonAnimationFile( file, mesh, invertedAnimation, true );
+		Assert::AreEqual( -0.25f * 5, invertedAnimation.getPose( 5 ).getTranslations()[ 0 ].z, 0.0001f );
+	}
+
+	TEST_METHOD( MyXAFFileParser_Missing_Scene_Info )
+	{
+		SkeletonMesh mesh;
+		createSkeletonMesh( mesh, 1 );
+
+		const std::string       text = "<MaxAnimation><Node name=\"Bip01 Bone1\"><Samples><S t=\"0\" v=\"1 0 0 0 1 0 0 0 1 0 0 0\"/></Samples></Node></MaxAnimation>";
+		const std::vector<char> file( text.begin(), text.end() );
+
+		SkeletonAnimation animation;
+		try {
+			MyXAFFileParser::parseSkeletonAnimationFile( file, mesh, animation, false );
+		} catch ( ... ) {
+			return;
+		}
+
+		Assert::Fail( L"MyXAFFileParser::parseSkeletonAnimationFile didn't throw an exception for a file without \"SceneInfo\"" );
+	}
+
+	TEST_METHOD( XmlStreamReader_Small_Chunks_Match_Memory )
+	{
+		const std::string text =
+			"<?xml version=\"1.0\"?>\n<!DOCTYPE root [ <!ENTITY e \"x\"> ]>\n"
+			"<root a=\"1 > 0\" b='&lt;&amp;&#65;&#x42;'>text<!-- <fake/> --><![CDATA[ <fake/> ]]>"
+			"<child name=\"first\"/><child\n name = \"second\" ></child></root>";
+
+		XmlStreamReader memoryReader( text.data(), text.size() );
+
+		std::istringstream stream( text );
+		XmlStreamReader    streamReader( stream, 16 );
+
+		int elementCount = 0;
+		while ( true ) {
+			const XmlStreamReader::Event event = memoryReader.next();
+			Assert::IsTrue( event == streamReader.next() );
+
+			if ( event == XmlStreamReader::Event::EndOfDocument )
+				break;
+
+			Assert::AreEqual( memoryReader.getName().toString(), streamReader.getName().toString() );
+
+			if ( event == XmlStreamReader::Event::StartElement ) {
+				++elementCount;
+
+				XmlStreamReader::Text value;
+				if ( memoryReader.getName().equals( "root" ) ) {
+					Assert::IsTrue( streamReader.findAttribute( "a", value ) );
+					Assert::AreEqual( std::string( "1 > 0" ), value.toString() );
+					Assert::IsTrue( streamReader.findAttribute( "b", value ) );
+					Assert::AreEqual( std::string( "<&AB" ), value.toString() );
+				} else {
+					Assert::IsTrue( streamReader.findAttribute( "name", value ) );
+					Assert::AreEqual( std::string( elementCount == 2 ? "first" : "second" ), value.toString() );
+				}
+			}
+		}
+
+		Assert::AreEqual( 3, elementCount );
+	}
+
+	TEST_METHOD( XmlStreamReader_Data_Ending_At_Chunk_Boundary )
+	{
+		// Two chunks of 16 characters - the last markup is too short to be recognized before the data end is known.
+		const std::string text = "<root><child/><child/>xyz</root>";
+		Assert::AreEqual( (size_t)0, text.size() % 16 );
+
+		std::istringstream stream( text );
+		XmlStreamReader    reader( stream, 16 );
+
+		int elementCount = 0, endElementCount = 0;
+		XmlStreamReader::Event event;
+		while ( ( event = reader.next() ) != XmlStreamReader::Event::EndOfDocument ) {
+			elementCount    += event == XmlStreamReader::Event::StartElement ? 1 : 0;
+			endElementCount += event == XmlStreamReader::Event::EndElement ? 1 : 0;
+		}
+
+		Assert::AreEqual( 3, elementCount );
+		Assert::AreEqual( 3, endElementCount );
+
+		// Data which really ends inside of a markup.
+		std::istringstream truncatedStream( text.substr( 0, 30 ) );
+		XmlStreamReader    truncatedReader( truncatedStream, 15 );
+
+		Assert::ExpectException< std::exception >( [ &truncatedReader ]() { while ( truncatedReader.next() != XmlStreamReader::Event::EndOfDocument ); } );
+	}
+
+	TEST_METHOD( MyXAFFileParser_Benchmark_Large_File )
+	{
+		const int boneCount = 60, keyframeCount = 3000;
+
+		SkeletonMesh mesh;
+		createSkeletonMesh( mesh, boneCount );
+
+		const std::string       text = createXAFFile( boneCount, keyframeCount );
+		const std::vector<char> file( text.begin(), text.end() );
+
+		const Timer startTime;
+		std::shared_ptr<SkeletonAnimation> animation = SkeletonAnimation::createFromMemory( file, SkeletonAnimationFileInfo::Format::XAF, mesh );
+		const Timer endTime;
+
+		SkeletonAnimation  streamedAnimation;
+		std::istringstream stream( text );
+		MyXAFFileParser::parseSkeletonAnimationFile( stream, mesh, streamedAnimation, false );
+		const Timer streamEndTime;
+
+		const double megabytes = (double)file.size() / ( 1024.0 * 1024.0 );
+
+		Logger::WriteMessage( (
+			"XAF import (" + std::to_string( megabytes ) + " MB, " + std::to_string( boneCount ) + " bones, " + std::to_string( keyframeCount ) + " keyframes): "
+			+ std::to_string( megabytes / ( Timer::getElapsedTime( endTime, startTime ) / 1000.0 ) ) + " MB/s from memory, "
+			+ std::to_string( megabytes / ( Timer::getElapsedTime( streamEndTime, endTime ) / 1000.0 ) ) + " MB/s from stream\n"
+		).c_str() );
+
+		Assert::AreEqual( keyframeCount, (int)animation->getKeyframeCount() );
+		Assert::AreEqual( keyframeCount, (int)streamedAnimation.getKeyframeCount() );
+	}
+	};
+}
@@ -0,0 +1,275 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <algorithm>
+#include <string>
+
+#include "RayTreePruning.h"
+
+using namespace Engine1;
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTests
+{
+	TEST_CLASS( RayTreePruningTests )
+	{
+	private:
+
+	static std::vector< uchar4 > createImage( const int2 dimensions, const uchar4& value )
+	{
+		return std::vector< uchar4 >( dimensions.x * dimensions.y, value );
+	}
+
+	// Reduces the image by averaging 2x2 blocks, as mipmap generation on the GPU does.
+	static std::vector< uchar4 > downsample( const std::vector< uchar4 >& image, int2& dimensions, const int mipmapLevel )
+	{
+		std::vector< uchar4 > result = image;
+
+		for ( int level = 0; level < mipmapLevel; ++level )
+		{
+			const int2 reducedDimensions( std::max( 1, dimensions.x / 2 ), std::max( 1, dimensions.y / 2 ) );
+			std::vector< uchar4 > reduced( reducedDimensions.x * reducedDimensions.y );
+
+			for ( int y = 0; y < reducedDimensions.y; ++y ) {
+				for ( int x = 0; x < reducedDimensions.x; ++x )
+				{
+					int sum[ 4 ] = { 0, 0, 0, 0 };
+					for ( int sampleIdx = 0; sampleIdx < 4; ++sampleIdx )
+					{
+						const int sampleX = std::min( dimensions.x - 1, x * 2 + sampleIdx % 2 );
+						const int sampleY = std::min( dimensions.y - 1, y * 2 + sampleIdx / 2 );
+						const uchar4& sample = result[ sampleY * dimensions.x + sampleX ];
+
+						sum[ 0 ] += sample.x; sum[ 1 ] += sample.y; sum[ 2 ] += sample.z; sum[ 3 ] += sample.w;
+					}
+
+					reduced[ y * reducedDimensions.x + x ] = uchar4( ( sum[ 0 ] + 2 ) / 4, ( sum[ 1 ] + 2 ) / 4, ( sum[ 2 ] + 2 ) / 4, ( sum[ 3 ] + 2 ) / 4 );
+				}
+			}
+
+			result     = reduced;
+			dimensions = reducedDimensions;
+		}
+
+		return result;
+	}
+
+	// Contribution image of a stage in a test scene - a mirror (strong reflections, no transmission), a glass pane (weak reflections, strong transmission)
+	// and diffuse walls (weak reflections, no transmission). Rays of each level hit a slightly shifted part of the scene - mirror reflections see mostly the mirror again.
+	static std::vector< uchar4 > createStageImage( const RenderingStage stage, const int2 dimensions )
+	{
+		const bool reflection = getLastRenderingStageType( stage ) == RenderingStageType::Reflection;
+		const int  level      = getRenderingStageLevel( stage );
+
+		std::vector< uchar4 > image( dimensions.x * dimensions.y );
+		for ( int y = 0; y < dimensions.y; ++y ) {
+			for ( int x = 0; x < dimensions.x; ++x )
+			{
+				// Material of the surface which rays of this stage leave.
+				const int column = ( x + ( level - 1 ) * dimensions.x / 32 ) % dimensions.x;
+
+				unsigned char term;
+				if ( column < dimensions.x / 10 )       // Mirror.
+					term = reflection ? 230 : 0;
+				else if ( column < dimensions.x / 4 )   // Glass.
+					term = reflection ? 10 : 240;
+				else                                     // Wall.
+					term = reflection ? 10 : 0;
+
+				image[ y * dimensions.x + x ] = uchar4( term, term, term, 128 );
+			}
+		}
+
+		return image;
+	}
+
+	// Updates the stage and its descendants up to the given level, skipping the pruned ones as Renderer does. Returns the rendered stage count.
+	static int renderStages( RayTreePruning& pruning, const RenderingStage stage, const int maxLevel, const float threshold, const int2 dimensions )
+	{
+		if ( getRenderingStageLevel( stage ) > maxLevel )
+			return 0;
+
+		pruning.update( stage, createStageImage( stage, dimensions ), dimensions );
+
+		if ( !pruning.isStageVisible( stage, threshold ) )
+			return 0;
+
+		return 1
+			+ renderStages( pruning, getNextRenderingStage( stage, RenderingStageType::Reflection ), maxLevel, threshold, dimensions )
+			+ renderStages( pruning, getNextRenderingStage( stage, RenderingStageType::Transmission ), maxLevel, threshold, dimensions );
+	}
+
+	public:
+
+	TEST_METHOD( RayTreePruning_Accumulation )
+	{
+		RayTreePruning pruning;
+
+		const int2 dimensions( 4, 2 );
+
+		// Contribution is the largest color component - roughness (alpha) is ignored.
+		pruning.update( RenderingStage::R, createImage( dimensions, uchar4( 51, 102, 0, 255 ) ), dimensions );
+		Assert::AreEqual( 0.4f, pruning.getContribution( RenderingStage::R ), 0.001f );
+
+		// Multiplied by the contribution of the previous stage in each pixel.
+		std::vector< uchar4 > image = createImage( dimensions, uchar4( 255, 255, 255, 0 ) );
+		image[ 0 ] = uchar4( 0, 0, 0, 0 );
+		pruning.update( RenderingStage::RT, image, dimensions );
+
+		Assert::AreEqual( 0.4f * 7.0f / 8.0f, pruning.getContribution( RenderingStage::RT ), 0.001f );
+		Assert::AreEqual( 0.0f, pruning.getTotalContribution( RenderingStage::RT )[ 0 ] );
+		Assert::AreEqual( 0.4f, pruning.getTotalContribution( RenderingStage::RT )[ 1 ], 0.001f );
+
+		pruning.update( RenderingStage::RTR, createImage( dimensions, uchar4( 0, 0, 128, 0 ) ), dimensions );
+		Assert::AreEqual( 0.4f * 7.0f / 8.0f * 128.0f / 255.0f, pruning.getContribution( RenderingStage::RTR ), 0.001f );
+
+		// Previous stage without an estimate or of different dimensions - no reduction.
+		pruning.update( RenderingStage::TR, createImage( dimensions, uchar4( 0, 128, 0, 0 ) ), dimensions );
+		Assert::AreEqual( 128.0f / 255.0f, pruning.getContribution( RenderingStage::TR ), 0.001f );
+
+		const int2 otherDimensions( 2, 2 );
+		pruning.update( RenderingStage::RR, createImage( otherDimensions, uchar4( 255, 0, 0, 0 ) ), otherDimensions );
+		Assert::AreEqual( 1.0f, pruning.getContribution( RenderingStage::RR ), 0.001f );
+
+		pruning.clear();
+		Assert::IsFalse( pruning.hasEstimate( RenderingStage::R ) );
+		Assert::IsTrue( pruning.getTotalContribution( RenderingStage::R ).empty() );
+	}
+
+	TEST_METHOD( RayTreePruning_Decision )
+	{
+		RayTreePruning pruning;
+
+		const int2 dimensions( 8, 8 );
+
+		// Stages without an estimate are always rendered.
+		Assert::IsTrue( pruning.isStageVisible( RenderingStage::R, 0.5f ) );
+		Assert::AreEqual( 1.0f, pruning.getContribution( RenderingStage::R ) );
+
+		// A single half-bright pixel on an otherwise black image - 1/64 of the screen.
+		std::vector< uchar4 > image = createImage( dimensions, uchar4( 0, 0, 0, 0 ) );
+		image[ 10 ] = uchar4( 128, 128, 128, 255 );
+		pruning.update( RenderingStage::R, image, dimensions );
+
+		// Decision doesn't depend on how much of the screen the stage covers - only on its largest contribution to a pixel.
+		Assert::IsTrue( pruning.hasEstimate( RenderingStage::R ) );
+		Assert::AreEqual( 128.0f / 255.0f / 64.0f, pruning.getContribution( RenderingStage::R ), 0.0001f );
+		Assert::AreEqual( 128.0f / 255.0f, pruning.getMaxContribution( RenderingStage::R ), 0.0001f );
+		Assert::IsTrue( pruning.isStageVisible( RenderingStage::R, 0.4f ) );
+		Assert::IsFalse( pruning.isStageVisible( RenderingStage::R, 0.6f ) );
+
+		// Fully contributing child is limited by the contribution of the pixel.
+		pruning.update( RenderingStage::RR, createImage( dimensions, uchar4( 255, 255, 255, 255 ) ), dimensions );
+		Assert::IsTrue( pruning.isStageVisible( RenderingStage::RR, 0.4f ) );
+		Assert::IsFalse( pruning.isStageVisible( RenderingStage::RR, 0.6f ) );
+
+		// Zero threshold keeps every stage.
+		pruning.update( RenderingStage::T, createImage( dimensions, uchar4( 0, 0, 0, 0 ) ), dimensions );
+		Assert::IsTrue( pruning.isStageVisible( RenderingStage::T, 0.0f ) );
+		Assert::IsFalse( pruning.isStageVisible( RenderingStage::T, 0.001f ) );
+
+		// Stage with a removed estimate is rendered again.
+		pruning.remove( RenderingStage::T );
+		Assert::IsFalse( pruning.hasEstimate( RenderingStage::T ) );
+		Assert::IsTrue( pruning.isStageVisible( RenderingStage::T, 0.001f ) );
+		Assert::IsTrue( pruning.hasEstimate( RenderingStage::R ) );
+	}
+
+	TEST_METHOD( RayTreePruning_Debug_View_Subtree )
+	{
+		// Renderer never prunes the debug viewed stage and the stages leading to it.
+		Assert::IsTrue( isRenderingStageInSubtree( RenderingStage::RTR, RenderingStage::R ) );
+		Assert::IsTrue( isRenderingStageInSubtree( RenderingStage::RTR, RenderingStage::RT ) );
+		Assert::IsTrue( isRenderingStageInSubtree( RenderingStage::RTR, RenderingStage::RTR ) );
+		Assert::IsTrue( isRenderingStageInSubtree( RenderingStage::T, RenderingStage::Main ) );
+
+		Assert::IsFalse( isRenderingStageInSubtree( RenderingStage::RTR, RenderingStage::T ) );
+		Assert::IsFalse( isRenderingStageInSubtree( RenderingStage::RTR, RenderingStage::RR ) );
+		Assert::IsFalse( isRenderingStageInSubtree( RenderingStage::RT, RenderingStage::RTR ) );
+		Assert::IsFalse( isRenderingStageInSubtree( RenderingStage::Main, RenderingStage::R ) );
+	}
+
+	TEST_METHOD( RayTreePruning_Invalid_Input )
+	{
+		RayTreePruning pruning;
+
+		const int2 dimensions( 4, 4 );
+
+		Assert::ExpectException< std::exception >( [ &pruning, &dimensions ]() {
+			pruning.update( RenderingStage::R, createImage( int2( 4, 3 ), uchar4( 0, 0, 0, 0 ) ), dimensions );
+		} );
+
+		Assert::ExpectException< std::exception >( [ &pruning ]() {
+			pruning.update( RenderingStage::R, std::vector< uchar4 >(), int2( 0, 0 ) );
+		} );
+
+		Assert::ExpectException< std::exception >( [ &pruning, &dimensions ]() {
+			pruning.update( RenderingStage::Main, createImage( dimensions, uchar4( 0, 0, 0, 0 ) ), dimensions );
+		} );
+	}
+
+	TEST_METHOD( RayTreePruning_Reduced_Resolution )
+	{
+		const int2 fullDimensions( 256, 144 );
+
+		for ( const RenderingStage stage : { RenderingStage::R, RenderingStage::T } )
+		{
+			const std::vector< uchar4 > image = createStageImage( stage, fullDimensions );
+
+			RayTreePruning fullPruning;
+			fullPruning.update( stage, image, fullDimensions );
+
+			// Mipmap 4 - 16x9 pixels, as read back by Renderer.
+			int2 dimensions = fullDimensions;
+			const std::vector< uchar4 > reducedImage = downsample( image, dimensions, 4 );
+
+			RayTreePruning reducedPruning;
+			reducedPruning.update( stage, reducedImage, dimensions );
+
+			Assert::AreEqual( 16, dimensions.x );
+			Assert::AreEqual( 9, dimensions.y );
+			Assert::AreEqual( fullPruning.getContribution( stage ), reducedPruning.getContribution( stage ), 0.01f );
+		}
+	}
+
+	TEST_METHOD( RayTreePruning_Pruned_Stages )
+	{
+		const int2 dimensions( 64, 36 );
+		const int  maxLevel = 4;
+
+		// Every stage up to the max level.
+		const int stageCount = ( 1 << ( maxLevel + 1 ) ) - 2;
+
+		int prevRenderedStageCount = stageCount;
+		for ( const float threshold : { 0.0f, 0.001f, 0.01f, 0.05f } )
+		{
+			RayTreePruning pruning;
+
+			const int renderedStageCount
+				= renderStages( pruning, RenderingStage::R, maxLevel, threshold, dimensions )
+				+ renderStages( pruning, RenderingStage::T, maxLevel, threshold, dimensions );
+
+			Logger::WriteMessage( (
+				"Threshold " + std::to_string( threshold ) + ": " + std::to_string( renderedStageCount ) + " of "
+				+ std::to_string( stageCount ) + " stages rendered\n"
+			).c_str() );
+
+			Assert::IsTrue( renderedStageCount <= prevRenderedStageCount );
+			prevRenderedStageCount = renderedStageCount;
+
+			if ( threshold == 0.0f )
+				Assert::AreEqual( stageCount, renderedStageCount );
+		}
+
+		// Both first level stages matter - reflections thanks to the mirror, transmission thanks to the glass pane.
+		RayTreePruning pruning;
+		renderStages( pruning, RenderingStage::R, 1, 0.01f, dimensions );
+		renderStages( pruning, RenderingStage::T, 1, 0.01f, dimensions );
+
+		Assert::IsTrue( pruning.isStageVisible( RenderingStage::R, 0.01f ) );
+		Assert::IsTrue( pruning.isStageVisible( RenderingStage::T, 0.01f ) );
+		Assert::IsTrue( pruning.getContribution( RenderingStage::R ) > 0.1f );
+		Assert::IsTrue( pruning.getContribution( RenderingStage::T ) > 0.1f );
+	}
+	};
+}
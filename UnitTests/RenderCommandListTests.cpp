@@ -0,0 +1,336 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <algorithm>
+#include <experimental/filesystem>
+#include <memory>
+#include <string>
+#include <d3d11_3.h>
+#include <wrl.h>
+
+#include "RenderCommandList.h"
+#include "NullRenderCommandBackend.h"
+#include "DX11RendererCore.h"
+#include "ComputeShader.h"
+#include "Renderer.h"
+#include "Profiler.h"
+#include "RenderTargetManager.h"
+#include "Scene.h"
+#include "PointLight.h"
+#include "FreeCamera.h"
+#include "Selection.h"
+#include "Settings.h"
+#include "MathUtil.h"
+#include "Timer.h"
+
+using namespace Engine1;
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using Microsoft::WRL::ComPtr;
+
+namespace UnitTests
+{
+	TEST_CLASS( RenderCommandListTests )
+	{
+	private:
+
+	// Stand-ins for the GPU objects - only their addresses are recorded.
+	int m_vertexShader, m_fragmentShader, m_computeShaders[ 4 ], m_renderTargets[ 4 ], m_depthStencil, m_mesh, m_textures[ 2 ];
+
+	// Software (WARP) device - shader classes bind their inputs directly on a device context, so Renderer needs one, but not a GPU.
+	static void createWarpDevice( ComPtr< ID3D11Device3 >& device, ComPtr< ID3D11DeviceContext3 >& deviceContext )
+	{
+		D3D_FEATURE_LEVEL featureLevel = D3D_FEATURE_LEVEL_11_0;
+
+		ComPtr< ID3D11Device >        basicDevice;
+		ComPtr< ID3D11DeviceContext > basicDeviceContext;
+
+		HRESULT result = D3D11CreateDevice( 
+			nullptr, D3D_DRIVER_TYPE_WARP, 
+			nullptr, 0, &featureLevel, 1, 
+			D3D11_SDK_VERSION, 
+			basicDevice.ReleaseAndGetAddressOf(), 
+			nullptr, 
+			basicDeviceContext.ReleaseAndGetAddressOf() );
+
+		if ( result < 0 )
+			throw std::exception( "Device creation failed." );
+
+		result = basicDevice.As( &device );
+		basicDeviceContext.As( &deviceContext );
+
+		if ( result < 0 )
+			throw std::exception( "Creation of DirectX 11.3 device failed" );
+	}
+
+	// Renders a frame through Renderer with the capture enabled and returns the recorded commands. Reflections and refractions are
+	// rendered up to the given level without pruning - so the rendered layers don't depend on the contribution read back from the GPU.
+	static RenderCommandList captureFrame( const int lightCount, const int maxLevel )
+	{
+		ComPtr< ID3D11Device3 >        device;
+		ComPtr< ID3D11DeviceContext3 > deviceContext;
+		createWarpDevice( device, deviceContext );
+
+		// Shaders are loaded relative to the root project directory.
+		const auto testPath = std::experimental::filesystem::v1::current_path();
+		std::experimental::filesystem::v1::current_path( testPath.parent_path().parent_path() );
+
+		const Settings originalSettings = settings();
+
+		Settings::modify().initialize( *device.Get() );
+		Settings::modify().debug.renderLightSources                            = false; // No light model is passed to the renderer.
+		Settings::modify().rendering.shadows.enabled                           = true;
+		Settings::modify().rendering.reflectionsRefractions.reflectionsEnabled = true;
+		Settings::modify().rendering.reflectionsRefractions.refractionsEnabled = true;
+		Settings::modify().rendering.reflectionsRefractions.maxLevel           = maxLevel;
+		Settings::modify().rendering.reflectionsRefractions.pruning.enabled    = false;
+
+		DX11RendererCore rendererCore;
+		rendererCore.initialize( *deviceContext.Get() );
+
+		Profiler profiler;
+		profiler.initialize( device, deviceContext );
+
+		RenderTargetManager renderTargetManager;
+		renderTargetManager.initialize( device );
+
+		Renderer renderer( rendererCore, profiler, renderTargetManager );
+		renderer.initialize( settings().main.screenDimensions, device, deviceContext, nullptr );
+
+		Scene scene;
+		for ( int lightIdx = 0; lightIdx < lightCount; ++lightIdx )
+			scene.addLight( std::make_shared< PointLight >( float3( (float)lightIdx, 5.0f, 0.0f ) ) );
+
+		const FreeCamera camera( float3( 0.0f, 0.0f, -10.0f ), float3::ZERO, MathUtil::degreesToRadians( 70.0f ) );
+
+		renderer.captureNextFrame();
+		renderer.renderScene( scene, camera, false, Selection(), nullptr );
+
+		// Only the captured frame is recorded.
+		Assert::IsTrue( rendererCore.getCommandList() == nullptr );
+		Assert::AreEqual( (int)renderer.getCapturedCommandList().getCommands().size(), renderer.getCapturedFrameAnalysis().getStatistics().commandCount );
+
+		const RenderCommandList commandList = renderer.getCapturedCommandList();
+
+		renderer.renderScene( scene, camera, false, Selection(), nullptr );
+		Assert::AreEqual( commandList.getCommands().size(), renderer.getCapturedCommandList().getCommands().size() );
+
+		Settings::modify() = originalSettings;
+		std::experimental::filesystem::v1::current_path( testPath );
+
+		return commandList;
+	}
+
+	static int countPasses( const RenderCommandList& commandList, const std::string& name )
+	{
+		int count = 0;
+		for ( const RenderCommand& command : commandList.getCommands() ) {
+			if ( command.type == RenderCommandType::BeginPass && name == (const char*)commandList.getHandles()[ command.firstHandle ] )
+				++count;
+		}
+
+		return count;
+	}
+
+	public:
+
+	TEST_METHOD( RenderCommandList_Recording )
+	{
+		RenderCommandList commandList;
+
+		const RenderHandle renderTargets[] = { &m_renderTargets[ 0 ], &m_renderTargets[ 1 ] };
+		const RenderHandle uavs[] = { &m_renderTargets[ 2 ] };
+
+		commandList.setViewport( float2( 1024.0f, 768.0f ), float2::ZERO, 0.0f, 1.0f );
+		commandList.setRenderTargets( renderTargets, 2, &m_depthStencil, uavs, 1 );
+		commandList.draw( &m_mesh, 36, 4 );
+		commandList.dispatch( uint3( 4, 5, 6 ) );
+
+		const auto& commands = commandList.getCommands();
+		const auto& handles  = commandList.getHandles();
+
+		Assert::AreEqual( 4, (int)commands.size() );
+		Assert::IsTrue( commands[ 0 ].type == RenderCommandType::SetViewport );
+		Assert::AreEqual( 1024.0f, commandList.getViewports()[ commands[ 0 ].arguments[ 0 ] ].dimensions.x );
+
+		// Render target views, depth-stencil view and unordered access views.
+		Assert::AreEqual( 4, (int)commands[ 1 ].handleCount );
+		Assert::IsTrue( handles[ commands[ 1 ].firstHandle + 2 ] == &m_depthStencil );
+		Assert::IsTrue( handles[ commands[ 1 ].firstHandle + 3 ] == &m_renderTargets[ 2 ] );
+
+		Assert::IsTrue( handles[ commands[ 2 ].firstHandle ] == &m_mesh );
+		Assert::AreEqual( 36, (int)commands[ 2 ].arguments[ 0 ] );
+		Assert::AreEqual( 4, (int)commands[ 2 ].arguments[ 1 ] );
+		Assert::AreEqual( 6, (int)commands[ 3 ].arguments[ 2 ] );
+
+		commandList.clear();
+		Assert::IsTrue( commandList.getCommands().empty() );
+		Assert::IsTrue( commandList.getHandles().empty() );
+	}
+
+	TEST_METHOD( RenderCommandList_Null_Backend_Statistics )
+	{
+		RenderCommandList commandList;
+
+		const RenderHandle renderTargets[] = { &m_renderTargets[ 0 ] };
+
+		commandList.beginPass( "geometry" );
+		commandList.setRenderTargets( renderTargets, 1, &m_depthStencil, nullptr, 0 );
+		commandList.setRenderingShaders( &m_vertexShader, &m_fragmentShader );
+		commandList.setBlendState( nullptr );                              // Redundant - default state is bound.
+		commandList.draw( &m_mesh, 36 );
+		commandList.setRenderingShaders( &m_vertexShader, &m_fragmentShader ); // Redundant.
+		commandList.draw( &m_mesh, 36, 10 );
+		commandList.endPass();
+
+		commandList.beginPass( "lighting" );
+		commandList.unbindRenderTargets();
+		commandList.setComputeShader( &m_computeShaders[ 0 ] );
+		commandList.setRenderTargets( nullptr, 0, nullptr, renderTargets, 1 );
+		commandList.dispatch( uint3( 8, 8, 1 ) );
+		commandList.setRenderTargets( nullptr, 0, nullptr, renderTargets, 1 ); // Redundant.
+		commandList.dispatch( uint3( 8, 8, 1 ) );
+		commandList.unbindShaderInputs();
+		commandList.endPass();
+
+		NullRenderCommandBackend backend;
+		commandList.execute( backend );
+
+		const auto& statistics = backend.getStatistics();
+		Assert::AreEqual( 13, statistics.commandCount );
+		Assert::AreEqual( 2, statistics.drawCount );
+		Assert::AreEqual( 11, statistics.instanceCount );
+		Assert::AreEqual( 2, statistics.dispatchCount );
+		Assert::AreEqual( 2, statistics.barrierCount );
+		Assert::AreEqual( 7, statistics.bindCount );
+		Assert::AreEqual( 3, statistics.redundantBindCount );
+
+		Assert::AreEqual( 2, (int)backend.getPassNames().size() );
+		Assert::AreEqual( 2, backend.getPassStatistics( "geometry" ).redundantBindCount );
+		Assert::AreEqual( 2, backend.getPassStatistics( "lighting" ).dispatchCount );
+		Assert::AreEqual( 0, backend.getPassStatistics( "unknown" ).commandCount );
+	}
+
+	TEST_METHOD( RenderCommandList_Null_Backend_Validation )
+	{
+		const RenderHandle renderTargets[] = { &m_renderTargets[ 0 ] };
+
+		{ // Draw after the compute shader replaced the rendering shaders.
+			RenderCommandList commandList;
+			commandList.setRenderTargets( renderTargets, 1, nullptr, nullptr, 0 );
+			commandList.setRenderingShaders( &m_vertexShader, &m_fragmentShader );
+			commandList.setComputeShader( &m_computeShaders[ 0 ] );
+			commandList.draw( &m_mesh, 36 );
+
+			NullRenderCommandBackend backend;
+			Assert::ExpectException< std::exception >( [ &commandList, &backend ]() { commandList.execute( backend ); } );
+		}
+
+		{ // Draw without render targets.
+			RenderCommandList commandList;
+			commandList.setRenderingShaders( &m_vertexShader, &m_fragmentShader );
+			commandList.draw( &m_mesh, 36 );
+
+			NullRenderCommandBackend backend;
+			Assert::ExpectException< std::exception >( [ &commandList, &backend ]() { commandList.execute( backend ); } );
+		}
+
+		{ // Dispatch without a compute shader.
+			RenderCommandList commandList;
+			commandList.dispatch( uint3( 1, 1, 1 ) );
+
+			NullRenderCommandBackend backend;
+			Assert::ExpectException< std::exception >( [ &commandList, &backend ]() { commandList.execute( backend ); } );
+		}
+
+		{ // Unmatched pass end.
+			RenderCommandList commandList;
+			commandList.endPass();
+
+			NullRenderCommandBackend backend;
+			Assert::ExpectException< std::exception >( [ &commandList, &backend ]() { commandList.execute( backend ); } );
+		}
+	}
+
+	TEST_METHOD( RenderCommandList_Headless_Renderer_Core )
+	{
+		DX11RendererCore rendererCore;
+		ComputeShader    computeShader;
+
+		// Neither a device context nor a command list.
+		Assert::ExpectException< std::exception >( [ &rendererCore, &computeShader ]() { rendererCore.enableComputeShader( computeShader ); } );
+
+		RenderCommandList commandList;
+		rendererCore.setCommandList( &commandList );
+
+		rendererCore.beginPass( "pass" );
+		rendererCore.enableComputeShader( computeShader );
+		rendererCore.enableComputeShader( computeShader );
+		rendererCore.compute( uint3( 2, 2, 1 ) );
+		rendererCore.disableComputePipeline();
+		rendererCore.endPass();
+
+		// Calls filtered by the core's state cache are recorded too.
+		const auto& commands = commandList.getCommands();
+		Assert::AreEqual( 7, (int)commands.size() );
+		Assert::IsTrue( commands[ 1 ].type == RenderCommandType::SetComputeShader );
+		Assert::IsTrue( commandList.getHandles()[ commands[ 1 ].firstHandle ] == &computeShader );
+		Assert::IsTrue( commands[ 3 ].type == RenderCommandType::Dispatch );
+
+		NullRenderCommandBackend backend;
+		commandList.execute( backend );
+
+		Assert::AreEqual( 1, backend.getStatistics().dispatchCount );
+		Assert::AreEqual( 1, backend.getStatistics().redundantBindCount );
+	}
+
+	TEST_METHOD( RenderCommandList_Renderer_Frame_Capture )
+	{
+		const RenderCommandList level1 = captureFrame( 1, 1 );
+		const RenderCommandList level2 = captureFrame( 1, 2 );
+
+		// Stream recorded by the real frame is valid.
+		NullRenderCommandBackend backend;
+		level1.execute( backend );
+
+		const auto& passNames = backend.getPassNames();
+		for ( const std::string passName : { "renderPrimaryLayer", "renderSecondaryLayers", "renderSecondaryLayer", "postProcess" } )
+			Assert::IsTrue( std::find( passNames.begin(), passNames.end(), passName ) != passNames.end() );
+
+		Assert::IsTrue( backend.getPassStatistics( "renderSecondaryLayer" ).dispatchCount > 0 );
+
+		// Reflection and refraction of the first level, then reflection and refraction of each of them.
+		Assert::AreEqual( 2, countPasses( level1, "renderSecondaryLayer" ) );
+		Assert::AreEqual( 6, countPasses( level2, "renderSecondaryLayer" ) );
+	}
+
+	TEST_METHOD( RenderCommandList_Benchmark )
+	{
+		NullRenderCommandBackend backend;
+
+		for ( const int lightCount : { 1, 4, 8 } )
+		{
+			const RenderCommandList commandList = captureFrame( lightCount, 2 );
+
+			const int   repeatCount = 100;
+			const Timer executionStartTime;
+			for ( int i = 0; i < repeatCount; ++i ) {
+				backend.reset();
+				commandList.execute( backend );
+			}
+			const Timer executionEndTime;
+
+			const auto& statistics          = backend.getStatistics();
+			const auto  secondaryStatistics = backend.getPassStatistics( "renderSecondaryLayer" );
+
+			Logger::WriteMessage( (
+				std::to_string( lightCount ) + " lights: " + std::to_string( statistics.commandCount ) + " commands per frame, executed headless in " 
+				+ std::to_string( Timer::getElapsedTime( executionEndTime, executionStartTime ) / repeatCount ) + " ms, "
+				+ std::to_string( statistics.dispatchCount ) + " dispatches (" + std::to_string( secondaryStatistics.dispatchCount ) + " in secondary layers), "
+				+ std::to_string( statistics.redundantBindCount ) + " of " + std::to_string( statistics.bindCount ) + " binds redundant\n"
+			).c_str() );
+
+			Assert::IsTrue( secondaryStatistics.dispatchCount > 0 );
+		}
+	}
+	};
+}
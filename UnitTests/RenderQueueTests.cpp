@@ -0,0 +1,209 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+
+#include "RenderQueue.h"
+#include "BlockModel.h"
+#include "Timer.h"
+
+using namespace Engine1;
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTests
+{
+	TEST_CLASS( RenderQueueTests )
+	{
+	private:
+
+	// Counts the state changes instead of calling the GPU.
+	class MockBackend : public RenderQueueBackend
+	{
+		public:
+
+		MockBackend() : shaderBindCount( 0 ), modelBindCount( 0 ), drawCount( 0 ), instanceCount( 0 ), boundModel( nullptr ) {}
+
+		void bindShader( const int shader ) override
+		{
+			++shaderBindCount;
+			boundModel = nullptr;
+		}
+
+		void bindModel( const BlockModel& model, const int material ) override
+		{
+			++modelBindCount;
+			boundModel = &model;
+		}
+
+		void drawInstances( const BlockModel& model, const float43* worldMatrices, const int count ) override
+		{
+			Assert::IsTrue( boundModel == &model );
+
+			++drawCount;
+			instanceCount += count;
+
+			drawnMatrices.insert( drawnMatrices.end(), worldMatrices, worldMatrices + count );
+		}
+
+		int shaderBindCount;
+		int modelBindCount;
+		int drawCount;
+		int instanceCount;
+
+		const BlockModel*      boundModel;
+		std::vector< float43 > drawnMatrices;
+	};
+
+	static float43 createWorldMatrix( const float3& position )
+	{
+		float43 matrix( float43::IDENTITY );
+		matrix.setTranslation( position );
+
+		return matrix;
+	}
+
+	public:
+
+	TEST_METHOD( RenderQueue_Radix_Sort )
+	{
+		std::mt19937_64 random( 1 );
+
+		for ( const int count : { 0, 1, 7, 1000 } )
+		{
+			std::vector< unsigned long long > keys, tmpKeys;
+			std::vector< unsigned int >       indices, tmpIndices;
+
+			for ( int i = 0; i < count; ++i ) {
+				// Few distinct values in the low bits - to check stability.
+				keys.push_back( i % 3 == 0 ? ( random() & 0xF ) : random() );
+				indices.push_back( i );
+			}
+
+			std::vector< std::pair< unsigned long long, unsigned int > > expected;
+			for ( int i = 0; i < count; ++i )
+				expected.emplace_back( keys[ i ], indices[ i ] );
+
+			std::stable_sort( expected.begin(), expected.end(), []( const std::pair< unsigned long long, unsigned int >& a, const std::pair< unsigned long long, unsigned int >& b ) {
+				return a.first < b.first;
+			} );
+
+			RenderQueue::radixSort( keys, indices, tmpKeys, tmpIndices );
+
+			for ( int i = 0; i < count; ++i ) {
+				Assert::IsTrue( expected[ i ].first == keys[ i ] );
+				Assert::AreEqual( (int)expected[ i ].second, (int)indices[ i ] );
+			}
+		}
+	}
+
+	TEST_METHOD( RenderQueue_Key_Order )
+	{
+		const float maxDepth = 100.0f;
+
+		// Pass is the most significant, then shader, model, material and depth.
+		Assert::IsTrue( RenderQueue::createKey( 0, 9, 9, 9, 99.0f, maxDepth ) < RenderQueue::createKey( 1, 0, 0, 0, 0.0f, maxDepth ) );
+		Assert::IsTrue( RenderQueue::createKey( 0, 0, 9, 9, 99.0f, maxDepth ) < RenderQueue::createKey( 0, 1, 0, 0, 0.0f, maxDepth ) );
+		Assert::IsTrue( RenderQueue::createKey( 0, 0, 0, 9, 99.0f, maxDepth ) < RenderQueue::createKey( 0, 0, 1, 0, 0.0f, maxDepth ) );
+		Assert::IsTrue( RenderQueue::createKey( 0, 0, 0, 0, 99.0f, maxDepth ) < RenderQueue::createKey( 0, 0, 0, 1, 0.0f, maxDepth ) );
+		Assert::IsTrue( RenderQueue::createKey( 0, 0, 0, 0, 10.0f, maxDepth ) < RenderQueue::createKey( 0, 0, 0, 0, 20.0f, maxDepth ) );
+
+		// Depth outside of the range is clamped.
+		Assert::IsTrue( RenderQueue::createKey( 0, 0, 0, 0, 500.0f, maxDepth ) == RenderQueue::createKey( 0, 0, 0, 0, 100.0f, maxDepth ) );
+
+		Assert::ExpectException< std::exception >( [ maxDepth ]() { RenderQueue::createKey( 16, 0, 0, 0, 0.0f, maxDepth ); } );
+	}
+
+	TEST_METHOD( RenderQueue_Instancing )
+	{
+		const auto modelA = std::make_shared< BlockModel >();
+		const auto modelB = std::make_shared< BlockModel >();
+
+		RenderQueue queue;
+		queue.clear( 1000.0f );
+
+		// Interleaved models, as iterating over actors in a hash set would produce.
+		for ( int i = 0; i < 10; ++i ) {
+			queue.add( *modelA, createWorldMatrix( float3( 0.0f, 0.0f, (float)( 100 - i ) ) ), (float)( 100 - i ) );
+			queue.add( *modelB, createWorldMatrix( float3( 0.0f, 0.0f, (float)i ) ), (float)i );
+		}
+
+		// Same model with a different material and shader, and a later pass.
+		queue.add( *modelA, createWorldMatrix( float3::ZERO ), 0.0f, 0, 0, 1 );
+		queue.add( *modelA, createWorldMatrix( float3::ZERO ), 0.0f, 0, 1, 0 );
+		queue.add( *modelB, createWorldMatrix( float3::ZERO ), 0.0f, 1, 0, 0 );
+
+		queue.sort();
+
+		MockBackend backend;
+		queue.submit( backend );
+
+		// Shader 0: A, A with material 1, B, then shader 1: A, then pass 1: B.
+		Assert::AreEqual( 5, backend.drawCount );
+		Assert::AreEqual( 23, backend.instanceCount );
+		Assert::AreEqual( 3, backend.shaderBindCount );
+		Assert::AreEqual( 5, backend.modelBindCount );
+
+		const auto& statistics = queue.getStatistics();
+		Assert::AreEqual( 23, statistics.drawCount );
+		Assert::AreEqual( 5, statistics.instancedDrawCount );
+		Assert::AreEqual( 3, statistics.shaderBindCount );
+		Assert::AreEqual( 5, statistics.modelBindCount );
+
+		// Instances within a draw go front to back.
+		for ( int i = 1; i < 10; ++i )
+			Assert::IsTrue( backend.drawnMatrices[ i - 1 ].getTranslation().z < backend.drawnMatrices[ i ].getTranslation().z );
+	}
+
+	TEST_METHOD( RenderQueue_Benchmark )
+	{
+		std::mt19937 random( 4 );
+
+		for ( const int modelCount : { 10, 100, 1000 } )
+		{
+			std::vector< std::shared_ptr< BlockModel > > models;
+			for ( int i = 0; i < modelCount; ++i )
+				models.push_back( std::make_shared< BlockModel >() );
+
+			std::uniform_int_distribution< int >    modelIdx( 0, modelCount - 1 );
+			std::uniform_real_distribution< float > depth( 0.0f, 1000.0f );
+
+			// Actors in random order - many clones of each model.
+			const int actorCount = 100000;
+
+			std::vector< int > actorModels;
+			for ( int i = 0; i < actorCount; ++i )
+				actorModels.push_back( modelIdx( random ) );
+
+			// Without the queue each actor binds its model (shaders, textures, constants).
+			int unsortedModelChangeCount = 0;
+			for ( int i = 0; i < actorCount; ++i )
+				unsortedModelChangeCount += ( i == 0 || actorModels[ i ] != actorModels[ i - 1 ] ) ? 1 : 0;
+
+			RenderQueue  queue;
+			MockBackend  backend;
+
+			const Timer startTime;
+			queue.clear( 1000.0f );
+			for ( int i = 0; i < actorCount; ++i )
+				queue.add( *models[ actorModels[ i ] ], float43::IDENTITY, depth( random ) );
+			queue.sort();
+			const Timer endTime;
+
+			queue.submit( backend );
+
+			Logger::WriteMessage( (
+				std::to_string( actorCount ) + " actors, " + std::to_string( modelCount ) + " models: "
+				+ std::to_string( Timer::getElapsedTime( endTime, startTime ) ) + " ms to build and sort, "
+				+ std::to_string( backend.modelBindCount ) + " model binds and " + std::to_string( backend.drawCount ) + " draws instead of "
+				+ std::to_string( actorCount ) + " draws with " + std::to_string( unsortedModelChangeCount ) + " model changes\n"
+			).c_str() );
+
+			Assert::AreEqual( modelCount, backend.drawCount );
+			Assert::AreEqual( actorCount, backend.instanceCount );
+		}
+	}
+	};
+}
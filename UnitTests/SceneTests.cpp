@@ -0,0 +1,312 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "Scene.h"
+#include "SceneUtil.h"
+#include "BlockActor.h"
+#include "BlockModel.h"
+#include "BlockMesh.h"
+#include "PointLight.h"
+#include "MathUtil.h"
+#include "Timer.h"
+
+#include "BlockActorFixtures.h"
+
+using namespace Engine1;
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace UnitTests::BlockActorFixtures;
+
+namespace UnitTests
+{
+	TEST_CLASS( SceneTests )
+	{
+	private:
+
+	// Checks that the arrays of each actor type describe the same actors as the list of all the actors.
+	static void checkConsistency( const Scene& scene )
+	{
+		const Scene::BlockActorArrays& blockActors = scene.getBlockActors();
+
+		Assert::AreEqual( scene.getActors().size(), blockActors.actors.size() );
+		Assert::AreEqual( blockActors.actors.size(), blockActors.poses.size() );
+		Assert::AreEqual( blockActors.actors.size(), blockActors.bounds.size() );
+		Assert::AreEqual( blockActors.actors.size(), blockActors.models.size() );
+		Assert::AreEqual( blockActors.actors.size(), blockActors.flags.size() );
+
+		for ( int i = 0; i < blockActors.size(); ++i )
+		{
+			const auto& actor = blockActors.actors[ i ];
+
+			Assert::IsTrue( scene.getActors()[ scene.getActorIndex( *actor ) ] == actor );
+			Assert::IsTrue( scene.getActor( scene.getHandle( *actor ) ) == actor );
+			Assert::IsTrue( MathUtil::areEqual( actor->getPose().getTranslation(), blockActors.poses[ i ].getTranslation(), 0.0f, 0.0001f ) );
+		}
+	}
+
+	public:
+
+	TEST_METHOD( Scene_Handles )
+	{
+		Scene scene;
+
+		const auto model  = createBoxModel();
+		const auto actor1 = createActor( model, float3( 1.0f, 0.0f, 0.0f ) );
+		const auto actor2 = createActor( model, float3( 2.0f, 0.0f, 0.0f ) );
+		const auto actor3 = createActor( model, float3( 3.0f, 0.0f, 0.0f ) );
+
+		const Scene::Handle handle1 = scene.addActor( actor1 );
+		const Scene::Handle handle2 = scene.addActor( actor2 );
+		const Scene::Handle handle3 = scene.addActor( actor3 );
+
+		Assert::IsTrue( handle1 != handle2 && handle2 != handle3 );
+		Assert::IsTrue( scene.getActor( handle2 ) == actor2 );
+
+		// Adding twice doesn't duplicate the actor.
+		Assert::IsTrue( scene.addActor( actor2 ) == handle2 );
+		Assert::AreEqual( (size_t)3, scene.getActors().size() );
+
+		scene.removeActor( handle1 );
+
+		Assert::IsTrue( scene.getActor( handle1 ) == nullptr );
+		Assert::AreEqual( -1, scene.getActorIndex( *actor1 ) );
+		Assert::IsTrue( scene.getActor( handle3 ) == actor3 );
+		checkConsistency( scene );
+
+		// Slot of the removed actor is reused, but the old handle stays invalid.
+		const auto          actor4  = createActor( model, float3( 4.0f, 0.0f, 0.0f ) );
+		const Scene::Handle handle4 = scene.addActor( actor4 );
+
+		Assert::AreEqual( handle1.slot, handle4.slot );
+		Assert::IsTrue( scene.getActor( handle1 ) == nullptr );
+		Assert::IsTrue( scene.getActor( handle4 ) == actor4 );
+
+		// Removing through a stale handle does nothing.
+		scene.removeActor( handle1 );
+		Assert::AreEqual( (size_t)3, scene.getActors().size() );
+		checkConsistency( scene );
+
+		scene.removeActor( actor3 );
+		scene.removeActor( actor2 );
+		Assert::AreEqual( (size_t)1, scene.getActors().size() );
+		checkConsistency( scene );
+
+		scene.removeAllActors();
+		Assert::IsTrue( scene.getActor( handle4 ) == nullptr );
+		Assert::AreEqual( 0, scene.getBlockActors().size() );
+
+		// Lights.
+		const auto light1 = std::make_shared< PointLight >( float3( 0.0f, 1.0f, 0.0f ) );
+		const auto light2 = std::make_shared< PointLight >( float3( 0.0f, 2.0f, 0.0f ) );
+
+		const Scene::Handle lightHandle1 = scene.addLight( light1 );
+		scene.addLight( light2 );
+		scene.removeLight( light1 );
+
+		Assert::IsTrue( scene.getLight( lightHandle1 ) == nullptr );
+		Assert::AreEqual( (size_t)1, scene.getLights().size() );
+		Assert::IsTrue( scene.getLights()[ 0 ] == light2 );
+		Assert::AreEqual( 0, scene.getLightIndex( *light2 ) );
+	}
+
+	TEST_METHOD( Scene_Actor_Data )
+	{
+		Scene scene;
+
+		const auto model           = createBoxModel();
+		const auto actor           = createActor( model, float3( 10.0f, 0.0f, 0.0f ) );
+		const auto actorNotCasting = createActor( model, float3( 20.0f, 0.0f, 0.0f ) );
+		const auto actorNoModel    = createActor( nullptr, float3( 30.0f, 0.0f, 0.0f ) );
+
+		actorNotCasting->setCastingShadows( false );
+
+		scene.addActor( actor );
+		scene.addActor( actorNotCasting );
+		scene.addActor( actorNoModel );
+
+		// Actor moved after being added - arrays are updated on request.
+		actor->getPose().setTranslation( float3( 0.0f, 5.0f, 0.0f ) );
+		scene.updateActorData();
+
+		const Scene::BlockActorArrays& blockActors = scene.getBlockActors();
+
+		const int actorIdx           = scene.getActorIndex( *actor );
+		const int actorNotCastingIdx = scene.getActorIndex( *actorNotCasting );
+		const int actorNoModelIdx    = scene.getActorIndex( *actorNoModel );
+
+		Assert::IsTrue( MathUtil::areEqual( float3( -1.0f, 4.0f, -1.0f ), blockActors.bounds[ actorIdx ].getMin(), 0.0f, 0.0001f ) );
+		Assert::IsTrue( MathUtil::areEqual( float3( 1.0f, 6.0f, 1.0f ), blockActors.bounds[ actorIdx ].getMax(), 0.0f, 0.0001f ) );
+		Assert::IsTrue( blockActors.models[ actorIdx ] == model.get() );
+		Assert::AreEqual( (int)( Scene::s_castsShadowFlag | Scene::s_hasMeshFlag ), (int)blockActors.flags[ actorIdx ] );
+		Assert::AreEqual( (int)Scene::s_hasMeshFlag, (int)blockActors.flags[ actorNotCastingIdx ] );
+
+		// Actors without a mesh get an empty box.
+		Assert::IsTrue( blockActors.models[ actorNoModelIdx ] == nullptr );
+		Assert::AreEqual( (int)Scene::s_castsShadowFlag, (int)blockActors.flags[ actorNoModelIdx ] );
+		Assert::IsTrue( blockActors.bounds[ actorNoModelIdx ].getMin().x > blockActors.bounds[ actorNoModelIdx ].getMax().x );
+
+		// Removal moves the data of the last actor.
+		scene.removeActor( actor );
+		checkConsistency( scene );
+
+		Assert::IsTrue( MathUtil::areEqual( float3( 21.0f, 1.0f, 1.0f ), blockActors.bounds[ scene.getActorIndex( *actorNotCasting ) ].getMax(), 0.0f, 0.0001f ) );
+	}
+
+	TEST_METHOD( Scene_Spatial_Queries )
+	{
+		Scene scene;
+
+		const auto model        = createBoxModel();
+		const auto actor1       = createActor( model, float3( 0.0f, 0.0f, 0.0f ) );
+		const auto actor2       = createActor( model, float3( 10.0f, 0.0f, 0.0f ) );
+		const auto actor3       = createActor( model, float3( 20.0f, 0.0f, 0.0f ) );
+		const auto actorNoModel = createActor( nullptr, float3( 10.0f, 0.0f, 0.0f ) );
+
+		scene.addActor( actor1 );
+		scene.addActor( actor2 );
+		scene.addActor( actor3 );
+		scene.addActor( actorNoModel );
+
+		// Actors with a mesh enter the index when they're added - queries don't have to wait for updateActorData.
+		Assert::AreEqual( 3, scene.getSpatialIndex().getProxyCount() );
+
+		std::vector< std::shared_ptr< Actor > > result;
+		scene.findActors( BoundingBox( float3( 8.0f, -1.0f, -1.0f ), float3( 12.0f, 1.0f, 1.0f ) ), result );
+
+		Assert::AreEqual( (size_t)1, result.size() );
+		Assert::IsTrue( result[ 0 ] == actor2 );
+
+		result.clear();
+		scene.findNearestActors( float3( 17.0f, 0.0f, 0.0f ), 2, result );
+
+		Assert::AreEqual( (size_t)2, result.size() );
+		Assert::IsTrue( result[ 0 ] == actor3 && result[ 1 ] == actor2 );
+
+		// Nearest hit along the ray - callback shortens the ray, so the actors behind aren't reported.
+		std::shared_ptr< Actor > hitActor;
+		scene.rayCastActors( float3( -10.0f, 0.0f, 0.0f ), float3( 1.0f, 0.0f, 0.0f ), 100.0f, [ & ]( const std::shared_ptr< Actor >& actor, float distance ) {
+			hitActor = actor;
+			return distance;
+		} );
+
+		Assert::IsTrue( hitActor == actor1 );
+
+		// Moved and removed actors.
+		actor1->getPose().setTranslation( float3( 10.0f, 5.0f, 0.0f ) );
+		scene.removeActor( actor2 );
+		scene.updateActorData();
+
+		result.clear();
+		scene.findActors( BoundingBox( float3( 8.0f, -1.0f, -1.0f ), float3( 12.0f, 1.0f, 1.0f ) ), result );
+		Assert::IsTrue( result.empty() );
+
+		result.clear();
+		scene.findActors( BoundingBox( float3( 9.0f, 5.0f, 0.0f ), float3( 9.5f, 5.5f, 0.5f ) ), result );
+		Assert::AreEqual( (size_t)1, result.size() );
+		Assert::IsTrue( result[ 0 ] == actor1 );
+
+		// Actor which lost its model leaves the index.
+		actor3->setModel( nullptr );
+		scene.updateActorData();
+		Assert::AreEqual( 1, scene.getSpatialIndex().getProxyCount() );
+
+		scene.removeAllActors();
+		Assert::AreEqual( 0, scene.getSpatialIndex().getProxyCount() );
+	}
+
+	// Compares the scene storage with the previous one - a set of actor pointers, copied to a vector and filtered by type each frame.
+	TEST_METHOD( Scene_Benchmark_100k_Actors )
+	{
+		const int actorCount = 100000, repeatCount = 10;
+
+		std::mt19937 random( 5 );
+		std::uniform_real_distribution< float > position( -500.0f, 500.0f );
+
+		const auto model = createBoxModel();
+
+		Scene                                          scene;
+		std::unordered_set< std::shared_ptr< Actor > > actorSet;
+
+		for ( int i = 0; i < actorCount; ++i ) {
+			const auto actor = createActor( model, float3( position( random ), 0.0f, position( random ) ) );
+			scene.addActor( actor );
+			actorSet.insert( actor );
+		}
+
+		scene.updateActorData();
+
+		float3 setSum = float3::ZERO, sceneSum = float3::ZERO;
+		int    setCount = 0, sceneCount = 0;
+
+		// Iteration - sum of the translations.
+		const Timer setIterationStartTime;
+		for ( int repeat = 0; repeat < repeatCount; ++repeat ) {
+			for ( const auto& actor : actorSet )
+				setSum += actor->getPose().getTranslation();
+		}
+		const Timer setIterationEndTime;
+
+		const Timer sceneIterationStartTime;
+		for ( int repeat = 0; repeat < repeatCount; ++repeat ) {
+			for ( const float43& pose : scene.getBlockActors().poses )
+				sceneSum += pose.getTranslation();
+		}
+		const Timer sceneIterationEndTime;
+
+		// Filtering - block actors.
+		const Timer setFilteringStartTime;
+		for ( int repeat = 0; repeat < repeatCount; ++repeat ) {
+			const std::vector< std::shared_ptr< Actor > > actorVec( actorSet.begin(), actorSet.end() );
+			setCount += (int)SceneUtil::filterActorsByType< BlockActor >( actorVec ).size();
+		}
+		const Timer setFilteringEndTime;
+
+		const Timer sceneFilteringStartTime;
+		for ( int repeat = 0; repeat < repeatCount; ++repeat )
+			sceneCount += scene.getBlockActors().size();
+		const Timer sceneFilteringEndTime;
+
+		// Bounds update - world bounding box of each actor.
+		std::vector< BoundingBox > setBounds;
+
+		const Timer setBoundsStartTime;
+		for ( int repeat = 0; repeat < repeatCount; ++repeat )
+		{
+			setBounds.clear();
+			for ( const auto& actor : actorSet )
+			{
+				const auto& blockActor = std::static_pointer_cast< BlockActor >( actor );
+
+				if ( blockActor->getModel() && blockActor->getModel()->getMesh() )
+					setBounds.push_back( MathUtil::boundingBoxLocalToWorld( blockActor->getModel()->getMesh()->getBoundingBox(), blockActor->getPose() ) );
+			}
+		}
+		const Timer setBoundsEndTime;
+
+		const Timer sceneBoundsStartTime;
+		for ( int repeat = 0; repeat < repeatCount; ++repeat )
+			scene.updateActorData();
+		const Timer sceneBoundsEndTime;
+
+		const auto getDuration = [ repeatCount ]( const Timer& endTime, const Timer& startTime ) {
+			return std::to_string( Timer::getElapsedTime( endTime, startTime ) / repeatCount ) + " ms";
+		};
+
+		Logger::WriteMessage( (
+			"Scene (" + std::to_string( actorCount ) + " actors) - set / dense arrays: "
+			+ "iteration " + getDuration( setIterationEndTime, setIterationStartTime ) + " / " + getDuration( sceneIterationEndTime, sceneIterationStartTime ) + ", "
+			+ "filtering " + getDuration( setFilteringEndTime, setFilteringStartTime ) + " / " + getDuration( sceneFilteringEndTime, sceneFilteringStartTime ) + ", "
+			+ "bounds update " + getDuration( setBoundsEndTime, setBoundsStartTime ) + " / " + getDuration( sceneBoundsEndTime, sceneBoundsStartTime ) + "\n"
+		).c_str() );
+
+		Assert::IsTrue( MathUtil::areEqual( setSum, sceneSum, 0.001f, 0.1f ) );
+		Assert::AreEqual( setCount, sceneCount );
+		Assert::AreEqual( setBounds.size(), scene.getBlockActors().bounds.size() );
+	}
+	};
+}
@@ -0,0 +1,144 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+
+#include "ShadowCasterCulling.h"
+#include "RaytracingShadowsComputeShader.h"
+#include "BlockActor.h"
+#include "BlockModel.h"
+#include "BlockMesh.h"
+#include "PointLight.h"
+#include "SpotLight.h"
+#include "MathUtil.h"
+
+#include "BlockActorFixtures.h"
+
+using namespace Engine1;
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace UnitTests::BlockActorFixtures;
+
+namespace UnitTests
+{
+	TEST_CLASS( ShadowCasterCullingTests )
+	{
+	private:
+
+	static bool contains( const std::vector< std::shared_ptr< BlockActor > >& actors, const std::shared_ptr< BlockActor >& actor )
+	{
+		return std::find( actors.begin(), actors.end(), actor ) != actors.end();
+	}
+
+	public:
+
+	TEST_METHOD( ShadowCasterCulling_Point_Light )
+	{
+		const auto model = createBoxModel();
+
+		const auto receiver      = createActor( model, float3( 0.0f, 0.0f, 0.0f ) );
+		const auto between       = createActor( model, float3( 0.0f, 5.0f, 0.0f ) );
+		const auto nearTheShadow = createActor( model, float3( 2.5f, 5.0f, 0.0f ) ); // Within the penumbra of the area light.
+		const auto aside         = createActor( model, float3( 20.0f, 5.0f, 0.0f ) );
+		const auto aboveTheLight = createActor( model, float3( 0.0f, 20.0f, 0.0f ) );
+		const auto belowReceiver = createActor( model, float3( 0.0f, -10.0f, 0.0f ) );
+		const auto notCasting    = createActor( model, float3( 0.0f, 7.0f, 0.0f ), false );
+
+		const std::vector< std::shared_ptr< BlockActor > > actors = { receiver, between, nearTheShadow, aside, aboveTheLight, belowReceiver, notCasting };
+
+		PointLight light( float3( 0.0f, 10.0f, 0.0f ) );
+		light.setEmitterRadius( 2.0f );
+
+		ShadowCasterCulling culling;
+		culling.update( actors );
+		culling.setReceivers( { BoundingBox( float3( -1.0f, -1.0f, -1.0f ), float3( 1.0f, 1.0f, 1.0f ) ) } );
+
+		const auto& casters = culling.cull( light );
+
+		Assert::IsTrue( contains( casters, receiver ) ); // Can shadow itself.
+		Assert::IsTrue( contains( casters, between ) );
+		Assert::IsTrue( contains( casters, nearTheShadow ) );
+		Assert::IsFalse( contains( casters, aside ) );
+		Assert::IsFalse( contains( casters, aboveTheLight ) );
+		Assert::IsFalse( contains( casters, belowReceiver ) );
+		Assert::IsFalse( contains( casters, notCasting ) );
+		Assert::AreEqual( 6, culling.getStatistics().casterCount );
+
+		// All actors are receivers - everything casting shadows may be relevant.
+		culling.setAllActorsAsReceivers();
+		Assert::AreEqual( 6, (int)culling.cull( light ).size() );
+	}
+
+	TEST_METHOD( ShadowCasterCulling_Spot_Light_Cone )
+	{
+		const auto model = createBoxModel();
+
+		const auto insideTheCone  = createActor( model, float3( 0.0f, 0.0f, 0.0f ) );
+		const auto outsideTheCone = createActor( model, float3( 30.0f, 0.0f, 0.0f ) );
+		const auto behindTheLight = createActor( model, float3( 0.0f, 15.0f, 0.0f ) );
+
+		SpotLight light( float3( 0.0f, 10.0f, 0.0f ), float3( 0.0f, -1.0f, 0.0f ), MathUtil::degreesToRadians( 30.0f ) );
+
+		ShadowCasterCulling culling;
+		culling.update( { insideTheCone, outsideTheCone, behindTheLight } );
+		culling.setAllActorsAsReceivers();
+
+		const auto& casters = culling.cull( light );
+
+		Assert::AreEqual( 1, (int)casters.size() );
+		Assert::IsTrue( contains( casters, insideTheCone ) );
+	}
+
+	TEST_METHOD( ShadowCasterCulling_Benchmark )
+	{
+		std::mt19937 random( 9 );
+		std::uniform_real_distribution< float > position( -200.0f, 200.0f );
+
+		const auto model = createBoxModel();
+
+		std::vector< std::shared_ptr< BlockActor > > actors;
+		for ( int i = 0; i < 2000; ++i )
+			actors.push_back( createActor( model, float3( position( random ), 0.0f, position( random ) ) ) );
+
+		// Receivers - actors in a part of the scene, as if seen by the camera.
+		std::vector< BoundingBox > receivers;
+		for ( const auto& actor : actors ) {
+			const float3 actorPosition = actor->getPose().getTranslation();
+			if ( actorPosition.x > 0.0f && actorPosition.x < 60.0f && actorPosition.z > 0.0f && actorPosition.z < 60.0f )
+				receivers.push_back( BoundingBox( actorPosition - float3( 1.0f, 1.0f, 1.0f ), actorPosition + float3( 1.0f, 1.0f, 1.0f ) ) );
+		}
+
+		std::vector< std::shared_ptr< Light > > lights;
+		lights.push_back( std::make_shared< PointLight >( float3( 30.0f, 20.0f, 30.0f ) ) );
+		lights.push_back( std::make_shared< PointLight >( float3( -100.0f, 50.0f, 0.0f ) ) );
+		lights.push_back( std::make_shared< SpotLight >( float3( 30.0f, 40.0f, 30.0f ), float3( 0.0f, -1.0f, 0.0f ), MathUtil::degreesToRadians( 20.0f ) ) );
+		lights.push_back( std::make_shared< SpotLight >( float3( 100.0f, 40.0f, 100.0f ), float3( -1.0f, -1.0f, -1.0f ), MathUtil::degreesToRadians( 30.0f ) ) );
+
+		ShadowCasterCulling culling;
+		culling.update( actors );
+		culling.setReceivers( receivers );
+
+		for ( const auto& light : lights )
+		{
+			culling.cull( *light );
+
+			const auto& statistics = culling.getStatistics();
+
+			// Shadow tracer dispatches once per s_maxActorCount casters.
+			const int maxActorCount       = RaytracingShadowsComputeShader::s_maxActorCount;
+			const int dispatchCountBefore = ( statistics.casterCount + maxActorCount - 1 ) / maxActorCount;
+			const int dispatchCountAfter  = ( statistics.relevantCasterCount + maxActorCount - 1 ) / maxActorCount;
+
+			Logger::WriteMessage( (
+				std::string( light->getType() == Light::Type::SpotLight ? "Spot light" : "Point light" ) + ": " 
+				+ std::to_string( statistics.relevantCasterCount ) + " of " + std::to_string( statistics.casterCount ) + " casters (" 
+				+ std::to_string( statistics.receiverClusterCount ) + " receiver clusters), dispatches " 
+				+ std::to_string( dispatchCountAfter ) + " instead of " + std::to_string( dispatchCountBefore ) 
+				+ " (" + std::to_string( dispatchCountBefore - dispatchCountAfter ) + " saved)\n"
+			).c_str() );
+		}
+	}
+	};
+}
@@ -0,0 +1,240 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cmath>
+
+#include "SkeletonBlendTree.h"
+#include "SkeletonAnimation.h"
+#include "ScratchArena.h"
+#include "MathUtil.h"
+#include "Timer.h"
+
+using namespace Engine1;
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTests
+{
+	TEST_CLASS( SkeletonBlendTreeTests )
+	{
+	private:
+
+	// Bones swing around different axes - phase and amplitude make animations distinguishable.
+	static std::shared_ptr< SkeletonAnimation > createAnimation( const int boneCount, const int keyframeCount, const float phase, const float amplitude )
+	{
+		auto animation = std::make_shared< SkeletonAnimation >();
+
+		for ( int keyframe = 0; keyframe < keyframeCount; ++keyframe ) {
+			SkeletonPose& pose = animation->getOrAddPose( keyframe );
+
+			for ( int boneIndex = 1; boneIndex <= boneCount; ++boneIndex ) {
+				const float angle = amplitude * std::sin( keyframe * 0.1f + boneIndex + phase );
+
+				float3 axis( std::sin( (float)boneIndex ), std::cos( (float)boneIndex ), 0.5f );
+				axis.normalize();
+
+				const quat orientation( std::cos( angle * 0.5f ), axis.x * std::sin( angle * 0.5f ), axis.y * std::sin( angle * 0.5f ), axis.z * std::sin( angle * 0.5f ) );
+
+				pose.setBonePose( (unsigned char)boneIndex, orientation, float3( phase, 0.1f * boneIndex, amplitude ) );
+			}
+		}
+
+		return animation;
+	}
+
+	static void assertPosesAreEqual( const SkeletonPose& expectedPose, const SkeletonPose& pose )
+	{
+		Assert::AreEqual( (int)expectedPose.getBonesCount(), (int)pose.getBonesCount() );
+
+		for ( int i = 0; i < (int)expectedPose.getBonesCount(); ++i ) {
+			Assert::IsTrue( std::abs( quat::dot( expectedPose.getOrientations()[ i ], pose.getOrientations()[ i ] ) ) > 0.9999f );
+			Assert::IsTrue( MathUtil::areEqual( expectedPose.getTranslations()[ i ], pose.getTranslations()[ i ], 0.0f, 0.0001f ) );
+			Assert::IsTrue( MathUtil::areEqual( expectedPose.getScales()[ i ], pose.getScales()[ i ], 0.0f, 0.0001f ) );
+		}
+	}
+
+	public:
+
+	TEST_METHOD( SkeletonBlendTree_Lerp_Matches_Blending_Sampled_Poses )
+	{
+		const int boneCount = 30;
+
+		auto animation1 = createAnimation( boneCount, 50, 0.0f, 0.5f );
+		auto animation2 = createAnimation( boneCount, 80, 1.0f, 1.0f );
+
+		SkeletonBlendTree tree( boneCount );
+		const int clip1 = tree.addClip( animation1, 0 );
+		const int clip2 = tree.addClip( animation2, 1 );
+		tree.addLerp( clip1, clip2, 2 );
+
+		Assert::AreEqual( 3, tree.getParameterCount() );
+
+		const float  parameters[ 3 ] = { 0.3f, 0.7f, 0.25f };
+		SkeletonPose pose;
+		ScratchArena arena;
+		tree.evaluate( parameters, pose, arena );
+
+		const SkeletonPose expectedPose = SkeletonPose::blendPoses( animation1->getInterpolatedPose( 0.3f ), animation2->getInterpolatedPose( 0.7f ), 0.25f );
+		assertPosesAreEqual( expectedPose, pose );
+		Assert::AreEqual( tree.getScratchSize(), arena.getCapacity() );
+	}
+
+	TEST_METHOD( SkeletonBlendTree_Additive_And_Masked_Layers )
+	{
+		const int boneCount = 10;
+
+		auto baseAnimation     = createAnimation( boneCount, 20, 0.0f, 0.5f );
+		auto additiveAnimation = createAnimation( boneCount, 20, 2.0f, 0.8f );
+
+		// Adding the difference to the reference pose gives the additive pose.
+		SkeletonBlendTree additiveTree( boneCount );
+		const int reference = additiveTree.addClip( baseAnimation, 0 );
+		const int additive  = additiveTree.addClip( additiveAnimation, 0 );
+		additiveTree.addAdditive( reference, additive, reference, 1 );
+
+		const float  parameters[ 2 ] = { 0.5f, 1.0f };
+		SkeletonPose pose;
+		ScratchArena arena;
+		additiveTree.evaluate( parameters, pose, arena );
+
+		assertPosesAreEqual( additiveAnimation->getInterpolatedPose( 0.5f ), pose );
+
+		// Bones with zero weight keep the base pose, bones with full weight get the layer pose.
+		std::vector< float > boneWeights( boneCount, 0.0f );
+		std::fill( boneWeights.begin() + boneCount / 2, boneWeights.end(), 1.0f );
+
+		SkeletonBlendTree maskedTree( boneCount );
+		const int base  = maskedTree.addClip( baseAnimation, 0 );
+		const int layer = maskedTree.addClip( additiveAnimation, 0 );
+		maskedTree.addMaskedLayer( base, layer, boneWeights, 1 );
+
+		maskedTree.evaluate( parameters, pose, arena );
+
+		const SkeletonPose basePose  = baseAnimation->getInterpolatedPose( 0.5f );
+		const SkeletonPose layerPose = additiveAnimation->getInterpolatedPose( 0.5f );
+		for ( int i = 0; i < boneCount; ++i ) {
+			const SkeletonPose& expectedPose = i < boneCount / 2 ? basePose : layerPose;
+
+			Assert::IsTrue( MathUtil::areEqual( expectedPose.getTranslations()[ i ], pose.getTranslations()[ i ], 0.0f, 0.0001f ) );
+		}
+	}
+
+	TEST_METHOD( SkeletonBlendTree_Blend_Spaces )
+	{
+		const int boneCount = 10;
+
+		std::vector< std::shared_ptr< SkeletonAnimation > > animations;
+		for ( int i = 0; i < 4; ++i )
+			animations.push_back( createAnimation( boneCount, 20, (float)i, 0.5f ) );
+
+		SkeletonBlendTree tree( boneCount );
+		std::vector< int > clips;
+		for ( const auto& animation : animations )
+			clips.push_back( tree.addClip( animation, 0 ) );
+
+		// Unsorted 1D samples.
+		const int blendSpace1D = tree.addBlendSpace1D( { { 1.0f, clips[ 1 ] }, { 0.0f, clips[ 0 ] }, { 2.0f, clips[ 2 ] } }, 1 );
+		const int blendSpace2D = tree.addBlendSpace2D( { { float2( 0.0f, 0.0f ), clips[ 0 ] }, { float2( 1.0f, 0.0f ), clips[ 1 ] }, { float2( 0.0f, 1.0f ), clips[ 2 ] }, { float2( 1.0f, 1.0f ), clips[ 3 ] } }, 1, 2 );
+
+		SkeletonPose pose;
+		ScratchArena arena;
+
+		tree.setRootNode( blendSpace1D );
+		{
+			const float parameters[ 3 ] = { 0.5f, 1.5f, 0.0f };
+			tree.evaluate( parameters, pose, arena );
+			assertPosesAreEqual( SkeletonPose::blendPoses( animations[ 1 ]->getInterpolatedPose( 0.5f ), animations[ 2 ]->getInterpolatedPose( 0.5f ), 0.5f ), pose );
+		}
+
+		tree.setRootNode( blendSpace2D );
+		{
+			// Each sample has full weight at its position.
+			const float parameters[ 3 ] = { 0.5f, 1.0f, 1.0f };
+			tree.evaluate( parameters, pose, arena );
+			assertPosesAreEqual( animations[ 3 ]->getInterpolatedPose( 0.5f ), pose );
+		}
+		{
+			// Halfway between two samples.
+			const float parameters[ 3 ] = { 0.5f, 0.5f, 0.0f };
+			tree.evaluate( parameters, pose, arena );
+			Assert::AreEqual( 0.5f, pose.getTranslations()[ 0 ].x, 0.0001f );
+		}
+	}
+
+	TEST_METHOD( ScratchArena_Allocations_Are_Aligned_And_Bounded )
+	{
+		ScratchArena arena;
+		arena.reset( 64 );
+
+		char* memory1 = arena.allocate< char >( 3 );
+		const size_t marker = arena.getMarker();
+		float* memory2 = arena.allocate< float >( 5 );
+
+		Assert::IsTrue( reinterpret_cast< uintptr_t >( memory1 ) % ScratchArena::s_alignment == 0 );
+		Assert::IsTrue( reinterpret_cast< uintptr_t >( memory2 ) % ScratchArena::s_alignment == 0 );
+
+		arena.release( marker );
+		Assert::IsTrue( memory2 == arena.allocate< float >( 5 ) );
+
+		try {
+			arena.allocate< char >( 64 );
+		} catch ( ... ) {
+			return;
+		}
+
+		Assert::Fail( L"ScratchArena::allocate didn't throw an exception when the arena was full" );
+	}
+
+	TEST_METHOD( SkeletonBlendTree_Benchmark_Many_Characters )
+	{
+		const int boneCount = 60, characterCount = 2000, frameCount = 20;
+
+		std::vector< std::shared_ptr< SkeletonAnimation > > animations;
+		for ( int i = 0; i < 6; ++i )
+			animations.push_back( createAnimation( boneCount, 100, (float)i, 0.5f ) );
+
+		// Locomotion blend space with an additive lean and an upper body layer.
+		auto tree = std::make_shared< SkeletonBlendTree >( boneCount );
+		const int idle        = tree->addClip( animations[ 0 ], 0 );
+		const int walkForward = tree->addClip( animations[ 1 ], 0 );
+		const int walkLeft    = tree->addClip( animations[ 2 ], 0 );
+		const int walkRight   = tree->addClip( animations[ 3 ], 0 );
+		const int locomotion  = tree->addBlendSpace2D( { { float2( 0.0f, 0.0f ), idle }, { float2( 0.0f, 1.0f ), walkForward }, { float2( -1.0f, 0.0f ), walkLeft }, { float2( 1.0f, 0.0f ), walkRight } }, 1, 2 );
+		const int lean        = tree->addClip( animations[ 4 ], 0 );
+		const int leaning     = tree->addAdditive( locomotion, lean, idle, 3 );
+		const int aim         = tree->addClip( animations[ 5 ], 0 );
+
+		std::vector< float > upperBodyWeights( boneCount, 0.0f );
+		std::fill( upperBodyWeights.begin() + boneCount / 2, upperBodyWeights.end(), 1.0f );
+		tree->addMaskedLayer( leaning, aim, upperBodyWeights, 4 );
+
+		std::vector< SkeletonBlendTree::Instance > characters( characterCount, SkeletonBlendTree::Instance( tree ) );
+		for ( int i = 0; i < characterCount; ++i ) {
+			characters[ i ].parameters = { 0.0f, std::sin( (float)i ), std::cos( (float)i ) * 0.5f + 0.5f, 0.5f, 0.8f };
+		}
+
+		// First evaluation allocates the poses and the arenas.
+		SkeletonBlendTree::evaluate( characters );
+
+		const Timer startTime;
+		for ( int frame = 0; frame < frameCount; ++frame ) {
+			for ( auto& character : characters )
+				character.parameters[ 0 ] = frame / (float)frameCount;
+
+			SkeletonBlendTree::evaluate( characters );
+		}
+		const Timer endTime;
+
+		const double milliseconds = Timer::getElapsedTime( endTime, startTime ) / frameCount;
+
+		Logger::WriteMessage( (
+			"SkeletonBlendTree (" + std::to_string( boneCount ) + " bones, " + std::to_string( tree->getNodeCount() ) + " nodes): "
+			+ std::to_string( characterCount / milliseconds ) + " characters per ms\n"
+		).c_str() );
+
+		Assert::AreEqual( boneCount, (int)characters.back().pose.getBonesCount() );
+	}
+	};
+}
@@ -0,0 +1,253 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <vector>
+#include <tuple>
+#include <cmath>
+
+#include "SkeletonBoneBounds.h"
+#include "SkeletonSkinning.h"
+#include "SkeletonMesh.h"
+#include "SkeletonPose.h"
+#include "MathUtil.h"
+
+using namespace Engine1;
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTests
+{
+	TEST_CLASS( SkeletonBoneBoundsTests )
+	{
+	private:
+
+	static float43 createBonePose( const quat& orientation, const float3& translation )
+	{
+		float43 pose( orientation );
+		pose.setTranslation( translation );
+
+		return pose;
+	}
+
+	static quat createOrientation( const float w, const float x, const float y, const float z )
+	{
+		quat orientation( w, x, y, z );
+		orientation.normalize();
+
+		return orientation;
+	}
+
+	// Rotation around the Z axis.
+	static quat createRotationZ( const float angle )
+	{
+		return quat( std::cos( angle * 0.5f ), 0.0f, 0.0f, std::sin( angle * 0.5f ) );
+	}
+
+	static bool isInside( const float3& point, const BoundingBox& box )
+	{
+		const float epsilon = 0.0001f;
+
+		return point.x >= box.getMin().x - epsilon && point.y >= box.getMin().y - epsilon && point.z >= box.getMin().z - epsilon
+			&& point.x <= box.getMax().x + epsilon && point.y <= box.getMax().y + epsilon && point.z <= box.getMax().z + epsilon;
+	}
+
+	// Chain of three bones along the X axis - each bone has a ring of vertices (radius 0.2) in the middle of its segment
+	// and shares a ring with blended weights with the next bone at the joint.
+	static void createArmMesh( SkeletonMesh& mesh, const float43 bindPoses[ 3 ] )
+	{
+		mesh.addOrModifyBone( 1, "bone1", 0, bindPoses[ 0 ] );
+		mesh.addOrModifyBone( 2, "bone2", 1, bindPoses[ 1 ] );
+		mesh.addOrModifyBone( 3, "bone3", 2, bindPoses[ 2 ] );
+
+		const int ringVertexCount = 8;
+
+		for ( int ring = 0; ring < 5; ++ring ) {
+			for ( int i = 0; i < ringVertexCount; ++i ) {
+				const float angle = 2.0f * MathUtil::pi * i / ringVertexCount;
+
+				mesh.getVertices().push_back( float3( 0.5f + ring * 0.5f, 0.2f * std::cos( angle ), 0.2f * std::sin( angle ) ) );
+				mesh.getNormals().push_back( float3( 0.0f, std::cos( angle ), std::sin( angle ) ) );
+				mesh.getTangents().push_back( float3( 1.0f, 0.0f, 0.0f ) );
+			}
+		}
+
+		mesh.setBonesPerVertexCount( BonesPerVertexCount::Type::TWO );
+
+		for ( int ring = 0; ring < 5; ++ring ) {
+			for ( int i = 0; i < ringVertexCount; ++i ) {
+				const int vertexIndex = ring * ringVertexCount + i;
+
+				if ( ring % 2 == 0 ) {
+					mesh.attachVertexToBone( vertexIndex, (unsigned char)( ring / 2 + 1 ), 1.0f );
+				} else {
+					mesh.attachVertexToBone( vertexIndex, (unsigned char)( ring / 2 + 1 ), 0.5f );
+					mesh.attachVertexToBone( vertexIndex, (unsigned char)( ring / 2 + 2 ), 0.5f );
+				}
+			}
+		}
+
+		mesh.recalculateBoundingBox();
+	}
+
+	// Arm bent by 90 degrees at the second joint - the third bone points along the Y axis.
+	static SkeletonPose createBentArmPose()
+	{
+		SkeletonPose pose;
+		pose.setBonePose( 1, float43::IDENTITY );
+		pose.setBonePose( 2, float43::IDENTITY );
+		pose.setBonePose( 3, createBonePose( createRotationZ( MathUtil::pi * 0.5f ), float3( 2.0f, -2.0f, 0.0f ) ) );
+
+		return pose;
+	}
+
+	public:
+
+	TEST_METHOD( SkeletonBoneBounds_Contain_Skinned_Vertices )
+	{
+		const float43 bindPoses[ 3 ] = {
+			createBonePose( createRotationZ( 0.3f ), float3( 0.0f, 0.0f, 0.0f ) ),
+			createBonePose( createRotationZ( -0.5f ), float3( 1.0f, 0.0f, 0.0f ) ),
+			createBonePose( createOrientation( 0.9f, 0.1f, 0.3f, 0.2f ), float3( 2.0f, 0.1f, 0.0f ) )
+		};
+
+		SkeletonMesh mesh;
+		createArmMesh( mesh, bindPoses );
+
+		Assert::AreEqual( 3, (int)mesh.getBoneBoundingBoxes().size() );
+
+		SkeletonPose pose;
+		pose.setBonePose( 1, createBonePose( createOrientation( 0.8f, 0.2f, -0.1f, 0.4f ), float3( 0.5f, 1.0f, -0.3f ) ) );
+		pose.setBonePose( 2, createBonePose( createOrientation( 0.6f, -0.3f, 0.5f, 0.1f ), float3( -1.0f, 0.2f, 0.7f ) ) );
+		pose.setBonePose( 3, createBonePose( createOrientation( 0.2f, 0.7f, 0.1f, -0.6f ), float3( 0.3f, -0.4f, 2.0f ) ) );
+
+		SkeletonBoneBounds bounds;
+		Assert::IsTrue( bounds.update( mesh, pose ) );
+
+		std::vector< float3 > vertices, normals, tangents;
+		SkeletonSkinning::skin( mesh, pose, SkeletonSkinning::Mode::LinearBlend, vertices, normals, tangents );
+
+		const int bonesPerVertex = static_cast< int >( mesh.getBonesPerVertexCount() );
+
+		for ( int vertexIndex = 0; vertexIndex < (int)vertices.size(); ++vertexIndex ) {
+			Assert::IsTrue( isInside( vertices[ vertexIndex ], bounds.getBoundingBox() ) );
+
+			// Vertices are inside the boxes of all their bones - blended ones too.
+			for ( int i = 0; i < bonesPerVertex; ++i ) {
+				const unsigned char boneIndex = mesh.getVertexBones()[ vertexIndex * bonesPerVertex + i ];
+
+				if ( boneIndex != 0 && mesh.getVertexWeights()[ vertexIndex * bonesPerVertex + i ] > 0.0f )
+					Assert::IsTrue( isInside( vertices[ vertexIndex ], bounds.getBoneBoundingBox( boneIndex ) ) );
+			}
+		}
+
+		// Pose without all the bones of the mesh.
+		SkeletonPose incompletePose;
+		incompletePose.setBonePose( 1, float43::IDENTITY );
+
+		Assert::IsFalse( bounds.update( mesh, incompletePose ) );
+		Assert::IsTrue( bounds.isEmpty() );
+	}
+
+	TEST_METHOD( SkeletonBoneBounds_Contain_Blended_Vertices )
+	{
+		SkeletonMesh mesh;
+		mesh.addOrModifyBone( 1, "bone1", 0, float43::IDENTITY );
+		mesh.addOrModifyBone( 2, "bone2", 1, createBonePose( quat( 1.0f, 0.0f, 0.0f, 0.0f ), float3( 1.0f, 0.0f, 0.0f ) ) );
+
+		mesh.getVertices().push_back( float3( 0.5f, 0.0f, 0.0f ) );
+		mesh.getVertices().push_back( float3( 1.0f, 0.0f, 0.0f ) );
+		mesh.getVertices().push_back( float3( 1.5f, 0.0f, 0.0f ) );
+
+		for ( int i = 0; i < 3; ++i ) {
+			mesh.getNormals().push_back( float3( 0.0f, 1.0f, 0.0f ) );
+			mesh.getTangents().push_back( float3( 1.0f, 0.0f, 0.0f ) );
+		}
+
+		mesh.setBonesPerVertexCount( BonesPerVertexCount::Type::TWO );
+		mesh.attachVertexToBone( 0, 1, 1.0f );
+		mesh.attachVertexToBone( 1, 1, 0.5f );
+		mesh.attachVertexToBone( 1, 2, 0.5f );
+		mesh.attachVertexToBone( 2, 2, 1.0f );
+		mesh.recalculateBoundingBox();
+
+		// Second bone moved away from the first one - the blended vertex ends up halfway, outside of the rigidly moved vertices of both bones.
+		SkeletonPose pose;
+		pose.setBonePose( 1, float43::IDENTITY );
+		pose.setBonePose( 2, createBonePose( quat( 1.0f, 0.0f, 0.0f, 0.0f ), float3( 1.0f, 4.0f, 0.0f ) ) );
+
+		SkeletonBoneBounds bounds;
+		Assert::IsTrue( bounds.update( mesh, pose ) );
+
+		std::vector< float3 > vertices, normals, tangents;
+		SkeletonSkinning::skin( mesh, pose, SkeletonSkinning::Mode::LinearBlend, vertices, normals, tangents );
+
+		Assert::AreEqual( 2.0f, vertices[ 1 ].y, 0.0001f );
+		Assert::IsTrue( isInside( vertices[ 1 ], bounds.getBoneBoundingBox( 1 ) ) );
+		Assert::IsTrue( isInside( vertices[ 1 ], bounds.getBoneBoundingBox( 2 ) ) );
+
+		bool          hit       = false;
+		float         distance  = 0.0f;
+		unsigned char boneIndex = 0;
+
+		std::tie( hit, distance, boneIndex ) = bounds.intersectRay( vertices[ 1 ] + float3( 0.0f, 0.0f, 10.0f ), float3( 0.0f, 0.0f, -1.0f ) );
+		Assert::IsTrue( hit );
+		Assert::AreEqual( 10.0f, distance, 0.0001f );
+	}
+
+	TEST_METHOD( SkeletonBoneBounds_Ray_Hits_The_Closest_Bone )
+	{
+		const float43 bindPoses[ 3 ] = { float43::IDENTITY, float43::IDENTITY, float43::IDENTITY };
+
+		SkeletonMesh mesh;
+		createArmMesh( mesh, bindPoses );
+
+		SkeletonBoneBounds bounds;
+		Assert::IsTrue( bounds.update( mesh, createBentArmPose() ) );
+
+		bool          hit       = false;
+		float         distance  = 0.0f;
+		unsigned char boneIndex = 0;
+
+		// Third bone in its new place - along the Y axis from the second joint. Box of the second bone contains it too
+		// (they share the blended vertices), so any of them can be reported.
+		std::tie( hit, distance, boneIndex ) = bounds.intersectRay( float3( 2.0f, 0.4f, 10.0f ), float3( 0.0f, 0.0f, -1.0f ) );
+		Assert::IsTrue( hit );
+		Assert::IsTrue( boneIndex == 2 || boneIndex == 3 );
+		Assert::AreEqual( 9.8f, distance, 0.0001f );
+
+		// Ray along the arm hits the first bone first (or the second one, containing the first one's blended vertices).
+		std::tie( hit, distance, boneIndex ) = bounds.intersectRay( float3( -10.0f, 0.0f, 0.0f ), float3( 1.0f, 0.0f, 0.0f ) );
+		Assert::IsTrue( hit );
+		Assert::IsTrue( boneIndex == 1 || boneIndex == 2 );
+		Assert::AreEqual( 10.5f, distance, 0.0001f );
+
+		// Place of the third bone in the bind pose is empty now - although it's still inside the mesh's bounding box.
+		std::tie( hit, distance, boneIndex ) = bounds.intersectRay( float3( 2.4f, 0.0f, 10.0f ), float3( 0.0f, 0.0f, -1.0f ) );
+		Assert::IsFalse( hit );
+
+		std::tie( hit, distance ) = MathUtil::intersectRayWithBoundingBox( float3( 2.4f, 0.0f, 10.0f ), float3( 0.0f, 0.0f, -1.0f ), mesh.getBoundingBox() );
+		Assert::IsTrue( hit );
+
+		// Hits further than the max distance are ignored.
+		std::tie( hit, distance, boneIndex ) = bounds.intersectRay( float3( 2.0f, 0.4f, 10.0f ), float3( 0.0f, 0.0f, -1.0f ), 5.0f );
+		Assert::IsFalse( hit );
+	}
+
+	TEST_METHOD( SkeletonBoneBounds_Intersect_Box_In_World_Space )
+	{
+		const float43 bindPoses[ 3 ] = { float43::IDENTITY, float43::IDENTITY, float43::IDENTITY };
+
+		SkeletonMesh mesh;
+		createArmMesh( mesh, bindPoses );
+
+		SkeletonBoneBounds bounds;
+		Assert::IsTrue( bounds.update( mesh, createBentArmPose() ) );
+
+		float43 actorPose = float43::IDENTITY;
+		actorPose.setTranslation( float3( 0.0f, 0.0f, 5.0f ) );
+
+		Assert::IsTrue( bounds.intersects( BoundingBox( float3( 1.9f, 0.3f, 4.9f ), float3( 2.1f, 0.4f, 5.1f ) ), actorPose ) );
+		Assert::IsFalse( bounds.intersects( BoundingBox( float3( 2.3f, -0.1f, 4.9f ), float3( 2.45f, 0.1f, 5.1f ) ), actorPose ) );
+		Assert::IsFalse( bounds.intersects( BoundingBox( float3( 1.9f, 0.3f, -0.1f ), float3( 2.1f, 0.4f, 0.1f ) ), actorPose ) );
+	}
+	};
+}
@@ -0,0 +1,220 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <vector>
+#include <string>
+#include <random>
+#include <algorithm>
+#include <cmath>
+
+#include "SkeletonPoseMath.h"
+#include "SkeletonPose.h"
+#include "MathUtil.h"
+#include "float43.h"
+#include "Timer.h"
+
+using namespace Engine1;
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTests
+{
+	TEST_CLASS( SkeletonPoseMathTests )
+	{
+	private:
+
+	static quat createRandomOrientation( std::mt19937& random )
+	{
+		std::uniform_real_distribution< float > distribution( -1.0f, 1.0f );
+
+		quat orientation( distribution( random ), distribution( random ), distribution( random ), distribution( random ) );
+		orientation.normalize();
+
+		return orientation;
+	}
+
+	static float3 createRandomVector( std::mt19937& random, const float min, const float max )
+	{
+		std::uniform_real_distribution< float > distribution( min, max );
+
+		return float3( distribution( random ), distribution( random ), distribution( random ) );
+	}
+
+	// Angle between the rotations represented by the quaternions (in radians).
+	static float getAngle( const quat& q1, const quat& q2 )
+	{
+		return 2.0f * std::acos( std::min( 1.0f, std::abs( quat::dot( q1, q2 ) ) ) );
+	}
+
+	// Compares quaternions representing the same rotation (q and -q are equal).
+	static bool areEqual( const quat& q1, const quat& q2, const float tolerance )
+	{
+		const float sign = quat::dot( q1, q2 ) < 0.0f ? -1.0f : 1.0f;
+
+		return std::abs( q1.w - q2.w * sign ) <= tolerance && std::abs( q1.x - q2.x * sign ) <= tolerance
+			&& std::abs( q1.y - q2.y * sign ) <= tolerance && std::abs( q1.z - q2.z * sign ) <= tolerance;
+	}
+
+	static bool areEqual( const float43& matrix1, const float43& matrix2, const float tolerance )
+	{
+		return MathUtil::areEqual( matrix1.getRow1(), matrix2.getRow1(), 0.0f, tolerance )
+			&& MathUtil::areEqual( matrix1.getRow2(), matrix2.getRow2(), 0.0f, tolerance )
+			&& MathUtil::areEqual( matrix1.getRow3(), matrix2.getRow3(), 0.0f, tolerance )
+			&& MathUtil::areEqual( matrix1.getTranslation(), matrix2.getTranslation(), 0.0f, tolerance );
+	}
+
+	public:
+
+	TEST_METHOD( SkeletonPoseMath_Slerp_Matches_Scalar_Slerp )
+	{
+		// Odd count - covers both the batched loop and the remainder.
+		const int count = 1003;
+
+		std::mt19937 random( 1 );
+
+		std::vector< quat > from, to;
+		for ( int i = 0; i < count; ++i ) {
+			from.push_back( createRandomOrientation( random ) );
+			to.push_back( createRandomOrientation( random ) );
+		}
+
+		for ( const float factor : { 0.0f, 0.1f, 0.33f, 0.5f, 0.9f, 1.0f } ) {
+			std::vector< quat > result( count );
+			SkeletonPoseMath::slerp( from.data(), to.data(), factor, result.data(), count );
+
+			for ( int i = 0; i < count; ++i ) {
+				Assert::IsTrue( areEqual( result[ i ], quat::slerp( from[ i ], to[ i ], factor ), 0.0005f ) );
+				Assert::AreEqual( 1.0f, quat::dot( result[ i ], result[ i ] ), 0.0001f );
+			}
+		}
+	}
+
+	TEST_METHOD( SkeletonPoseMath_Nlerp_Takes_Shorter_Arc )
+	{
+		const quat from( 1.0f, 0.0f, 0.0f, 0.0f );
+		const quat to( -0.9f, 0.0f, -0.43589f, 0.0f ); // Same rotation as ( 0.9, 0, 0.43589, 0 ).
+
+		std::vector< quat > fromArray( 5, from ), toArray( 5, to ), result( 5 );
+		SkeletonPoseMath::nlerp( fromArray.data(), toArray.data(), 0.5f, result.data(), 5 );
+
+		for ( const quat& orientation : result ) {
+			Assert::IsTrue( orientation.w > 0.9f );
+			Assert::AreEqual( 1.0f, quat::dot( orientation, orientation ), 0.0001f );
+			Assert::IsTrue( std::abs( getAngle( from, orientation ) - 0.5f * getAngle( from, to ) ) < 0.01f );
+		}
+	}
+
+	TEST_METHOD( SkeletonPoseMath_Lerp )
+	{
+		const int count = 7;
+
+		std::mt19937 random( 2 );
+
+		std::vector< float3 > from, to, result( count );
+		for ( int i = 0; i < count; ++i ) {
+			from.push_back( createRandomVector( random, -10.0f, 10.0f ) );
+			to.push_back( createRandomVector( random, -10.0f, 10.0f ) );
+		}
+
+		SkeletonPoseMath::lerp( from.data(), to.data(), 0.25f, result.data(), count );
+
+		for ( int i = 0; i < count; ++i )
+			Assert::IsTrue( MathUtil::areEqual( from[ i ] * 0.75f + to[ i ] * 0.25f, result[ i ], 0.0f, 0.0001f ) );
+	}
+
+	TEST_METHOD( SkeletonPoseMath_Matrices_Match_Scalar_Concatenation )
+	{
+		const int boneCount = 63;
+
+		std::mt19937 random( 3 );
+
+		// Each bone's parent has a lower index - the identity order lists parents first.
+		std::vector< unsigned char > parentBoneIndices, order;
+		std::vector< quat >          orientations;
+		std::vector< float3 >        translations, scales;
+		for ( int i = 0; i < boneCount; ++i ) {
+			parentBoneIndices.push_back( i == 0 ? 0 : (unsigned char)( 1 + random() % i ) );
+			order.push_back( (unsigned char)( i + 1 ) );
+
+			orientations.push_back( createRandomOrientation( random ) );
+			translations.push_back( createRandomVector( random, -1.0f, 1.0f ) );
+			scales.push_back( createRandomVector( random, 0.8f, 1.2f ) );
+		}
+
+		std::vector< float43 > matricesInParentSpace( boneCount ), matricesInSkeletonSpace( boneCount );
+		SkeletonPoseMath::composeMatrices( orientations.data(), translations.data(), scales.data(), matricesInParentSpace.data(), boneCount );
+		SkeletonPoseMath::concatenateParentChain( matricesInParentSpace.data(), parentBoneIndices.data(), order.data(), boneCount, matricesInSkeletonSpace.data() );
+
+		std::vector< float43 > expected( boneCount );
+		for ( int i = 0; i < boneCount; ++i ) {
+			float43 matrix( orientations[ i ] );
+			matrix.scale( scales[ i ] );
+			matrix.setTranslation( translations[ i ] );
+
+			Assert::IsTrue( areEqual( matrix, matricesInParentSpace[ i ], 0.00001f ) );
+
+			expected[ i ] = parentBoneIndices[ i ] == 0 ? matrix : matrix * expected[ parentBoneIndices[ i ] - 1 ];
+
+			Assert::IsTrue( areEqual( expected[ i ], matricesInSkeletonSpace[ i ], 0.0001f * std::max( 1.0f, expected[ i ].getTranslation().length() ) ) );
+		}
+	}
+
+	TEST_METHOD( SkeletonPoseMath_Benchmark_Skeletons_Per_Frame )
+	{
+		const int skeletonCount = 2000, boneCount = 64;
+
+		std::mt19937 random( 4 );
+
+		std::vector< unsigned char > parentBoneIndices, order;
+		for ( int i = 0; i < boneCount; ++i ) {
+			parentBoneIndices.push_back( i == 0 ? 0 : (unsigned char)( 1 + random() % i ) );
+			order.push_back( (unsigned char)( i + 1 ) );
+		}
+
+		// Two keyframes per skeleton.
+		std::vector< SkeletonPose > poses1( skeletonCount ), poses2( skeletonCount );
+		for ( int s = 0; s < skeletonCount; ++s ) {
+			for ( int i = 0; i < boneCount; ++i ) {
+				poses1[ s ].setBonePose( (unsigned char)( i + 1 ), createRandomOrientation( random ), createRandomVector( random, -1.0f, 1.0f ) );
+				poses2[ s ].setBonePose( (unsigned char)( i + 1 ), createRandomOrientation( random ), createRandomVector( random, -1.0f, 1.0f ) );
+			}
+		}
+
+		// Scalar path - slerp of matrices and matrix multiplication, bone by bone.
+		std::vector< float43 > matrices1, matrices2, scalarResult( boneCount );
+		const Timer scalarStartTime;
+		for ( int s = 0; s < skeletonCount; ++s ) {
+			poses1[ s ].getBonePoses( matrices1 );
+			poses2[ s ].getBonePoses( matrices2 );
+
+			for ( int i = 0; i < boneCount; ++i ) {
+				const float43 local = float43::slerp( matrices1[ i ], matrices2[ i ], 0.3f );
+				scalarResult[ i ] = parentBoneIndices[ i ] == 0 ? local : local * scalarResult[ parentBoneIndices[ i ] - 1 ];
+			}
+		}
+		const Timer scalarEndTime;
+
+		// Batched kernels.
+		std::vector< float43 > matricesInParentSpace, result( boneCount );
+		for ( int s = 0; s < skeletonCount; ++s ) {
+			const SkeletonPose blendedPose = SkeletonPose::blendPoses( poses1[ s ], poses2[ s ], 0.3f );
+
+			blendedPose.getBonePoses( matricesInParentSpace );
+			SkeletonPoseMath::concatenateParentChain( matricesInParentSpace.data(), parentBoneIndices.data(), order.data(), boneCount, result.data() );
+		}
+		const Timer endTime;
+
+		const double scalarTime = Timer::getElapsedTime( scalarEndTime, scalarStartTime );
+		const double time       = Timer::getElapsedTime( endTime, scalarEndTime );
+
+		Logger::WriteMessage( (
+			"Blend and concatenate " + std::to_string( skeletonCount ) + " skeletons (" + std::to_string( boneCount ) + " bones): "
+			+ std::to_string( time ) + " ms, " + std::to_string( skeletonCount * 16.6 / time ) + " skeletons per 16.6 ms frame"
+			+ " (scalar: " + std::to_string( scalarTime ) + " ms, " + std::to_string( skeletonCount * 16.6 / scalarTime ) + " skeletons per frame)\n"
+		).c_str() );
+
+		// Both paths evaluated the same poses for the last skeleton.
+		for ( int i = 0; i < boneCount; ++i )
+			Assert::IsTrue( areEqual( scalarResult[ i ], result[ i ], 0.01f * std::max( 1.0f, scalarResult[ i ].getTranslation().length() ) ) );
+	}
+	};
+}
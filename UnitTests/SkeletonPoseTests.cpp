@@ -0,0 +1,230 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <cmath>
+
+#include "SkeletonPose.h"
+#include "SkeletonMesh.h"
+#include "MathUtil.h"
+#include "Timer.h"
+
+using namespace Engine1;
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTests
+{
+	TEST_CLASS( SkeletonPoseTests )
+	{
+	private:
+
+	// Creates a skeleton where parents have random (also higher) indices than their children.
+	static void createRandomSkeleton( SkeletonMesh& mesh, const int boneCount, std::mt19937& random )
+	{
+		std::vector< int > order( boneCount );
+		std::iota( order.begin(), order.end(), 1 );
+		std::shuffle( order.begin(), order.end(), random );
+
+		for ( int i = 0; i < boneCount; ++i ) {
+			// Each bone's parent is one of the bones before it in the shuffled order.
+			const unsigned char parentBoneIndex = i == 0 ? 0 : (unsigned char)order[ random() % i ];
+
+			mesh.addOrModifyBone( (unsigned char)order[ i ], "bone" + std::to_string( order[ i ] ), parentBoneIndex, float43::IDENTITY );
+		}
+	}
+
+	static float43 createRandomBonePose( std::mt19937& random )
+	{
+		std::uniform_real_distribution< float > distribution( -1.0f, 1.0f );
+
+		quat orientation( distribution( random ), distribution( random ), distribution( random ), distribution( random ) );
+		orientation.normalize();
+
+		const float scale = 1.0f + 0.25f * distribution( random );
+
+		float43 pose( orientation );
+		pose.scale( float3( scale, scale, scale ) );
+		pose.setTranslation( float3( distribution( random ), distribution( random ), distribution( random ) ) );
+
+		return pose;
+	}
+
+	static bool areEqual( const float43& pose1, const float43& pose2, const float tolerance )
+	{
+		return MathUtil::areEqual( pose1.getRow1(), pose2.getRow1(), 0.0f, tolerance )
+			&& MathUtil::areEqual( pose1.getRow2(), pose2.getRow2(), 0.0f, tolerance )
+			&& MathUtil::areEqual( pose1.getRow3(), pose2.getRow3(), 0.0f, tolerance )
+			&& MathUtil::areEqual( pose1.getTranslation(), pose2.getTranslation(), 0.0f, tolerance );
+	}
+
+	// Skeleton-space evaluation done the way it was before the hierarchy order was precomputed -
+	// sweeps over the bones (with a linear search for each pose) until all parents are resolved.
+	static std::vector< float43 > calculatePoseInSkeletonSpaceReference( const std::vector< float43 >& poseInParentSpace, const SkeletonMesh& mesh )
+	{
+		const int boneCount = (int)poseInParentSpace.size();
+
+		std::vector< std::pair< unsigned char, float43 > > calculated;
+		auto find = [ &calculated ]( const unsigned char boneIndex ) -> const float43* {
+			for ( const auto& bone : calculated ) {
+				if ( bone.first == boneIndex )
+					return &bone.second;
+			}
+			return nullptr;
+		};
+
+		while ( (int)calculated.size() < boneCount ) {
+			for ( int boneIndex = 1; boneIndex <= boneCount; ++boneIndex ) {
+				if ( find( (unsigned char)boneIndex ) )
+					continue;
+
+				const unsigned char parentBoneIndex = mesh.getBone( (unsigned char)boneIndex ).getParentBoneIndex();
+				if ( parentBoneIndex == 0 )
+					calculated.emplace_back( (unsigned char)boneIndex, poseInParentSpace[ boneIndex - 1 ] );
+				else if ( const float43* parentPose = find( parentBoneIndex ) )
+					calculated.emplace_back( (unsigned char)boneIndex, poseInParentSpace[ boneIndex - 1 ] * *parentPose );
+			}
+		}
+
+		std::vector< float43 > poseInSkeletonSpace( boneCount );
+		for ( const auto& bone : calculated )
+			poseInSkeletonSpace[ bone.first - 1 ] = bone.second;
+
+		return poseInSkeletonSpace;
+	}
+
+	public:
+
+	TEST_METHOD( SkeletonPose_Hierarchy_Order_Visits_Parents_First )
+	{
+		std::mt19937 random( 1 );
+
+		SkeletonMesh mesh;
+		createRandomSkeleton( mesh, 255, random );
+
+		const std::vector< unsigned char >& order = mesh.getBonesInHierarchyOrder();
+		Assert::AreEqual( 255, (int)order.size() );
+
+		std::vector< bool > visited( 256, false );
+		for ( const unsigned char boneIndex : order ) {
+			const unsigned char parentBoneIndex = mesh.getParentBoneIndices()[ boneIndex - 1 ];
+
+			Assert::IsTrue( parentBoneIndex == 0 || visited[ parentBoneIndex ] );
+			Assert::IsFalse( visited[ boneIndex ] );
+
+			visited[ boneIndex ] = true;
+		}
+	}
+
+	TEST_METHOD( SkeletonPose_Skeleton_Space_Matches_Matrix_Reference )
+	{
+		std::mt19937 random( 2 );
+
+		SkeletonMesh mesh;
+		createRandomSkeleton( mesh, 60, random );
+
+		std::vector< float43 > bonePoses;
+		SkeletonPose           poseInParentSpace;
+		for ( unsigned char boneIndex = 1; boneIndex <= 60; ++boneIndex ) {
+			bonePoses.push_back( createRandomBonePose( random ) );
+			poseInParentSpace.setBonePose( boneIndex, bonePoses.back() );
+		}
+
+		const std::vector< float43 > expected            = calculatePoseInSkeletonSpaceReference( bonePoses, mesh );
+		const SkeletonPose           poseInSkeletonSpace = SkeletonPose::calculatePoseInSkeletonSpace( poseInParentSpace, mesh );
+
+		Assert::AreEqual( 60, (int)poseInSkeletonSpace.getBonesCount() );
+
+		for ( unsigned char boneIndex = 1; boneIndex <= 60; ++boneIndex ) {
+			// Chains are deep, so errors accumulate - use tolerance relative to the scale of the poses.
+			const float tolerance = 0.001f * std::max( 1.0f, expected[ boneIndex - 1 ].getTranslation().length() );
+			Assert::IsTrue( areEqual( poseInSkeletonSpace.getBonePose( boneIndex ), expected[ boneIndex - 1 ], tolerance ) );
+		}
+
+		// Converting back to parent space should restore the original poses.
+		const SkeletonPose restoredPoseInParentSpace = SkeletonPose::calculatePoseInParentSpace( poseInSkeletonSpace, mesh );
+		for ( unsigned char boneIndex = 1; boneIndex <= 60; ++boneIndex )
+			Assert::IsTrue( areEqual( restoredPoseInParentSpace.getBonePose( boneIndex ), bonePoses[ boneIndex - 1 ], 0.01f ) );
+	}
+
+	TEST_METHOD( SkeletonPose_Blend_Keeps_Bones_Present_In_One_Pose )
+	{
+		SkeletonPose pose1, pose2;
+		pose1.setBonePose( 1, float43::IDENTITY );
+		pose1.setBonePose( 3, float43::IDENTITY );
+
+		float43 translated( float43::IDENTITY );
+		translated.setTranslation( float3( 2.0f, 0.0f, 0.0f ) );
+		pose2.setBonePose( 1, translated );
+		pose2.setBonePose( 7, translated );
+
+		const SkeletonPose blendedPose = SkeletonPose::blendPoses( pose1, pose2, 0.25f );
+
+		Assert::AreEqual( 3, (int)blendedPose.getBonesCount() );
+		Assert::IsTrue( blendedPose.hasBone( 1 ) && blendedPose.hasBone( 3 ) && blendedPose.hasBone( 7 ) );
+		Assert::IsFalse( blendedPose.hasBone( 2 ) );
+
+		Assert::IsTrue( MathUtil::areEqual( float3( 0.5f, 0.0f, 0.0f ), blendedPose.getBonePose( 1 ).getTranslation() ) );
+		Assert::IsTrue( MathUtil::areEqual( float3( 2.0f, 0.0f, 0.0f ), blendedPose.getBonePose( 7 ).getTranslation() ) );
+	}
+
+	TEST_METHOD( SkeletonPose_Missing_Parent )
+	{
+		SkeletonMesh mesh;
+		mesh.addOrModifyBone( 1, "root", 0, float43::IDENTITY );
+		mesh.addOrModifyBone( 2, "child", 1, float43::IDENTITY );
+
+		SkeletonPose poseInParentSpace;
+		poseInParentSpace.setBonePose( 2, float43::IDENTITY );
+
+		try {
+			SkeletonPose::calculatePoseInSkeletonSpace( poseInParentSpace, mesh );
+		} catch ( ... ) {
+			return;
+		}
+
+		Assert::Fail( L"SkeletonPose::calculatePoseInSkeletonSpace didn't throw an exception for a bone without parent pose" );
+	}
+
+	TEST_METHOD( SkeletonPose_Benchmark_Poses_Per_Second )
+	{
+		const int boneCount = 255, iterationCount = 2000, referenceIterationCount = 20;
+
+		std::mt19937 random( 3 );
+
+		SkeletonMesh mesh;
+		createRandomSkeleton( mesh, boneCount, random );
+
+		std::vector< float43 > bonePoses;
+		SkeletonPose           poseInParentSpace;
+		for ( int boneIndex = 1; boneIndex <= boneCount; ++boneIndex ) {
+			bonePoses.push_back( createRandomBonePose( random ) );
+			poseInParentSpace.setBonePose( (unsigned char)boneIndex, bonePoses.back() );
+		}
+
+		const Timer startTime;
+		SkeletonPose poseInSkeletonSpace;
+		for ( int i = 0; i < iterationCount; ++i )
+			poseInSkeletonSpace = SkeletonPose::calculatePoseInSkeletonSpace( poseInParentSpace, mesh );
+		const Timer endTime;
+
+		std::vector< float43 > referencePose;
+		for ( int i = 0; i < referenceIterationCount; ++i )
+			referencePose = calculatePoseInSkeletonSpaceReference( bonePoses, mesh );
+		const Timer referenceEndTime;
+
+		const double posesPerSecond          = iterationCount / ( Timer::getElapsedTime( endTime, startTime ) / 1000.0 );
+		const double referencePosesPerSecond = referenceIterationCount / ( Timer::getElapsedTime( referenceEndTime, endTime ) / 1000.0 );
+
+		Logger::WriteMessage( (
+			"Skeleton space evaluation (" + std::to_string( boneCount ) + " bones): " + std::to_string( posesPerSecond ) + " poses/s"
+			+ " (repeated sweeps with linear search: " + std::to_string( referencePosesPerSecond ) + " poses/s)\n"
+		).c_str() );
+
+		Assert::AreEqual( boneCount, (int)poseInSkeletonSpace.getBonesCount() );
+	}
+	};
+}
@@ -0,0 +1,190 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <vector>
+#include <string>
+#include <random>
+#include <cmath>
+
+#include "SkeletonSkinning.h"
+#include "SkeletonMesh.h"
+#include "SkeletonPose.h"
+#include "MathUtil.h"
+#include "float33.h"
+#include "Timer.h"
+
+using namespace Engine1;
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTests
+{
+	TEST_CLASS( SkeletonSkinningTests )
+	{
+	private:
+
+	static float43 createBonePose( const quat& orientation, const float3& translation )
+	{
+		float43 pose( orientation );
+		pose.setTranslation( translation );
+
+		return pose;
+	}
+
+	// Rotation around the X axis.
+	static quat createTwist( const float angle )
+	{
+		return quat( std::cos( angle * 0.5f ), std::sin( angle * 0.5f ), 0.0f, 0.0f );
+	}
+
+	// Two bones along the X axis. Vertices form a ring around the axis at x = 1, half attached to each bone.
+	static void createTwoBoneMesh( SkeletonMesh& mesh, const int vertexCount )
+	{
+		mesh.addOrModifyBone( 1, "bone1", 0, float43::IDENTITY );
+		mesh.addOrModifyBone( 2, "bone2", 1, float43::IDENTITY );
+
+		for ( int i = 0; i < vertexCount; ++i ) {
+			const float angle = 2.0f * MathUtil::pi * i / vertexCount;
+
+			mesh.getVertices().push_back( float3( 1.0f, std::cos( angle ), std::sin( angle ) ) );
+			mesh.getNormals().push_back( float3( 0.0f, std::cos( angle ), std::sin( angle ) ) );
+			mesh.getTangents().push_back( float3( 1.0f, 0.0f, 0.0f ) );
+		}
+
+		mesh.setBonesPerVertexCount( BonesPerVertexCount::Type::TWO );
+
+		for ( int i = 0; i < vertexCount; ++i ) {
+			mesh.attachVertexToBone( i, 1, 0.5f );
+			mesh.attachVertexToBone( i, 2, 0.5f );
+		}
+	}
+
+	public:
+
+	TEST_METHOD( SkeletonSkinning_Rigid_Vertices_Follow_The_Bone )
+	{
+		SkeletonMesh mesh;
+		mesh.addOrModifyBone( 1, "bone1", 0, float43::IDENTITY );
+		mesh.getVertices() = { float3( 1.0f, 0.0f, 0.0f ), float3( 0.0f, 2.0f, 0.0f ), float3( 0.5f, 0.5f, 3.0f ) };
+		mesh.getNormals()  = { float3( 0.0f, 1.0f, 0.0f ), float3( 1.0f, 0.0f, 0.0f ), float3( 0.0f, 0.0f, 1.0f ) };
+		mesh.getTangents() = { float3( 1.0f, 0.0f, 0.0f ), float3( 0.0f, 1.0f, 0.0f ), float3( 0.0f, 1.0f, 0.0f ) };
+		mesh.setBonesPerVertexCount( BonesPerVertexCount::Type::FOUR );
+
+		for ( int i = 0; i < 3; ++i )
+			mesh.attachVertexToBone( i, 1, 1.0f );
+
+		quat orientation( 0.3f, 0.5f, -0.2f, 0.7f );
+		orientation.normalize();
+
+		const float43 bonePose = createBonePose( orientation, float3( 1.0f, -2.0f, 0.5f ) );
+
+		SkeletonPose pose;
+		pose.setBonePose( 1, bonePose );
+
+		for ( const SkeletonSkinning::Mode mode : { SkeletonSkinning::Mode::LinearBlend, SkeletonSkinning::Mode::DualQuaternion } ) {
+			std::vector< float3 > vertices, normals, tangents;
+			SkeletonSkinning::skin( mesh, pose, mode, vertices, normals, tangents );
+
+			Assert::AreEqual( 3, (int)vertices.size() );
+			Assert::AreEqual( 3, (int)normals.size() );
+
+			for ( int i = 0; i < 3; ++i ) {
+				Assert::IsTrue( MathUtil::areEqual( mesh.getVertices()[ i ] * bonePose, vertices[ i ], 0.0f, 0.0001f ) );
+				Assert::IsTrue( MathUtil::areEqual( mesh.getNormals()[ i ] * bonePose.getOrientation(), normals[ i ], 0.0f, 0.0001f ) );
+				Assert::IsTrue( MathUtil::areEqual( mesh.getTangents()[ i ] * bonePose.getOrientation(), tangents[ i ], 0.0f, 0.0001f ) );
+			}
+		}
+	}
+
+	TEST_METHOD( SkeletonSkinning_Dual_Quaternion_Preserves_Volume_Of_Twisted_Joint )
+	{
+		SkeletonMesh mesh;
+		createTwoBoneMesh( mesh, 16 );
+
+		// Second bone twisted by 160 degrees around its axis.
+		SkeletonPose pose;
+		pose.setBonePose( 1, float43::IDENTITY );
+		pose.setBonePose( 2, createBonePose( createTwist( MathUtil::degreesToRadians( 160.0f ) ), float3::ZERO ) );
+
+		std::vector< float3 > linearBlendVertices, dualQuaternionVertices, normals, tangents;
+		SkeletonSkinning::skin( mesh, pose, SkeletonSkinning::Mode::LinearBlend, linearBlendVertices, normals, tangents );
+		SkeletonSkinning::skin( mesh, pose, SkeletonSkinning::Mode::DualQuaternion, dualQuaternionVertices, normals, tangents );
+
+		for ( int i = 0; i < 16; ++i ) {
+			const float linearBlendRadius    = std::sqrt( linearBlendVertices[ i ].y * linearBlendVertices[ i ].y + linearBlendVertices[ i ].z * linearBlendVertices[ i ].z );
+			const float dualQuaternionRadius = std::sqrt( dualQuaternionVertices[ i ].y * dualQuaternionVertices[ i ].y + dualQuaternionVertices[ i ].z * dualQuaternionVertices[ i ].z );
+
+			// Linear blending collapses the ring towards the axis (candy-wrapper), dual quaternions keep its radius.
+			Assert::IsTrue( linearBlendRadius < 0.2f );
+			Assert::AreEqual( 1.0f, dualQuaternionRadius, 0.001f );
+			Assert::AreEqual( 1.0f, dualQuaternionVertices[ i ].x, 0.001f );
+		}
+	}
+
+	TEST_METHOD( SkeletonSkinning_Missing_Bone_Pose )
+	{
+		SkeletonMesh mesh;
+		createTwoBoneMesh( mesh, 4 );
+
+		SkeletonPose pose;
+		pose.setBonePose( 1, float43::IDENTITY );
+
+		std::vector< float3 > vertices, normals, tangents;
+		try {
+			SkeletonSkinning::skin( mesh, pose, SkeletonSkinning::Mode::LinearBlend, vertices, normals, tangents );
+		} catch ( ... ) {
+			return;
+		}
+
+		Assert::Fail( L"SkeletonSkinning::skin didn't throw an exception for a pose without all the bones" );
+	}
+
+	TEST_METHOD( SkeletonSkinning_Benchmark_Vertices_Per_Second )
+	{
+		const int vertexCount = 200000, boneCount = 64, iterationCount = 10;
+
+		std::mt19937                            random( 1 );
+		std::uniform_real_distribution< float > distribution( -1.0f, 1.0f );
+
+		SkeletonMesh mesh;
+		SkeletonPose pose;
+		for ( int boneIndex = 1; boneIndex <= boneCount; ++boneIndex ) {
+			mesh.addOrModifyBone( (unsigned char)boneIndex, "bone" + std::to_string( boneIndex ), 0, float43::IDENTITY );
+
+			quat orientation( distribution( random ), distribution( random ), distribution( random ), distribution( random ) );
+			orientation.normalize();
+
+			pose.setBonePose( (unsigned char)boneIndex, createBonePose( orientation, float3( distribution( random ), distribution( random ), distribution( random ) ) ) );
+		}
+
+		for ( int i = 0; i < vertexCount; ++i ) {
+			mesh.getVertices().push_back( float3( distribution( random ), distribution( random ), distribution( random ) ) );
+			mesh.getNormals().push_back( float3( 0.0f, 1.0f, 0.0f ) );
+			mesh.getTangents().push_back( float3( 1.0f, 0.0f, 0.0f ) );
+		}
+
+		mesh.setBonesPerVertexCount( BonesPerVertexCount::Type::FOUR );
+		for ( int i = 0; i < vertexCount; ++i ) {
+			for ( int j = 0; j < 4; ++j )
+				mesh.attachVertexToBone( i, (unsigned char)( 1 + ( i + j * 7 ) % boneCount ), 0.4f - j * 0.1f );
+		}
+
+		std::vector< float3 > vertices, normals, tangents;
+
+		std::string message = "CPU skinning (" + std::to_string( vertexCount ) + " vertices, 4 bones per vertex):";
+		for ( const SkeletonSkinning::Mode mode : { SkeletonSkinning::Mode::LinearBlend, SkeletonSkinning::Mode::DualQuaternion } ) {
+			const Timer startTime;
+			for ( int i = 0; i < iterationCount; ++i )
+				SkeletonSkinning::skin( mesh, pose, mode, vertices, normals, tangents );
+			const Timer endTime;
+
+			const double verticesPerSecond = (double)vertexCount * iterationCount / ( Timer::getElapsedTime( endTime, startTime ) / 1000.0 );
+
+			message += ( mode == SkeletonSkinning::Mode::LinearBlend ? " linear blend " : ", dual quaternion " ) + std::to_string( verticesPerSecond / 1000000.0 ) + " M vertices/s";
+
+			Assert::AreEqual( vertexCount, (int)vertices.size() );
+		}
+
+		Logger::WriteMessage( ( message + "\n" ).c_str() );
+	}
+	};
+}
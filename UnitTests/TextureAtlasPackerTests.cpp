@@ -0,0 +1,182 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <random>
+
+#include "TextureAtlasPacker.h"
+#include "MathUtil.h"
+#include "Timer.h"
+
+using namespace Engine1;
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTests
+{
+	TEST_CLASS( TextureAtlasPackerTests )
+	{
+	private:
+
+	// Checks that rectangles (extended by gutters) lie within their pages and don't overlap.
+	static bool isLayoutValid( const std::vector< int2 >& dimensions, const TextureAtlasPacker::Result& result, const int gutter )
+	{
+		if ( result.placements.size() != dimensions.size() )
+			return false;
+
+		for ( size_t i = 0; i < dimensions.size(); ++i ) {
+			const TextureAtlasPacker::Placement& placement = result.placements[ i ];
+
+			if ( placement.pageIndex < 0 || placement.pageIndex >= (int)result.pageDimensions.size() )
+				return false;
+
+			const int2 pageDimensions = result.pageDimensions[ placement.pageIndex ];
+			if ( placement.topLeft.x - gutter < 0 || placement.topLeft.y - gutter < 0
+				|| placement.topLeft.x + dimensions[ i ].x + gutter > pageDimensions.x
+				|| placement.topLeft.y + dimensions[ i ].y + gutter > pageDimensions.y )
+				return false;
+
+			for ( size_t j = i + 1; j < dimensions.size(); ++j ) {
+				const TextureAtlasPacker::Placement& other = result.placements[ j ];
+
+				if ( other.pageIndex != placement.pageIndex )
+					continue;
+
+				const bool overlap = placement.topLeft.x - gutter < other.topLeft.x + dimensions[ j ].x + gutter
+					&& other.topLeft.x - gutter < placement.topLeft.x + dimensions[ i ].x + gutter
+					&& placement.topLeft.y - gutter < other.topLeft.y + dimensions[ j ].y + gutter
+					&& other.topLeft.y - gutter < placement.topLeft.y + dimensions[ i ].y + gutter;
+
+				if ( overlap )
+					return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Mix of texture sizes typical for a selection of scene props - mostly power-of-two with some arbitrary sizes.
+	static std::vector< int2 > getTypicalSelection()
+	{
+		return {
+			int2( 1024, 1024 ), int2( 1024, 1024 ), int2( 512, 512 ), int2( 512, 256 ), int2( 256, 256 ), int2( 256, 256 ),
+			int2( 2048, 1024 ), int2( 128, 128 ), int2( 128, 64 ), int2( 64, 64 ), int2( 300, 200 ), int2( 640, 480 ),
+			int2( 512, 512 ), int2( 1000, 750 ), int2( 96, 96 ), int2( 256, 1024 )
+		};
+	}
+
+	// Atlas size the previous packer (binary split, enlarged by doubling) would produce at best - the smallest power-of-two square holding the total area.
+	static long long getPowerOfTwoAtlasArea( const std::vector< int2 >& dimensions )
+	{
+		long long area = 0;
+		for ( const int2& rectDimensions : dimensions )
+			area += (long long)rectDimensions.x * rectDimensions.y;
+
+		long long side = 1;
+		while ( side * side < area )
+			side *= 2;
+
+		return side * side;
+	}
+
+	public:
+
+	TEST_METHOD( TextureAtlasPacker_Arbitrary_Sizes_Dont_Overlap )
+	{
+		std::vector< int2 > dimensions;
+		for ( int i = 0; i < 60; ++i )
+			dimensions.push_back( int2( 17 + ( i * 37 ) % 200, 9 + ( i * 53 ) % 150 ) );
+
+		const int gutters[] = { 0, 1, 4 };
+		for ( const int gutter : gutters ) {
+			const TextureAtlasPacker::Result result = TextureAtlasPacker::pack( dimensions, TextureAtlasPacker::Options( 4096, gutter ) );
+
+			Assert::AreEqual( 1, (int)result.pageDimensions.size() );
+			Assert::IsTrue( isLayoutValid( dimensions, result, gutter ) );
+			Assert::AreEqual( 0, result.pageDimensions[ 0 ].x % 4 );
+			Assert::AreEqual( 0, result.pageDimensions[ 0 ].y % 4 );
+		}
+	}
+
+	// Search for the smallest page height tries heights which fail - the layout has to come from the last successful attempt.
+	TEST_METHOD( TextureAtlasPacker_Random_Sizes_Dont_Overlap )
+	{
+		std::mt19937 random( 1 );
+		std::uniform_int_distribution< int > size( 1, 300 ), count( 1, 40 ), gutter( 0, 2 );
+
+		for ( int i = 0; i < 200; ++i ) {
+			std::vector< int2 > dimensions( count( random ) );
+			for ( int2& rectDimensions : dimensions )
+				rectDimensions = int2( size( random ), size( random ) );
+
+			const int                        rectGutter = gutter( random );
+			const TextureAtlasPacker::Result result     = TextureAtlasPacker::pack( dimensions, TextureAtlasPacker::Options( 2048, rectGutter ) );
+
+			Assert::IsTrue( isLayoutValid( dimensions, result, rectGutter ) );
+		}
+	}
+
+	TEST_METHOD( TextureAtlasPacker_Single_Texture_Fits_Exactly )
+	{
+		const std::vector< int2 > dimensions = { int2( 256, 128 ) };
+
+		const TextureAtlasPacker::Result result = TextureAtlasPacker::pack( dimensions, TextureAtlasPacker::Options( 4096, 0 ) );
+
+		Assert::IsTrue( result.pageDimensions[ 0 ] == int2( 256, 128 ) );
+		Assert::IsTrue( result.placements[ 0 ].topLeft == int2( 0, 0 ) );
+		Assert::AreEqual( 1.0f, result.getEfficiency() );
+	}
+
+	TEST_METHOD( TextureAtlasPacker_Overflow_Creates_More_Pages )
+	{
+		const std::vector< int2 > dimensions( 9, int2( 500, 500 ) );
+		const int                 gutter = 2;
+
+		const TextureAtlasPacker::Result result = TextureAtlasPacker::pack( dimensions, TextureAtlasPacker::Options( 1024, gutter ) );
+
+		// Only four padded 500x500 rectangles fit in a 1024x1024 page.
+		Assert::AreEqual( 3, (int)result.pageDimensions.size() );
+		Assert::IsTrue( isLayoutValid( dimensions, result, gutter ) );
+
+		for ( const int2& pageDimensions : result.pageDimensions )
+			Assert::IsTrue( pageDimensions.x <= 1024 && pageDimensions.y <= 1024 );
+	}
+
+	TEST_METHOD( TextureAtlasPacker_Too_Large_Rectangle )
+	{
+		try {
+			TextureAtlasPacker::pack( { int2( 1024, 16 ) }, TextureAtlasPacker::Options( 1024, 4 ) );
+		} catch ( ... ) {
+			return;
+		}
+
+		Assert::Fail( L"TextureAtlasPacker::pack didn't throw an exception for a rectangle larger than the page (with gutter)" );
+	}
+
+	TEST_METHOD( TextureAtlasPacker_Typical_Selection_Efficiency )
+	{
+		const std::vector< int2 > dimensions = getTypicalSelection();
+		const int                 gutter     = 4;
+
+		const Timer startTime;
+		const TextureAtlasPacker::Result result = TextureAtlasPacker::pack( dimensions, TextureAtlasPacker::Options( 8192, gutter ) );
+		const Timer endTime;
+
+		Assert::AreEqual( 1, (int)result.pageDimensions.size() );
+		Assert::IsTrue( isLayoutValid( dimensions, result, gutter ) );
+
+		const float powerOfTwoEfficiency = (float)( (double)result.usedArea / (double)getPowerOfTwoAtlasArea( dimensions ) );
+
+		Logger::WriteMessage( (
+			"Atlas " + std::to_string( result.pageDimensions[ 0 ].x ) + "x" + std::to_string( result.pageDimensions[ 0 ].y )
+			+ ", packing efficiency " + std::to_string( result.getEfficiency() )
+			+ " (power-of-two square bound " + std::to_string( powerOfTwoEfficiency ) + ")"
+			+ ", packing time " + std::to_string( Timer::getElapsedTime( endTime, startTime ) ) + " ms\n"
+		).c_str() );
+
+		Assert::IsTrue( result.getEfficiency() >= 0.8f );
+		Assert::IsTrue( result.getEfficiency() > powerOfTwoEfficiency );
+	}
+	};
+}